@@ -115,6 +115,28 @@ INSERT INTO toast_bug SELECT repeat('a', 2200);
 -- Should not get false positive report of corruption:
 SELECT bt_index_check('toasty', true);
 
+--
+-- Test leaf pages with a key prefix
+--
+CREATE TABLE bttest_prefix (a int, t text);
+CREATE INDEX bttest_prefix_idx ON bttest_prefix (a, t)
+  WITH (compress_key_prefixes = on);
+INSERT INTO bttest_prefix
+  SELECT g / 1000, 'https://www.example.com/some/long/path/' || g
+  FROM generate_series(1, 10000) g;
+SELECT bt_index_parent_check('bttest_prefix_idx', heapallindexed => true,
+                             rootdescend => true);
+-- empty some leaf pages, then add tuples that don't match their prefix
+DELETE FROM bttest_prefix WHERE a = 4;
+VACUUM bttest_prefix;
+INSERT INTO bttest_prefix VALUES (4, NULL), (NULL, 'x');
+INSERT INTO bttest_prefix
+  SELECT 4, 'https://www.example.com/other/' || g
+  FROM generate_series(1, 2000) g;
+SELECT bt_index_parent_check('bttest_prefix_idx', heapallindexed => true,
+                             rootdescend => true);
+SELECT bt_index_check('bttest_prefix_idx', true);
+
 --
 -- Check that index expressions and predicates are run as the table's owner
 --
@@ -141,6 +163,7 @@ DROP TABLE bttest_b;
 DROP TABLE bttest_multi;
 DROP TABLE delete_test_table;
 DROP TABLE toast_bug;
+DROP TABLE bttest_prefix;
 DROP FUNCTION ifun(int8);
 DROP OWNED BY regress_bttest_role; -- permissions
 DROP ROLE regress_bttest_role;
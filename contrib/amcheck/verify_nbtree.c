@@ -1121,6 +1121,7 @@ bt_target_page_check(BtreeCheckState *state)
 	{
 		ItemId		itemid;
 		IndexTuple	itup;
+		BTItemBuf	itembuf;
 		size_t		tupsize;
 		BTScanInsert skey;
 		bool		lowersizelimit;
@@ -1138,8 +1139,12 @@ bt_target_page_check(BtreeCheckState *state)
 		 * lp_len is completely redundant in indexes, and both sources of
 		 * tuple length are MAXALIGN()'d.  nbtree does not use lp_len all that
 		 * frequently, and is surprisingly tolerant of corrupt lp_len fields.
+		 *
+		 * Leaf pages with a key prefix are the exception: lp_len is the size
+		 * of the tuple as stored, without the part of its key that's in the
+		 * prefix.  BTPageGetItem() verifies lp_len for those instead.
 		 */
-		if (tupsize != ItemIdGetLength(itemid))
+		if (tupsize != ItemIdGetLength(itemid) && !P_HAS_PREFIX(topaque))
 			ereport(ERROR,
 					(errcode(ERRCODE_INDEX_CORRUPTED),
 					 errmsg("index tuple size does not equal lp_len in index \"%s\"",
@@ -1150,6 +1155,8 @@ bt_target_page_check(BtreeCheckState *state)
 										LSN_FORMAT_ARGS(state->targetlsn)),
 					 errhint("This could be a torn page problem.")));
 
+		itup = BTPageGetItem(state->target, itemid, &itembuf);
+
 		/* Check the number of index tuple attributes */
 		if (!_bt_check_natts(state->rel, state->heapkeyspace, state->target,
 							 offset))
@@ -1230,16 +1237,16 @@ bt_target_page_check(BtreeCheckState *state)
 		if (BTreeTupleIsPosting(itup))
 		{
 			ItemPointerData last;
-			ItemPointer current;
+			ItemPointerData current;
 
 			ItemPointerCopy(BTreeTupleGetHeapTID(itup), &last);
 
 			for (int i = 1; i < BTreeTupleGetNPosting(itup); i++)
 			{
 
-				current = BTreeTupleGetPostingN(itup, i);
+				BTreeTupleGetPostingTID(itup, i, &current);
 
-				if (ItemPointerCompare(current, &last) <= 0)
+				if (ItemPointerCompare(&current, &last) <= 0)
 				{
 					char	   *itid = psprintf("(%u,%u)", state->targetblock, offset);
 
@@ -1252,7 +1259,22 @@ bt_target_page_check(BtreeCheckState *state)
 												LSN_FORMAT_ARGS(state->targetlsn))));
 				}
 
-				ItemPointerCopy(current, &last);
+				ItemPointerCopy(&current, &last);
+			}
+
+			/* Compressed posting list stores its highest TID separately */
+			if (BTreeTupleIsCompressedPosting(itup) &&
+				!ItemPointerEquals(&last, BTreeTupleGetMaxHeapTID(itup)))
+			{
+				char	   *itid = psprintf("(%u,%u)", state->targetblock, offset);
+
+				ereport(ERROR,
+						(errcode(ERRCODE_INDEX_CORRUPTED),
+						 errmsg_internal("compressed posting list has inconsistent highest TID in index \"%s\"",
+										 RelationGetRelationName(state->rel)),
+						 errdetail_internal("Index tid=%s page lsn=%X/%X.",
+											itid,
+											LSN_FORMAT_ARGS(state->targetlsn))));
 			}
 		}
 
@@ -1444,7 +1466,7 @@ bt_target_page_check(BtreeCheckState *state)
 			itemid = PageGetItemIdCareful(state, state->targetblock,
 										  state->target,
 										  OffsetNumberNext(offset));
-			itup = (IndexTuple) PageGetItem(state->target, itemid);
+			itup = BTPageGetItem(state->target, itemid, &itembuf);
 			tid = BTreeTupleGetPointsToTID(itup);
 			nhtid = psprintf("(%u,%u)",
 							 ItemPointerGetBlockNumberNoCheck(tid),
@@ -1764,9 +1786,11 @@ bt_right_page_check_scankey(BtreeCheckState *state)
 
 	/*
 	 * Return first real item scankey.  Note that this relies on right page
-	 * memory remaining allocated.
+	 * memory (and the memory of any expanded copy of the item) remaining
+	 * allocated.
 	 */
-	firstitup = (IndexTuple) PageGetItem(rightpage, rightitem);
+	firstitup = BTPageGetItem(rightpage, rightitem,
+							  palloc(sizeof(BTItemBuf)));
 	return bt_mkscankey_pivotsearch(state->rel, firstitup);
 }
 
@@ -2642,10 +2666,13 @@ bt_normalize_tuple(BtreeCheckState *state, IndexTuple itup)
 static inline IndexTuple
 bt_posting_plain_tuple(IndexTuple itup, int n)
 {
+	ItemPointerData htid;
+
 	Assert(BTreeTupleIsPosting(itup));
 
 	/* Returns non-posting-list tuple */
-	return _bt_form_posting(itup, BTreeTupleGetPostingN(itup, n), 1);
+	BTreeTupleGetPostingTID(itup, n, &htid);
+	return _bt_form_posting(itup, &htid, 1, false);
 }
 
 /*
@@ -2802,11 +2829,12 @@ invariant_l_offset(BtreeCheckState *state, BTScanInsert key,
 	{
 		BTPageOpaque topaque;
 		IndexTuple	ritup;
+		BTItemBuf	itembuf;
 		int			uppnkeyatts;
 		ItemPointer rheaptid;
 		bool		nonpivot;
 
-		ritup = (IndexTuple) PageGetItem(state->target, itemid);
+		ritup = BTPageGetItem(state->target, itemid, &itembuf);
 		topaque = BTPageGetOpaque(state->target);
 		nonpivot = P_ISLEAF(topaque) && upperbound >= P_FIRSTDATAKEY(topaque);
 
@@ -2916,12 +2944,13 @@ invariant_l_nontarget_offset(BtreeCheckState *state, BTScanInsert key,
 	if (cmp == 0)
 	{
 		IndexTuple	child;
+		BTItemBuf	itembuf;
 		int			uppnkeyatts;
 		ItemPointer childheaptid;
 		BTPageOpaque copaque;
 		bool		nonpivot;
 
-		child = (IndexTuple) PageGetItem(nontarget, itemid);
+		child = BTPageGetItem(nontarget, itemid, &itembuf);
 		copaque = BTPageGetOpaque(nontarget);
 		nonpivot = P_ISLEAF(copaque) && upperbound >= P_FIRSTDATAKEY(copaque);
 
@@ -3162,7 +3191,7 @@ PageGetItemIdCareful(BtreeCheckState *state, BlockNumber block, Page page,
 	ItemId		itemid = PageGetItemId(page, offset);
 
 	if (ItemIdGetOffset(itemid) + ItemIdGetLength(itemid) >
-		BLCKSZ - MAXALIGN(sizeof(BTPageOpaqueData)))
+		BLCKSZ - PageGetSpecialSize(page))
 		ereport(ERROR,
 				(errcode(ERRCODE_INDEX_CORRUPTED),
 				 errmsg("line pointer points past end of tuple space in index \"%s\"",
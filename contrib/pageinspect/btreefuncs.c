@@ -315,6 +315,7 @@ bt_page_print_tuples(struct user_args *uargs)
 	HeapTuple	tuple;
 	ItemId		id;
 	IndexTuple	itup;
+	BTItemBuf	itembuf;
 	int			j;
 	int			off;
 	int			dlen;
@@ -328,7 +329,7 @@ bt_page_print_tuples(struct user_args *uargs)
 	if (!ItemIdIsValid(id))
 		elog(ERROR, "invalid ItemId");
 
-	itup = (IndexTuple) PageGetItem(page, id);
+	itup = BTPageGetItem(page, id, &itembuf);
 
 	j = 0;
 	memset(nulls, 0, sizeof(nulls));
@@ -420,8 +421,10 @@ bt_page_print_tuples(struct user_args *uargs)
 		Datum	   *tids_datum;
 		int			nposting;
 
-		tids = BTreeTupleGetPosting(itup);
 		nposting = BTreeTupleGetNPosting(itup);
+		tids = (ItemPointer) palloc(nposting * sizeof(ItemPointerData));
+		for (int i = 0; i < nposting; i++)
+			BTreeTupleGetPostingTID(itup, i, &tids[i]);
 		tids_datum = (Datum *) palloc(nposting * sizeof(Datum));
 		for (int i = 0; i < nposting; i++)
 			tids_datum[i] = ItemPointerGetDatum(&tids[i]);
@@ -431,6 +434,7 @@ bt_page_print_tuples(struct user_args *uargs)
 													  sizeof(ItemPointerData),
 													  false, TYPALIGN_SHORT));
 		pfree(tids_datum);
+		pfree(tids);
 	}
 	else
 		nulls[j++] = true;
@@ -620,7 +624,7 @@ bt_page_items_bytea(PG_FUNCTION_ARGS)
 		uargs->offset = FirstOffsetNumber;
 
 		/* verify the special space has the expected size */
-		if (PageGetSpecialSize(uargs->page) != MAXALIGN(sizeof(BTPageOpaqueData)))
+		if (!BTPageSpecialSizeIsValid(uargs->page))
 			ereport(ERROR,
 					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 					 errmsg("input page is not a valid %s page", "btree"),
@@ -0,0 +1,29 @@
+/* contrib/pg_buffercache/pg_buffercache--1.3--1.4.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pg_buffercache UPDATE TO '1.4'" to load this file. \quit
+
+-- Register the NUMA stripe function.
+CREATE FUNCTION pg_buffercache_numa_nodes(
+    OUT node integer,
+    OUT first_bufferid integer,
+    OUT buffers integer,
+    OUT buffers_used integer,
+    OUT buffers_dirty integer,
+    OUT hits bigint,
+    OUT remote_hits bigint,
+    OUT allocs bigint)
+RETURNS SETOF RECORD
+AS 'MODULE_PATHNAME', 'pg_buffercache_numa_nodes'
+LANGUAGE C PARALLEL SAFE;
+
+-- Create a view for convenient access.
+CREATE VIEW pg_buffercache_numa AS
+	SELECT * FROM pg_buffercache_numa_nodes();
+
+-- Don't want these to be available to public.
+REVOKE ALL ON FUNCTION pg_buffercache_numa_nodes() FROM PUBLIC;
+REVOKE ALL ON pg_buffercache_numa FROM PUBLIC;
+
+GRANT EXECUTE ON FUNCTION pg_buffercache_numa_nodes() TO pg_monitor;
+GRANT SELECT ON pg_buffercache_numa TO pg_monitor;
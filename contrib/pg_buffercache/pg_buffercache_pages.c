@@ -11,12 +11,14 @@
 #include "access/htup_details.h"
 #include "catalog/pg_type.h"
 #include "funcapi.h"
+#include "miscadmin.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 
 
 #define NUM_BUFFERCACHE_PAGES_MIN_ELEM	8
 #define NUM_BUFFERCACHE_PAGES_ELEM	9
+#define NUM_BUFFERCACHE_NUMA_NODES_ELEM	8
 
 PG_MODULE_MAGIC;
 
@@ -59,6 +61,7 @@ typedef struct
  * relation node/tablespace/database/blocknum and dirty indicator.
  */
 PG_FUNCTION_INFO_V1(pg_buffercache_pages);
+PG_FUNCTION_INFO_V1(pg_buffercache_numa_nodes);
 
 Datum
 pg_buffercache_pages(PG_FUNCTION_ARGS)
@@ -237,3 +240,70 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 	else
 		SRF_RETURN_DONE(funcctx);
 }
+
+/*
+ * Function returning one row per NUMA stripe of the shared buffer cache -
+ * node, range of buffers, usage and hit statistics.  Returns no rows if
+ * numa_shared_buffers is not in use.
+ */
+Datum
+pg_buffercache_numa_nodes(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	int			nstripes;
+	int			stripeno;
+
+	SetSingleFuncCall(fcinfo, 0);
+
+	nstripes = BufferNumaStripes();
+	for (stripeno = 0; stripeno < nstripes; stripeno++)
+	{
+		Datum		values[NUM_BUFFERCACHE_NUMA_NODES_ELEM];
+		bool		nulls[NUM_BUFFERCACHE_NUMA_NODES_ELEM];
+		int			os_node;
+		int			first_buffer;
+		int			nbuffers;
+		uint64		hits;
+		uint64		remote_hits;
+		uint64		allocs;
+		int32		buffers_used = 0;
+		int32		buffers_dirty = 0;
+		int			i;
+
+		BufferNumaGetStripe(stripeno, &os_node, &first_buffer, &nbuffers,
+							&hits, &remote_hits, &allocs);
+
+		/*
+		 * As in pg_buffercache_pages(), we don't get a consistent snapshot
+		 * across buffers, but look at each one under its header lock.
+		 */
+		for (i = first_buffer; i < first_buffer + nbuffers; i++)
+		{
+			BufferDesc *bufHdr = GetBufferDescriptor(i);
+			uint32		buf_state;
+
+			buf_state = LockBufHdr(bufHdr);
+			if ((buf_state & BM_VALID) && (buf_state & BM_TAG_VALID))
+				buffers_used++;
+			if (buf_state & BM_DIRTY)
+				buffers_dirty++;
+			UnlockBufHdr(bufHdr, buf_state);
+		}
+
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = Int32GetDatum(os_node);
+		values[1] = Int32GetDatum(first_buffer + 1);
+		values[2] = Int32GetDatum(nbuffers);
+		values[3] = Int32GetDatum(buffers_used);
+		values[4] = Int32GetDatum(buffers_dirty);
+		values[5] = Int64GetDatum((int64) hits);
+		values[6] = Int64GetDatum((int64) remote_hits);
+		values[7] = Int64GetDatum((int64) allocs);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	return (Datum) 0;
+}
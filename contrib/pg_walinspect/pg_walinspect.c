@@ -35,6 +35,7 @@ PG_FUNCTION_INFO_V1(pg_get_wal_records_info);
 PG_FUNCTION_INFO_V1(pg_get_wal_records_info_till_end_of_wal);
 PG_FUNCTION_INFO_V1(pg_get_wal_stats);
 PG_FUNCTION_INFO_V1(pg_get_wal_stats_till_end_of_wal);
+PG_FUNCTION_INFO_V1(pg_get_wal_fpi_stats);
 
 static bool IsFutureLSN(XLogRecPtr lsn, XLogRecPtr *curr_lsn);
 static XLogReaderState *InitXLogReaderState(XLogRecPtr lsn,
@@ -55,8 +56,12 @@ static void FillXLogStatsRow(const char *name, uint64 n, uint64 total_count,
 							 uint64 fpi_len, uint64 total_fpi_len,
 							 uint64 tot_len, uint64 total_len,
 							 Datum *values, bool *nulls, uint32 ncols);
+static void CollectWalStats(XLogRecPtr start_lsn, XLogRecPtr end_lsn,
+							XLogStats *stats);
 static void GetWalStats(FunctionCallInfo fcinfo, XLogRecPtr start_lsn,
 						XLogRecPtr end_lsn, bool stats_per_record);
+static void FillXLogFPIStatsRow(const char *name, XLogRecStats *recstats,
+								Datum *values, bool *nulls, uint32 ncols);
 
 /*
  * Check if the given LSN is in future. Also, return the LSN up to which the
@@ -547,36 +552,46 @@ GetXLogSummaryStats(XLogStats *stats, ReturnSetInfo *rsinfo,
 }
 
 /*
- * Get WAL stats between start LSN and end LSN.
+ * Accumulate stats of the WAL records between start LSN and end LSN.
  */
 static void
-GetWalStats(FunctionCallInfo fcinfo, XLogRecPtr start_lsn,
-			XLogRecPtr end_lsn, bool stats_per_record)
+CollectWalStats(XLogRecPtr start_lsn, XLogRecPtr end_lsn, XLogStats *stats)
 {
-#define PG_GET_WAL_STATS_COLS 9
 	XLogRecPtr	first_record;
 	XLogReaderState *xlogreader;
-	XLogStats	stats;
-	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
-	Datum		values[PG_GET_WAL_STATS_COLS];
-	bool		nulls[PG_GET_WAL_STATS_COLS];
-
-	SetSingleFuncCall(fcinfo, 0);
 
 	xlogreader = InitXLogReaderState(start_lsn, &first_record);
 
-	MemSet(&stats, 0, sizeof(stats));
+	MemSet(stats, 0, sizeof(XLogStats));
 
 	while (ReadNextXLogRecord(xlogreader, first_record) &&
 		   xlogreader->EndRecPtr <= end_lsn)
 	{
-		XLogRecStoreStats(&stats, xlogreader);
+		XLogRecStoreStats(stats, xlogreader);
 
 		CHECK_FOR_INTERRUPTS();
 	}
 
 	pfree(xlogreader->private_data);
 	XLogReaderFree(xlogreader);
+}
+
+/*
+ * Get WAL stats between start LSN and end LSN.
+ */
+static void
+GetWalStats(FunctionCallInfo fcinfo, XLogRecPtr start_lsn,
+			XLogRecPtr end_lsn, bool stats_per_record)
+{
+#define PG_GET_WAL_STATS_COLS 9
+	XLogStats	stats;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Datum		values[PG_GET_WAL_STATS_COLS];
+	bool		nulls[PG_GET_WAL_STATS_COLS];
+
+	SetSingleFuncCall(fcinfo, 0);
+
+	CollectWalStats(start_lsn, end_lsn, &stats);
 
 	MemSet(values, 0, sizeof(values));
 	MemSet(nulls, 0, sizeof(nulls));
@@ -634,3 +649,113 @@ pg_get_wal_stats_till_end_of_wal(PG_FUNCTION_ARGS)
 
 	PG_RETURN_VOID();
 }
+
+/*
+ * Fill in a row of full-page image compression stats.
+ */
+static void
+FillXLogFPIStatsRow(const char *name, XLogRecStats *recstats,
+					Datum *values, bool *nulls, uint32 ncols)
+{
+	int			i = 0;
+
+	values[i++] = CStringGetTextDatum(name);
+	values[i++] = Int64GetDatum(recstats->fpi_count);
+	values[i++] = Int64GetDatum(recstats->fpi_len);
+	values[i++] = Int64GetDatum(recstats->fpi_raw_len);
+	if (recstats->fpi_len != 0)
+		values[i++] = Float4GetDatum((double) recstats->fpi_raw_len /
+									 recstats->fpi_len);
+	else
+		nulls[i++] = true;
+
+	Assert(i == ncols);
+}
+
+/*
+ * Get stats about the full-page images of the WAL records between start LSN
+ * and end LSN: how many there are, how much space they take, and how much
+ * they would take without compression.  Rows without any full-page image are
+ * omitted.
+ *
+ * This function emits an error if a future start or end WAL LSN i.e. WAL LSN
+ * the database system doesn't know about is specified.
+ */
+Datum
+pg_get_wal_fpi_stats(PG_FUNCTION_ARGS)
+{
+#define PG_GET_WAL_FPI_STATS_COLS 5
+	XLogRecPtr	start_lsn;
+	XLogRecPtr	end_lsn;
+	bool		stats_per_record;
+	XLogStats	stats;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Datum		values[PG_GET_WAL_FPI_STATS_COLS];
+	bool		nulls[PG_GET_WAL_FPI_STATS_COLS];
+	int			ri;
+
+	start_lsn = PG_GETARG_LSN(0);
+	end_lsn = PG_GETARG_LSN(1);
+	stats_per_record = PG_GETARG_BOOL(2);
+
+	end_lsn = ValidateInputLSNs(false, start_lsn, end_lsn);
+
+	SetSingleFuncCall(fcinfo, 0);
+
+	CollectWalStats(start_lsn, end_lsn, &stats);
+
+	for (ri = 0; ri <= RM_MAX_ID; ri++)
+	{
+		RmgrData	desc;
+
+		if (!RmgrIdIsValid(ri))
+			continue;
+
+		if (!RmgrIdExists(ri))
+			continue;
+
+		desc = GetRmgr(ri);
+
+		if (stats_per_record)
+		{
+			int			rj;
+
+			for (rj = 0; rj < MAX_XLINFO_TYPES; rj++)
+			{
+				const char *id;
+
+				if (stats.record_stats[ri][rj].fpi_count == 0)
+					continue;
+
+				/* the upper four bits in xl_info are the rmgr's */
+				id = desc.rm_identify(rj << 4);
+				if (id == NULL)
+					id = psprintf("UNKNOWN (%x)", rj << 4);
+
+				MemSet(nulls, 0, sizeof(nulls));
+				FillXLogFPIStatsRow(psprintf("%s/%s", desc.rm_name, id),
+									&stats.record_stats[ri][rj],
+									values, nulls, PG_GET_WAL_FPI_STATS_COLS);
+
+				tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+									 values, nulls);
+			}
+		}
+		else
+		{
+			if (stats.rmgr_stats[ri].fpi_count == 0)
+				continue;
+
+			MemSet(nulls, 0, sizeof(nulls));
+			FillXLogFPIStatsRow(desc.rm_name, &stats.rmgr_stats[ri],
+								values, nulls, PG_GET_WAL_FPI_STATS_COLS);
+
+			tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+								 values, nulls);
+		}
+	}
+
+#undef PG_GET_WAL_FPI_STATS_COLS
+
+	PG_RETURN_VOID();
+}
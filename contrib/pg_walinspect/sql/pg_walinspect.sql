@@ -35,6 +35,8 @@ SELECT COUNT(*) >= 0 AS ok FROM pg_get_wal_stats(:'wal_lsn1', :'wal_lsn2');
 
 SELECT COUNT(*) >= 0 AS ok FROM pg_get_wal_stats_till_end_of_wal(:'wal_lsn1');
 
+SELECT COUNT(*) >= 0 AS ok FROM pg_get_wal_fpi_stats(:'wal_lsn1', :'wal_lsn2', true);
+
 -- ===================================================================
 -- Test for filtering out WAL records of a particular table
 -- ===================================================================
@@ -168,6 +168,26 @@ static relopt_bool boolRelOpts[] =
 		},
 		true
 	},
+	{
+		{
+			"compress_posting_lists",
+			"Compresses posting lists created by deduplication in this btree index",
+			RELOPT_KIND_BTREE,
+			ShareUpdateExclusiveLock	/* since it applies only to later
+										 * inserts */
+		},
+		false
+	},
+	{
+		{
+			"compress_key_prefixes",
+			"Stores leaf pages of this btree index with a common key prefix",
+			RELOPT_KIND_BTREE,
+			ShareUpdateExclusiveLock	/* since it applies only to later
+										 * page splits */
+		},
+		false
+	},
 	/* list terminator */
 	{{NULL}}
 };
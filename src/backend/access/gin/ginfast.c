@@ -3,9 +3,10 @@
  * ginfast.c
  *	  Fast insert routines for the Postgres inverted index access method.
  *	  Pending entries are stored in linear list of pages.  Later on
- *	  (typically during VACUUM), ginInsertCleanup() will be invoked to
- *	  transfer pending entries into the regular index structure.  This
- *	  wins because bulk insertion is much more efficient than retail.
+ *	  (typically during VACUUM, or by autovacuum once the list has grown
+ *	  too long), ginInsertCleanup() will be invoked to transfer pending
+ *	  entries into the regular index structure.  This wins because bulk
+ *	  insertion is much more efficient than retail.
  *
  * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -20,6 +21,8 @@
 
 #include "access/gin_private.h"
 #include "access/ginxlog.h"
+#include "access/relation.h"
+#include "access/table.h"
 #include "access/xlog.h"
 #include "access/xloginsert.h"
 #include "catalog/pg_am.h"
@@ -49,6 +52,7 @@ typedef struct KeyArray
 	int32		maxvalues;		/* allocated size of arrays */
 } KeyArray;
 
+static bool ginCanCleanupInBackground(Relation index);
 
 /*
  * Build a pending-list page from the given array of tuples, and write it out.
@@ -227,7 +231,9 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	ginxlogUpdateMeta data;
 	bool		separateList = false;
 	bool		needCleanup = false;
+	bool		overHardLimit = false;
 	int			cleanupSize;
+	int64		pendingSize;
 	bool		needWal;
 
 	if (collector->ntuples == 0)
@@ -447,19 +453,72 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	 * ginInsertCleanup() should not be called inside our CRIT_SECTION.
 	 */
 	cleanupSize = GinGetPendingListCleanupSize(index);
-	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * 1024L)
+	pendingSize = (int64) metadata->nPendingPages * GIN_PAGE_FREESIZE;
+	if (pendingSize > (int64) cleanupSize * 1024)
 		needCleanup = true;
+	if (pendingSize >
+		(int64) cleanupSize * 1024 * GIN_PENDING_LIST_HARD_LIMIT_FACTOR)
+		overHardLimit = true;
 
 	UnlockReleaseBuffer(metabuffer);
 
 	END_CRIT_SECTION();
 
-	/*
-	 * Since it could contend with concurrent cleanup process we cleanup
-	 * pending list not forcibly.
-	 */
-	if (needCleanup)
+	if (!needCleanup)
+		return;
+
+	if (overHardLimit)
+	{
+		/*
+		 * Background cleanup isn't keeping up (or isn't happening at all), so
+		 * apply back-pressure: clean up the list ourselves, waiting for any
+		 * concurrent cleanup to finish first.
+		 */
+		ginInsertCleanup(ginstate, false, true, true, NULL);
+	}
+	else if (!ginCanCleanupInBackground(index))
+	{
+		/*
+		 * Since it could contend with concurrent cleanup process we cleanup
+		 * pending list not forcibly.
+		 */
 		ginInsertCleanup(ginstate, false, true, false, NULL);
+	}
+	else if (separateList)
+	{
+		/*
+		 * Ask autovacuum to clean up the list, so this insertion doesn't have
+		 * to wait for that.  Only inserts that add pages to the list ask, so
+		 * that we don't keep asking for every tuple.  If the request can't be
+		 * recorded, clean up the list ourselves as before.
+		 */
+		if (!AutoVacuumRequestWork(AVW_GINCleanupPendingList,
+								   RelationGetRelid(index),
+								   InvalidBlockNumber))
+			ginInsertCleanup(ginstate, false, true, false, NULL);
+	}
+}
+
+/*
+ * Can autovacuum clean up the pending list of this index for us?
+ */
+static bool
+ginCanCleanupInBackground(Relation index)
+{
+	Relation	heapRel;
+	bool		enabled;
+
+	/* autovacuum can't process temporary tables */
+	if (!AutoVacuumingActive() || RelationUsesLocalBuffers(index))
+		return false;
+
+	/* Respect the table's autovacuum_enabled storage parameter */
+	heapRel = table_open(index->rd_index->indrelid, NoLock);
+	enabled = heapRel->rd_options == NULL ||
+		((StdRdOptions *) heapRel->rd_options)->autovacuum.enabled;
+	table_close(heapRel, NoLock);
+
+	return enabled;
 }
 
 /*
@@ -801,8 +860,10 @@ ginInsertCleanup(GinState *ginstate, bool full_clean,
 	if (forceCleanup)
 	{
 		/*
-		 * We are called from [auto]vacuum/analyze or gin_clean_pending_list()
-		 * and we would like to wait concurrent cleanup to finish.
+		 * We are called from [auto]vacuum/analyze, gin_clean_pending_list(),
+		 * an autovacuum work item, or an insert that found the pending list
+		 * over its hard limit, and we would like to wait concurrent cleanup
+		 * to finish.
 		 */
 		LockPage(index, GIN_METAPAGE_BLKNO, ExclusiveLock);
 		workMemory =
@@ -1018,6 +1079,40 @@ ginInsertCleanup(GinState *ginstate, bool full_clean,
 	MemoryContextDelete(opCtx);
 }
 
+/*
+ * Clean up the pending list of a GIN index, as requested of autovacuum by
+ * ginHeapTupleFastInsert().
+ *
+ * The work done by each call is bounded: only the pages that are in the list
+ * when we start are moved into the main structure, in batches that fit in
+ * autovacuum_work_mem.  If inserts keep the list growing past the limit, they
+ * will request another call.
+ */
+void
+ginCleanupPendingListWorkItem(Oid indexoid)
+{
+	Relation	indexRel;
+	GinState	ginstate;
+
+	/* The index might have been dropped since the request was made */
+	indexRel = try_relation_open(indexoid, RowExclusiveLock);
+	if (indexRel == NULL)
+		return;
+
+	/* ... and its OID even reused for something else */
+	if (indexRel->rd_rel->relkind != RELKIND_INDEX ||
+		indexRel->rd_rel->relam != GIN_AM_OID)
+	{
+		relation_close(indexRel, RowExclusiveLock);
+		return;
+	}
+
+	initGinState(&ginstate, indexRel);
+	ginInsertCleanup(&ginstate, false, true, true, NULL);
+
+	relation_close(indexRel, RowExclusiveLock);
+}
+
 /*
  * SQL-callable function to clean the insert pending list
  */
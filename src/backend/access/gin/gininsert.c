@@ -16,16 +16,138 @@
 
 #include "access/gin_private.h"
 #include "access/ginxlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/indexfsm.h"
 #include "storage/predicate.h"
+#include "storage/sharedfileset.h"
 #include "storage/smgr.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/datum.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIN_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB000000000000003)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB000000000000004)
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ *
+ * Each participant scans part of the heap and accumulates entries in its own
+ * BuildAccumulator.  Whenever that fills up, the participant writes out its
+ * entries as a sorted run, which is a temporary file in the shared fileset.
+ * Once all participants are done, the leader merges the runs and inserts
+ * each key with all of its heap TIDs into the index.
+ */
+typedef struct GinShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to open the relations.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			nparticipants;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can start
+	 * merging their runs.
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects the fields below it.
+	 *
+	 * nparticipantsdone is number of participants finished.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 *
+	 * indtuples is the total number of entries extracted from them.
+	 *
+	 * brokenhotchain indicates if any worker detected a broken HOT chain
+	 * during build.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/* Temporary files holding the participants' sorted runs */
+	SharedFileSet fileset;
+
+	/*
+	 * nruns[i] is the number of runs written by participant i.  Workers use
+	 * their ParallelWorkerNumber as i, and the leader uses the last slot.
+	 */
+	int			nruns[FLEXIBLE_ARRAY_MEMBER];
+
+	/*
+	 * ParallelTableScanDescData data follows the nruns array.  Can't directly
+	 * embed here, as implementations of the parallel table scan desc
+	 * interface might need stronger alignment.
+	 */
+} GinShared;
+
+/*
+ * Size of GinShared with the given number of participant slots, not counting
+ * the parallel table scan.
+ */
+#define GinSharedSize(nparticipants) \
+	(offsetof(GinShared, nruns) + sizeof(int) * (nparticipants))
+
+/*
+ * Return pointer to a GinShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromGinShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + \
+							 BUFFERALIGN(GinSharedSize((shared)->nparticipants)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipants is the exact number of worker processes successfully
+	 * launched, plus one leader process if it participates as a worker.
+	 */
+	int			nparticipants;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).  snapshot is the snapshot used by the scan iff an MVCC
+	 * snapshot is required.
+	 */
+	GinShared  *ginshared;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} GinLeader;
 
 typedef struct
 {
@@ -35,8 +157,77 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+
+	/* memory to use for accumulating entries, in kilobytes */
+	int			workmem;
+
+	/*
+	 * ginleader is only present when a parallel index build is performed,
+	 * and only in the leader process.
+	 */
+	GinLeader  *ginleader;
+
+	/*
+	 * In a parallel build participant, ginshared is the shared state, and
+	 * participant is our slot in its nruns array.  Accumulated entries are
+	 * then written out as runs, rather than inserted into the index.
+	 */
+	GinShared  *ginshared;
+	int			participant;
 } GinBuildState;
 
+/*
+ * Header of each entry in a sorted run.  It's followed by the serialized key
+ * (if keylen > 0), and then by nitems heap TIDs in ascending order.
+ */
+typedef struct GinRunEntryHeader
+{
+	OffsetNumber attnum;
+	GinNullCategory category;
+	uint32		nitems;
+	Size		keylen;
+} GinRunEntryHeader;
+
+/*
+ * Reader for one sorted run, used by the leader to merge the runs.  The
+ * current entry of the run is kept here.
+ */
+typedef struct GinRunReader
+{
+	BufFile    *file;
+	OffsetNumber attnum;
+	Datum		key;
+	GinNullCategory category;
+	bool		keyalloced;		/* key points to palloc'd memory? */
+	ItemPointerData *items;
+	uint32		nitems;
+} GinRunReader;
+
+typedef struct GinMergeState
+{
+	GinState   *ginstate;
+	GinRunReader *readers;
+} GinMergeState;
+
+static void _gin_begin_parallel(GinBuildState *buildstate, Relation heap,
+								Relation index, bool isconcurrent,
+								int request);
+static void _gin_end_parallel(GinLeader *ginleader);
+static Size _gin_parallel_estimate_shared(Relation heap, Snapshot snapshot,
+										  int nparticipants);
+static double _gin_parallel_heapscan(GinBuildState *buildstate,
+									 bool *brokenhotchain);
+static void _gin_parallel_merge(GinBuildState *buildstate);
+static void _gin_leader_participate_as_worker(GinBuildState *buildstate,
+											  Relation heap, Relation index);
+static void _gin_parallel_scan_and_build(GinShared *ginshared,
+										 Relation heap, Relation index,
+										 int workmem, int participant,
+										 bool progress);
+static void _gin_write_run(GinBuildState *buildstate);
+static bool _gin_read_run_entry(GinState *ginstate, GinRunReader *reader);
+static int	_gin_run_cmp(Datum a, Datum b, void *arg);
+
 
 /*
  * Adds array of item pointers to tuple's posting list, or
@@ -290,23 +481,31 @@ ginBuildCallback(Relation index, ItemPointer tid, Datum *values,
 		ginHeapTupleBulkInsert(buildstate, (OffsetNumber) (i + 1),
 							   values[i], isnull[i], tid);
 
-	/* If we've maxed out our available memory, dump everything to the index */
-	if (buildstate->accum.allocatedMemory >= (Size) maintenance_work_mem * 1024L)
+	/*
+	 * If we've maxed out our available memory, dump everything to the index,
+	 * or to a new sorted run in a parallel build
+	 */
+	if (buildstate->accum.allocatedMemory >= (Size) buildstate->workmem * 1024L)
 	{
-		ItemPointerData *list;
-		Datum		key;
-		GinNullCategory category;
-		uint32		nlist;
-		OffsetNumber attnum;
-
-		ginBeginBAScan(&buildstate->accum);
-		while ((list = ginGetBAEntry(&buildstate->accum,
-									 &attnum, &key, &category, &nlist)) != NULL)
+		if (buildstate->ginshared)
+			_gin_write_run(buildstate);
+		else
 		{
-			/* there could be many entries, so be willing to abort here */
-			CHECK_FOR_INTERRUPTS();
-			ginEntryInsert(&buildstate->ginstate, attnum, key, category,
-						   list, nlist, &buildstate->buildStats);
+			ItemPointerData *list;
+			Datum		key;
+			GinNullCategory category;
+			uint32		nlist;
+			OffsetNumber attnum;
+
+			ginBeginBAScan(&buildstate->accum);
+			while ((list = ginGetBAEntry(&buildstate->accum,
+										 &attnum, &key, &category, &nlist)) != NULL)
+			{
+				/* there could be many entries, so be willing to abort here */
+				CHECK_FOR_INTERRUPTS();
+				ginEntryInsert(&buildstate->ginstate, attnum, key, category,
+							   list, nlist, &buildstate->buildStats);
+			}
 		}
 
 		MemoryContextReset(buildstate->tmpCtx);
@@ -338,6 +537,10 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	initGinState(&buildstate.ginstate, index);
 	buildstate.indtuples = 0;
 	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.workmem = maintenance_work_mem;
+	buildstate.ginleader = NULL;
+	buildstate.ginshared = NULL;
+	buildstate.participant = -1;
 
 	/* initialize the meta page */
 	MetaBuffer = GinNewBuffer(index);
@@ -378,26 +581,49 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	buildstate.accum.ginstate = &buildstate.ginstate;
 	ginInitBA(&buildstate.accum);
 
-	/*
-	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
-	 * prefers to receive tuples in TID order.
-	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   ginBuildCallback, (void *) &buildstate,
-									   NULL);
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_gin_begin_parallel(&buildstate, heap, index, indexInfo->ii_Concurrent,
+							indexInfo->ii_ParallelWorkers);
 
-	/* dump remaining entries to the index */
-	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	ginBeginBAScan(&buildstate.accum);
-	while ((list = ginGetBAEntry(&buildstate.accum,
-								 &attnum, &key, &category, &nlist)) != NULL)
+	if (buildstate.ginleader)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		ginEntryInsert(&buildstate.ginstate, attnum, key, category,
-					   list, nlist, &buildstate.buildStats);
+		bool		brokenhotchain;
+
+		/*
+		 * Wait for all participants to write out their runs, then merge the
+		 * runs into the index
+		 */
+		reltuples = _gin_parallel_heapscan(&buildstate, &brokenhotchain);
+		if (brokenhotchain)
+			indexInfo->ii_BrokenHotChain = true;
+
+		_gin_parallel_merge(&buildstate);
+		_gin_end_parallel(buildstate.ginleader);
+	}
+	else
+	{
+		/*
+		 * Do the heap scan.  We disallow sync scan here because
+		 * dataPlaceToPage prefers to receive tuples in TID order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   ginBuildCallback, (void *) &buildstate,
+										   NULL);
+
+		/* dump remaining entries to the index */
+		oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+		ginBeginBAScan(&buildstate.accum);
+		while ((list = ginGetBAEntry(&buildstate.accum,
+									 &attnum, &key, &category, &nlist)) != NULL)
+		{
+			/* there could be many entries, so be willing to abort here */
+			CHECK_FOR_INTERRUPTS();
+			ginEntryInsert(&buildstate.ginstate, attnum, key, category,
+						   list, nlist, &buildstate.buildStats);
+		}
+		MemoryContextSwitchTo(oldCtx);
 	}
-	MemoryContextSwitchTo(oldCtx);
 
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
@@ -539,3 +765,696 @@ gininsert(Relation index, Datum *values, bool *isnull,
 
 	return false;
 }
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * buildstate argument should be initialized (with the exception of the
+ * parallel state, which is set here).
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's GinLeader, which caller must use to shut down parallel
+ * mode by passing it to _gin_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_gin_begin_parallel(GinBuildState *buildstate, Relation heap, Relation index,
+					bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			nparticipants;
+	Snapshot	snapshot;
+	Size		estginshared;
+	GinShared  *ginshared;
+	GinLeader  *ginleader = (GinLeader *) palloc0(sizeof(GinLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of gin index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gin_parallel_build_main",
+								 request);
+
+	/* The leader always participates as a worker, using the last slot */
+	nparticipants = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/* Estimate size for our own PARALLEL_KEY_GIN_SHARED workspace */
+	estginshared = _gin_parallel_estimate_shared(heap, snapshot, nparticipants);
+	shm_toc_estimate_chunk(&pcxt->estimator, estginshared);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 *
+	 * If there are no extensions loaded that care, we could skip this.  We
+	 * have no way of knowing whether anyone's looking at pgWalUsage or
+	 * pgBufferUsage, so do it unconditionally.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	ginshared = (GinShared *) shm_toc_allocate(pcxt->toc, estginshared);
+	/* Initialize immutable state */
+	ginshared->heaprelid = RelationGetRelid(heap);
+	ginshared->indexrelid = RelationGetRelid(index);
+	ginshared->isconcurrent = isconcurrent;
+	ginshared->nparticipants = nparticipants;
+	ConditionVariableInit(&ginshared->workersdonecv);
+	SpinLockInit(&ginshared->mutex);
+	/* Initialize mutable state */
+	ginshared->nparticipantsdone = 0;
+	ginshared->reltuples = 0.0;
+	ginshared->indtuples = 0.0;
+	ginshared->brokenhotchain = false;
+	SharedFileSetInit(&ginshared->fileset, pcxt->seg);
+	memset(ginshared->nruns, 0, sizeof(int) * nparticipants);
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromGinShared(ginshared),
+								  snapshot);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_SHARED, ginshared);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	ginleader->pcxt = pcxt;
+	ginleader->nparticipants = pcxt->nworkers_launched + 1;
+	ginleader->ginshared = ginshared;
+	ginleader->snapshot = snapshot;
+	ginleader->walusage = walusage;
+	ginleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_gin_end_parallel(ginleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->ginleader = ginleader;
+
+	/*
+	 * Caller needs to wait for all launched workers to report that they are
+	 * done.  Make sure that the failure-to-start case will not hang forever,
+	 * before the leader starts participating.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+
+	/* Join heap scan ourselves */
+	_gin_leader_participate_as_worker(buildstate, heap, index);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_gin_end_parallel(GinLeader *ginleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < ginleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&ginleader->bufferusage[i], &ginleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(ginleader->snapshot))
+		UnregisterSnapshot(ginleader->snapshot);
+	DestroyParallelContext(ginleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * gin index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_gin_parallel_estimate_shared(Relation heap, Snapshot snapshot,
+							  int nparticipants)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(GinSharedSize(nparticipants)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Within leader, wait for end of heap scan.
+ *
+ * When called, parallel heap scan started by _gin_begin_parallel() will
+ * already be underway within worker processes (when leader participates
+ * as a worker, we should end up here just as workers are finishing).
+ *
+ * Fills in fields needed for ambuild statistics, and lets caller set
+ * field indicating that some worker encountered a broken HOT chain.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_gin_parallel_heapscan(GinBuildState *buildstate, bool *brokenhotchain)
+{
+	GinShared  *ginshared = buildstate->ginleader->ginshared;
+	int			nparticipants;
+	double		reltuples;
+
+	nparticipants = buildstate->ginleader->nparticipants;
+	for (;;)
+	{
+		SpinLockAcquire(&ginshared->mutex);
+		if (ginshared->nparticipantsdone == nparticipants)
+		{
+			buildstate->indtuples = ginshared->indtuples;
+			*brokenhotchain = ginshared->brokenhotchain;
+			reltuples = ginshared->reltuples;
+			SpinLockRelease(&ginshared->mutex);
+			break;
+		}
+		SpinLockRelease(&ginshared->mutex);
+
+		ConditionVariableSleep(&ginshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return reltuples;
+}
+
+/*
+ * Within leader, merge the sorted runs written by all participants, and
+ * insert the entries into the index.
+ *
+ * Each run is in key order, so a k-way merge produces every key exactly once
+ * (with the TIDs from all runs that have it), in key order.  That lets us
+ * insert each key's complete TID list with a single ginEntryInsert() call,
+ * building its posting list or posting tree in one go, and the entry tree
+ * fills from left to right.
+ */
+static void
+_gin_parallel_merge(GinBuildState *buildstate)
+{
+	GinShared  *ginshared = buildstate->ginleader->ginshared;
+	GinState   *ginstate = &buildstate->ginstate;
+	GinMergeState mergestate;
+	GinRunReader *readers;
+	binaryheap *heap;
+	int		   *pending;
+	int			nreaders;
+	Size		maxitems;
+	MemoryContext oldCtx;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	nreaders = 0;
+	for (int i = 0; i < ginshared->nparticipants; i++)
+		nreaders += ginshared->nruns[i];
+
+	readers = (GinRunReader *) palloc0(sizeof(GinRunReader) * Max(nreaders, 1));
+	pending = (int *) palloc(sizeof(int) * Max(nreaders, 1));
+	mergestate.ginstate = ginstate;
+	mergestate.readers = readers;
+	heap = binaryheap_allocate(Max(nreaders, 1), _gin_run_cmp, &mergestate);
+
+	/* Open every run, and read its first entry */
+	nreaders = 0;
+	for (int i = 0; i < ginshared->nparticipants; i++)
+	{
+		for (int run = 0; run < ginshared->nruns[i]; run++)
+		{
+			GinRunReader *reader = &readers[nreaders];
+			char		name[MAXPGPATH];
+
+			snprintf(name, sizeof(name), "gin.%d.%d", i, run);
+			reader->file = BufFileOpenFileSet(&ginshared->fileset.fs, name,
+											  O_RDONLY, false);
+			if (_gin_read_run_entry(ginstate, reader))
+				binaryheap_add_unordered(heap, Int32GetDatum(nreaders));
+			nreaders++;
+		}
+	}
+	binaryheap_build(heap);
+
+	/*
+	 * Don't merge more heap TIDs for a single key than fit in
+	 * maintenance_work_mem (or in one allocation).  Any further TIDs for the
+	 * key are inserted by another ginEntryInsert() call.
+	 */
+	maxitems = Min((Size) maintenance_work_mem * 1024L, MaxAllocSize) /
+		sizeof(ItemPointerData);
+
+	while (!binaryheap_empty(heap))
+	{
+		GinRunReader *first;
+		ItemPointerData *items;
+		uint32		nitems;
+		bool		merged = false;
+		int			npending = 0;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		pending[npending++] = DatumGetInt32(binaryheap_remove_first(heap));
+		first = &readers[pending[0]];
+		items = first->items;
+		nitems = first->nitems;
+
+		/* Collect the TIDs of all other runs whose next entry has this key */
+		while (!binaryheap_empty(heap))
+		{
+			int			next = DatumGetInt32(binaryheap_first(heap));
+			GinRunReader *reader = &readers[next];
+
+			if (ginCompareAttEntries(ginstate,
+									 first->attnum, first->key, first->category,
+									 reader->attnum, reader->key,
+									 reader->category) != 0)
+				break;
+
+			(void) binaryheap_remove_first(heap);
+			pending[npending++] = next;
+
+			if (nitems + reader->nitems > maxitems)
+			{
+				ginEntryInsert(ginstate, first->attnum, first->key,
+							   first->category, items, nitems,
+							   &buildstate->buildStats);
+				if (merged)
+					pfree(items);
+				items = reader->items;
+				nitems = reader->nitems;
+				merged = false;
+			}
+			else
+			{
+				ItemPointerData *newitems;
+				int			nnew;
+
+				newitems = ginMergeItemPointers(items, nitems,
+												reader->items, reader->nitems,
+												&nnew);
+				if (merged)
+					pfree(items);
+				items = newitems;
+				nitems = nnew;
+				merged = true;
+			}
+		}
+
+		ginEntryInsert(ginstate, first->attnum, first->key, first->category,
+					   items, nitems, &buildstate->buildStats);
+		if (merged)
+			pfree(items);
+
+		/* Advance every run we used */
+		for (int i = 0; i < npending; i++)
+		{
+			if (_gin_read_run_entry(ginstate, &readers[pending[i]]))
+				binaryheap_add(heap, Int32GetDatum(pending[i]));
+		}
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
+/*
+ * Within leader, participate as a parallel worker.
+ */
+static void
+_gin_leader_participate_as_worker(GinBuildState *buildstate, Relation heap,
+								  Relation index)
+{
+	GinLeader  *ginleader = buildstate->ginleader;
+	int			workmem;
+
+	/*
+	 * Might as well use reliable figure when doling out maintenance_work_mem
+	 * (when requested number of workers were not launched, this will be
+	 * somewhat higher than it is for other workers).
+	 */
+	workmem = maintenance_work_mem / ginleader->nparticipants;
+
+	/* Perform work common to all participants */
+	_gin_parallel_scan_and_build(ginleader->ginshared, heap, index, workmem,
+								 ginleader->ginshared->nparticipants - 1,
+								 true);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GinShared  *ginshared;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			workmem;
+
+	/*
+	 * The only possible status flag that can be set to the parallel worker is
+	 * PROC_IN_SAFE_IC.
+	 */
+	Assert((MyProc->statusFlags == 0) ||
+		   (MyProc->statusFlags == PROC_IN_SAFE_IC));
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up gin shared state */
+	ginshared = shm_toc_lookup(toc, PARALLEL_KEY_GIN_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!ginshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(ginshared->heaprelid, heapLockmode);
+	indexRel = index_open(ginshared->indexrelid, indexLockmode);
+
+	/* Attach to the fileset that our runs go into */
+	SharedFileSetAttach(&ginshared->fileset, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Scan our part of the heap, writing out runs */
+	workmem = maintenance_work_mem / ginshared->nparticipants;
+	_gin_parallel_scan_and_build(ginshared, heapRel, indexRel, workmem,
+								 ParallelWorkerNumber, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build.
+ *
+ * Scans part of the heap, accumulating entries in memory, and writes them out
+ * as sorted runs whenever workmem (in KBs) is used up, and at the end of the
+ * scan.  participant is this participant's slot in the shared nruns array.
+ *
+ * When this returns, the participant's runs have been written, and the
+ * leader has been told about them.
+ */
+static void
+_gin_parallel_scan_and_build(GinShared *ginshared, Relation heap,
+							 Relation index, int workmem, int participant,
+							 bool progress)
+{
+	GinBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+
+	initGinState(&buildstate.ginstate, index);
+	buildstate.indtuples = 0;
+	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.workmem = workmem;
+	buildstate.ginleader = NULL;
+	buildstate.ginshared = ginshared;
+	buildstate.participant = participant;
+
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "Gin build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+	buildstate.funcCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Gin build temporary context for user-defined function",
+											   ALLOCSET_DEFAULT_SIZES);
+
+	buildstate.accum.ginstate = &buildstate.ginstate;
+	ginInitBA(&buildstate.accum);
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = ginshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromGinShared(ginshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   ginBuildCallback, (void *) &buildstate,
+									   scan);
+
+	/* Write out the remaining entries as a final run */
+	if (buildstate.accum.allocatedMemory > 0)
+		_gin_write_run(&buildstate);
+
+	MemoryContextDelete(buildstate.funcCtx);
+	MemoryContextDelete(buildstate.tmpCtx);
+
+	/*
+	 * Done.  Record ambuild statistics, and whether we encountered a broken
+	 * HOT chain.
+	 */
+	SpinLockAcquire(&ginshared->mutex);
+	ginshared->nparticipantsdone++;
+	ginshared->reltuples += reltuples;
+	ginshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		ginshared->brokenhotchain = true;
+	SpinLockRelease(&ginshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&ginshared->workersdonecv);
+}
+
+/*
+ * Write out the entries accumulated by a parallel build participant as a new
+ * sorted run.  Caller is responsible for resetting the accumulator.
+ */
+static void
+_gin_write_run(GinBuildState *buildstate)
+{
+	GinShared  *ginshared = buildstate->ginshared;
+	int		   *nruns = &ginshared->nruns[buildstate->participant];
+	char		name[MAXPGPATH];
+	BufFile    *file;
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+	MemoryContext oldCtx;
+
+	snprintf(name, sizeof(name), "gin.%d.%d", buildstate->participant, *nruns);
+	file = BufFileCreateFileSet(&ginshared->fileset.fs, name);
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		GinRunEntryHeader hdr;
+		char	   *keybuf = NULL;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.attnum = attnum;
+		hdr.category = category;
+		hdr.nitems = nlist;
+		if (category == GIN_CAT_NORM_KEY)
+		{
+			Form_pg_attribute attr = TupleDescAttr(buildstate->ginstate.origTupdesc,
+												   attnum - 1);
+			char	   *ptr;
+
+			hdr.keylen = datumEstimateSpace(key, false, attr->attbyval,
+											attr->attlen);
+			keybuf = ptr = palloc(hdr.keylen);
+			datumSerialize(key, false, attr->attbyval, attr->attlen, &ptr);
+		}
+
+		BufFileWrite(file, &hdr, sizeof(hdr));
+		if (keybuf)
+		{
+			BufFileWrite(file, keybuf, hdr.keylen);
+			pfree(keybuf);
+		}
+		BufFileWrite(file, list, sizeof(ItemPointerData) * nlist);
+	}
+	MemoryContextSwitchTo(oldCtx);
+
+	BufFileClose(file);
+	(*nruns)++;
+}
+
+/*
+ * Read the next entry of a sorted run into reader, replacing its current
+ * entry.  Returns false (and closes the run) once the run is exhausted.
+ */
+static bool
+_gin_read_run_entry(GinState *ginstate, GinRunReader *reader)
+{
+	GinRunEntryHeader hdr;
+	size_t		nread;
+
+	/* Release the current entry */
+	if (reader->keyalloced)
+		pfree(DatumGetPointer(reader->key));
+	if (reader->items)
+		pfree(reader->items);
+	reader->keyalloced = false;
+	reader->items = NULL;
+
+	nread = BufFileRead(reader->file, &hdr, sizeof(hdr));
+	if (nread == 0)
+	{
+		BufFileClose(reader->file);
+		reader->file = NULL;
+		return false;
+	}
+	if (nread != sizeof(hdr))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from GIN index build temporary file"),
+				 errdetail_internal("Short read while reading entry header.")));
+
+	reader->attnum = hdr.attnum;
+	reader->category = hdr.category;
+	reader->nitems = hdr.nitems;
+
+	if (hdr.keylen > 0)
+	{
+		char	   *keybuf = palloc(hdr.keylen);
+		char	   *ptr = keybuf;
+		bool		isnull;
+
+		if (BufFileRead(reader->file, keybuf, hdr.keylen) != hdr.keylen)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from GIN index build temporary file"),
+					 errdetail_internal("Short read while reading key.")));
+		reader->key = datumRestore(&ptr, &isnull);
+		reader->keyalloced =
+			!TupleDescAttr(ginstate->origTupdesc, hdr.attnum - 1)->attbyval;
+		pfree(keybuf);
+	}
+	else
+		reader->key = (Datum) 0;
+
+	reader->items = (ItemPointerData *)
+		MemoryContextAllocHuge(CurrentMemoryContext,
+							   sizeof(ItemPointerData) * hdr.nitems);
+	if (BufFileRead(reader->file, reader->items,
+					sizeof(ItemPointerData) * hdr.nitems) !=
+		sizeof(ItemPointerData) * hdr.nitems)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from GIN index build temporary file"),
+				 errdetail_internal("Short read while reading heap TIDs.")));
+
+	return true;
+}
+
+/*
+ * Comparator for the leader's binary heap of runs, ordering runs by their
+ * current entries.  binaryheap is a max-heap, so the order is inverted.
+ */
+static int
+_gin_run_cmp(Datum a, Datum b, void *arg)
+{
+	GinMergeState *mergestate = (GinMergeState *) arg;
+	GinRunReader *ra = &mergestate->readers[DatumGetInt32(a)];
+	GinRunReader *rb = &mergestate->readers[DatumGetInt32(b)];
+
+	return -ginCompareAttEntries(mergestate->ginstate,
+								 ra->attnum, ra->key, ra->category,
+								 rb->attnum, rb->key, rb->category);
+}
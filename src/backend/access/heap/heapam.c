@@ -61,6 +61,7 @@
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/procarray.h"
+#include "storage/read_stream.h"
 #include "storage/smgr.h"
 #include "storage/spin.h"
 #include "storage/standby.h"
@@ -72,6 +73,7 @@
 #include "utils/spccache.h"
 
 
+static void heappagevisible(HeapScanDesc scan);
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 									 TransactionId xid, CommandId cid, int options);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
@@ -322,6 +324,8 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
 	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_prefetch_block = InvalidBlockNumber;
+	scan->rs_dir = ForwardScanDirection;
 
 	/* page-at-a-time fields are always invalid when not rs_inited */
 
@@ -373,14 +377,6 @@ void
 heapgetpage(TableScanDesc sscan, BlockNumber page)
 {
 	HeapScanDesc scan = (HeapScanDesc) sscan;
-	Buffer		buffer;
-	Snapshot	snapshot;
-	Page		dp;
-	int			lines;
-	int			ntup;
-	OffsetNumber lineoff;
-	ItemId		lpp;
-	bool		all_visible;
 
 	Assert(page < scan->rs_nblocks);
 
@@ -406,7 +402,30 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	if (!(scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE))
 		return;
 
-	buffer = scan->rs_cbuf;
+	heappagevisible(scan);
+}
+
+/*
+ * heappagevisible - determine which tuples on the current page are visible
+ *
+ * Fills in rs_vistuples[] and rs_ntuples for the page in rs_cbuf, which the
+ * caller must have pinned.  Used in page-at-a-time mode only.
+ */
+static void
+heappagevisible(HeapScanDesc scan)
+{
+	Buffer		buffer = scan->rs_cbuf;
+	BlockNumber page = scan->rs_cblock;
+	Snapshot	snapshot;
+	Page		dp;
+	int			lines;
+	int			ntup;
+	OffsetNumber lineoff;
+	ItemId		lpp;
+	bool		all_visible;
+
+	Assert(BufferGetBlockNumber(buffer) == page);
+
 	snapshot = scan->rs_base.rs_snapshot;
 
 	/*
@@ -481,6 +500,234 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	scan->rs_ntuples = ntup;
 }
 
+/*
+ * heapgettup_initial_block - return the first block to scan
+ *
+ * Returns InvalidBlockNumber when there are no blocks to scan.  This can
+ * happen with empty tables, with scans limited to zero blocks by
+ * heap_setscanlimits(), and in parallel scans when other participants got
+ * all of the pages before we had a chance to get our first one.
+ */
+static BlockNumber
+heapgettup_initial_block(HeapScanDesc scan, ScanDirection dir)
+{
+	Assert(!scan->rs_inited);
+
+	/* return InvalidBlockNumber immediately if relation is empty */
+	if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+		return InvalidBlockNumber;
+
+	if (ScanDirectionIsForward(dir))
+	{
+		if (scan->rs_base.rs_parallel != NULL)
+		{
+			ParallelBlockTableScanDesc pbscan =
+			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+			ParallelBlockTableScanWorker pbscanwork =
+			scan->rs_parallelworkerdata;
+
+			table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
+													 pbscanwork, pbscan);
+
+			/* Other processes might have already finished the scan. */
+			return table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+													 pbscanwork, pbscan);
+		}
+
+		return scan->rs_startblock; /* first page */
+	}
+
+	/* backward parallel scan not supported */
+	Assert(scan->rs_base.rs_parallel == NULL);
+
+	/*
+	 * Disable reporting to syncscan logic in a backwards scan; it's not very
+	 * likely anyone else is doing the same thing at the same time, and much
+	 * more likely that we'll just bollix things for forward scanners.
+	 */
+	scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
+
+	/*
+	 * Start from last page of the scan.  Ensure we take into account
+	 * rs_numblocks if it's been adjusted by heap_setscanlimits().
+	 */
+	if (scan->rs_numblocks != InvalidBlockNumber)
+		return (scan->rs_startblock + scan->rs_numblocks - 1) % scan->rs_nblocks;
+	if (scan->rs_startblock > 0)
+		return scan->rs_startblock - 1;
+	return scan->rs_nblocks - 1;
+}
+
+/*
+ * heapgettup_advance_block - return the block that follows "page"
+ *
+ * Returns InvalidBlockNumber when we've exhausted all the pages to scan in
+ * the given direction.
+ */
+static BlockNumber
+heapgettup_advance_block(HeapScanDesc scan, BlockNumber page,
+						 ScanDirection dir)
+{
+	bool		finished;
+
+	Assert(BlockNumberIsValid(page));
+
+	if (ScanDirectionIsBackward(dir))
+	{
+		finished = (page == scan->rs_startblock) ||
+			(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
+		if (finished)
+			return InvalidBlockNumber;
+		if (page == 0)
+			page = scan->rs_nblocks;
+		return page - 1;
+	}
+	else if (scan->rs_base.rs_parallel != NULL)
+	{
+		ParallelBlockTableScanDesc pbscan =
+		(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+		ParallelBlockTableScanWorker pbscanwork =
+		scan->rs_parallelworkerdata;
+
+		return table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+												 pbscanwork, pbscan);
+	}
+
+	page++;
+	if (page >= scan->rs_nblocks)
+		page = 0;
+	finished = (page == scan->rs_startblock) ||
+		(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
+
+	/*
+	 * Report our new scan position for synchronization purposes. We don't do
+	 * that when moving backwards, however. That would just mess up any other
+	 * forward-moving scanners.
+	 *
+	 * Note: we do this before checking for end of scan so that the final
+	 * state of the position hint is back at the start of the rel.  That's not
+	 * strictly necessary, but otherwise when you run the same query multiple
+	 * times the starting position would shift a little bit backwards on every
+	 * invocation, which is confusing. We don't guarantee any specific
+	 * ordering in general, though.
+	 *
+	 * When the scan reads through a read stream, the position reported here
+	 * is that of the stream's look-ahead, which is slightly ahead of the
+	 * tuples actually returned.  That's fine for a hint.
+	 */
+	if (scan->rs_base.rs_flags & SO_ALLOW_SYNC)
+		ss_report_location(scan->rs_base.rs_rd, page);
+
+	return finished ? InvalidBlockNumber : page;
+}
+
+/*
+ * heap_scan_stream_read_next - read stream callback for sequential scans
+ *
+ * Hands the read stream the blocks of the scan in the current scan
+ * direction.  rs_prefetch_block tracks how far the stream has looked ahead,
+ * independently of rs_cblock, the block currently being returned from.
+ */
+static BlockNumber
+heap_scan_stream_read_next(ReadStream *stream,
+						   void *callback_private_data,
+						   void *per_buffer_data)
+{
+	HeapScanDesc scan = (HeapScanDesc) callback_private_data;
+
+	if (unlikely(!scan->rs_inited))
+	{
+		scan->rs_prefetch_block = heapgettup_initial_block(scan, scan->rs_dir);
+		scan->rs_inited = true;
+	}
+	else
+		scan->rs_prefetch_block = heapgettup_advance_block(scan,
+														   scan->rs_prefetch_block,
+														   scan->rs_dir);
+
+	return scan->rs_prefetch_block;
+}
+
+/*
+ * heapfetchbuf - read and pin the next page of the scan
+ *
+ * Releases the current page, if any, then sets rs_cbuf and rs_cblock to the
+ * next page in the given direction.  When there are no more pages to scan,
+ * rs_cbuf is left set to InvalidBuffer.  Either way, rs_inited is true on
+ * return.
+ */
+static void
+heapfetchbuf(HeapScanDesc scan, ScanDirection dir)
+{
+	/* release previous scan buffer, if any */
+	if (BufferIsValid(scan->rs_cbuf))
+	{
+		ReleaseBuffer(scan->rs_cbuf);
+		scan->rs_cbuf = InvalidBuffer;
+	}
+
+	/*
+	 * Be sure to check for interrupts at least once per page.  Checks at
+	 * higher code levels won't be able to stop a seqscan that encounters many
+	 * pages' worth of consecutive dead tuples.
+	 */
+	CHECK_FOR_INTERRUPTS();
+
+	if (scan->rs_read_stream != NULL)
+	{
+		/*
+		 * If the scan direction changed, the blocks the stream has queued up
+		 * are the wrong ones.  Forget them, and let the stream continue from
+		 * the current block in the new direction.
+		 */
+		if (unlikely(scan->rs_dir != dir))
+		{
+			scan->rs_prefetch_block = scan->rs_cblock;
+			read_stream_reset(scan->rs_read_stream);
+			scan->rs_dir = dir;
+		}
+
+		scan->rs_cbuf = read_stream_next_buffer(scan->rs_read_stream, NULL);
+		if (BufferIsValid(scan->rs_cbuf))
+			scan->rs_cblock = BufferGetBlockNumber(scan->rs_cbuf);
+		return;
+	}
+
+	if (!scan->rs_inited)
+	{
+		scan->rs_cblock = heapgettup_initial_block(scan, dir);
+		scan->rs_inited = true;
+	}
+	else
+		scan->rs_cblock = heapgettup_advance_block(scan, scan->rs_cblock, dir);
+
+	/* read page using selected strategy */
+	if (BlockNumberIsValid(scan->rs_cblock))
+		scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM,
+										   scan->rs_cblock, RBM_NORMAL,
+										   scan->rs_strategy);
+}
+
+/*
+ * heapgettup_end - reset the scan after we've run out of pages
+ *
+ * A further request with the same scan direction will restart the scan.
+ */
+static void
+heapgettup_end(HeapScanDesc scan)
+{
+	if (BufferIsValid(scan->rs_cbuf))
+		ReleaseBuffer(scan->rs_cbuf);
+	scan->rs_cbuf = InvalidBuffer;
+	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_prefetch_block = InvalidBlockNumber;
+	scan->rs_ctup.t_data = NULL;
+	scan->rs_inited = false;
+
+	if (scan->rs_read_stream != NULL)
+		read_stream_reset(scan->rs_read_stream);
+}
+
 /* ----------------
  *		heapgettup - fetch next heap tuple
  *
@@ -514,7 +761,6 @@ heapgettup(HeapScanDesc scan,
 	Snapshot	snapshot = scan->rs_base.rs_snapshot;
 	bool		backward = ScanDirectionIsBackward(dir);
 	BlockNumber page;
-	bool		finished;
 	Page		dp;
 	int			lines;
 	OffsetNumber lineoff;
@@ -528,49 +774,26 @@ heapgettup(HeapScanDesc scan,
 	{
 		if (!scan->rs_inited)
 		{
+			heapfetchbuf(scan, dir);
+
 			/*
-			 * return null immediately if relation is empty
+			 * return null immediately if relation is empty, or if other
+			 * processes have already finished a parallel scan
 			 */
-			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+			if (!BufferIsValid(scan->rs_cbuf))
 			{
-				Assert(!BufferIsValid(scan->rs_cbuf));
-				tuple->t_data = NULL;
+				heapgettup_end(scan);
 				return;
 			}
-			if (scan->rs_base.rs_parallel != NULL)
-			{
-				ParallelBlockTableScanDesc pbscan =
-				(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-				ParallelBlockTableScanWorker pbscanwork =
-				scan->rs_parallelworkerdata;
-
-				table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				/* Other processes might have already finished the scan. */
-				if (page == InvalidBlockNumber)
-				{
-					Assert(!BufferIsValid(scan->rs_cbuf));
-					tuple->t_data = NULL;
-					return;
-				}
-			}
-			else
-				page = scan->rs_startblock; /* first page */
-			heapgetpage((TableScanDesc) scan, page);
 			lineoff = FirstOffsetNumber;	/* first offnum */
-			scan->rs_inited = true;
 		}
 		else
 		{
 			/* continue from previously returned page/tuple */
-			page = scan->rs_cblock; /* current page */
 			lineoff =			/* next offnum */
 				OffsetNumberNext(ItemPointerGetOffsetNumber(&(tuple->t_self)));
 		}
+		page = scan->rs_cblock; /* current page */
 
 		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_SHARE);
 
@@ -583,46 +806,25 @@ heapgettup(HeapScanDesc scan,
 	}
 	else if (backward)
 	{
+		bool		first_page = !scan->rs_inited;
+
 		/* backward parallel scan not supported */
 		Assert(scan->rs_base.rs_parallel == NULL);
 
-		if (!scan->rs_inited)
+		if (first_page)
 		{
+			heapfetchbuf(scan, dir);
+
 			/*
 			 * return null immediately if relation is empty
 			 */
-			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+			if (!BufferIsValid(scan->rs_cbuf))
 			{
-				Assert(!BufferIsValid(scan->rs_cbuf));
-				tuple->t_data = NULL;
+				heapgettup_end(scan);
 				return;
 			}
-
-			/*
-			 * Disable reporting to syncscan logic in a backwards scan; it's
-			 * not very likely anyone else is doing the same thing at the same
-			 * time, and much more likely that we'll just bollix things for
-			 * forward scanners.
-			 */
-			scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
-
-			/*
-			 * Start from last page of the scan.  Ensure we take into account
-			 * rs_numblocks if it's been adjusted by heap_setscanlimits().
-			 */
-			if (scan->rs_numblocks != InvalidBlockNumber)
-				page = (scan->rs_startblock + scan->rs_numblocks - 1) % scan->rs_nblocks;
-			else if (scan->rs_startblock > 0)
-				page = scan->rs_startblock - 1;
-			else
-				page = scan->rs_nblocks - 1;
-			heapgetpage((TableScanDesc) scan, page);
-		}
-		else
-		{
-			/* continue from previously returned page/tuple */
-			page = scan->rs_cblock; /* current page */
 		}
+		page = scan->rs_cblock; /* current page */
 
 		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_SHARE);
 
@@ -630,10 +832,9 @@ heapgettup(HeapScanDesc scan,
 		TestForOldSnapshot(snapshot, scan->rs_base.rs_rd, dp);
 		lines = PageGetMaxOffsetNumber(dp);
 
-		if (!scan->rs_inited)
+		if (first_page)
 		{
 			lineoff = lines;	/* final offnum */
-			scan->rs_inited = true;
 		}
 		else
 		{
@@ -749,66 +950,16 @@ heapgettup(HeapScanDesc scan,
 		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_UNLOCK);
 
 		/*
-		 * advance to next/prior page and detect end of scan
+		 * advance to next/prior page, and return NULL if we've exhausted all
+		 * the pages
 		 */
-		if (backward)
-		{
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-			if (page == 0)
-				page = scan->rs_nblocks;
-			page--;
-		}
-		else if (scan->rs_base.rs_parallel != NULL)
+		heapfetchbuf(scan, dir);
+		if (!BufferIsValid(scan->rs_cbuf))
 		{
-			ParallelBlockTableScanDesc pbscan =
-			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-			ParallelBlockTableScanWorker pbscanwork =
-			scan->rs_parallelworkerdata;
-
-			page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-													 pbscanwork, pbscan);
-			finished = (page == InvalidBlockNumber);
-		}
-		else
-		{
-			page++;
-			if (page >= scan->rs_nblocks)
-				page = 0;
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-
-			/*
-			 * Report our new scan position for synchronization purposes. We
-			 * don't do that when moving backwards, however. That would just
-			 * mess up any other forward-moving scanners.
-			 *
-			 * Note: we do this before checking for end of scan so that the
-			 * final state of the position hint is back at the start of the
-			 * rel.  That's not strictly necessary, but otherwise when you run
-			 * the same query multiple times the starting position would shift
-			 * a little bit backwards on every invocation, which is confusing.
-			 * We don't guarantee any specific ordering in general, though.
-			 */
-			if (scan->rs_base.rs_flags & SO_ALLOW_SYNC)
-				ss_report_location(scan->rs_base.rs_rd, page);
-		}
-
-		/*
-		 * return NULL if we've exhausted all the pages
-		 */
-		if (finished)
-		{
-			if (BufferIsValid(scan->rs_cbuf))
-				ReleaseBuffer(scan->rs_cbuf);
-			scan->rs_cbuf = InvalidBuffer;
-			scan->rs_cblock = InvalidBlockNumber;
-			tuple->t_data = NULL;
-			scan->rs_inited = false;
+			heapgettup_end(scan);
 			return;
 		}
-
-		heapgetpage((TableScanDesc) scan, page);
+		page = scan->rs_cblock;
 
 		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_SHARE);
 
@@ -836,8 +987,8 @@ heapgettup(HeapScanDesc scan,
  *
  * The internal logic is much the same as heapgettup's too, but there are some
  * differences: we do not take the buffer content lock (that only needs to
- * happen inside heapgetpage), and we iterate through just the tuples listed
- * in rs_vistuples[] rather than all tuples on the page.  Notice that
+ * happen inside heappagevisible), and we iterate through just the tuples
+ * listed in rs_vistuples[] rather than all tuples on the page.  Notice that
  * lineindex is 0-based, where the corresponding loop variable lineoff in
  * heapgettup is 1-based.
  * ----------------
@@ -851,7 +1002,6 @@ heapgettup_pagemode(HeapScanDesc scan,
 	HeapTuple	tuple = &(scan->rs_ctup);
 	bool		backward = ScanDirectionIsBackward(dir);
 	BlockNumber page;
-	bool		finished;
 	Page		dp;
 	int			lines;
 	int			lineindex;
@@ -866,48 +1016,26 @@ heapgettup_pagemode(HeapScanDesc scan,
 	{
 		if (!scan->rs_inited)
 		{
+			heapfetchbuf(scan, dir);
+
 			/*
-			 * return null immediately if relation is empty
+			 * return null immediately if relation is empty, or if other
+			 * processes have already finished a parallel scan
 			 */
-			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+			if (!BufferIsValid(scan->rs_cbuf))
 			{
-				Assert(!BufferIsValid(scan->rs_cbuf));
-				tuple->t_data = NULL;
+				heapgettup_end(scan);
 				return;
 			}
-			if (scan->rs_base.rs_parallel != NULL)
-			{
-				ParallelBlockTableScanDesc pbscan =
-				(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-				ParallelBlockTableScanWorker pbscanwork =
-				scan->rs_parallelworkerdata;
-
-				table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				/* Other processes might have already finished the scan. */
-				if (page == InvalidBlockNumber)
-				{
-					Assert(!BufferIsValid(scan->rs_cbuf));
-					tuple->t_data = NULL;
-					return;
-				}
-			}
-			else
-				page = scan->rs_startblock; /* first page */
-			heapgetpage((TableScanDesc) scan, page);
+			heappagevisible(scan);
 			lineindex = 0;
-			scan->rs_inited = true;
 		}
 		else
 		{
 			/* continue from previously returned page/tuple */
-			page = scan->rs_cblock; /* current page */
 			lineindex = scan->rs_cindex + 1;
 		}
+		page = scan->rs_cblock; /* current page */
 
 		dp = BufferGetPage(scan->rs_cbuf);
 		TestForOldSnapshot(scan->rs_base.rs_snapshot, scan->rs_base.rs_rd, dp);
@@ -918,55 +1046,34 @@ heapgettup_pagemode(HeapScanDesc scan,
 	}
 	else if (backward)
 	{
+		bool		first_page = !scan->rs_inited;
+
 		/* backward parallel scan not supported */
 		Assert(scan->rs_base.rs_parallel == NULL);
 
-		if (!scan->rs_inited)
+		if (first_page)
 		{
+			heapfetchbuf(scan, dir);
+
 			/*
 			 * return null immediately if relation is empty
 			 */
-			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+			if (!BufferIsValid(scan->rs_cbuf))
 			{
-				Assert(!BufferIsValid(scan->rs_cbuf));
-				tuple->t_data = NULL;
+				heapgettup_end(scan);
 				return;
 			}
-
-			/*
-			 * Disable reporting to syncscan logic in a backwards scan; it's
-			 * not very likely anyone else is doing the same thing at the same
-			 * time, and much more likely that we'll just bollix things for
-			 * forward scanners.
-			 */
-			scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
-
-			/*
-			 * Start from last page of the scan.  Ensure we take into account
-			 * rs_numblocks if it's been adjusted by heap_setscanlimits().
-			 */
-			if (scan->rs_numblocks != InvalidBlockNumber)
-				page = (scan->rs_startblock + scan->rs_numblocks - 1) % scan->rs_nblocks;
-			else if (scan->rs_startblock > 0)
-				page = scan->rs_startblock - 1;
-			else
-				page = scan->rs_nblocks - 1;
-			heapgetpage((TableScanDesc) scan, page);
-		}
-		else
-		{
-			/* continue from previously returned page/tuple */
-			page = scan->rs_cblock; /* current page */
+			heappagevisible(scan);
 		}
+		page = scan->rs_cblock; /* current page */
 
 		dp = BufferGetPage(scan->rs_cbuf);
 		TestForOldSnapshot(scan->rs_base.rs_snapshot, scan->rs_base.rs_rd, dp);
 		lines = scan->rs_ntuples;
 
-		if (!scan->rs_inited)
+		if (first_page)
 		{
 			lineindex = lines - 1;
-			scan->rs_inited = true;
 		}
 		else
 		{
@@ -1058,66 +1165,17 @@ heapgettup_pagemode(HeapScanDesc scan,
 
 		/*
 		 * if we get here, it means we've exhausted the items on this page and
-		 * it's time to move to the next.
-		 */
-		if (backward)
-		{
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-			if (page == 0)
-				page = scan->rs_nblocks;
-			page--;
-		}
-		else if (scan->rs_base.rs_parallel != NULL)
-		{
-			ParallelBlockTableScanDesc pbscan =
-			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-			ParallelBlockTableScanWorker pbscanwork =
-			scan->rs_parallelworkerdata;
-
-			page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-													 pbscanwork, pbscan);
-			finished = (page == InvalidBlockNumber);
-		}
-		else
-		{
-			page++;
-			if (page >= scan->rs_nblocks)
-				page = 0;
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-
-			/*
-			 * Report our new scan position for synchronization purposes. We
-			 * don't do that when moving backwards, however. That would just
-			 * mess up any other forward-moving scanners.
-			 *
-			 * Note: we do this before checking for end of scan so that the
-			 * final state of the position hint is back at the start of the
-			 * rel.  That's not strictly necessary, but otherwise when you run
-			 * the same query multiple times the starting position would shift
-			 * a little bit backwards on every invocation, which is confusing.
-			 * We don't guarantee any specific ordering in general, though.
-			 */
-			if (scan->rs_base.rs_flags & SO_ALLOW_SYNC)
-				ss_report_location(scan->rs_base.rs_rd, page);
-		}
-
-		/*
-		 * return NULL if we've exhausted all the pages
+		 * it's time to move to the next.  Return NULL if we've exhausted all
+		 * the pages.
 		 */
-		if (finished)
+		heapfetchbuf(scan, dir);
+		if (!BufferIsValid(scan->rs_cbuf))
 		{
-			if (BufferIsValid(scan->rs_cbuf))
-				ReleaseBuffer(scan->rs_cbuf);
-			scan->rs_cbuf = InvalidBuffer;
-			scan->rs_cblock = InvalidBlockNumber;
-			tuple->t_data = NULL;
-			scan->rs_inited = false;
+			heapgettup_end(scan);
 			return;
 		}
-
-		heapgetpage((TableScanDesc) scan, page);
+		heappagevisible(scan);
+		page = scan->rs_cblock;
 
 		dp = BufferGetPage(scan->rs_cbuf);
 		TestForOldSnapshot(scan->rs_base.rs_snapshot, scan->rs_base.rs_rd, dp);
@@ -1165,6 +1223,7 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 	scan->rs_base.rs_flags = flags;
 	scan->rs_base.rs_parallel = parallel_scan;
 	scan->rs_strategy = NULL;	/* set in initscan */
+	scan->rs_read_stream = NULL;	/* set below */
 
 	/*
 	 * Disable page-at-a-time mode if it's not a MVCC-safe snapshot.
@@ -1219,6 +1278,20 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 
 	initscan(scan, key, false);
 
+	/*
+	 * Sequential scans read their pages through a read stream, so that
+	 * upcoming pages can be prefetched.  Other kinds of scans either read
+	 * just a few pages, or choose their pages one at a time.
+	 */
+	if (scan->rs_base.rs_flags & SO_TYPE_SEQSCAN)
+		scan->rs_read_stream = read_stream_begin_relation(READ_STREAM_DEFAULT,
+														  scan->rs_strategy,
+														  scan->rs_base.rs_rd,
+														  MAIN_FORKNUM,
+														  heap_scan_stream_read_next,
+														  scan,
+														  0);
+
 	return (TableScanDesc) scan;
 }
 
@@ -1227,6 +1300,7 @@ heap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 			bool allow_strat, bool allow_sync, bool allow_pagemode)
 {
 	HeapScanDesc scan = (HeapScanDesc) sscan;
+	BufferAccessStrategy old_strategy = scan->rs_strategy;
 
 	if (set_params)
 	{
@@ -1253,10 +1327,32 @@ heap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	/*
+	 * forget any blocks the read stream has queued up
+	 */
+	if (scan->rs_read_stream != NULL)
+		read_stream_reset(scan->rs_read_stream);
+
 	/*
 	 * reinitialize scan descriptor
 	 */
 	initscan(scan, key, true);
+
+	/*
+	 * initscan() may have replaced the access strategy, which the read stream
+	 * remembers, so start a new stream in that case.
+	 */
+	if (scan->rs_read_stream != NULL && scan->rs_strategy != old_strategy)
+	{
+		read_stream_end(scan->rs_read_stream);
+		scan->rs_read_stream = read_stream_begin_relation(READ_STREAM_DEFAULT,
+														  scan->rs_strategy,
+														  scan->rs_base.rs_rd,
+														  MAIN_FORKNUM,
+														  heap_scan_stream_read_next,
+														  scan,
+														  0);
+	}
 }
 
 void
@@ -1272,6 +1368,9 @@ heap_endscan(TableScanDesc sscan)
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	if (scan->rs_read_stream != NULL)
+		read_stream_end(scan->rs_read_stream);
+
 	/*
 	 * decrement relation reference count and free scan descriptor storage
 	 */
@@ -1371,6 +1470,86 @@ heap_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlot *s
 	return true;
 }
 
+/*
+ * heap_getnextbatch - deform a batch of tuples from the current page
+ *
+ * Returns up to maxrows visible tuples, all from the same heap page, deformed
+ * into the row-major values/isnull arrays (natts entries per row).  Returns 0
+ * at the end of the scan.  By-reference datums point into the page and stay
+ * valid only until the next call, which may release the buffer pin.
+ *
+ * Only forward scans without scan keys are supported; that is what a
+ * sequential scan in the executor uses.
+ */
+int
+heap_getnextbatch(TableScanDesc sscan, ScanDirection direction,
+				  struct TupleDeformProgram *program, int natts,
+				  Datum *values, bool *isnull, int maxrows)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	HeapTupleData tuples[MaxHeapTuplesPerPage];
+	HeapTuple	tupptrs[MaxHeapTuplesPerPage];
+	BlockNumber page;
+	Page		dp;
+	int			ntuples;
+
+	Assert(ScanDirectionIsForward(direction));
+	Assert(sscan->rs_nkeys == 0);
+	Assert(maxrows > 0);
+
+	/*
+	 * Without page-at-a-time visibility checks, return the tuples one by
+	 * one.  That only happens with non-MVCC snapshots.
+	 */
+	if (!(sscan->rs_flags & SO_ALLOW_PAGEMODE))
+	{
+		HeapTuple	tuple = &scan->rs_ctup;
+
+		heapgettup(scan, direction, 0, NULL);
+		if (tuple->t_data == NULL)
+			return 0;
+		pgstat_count_heap_getnext(scan->rs_base.rs_rd);
+		ExecDeformHeapTuples(program, &tuple, 1, natts, values, isnull);
+		return 1;
+	}
+
+	/* Advance to the next visible tuple, possibly on a new page */
+	heapgettup_pagemode(scan, direction, 0, NULL);
+	if (scan->rs_ctup.t_data == NULL)
+		return 0;
+
+	tuples[0] = scan->rs_ctup;
+	tupptrs[0] = &tuples[0];
+	ntuples = 1;
+
+	/* Take the rest of the page's visible tuples directly */
+	page = scan->rs_cblock;
+	dp = BufferGetPage(scan->rs_cbuf);
+	while (ntuples < maxrows && scan->rs_cindex + 1 < scan->rs_ntuples)
+	{
+		OffsetNumber lineoff = scan->rs_vistuples[++scan->rs_cindex];
+		ItemId		lpp = PageGetItemId(dp, lineoff);
+		HeapTuple	tuple = &tuples[ntuples];
+
+		Assert(ItemIdIsNormal(lpp));
+		tuple->t_data = (HeapTupleHeader) PageGetItem(dp, lpp);
+		tuple->t_len = ItemIdGetLength(lpp);
+		tuple->t_tableOid = RelationGetRelid(sscan->rs_rd);
+		ItemPointerSet(&tuple->t_self, page, lineoff);
+		tupptrs[ntuples++] = tuple;
+	}
+
+	/* Keep rs_ctup in sync with rs_cindex, as heapgettup_pagemode would */
+	scan->rs_ctup = tuples[ntuples - 1];
+
+	for (int i = 0; i < ntuples; i++)
+		pgstat_count_heap_getnext(scan->rs_base.rs_rd);
+
+	ExecDeformHeapTuples(program, tupptrs, ntuples, natts, values, isnull);
+
+	return ntuples;
+}
+
 void
 heap_set_tidrange(TableScanDesc sscan, ItemPointer mintid,
 				  ItemPointer maxtid)
@@ -2253,6 +2432,55 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 		return tup;
 }
 
+/*
+ * Number of freshly extended pages heap_multi_insert() fills before inserting
+ * their WAL records as one batch.
+ */
+#define MULTI_INSERT_WAL_BATCH_PAGES	8
+
+/*
+ * Subroutine for heap_multi_insert(). Returns how many of the given tuples,
+ * at least one, heap_multi_insert() will put on the given empty page, without
+ * modifying it.  This has to match the space checks done when the tuples are
+ * actually added.
+ */
+static int
+heap_multi_insert_fit_empty(Page page, HeapTuple *tuples, int ntuples,
+							Size saveFreeSpace)
+{
+	Size		lower = ((PageHeader) page)->pd_lower;
+	Size		upper = ((PageHeader) page)->pd_upper;
+	int			n;
+
+	Assert(PageGetMaxOffsetNumber(page) == 0);
+
+	/* RelationGetBufferForTuple has ensured that the first tuple fits */
+	for (n = 0; n < ntuples; n++)
+	{
+		Size		alignedSize = MAXALIGN(tuples[n]->t_len);
+
+		if (n > 0)
+		{
+			Size		freeSpace;
+
+			/* as in PageGetHeapFreeSpace(), with no unused line pointers */
+			if (n >= MaxHeapTuplesPerPage ||
+				upper < lower + sizeof(ItemIdData))
+				freeSpace = 0;
+			else
+				freeSpace = upper - lower - sizeof(ItemIdData);
+
+			if (freeSpace < alignedSize + saveFreeSpace)
+				break;
+		}
+
+		lower += sizeof(ItemIdData);
+		upper -= alignedSize;
+	}
+
+	return n;
+}
+
 /*
  *	heap_multi_insert	- insert multiple tuples into a heap
  *
@@ -2276,6 +2504,7 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	Page		page;
 	Buffer		vmbuffer = InvalidBuffer;
 	bool		needwal;
+	bool		batch_wal;
 	Size		saveFreeSpace;
 	bool		need_tuple_data = RelationIsLogicallyLogged(relation);
 	bool		need_cids = RelationIsAccessibleInLogicalDecoding(relation);
@@ -2284,6 +2513,14 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	AssertArg(!(options & HEAP_INSERT_NO_LOGICAL));
 
 	needwal = RelationNeedsWAL(relation);
+
+	/*
+	 * Decide whether the WAL records of several pages may be inserted as one
+	 * batch.  Not when we need to emit other records in between for logical
+	 * decoding, nor with COPY FREEZE, which sets visibility map bits on each
+	 * page after logging it.
+	 */
+	batch_wal = needwal && !need_cids && !(options & HEAP_INSERT_FROZEN);
 	saveFreeSpace = RelationGetTargetPageFreeSpace(relation,
 												   HEAP_DEFAULT_FILLFACTOR);
 
@@ -2328,11 +2565,11 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	ndone = 0;
 	while (ndone < ntuples)
 	{
-		Buffer		buffer;
-		bool		starting_with_empty_page;
-		bool		all_visible_cleared = false;
-		bool		all_frozen_set = false;
-		int			nthispage;
+		Buffer		buffers[MULTI_INSERT_WAL_BATCH_PAGES];
+		int			pageend[MULTI_INSERT_WAL_BATCH_PAGES];
+		bool		all_frozen_set[MULTI_INSERT_WAL_BATCH_PAGES];
+		int			npages;
+		int			p;
 
 		CHECK_FOR_INTERRUPTS();
 
@@ -2343,211 +2580,290 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 		 * Also pin visibility map page if COPY FREEZE inserts tuples into an
 		 * empty page. See all_frozen_set below.
 		 */
-		buffer = RelationGetBufferForTuple(relation, heaptuples[ndone]->t_len,
-										   InvalidBuffer, options, bistate,
-										   &vmbuffer, NULL);
-		page = BufferGetPage(buffer);
+		buffers[0] = RelationGetBufferForTuple(relation, heaptuples[ndone]->t_len,
+											   InvalidBuffer, options, bistate,
+											   &vmbuffer, NULL);
+		pageend[0] = ntuples;
+		npages = 1;
 
-		starting_with_empty_page = PageGetMaxOffsetNumber(page) == 0;
+		/*
+		 * If we're filling an empty page and the tuples won't all fit on it,
+		 * we're most likely loading into the end of the relation.  Extend the
+		 * relation by a few more pages right away, fill them all, and insert
+		 * their WAL records as one batch, to take the WAL insertion lock only
+		 * once.  The pages stay locked until the batch has been inserted;
+		 * because they're all freshly extended, nobody else can be waiting
+		 * for them, so waiting for the next one can't deadlock.
+		 */
+		if (batch_wal &&
+			PageGetMaxOffsetNumber(BufferGetPage(buffers[0])) == 0)
+		{
+			int			next;
+
+			next = ndone + heap_multi_insert_fit_empty(BufferGetPage(buffers[0]),
+													   heaptuples + ndone,
+													   ntuples - ndone,
+													   saveFreeSpace);
+			pageend[0] = next;
 
-		if (starting_with_empty_page && (options & HEAP_INSERT_FROZEN))
-			all_frozen_set = true;
+			if (next < ntuples)
+				XLogBeginBatch(MULTI_INSERT_WAL_BATCH_PAGES, 0, BLCKSZ);
+
+			while (next < ntuples && npages < MULTI_INSERT_WAL_BATCH_PAGES)
+			{
+				buffers[npages] =
+					RelationGetBufferForTuple(relation, heaptuples[next]->t_len,
+											  InvalidBuffer,
+											  options | HEAP_INSERT_EXTEND,
+											  bistate, &vmbuffer, NULL);
+				next += heap_multi_insert_fit_empty(BufferGetPage(buffers[npages]),
+													heaptuples + next,
+													ntuples - next,
+													saveFreeSpace);
+				pageend[npages++] = next;
+			}
+		}
 
 		/* NO EREPORT(ERROR) from here till changes are logged */
 		START_CRIT_SECTION();
 
-		/*
-		 * RelationGetBufferForTuple has ensured that the first tuple fits.
-		 * Put that on the page, and then as many other tuples as fit.
-		 */
-		RelationPutHeapTuple(relation, buffer, heaptuples[ndone], false);
+		for (p = 0; p < npages; p++)
+		{
+			Buffer		buffer = buffers[p];
+			bool		starting_with_empty_page;
+			bool		all_visible_cleared = false;
+			int			nthispage;
 
-		/*
-		 * For logical decoding we need combo CIDs to properly decode the
-		 * catalog.
-		 */
-		if (needwal && need_cids)
-			log_heap_new_cid(relation, heaptuples[ndone]);
+			page = BufferGetPage(buffer);
 
-		for (nthispage = 1; ndone + nthispage < ntuples; nthispage++)
-		{
-			HeapTuple	heaptup = heaptuples[ndone + nthispage];
+			starting_with_empty_page = PageGetMaxOffsetNumber(page) == 0;
 
-			if (PageGetHeapFreeSpace(page) < MAXALIGN(heaptup->t_len) + saveFreeSpace)
-				break;
+			all_frozen_set[p] = false;
+			if (starting_with_empty_page && (options & HEAP_INSERT_FROZEN))
+				all_frozen_set[p] = true;
 
-			RelationPutHeapTuple(relation, buffer, heaptup, false);
+			/*
+			 * RelationGetBufferForTuple has ensured that the first tuple
+			 * fits. Put that on the page, and then as many other tuples as
+			 * fit.
+			 */
+			RelationPutHeapTuple(relation, buffer, heaptuples[ndone], false);
 
 			/*
 			 * For logical decoding we need combo CIDs to properly decode the
 			 * catalog.
 			 */
 			if (needwal && need_cids)
-				log_heap_new_cid(relation, heaptup);
-		}
+				log_heap_new_cid(relation, heaptuples[ndone]);
 
-		/*
-		 * If the page is all visible, need to clear that, unless we're only
-		 * going to add further frozen rows to it.
-		 *
-		 * If we're only adding already frozen rows to a previously empty
-		 * page, mark it as all-visible.
-		 */
-		if (PageIsAllVisible(page) && !(options & HEAP_INSERT_FROZEN))
-		{
-			all_visible_cleared = true;
-			PageClearAllVisible(page);
-			visibilitymap_clear(relation,
-								BufferGetBlockNumber(buffer),
-								vmbuffer, VISIBILITYMAP_VALID_BITS);
-		}
-		else if (all_frozen_set)
-			PageSetAllVisible(page);
+			for (nthispage = 1; ndone + nthispage < pageend[p]; nthispage++)
+			{
+				HeapTuple	heaptup = heaptuples[ndone + nthispage];
 
-		/*
-		 * XXX Should we set PageSetPrunable on this page ? See heap_insert()
-		 */
+				if (PageGetHeapFreeSpace(page) < MAXALIGN(heaptup->t_len) + saveFreeSpace)
+					break;
 
-		MarkBufferDirty(buffer);
+				RelationPutHeapTuple(relation, buffer, heaptup, false);
 
-		/* XLOG stuff */
-		if (needwal)
-		{
-			XLogRecPtr	recptr;
-			xl_heap_multi_insert *xlrec;
-			uint8		info = XLOG_HEAP2_MULTI_INSERT;
-			char	   *tupledata;
-			int			totaldatalen;
-			char	   *scratchptr = scratch.data;
-			bool		init;
-			int			bufflags = 0;
+				/*
+				 * For logical decoding we need combo CIDs to properly decode
+				 * the catalog.
+				 */
+				if (needwal && need_cids)
+					log_heap_new_cid(relation, heaptup);
+			}
+
+			/* batched pages must hold exactly what we planned for */
+			Assert(npages == 1 || ndone + nthispage == pageend[p]);
 
 			/*
-			 * If the page was previously empty, we can reinit the page
-			 * instead of restoring the whole thing.
+			 * If the page is all visible, need to clear that, unless we're
+			 * only going to add further frozen rows to it.
+			 *
+			 * If we're only adding already frozen rows to a previously empty
+			 * page, mark it as all-visible.
 			 */
-			init = starting_with_empty_page;
-
-			/* allocate xl_heap_multi_insert struct from the scratch area */
-			xlrec = (xl_heap_multi_insert *) scratchptr;
-			scratchptr += SizeOfHeapMultiInsert;
+			if (PageIsAllVisible(page) && !(options & HEAP_INSERT_FROZEN))
+			{
+				all_visible_cleared = true;
+				PageClearAllVisible(page);
+				visibilitymap_clear(relation,
+									BufferGetBlockNumber(buffer),
+									vmbuffer, VISIBILITYMAP_VALID_BITS);
+			}
+			else if (all_frozen_set[p])
+				PageSetAllVisible(page);
 
 			/*
-			 * Allocate offsets array. Unless we're reinitializing the page,
-			 * in that case the tuples are stored in order starting at
-			 * FirstOffsetNumber and we don't need to store the offsets
-			 * explicitly.
+			 * XXX Should we set PageSetPrunable on this page ? See
+			 * heap_insert()
 			 */
-			if (!init)
-				scratchptr += nthispage * sizeof(OffsetNumber);
 
-			/* the rest of the scratch space is used for tuple data */
-			tupledata = scratchptr;
+			MarkBufferDirty(buffer);
 
-			/* check that the mutually exclusive flags are not both set */
-			Assert(!(all_visible_cleared && all_frozen_set));
-
-			xlrec->flags = 0;
-			if (all_visible_cleared)
-				xlrec->flags = XLH_INSERT_ALL_VISIBLE_CLEARED;
-			if (all_frozen_set)
-				xlrec->flags = XLH_INSERT_ALL_FROZEN_SET;
+			/* XLOG stuff */
+			if (needwal)
+			{
+				XLogRecPtr	recptr;
+				xl_heap_multi_insert *xlrec;
+				uint8		info = XLOG_HEAP2_MULTI_INSERT;
+				char	   *tupledata;
+				int			totaldatalen;
+				char	   *scratchptr = scratch.data;
+				bool		init;
+				int			bufflags = 0;
 
-			xlrec->ntuples = nthispage;
+				/*
+				 * If the page was previously empty, we can reinit the page
+				 * instead of restoring the whole thing.
+				 */
+				init = starting_with_empty_page;
 
-			/*
-			 * Write out an xl_multi_insert_tuple and the tuple data itself
-			 * for each tuple.
-			 */
-			for (i = 0; i < nthispage; i++)
-			{
-				HeapTuple	heaptup = heaptuples[ndone + i];
-				xl_multi_insert_tuple *tuphdr;
-				int			datalen;
+				/* allocate xl_heap_multi_insert struct from the scratch area */
+				xlrec = (xl_heap_multi_insert *) scratchptr;
+				scratchptr += SizeOfHeapMultiInsert;
 
+				/*
+				 * Allocate offsets array. Unless we're reinitializing the
+				 * page, in that case the tuples are stored in order starting
+				 * at FirstOffsetNumber and we don't need to store the offsets
+				 * explicitly.
+				 */
 				if (!init)
-					xlrec->offsets[i] = ItemPointerGetOffsetNumber(&heaptup->t_self);
-				/* xl_multi_insert_tuple needs two-byte alignment. */
-				tuphdr = (xl_multi_insert_tuple *) SHORTALIGN(scratchptr);
-				scratchptr = ((char *) tuphdr) + SizeOfMultiInsertTuple;
-
-				tuphdr->t_infomask2 = heaptup->t_data->t_infomask2;
-				tuphdr->t_infomask = heaptup->t_data->t_infomask;
-				tuphdr->t_hoff = heaptup->t_data->t_hoff;
-
-				/* write bitmap [+ padding] [+ oid] + data */
-				datalen = heaptup->t_len - SizeofHeapTupleHeader;
-				memcpy(scratchptr,
-					   (char *) heaptup->t_data + SizeofHeapTupleHeader,
-					   datalen);
-				tuphdr->datalen = datalen;
-				scratchptr += datalen;
-			}
-			totaldatalen = scratchptr - tupledata;
-			Assert((scratchptr - scratch.data) < BLCKSZ);
+					scratchptr += nthispage * sizeof(OffsetNumber);
 
-			if (need_tuple_data)
-				xlrec->flags |= XLH_INSERT_CONTAINS_NEW_TUPLE;
+				/* the rest of the scratch space is used for tuple data */
+				tupledata = scratchptr;
 
-			/*
-			 * Signal that this is the last xl_heap_multi_insert record
-			 * emitted by this call to heap_multi_insert(). Needed for logical
-			 * decoding so it knows when to cleanup temporary data.
-			 */
-			if (ndone + nthispage == ntuples)
-				xlrec->flags |= XLH_INSERT_LAST_IN_MULTI;
+				/* check that the mutually exclusive flags are not both set */
+				Assert(!(all_visible_cleared && all_frozen_set[p]));
 
-			if (init)
-			{
-				info |= XLOG_HEAP_INIT_PAGE;
-				bufflags |= REGBUF_WILL_INIT;
-			}
+				xlrec->flags = 0;
+				if (all_visible_cleared)
+					xlrec->flags = XLH_INSERT_ALL_VISIBLE_CLEARED;
+				if (all_frozen_set[p])
+					xlrec->flags = XLH_INSERT_ALL_FROZEN_SET;
 
-			/*
-			 * If we're doing logical decoding, include the new tuple data
-			 * even if we take a full-page image of the page.
-			 */
-			if (need_tuple_data)
-				bufflags |= REGBUF_KEEP_DATA;
+				xlrec->ntuples = nthispage;
 
-			XLogBeginInsert();
-			XLogRegisterData((char *) xlrec, tupledata - scratch.data);
-			XLogRegisterBuffer(0, buffer, REGBUF_STANDARD | bufflags);
+				/*
+				 * Write out an xl_multi_insert_tuple and the tuple data
+				 * itself for each tuple.
+				 */
+				for (i = 0; i < nthispage; i++)
+				{
+					HeapTuple	heaptup = heaptuples[ndone + i];
+					xl_multi_insert_tuple *tuphdr;
+					int			datalen;
+
+					if (!init)
+						xlrec->offsets[i] = ItemPointerGetOffsetNumber(&heaptup->t_self);
+					/* xl_multi_insert_tuple needs two-byte alignment. */
+					tuphdr = (xl_multi_insert_tuple *) SHORTALIGN(scratchptr);
+					scratchptr = ((char *) tuphdr) + SizeOfMultiInsertTuple;
+
+					tuphdr->t_infomask2 = heaptup->t_data->t_infomask2;
+					tuphdr->t_infomask = heaptup->t_data->t_infomask;
+					tuphdr->t_hoff = heaptup->t_data->t_hoff;
+
+					/* write bitmap [+ padding] [+ oid] + data */
+					datalen = heaptup->t_len - SizeofHeapTupleHeader;
+					memcpy(scratchptr,
+						   (char *) heaptup->t_data + SizeofHeapTupleHeader,
+						   datalen);
+					tuphdr->datalen = datalen;
+					scratchptr += datalen;
+				}
+				totaldatalen = scratchptr - tupledata;
+				Assert((scratchptr - scratch.data) < BLCKSZ);
 
-			XLogRegisterBufData(0, tupledata, totaldatalen);
+				if (need_tuple_data)
+					xlrec->flags |= XLH_INSERT_CONTAINS_NEW_TUPLE;
 
-			/* filtering by origin on a row level is much more efficient */
-			XLogSetRecordFlags(XLOG_INCLUDE_ORIGIN);
+				/*
+				 * Signal that this is the last xl_heap_multi_insert record
+				 * emitted by this call to heap_multi_insert(). Needed for
+				 * logical decoding so it knows when to cleanup temporary
+				 * data.
+				 */
+				if (ndone + nthispage == ntuples)
+					xlrec->flags |= XLH_INSERT_LAST_IN_MULTI;
 
-			recptr = XLogInsert(RM_HEAP2_ID, info);
+				if (init)
+				{
+					info |= XLOG_HEAP_INIT_PAGE;
+					bufflags |= REGBUF_WILL_INIT;
+				}
 
-			PageSetLSN(page, recptr);
+				/*
+				 * If we're doing logical decoding, include the new tuple data
+				 * even if we take a full-page image of the page.
+				 */
+				if (need_tuple_data)
+					bufflags |= REGBUF_KEEP_DATA;
+
+				XLogBeginInsert();
+				XLogRegisterData((char *) xlrec, tupledata - scratch.data);
+				XLogRegisterBuffer(0, buffer, REGBUF_STANDARD | bufflags);
+
+				XLogRegisterBufData(0, tupledata, totaldatalen);
+
+				/* filtering by origin on a row level is much more efficient */
+				XLogSetRecordFlags(XLOG_INCLUDE_ORIGIN);
+
+				if (npages > 1)
+					XLogBatchAdd(RM_HEAP2_ID, info);
+				else
+				{
+					recptr = XLogInsert(RM_HEAP2_ID, info);
+
+					PageSetLSN(page, recptr);
+				}
+			}
+
+			ndone += nthispage;
+		}
+
+		/* Insert the WAL records of all the pages at once */
+		if (needwal && npages > 1)
+		{
+			XLogRecPtr	recptrs[MULTI_INSERT_WAL_BATCH_PAGES];
+
+			XLogInsertBatch(recptrs);
+
+			for (p = 0; p < npages; p++)
+				PageSetLSN(BufferGetPage(buffers[p]), recptrs[p]);
 		}
 
 		END_CRIT_SECTION();
 
-		/*
-		 * If we've frozen everything on the page, update the visibilitymap.
-		 * We're already holding pin on the vmbuffer.
-		 */
-		if (all_frozen_set)
+		for (p = 0; p < npages; p++)
 		{
-			Assert(PageIsAllVisible(page));
-			Assert(visibilitymap_pin_ok(BufferGetBlockNumber(buffer), vmbuffer));
+			Buffer		buffer = buffers[p];
 
 			/*
-			 * It's fine to use InvalidTransactionId here - this is only used
-			 * when HEAP_INSERT_FROZEN is specified, which intentionally
-			 * violates visibility rules.
+			 * If we've frozen everything on the page, update the
+			 * visibilitymap. We're already holding pin on the vmbuffer.
 			 */
-			visibilitymap_set(relation, BufferGetBlockNumber(buffer), buffer,
-							  InvalidXLogRecPtr, vmbuffer,
-							  InvalidTransactionId,
-							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
-		}
+			if (all_frozen_set[p])
+			{
+				page = BufferGetPage(buffer);
+				Assert(PageIsAllVisible(page));
+				Assert(visibilitymap_pin_ok(BufferGetBlockNumber(buffer), vmbuffer));
 
-		UnlockReleaseBuffer(buffer);
-		ndone += nthispage;
+				/*
+				 * It's fine to use InvalidTransactionId here - this is only
+				 * used when HEAP_INSERT_FROZEN is specified, which
+				 * intentionally violates visibility rules.
+				 */
+				visibilitymap_set(relation, BufferGetBlockNumber(buffer), buffer,
+								  InvalidXLogRecPtr, vmbuffer,
+								  InvalidTransactionId,
+								  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+			}
+
+			UnlockReleaseBuffer(buffer);
+		}
 
 		/*
 		 * NB: Only release vmbuffer after inserting all tuples - it's fairly
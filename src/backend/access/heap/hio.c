@@ -315,6 +315,12 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
  *	any committed data of other transactions.  (See heap_insert's comments
  *	for additional constraints needed for safe usage of this behavior.)
  *
+ *	HEAP_INSERT_EXTEND always appends a new empty page, without looking at
+ *	the current target page or the FSM.  heap_multi_insert uses it to get more
+ *	pages while it still holds locks on the pages it has filled, since the
+ *	only page locks acquired along the way are on the new page, which nobody
+ *	else can be holding.
+ *
  *	The caller can also provide a BulkInsertState object to optimize many
  *	insertions into the same relation.  This keeps a pin on the current
  *	insertion target page (to save pin/unpin cycles) and also passes a
@@ -335,7 +341,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 						  BulkInsertState bistate,
 						  Buffer *vmbuffer, Buffer *vmbuffer_other)
 {
-	bool		use_fsm = !(options & HEAP_INSERT_SKIP_FSM);
+	bool		use_fsm = !(options & (HEAP_INSERT_SKIP_FSM | HEAP_INSERT_EXTEND));
 	Buffer		buffer = InvalidBuffer;
 	Page		page;
 	Size		nearlyEmptyFreeSpace,
@@ -395,7 +401,9 @@ RelationGetBufferForTuple(Relation relation, Size len,
 	 * When use_fsm is false, we either put the tuple onto the existing target
 	 * page or extend the relation.
 	 */
-	if (bistate && bistate->current_buf != InvalidBuffer)
+	if (options & HEAP_INSERT_EXTEND)
+		targetBlock = InvalidBlockNumber;
+	else if (bistate && bistate->current_buf != InvalidBuffer)
 		targetBlock = BufferGetBlockNumber(bistate->current_buf);
 	else
 		targetBlock = RelationGetTargetBlock(relation);
@@ -414,7 +422,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 	 * up and extend.  This avoids one-tuple-per-page syndrome during
 	 * bootstrapping or in a recently-started system.
 	 */
-	if (targetBlock == InvalidBlockNumber)
+	if (targetBlock == InvalidBlockNumber && !(options & HEAP_INSERT_EXTEND))
 	{
 		BlockNumber nblocks = RelationGetNumberOfBlocks(relation);
 
@@ -59,6 +59,7 @@
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/read_stream.h"
 #include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -202,6 +203,16 @@ typedef struct LVRelState
 	BlockNumber missed_dead_pages;	/* # pages with missed dead tuples */
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
 
+	/*
+	 * State used by heap_vac_scan_next_block() to choose the pages to scan,
+	 * ahead of lazy_scan_heap() processing them
+	 */
+	BlockNumber next_block;		/* next block to consider */
+	BlockNumber next_unskippable_block; /* next page that can't be skipped */
+	bool		next_unskippable_allvis;	/* its all-visible status */
+	bool		skipping_current_range; /* skip pages before it? */
+	Buffer		next_unskippable_vmbuffer;	/* VM page used for skipping */
+
 	/* Statistics output by us, for table */
 	double		new_rel_tuples; /* new estimated total # of tuples */
 	double		new_live_tuples;	/* new estimated total # of live tuples */
@@ -247,6 +258,9 @@ typedef struct LVSavedErrInfo
 
 /* non-export function prototypes */
 static void lazy_scan_heap(LVRelState *vacrel);
+static BlockNumber heap_vac_scan_next_block(ReadStream *stream,
+											void *callback_private_data,
+											void *per_buffer_data);
 static BlockNumber lazy_scan_skip(LVRelState *vacrel, Buffer *vmbuffer,
 								  BlockNumber next_block,
 								  bool *next_unskippable_allvis,
@@ -845,14 +859,12 @@ static void
 lazy_scan_heap(LVRelState *vacrel)
 {
 	BlockNumber rel_pages = vacrel->rel_pages,
-				blkno,
-				next_unskippable_block,
+				blkno = 0,
 				next_failsafe_block = 0,
 				next_fsm_block_to_vacuum = 0;
 	VacDeadItems *dead_items = vacrel->dead_items;
 	Buffer		vmbuffer = InvalidBuffer;
-	bool		next_unskippable_allvis,
-				skipping_current_range;
+	ReadStream *stream;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
 		PROGRESS_VACUUM_TOTAL_HEAP_BLKS,
@@ -867,71 +879,41 @@ lazy_scan_heap(LVRelState *vacrel)
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
 	/* Set up an initial range of skippable blocks using the visibility map */
-	next_unskippable_block = lazy_scan_skip(vacrel, &vmbuffer, 0,
-											&next_unskippable_allvis,
-											&skipping_current_range);
-	for (blkno = 0; blkno < rel_pages; blkno++)
+	vacrel->next_block = 0;
+	vacrel->next_unskippable_vmbuffer = InvalidBuffer;
+	vacrel->next_unskippable_block =
+		lazy_scan_skip(vacrel, &vacrel->next_unskippable_vmbuffer, 0,
+					   &vacrel->next_unskippable_allvis,
+					   &vacrel->skipping_current_range);
+
+	/*
+	 * Read the pages that can't be skipped through a read stream, so that
+	 * they are prefetched ahead of being processed.  Each page comes with
+	 * its all-visible status according to the visibility map.
+	 */
+	stream = read_stream_begin_relation(READ_STREAM_MAINTENANCE,
+										vacrel->bstrategy,
+										vacrel->rel,
+										MAIN_FORKNUM,
+										heap_vac_scan_next_block,
+										vacrel,
+										sizeof(bool));
+
+	while (true)
 	{
 		Buffer		buf;
 		Page		page;
 		bool		all_visible_according_to_vm;
 		LVPagePruneState prunestate;
-
-		if (blkno == next_unskippable_block)
-		{
-			/*
-			 * Can't skip this page safely.  Must scan the page.  But
-			 * determine the next skippable range after the page first.
-			 */
-			all_visible_according_to_vm = next_unskippable_allvis;
-			next_unskippable_block = lazy_scan_skip(vacrel, &vmbuffer,
-													blkno + 1,
-													&next_unskippable_allvis,
-													&skipping_current_range);
-
-			Assert(next_unskippable_block >= blkno + 1);
-		}
-		else
-		{
-			/* Last page always scanned (may need to set nonempty_pages) */
-			Assert(blkno < rel_pages - 1);
-
-			if (skipping_current_range)
-				continue;
-
-			/* Current range is too small to skip -- just scan the page */
-			all_visible_according_to_vm = true;
-		}
-
-		vacrel->scanned_pages++;
-
-		/* Report as block scanned, update error traceback information */
-		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
-		update_vacuum_error_info(vacrel, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
-								 blkno, InvalidOffsetNumber);
+		void	   *per_buffer_data;
 
 		vacuum_delay_point();
 
 		/*
-		 * Regularly check if wraparound failsafe should trigger.
-		 *
-		 * There is a similar check inside lazy_vacuum_all_indexes(), but
-		 * relfrozenxid might start to look dangerously old before we reach
-		 * that point.  This check also provides failsafe coverage for the
-		 * one-pass strategy, and the two-pass strategy with the index_cleanup
-		 * param set to 'off'.
-		 */
-		if (blkno - next_failsafe_block >= FAILSAFE_EVERY_PAGES)
-		{
-			lazy_check_wraparound_failsafe(vacrel);
-			next_failsafe_block = blkno;
-		}
-
-		/*
-		 * Consider if we definitely have enough space to process TIDs on page
-		 * already.  If we are close to overrunning the available space for
-		 * dead_items TIDs, pause and do a cycle of vacuuming before we tackle
-		 * this page.
+		 * Consider if we definitely have enough space to process TIDs on the
+		 * next page already.  If we are close to overrunning the available
+		 * space for dead_items TIDs, pause and do a cycle of vacuuming before
+		 * we tackle it.
 		 */
 		Assert(dead_items->max_items >= MaxHeapTuplesPerPage);
 		if (dead_items->max_items - dead_items->num_items < MaxHeapTuplesPerPage)
@@ -947,6 +929,11 @@ lazy_scan_heap(LVRelState *vacrel)
 				ReleaseBuffer(vmbuffer);
 				vmbuffer = InvalidBuffer;
 			}
+			if (BufferIsValid(vacrel->next_unskippable_vmbuffer))
+			{
+				ReleaseBuffer(vacrel->next_unskippable_vmbuffer);
+				vacrel->next_unskippable_vmbuffer = InvalidBuffer;
+			}
 
 			/* Perform a round of index and heap vacuuming */
 			vacrel->consider_bypass_optimization = false;
@@ -954,17 +941,50 @@ lazy_scan_heap(LVRelState *vacrel)
 
 			/*
 			 * Vacuum the Free Space Map to make newly-freed space visible on
-			 * upper-level FSM pages.  Note we have not yet processed blkno.
+			 * upper-level FSM pages.  Note that blkno is the last page we
+			 * processed.
 			 */
 			FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
-									blkno);
-			next_fsm_block_to_vacuum = blkno;
+									blkno + 1);
+			next_fsm_block_to_vacuum = blkno + 1;
 
 			/* Report that we are once again scanning the heap */
 			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
 										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
 		}
 
+		buf = read_stream_next_buffer(stream, &per_buffer_data);
+
+		/* The relation is exhausted */
+		if (!BufferIsValid(buf))
+			break;
+
+		blkno = BufferGetBlockNumber(buf);
+		all_visible_according_to_vm = *((bool *) per_buffer_data);
+		page = BufferGetPage(buf);
+
+		vacrel->scanned_pages++;
+
+		/* Report as block scanned, update error traceback information */
+		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+		update_vacuum_error_info(vacrel, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
+								 blkno, InvalidOffsetNumber);
+
+		/*
+		 * Regularly check if wraparound failsafe should trigger.
+		 *
+		 * There is a similar check inside lazy_vacuum_all_indexes(), but
+		 * relfrozenxid might start to look dangerously old before we reach
+		 * that point.  This check also provides failsafe coverage for the
+		 * one-pass strategy, and the two-pass strategy with the index_cleanup
+		 * param set to 'off'.
+		 */
+		if (blkno - next_failsafe_block >= FAILSAFE_EVERY_PAGES)
+		{
+			lazy_check_wraparound_failsafe(vacrel);
+			next_failsafe_block = blkno;
+		}
+
 		/*
 		 * Pin the visibility map page in case we need to mark the page
 		 * all-visible.  In most cases this will be very cheap, because we'll
@@ -972,11 +992,6 @@ lazy_scan_heap(LVRelState *vacrel)
 		 */
 		visibilitymap_pin(vacrel->rel, blkno, &vmbuffer);
 
-		/* Finished preparatory checks.  Actually scan the page. */
-		buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vacrel->bstrategy);
-		page = BufferGetPage(buf);
-
 		/*
 		 * We need a buffer cleanup lock to prune HOT chains and defragment
 		 * the page in lazy_scan_prune.  But when it's not possible to acquire
@@ -1236,12 +1251,16 @@ lazy_scan_heap(LVRelState *vacrel)
 		}
 	}
 
+	read_stream_end(stream);
+
 	vacrel->blkno = InvalidBlockNumber;
 	if (BufferIsValid(vmbuffer))
 		ReleaseBuffer(vmbuffer);
+	if (BufferIsValid(vacrel->next_unskippable_vmbuffer))
+		ReleaseBuffer(vacrel->next_unskippable_vmbuffer);
 
 	/* report that everything is now scanned */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, rel_pages);
 
 	/* now we can compute the new value for pg_class.reltuples */
 	vacrel->new_live_tuples = vac_estimate_reltuples(vacrel->rel, rel_pages,
@@ -1267,22 +1286,82 @@ lazy_scan_heap(LVRelState *vacrel)
 	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
 	 * not there were indexes, and whether or not we bypassed index vacuuming.
 	 */
-	if (blkno > next_fsm_block_to_vacuum)
-		FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum, blkno);
+	if (rel_pages > next_fsm_block_to_vacuum)
+		FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
+								rel_pages);
 
 	/* report all blocks vacuumed */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, rel_pages);
 
 	/* Do final index cleanup (call each index's amvacuumcleanup routine) */
 	if (vacrel->nindexes > 0 && vacrel->do_index_cleanup)
 		lazy_cleanup_all_indexes(vacrel);
 }
 
+/*
+ *	heap_vac_scan_next_block() -- read stream callback for lazy_scan_heap().
+ *
+ * Returns the next block that lazy_scan_heap() must process, skipping
+ * ranges of pages that lazy_scan_skip() decided can be skipped, or
+ * InvalidBlockNumber when there are no more pages to process.  The
+ * all-visible status of the block according to the visibility map (as of
+ * the time it was returned here) is stored in *per_buffer_data.
+ */
+static BlockNumber
+heap_vac_scan_next_block(ReadStream *stream,
+						 void *callback_private_data,
+						 void *per_buffer_data)
+{
+	LVRelState *vacrel = callback_private_data;
+	bool	   *all_visible_according_to_vm = per_buffer_data;
+
+	for (;;)
+	{
+		BlockNumber blkno = vacrel->next_block;
+
+		if (blkno >= vacrel->rel_pages)
+			return InvalidBlockNumber;
+
+		if (blkno == vacrel->next_unskippable_block)
+		{
+			/*
+			 * Can't skip this page safely.  Must scan the page.  But
+			 * determine the next skippable range after the page first.
+			 */
+			*all_visible_according_to_vm = vacrel->next_unskippable_allvis;
+			vacrel->next_unskippable_block =
+				lazy_scan_skip(vacrel, &vacrel->next_unskippable_vmbuffer,
+							   blkno + 1,
+							   &vacrel->next_unskippable_allvis,
+							   &vacrel->skipping_current_range);
+
+			Assert(vacrel->next_unskippable_block >= blkno + 1);
+			vacrel->next_block = blkno + 1;
+			return blkno;
+		}
+
+		/* Last page always scanned (may need to set nonempty_pages) */
+		Assert(blkno < vacrel->rel_pages - 1);
+
+		if (vacrel->skipping_current_range)
+		{
+			/* Skip straight to the end of the skippable range */
+			vacrel->next_block = vacrel->next_unskippable_block;
+			continue;
+		}
+
+		/* Current range is too small to skip -- just scan the page */
+		*all_visible_according_to_vm = true;
+		vacrel->next_block = blkno + 1;
+		return blkno;
+	}
+}
+
 /*
  *	lazy_scan_skip() -- set up range of skippable blocks using visibility map.
  *
- * lazy_scan_heap() calls here every time it needs to set up a new range of
- * blocks to skip via the visibility map.  Caller passes the next block in
+ * heap_vac_scan_next_block() calls here every time it needs to set up a new
+ * range of blocks to skip via the visibility map.  Caller passes the next block in
  * line.  We return a next_unskippable_block for this range.  When there are
  * no skippable blocks we just return caller's next_block.  The all-visible
  * status of the returned block is set in *next_unskippable_allvis for caller,
@@ -14,18 +14,31 @@
  */
 #include "postgres.h"
 
+#include "access/htup_details.h"
 #include "access/nbtree.h"
 #include "access/nbtxlog.h"
 #include "access/xloginsert.h"
 #include "miscadmin.h"
 #include "utils/rel.h"
 
+/*
+ * Compressed posting lists can only represent heap TIDs whose offset number
+ * fits in BT_POSTING_OFFSET_BITS.  That's always true of heap TIDs, which is
+ * why compression is only used for indexes on heap tables.
+ */
+StaticAssertDecl(MaxHeapTuplesPerPage < (1 << BT_POSTING_OFFSET_BITS),
+				 "heap offset numbers must fit in compressed posting lists");
+
 static void _bt_bottomupdel_finish_pending(Page page, BTDedupState state,
 										   TM_IndexDeleteOp *delstate);
 static bool _bt_do_singleval(Relation rel, Page page, BTDedupState state,
 							 OffsetNumber minoff, IndexTuple newitem);
 static void _bt_singleval_fillfactor(Page page, BTDedupState state,
 									 Size newitemsz);
+static inline bool _bt_posting_tid_fits(ItemPointer htid);
+static int	_bt_posting_width(ItemPointer mintid, ItemPointer maxtid);
+static void _bt_compress_posting(IndexTuple posting, ItemPointer htids,
+								 int nhtids, int width);
 #ifdef USE_ASSERT_CHECKING
 static bool _bt_posting_valid(IndexTuple posting);
 #endif
@@ -68,6 +81,8 @@ _bt_dedup_pass(Relation rel, Buffer buf, Relation heapRel, IndexTuple newitem,
 	Size		pagesaving PG_USED_FOR_ASSERTS_ONLY = 0;
 	bool		singlevalstrat = false;
 	int			nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
+	BTItemBuf	itembufs[2];
+	int			curbuf = 0;
 
 	/* Passed-in newitemsz is MAXALIGNED but does not include line pointer */
 	newitemsz += sizeof(ItemIdData);
@@ -83,6 +98,8 @@ _bt_dedup_pass(Relation rel, Buffer buf, Relation heapRel, IndexTuple newitem,
 	 */
 	state = (BTDedupState) palloc(sizeof(BTDedupStateData));
 	state->deduplicate = true;
+	state->compress = BTGetCompressPostingLists(rel) &&
+		heapRel->rd_rel->relam == HEAP_TABLE_AM_OID;
 	state->nmaxitems = 0;
 	state->maxpostingsize = Min(BTMaxItemSize(page) / 2, INDEX_SIZE_MASK);
 	/* Metadata about base tuple of current pending posting list */
@@ -135,7 +152,14 @@ _bt_dedup_pass(Relation rel, Buffer buf, Relation heapRel, IndexTuple newitem,
 		 offnum = OffsetNumberNext(offnum))
 	{
 		ItemId		itemid = PageGetItemId(page, offnum);
-		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+		IndexTuple	itup;
+
+		/*
+		 * The base tuple of the pending posting list has to stay put while
+		 * we look at the tuples after it, so alternate between two buffers
+		 * for expanded tuples
+		 */
+		itup = BTPageGetItem(page, itemid, &itembufs[curbuf]);
 
 		Assert(!ItemIdIsDead(itemid));
 
@@ -146,6 +170,7 @@ _bt_dedup_pass(Relation rel, Buffer buf, Relation heapRel, IndexTuple newitem,
 			 * as base tuple of pending posting list
 			 */
 			_bt_dedup_start_pending(state, itup, offnum);
+			curbuf = 1 - curbuf;
 		}
 		else if (state->deduplicate &&
 				 _bt_keep_natts_fast(rel, state->base, itup) > nkeyatts &&
@@ -197,6 +222,7 @@ _bt_dedup_pass(Relation rel, Buffer buf, Relation heapRel, IndexTuple newitem,
 
 			/* itup starts new pending posting list */
 			_bt_dedup_start_pending(state, itup, offnum);
+			curbuf = 1 - curbuf;
 		}
 	}
 
@@ -248,6 +274,7 @@ _bt_dedup_pass(Relation rel, Buffer buf, Relation heapRel, IndexTuple newitem,
 		xl_btree_dedup xlrec_dedup;
 
 		xlrec_dedup.nintervals = state->nintervals;
+		xlrec_dedup.compress = state->compress;
 
 		XLogBeginInsert();
 		XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
@@ -315,6 +342,8 @@ _bt_bottomupdel_pass(Relation rel, Buffer buf, Relation heapRel,
 	TM_IndexDeleteOp delstate;
 	bool		neverdedup;
 	int			nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
+	BTItemBuf	itembufs[2];
+	int			curbuf = 0;
 
 	/* Passed-in newitemsz is MAXALIGNED but does not include line pointer */
 	newitemsz += sizeof(ItemIdData);
@@ -322,6 +351,7 @@ _bt_bottomupdel_pass(Relation rel, Buffer buf, Relation heapRel,
 	/* Initialize deduplication state */
 	state = (BTDedupState) palloc(sizeof(BTDedupStateData));
 	state->deduplicate = true;
+	state->compress = false;	/* unused */
 	state->nmaxitems = 0;
 	state->maxpostingsize = BLCKSZ; /* We're not really deduplicating */
 	state->base = NULL;
@@ -354,8 +384,8 @@ _bt_bottomupdel_pass(Relation rel, Buffer buf, Relation heapRel,
 	delstate.bottomup = true;
 	delstate.bottomupfreespace = Max(BLCKSZ / 16, newitemsz);
 	delstate.ndeltids = 0;
-	delstate.deltids = palloc(MaxTIDsPerBTreePage * sizeof(TM_IndexDelete));
-	delstate.status = palloc(MaxTIDsPerBTreePage * sizeof(TM_IndexStatus));
+	delstate.deltids = palloc(BTPageGetMaxTIDs(opaque) * sizeof(TM_IndexDelete));
+	delstate.status = palloc(BTPageGetMaxTIDs(opaque) * sizeof(TM_IndexStatus));
 
 	minoff = P_FIRSTDATAKEY(opaque);
 	maxoff = PageGetMaxOffsetNumber(page);
@@ -364,7 +394,7 @@ _bt_bottomupdel_pass(Relation rel, Buffer buf, Relation heapRel,
 		 offnum = OffsetNumberNext(offnum))
 	{
 		ItemId		itemid = PageGetItemId(page, offnum);
-		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+		IndexTuple	itup = BTPageGetItem(page, itemid, &itembufs[curbuf]);
 
 		Assert(!ItemIdIsDead(itemid));
 
@@ -372,6 +402,7 @@ _bt_bottomupdel_pass(Relation rel, Buffer buf, Relation heapRel,
 		{
 			/* itup starts first pending interval */
 			_bt_dedup_start_pending(state, itup, offnum);
+			curbuf = 1 - curbuf;
 		}
 		else if (_bt_keep_natts_fast(rel, state->base, itup) > nkeyatts &&
 				 _bt_dedup_save_htid(state, itup))
@@ -383,8 +414,9 @@ _bt_bottomupdel_pass(Relation rel, Buffer buf, Relation heapRel,
 			/* Finalize interval -- move its TIDs to delete state */
 			_bt_bottomupdel_finish_pending(page, state, &delstate);
 
-			/* itup starts new pending interval */
+			/* itup starts new pending interval (see _bt_dedup_pass) */
 			_bt_dedup_start_pending(state, itup, offnum);
+			curbuf = 1 - curbuf;
 		}
 	}
 	/* Finalize final interval -- move its TIDs to delete state */
@@ -446,7 +478,7 @@ _bt_dedup_start_pending(BTDedupState state, IndexTuple base,
 		state->nhtids = 1;
 		state->basetupsize = IndexTupleSize(base);
 	}
-	else
+	else if (!BTreeTupleIsCompressedPosting(base))
 	{
 		int			nposting;
 
@@ -457,6 +489,17 @@ _bt_dedup_start_pending(BTDedupState state, IndexTuple base,
 		/* basetupsize should not include existing posting list */
 		state->basetupsize = BTreeTupleGetPostingOffset(base);
 	}
+	else
+	{
+		int			nposting;
+
+		nposting = BTreeTupleGetNPosting(base);
+		for (int i = 0; i < nposting; i++)
+			BTreeTupleGetPostingTID(base, i, &state->htids[i]);
+		state->nhtids = nposting;
+		/* basetupsize should not include existing posting list */
+		state->basetupsize = BTreeTupleGetPostingOffset(base);
+	}
 
 	/*
 	 * Save new base tuple itself -- it'll be needed if we actually create a
@@ -504,7 +547,11 @@ _bt_dedup_save_htid(BTDedupState state, IndexTuple itup)
 	 * appending heap TID(s) from itup would put us over maxpostingsize limit.
 	 *
 	 * This calculation needs to match the code used within _bt_form_posting()
-	 * for new posting list tuples.
+	 * for new posting list tuples.  When the new posting list is to be
+	 * compressed, we still limit the size it would have uncompressed.  That
+	 * way compression leaves the number of heap TIDs in each posting list
+	 * (and the choices made by the single value strategy) alone.  It also
+	 * keeps the number of heap TIDs on a page from growing so quickly.
 	 */
 	mergedtupsz = MAXALIGN(state->basetupsize +
 						   (state->nhtids + nhtids) * sizeof(ItemPointerData));
@@ -534,8 +581,14 @@ _bt_dedup_save_htid(BTDedupState state, IndexTuple itup)
 	 * pending posting list
 	 */
 	state->nitems++;
-	memcpy(state->htids + state->nhtids, htids,
-		   sizeof(ItemPointerData) * nhtids);
+	if (!BTreeTupleIsCompressedPosting(itup))
+		memcpy(state->htids + state->nhtids, htids,
+			   sizeof(ItemPointerData) * nhtids);
+	else
+	{
+		for (int i = 0; i < nhtids; i++)
+			BTreeTupleGetPostingTID(itup, i, &state->htids[state->nhtids + i]);
+	}
 	state->nhtids += nhtids;
 	state->phystupsize += MAXALIGN(IndexTupleSize(itup)) + sizeof(ItemIdData);
 
@@ -556,6 +609,9 @@ _bt_dedup_finish_pending(Page newpage, BTDedupState state)
 	OffsetNumber tupoff;
 	Size		tuplesz;
 	Size		spacesaving;
+	IndexTuple	stored;
+	Size		storedsz;
+	BTItemBuf	storedbuf;
 
 	Assert(state->nitems > 0);
 	Assert(state->nitems <= state->nhtids);
@@ -565,8 +621,9 @@ _bt_dedup_finish_pending(Page newpage, BTDedupState state)
 	if (state->nitems == 1)
 	{
 		/* Use original, unchanged base tuple */
-		tuplesz = IndexTupleSize(state->base);
-		if (PageAddItem(newpage, (Item) state->base, tuplesz, tupoff,
+		stored = _bt_prefix_compress(newpage, state->base, &storedsz,
+									 &storedbuf);
+		if (PageAddItem(newpage, (Item) stored, storedsz, tupoff,
 						false, false) == InvalidOffsetNumber)
 			elog(ERROR, "deduplication failed to add tuple to page");
 
@@ -577,20 +634,34 @@ _bt_dedup_finish_pending(Page newpage, BTDedupState state)
 		IndexTuple	final;
 
 		/* Form a tuple with a posting list */
-		final = _bt_form_posting(state->base, state->htids, state->nhtids);
+		final = _bt_form_posting(state->base, state->htids, state->nhtids,
+								 state->compress);
 		tuplesz = IndexTupleSize(final);
 		Assert(tuplesz <= state->maxpostingsize);
 
+		/* Insertions must now look out for MaxTIDsPerCompressedBTreePage */
+		if (BTreeTupleIsCompressedPosting(final))
+			BTPageGetOpaque(newpage)->btpo_flags |= BTP_HAS_COMPRESSED;
+
 		/* Save final number of items for posting list */
 		state->intervals[state->nintervals].nitems = state->nitems;
 
 		Assert(tuplesz == MAXALIGN(IndexTupleSize(final)));
-		if (PageAddItem(newpage, (Item) final, tuplesz, tupoff, false,
+		stored = _bt_prefix_compress(newpage, final, &storedsz, &storedbuf);
+		if (PageAddItem(newpage, (Item) stored, storedsz, tupoff, false,
 						false) == InvalidOffsetNumber)
 			elog(ERROR, "deduplication failed to add tuple to page");
 
 		pfree(final);
 		spacesaving = state->phystupsize - (tuplesz + sizeof(ItemIdData));
+
+		/*
+		 * phystupsize counts full tuple sizes.  On a page with a key prefix,
+		 * the tuples that were merged all shared the same part of it (their
+		 * keys are equal), so each of them took up as much less space as
+		 * the new posting list tuple does.
+		 */
+		spacesaving -= (state->nitems - 1) * (tuplesz - MAXALIGN(storedsz));
 		/* Increment nintervals, since we wrote a new posting list tuple */
 		state->nintervals++;
 		Assert(spacesaving > 0 && spacesaving < BLCKSZ);
@@ -645,6 +716,7 @@ _bt_bottomupdel_finish_pending(Page page, BTDedupState state,
 							   TM_IndexDeleteOp *delstate)
 {
 	bool		dupinterval = (state->nitems > 1);
+	BTItemBuf	itembuf;
 
 	Assert(state->nitems > 0);
 	Assert(state->nitems <= state->nhtids);
@@ -654,7 +726,7 @@ _bt_bottomupdel_finish_pending(Page page, BTDedupState state,
 	{
 		OffsetNumber offnum = state->baseoff + i;
 		ItemId		itemid = PageGetItemId(page, offnum);
-		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+		IndexTuple	itup = BTPageGetItem(page, itemid, &itembuf);
 		TM_IndexDelete *ideltid = &delstate->deltids[delstate->ndeltids];
 		TM_IndexStatus *istatus = &delstate->status[delstate->ndeltids];
 
@@ -666,7 +738,8 @@ _bt_bottomupdel_finish_pending(Page page, BTDedupState state,
 			istatus->idxoffnum = offnum;
 			istatus->knowndeletable = false;	/* for now */
 			istatus->promising = dupinterval;	/* simple rule */
-			istatus->freespace = ItemIdGetLength(itemid) + sizeof(ItemIdData);
+			istatus->freespace = MAXALIGN(ItemIdGetLength(itemid)) +
+				sizeof(ItemIdData);
 
 			delstate->ndeltids++;
 		}
@@ -699,14 +772,14 @@ _bt_bottomupdel_finish_pending(Page page, BTDedupState state,
 							midblocklist,
 							maxblocklist;
 				ItemPointer mintid,
-							midtid,
 							maxtid;
+				ItemPointerData midtid;
 
 				mintid = BTreeTupleGetHeapTID(itup);
-				midtid = BTreeTupleGetPostingN(itup, nitem / 2);
+				BTreeTupleGetPostingTID(itup, nitem / 2, &midtid);
 				maxtid = BTreeTupleGetMaxHeapTID(itup);
 				minblocklist = ItemPointerGetBlockNumber(mintid);
-				midblocklist = ItemPointerGetBlockNumber(midtid);
+				midblocklist = ItemPointerGetBlockNumber(&midtid);
 				maxblocklist = ItemPointerGetBlockNumber(maxtid);
 
 				/* Only entry with predominant table block can be promising */
@@ -717,9 +790,7 @@ _bt_bottomupdel_finish_pending(Page page, BTDedupState state,
 
 			for (int p = 0; p < nitem; p++)
 			{
-				ItemPointer htid = BTreeTupleGetPostingN(itup, p);
-
-				ideltid->tid = *htid;
+				BTreeTupleGetPostingTID(itup, p, &ideltid->tid);
 				ideltid->id = delstate->ndeltids;
 				istatus->idxoffnum = offnum;
 				istatus->knowndeletable = false;	/* for now */
@@ -781,14 +852,15 @@ _bt_do_singleval(Relation rel, Page page, BTDedupState state,
 	int			nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
 	ItemId		itemid;
 	IndexTuple	itup;
+	BTItemBuf	itembuf;
 
 	itemid = PageGetItemId(page, minoff);
-	itup = (IndexTuple) PageGetItem(page, itemid);
+	itup = BTPageGetItem(page, itemid, &itembuf);
 
 	if (_bt_keep_natts_fast(rel, newitem, itup) > nkeyatts)
 	{
 		itemid = PageGetItemId(page, PageGetMaxOffsetNumber(page));
-		itup = (IndexTuple) PageGetItem(page, itemid);
+		itup = BTPageGetItem(page, itemid, &itembuf);
 
 		if (_bt_keep_natts_fast(rel, newitem, itup) > nkeyatts)
 			return true;
@@ -822,7 +894,7 @@ _bt_singleval_fillfactor(Page page, BTDedupState state, Size newitemsz)
 
 	/* This calculation needs to match nbtsplitloc.c */
 	leftfree = PageGetPageSize(page) - SizeOfPageHeaderData -
-		MAXALIGN(sizeof(BTPageOpaqueData));
+		PageGetSpecialSize(page);
 	/* Subtract size of new high key (includes pivot heap TID space) */
 	leftfree -= newitemsz + MAXALIGN(sizeof(ItemPointerData));
 
@@ -852,16 +924,23 @@ _bt_singleval_fillfactor(Page page, BTDedupState state, Size newitemsz)
  * space accounting used when deduplicating a page (the same convention
  * simplifies the accounting for choosing a point to split a page at).
  *
+ * When caller asks for compression, the posting list is compressed if that
+ * makes the tuple any smaller, and if every heap TID can be represented in a
+ * compressed posting list.  Otherwise we quietly fall back on a plain
+ * posting list.
+ *
  * Note: Caller's "htids" array must be unique and already in ascending TID
  * order.  Any existing heap TIDs from "base" won't automatically appear in
  * returned posting list tuple (they must be included in htids array.)
  */
 IndexTuple
-_bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
+_bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids,
+				 bool compress)
 {
 	uint32		keysize,
 				newsize;
 	IndexTuple	itup;
+	int			width = 0;
 
 	if (BTreeTupleIsPosting(base))
 		keysize = BTreeTupleGetPostingOffset(base);
@@ -879,6 +958,23 @@ _bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
 	else
 		newsize = keysize;
 
+	if (compress && nhtids > 2)
+	{
+		width = _bt_posting_width(&htids[0], &htids[nhtids - 1]);
+		for (int i = 0; i < nhtids && width > 0; i++)
+		{
+			if (!_bt_posting_tid_fits(&htids[i]))
+				width = 0;
+		}
+		if (width > 0 &&
+			MAXALIGN(keysize + SizeOfBtCompressedPostingHeader +
+					 (nhtids - 2) * width) < newsize)
+			newsize = MAXALIGN(keysize + SizeOfBtCompressedPostingHeader +
+							   (nhtids - 2) * width);
+		else
+			width = 0;
+	}
+
 	Assert(newsize <= INDEX_SIZE_MASK);
 	Assert(newsize == MAXALIGN(newsize));
 
@@ -887,10 +983,17 @@ _bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
 	memcpy(itup, base, keysize);
 	itup->t_info &= ~INDEX_SIZE_MASK;
 	itup->t_info |= newsize;
-	if (nhtids > 1)
+	if (width > 0)
+	{
+		/* Form compressed posting list tuple */
+		BTreeTupleSetPosting(itup, nhtids, keysize, true);
+		_bt_compress_posting(itup, htids, nhtids, width);
+		Assert(_bt_posting_valid(itup));
+	}
+	else if (nhtids > 1)
 	{
 		/* Form posting list tuple */
-		BTreeTupleSetPosting(itup, nhtids, keysize);
+		BTreeTupleSetPosting(itup, nhtids, keysize, false);
 		memcpy(BTreeTupleGetPosting(itup), htids,
 			   sizeof(ItemPointerData) * nhtids);
 		Assert(_bt_posting_valid(itup));
@@ -915,6 +1018,10 @@ _bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
  *
  * On return, caller's vacposting argument will point to final "updated"
  * tuple, which will be palloc()'d in caller's memory context.
+ *
+ * A compressed posting list stays compressed where possible.  The updated
+ * tuple is never larger than the original either way, since removing TIDs
+ * can only shrink the range of TIDs that the remaining TIDs span.
  */
 void
 _bt_update_posting(BTVacuumPosting vacposting)
@@ -933,6 +1040,32 @@ _bt_update_posting(BTVacuumPosting vacposting)
 	Assert(_bt_posting_valid(origtuple));
 	Assert(nhtids > 0 && nhtids < BTreeTupleGetNPosting(origtuple));
 
+	if (BTreeTupleIsCompressedPosting(origtuple))
+	{
+		htids = palloc(sizeof(ItemPointerData) * nhtids);
+		ui = 0;
+		d = 0;
+		for (int i = 0; i < BTreeTupleGetNPosting(origtuple); i++)
+		{
+			if (d < vacposting->ndeletedtids && vacposting->deletetids[d] == i)
+			{
+				d++;
+				continue;
+			}
+			BTreeTupleGetPostingTID(origtuple, i, &htids[ui++]);
+		}
+		Assert(ui == nhtids);
+		Assert(d == vacposting->ndeletedtids);
+
+		itup = _bt_form_posting(origtuple, htids, nhtids, true);
+		Assert(IndexTupleSize(itup) <= IndexTupleSize(origtuple));
+		pfree(htids);
+
+		/* vacposting arg's itup will now point to updated version */
+		vacposting->itup = itup;
+		return;
+	}
+
 	/*
 	 * Determine final size of new tuple.
 	 *
@@ -959,7 +1092,7 @@ _bt_update_posting(BTVacuumPosting vacposting)
 	if (nhtids > 1)
 	{
 		/* Form posting list tuple */
-		BTreeTupleSetPosting(itup, nhtids, keysize);
+		BTreeTupleSetPosting(itup, nhtids, keysize, false);
 		htids = BTreeTupleGetPosting(itup);
 	}
 	else
@@ -1022,6 +1155,8 @@ _bt_swap_posting(IndexTuple newitem, IndexTuple oposting, int postingoff)
 	char	   *replaceposright;
 	Size		nmovebytes;
 	IndexTuple	nposting;
+	ItemPointer htids;
+	int			width;
 
 	nhtids = BTreeTupleGetNPosting(oposting);
 	Assert(_bt_posting_valid(oposting));
@@ -1039,6 +1174,49 @@ _bt_swap_posting(IndexTuple newitem, IndexTuple oposting, int postingoff)
 		elog(ERROR, "posting list tuple with %d items cannot be split at offset %d",
 			 nhtids, postingoff);
 
+	Assert(!BTreeTupleIsPivot(newitem) && !BTreeTupleIsPosting(newitem));
+
+	if (BTreeTupleIsCompressedPosting(oposting))
+	{
+		/*
+		 * Compressed posting list is rewritten with the same width as before.
+		 * newitem's TID is greater than the lowest TID, and less than the
+		 * highest TID, which is what it displaces, so every TID is still
+		 * within range of the lowest TID.  This keeps the size of the tuple
+		 * unchanged, just like in the uncompressed case.
+		 *
+		 * That only works if newitem's TID can be represented, which is
+		 * always true of heap TIDs (only indexes on heap tables compress
+		 * their posting lists).  Don't write a corrupt posting list if it
+		 * somehow isn't.
+		 */
+		if (!_bt_posting_tid_fits(&newitem->t_tid))
+			elog(ERROR, "heap TID (%u,%u) cannot be stored in compressed posting list",
+				 ItemPointerGetBlockNumber(&newitem->t_tid),
+				 ItemPointerGetOffsetNumber(&newitem->t_tid));
+
+		htids = palloc(sizeof(ItemPointerData) * nhtids);
+		for (int i = 0; i < postingoff; i++)
+			BTreeTupleGetPostingTID(oposting, i, &htids[i]);
+		ItemPointerCopy(&newitem->t_tid, &htids[postingoff]);
+		for (int i = postingoff + 1; i < nhtids; i++)
+			BTreeTupleGetPostingTID(oposting, i - 1, &htids[i]);
+
+		nposting = CopyIndexTuple(oposting);
+		width = *((unsigned char *) (BTreeTupleGetPosting(oposting) + 2));
+		_bt_compress_posting(nposting, htids, nhtids, width);
+		pfree(htids);
+
+		/* Now copy oposting's rightmost/max TID into new item */
+		ItemPointerCopy(BTreeTupleGetMaxHeapTID(oposting), &newitem->t_tid);
+
+		Assert(ItemPointerCompare(BTreeTupleGetMaxHeapTID(nposting),
+								  BTreeTupleGetHeapTID(newitem)) < 0);
+		Assert(_bt_posting_valid(nposting));
+
+		return nposting;
+	}
+
 	/*
 	 * Move item pointers in posting list to make a gap for the new item's
 	 * heap TID.  We shift TIDs one place to the right, losing original
@@ -1052,7 +1230,6 @@ _bt_swap_posting(IndexTuple newitem, IndexTuple oposting, int postingoff)
 	memmove(replaceposright, replacepos, nmovebytes);
 
 	/* Fill the gap at postingoff with TID of new item (original new TID) */
-	Assert(!BTreeTupleIsPivot(newitem) && !BTreeTupleIsPosting(newitem));
 	ItemPointerCopy(&newitem->t_tid, (ItemPointer) replacepos);
 
 	/* Now copy oposting's rightmost/max TID into new item (final new TID) */
@@ -1065,6 +1242,84 @@ _bt_swap_posting(IndexTuple newitem, IndexTuple oposting, int postingoff)
 	return nposting;
 }
 
+/*
+ * Can heap TID be represented in a compressed posting list?
+ */
+static inline bool
+_bt_posting_tid_fits(ItemPointer htid)
+{
+	return ItemPointerGetOffsetNumber(htid) < (1 << BT_POSTING_OFFSET_BITS);
+}
+
+/*
+ * Represent heap TID as an integer, the way compressed posting lists do.
+ * Caller must have checked that it fits.
+ */
+static inline uint64
+_bt_posting_tid_value(ItemPointer htid)
+{
+	Assert(_bt_posting_tid_fits(htid));
+
+	return ((uint64) ItemPointerGetBlockNumber(htid) <<
+			BT_POSTING_OFFSET_BITS) | ItemPointerGetOffsetNumber(htid);
+}
+
+/*
+ * Determine how many bytes a compressed posting list needs for each of its
+ * TIDs when they span mintid to maxtid.  Returns 0 if that's too many for a
+ * compressed posting list to be worthwhile.
+ */
+static int
+_bt_posting_width(ItemPointer mintid, ItemPointer maxtid)
+{
+	uint64		range;
+	int			width = 1;
+
+	range = _bt_posting_tid_value(maxtid) - _bt_posting_tid_value(mintid);
+	while ((range >> (width * BITS_PER_BYTE)) != 0)
+	{
+		if (++width > BT_POSTING_MAX_WIDTH)
+			return 0;
+	}
+
+	return width;
+}
+
+/*
+ * Write compressed posting list for htids into posting, using width bytes
+ * for each TID other than the lowest and highest.  posting must already have
+ * been set up as a compressed posting list tuple of the right size.
+ */
+static void
+_bt_compress_posting(IndexTuple posting, ItemPointer htids, int nhtids,
+					 int width)
+{
+	ItemPointer plist = BTreeTupleGetPosting(posting);
+	unsigned char *ptr;
+	uint64		minval;
+
+	Assert(BTreeTupleIsCompressedPosting(posting));
+	Assert(BTreeTupleGetNPosting(posting) == nhtids && nhtids > 2);
+	Assert(width > 0 && width <= BT_POSTING_MAX_WIDTH);
+	Assert((char *) plist + SizeOfBtCompressedPostingHeader +
+		   (nhtids - 2) * width <= (char *) posting + IndexTupleSize(posting));
+
+	ItemPointerCopy(&htids[0], &plist[0]);
+	ItemPointerCopy(&htids[nhtids - 1], &plist[1]);
+	ptr = (unsigned char *) (plist + 2);
+	*ptr++ = (unsigned char) width;
+
+	minval = _bt_posting_tid_value(&htids[0]);
+	for (int i = 1; i < nhtids - 1; i++)
+	{
+		uint64		delta = _bt_posting_tid_value(&htids[i]) - minval;
+
+		Assert((delta >> (width * BITS_PER_BYTE)) == 0);
+		for (int b = width - 1; b >= 0; b--)
+			*ptr++ = (unsigned char) (delta >> (b * BITS_PER_BYTE));
+	}
+}
+
 /*
  * Verify posting list invariants for "posting", which must be a posting list
  * tuple.  Used within assertions.
@@ -1074,7 +1329,7 @@ static bool
 _bt_posting_valid(IndexTuple posting)
 {
 	ItemPointerData last;
-	ItemPointer htid;
+	ItemPointerData htid;
 
 	if (!BTreeTupleIsPosting(posting) || BTreeTupleGetNPosting(posting) < 2)
 		return false;
@@ -1087,15 +1342,20 @@ _bt_posting_valid(IndexTuple posting)
 	/* Iterate, starting from second TID */
 	for (int i = 1; i < BTreeTupleGetNPosting(posting); i++)
 	{
-		htid = BTreeTupleGetPostingN(posting, i);
+		BTreeTupleGetPostingTID(posting, i, &htid);
 
-		if (!ItemPointerIsValid(htid))
+		if (!ItemPointerIsValid(&htid))
 			return false;
-		if (ItemPointerCompare(htid, &last) <= 0)
+		if (ItemPointerCompare(&htid, &last) <= 0)
 			return false;
-		ItemPointerCopy(htid, &last);
+		ItemPointerCopy(&htid, &last);
 	}
 
+	/* Highest TID of compressed posting list is stored twice */
+	if (BTreeTupleIsCompressedPosting(posting) &&
+		!ItemPointerEquals(&last, BTreeTupleGetMaxHeapTID(posting)))
+		return false;
+
 	return true;
 }
 #endif
@@ -58,6 +58,14 @@ static Buffer _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf,
 static void _bt_insert_parent(Relation rel, Buffer buf, Buffer rbuf,
 							  BTStack stack, bool isroot, bool isonly);
 static Buffer _bt_newroot(Relation rel, Buffer lbuf, Buffer rbuf);
+static bool _bt_leaf_tids_full(Page page);
+static Size _bt_split_newitemsz(Page origpage, IndexTuple newitem,
+								Size newitemsz);
+static BTPagePrefix _bt_split_prefix(Relation rel, Page origpage,
+									 OffsetNumber firstoff,
+									 OffsetNumber lastoff, IndexTuple newitem,
+									 OffsetNumber postingoff,
+									 IndexTuple nposting);
 static inline bool _bt_pgaddtup(Page page, Size itemsize, IndexTuple itup,
 								OffsetNumber itup_off, bool newfirstdataitem);
 static void _bt_delete_or_dedup_one_page(Relation rel, Relation heapRel,
@@ -410,6 +418,7 @@ _bt_check_unique(Relation rel, BTInsertState insertstate, Relation heapRel,
 	IndexTuple	itup = insertstate->itup;
 	IndexTuple	curitup = NULL;
 	ItemId		curitemid = NULL;
+	BTItemBuf	curitupbuf;
 	BTScanInsert itup_key = insertstate->itup_key;
 	SnapshotData SnapshotDirty;
 	OffsetNumber offset;
@@ -512,7 +521,7 @@ _bt_check_unique(Relation rel, BTInsertState insertstate, Relation heapRel,
 						break;	/* we're past all the equal tuples */
 
 					/* Advanced curitup */
-					curitup = (IndexTuple) PageGetItem(page, curitemid);
+					curitup = BTPageGetItem(page, curitemid, &curitupbuf);
 					Assert(!BTreeTupleIsPivot(curitup));
 				}
 
@@ -529,13 +538,13 @@ _bt_check_unique(Relation rel, BTInsertState insertstate, Relation heapRel,
 					inposting = true;
 					prevalldead = true;
 					curposti = 0;
-					htid = *BTreeTupleGetPostingN(curitup, 0);
+					BTreeTupleGetPostingTID(curitup, 0, &htid);
 				}
 				else
 				{
 					/* ... htid is second or subsequent TID in posting list */
 					Assert(curposti > 0);
-					htid = *BTreeTupleGetPostingN(curitup, curposti);
+					BTreeTupleGetPostingTID(curitup, curposti, &htid);
 				}
 
 				/*
@@ -1118,6 +1127,11 @@ _bt_insertonpg(Relation rel,
 	IndexTuple	oposting = NULL;
 	IndexTuple	origitup = NULL;
 	IndexTuple	nposting = NULL;
+	ItemId		opostingitemid = NULL;
+	IndexTuple	storeditup;
+	Size		storeditemsz;
+	BTItemBuf	opostingbuf;
+	BTItemBuf	storedbuf;
 
 	page = BufferGetPage(buf);
 	opaque = BTPageGetOpaque(page);
@@ -1163,7 +1177,8 @@ _bt_insertonpg(Relation rel,
 		 * insert or page split critical section.
 		 */
 		Assert(isleaf && itup_key->heapkeyspace && itup_key->allequalimage);
-		oposting = (IndexTuple) PageGetItem(page, itemid);
+		opostingitemid = itemid;
+		oposting = BTPageGetItem(page, itemid, &opostingbuf);
 
 		/*
 		 * postingoff value comes from earlier call to _bt_binsrch_posting().
@@ -1195,14 +1210,24 @@ _bt_insertonpg(Relation rel,
 		newitemoff = OffsetNumberNext(newitemoff);
 	}
 
+	/*
+	 * On a leaf page with a key prefix, itup takes up less space than itemsz
+	 * if it shares some of the prefix
+	 */
+	storeditup = _bt_prefix_compress(page, itup, &storeditemsz, &storedbuf);
+
 	/*
 	 * Do we need to split the page to fit the item on it?
 	 *
 	 * Note: PageGetFreeSpace() subtracts sizeof(ItemIdData) from its result,
 	 * so this comparison is correct even though we appear to be accounting
 	 * only for the item and not for its line pointer.
+	 *
+	 * A leaf page with compressed posting lists may also have to be split
+	 * because it already holds as many heap TIDs as a leaf page may.
 	 */
-	if (PageGetFreeSpace(page) < itemsz)
+	if (PageGetFreeSpace(page) < MAXALIGN(storeditemsz) ||
+		(isleaf && P_HAS_COMPRESSED(opaque) && _bt_leaf_tids_full(page)))
 	{
 		Buffer		rbuf;
 
@@ -1270,10 +1295,18 @@ _bt_insertonpg(Relation rel,
 		START_CRIT_SECTION();
 
 		if (postingoff != 0)
-			memcpy(oposting, nposting, MAXALIGN(IndexTupleSize(nposting)));
+		{
+			Size		npostingsz;
 
-		if (PageAddItem(page, (Item) itup, itemsz, newitemoff, false,
-						false) == InvalidOffsetNumber)
+			/* nposting has the same keys, so it's stored in the same space */
+			nposting = _bt_prefix_compress(page, nposting, &npostingsz,
+										   &opostingbuf);
+			Assert(npostingsz == ItemIdGetLength(opostingitemid));
+			memcpy(PageGetItem(page, opostingitemid), nposting, npostingsz);
+		}
+
+		if (PageAddItem(page, (Item) storeditup, storeditemsz, newitemoff,
+						false, false) == InvalidOffsetNumber)
 			elog(PANIC, "failed to add new item to block %u in index \"%s\"",
 				 BufferGetBlockNumber(buf), RelationGetRelationName(rel));
 
@@ -1361,8 +1394,8 @@ _bt_insertonpg(Relation rel,
 			XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
 			if (postingoff == 0)
 			{
-				/* Just log itup from caller */
-				XLogRegisterBufData(0, (char *) itup, IndexTupleSize(itup));
+				/* Just log itup from caller, as stored on the page */
+				XLogRegisterBufData(0, (char *) storeditup, storeditemsz);
 			}
 			else
 			{
@@ -1479,6 +1512,10 @@ _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf, Buffer cbuf,
 	ItemId		itemid;
 	IndexTuple	firstright,
 				lefthighkey;
+	BTItemBuf	firstrightbuf,
+				lastleftbuf;
+	BTPagePrefix lprefix = NULL,
+				rprefix = NULL;
 	OffsetNumber firstrightoff;
 	OffsetNumber afterleftoff,
 				afterrightoff,
@@ -1534,7 +1571,9 @@ _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf, Buffer cbuf,
 	 * newitem the firstright tuple, though, so this case isn't a special
 	 * case.
 	 */
-	firstrightoff = _bt_findsplitloc(rel, origpage, newitemoff, newitemsz,
+	firstrightoff = _bt_findsplitloc(rel, origpage, newitemoff,
+									 _bt_split_newitemsz(origpage, newitem,
+														 newitemsz),
 									 newitem, &newitemonleft);
 
 	/* Allocate temp buffer for leftpage */
@@ -1544,10 +1583,11 @@ _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf, Buffer cbuf,
 
 	/*
 	 * leftpage won't be the root when we're done.  Also, clear the SPLIT_END
-	 * and HAS_GARBAGE flags.
+	 * and HAS_GARBAGE flags.  The key prefix (if any) is set up below.
 	 */
 	lopaque->btpo_flags = oopaque->btpo_flags;
-	lopaque->btpo_flags &= ~(BTP_ROOT | BTP_SPLIT_END | BTP_HAS_GARBAGE);
+	lopaque->btpo_flags &= ~(BTP_ROOT | BTP_SPLIT_END | BTP_HAS_GARBAGE |
+							 BTP_HAS_PREFIX);
 	/* set flag in leftpage indicating that rightpage has no downlink yet */
 	lopaque->btpo_flags |= BTP_INCOMPLETE_SPLIT;
 	lopaque->btpo_prev = oopaque->btpo_prev;
@@ -1590,6 +1630,28 @@ _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf, Buffer cbuf,
 		origpagepostingoff = OffsetNumberPrev(newitemoff);
 	}
 
+	/*
+	 * Choose key prefixes for the new halves of a leaf page.  Each half keeps
+	 * origpage's key prefix, if it had one, unless a longer one makes the
+	 * half smaller still.  Either way no item takes up more space on its
+	 * half than _bt_findsplitloc() assumed, so the halves are sure to fit.
+	 */
+	if (isleaf)
+	{
+		lprefix = _bt_split_prefix(rel, origpage, P_FIRSTDATAKEY(oopaque),
+								   OffsetNumberPrev(firstrightoff),
+								   newitemonleft ? newitem : NULL,
+								   origpagepostingoff, nposting);
+		rprefix = _bt_split_prefix(rel, origpage, firstrightoff, maxoff,
+								   newitemonleft ? NULL : newitem,
+								   origpagepostingoff, nposting);
+		if (lprefix)
+		{
+			_bt_prefix_setpage(leftpage, lprefix);
+			lopaque = BTPageGetOpaque(leftpage);
+		}
+	}
+
 	/*
 	 * The high key for the new left page is a possibly-truncated copy of
 	 * firstright on the leaf level (it's "firstright itself" on internal
@@ -1621,7 +1683,7 @@ _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf, Buffer cbuf,
 		/* existing item at firstrightoff becomes firstright */
 		itemid = PageGetItemId(origpage, firstrightoff);
 		itemsz = ItemIdGetLength(itemid);
-		firstright = (IndexTuple) PageGetItem(origpage, itemid);
+		firstright = BTPageGetItem(origpage, itemid, &firstrightbuf);
 		if (firstrightoff == origpagepostingoff)
 			firstright = nposting;
 	}
@@ -1644,7 +1706,7 @@ _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf, Buffer cbuf,
 			lastleftoff = OffsetNumberPrev(firstrightoff);
 			Assert(lastleftoff >= P_FIRSTDATAKEY(oopaque));
 			itemid = PageGetItemId(origpage, lastleftoff);
-			lastleft = (IndexTuple) PageGetItem(origpage, itemid);
+			lastleft = BTPageGetItem(origpage, itemid, &lastleftbuf);
 			if (lastleftoff == origpagepostingoff)
 				lastleft = nposting;
 		}
@@ -1734,11 +1796,17 @@ _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf, Buffer cbuf,
 	 * and HAS_GARBAGE flags.
 	 */
 	ropaque->btpo_flags = oopaque->btpo_flags;
-	ropaque->btpo_flags &= ~(BTP_ROOT | BTP_SPLIT_END | BTP_HAS_GARBAGE);
+	ropaque->btpo_flags &= ~(BTP_ROOT | BTP_SPLIT_END | BTP_HAS_GARBAGE |
+							 BTP_HAS_PREFIX);
 	ropaque->btpo_prev = origpagenumber;
 	ropaque->btpo_next = oopaque->btpo_next;
 	ropaque->btpo_level = oopaque->btpo_level;
 	ropaque->btpo_cycleid = lopaque->btpo_cycleid;
+	if (rprefix)
+	{
+		_bt_prefix_setpage(rightpage, rprefix);
+		ropaque = BTPageGetOpaque(rightpage);
+	}
 
 	/*
 	 * Add new high key to rightpage where necessary.
@@ -1790,8 +1858,8 @@ _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf, Buffer cbuf,
 		IndexTuple	dataitem;
 
 		itemid = PageGetItemId(origpage, i);
-		itemsz = ItemIdGetLength(itemid);
-		dataitem = (IndexTuple) PageGetItem(origpage, itemid);
+		dataitem = BTPageGetItem(origpage, itemid, &firstrightbuf);
+		itemsz = MAXALIGN(IndexTupleSize(dataitem));
 
 		/* replace original item with nposting due to posting split? */
 		if (i == origpagepostingoff)
@@ -1976,8 +2044,18 @@ _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf, Buffer cbuf,
 		XLogBeginInsert();
 		XLogRegisterData((char *) &xlrec, SizeOfBtreeSplit);
 
-		XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
-		XLogRegisterBuffer(1, rbuf, REGBUF_WILL_INIT);
+		/*
+		 * REDO routine can't reconstruct halves that have a key prefix from
+		 * the record alone, so log full-page images of those instead
+		 */
+		if (P_HAS_PREFIX(BTPageGetOpaque(origpage)))
+			XLogRegisterBuffer(0, buf, REGBUF_STANDARD | REGBUF_FORCE_IMAGE);
+		else
+			XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
+		if (P_HAS_PREFIX(ropaque))
+			XLogRegisterBuffer(1, rbuf, REGBUF_STANDARD | REGBUF_FORCE_IMAGE);
+		else
+			XLogRegisterBuffer(1, rbuf, REGBUF_WILL_INIT);
 		/* Log original right sibling, since we've changed its prev-pointer */
 		if (!isrightmost)
 			XLogRegisterBuffer(2, sbuf, REGBUF_STANDARD);
@@ -2595,6 +2673,131 @@ _bt_newroot(Relation rel, Buffer lbuf, Buffer rbuf)
 	return rootbuf;
 }
 
+/*
+ *	_bt_leaf_tids_full() -- can't add another heap TID to leaf page?
+ *
+ *		Compressed posting lists take less space per heap TID than the
+ *		MaxTIDsPerBTreePage limit allows for, so a leaf page with compressed
+ *		posting lists could otherwise end up with more heap TIDs than the
+ *		MaxTIDsPerCompressedBTreePage-sized buffers of index scans and index
+ *		tuple deletion can hold.  Only called for pages that have
+ *		BTP_HAS_COMPRESSED set.
+ *
+ *		Splitting the page when this returns true is always enough, since both
+ *		halves of the split get at least one heap TID.
+ *
+ *		Every heap TID takes up at least one byte of tuple space, so there is
+ *		no need to count them until the tuples on the page take up at least
+ *		MaxTIDsPerCompressedBTreePage bytes.  That keeps inserts into pages
+ *		that are far from full cheap.
+ */
+static bool
+_bt_leaf_tids_full(Page page)
+{
+	BTPageOpaque opaque = BTPageGetOpaque(page);
+	PageHeader	phdr = (PageHeader) page;
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+	int			ntids = 0;
+
+	Assert(P_ISLEAF(opaque) && P_HAS_COMPRESSED(opaque));
+
+	if (phdr->pd_special - phdr->pd_upper < MaxTIDsPerCompressedBTreePage)
+		return false;
+
+	for (OffsetNumber offnum = P_FIRSTDATAKEY(opaque);
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		IndexTuple	itup = (IndexTuple) PageGetItem(page,
+													PageGetItemId(page, offnum));
+
+		if (BTreeTupleIsPosting(itup))
+			ntids += BTreeTupleGetNPosting(itup);
+		else
+			ntids++;
+	}
+
+	return ntids >= MaxTIDsPerCompressedBTreePage;
+}
+
+/*
+ *	_bt_split_newitemsz() -- space newitem takes up on origpage during split.
+ *
+ *		newitemsz is the size of the full tuple.  It's less than that on a leaf
+ *		page with a key prefix that newitem shares part of.
+ */
+static Size
+_bt_split_newitemsz(Page origpage, IndexTuple newitem, Size newitemsz)
+{
+	BTItemBuf	storedbuf;
+
+	if (!P_HAS_PREFIX(BTPageGetOpaque(origpage)))
+		return newitemsz;
+
+	(void) _bt_prefix_compress(origpage, newitem, &newitemsz, &storedbuf);
+
+	return MAXALIGN(newitemsz);
+}
+
+/*
+ *	_bt_split_prefix() -- choose key prefix for one half of a leaf page split.
+ *
+ *		The half gets the items at offsets firstoff through lastoff of
+ *		origpage, with nposting in place of the item at postingoff, and also
+ *		newitem unless that's NULL.  Returns NULL if the half shouldn't have
+ *		a key prefix.
+ */
+static BTPagePrefix
+_bt_split_prefix(Relation rel, Page origpage, OffsetNumber firstoff,
+				 OffsetNumber lastoff, IndexTuple newitem,
+				 OffsetNumber postingoff, IndexTuple nposting)
+{
+	BTPagePrefix curprefix = NULL;
+	BTPagePrefix prefix;
+	IndexTuple *items;
+	bool	   *expanded;
+	int			nitems = 0;
+
+	if (P_HAS_PREFIX(BTPageGetOpaque(origpage)))
+		curprefix = BTPageGetPrefix(origpage);
+	if (!BTGetCompressKeyPrefixes(rel))
+		return curprefix;
+
+	items = palloc(sizeof(IndexTuple) * (lastoff - firstoff + 2));
+	expanded = palloc0(sizeof(bool) * (lastoff - firstoff + 2));
+	for (OffsetNumber off = firstoff; off <= lastoff; off++)
+	{
+		ItemId		itemid = PageGetItemId(origpage, off);
+		IndexTuple	itup = (IndexTuple) PageGetItem(origpage, itemid);
+
+		if (off == postingoff)
+			itup = nposting;
+		else if (IndexTupleSize(itup) != ItemIdGetLength(itemid))
+		{
+			BTItemBuf	itembuf;
+
+			itup = CopyIndexTuple(_bt_prefix_expand(origpage, itemid,
+													&itembuf));
+			expanded[nitems] = true;
+		}
+		items[nitems++] = itup;
+	}
+	if (newitem)
+		items[nitems++] = newitem;
+
+	prefix = _bt_prefix_choose(rel, curprefix, items, nitems);
+
+	for (int i = 0; i < nitems; i++)
+	{
+		if (expanded[i])
+			pfree(items[i]);
+	}
+	pfree(items);
+	pfree(expanded);
+
+	return prefix;
+}
+
 /*
  *	_bt_pgaddtup() -- add a data item to a particular page during split.
  *
@@ -2612,6 +2815,9 @@ _bt_newroot(Relation rel, Buffer lbuf, Buffer rbuf)
  *		See _bt_split() for a high level explanation of why we truncate here.
  *		Note that this routine has nothing to do with suffix truncation,
  *		despite using some of the same infrastructure.
+ *
+ *		Caller always passes a full tuple.  We store it without the part of
+ *		its key that it shares with the page's key prefix, if any.
  */
 static inline bool
 _bt_pgaddtup(Page page,
@@ -2621,6 +2827,7 @@ _bt_pgaddtup(Page page,
 			 bool newfirstdataitem)
 {
 	IndexTupleData trunctuple;
+	BTItemBuf	storedbuf;
 
 	if (newfirstdataitem)
 	{
@@ -2630,6 +2837,8 @@ _bt_pgaddtup(Page page,
 		itup = &trunctuple;
 		itemsize = sizeof(IndexTupleData);
 	}
+	else
+		itup = _bt_prefix_compress(page, itup, &itemsize, &storedbuf);
 
 	if (unlikely(PageAddItem(page, (Item) itup, itemsize, itup_off, false,
 							 false) == InvalidOffsetNumber))
@@ -2805,6 +3014,8 @@ _bt_simpledel_pass(Relation rel, Buffer buffer, Relation heapRel,
 	int			ndeadblocks;
 	TM_IndexDeleteOp delstate;
 	OffsetNumber offnum;
+	int			maxtids = BTPageGetMaxTIDs(BTPageGetOpaque(page));
+	BTItemBuf	itembuf;
 
 	/* Get array of table blocks pointed to by LP_DEAD-set tuples */
 	deadblocks = _bt_deadblocks(page, deletable, ndeletable, newitem,
@@ -2816,15 +3027,15 @@ _bt_simpledel_pass(Relation rel, Buffer buffer, Relation heapRel,
 	delstate.bottomup = false;
 	delstate.bottomupfreespace = 0;
 	delstate.ndeltids = 0;
-	delstate.deltids = palloc(MaxTIDsPerBTreePage * sizeof(TM_IndexDelete));
-	delstate.status = palloc(MaxTIDsPerBTreePage * sizeof(TM_IndexStatus));
+	delstate.deltids = palloc(maxtids * sizeof(TM_IndexDelete));
+	delstate.status = palloc(maxtids * sizeof(TM_IndexStatus));
 
 	for (offnum = minoff;
 		 offnum <= maxoff;
 		 offnum = OffsetNumberNext(offnum))
 	{
 		ItemId		itemid = PageGetItemId(page, offnum);
-		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+		IndexTuple	itup = BTPageGetItem(page, itemid, &itembuf);
 		TM_IndexDelete *odeltid = &delstate.deltids[delstate.ndeltids];
 		TM_IndexStatus *ostatus = &delstate.status[delstate.ndeltids];
 		BlockNumber tidblock;
@@ -2861,9 +3072,10 @@ _bt_simpledel_pass(Relation rel, Buffer buffer, Relation heapRel,
 
 			for (int p = 0; p < nitem; p++)
 			{
-				ItemPointer tid = BTreeTupleGetPostingN(itup, p);
+				ItemPointerData tid;
 
-				tidblock = ItemPointerGetBlockNumber(tid);
+				BTreeTupleGetPostingTID(itup, p, &tid);
+				tidblock = ItemPointerGetBlockNumber(&tid);
 				match = bsearch(&tidblock, deadblocks, ndeadblocks,
 								sizeof(BlockNumber), _bt_blk_cmp);
 
@@ -2877,7 +3089,7 @@ _bt_simpledel_pass(Relation rel, Buffer buffer, Relation heapRel,
 				 * TID's table block is among those pointed to by the TIDs
 				 * from LP_DEAD-bit set tuples on page -- add TID to deltids
 				 */
-				odeltid->tid = *tid;
+				odeltid->tid = tid;
 				odeltid->id = delstate.ndeltids;
 				ostatus->idxoffnum = offnum;
 				ostatus->knowndeletable = ItemIdIsDead(itemid);
@@ -2928,6 +3140,7 @@ _bt_deadblocks(Page page, OffsetNumber *deletable, int ndeletable,
 	int			spacentids,
 				ntids;
 	BlockNumber *tidblocks;
+	BTItemBuf	itembuf;
 
 	/*
 	 * Accumulate each TID's block in array whose initial size has space for
@@ -2950,7 +3163,7 @@ _bt_deadblocks(Page page, OffsetNumber *deletable, int ndeletable,
 	for (int i = 0; i < ndeletable; i++)
 	{
 		ItemId		itemid = PageGetItemId(page, deletable[i]);
-		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+		IndexTuple	itup = BTPageGetItem(page, itemid, &itembuf);
 
 		Assert(ItemIdIsDead(itemid));
 
@@ -2978,9 +3191,10 @@ _bt_deadblocks(Page page, OffsetNumber *deletable, int ndeletable,
 
 			for (int j = 0; j < nposting; j++)
 			{
-				ItemPointer tid = BTreeTupleGetPostingN(itup, j);
+				ItemPointerData tid;
 
-				tidblocks[ntids++] = ItemPointerGetBlockNumber(tid);
+				BTreeTupleGetPostingTID(itup, j, &tid);
+				tidblocks[ntids++] = ItemPointerGetBlockNumber(&tid);
 			}
 		}
 	}
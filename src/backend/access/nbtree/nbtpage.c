@@ -812,7 +812,7 @@ _bt_checkpage(Relation rel, Buffer buf)
 	/*
 	 * Additionally check that the special area looks sane.
 	 */
-	if (PageGetSpecialSize(page) != MAXALIGN(sizeof(BTPageOpaqueData)))
+	if (!BTPageSpecialSizeIsValid(page))
 		ereport(ERROR,
 				(errcode(ERRCODE_INDEX_CORRUPTED),
 				 errmsg("index \"%s\" contains corrupted page at block %u",
@@ -1172,6 +1172,7 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 	bool		needswal = RelationNeedsWAL(rel);
 	char	   *updatedbuf = NULL;
 	Size		updatedbuflen = 0;
+	BTItemBuf	storedbuf;
 	OffsetNumber updatedoffsets[MaxIndexTuplesPerPage];
 
 	/* Shouldn't be called unless there's something to do */
@@ -1204,8 +1205,8 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		IndexTuple	itup;
 		Size		itemsz;
 
-		itup = updatable[i]->itup;
-		itemsz = MAXALIGN(IndexTupleSize(itup));
+		itup = _bt_prefix_compress(page, updatable[i]->itup, &itemsz,
+								   &storedbuf);
 		if (!PageIndexTupleOverwrite(page, updatedoffset, (Item) itup,
 									 itemsz))
 			elog(PANIC, "failed to update partially dead item in block %u of index \"%s\"",
@@ -1302,6 +1303,7 @@ _bt_delitems_delete(Relation rel, Buffer buf, TransactionId latestRemovedXid,
 	bool		needswal = RelationNeedsWAL(rel);
 	char	   *updatedbuf = NULL;
 	Size		updatedbuflen = 0;
+	BTItemBuf	storedbuf;
 	OffsetNumber updatedoffsets[MaxIndexTuplesPerPage];
 
 	/* Shouldn't be called unless there's something to do */
@@ -1323,8 +1325,8 @@ _bt_delitems_delete(Relation rel, Buffer buf, TransactionId latestRemovedXid,
 		IndexTuple	itup;
 		Size		itemsz;
 
-		itup = updatable[i]->itup;
-		itemsz = MAXALIGN(IndexTupleSize(itup));
+		itup = _bt_prefix_compress(page, updatable[i]->itup, &itemsz,
+								   &storedbuf);
 		if (!PageIndexTupleOverwrite(page, updatedoffset, (Item) itup,
 									 itemsz))
 			elog(PANIC, "failed to update partially dead item in block %u of index \"%s\"",
@@ -1568,7 +1570,8 @@ _bt_delitems_delete_check(Relation rel, Buffer buf, Relation heapRel,
 		TM_IndexStatus *dstatus = delstate->status + delstate->deltids[i].id;
 		OffsetNumber idxoffnum = dstatus->idxoffnum;
 		ItemId		itemid = PageGetItemId(page, idxoffnum);
-		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+		BTItemBuf	itembuf;
+		IndexTuple	itup = BTPageGetItem(page, itemid, &itembuf);
 		int			nestedi,
 					nitem;
 		BTVacuumPosting vacposting;
@@ -1612,9 +1615,11 @@ _bt_delitems_delete_check(Relation rel, Buffer buf, Relation heapRel,
 		nitem = BTreeTupleGetNPosting(itup);
 		for (int p = 0; p < nitem; p++)
 		{
-			ItemPointer ptid = BTreeTupleGetPostingN(itup, p);
+			ItemPointerData ptid;
 			int			ptidcmp = -1;
 
+			BTreeTupleGetPostingTID(itup, p, &ptid);
+
 			/*
 			 * This nested loop reuses work across ptid TIDs taken from itup.
 			 * We take advantage of the fact that both itup's TIDs and deltids
@@ -1636,7 +1641,7 @@ _bt_delitems_delete_check(Relation rel, Buffer buf, Relation heapRel,
 					continue;
 
 				/* Entry is first partial ptid match (or an exact match)? */
-				ptidcmp = ItemPointerCompare(&tcdeltid->tid, ptid);
+				ptidcmp = ItemPointerCompare(&tcdeltid->tid, &ptid);
 				if (ptidcmp >= 0)
 				{
 					/* Greater than or equal (partial or exact) match... */
@@ -1653,6 +1658,9 @@ _bt_delitems_delete_check(Relation rel, Buffer buf, Relation heapRel,
 			{
 				vacposting = palloc(offsetof(BTVacuumPostingData, deletetids) +
 									nitem * sizeof(uint16));
+				/* an expanded itup must outlive itembuf */
+				if (itup == (IndexTuple) itembuf.data)
+					itup = CopyIndexTuple(itup);
 				vacposting->itup = itup;
 				vacposting->updatedoffset = idxoffnum;
 				vacposting->ndeletedtids = 0;
@@ -2217,6 +2225,12 @@ _bt_mark_page_halfdead(Relation rel, Buffer leafbuf, BTStack stack)
 	 */
 	page = BufferGetPage(leafbuf);
 	opaque = BTPageGetOpaque(page);
+	if (P_HAS_PREFIX(opaque))
+	{
+		/* REDO reinitializes the page without one */
+		_bt_prefix_clearpage(page);
+		opaque = BTPageGetOpaque(page);
+	}
 	opaque->btpo_flags |= BTP_HALF_DEAD;
 
 	Assert(PageGetMaxOffsetNumber(page) == P_HIKEY);
@@ -0,0 +1,448 @@
+/*-------------------------------------------------------------------------
+ *
+ * nbtprefix.c
+ *	  Key prefix compression of leaf pages in Postgres btrees.
+ *
+ * A leaf page with BTP_HAS_PREFIX set stores a key prefix in its special
+ * space (see BTPagePrefixData), and its non-pivot tuples are stored without
+ * the leading key bytes that they share with that prefix.  The routines here
+ * choose a key prefix for a page, and convert tuples between their stored
+ * and full forms.  Everything else in nbtree works with full tuples, which
+ * it gets from leaf pages with BTPageGetItem().
+ *
+ * Each stored tuple is independent of the others on the page: it can be
+ * expanded given only its line pointer and the page's key prefix.  The line
+ * pointer array therefore still serves as the index into the tuples on the
+ * page that binary searches rely on.  Expanding a tuple is a few memcpy()
+ * calls, and there's no need to do it at all for tuples that don't share any
+ * bytes with the prefix.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/nbtree/nbtprefix.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/nbtree.h"
+#include "access/tupmacs.h"
+#include "utils/rel.h"
+
+/*
+ * The bytes of a tuple's keys that a key prefix applies to
+ */
+typedef struct BTKeyBytes
+{
+	char	   *fixed;			/* leading fixed-width attributes, or NULL if
+								 * tuple can't share bytes with a prefix */
+	int			fixedlen;
+	char	   *var;			/* data of varlena attribute, or NULL */
+	int			varlen;
+} BTKeyBytes;
+
+static void _bt_prefix_keybytes(IndexTuple itup, uint16 fixedlen,
+								char varalign, BTKeyBytes *kb);
+static int	_bt_prefix_match(const char *prefix, int len, BTKeyBytes *kb);
+
+/*
+ * Determine the part of the tuples of index rel that a key prefix can apply
+ * to: the number of bytes taken up by its leading fixed-width key attributes,
+ * and the alignment of the varlena key attribute that follows them, if any.
+ *
+ * Returns false when there's nothing for a key prefix to apply to (when the
+ * first key attribute is a cstring, for example).
+ */
+bool
+_bt_prefix_layout(Relation rel, uint16 *fixedlen, char *varalign)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	int			nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
+	Size		off = 0;
+	int			i;
+
+	for (i = 0; i < nkeyatts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(itupdesc, i);
+
+		if (att->attlen <= 0)
+			break;
+
+		/*
+		 * Offsets are relative to the start of the data area of a tuple
+		 * without NULLs, which is MAXALIGN()'d, so aligning them is the same
+		 * as aligning the attribute's address
+		 */
+		off = att_align_nominal(off, att->attalign);
+		off += att->attlen;
+	}
+
+	*fixedlen = (uint16) off;
+	*varalign = '\0';
+	if (i < nkeyatts && TupleDescAttr(itupdesc, i)->attlen == -1)
+		*varalign = TupleDescAttr(itupdesc, i)->attalign;
+
+	return *fixedlen > 0 || *varalign != '\0';
+}
+
+/*
+ * Choose a key prefix for a leaf page that will hold items, an array of
+ * nitems full non-pivot tuples.
+ *
+ * curprefix is the key prefix that the tuples would be stored with
+ * otherwise, or NULL if they'd be stored in full.  We only return a new key
+ * prefix if it's an extension of curprefix, which ensures that no tuple
+ * takes up more space with the new prefix than with curprefix, and only if
+ * the page would take up less space overall, counting the larger special
+ * space.  Callers that have worked out that the tuples fit on a page when
+ * stored with curprefix can rely on that.  Otherwise we return curprefix.
+ *
+ * The new key prefix is palloc'd.
+ */
+BTPagePrefix
+_bt_prefix_choose(Relation rel, BTPagePrefix curprefix, IndexTuple *items,
+				  int nitems)
+{
+	uint16		fixedlen;
+	char		varalign;
+	char		cand[BTMaxPrefixSize];
+	int			len = -1;
+	Size		cursize,
+				newsize;
+	BTPagePrefix newprefix;
+
+	if (!BTGetCompressKeyPrefixes(rel) ||
+		!_bt_prefix_layout(rel, &fixedlen, &varalign))
+		return curprefix;
+
+	Assert(curprefix == NULL || (curprefix->btpp_fixedlen == fixedlen &&
+								 curprefix->btpp_varalign == varalign));
+
+	/* Find the longest prefix that all tuples that can have one share */
+	for (int i = 0; i < nitems && len != 0; i++)
+	{
+		BTKeyBytes	kb;
+
+		_bt_prefix_keybytes(items[i], fixedlen, varalign, &kb);
+		if (kb.fixed == NULL)
+			continue;
+
+		if (len < 0)
+		{
+			/* first candidate is all key bytes of first tuple */
+			len = Min(kb.fixedlen, BTMaxPrefixSize);
+			memcpy(cand, kb.fixed, len);
+			if (len == kb.fixedlen && kb.var != NULL)
+			{
+				int			varlen = Min(kb.varlen, BTMaxPrefixSize - len);
+
+				memcpy(cand + len, kb.var, varlen);
+				len += varlen;
+			}
+		}
+		else
+			len = _bt_prefix_match(cand, len, &kb);
+	}
+
+	if (len <= 0)
+		return curprefix;
+	if (curprefix != NULL &&
+		(len <= curprefix->btpp_len ||
+		 memcmp(cand, curprefix->btpp_data, curprefix->btpp_len) != 0))
+		return curprefix;
+
+	/* Is it worth it? */
+	cursize = curprefix ? BTPrefixSpecialSize(curprefix->btpp_len) :
+		MAXALIGN(sizeof(BTPageOpaqueData));
+	newsize = BTPrefixSpecialSize(len);
+	for (int i = 0; i < nitems; i++)
+	{
+		BTKeyBytes	kb;
+		Size		itemsz = IndexTupleSize(items[i]);
+
+		_bt_prefix_keybytes(items[i], fixedlen, varalign, &kb);
+		if (kb.fixed == NULL)
+		{
+			cursize += itemsz;
+			newsize += itemsz;
+			continue;
+		}
+
+		if (curprefix)
+			cursize += MAXALIGN(itemsz -
+								_bt_prefix_match(curprefix->btpp_data,
+												 curprefix->btpp_len, &kb));
+		else
+			cursize += itemsz;
+		newsize += MAXALIGN(itemsz - len);
+	}
+
+	if (newsize >= cursize)
+		return curprefix;
+
+	newprefix = palloc(SizeOfBTPagePrefix(len));
+	newprefix->btpp_len = len;
+	newprefix->btpp_fixedlen = fixedlen;
+	newprefix->btpp_varalign = varalign;
+	memcpy(newprefix->btpp_data, cand, len);
+
+	return newprefix;
+}
+
+/*
+ * Give empty leaf page a key prefix, making its special space larger.
+ *
+ * Page must have been initialized by _bt_pageinit() (which also means that
+ * it doesn't have a key prefix yet).  Caller can set the page's opaque
+ * fields before or after calling here, but BTPageGetOpaque() returns a
+ * different address afterwards.
+ */
+void
+_bt_prefix_setpage(Page page, BTPagePrefix prefix)
+{
+	PageHeader	phdr = (PageHeader) page;
+	BTPageOpaqueData opaque;
+	Size		specialsize = BTPrefixSpecialSize(prefix->btpp_len);
+
+	Assert(PageGetMaxOffsetNumber(page) == 0);
+	Assert(PageGetSpecialSize(page) == MAXALIGN(sizeof(BTPageOpaqueData)));
+	Assert(prefix->btpp_len > 0 && prefix->btpp_len <= BTMaxPrefixSize);
+
+	opaque = *BTPageGetOpaque(page);
+	phdr->pd_special = PageGetPageSize(page) - specialsize;
+	phdr->pd_upper = phdr->pd_special;
+	memset((char *) page + phdr->pd_special, 0, specialsize);
+
+	opaque.btpo_flags |= BTP_HAS_PREFIX;
+	*BTPageGetOpaque(page) = opaque;
+	memcpy(BTPageGetPrefix(page), prefix,
+		   SizeOfBTPagePrefix(prefix->btpp_len));
+}
+
+/*
+ * Take away key prefix from leaf page that has no items apart from its high
+ * key (if any), making its special space the usual size again.
+ *
+ * This is how page deletion leaves a half-dead page, matching what REDO
+ * does.  Only the page header's fields, the high key and the opaque fields
+ * are kept.
+ */
+void
+_bt_prefix_clearpage(Page page)
+{
+	PageHeader	phdr = (PageHeader) page;
+	BTPageOpaqueData opaque = *BTPageGetOpaque(page);
+	Size		pagesize = PageGetPageSize(page);
+	IndexTuple	hikey = NULL;
+	Size		hikeysz = 0;
+	BTItemBuf	hikeybuf;
+
+	Assert(P_HAS_PREFIX(&opaque));
+	Assert(PageGetMaxOffsetNumber(page) <= P_HIKEY);
+
+	if (PageGetMaxOffsetNumber(page) == P_HIKEY)
+	{
+		ItemId		itemid = PageGetItemId(page, P_HIKEY);
+
+		hikeysz = ItemIdGetLength(itemid);
+		memcpy(hikeybuf.data, PageGetItem(page, itemid), hikeysz);
+		hikey = (IndexTuple) hikeybuf.data;
+	}
+
+	memset((char *) page + SizeOfPageHeaderData, 0,
+		   pagesize - SizeOfPageHeaderData);
+	phdr->pd_lower = SizeOfPageHeaderData;
+	phdr->pd_special = pagesize - MAXALIGN(sizeof(BTPageOpaqueData));
+	phdr->pd_upper = phdr->pd_special;
+
+	opaque.btpo_flags &= ~BTP_HAS_PREFIX;
+	*BTPageGetOpaque(page) = opaque;
+
+	if (hikey &&
+		PageAddItem(page, (Item) hikey, hikeysz, P_HIKEY, false,
+					false) == InvalidOffsetNumber)
+		elog(ERROR, "failed to add high key to page without key prefix");
+}
+
+/*
+ * Form the stored version of full tuple itup for leaf page.
+ *
+ * Returns itup itself when it doesn't share any bytes with the page's key
+ * prefix (always the case on pages without one, and for pivot tuples).
+ * Otherwise the stored tuple is formed in caller's buffer.  Sets *itemsz to
+ * the size to pass to PageAddItem() and friends either way.  Only the stored
+ * tuple's size differs from that of itup, so the header of itup still
+ * describes it.
+ */
+IndexTuple
+_bt_prefix_compress(Page page, IndexTuple itup, Size *itemsz, BTItemBuf *buf)
+{
+	Size		size = IndexTupleSize(itup);
+	BTPagePrefix prefix;
+	BTKeyBytes	kb;
+	char	   *src = (char *) itup;
+	char	   *dest = buf->data;
+	Size		hoff;
+	int			skip;
+
+	*itemsz = MAXALIGN(size);
+	if (!P_HAS_PREFIX(BTPageGetOpaque(page)))
+		return itup;
+
+	prefix = BTPageGetPrefix(page);
+	_bt_prefix_keybytes(itup, prefix->btpp_fixedlen, prefix->btpp_varalign,
+						&kb);
+	skip = _bt_prefix_match(prefix->btpp_data, prefix->btpp_len, &kb);
+	if (skip == 0)
+		return itup;
+
+	Assert(size == MAXALIGN(size));
+	hoff = IndexInfoFindDataOffset(itup->t_info);
+	memcpy(dest, src, hoff);
+	dest += hoff;
+	if (skip <= kb.fixedlen)
+		memcpy(dest, src + hoff + skip, size - hoff - skip);
+	else
+	{
+		char	   *vstart = kb.fixed + kb.fixedlen;
+		char	   *vrest = kb.var + (skip - kb.fixedlen);
+
+		/* keep any alignment padding and the varlena header */
+		memcpy(dest, vstart, kb.var - vstart);
+		dest += kb.var - vstart;
+		memcpy(dest, vrest, src + size - vrest);
+	}
+
+	*itemsz = size - skip;
+	return (IndexTuple) buf->data;
+}
+
+/*
+ * Expand the stored tuple at itemid on leaf page into caller's buffer.
+ *
+ * Should only be called through BTPageGetItem(), once it has established
+ * that the tuple was stored without some of its key bytes.
+ */
+IndexTuple
+_bt_prefix_expand(Page page, ItemId itemid, BTItemBuf *buf)
+{
+	IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+	Size		size = IndexTupleSize(itup);
+	Size		storedsz = ItemIdGetLength(itemid);
+	BTPagePrefix prefix;
+	char	   *src = (char *) itup;
+	char	   *dest = buf->data;
+	Size		hoff;
+	int			skip;
+	int			fixedlen;
+
+	if (!P_HAS_PREFIX(BTPageGetOpaque(page)) || storedsz >= size ||
+		size - storedsz > BTPageGetPrefix(page)->btpp_len ||
+		BTreeTupleIsPivot(itup) || IndexTupleHasNulls(itup))
+		ereport(ERROR,
+				(errcode(ERRCODE_INDEX_CORRUPTED),
+				 errmsg_internal("index tuple size %zu does not match item length %zu",
+								 size, storedsz)));
+
+	prefix = BTPageGetPrefix(page);
+	skip = size - storedsz;
+	fixedlen = prefix->btpp_fixedlen;
+	hoff = IndexInfoFindDataOffset(itup->t_info);
+	memcpy(dest, src, hoff);
+
+	if (skip <= fixedlen)
+	{
+		memcpy(dest + hoff, prefix->btpp_data, skip);
+		memcpy(dest + hoff + skip, src + hoff, storedsz - hoff);
+	}
+	else
+	{
+		Size		off = hoff + fixedlen;
+		char	   *vsrc = src + hoff;
+		Size		voff;
+		Size		n;
+
+		/*
+		 * The varlena attribute's alignment padding and header were kept.
+		 * Work out where the header goes the same way as a tuple deformer
+		 * would, by peeking at the first byte.
+		 */
+		memcpy(dest + hoff, prefix->btpp_data, fixedlen);
+		voff = att_align_pointer(off, prefix->btpp_varalign, -1, vsrc);
+		n = voff - off;
+		if (n >= storedsz - hoff)
+			elog(ERROR, "invalid stored index tuple");
+		n += VARATT_IS_1B(vsrc + n) ? VARHDRSZ_SHORT : VARHDRSZ;
+		if (n > storedsz - hoff)
+			elog(ERROR, "invalid stored index tuple");
+
+		memcpy(dest + off, vsrc, n);
+		memcpy(dest + off + n, prefix->btpp_data + fixedlen, skip - fixedlen);
+		memcpy(dest + off + n + (skip - fixedlen), vsrc + n,
+			   storedsz - hoff - n);
+	}
+
+	return (IndexTuple) buf->data;
+}
+
+/*
+ * Find the key bytes of full tuple itup that a key prefix applies to.
+ * Pivot tuples and tuples with NULLs don't have any.
+ */
+static void
+_bt_prefix_keybytes(IndexTuple itup, uint16 fixedlen, char varalign,
+					BTKeyBytes *kb)
+{
+	char	   *tp = (char *) itup;
+	Size		off;
+
+	kb->fixed = NULL;
+	kb->fixedlen = 0;
+	kb->var = NULL;
+	kb->varlen = 0;
+
+	if (BTreeTupleIsPivot(itup) || IndexTupleHasNulls(itup))
+		return;
+
+	off = IndexInfoFindDataOffset(itup->t_info);
+	kb->fixed = tp + off;
+	kb->fixedlen = fixedlen;
+	off += fixedlen;
+
+	if (varalign != '\0')
+	{
+		off = att_align_pointer(off, varalign, -1, tp + off);
+		if (!VARATT_IS_EXTERNAL(tp + off))
+		{
+			Size		hdrsz = VARATT_IS_1B(tp + off) ? VARHDRSZ_SHORT : VARHDRSZ;
+
+			kb->var = tp + off + hdrsz;
+			kb->varlen = VARSIZE_ANY(tp + off) - hdrsz;
+		}
+	}
+}
+
+/*
+ * Return number of leading bytes of prefix (with length len) that kb shares
+ */
+static int
+_bt_prefix_match(const char *prefix, int len, BTKeyBytes *kb)
+{
+	int			n = 0;
+
+	if (kb->fixed == NULL)
+		return 0;
+
+	while (n < len && n < kb->fixedlen && prefix[n] == kb->fixed[n])
+		n++;
+	if (n < kb->fixedlen || kb->var == NULL)
+		return n;
+
+	for (int i = 0; n < len && i < kb->varlen && prefix[n] == kb->var[i]; i++)
+		n++;
+
+	return n;
+}
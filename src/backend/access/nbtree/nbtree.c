@@ -217,11 +217,12 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 	scan->xs_recheck = false;
 
 	/*
-	 * If we have any array keys, initialize them during first call for a
-	 * scan.  We can't do this in btrescan because we don't know the scan
-	 * direction at that time.
+	 * If we have any array or skip keys, initialize them during first call
+	 * for a scan.  We can't do this in btrescan because we don't know the
+	 * scan direction at that time.
 	 */
-	if (so->numArrayKeys && !BTScanPosIsValid(so->currPos))
+	if ((so->numArrayKeys || so->numSkipKeys) &&
+		!BTScanPosIsValid(so->currPos))
 	{
 		/* punt if we have any unsatisfiable array keys */
 		if (so->numArrayKeys < 0)
@@ -273,7 +274,8 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		if (res)
 			break;
 		/* ... otherwise see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, dir));
+	} while ((so->numArrayKeys || so->numSkipKeys) &&
+			 _bt_advance_array_keys(scan, dir));
 
 	return res;
 }
@@ -289,9 +291,9 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 	ItemPointer heapTid;
 
 	/*
-	 * If we have any array keys, initialize them.
+	 * If we have any array or skip keys, initialize them.
 	 */
-	if (so->numArrayKeys)
+	if (so->numArrayKeys || so->numSkipKeys)
 	{
 		/* punt if we have any unsatisfiable array keys */
 		if (so->numArrayKeys < 0)
@@ -331,7 +333,8 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 			}
 		}
 		/* Now see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, ForwardScanDirection));
+	} while ((so->numArrayKeys || so->numSkipKeys) &&
+			 _bt_advance_array_keys(scan, ForwardScanDirection));
 
 	return ntids;
 }
@@ -355,8 +358,12 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so = (BTScanOpaque) palloc(sizeof(BTScanOpaqueData));
 	BTScanPosInvalidate(so->currPos);
 	BTScanPosInvalidate(so->markPos);
+	/* leave room for the keys a skip scan adds on the leading columns */
 	if (scan->numberOfKeys > 0)
-		so->keyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
+		so->keyData = (ScanKey)
+			palloc((scan->numberOfKeys +
+					IndexRelationGetNumberOfKeyAttributes(rel)) *
+				   sizeof(ScanKeyData));
 	else
 		so->keyData = NULL;
 
@@ -364,6 +371,22 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so->numArrayKeys = 0;
 	so->arrayKeys = NULL;
 	so->arrayContext = NULL;
+	so->arrayKeysDone = false;
+	so->redescend = false;
+	so->numSkipKeys = 0;
+
+	/*
+	 * Only indexes that may have compressed posting lists need room for more
+	 * than MaxTIDsPerBTreePage items per page.  _bt_readpage enlarges the
+	 * arrays if it comes across such a page anyway (the reloption might have
+	 * been changed since the page was written).
+	 */
+	so->maxItems = BTGetCompressPostingLists(rel) ?
+		MaxTIDsPerCompressedBTreePage : MaxTIDsPerBTreePage;
+	so->currPos.items = (BTScanPosItem *)
+		palloc(so->maxItems * sizeof(BTScanPosItem));
+	so->markPos.items = (BTScanPosItem *)
+		palloc(so->maxItems * sizeof(BTScanPosItem));
 
 	so->killedItems = NULL;		/* until needed */
 	so->numKilled = 0;
@@ -474,6 +497,8 @@ btendscan(IndexScanDesc scan)
 	if (so->currTuples != NULL)
 		pfree(so->currTuples);
 	/* so->markTuples should not be pfree'd, see btrescan */
+	pfree(so->currPos.items);
+	pfree(so->markPos.items);
 	pfree(so);
 }
 
@@ -502,8 +527,8 @@ btmarkpos(IndexScanDesc scan)
 		so->markItemIndex = -1;
 	}
 
-	/* Also record the current positions of any array keys */
-	if (so->numArrayKeys)
+	/* Also record the current positions of any array or skip keys */
+	if (so->numArrayKeys || so->numSkipKeys)
 		_bt_mark_array_keys(scan);
 }
 
@@ -515,8 +540,8 @@ btrestrpos(IndexScanDesc scan)
 {
 	BTScanOpaque so = (BTScanOpaque) scan->opaque;
 
-	/* Restore the marked positions of any array keys */
-	if (so->numArrayKeys)
+	/* Restore the marked positions of any array or skip keys */
+	if (so->numArrayKeys || so->numSkipKeys)
 		_bt_restore_array_keys(scan);
 
 	if (so->markItemIndex >= 0)
@@ -551,9 +576,7 @@ btrestrpos(IndexScanDesc scan)
 			/* bump pin on mark buffer for assignment to current buffer */
 			if (BTScanPosIsPinned(so->markPos))
 				IncrBufferRefCount(so->markPos.buf);
-			memcpy(&so->currPos, &so->markPos,
-				   offsetof(BTScanPosData, items[1]) +
-				   so->markPos.lastItem * sizeof(BTScanPosItem));
+			BTScanPosCopy(&so->currPos, &so->markPos);
 			if (so->currTuples)
 				memcpy(so->currTuples, so->markTuples,
 					   so->markPos.nextTupleOffset);
@@ -1198,9 +1221,10 @@ backtrack:
 				 offnum = OffsetNumberNext(offnum))
 			{
 				IndexTuple	itup;
+				BTItemBuf	itembuf;
 
-				itup = (IndexTuple) PageGetItem(page,
-												PageGetItemId(page, offnum));
+				itup = BTPageGetItem(page, PageGetItemId(page, offnum),
+									 &itembuf);
 
 				Assert(!BTreeTupleIsPivot(itup));
 				if (!BTreeTupleIsPosting(itup))
@@ -1240,6 +1264,9 @@ backtrack:
 						 * _bt_delitems_vacuum().
 						 */
 						Assert(nremaining < BTreeTupleGetNPosting(itup));
+						/* an expanded itup must outlive itembuf */
+						if (itup == (IndexTuple) itembuf.data)
+							vacposting->itup = CopyIndexTuple(itup);
 						updatable[nupdatable++] = vacposting;
 						nhtidsdead += BTreeTupleGetNPosting(itup) - nremaining;
 					}
@@ -1371,12 +1398,14 @@ btreevacuumposting(BTVacState *vstate, IndexTuple posting,
 {
 	int			live = 0;
 	int			nitem = BTreeTupleGetNPosting(posting);
-	ItemPointer items = BTreeTupleGetPosting(posting);
 	BTVacuumPosting vacposting = NULL;
 
 	for (int i = 0; i < nitem; i++)
 	{
-		if (!vstate->callback(items + i, vstate->callback_state))
+		ItemPointerData item;
+
+		BTreeTupleGetPostingTID(posting, i, &item);
+		if (!vstate->callback(&item, vstate->callback_state))
 		{
 			/* Live table TID */
 			live++;
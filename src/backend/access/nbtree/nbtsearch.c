@@ -571,6 +571,7 @@ _bt_binsrch_posting(BTScanInsert key, Page page, OffsetNumber offnum)
 {
 	IndexTuple	itup;
 	ItemId		itemid;
+	BTItemBuf	itembuf;
 	int			low,
 				high,
 				mid,
@@ -587,7 +588,7 @@ _bt_binsrch_posting(BTScanInsert key, Page page, OffsetNumber offnum)
 	 * to be able to relocate a non-pivot tuple using _bt_binsrch_insert().)
 	 */
 	itemid = PageGetItemId(page, offnum);
-	itup = (IndexTuple) PageGetItem(page, itemid);
+	itup = BTPageGetItem(page, itemid, &itembuf);
 	if (!BTreeTupleIsPosting(itup))
 		return 0;
 
@@ -609,9 +610,11 @@ _bt_binsrch_posting(BTScanInsert key, Page page, OffsetNumber offnum)
 
 	while (high > low)
 	{
+		ItemPointerData midtid;
+
 		mid = low + ((high - low) / 2);
-		res = ItemPointerCompare(key->scantid,
-								 BTreeTupleGetPostingN(itup, mid));
+		BTreeTupleGetPostingTID(itup, mid, &midtid);
+		res = ItemPointerCompare(key->scantid, &midtid);
 
 		if (res > 0)
 			low = mid + 1;
@@ -661,6 +664,7 @@ _bt_compare(Relation rel,
 	TupleDesc	itupdesc = RelationGetDescr(rel);
 	BTPageOpaque opaque = BTPageGetOpaque(page);
 	IndexTuple	itup;
+	BTItemBuf	itembuf;
 	ItemPointer heapTid;
 	ScanKey		scankey;
 	int			ncmpkey;
@@ -678,7 +682,7 @@ _bt_compare(Relation rel,
 	if (!P_ISLEAF(opaque) && offnum == P_FIRSTDATAKEY(opaque))
 		return 1;
 
-	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	itup = BTPageGetItem(page, PageGetItemId(page, offnum), &itembuf);
 	ntupatts = BTreeTupleGetNAtts(itup, rel);
 
 	/*
@@ -870,6 +874,7 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	BTScanInsertData inskey;
 	ScanKey		startKeys[INDEX_MAX_KEYS];
 	ScanKeyData notnullkeys[INDEX_MAX_KEYS];
+	ScanKeyData skipkeys[INDEX_MAX_KEYS];
 	int			keysCount = 0;
 	int			i;
 	bool		status;
@@ -969,7 +974,33 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	 *----------
 	 */
 	strat_total = BTEqualStrategyNumber;
-	if (so->numberOfKeys > 0)
+	if (so->numSkipKeys > 0 && so->skipState != BT_SKIP_AT)
+	{
+		/*
+		 * A skip scan that doesn't know which prefix comes next starts from
+		 * the end of the index, or just beyond the last prefix it visited.
+		 * _bt_readpage takes the prefix from the first tuple it examines.
+		 */
+		if (so->skipState == BT_SKIP_NEXT)
+		{
+			strat_total = ScanDirectionIsForward(dir) ?
+				BTGreaterStrategyNumber : BTLessStrategyNumber;
+			for (i = 0; i < so->numSkipKeys; i++)
+			{
+				ScanKey		skey = &skipkeys[i];
+
+				memcpy(skey, &so->skipKeyTemplates[i], sizeof(ScanKeyData));
+				skey->sk_flags = rel->rd_indoption[i] << SK_BT_INDOPTION_SHIFT;
+				if (so->skipNulls[i])
+					skey->sk_flags |= SK_ISNULL;
+				if (i == so->numSkipKeys - 1)
+					skey->sk_strategy = strat_total;
+				skey->sk_argument = so->skipValues[i];
+				startKeys[keysCount++] = skey;
+			}
+		}
+	}
+	else if (so->numberOfKeys > 0)
 	{
 		AttrNumber	curattr;
 		ScanKey		chosen;
@@ -1527,7 +1558,10 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	OffsetNumber maxoff;
 	int			itemIndex;
 	bool		continuescan;
+	bool		skipadopted;
+	bool		arraynextpage;
 	int			indnatts;
+	BTItemBuf	itembuf;
 
 	/*
 	 * We must have the buffer pinned and locked, but the usual macro can't be
@@ -1548,6 +1582,8 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	}
 
 	continuescan = true;		/* default assumption */
+	skipadopted = false;
+	arraynextpage = false;
 	indnatts = IndexRelationGetNumberOfAttributes(scan->indexRelation);
 	minoff = P_FIRSTDATAKEY(opaque);
 	maxoff = PageGetMaxOffsetNumber(page);
@@ -1575,6 +1611,20 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	/* initialize tuple workspace to empty */
 	so->currPos.nextTupleOffset = 0;
 
+	/*
+	 * Make sure that items[] can hold every TID on the page.  The mark
+	 * position is copied from currPos, so it must be enlarged too.  Any
+	 * items it holds survive the repalloc.
+	 */
+	if (so->maxItems < BTPageGetMaxTIDs(opaque))
+	{
+		so->maxItems = BTPageGetMaxTIDs(opaque);
+		so->currPos.items = (BTScanPosItem *)
+			repalloc(so->currPos.items, so->maxItems * sizeof(BTScanPosItem));
+		so->markPos.items = (BTScanPosItem *)
+			repalloc(so->markPos.items, so->maxItems * sizeof(BTScanPosItem));
+	}
+
 	/*
 	 * Now that the current page has been made consistent, the macro should be
 	 * good.
@@ -1592,6 +1642,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		{
 			ItemId		iid = PageGetItemId(page, offnum);
 			IndexTuple	itup;
+			bool		passes_quals;
 
 			/*
 			 * If the scan specifies not to return killed tuples, then we
@@ -1603,9 +1654,18 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 				continue;
 			}
 
-			itup = (IndexTuple) PageGetItem(page, iid);
+			itup = BTPageGetItem(page, iid, &itembuf);
 
-			if (_bt_checkkeys(scan, itup, indnatts, dir, &continuescan))
+			/* a skip scan looking for its next prefix has found it */
+			if (so->numSkipKeys > 0 && so->skipState != BT_SKIP_AT)
+			{
+				_bt_skip_adopt(scan, itup);
+				skipadopted = true;
+			}
+
+			passes_quals = _bt_checkkeys(scan, itup, indnatts, dir,
+										 &continuescan);
+			if (passes_quals)
 			{
 				/* tuple passes all scan key conditions */
 				if (!BTreeTupleIsPosting(itup))
@@ -1617,29 +1677,58 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 				else
 				{
 					int			tupleOffset;
+					ItemPointerData htid;
 
 					/*
 					 * Set up state to return posting list, and remember first
 					 * TID
 					 */
+					BTreeTupleGetPostingTID(itup, 0, &htid);
 					tupleOffset =
 						_bt_setuppostingitems(so, itemIndex, offnum,
-											  BTreeTupleGetPostingN(itup, 0),
-											  itup);
+											  &htid, itup);
 					itemIndex++;
 					/* Remember additional TIDs */
 					for (int i = 1; i < BTreeTupleGetNPosting(itup); i++)
 					{
+						BTreeTupleGetPostingTID(itup, i, &htid);
 						_bt_savepostingitem(so, itemIndex, offnum,
-											BTreeTupleGetPostingN(itup, i),
-											tupleOffset);
+											&htid, tupleOffset);
 						itemIndex++;
 					}
 				}
 			}
-			/* When !continuescan, there can't be any more matches, so stop */
+			/*
+			 * When !continuescan, there can't be any more matches, so stop;
+			 * unless the next array elements or the next prefix of a skip
+			 * scan can be found without descending the tree again.
+			 */
 			if (!continuescan)
+			{
+				if (_bt_skip_next_on_page(scan, page, &offnum, dir) ||
+					(so->numArrayKeys > 0 &&
+					 _bt_advance_array_keys_page(scan, page, &offnum, dir,
+												 &arraynextpage)))
+				{
+					continuescan = true;
+					if (arraynextpage)
+						break;
+					continue;
+				}
 				break;
+			}
+
+			/*
+			 * If a new prefix's first tuple doesn't match, it may be better
+			 * to descend to its matches than to read our way to them.
+			 */
+			if (skipadopted && !passes_quals &&
+				_bt_skip_redescend(scan, page, dir))
+			{
+				continuescan = false;
+				break;
+			}
+			skipadopted = false;
 
 			offnum = OffsetNumberNext(offnum);
 		}
@@ -1655,7 +1744,8 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		 * only appear on non-pivot tuples on the right sibling page are
 		 * common.
 		 */
-		if (continuescan && !P_RIGHTMOST(opaque))
+		if (continuescan && !P_RIGHTMOST(opaque) && !arraynextpage &&
+			(so->numSkipKeys == 0 || so->skipState == BT_SKIP_AT))
 		{
 			ItemId		iid = PageGetItemId(page, P_HIKEY);
 			IndexTuple	itup = (IndexTuple) PageGetItem(page, iid);
@@ -1663,12 +1753,29 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 
 			truncatt = BTreeTupleGetNAtts(itup, scan->indexRelation);
 			_bt_checkkeys(scan, itup, truncatt, dir, &continuescan);
+
+			/*
+			 * In a skip scan without arrays, a high key with a new prefix
+			 * means that prefix starts on the right sibling, so go on there.
+			 */
+			if (!continuescan && so->numSkipKeys > 0 &&
+				so->numArrayKeys == 0 && truncatt >= so->numSkipKeys &&
+				_bt_skip_compare(scan, itup) != 0)
+			{
+				so->skipState = BT_SKIP_NEXT;
+				continuescan = true;
+			}
+
+			/* likewise if the array keys can move on past the high key */
+			if (!continuescan && so->numArrayKeys > 0 &&
+				_bt_advance_array_keys_hikey(scan, itup, truncatt, dir))
+				continuescan = true;
 		}
 
 		if (!continuescan)
 			so->currPos.moreRight = false;
 
-		Assert(itemIndex <= MaxTIDsPerBTreePage);
+		Assert(itemIndex <= so->maxItems);
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
@@ -1676,7 +1783,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	else
 	{
 		/* load items[] in descending order */
-		itemIndex = MaxTIDsPerBTreePage;
+		itemIndex = so->maxItems;
 
 		offnum = Min(offnum, maxoff);
 
@@ -1711,7 +1818,14 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			else
 				tuple_alive = true;
 
-			itup = (IndexTuple) PageGetItem(page, iid);
+			itup = BTPageGetItem(page, iid, &itembuf);
+
+			/* a skip scan looking for its next prefix has found it */
+			if (so->numSkipKeys > 0 && so->skipState != BT_SKIP_AT)
+			{
+				_bt_skip_adopt(scan, itup);
+				skipadopted = true;
+			}
 
 			passes_quals = _bt_checkkeys(scan, itup, indnatts, dir,
 										 &continuescan);
@@ -1727,6 +1841,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 				else
 				{
 					int			tupleOffset;
+					ItemPointerData htid;
 
 					/*
 					 * Set up state to return posting list, and remember first
@@ -1739,34 +1854,55 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 					 * associated with the same posting list tuple.
 					 */
 					itemIndex--;
+					BTreeTupleGetPostingTID(itup, 0, &htid);
 					tupleOffset =
 						_bt_setuppostingitems(so, itemIndex, offnum,
-											  BTreeTupleGetPostingN(itup, 0),
-											  itup);
+											  &htid, itup);
 					/* Remember additional TIDs */
 					for (int i = 1; i < BTreeTupleGetNPosting(itup); i++)
 					{
 						itemIndex--;
+						BTreeTupleGetPostingTID(itup, i, &htid);
 						_bt_savepostingitem(so, itemIndex, offnum,
-											BTreeTupleGetPostingN(itup, i),
-											tupleOffset);
+											&htid, tupleOffset);
 					}
 				}
 			}
 			if (!continuescan)
 			{
+				/* see forward scan case */
+				if (_bt_skip_next_on_page(scan, page, &offnum, dir) ||
+					(so->numArrayKeys > 0 &&
+					 _bt_advance_array_keys_page(scan, page, &offnum, dir,
+												 &arraynextpage)))
+				{
+					continuescan = true;
+					if (arraynextpage)
+						break;
+					continue;
+				}
+
 				/* there can't be any more matches, so stop */
 				so->currPos.moreLeft = false;
 				break;
 			}
 
+			/* see forward scan case */
+			if (skipadopted && !passes_quals &&
+				_bt_skip_redescend(scan, page, dir))
+			{
+				so->currPos.moreLeft = false;
+				break;
+			}
+			skipadopted = false;
+
 			offnum = OffsetNumberPrev(offnum);
 		}
 
 		Assert(itemIndex >= 0);
 		so->currPos.firstItem = itemIndex;
-		so->currPos.lastItem = MaxTIDsPerBTreePage - 1;
-		so->currPos.itemIndex = MaxTIDsPerBTreePage - 1;
+		so->currPos.lastItem = so->maxItems - 1;
+		so->currPos.itemIndex = so->maxItems - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
@@ -1891,9 +2027,7 @@ _bt_steppage(IndexScanDesc scan, ScanDirection dir)
 		/* bump pin on current buffer for assignment to mark buffer */
 		if (BTScanPosIsPinned(so->currPos))
 			IncrBufferRefCount(so->currPos.buf);
-		memcpy(&so->markPos, &so->currPos,
-			   offsetof(BTScanPosData, items[1]) +
-			   so->currPos.lastItem * sizeof(BTScanPosItem));
+		BTScanPosCopy(&so->markPos, &so->currPos);
 		if (so->markTuples)
 			memcpy(so->markTuples, so->currTuples,
 				   so->currPos.nextTupleOffset);
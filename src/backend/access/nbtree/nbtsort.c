@@ -239,6 +239,7 @@ typedef struct BTPageState
 	IndexTuple	btps_lowkey;	/* page's strict lower bound pivot tuple */
 	OffsetNumber btps_lastoff;	/* last item offset loaded */
 	Size		btps_lastextra; /* last item's extra posting list space */
+	int			btps_ntids;		/* number of heap TIDs on leaf page */
 	uint32		btps_level;		/* tree level (0 = leaf) */
 	Size		btps_full;		/* "full" if less than this much free space */
 	struct BTPageState *btps_next;	/* link to parent level, if any */
@@ -710,6 +711,7 @@ _bt_pagestate(BTWriteState *wstate, uint32 level)
 	/* initialize lastoff so first item goes into P_FIRSTKEY */
 	state->btps_lastoff = P_HIKEY;
 	state->btps_lastextra = 0;
+	state->btps_ntids = 0;
 	state->btps_level = level;
 	/* set "full" threshold based on level.  See notes at head of file. */
 	if (level > 0)
@@ -844,6 +846,7 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup,
 	Size		pgspc;
 	Size		itupsz;
 	bool		isleaf;
+	int			itupntids;
 
 	/*
 	 * This is a handy place to check for cancel interrupts during the btree
@@ -862,6 +865,7 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup,
 	itupsz = MAXALIGN(itupsz);
 	/* Leaf case has slightly different rules due to suffix truncation */
 	isleaf = (state->btps_level == 0);
+	itupntids = BTreeTupleIsPosting(itup) ? BTreeTupleGetNPosting(itup) : 1;
 
 	/*
 	 * Check whether the new item can fit on a btree page on current level at
@@ -899,10 +903,18 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup,
 	 * don't have the minimum number of items yet.  (Note that we deliberately
 	 * assume that suffix truncation neither enlarges nor shrinks new high key
 	 * when applying soft limit, except when last tuple has a posting list.)
+	 *
+	 * Compressed posting lists can also make a leaf page reach the limit on
+	 * the number of heap TIDs on a page (MaxTIDsPerCompressedBTreePage) before
+	 * it's full.  Posting lists are small enough that two items never exceed
+	 * it.
 	 */
 	Assert(last_truncextra == 0 || isleaf);
 	if (pgspc < itupsz + (isleaf ? MAXALIGN(sizeof(ItemPointerData)) : 0) ||
-		(pgspc + last_truncextra < state->btps_full && last_off > P_FIRSTKEY))
+		(pgspc + last_truncextra < state->btps_full && last_off > P_FIRSTKEY) ||
+		(isleaf && state->btps_ntids + itupntids >
+		 MaxTIDsPerCompressedBTreePage &&
+		 last_off > P_FIRSTKEY))
 	{
 		/*
 		 * Finish off the page and write it out.
@@ -931,6 +943,13 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup,
 		oitup = (IndexTuple) PageGetItem(opage, ii);
 		_bt_sortaddtup(npage, ItemIdGetLength(ii), oitup, P_FIRSTKEY,
 					   !isleaf);
+		if (isleaf)
+		{
+			state->btps_ntids = BTreeTupleIsPosting(oitup) ?
+				BTreeTupleGetNPosting(oitup) : 1;
+			if (BTreeTupleIsCompressedPosting(oitup))
+				BTPageGetOpaque(npage)->btpo_flags |= BTP_HAS_COMPRESSED;
+		}
 
 		/*
 		 * Move 'last' into the high key position on opage.  _bt_blnewpage()
@@ -1061,6 +1080,13 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup,
 	last_off = OffsetNumberNext(last_off);
 	_bt_sortaddtup(npage, itupsz, itup, last_off,
 				   !isleaf && last_off == P_FIRSTKEY);
+	if (isleaf)
+	{
+		state->btps_ntids += itupntids;
+		Assert(state->btps_ntids <= MaxTIDsPerCompressedBTreePage);
+		if (BTreeTupleIsCompressedPosting(itup))
+			BTPageGetOpaque(npage)->btpo_flags |= BTP_HAS_COMPRESSED;
+	}
 
 	state->btps_page = npage;
 	state->btps_blkno = nblkno;
@@ -1090,7 +1116,8 @@ _bt_sort_dedup_finish_pending(BTWriteState *wstate, BTPageState *state,
 		/* form a tuple with a posting list */
 		postingtuple = _bt_form_posting(dstate->base,
 										dstate->htids,
-										dstate->nhtids);
+										dstate->nhtids,
+										dstate->compress);
 		/* Calculate posting list overhead */
 		truncextra = IndexTupleSize(postingtuple) -
 			BTreeTupleGetPostingOffset(postingtuple);
@@ -1315,6 +1342,8 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 
 		dstate = (BTDedupState) palloc(sizeof(BTDedupStateData));
 		dstate->deduplicate = true; /* unused */
+		dstate->compress = BTGetCompressPostingLists(wstate->index) &&
+			wstate->heap->rd_rel->relam == HEAP_TABLE_AM_OID;
 		dstate->nmaxitems = 0;	/* unused */
 		dstate->maxpostingsize = 0; /* set later */
 		/* Metadata about base tuple of current pending posting list */
@@ -1647,15 +1676,23 @@ _bt_begin_parallel(BTBuildState *buildstate, bool isconcurrent, int request)
 	/* Save leader state now that it's clear build will be parallel */
 	buildstate->btleader = btleader;
 
-	/* Join heap scan ourselves */
-	if (leaderparticipates)
-		_bt_leader_participate_as_worker(buildstate);
+	/* Tell participants how many of them will take part in the sort */
+	tuplesort_launched_shared(sharedsort, btleader->nparticipanttuplesorts);
+	if (sharedsort2)
+		tuplesort_launched_shared(sharedsort2,
+								  btleader->nparticipanttuplesorts);
 
 	/*
-	 * Caller needs to wait for all launched workers when we return.  Make
-	 * sure that the failure-to-start case will not hang forever.
+	 * Caller needs to wait for all launched workers when we return, and
+	 * participants wait for one another while merging their sorted output.
+	 * Make sure that the failure-to-start case will not hang forever, before
+	 * the leader starts participating.
 	 */
 	WaitForParallelWorkersToAttach(pcxt);
+
+	/* Join heap scan ourselves */
+	if (leaderparticipates)
+		_bt_leader_participate_as_worker(buildstate);
 }
 
 /*
@@ -51,6 +51,8 @@ typedef struct
 	int			rightspace;		/* space available for items on right page */
 	int			olddataitemstotal;	/* space taken by old items */
 	Size		minfirstrightsz;	/* smallest firstright size */
+	Size		prefixsz;		/* most that a tuple's stored size can be
+								 * short of its full size */
 
 	/* candidate split point data */
 	int			maxsplits;		/* maximum number of splits */
@@ -78,9 +80,11 @@ static void _bt_interval_edges(FindSplitData *state,
 							   SplitPoint **leftinterval, SplitPoint **rightinterval);
 static inline int _bt_split_penalty(FindSplitData *state, SplitPoint *split);
 static inline IndexTuple _bt_split_lastleft(FindSplitData *state,
-											SplitPoint *split);
+											SplitPoint *split,
+											BTItemBuf *buf);
 static inline IndexTuple _bt_split_firstright(FindSplitData *state,
-											  SplitPoint *split);
+											  SplitPoint *split,
+											  BTItemBuf *buf);
 
 
 /*
@@ -154,10 +158,14 @@ _bt_findsplitloc(Relation rel,
 	opaque = BTPageGetOpaque(origpage);
 	maxoff = PageGetMaxOffsetNumber(origpage);
 
-	/* Total free space available on a btree page, after fixed overhead */
+	/*
+	 * Total free space available on a btree page, after fixed overhead.  A
+	 * leaf page with a key prefix has a larger special space, and so will
+	 * both halves (see _bt_split()).
+	 */
 	leftspace = rightspace =
 		PageGetPageSize(origpage) - SizeOfPageHeaderData -
-		MAXALIGN(sizeof(BTPageOpaqueData));
+		PageGetSpecialSize(origpage);
 
 	/* The right page will have the same high key as the old page */
 	if (!P_RIGHTMOST(opaque))
@@ -183,6 +191,9 @@ _bt_findsplitloc(Relation rel,
 	state.rightspace = rightspace;
 	state.olddataitemstotal = olddataitemstotal;
 	state.minfirstrightsz = SIZE_MAX;
+	state.prefixsz = 0;
+	if (P_HAS_PREFIX(opaque))
+		state.prefixsz = MAXALIGN(BTPageGetPrefix(origpage)->btpp_len);
 	state.newitemoff = newitemoff;
 
 	/* newitem cannot be a posting list item */
@@ -482,9 +493,10 @@ _bt_recsplitloc(FindSplitData *state,
 		{
 			ItemId		itemid;
 			IndexTuple	newhighkey;
+			BTItemBuf	itembuf;
 
 			itemid = PageGetItemId(state->origpage, firstrightoff);
-			newhighkey = (IndexTuple) PageGetItem(state->origpage, itemid);
+			newhighkey = BTPageGetItem(state->origpage, itemid, &itembuf);
 
 			if (BTreeTupleIsPosting(newhighkey))
 				postingsz = IndexTupleSize(newhighkey) -
@@ -518,10 +530,13 @@ _bt_recsplitloc(FindSplitData *state,
 	 * only when it looks like it will make an appreciable difference.
 	 * (Posting lists are the only case where truncation will typically make
 	 * the final high key far smaller than firstright, so being a bit more
-	 * precise there noticeably improves the balance of free space.)
+	 * precise there noticeably improves the balance of free space.)  On a
+	 * leaf page with a key prefix, the new high key is formed from the full
+	 * firstright tuple, which can be up to prefixsz larger than the stored
+	 * one.
 	 */
 	if (state->is_leaf)
-		leftfree -= (int16) (firstrightsz +
+		leftfree -= (int16) (firstrightsz + state->prefixsz +
 							 MAXALIGN(sizeof(ItemPointerData)) -
 							 postingsz);
 	else
@@ -638,6 +653,7 @@ _bt_afternewitemoff(FindSplitData *state, OffsetNumber maxoff,
 	int16		nkeyatts;
 	ItemId		itemid;
 	IndexTuple	tup;
+	BTItemBuf	itembuf;
 	int			keepnatts;
 
 	Assert(state->is_leaf && !state->is_rightmost);
@@ -691,7 +707,7 @@ _bt_afternewitemoff(FindSplitData *state, OffsetNumber maxoff,
 	if (state->newitemoff > maxoff)
 	{
 		itemid = PageGetItemId(state->origpage, maxoff);
-		tup = (IndexTuple) PageGetItem(state->origpage, itemid);
+		tup = BTPageGetItem(state->origpage, itemid, &itembuf);
 		keepnatts = _bt_keep_natts_fast(state->rel, tup, state->newitem);
 
 		if (keepnatts > 1 && keepnatts <= nkeyatts)
@@ -717,7 +733,7 @@ _bt_afternewitemoff(FindSplitData *state, OffsetNumber maxoff,
 	 * still split in the middle of the page on average.
 	 */
 	itemid = PageGetItemId(state->origpage, OffsetNumberPrev(state->newitemoff));
-	tup = (IndexTuple) PageGetItem(state->origpage, itemid);
+	tup = BTPageGetItem(state->origpage, itemid, &itembuf);
 	/* Do cheaper test first */
 	if (BTreeTupleIsPosting(tup) ||
 		!_bt_adjacenthtid(&tup->t_tid, &state->newitem->t_tid))
@@ -941,6 +957,8 @@ _bt_strategy(FindSplitData *state, SplitPoint *leftpage,
 {
 	IndexTuple	leftmost,
 				rightmost;
+	BTItemBuf	leftmostbuf,
+				rightmostbuf;
 	SplitPoint *leftinterval,
 			   *rightinterval;
 	int			perfectpenalty;
@@ -964,8 +982,8 @@ _bt_strategy(FindSplitData *state, SplitPoint *leftpage,
 	 * current split interval
 	 */
 	_bt_interval_edges(state, &leftinterval, &rightinterval);
-	leftmost = _bt_split_lastleft(state, leftinterval);
-	rightmost = _bt_split_firstright(state, rightinterval);
+	leftmost = _bt_split_lastleft(state, leftinterval, &leftmostbuf);
+	rightmost = _bt_split_firstright(state, rightinterval, &rightmostbuf);
 
 	/*
 	 * If initial split interval can produce a split point that will at least
@@ -984,8 +1002,8 @@ _bt_strategy(FindSplitData *state, SplitPoint *leftpage,
 	 * Use the leftmost split's lastleft tuple and the rightmost split's
 	 * firstright tuple to assess every possible split.
 	 */
-	leftmost = _bt_split_lastleft(state, leftpage);
-	rightmost = _bt_split_firstright(state, rightpage);
+	leftmost = _bt_split_lastleft(state, leftpage, &leftmostbuf);
+	rightmost = _bt_split_firstright(state, rightpage, &rightmostbuf);
 
 	/*
 	 * If page (including new item) has many duplicates but is not entirely
@@ -1137,6 +1155,8 @@ _bt_split_penalty(FindSplitData *state, SplitPoint *split)
 {
 	IndexTuple	lastleft;
 	IndexTuple	firstright;
+	BTItemBuf	lastleftbuf,
+				firstrightbuf;
 
 	if (!state->is_leaf)
 	{
@@ -1151,8 +1171,8 @@ _bt_split_penalty(FindSplitData *state, SplitPoint *split)
 		return MAXALIGN(ItemIdGetLength(itemid)) + sizeof(ItemIdData);
 	}
 
-	lastleft = _bt_split_lastleft(state, split);
-	firstright = _bt_split_firstright(state, split);
+	lastleft = _bt_split_lastleft(state, split, &lastleftbuf);
+	firstright = _bt_split_firstright(state, split, &firstrightbuf);
 
 	return _bt_keep_natts_fast(state->rel, lastleft, firstright);
 }
@@ -1161,7 +1181,7 @@ _bt_split_penalty(FindSplitData *state, SplitPoint *split)
  * Subroutine to get a lastleft IndexTuple for a split point
  */
 static inline IndexTuple
-_bt_split_lastleft(FindSplitData *state, SplitPoint *split)
+_bt_split_lastleft(FindSplitData *state, SplitPoint *split, BTItemBuf *buf)
 {
 	ItemId		itemid;
 
@@ -1170,14 +1190,14 @@ _bt_split_lastleft(FindSplitData *state, SplitPoint *split)
 
 	itemid = PageGetItemId(state->origpage,
 						   OffsetNumberPrev(split->firstrightoff));
-	return (IndexTuple) PageGetItem(state->origpage, itemid);
+	return BTPageGetItem(state->origpage, itemid, buf);
 }
 
 /*
  * Subroutine to get a firstright IndexTuple for a split point
  */
 static inline IndexTuple
-_bt_split_firstright(FindSplitData *state, SplitPoint *split)
+_bt_split_firstright(FindSplitData *state, SplitPoint *split, BTItemBuf *buf)
 {
 	ItemId		itemid;
 
@@ -1185,5 +1205,5 @@ _bt_split_firstright(FindSplitData *state, SplitPoint *split)
 		return state->newitem;
 
 	itemid = PageGetItemId(state->origpage, split->firstrightoff);
-	return (IndexTuple) PageGetItem(state->origpage, itemid);
+	return BTPageGetItem(state->origpage, itemid, buf);
 }
@@ -45,6 +45,20 @@ static int	_bt_sort_array_elements(IndexScanDesc scan, ScanKey skey,
 									bool reverse,
 									Datum *elems, int nelems);
 static int	_bt_compare_array_elements(const void *a, const void *b, void *arg);
+static void _bt_preprocess_skip_keys(IndexScanDesc scan, int numSkipKeys);
+static void _bt_skip_copy_value(IndexScanDesc scan, int i, Datum *dest,
+								bool *destnull, Datum value, bool isnull);
+static void _bt_skip_set_key(ScanKey skey, ScanKey template, Datum value,
+							 bool isnull);
+static void _bt_skip_set_keys(IndexScanDesc scan, Datum *values, bool *nulls);
+static bool _bt_skip_before_key(IndexScanDesc scan, ScanKey key, Datum datum,
+								ScanDirection dir);
+static FmgrInfo *_bt_key_orderproc(IndexScanDesc scan, ScanKey key);
+static bool _bt_advance_array_elems(IndexScanDesc scan, ScanDirection dir);
+static int	_bt_array_prefix_len(IndexScanDesc scan);
+static int	_bt_array_compare(IndexScanDesc scan, IndexTuple tuple,
+							  int tupnatts, int prefixlen, ScanDirection dir);
+static void _bt_sync_array_keys(IndexScanDesc scan);
 static bool _bt_compare_scankey_args(IndexScanDesc scan, ScanKey op,
 									 ScanKey leftarg, ScanKey rightarg,
 									 bool *result);
@@ -202,6 +216,19 @@ _bt_freestack(BTStack stack)
  * array keys, it's sufficient to find the extreme element value and replace
  * the whole array with that scalar value.
  *
+ * This is also where we decide to do a skip scan.  If the scan has keys, but
+ * none on the first index column(s), we put an "=" key for each of those
+ * leading columns at the front of so->arrayKeyData.  Their values are
+ * filled in as the scan finds each distinct prefix in turn, which lets every
+ * primitive index scan descend straight to the matches for the later keys,
+ * rather than reading the whole index.  The keys on the later columns also
+ * become required keys that can end each primitive scan.  This is only done
+ * if the caller allows it, which the executor does for the scans that the
+ * planner marked as skip scans (see btcostestimate).  Parallel scans
+ * don't do this, since the workers would have to agree on the prefixes, and
+ * neither do system catalog scans, which are keyed on their leading columns
+ * anyway and had better not do catalog lookups of their own here.
+ *
  * Note: the reason we need so->arrayKeyData, rather than just scribbling
  * on scan->keyData, is that callers are permitted to call btrescan without
  * supplying a new set of scankey data.
@@ -210,13 +237,17 @@ void
 _bt_preprocess_array_keys(IndexScanDesc scan)
 {
 	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
 	int			numberOfKeys = scan->numberOfKeys;
-	int16	   *indoption = scan->indexRelation->rd_indoption;
+	int16	   *indoption = rel->rd_indoption;
 	int			numArrayKeys;
+	int			numSkipKeys;
 	ScanKey		cur;
 	int			i;
 	MemoryContext oldContext;
 
+	so->numSkipKeys = 0;
+
 	/* Quick check to see if there are any array keys */
 	numArrayKeys = 0;
 	for (i = 0; i < numberOfKeys; i++)
@@ -236,8 +267,14 @@ _bt_preprocess_array_keys(IndexScanDesc scan)
 		}
 	}
 
+	/* Count the leading index columns that have no keys at all */
+	numSkipKeys = 0;
+	if (scan->xs_allow_skip && numberOfKeys > 0 &&
+		scan->parallel_scan == NULL && !IsCatalogRelation(rel))
+		numSkipKeys = scan->keyData[0].sk_attno - 1;
+
 	/* Quit if nothing to do. */
-	if (numArrayKeys == 0)
+	if (numArrayKeys == 0 && numSkipKeys == 0)
 	{
 		so->numArrayKeys = 0;
 		so->arrayKeyData = NULL;
@@ -257,11 +294,29 @@ _bt_preprocess_array_keys(IndexScanDesc scan)
 
 	oldContext = MemoryContextSwitchTo(so->arrayContext);
 
-	/* Create modifiable copy of scan->keyData in the workspace context */
-	so->arrayKeyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
-	memcpy(so->arrayKeyData,
+	/*
+	 * Create modifiable copy of scan->keyData in the workspace context, after
+	 * room for the skip keys
+	 */
+	so->arrayKeyData = (ScanKey) palloc((numSkipKeys + numberOfKeys) *
+										sizeof(ScanKeyData));
+	memcpy(so->arrayKeyData + numSkipKeys,
 		   scan->keyData,
-		   scan->numberOfKeys * sizeof(ScanKeyData));
+		   numberOfKeys * sizeof(ScanKeyData));
+
+	/* Set up state used to move on to new keys within a primitive scan */
+	so->orderProcs = (FmgrInfo *)
+		palloc0(IndexRelationGetNumberOfKeyAttributes(rel) * sizeof(FmgrInfo));
+	so->orderProcTypes = (Oid *)
+		palloc0(IndexRelationGetNumberOfKeyAttributes(rel) * sizeof(Oid));
+	so->arrayKeysDone = false;
+	so->redescend = false;
+	so->markArrayKeysDone = false;
+	so->markRedescend = false;
+
+	/* Set up the skip keys, if any; they get their values later */
+	if (numSkipKeys > 0)
+		_bt_preprocess_skip_keys(scan, numSkipKeys);
 
 	/* Allocate space for per-array data in the workspace context */
 	so->arrayKeys = (BTArrayKeyInfo *) palloc0(numArrayKeys * sizeof(BTArrayKeyInfo));
@@ -280,7 +335,7 @@ _bt_preprocess_array_keys(IndexScanDesc scan)
 		int			num_nonnulls;
 		int			j;
 
-		cur = &so->arrayKeyData[i];
+		cur = &so->arrayKeyData[numSkipKeys + i];
 		if (!(cur->sk_flags & SK_SEARCHARRAY))
 			continue;
 
@@ -360,7 +415,7 @@ _bt_preprocess_array_keys(IndexScanDesc scan)
 		/*
 		 * And set up the BTArrayKeyInfo data.
 		 */
-		so->arrayKeys[numArrayKeys].scan_key = i;
+		so->arrayKeys[numArrayKeys].scan_key = numSkipKeys + i;
 		so->arrayKeys[numArrayKeys].num_elems = num_elems;
 		so->arrayKeys[numArrayKeys].elem_values = elem_values;
 		numArrayKeys++;
@@ -371,6 +426,55 @@ _bt_preprocess_array_keys(IndexScanDesc scan)
 	MemoryContextSwitchTo(oldContext);
 }
 
+/*
+ * _bt_preprocess_skip_keys() -- Set up the keys for a skip scan
+ *
+ * Each of the first numSkipKeys index columns gets an "=" key using its
+ * opclass's equality operator, placed at the front of so->arrayKeyData.
+ * We keep a pristine copy of each key, since _bt_preprocess_keys scribbles
+ * on arrayKeyData when a prefix value is NULL.  Caller has switched into
+ * so->arrayContext.
+ */
+static void
+_bt_preprocess_skip_keys(IndexScanDesc scan, int numSkipKeys)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	int			i;
+
+	so->skipKeyTemplates = (ScanKey) palloc(numSkipKeys * sizeof(ScanKeyData));
+	for (i = 0; i < numSkipKeys; i++)
+	{
+		Oid			opfamily = rel->rd_opfamily[i];
+		Oid			opcintype = rel->rd_opcintype[i];
+		Oid			eq_op;
+
+		eq_op = get_opfamily_member(opfamily, opcintype, opcintype,
+									BTEqualStrategyNumber);
+		if (!OidIsValid(eq_op))
+			elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+				 BTEqualStrategyNumber, opcintype, opcintype, opfamily);
+		ScanKeyEntryInitialize(&so->skipKeyTemplates[i],
+							   0,
+							   i + 1,
+							   BTEqualStrategyNumber,
+							   opcintype,
+							   rel->rd_indcollation[i],
+							   get_opcode(eq_op),
+							   (Datum) 0);
+	}
+	memcpy(so->arrayKeyData, so->skipKeyTemplates,
+		   numSkipKeys * sizeof(ScanKeyData));
+
+	so->skipValues = (Datum *) palloc0(numSkipKeys * sizeof(Datum));
+	so->skipNulls = (bool *) palloc0(numSkipKeys * sizeof(bool));
+	so->skipMarkValues = (Datum *) palloc0(numSkipKeys * sizeof(Datum));
+	so->skipMarkNulls = (bool *) palloc0(numSkipKeys * sizeof(bool));
+	so->skipState = BT_SKIP_FIRST;
+	so->skipMarkState = BT_SKIP_FIRST;
+	so->numSkipKeys = numSkipKeys;
+}
+
 /*
  * _bt_find_extreme_element() -- get least or greatest array element
  *
@@ -539,6 +643,12 @@ _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir)
 			curArrayKey->cur_elem = 0;
 		skey->sk_argument = curArrayKey->elem_values[curArrayKey->cur_elem];
 	}
+
+	so->arrayKeysDone = false;
+	so->redescend = false;
+
+	/* A skip scan starts by looking for the first prefix in the index */
+	so->skipState = BT_SKIP_FIRST;
 }
 
 /*
@@ -546,9 +656,54 @@ _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir)
  *
  * Returns true if there is another set of values to consider, false if not.
  * On true result, the scankeys are initialized with the next set of values.
+ *
+ * In a skip scan the prefix columns come before all the arrays, so the arrays
+ * are cycled through for each prefix.  Once they wrap around, the next
+ * primitive scan looks for the next prefix.  That gives up only if looking
+ * for a prefix found nothing at all.
+ *
+ * _bt_readpage may already have moved the keys on (see
+ * _bt_advance_array_keys_page), in which case it tells us whether the next
+ * primitive scan should use them as they are, or whether the scan is over.
  */
 bool
 _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	bool		found;
+
+	if (so->redescend)
+	{
+		Assert(so->numSkipKeys == 0 || so->skipState == BT_SKIP_AT);
+		so->redescend = false;
+		return true;
+	}
+	if (so->arrayKeysDone)
+		return false;
+
+	found = _bt_advance_array_elems(scan, dir);
+
+	/* advance parallel scan */
+	if (scan->parallel_scan != NULL)
+		_bt_parallel_advance_array_keys(scan);
+
+	if (!found && so->numSkipKeys > 0 && so->skipState == BT_SKIP_AT)
+	{
+		so->skipState = BT_SKIP_NEXT;
+		found = true;
+	}
+
+	return found;
+}
+
+/*
+ * _bt_advance_array_elems() -- Step the array keys to their next elements
+ *
+ * Returns false if they all wrapped around.  Only so->arrayKeyData is
+ * updated.
+ */
+static bool
+_bt_advance_array_elems(IndexScanDesc scan, ScanDirection dir)
 {
 	BTScanOpaque so = (BTScanOpaque) scan->opaque;
 	bool		found = false;
@@ -594,10 +749,6 @@ _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir)
 			break;
 	}
 
-	/* advance parallel scan */
-	if (scan->parallel_scan != NULL)
-		_bt_parallel_advance_array_keys(scan);
-
 	return found;
 }
 
@@ -618,6 +769,17 @@ _bt_mark_array_keys(IndexScanDesc scan)
 
 		curArrayKey->mark_elem = curArrayKey->cur_elem;
 	}
+
+	if (so->numSkipKeys > 0 && so->skipState != BT_SKIP_FIRST)
+	{
+		for (i = 0; i < so->numSkipKeys; i++)
+			_bt_skip_copy_value(scan, i, &so->skipMarkValues[i],
+								&so->skipMarkNulls[i],
+								so->skipValues[i], so->skipNulls[i]);
+	}
+	so->skipMarkState = so->skipState;
+	so->markArrayKeysDone = so->arrayKeysDone;
+	so->markRedescend = so->redescend;
 }
 
 /*
@@ -647,6 +809,18 @@ _bt_restore_array_keys(IndexScanDesc scan)
 		}
 	}
 
+	so->arrayKeysDone = so->markArrayKeysDone;
+	so->redescend = so->markRedescend;
+
+	/* Likewise for the prefix of a skip scan; just assume it changed */
+	if (so->numSkipKeys > 0)
+	{
+		if (so->skipMarkState != BT_SKIP_FIRST)
+			_bt_skip_set_keys(scan, so->skipMarkValues, so->skipMarkNulls);
+		so->skipState = so->skipMarkState;
+		changed = true;
+	}
+
 	/*
 	 * If we changed any keys, we must redo _bt_preprocess_keys.  That might
 	 * sound like overkill, but in cases with multiple keys per index column
@@ -660,14 +834,653 @@ _bt_restore_array_keys(IndexScanDesc scan)
 	}
 }
 
+/*
+ * _bt_skip_copy_value() -- Store a value of skipped column i
+ *
+ * By-reference values are copied into so->arrayContext, and whatever *dest
+ * held before is freed.
+ */
+static void
+_bt_skip_copy_value(IndexScanDesc scan, int i, Datum *dest, bool *destnull,
+					Datum value, bool isnull)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute att = TupleDescAttr(RelationGetDescr(scan->indexRelation), i);
+	Datum		old = *dest;
+	bool		oldnull = *destnull;
+
+	if (isnull)
+		*dest = (Datum) 0;
+	else if (att->attbyval)
+		*dest = value;
+	else
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(so->arrayContext);
+
+		*dest = datumCopy(value, false, att->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+	*destnull = isnull;
+
+	if (!att->attbyval && !oldnull && DatumGetPointer(old) != NULL)
+		pfree(DatumGetPointer(old));
+}
+
+/*
+ * _bt_skip_set_key() -- Point a skip key at a prefix value
+ */
+static void
+_bt_skip_set_key(ScanKey skey, ScanKey template, Datum value, bool isnull)
+{
+	int			flags = skey->sk_flags & (SK_BT_REQFWD | SK_BT_REQBKWD |
+										  SK_BT_DESC | SK_BT_NULLS_FIRST);
+
+	memcpy(skey, template, sizeof(ScanKeyData));
+	skey->sk_flags |= flags;
+	if (isnull)
+	{
+		/* this is what _bt_fix_scankey_strategy would make of IS NULL */
+		skey->sk_flags |= (SK_ISNULL | SK_SEARCHNULL);
+		skey->sk_subtype = InvalidOid;
+		skey->sk_collation = InvalidOid;
+		skey->sk_argument = (Datum) 0;
+	}
+	else
+		skey->sk_argument = value;
+}
+
+/*
+ * _bt_skip_set_keys() -- Make the skip keys match the given prefix
+ *
+ * The skip keys in so->arrayKeyData are updated, and so are those in the
+ * preprocessed so->keyData (where they also come first, being the only keys
+ * on their columns), so that the current primitive scan can carry on with
+ * the new prefix.
+ */
+static void
+_bt_skip_set_keys(IndexScanDesc scan, Datum *values, bool *nulls)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	int			i;
+
+	for (i = 0; i < so->numSkipKeys; i++)
+	{
+		_bt_skip_copy_value(scan, i, &so->skipValues[i], &so->skipNulls[i],
+							values[i], nulls[i]);
+		_bt_skip_set_key(&so->arrayKeyData[i], &so->skipKeyTemplates[i],
+						 so->skipValues[i], so->skipNulls[i]);
+		if (so->qual_ok && i < so->numberOfKeys)
+		{
+			Assert(so->keyData[i].sk_attno == i + 1);
+			_bt_skip_set_key(&so->keyData[i], &so->skipKeyTemplates[i],
+							 so->skipValues[i], so->skipNulls[i]);
+		}
+	}
+}
+
+/*
+ * _bt_skip_adopt() -- Make the prefix of tuple the skip scan's current one
+ */
+void
+_bt_skip_adopt(IndexScanDesc scan, IndexTuple tuple)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	TupleDesc	itupdesc = RelationGetDescr(scan->indexRelation);
+	Datum		values[INDEX_MAX_KEYS];
+	bool		nulls[INDEX_MAX_KEYS];
+	int			i;
+
+	for (i = 0; i < so->numSkipKeys; i++)
+		values[i] = index_getattr(tuple, i + 1, itupdesc, &nulls[i]);
+	_bt_skip_set_keys(scan, values, nulls);
+	so->skipState = BT_SKIP_AT;
+}
+
+/*
+ * _bt_skip_compare() -- Compare the prefix of tuple with the current one
+ *
+ * Returns <0, 0 or >0 as the tuple's prefix comes before, equals or comes
+ * after so->skipValues in index order.  The tuple must not have any of the
+ * prefix columns truncated away.
+ */
+int
+_bt_skip_compare(IndexScanDesc scan, IndexTuple tuple)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	int			i;
+
+	for (i = 0; i < so->numSkipKeys; i++)
+	{
+		int16		indoption = rel->rd_indoption[i];
+		Datum		datum;
+		bool		isNull;
+		int32		result;
+
+		datum = index_getattr(tuple, i + 1, itupdesc, &isNull);
+		if (isNull && so->skipNulls[i])
+			continue;
+		if (isNull || so->skipNulls[i])
+		{
+			/* NULLs sort first or last, regardless of DESC */
+			if (indoption & INDOPTION_NULLS_FIRST)
+				return isNull ? -1 : 1;
+			return isNull ? 1 : -1;
+		}
+
+		result = DatumGetInt32(FunctionCall2Coll(index_getprocinfo(rel, i + 1,
+																   BTORDER_PROC),
+												 rel->rd_indcollation[i],
+												 datum, so->skipValues[i]));
+		if (result != 0)
+		{
+			if (indoption & INDOPTION_DESC)
+				INVERT_COMPARE_RESULT(result);
+			return result;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * _bt_skip_next_on_page() -- Look for the next prefix on the current page
+ *
+ * Called by _bt_readpage when the tuple at *offnum ended the current prefix's
+ * matches.  If a tuple with a later prefix (in scan direction) is on the same
+ * page, that's where the next prefix's tuples start: point *offnum there and
+ * return true, so that _bt_readpage can take it on from that tuple without a
+ * new descent.  This keeps a skip scan over many small prefixes about as
+ * cheap as reading the index in full.  Otherwise return false.
+ *
+ * We leave this to _bt_advance_array_keys when there are array keys, since
+ * they have to be cycled through for each prefix.
+ */
+bool
+_bt_skip_next_on_page(IndexScanDesc scan, Page page, OffsetNumber *offnum,
+					  ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTPageOpaque opaque = BTPageGetOpaque(page);
+	OffsetNumber minoff = P_FIRSTDATAKEY(opaque);
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+	OffsetNumber low,
+				high;
+	BTItemBuf	itembuf;
+
+	if (so->numSkipKeys == 0 || so->numArrayKeys != 0 ||
+		so->skipState != BT_SKIP_AT)
+		return false;
+
+	/* Does the tuple that stopped us already have a new prefix? */
+	if (_bt_skip_compare(scan,
+							 BTPageGetItem(page, PageGetItemId(page, *offnum),
+										   &itembuf)) != 0)
+	{
+		so->skipState = BT_SKIP_NEXT;
+		return true;
+	}
+
+	/*
+	 * Binary search for the first tuple beyond the current prefix, in scan
+	 * direction.  All tuples with the current prefix are adjacent.
+	 */
+	if (ScanDirectionIsForward(dir))
+	{
+		low = *offnum + 1;
+		high = maxoff + 1;
+		while (low < high)
+		{
+			OffsetNumber mid = low + ((high - low) / 2);
+
+			if (_bt_skip_compare(scan,
+									 BTPageGetItem(page, PageGetItemId(page, mid),
+												   &itembuf)) != 0)
+				high = mid;
+			else
+				low = mid + 1;
+		}
+		if (low > maxoff)
+			return false;
+		*offnum = low;
+	}
+	else
+	{
+		low = minoff;
+		high = *offnum;
+		while (low < high)
+		{
+			OffsetNumber mid = low + ((high - low) / 2);
+
+			if (_bt_skip_compare(scan,
+									 BTPageGetItem(page, PageGetItemId(page, mid),
+												   &itembuf)) != 0)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		if (low == minoff)
+			return false;
+		*offnum = low - 1;
+	}
+
+	so->skipState = BT_SKIP_NEXT;
+	return true;
+}
+
+/*
+ * _bt_skip_redescend() -- Should we descend again to the current prefix?
+ *
+ * Called by _bt_readpage when the first tuple it examined with a newly found
+ * prefix didn't match the later keys.  If the prefix's tuples continue past
+ * the end of this page, it's probably cheaper to descend to the first match
+ * than to read through to it.  Sets so->redescend and returns true if so.
+ */
+bool
+_bt_skip_redescend(IndexScanDesc scan, Page page, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTPageOpaque opaque = BTPageGetOpaque(page);
+	OffsetNumber last;
+	BTItemBuf	itembuf;
+
+	Assert(so->skipState == BT_SKIP_AT);
+
+	if (ScanDirectionIsForward(dir))
+	{
+		if (P_RIGHTMOST(opaque))
+			return false;
+		last = PageGetMaxOffsetNumber(page);
+	}
+	else
+	{
+		if (P_LEFTMOST(opaque))
+			return false;
+		last = P_FIRSTDATAKEY(opaque);
+	}
+
+	if (_bt_skip_compare(scan,
+							 BTPageGetItem(page, PageGetItemId(page, last),
+										   &itembuf)) != 0)
+		return false;
+
+	so->redescend = true;
+	return true;
+}
+
+/*
+ * _bt_skip_before_key() -- Is datum still ahead of a failed "=" key?
+ *
+ * In a skip scan, a primitive scan may start before the first tuple that
+ * matches the required "=" keys on the later columns, since it may have been
+ * positioned by the prefix alone.  Such tuples must not end the primitive
+ * scan the way tuples beyond the matches do.  We tell the two apart with
+ * the column's ORDER proc; without one, we just assume the former.
+ */
+static bool
+_bt_skip_before_key(IndexScanDesc scan, ScanKey key, Datum datum,
+					ScanDirection dir)
+{
+	FmgrInfo   *orderproc = _bt_key_orderproc(scan, key);
+	int32		result;
+
+	if (orderproc == NULL)
+		return true;
+
+	result = DatumGetInt32(FunctionCall2Coll(orderproc, key->sk_collation,
+											 datum, key->sk_argument));
+	if (key->sk_flags & SK_BT_DESC)
+		INVERT_COMPARE_RESULT(result);
+
+	return ScanDirectionIsForward(dir) ? result < 0 : result > 0;
+}
+
+/*
+ * _bt_key_orderproc() -- Get the ORDER proc that goes with a "=" scan key
+ *
+ * That is, the 3-way comparison of the column's opclass input type with the
+ * key's type.  Returns NULL if the opfamily doesn't have one.
+ */
+static FmgrInfo *
+_bt_key_orderproc(IndexScanDesc scan, ScanKey key)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	int			i = key->sk_attno - 1;
+	FmgrInfo   *orderproc = &so->orderProcs[i];
+	Oid			righttype;
+
+	righttype = OidIsValid(key->sk_subtype) ? key->sk_subtype :
+		rel->rd_opcintype[i];
+	if (!OidIsValid(orderproc->fn_oid) || so->orderProcTypes[i] != righttype)
+	{
+		RegProcedure cmp_proc;
+
+		cmp_proc = get_opfamily_proc(rel->rd_opfamily[i],
+									 rel->rd_opcintype[i],
+									 righttype,
+									 BTORDER_PROC);
+		if (!RegProcedureIsValid(cmp_proc))
+			return NULL;
+		fmgr_info_cxt(cmp_proc, orderproc, so->arrayContext);
+		so->orderProcTypes[i] = righttype;
+	}
+
+	return orderproc;
+}
+
+/*
+ * _bt_array_prefix_len() -- Can array keys be advanced within a page?
+ *
+ * That's possible when the array keys are all among the "=" keys on a
+ * leading prefix of the index columns, one key per column, since then the
+ * scan's position relative to each set of array elements can be told from
+ * the prefix of an index tuple alone.  Returns the length of that prefix,
+ * or 0 if it's not possible.
+ *
+ * Each array key must also be the only input key on its column, since
+ * _bt_preprocess_keys may otherwise have dropped some other key as redundant
+ * given the current array element only.  Skip scans and parallel scans have
+ * their own ways of moving on, so they don't do this.
+ */
+static int
+_bt_array_prefix_len(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	int			prefixlen;
+	int			i;
+
+	if (so->numArrayKeys <= 0 || so->numSkipKeys > 0 ||
+		scan->parallel_scan != NULL || !so->qual_ok)
+		return 0;
+
+	for (prefixlen = 0; prefixlen < so->numberOfKeys; prefixlen++)
+	{
+		ScanKey		key = &so->keyData[prefixlen];
+
+		if (key->sk_attno != prefixlen + 1 ||
+			key->sk_strategy != BTEqualStrategyNumber ||
+			(key->sk_flags & (SK_ISNULL | SK_ROW_HEADER)) ||
+			(prefixlen + 1 < so->numberOfKeys &&
+			 key[1].sk_attno == key->sk_attno) ||
+			_bt_key_orderproc(scan, key) == NULL)
+			break;
+		Assert(key->sk_flags & SK_BT_REQFWD);
+	}
+	for (i = prefixlen; i < so->numberOfKeys; i++)
+	{
+		if (so->keyData[i].sk_flags & SK_SEARCHARRAY)
+			return 0;
+	}
+
+	for (i = 0; i < so->numArrayKeys; i++)
+	{
+		int			ikey = so->arrayKeys[i].scan_key;
+		AttrNumber	attno = so->arrayKeyData[ikey].sk_attno;
+
+		if ((ikey > 0 && so->arrayKeyData[ikey - 1].sk_attno == attno) ||
+			(ikey + 1 < scan->numberOfKeys &&
+			 so->arrayKeyData[ikey + 1].sk_attno == attno))
+			return 0;
+	}
+
+	return prefixlen;
+}
+
+/*
+ * _bt_array_compare() -- Compare a tuple's prefix with the "=" keys
+ *
+ * Returns >0 if the tuple comes after the keys' matches in scan direction,
+ * <0 if before them, and 0 if it has the keys' values (as far as its
+ * untruncated attributes go).
+ */
+static int
+_bt_array_compare(IndexScanDesc scan, IndexTuple tuple, int tupnatts,
+				  int prefixlen, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	TupleDesc	itupdesc = RelationGetDescr(scan->indexRelation);
+	int			i;
+
+	for (i = 0; i < prefixlen && i < tupnatts; i++)
+	{
+		ScanKey		key = &so->keyData[i];
+		Datum		datum;
+		bool		isNull;
+		int32		result;
+
+		datum = index_getattr(tuple, i + 1, itupdesc, &isNull);
+		if (isNull)
+			result = (key->sk_flags & SK_BT_NULLS_FIRST) ? -1 : 1;
+		else
+		{
+			result = DatumGetInt32(FunctionCall2Coll(_bt_key_orderproc(scan, key),
+													 key->sk_collation,
+													 datum, key->sk_argument));
+			if (key->sk_flags & SK_BT_DESC)
+				INVERT_COMPARE_RESULT(result);
+		}
+
+		if (result != 0)
+			return ScanDirectionIsForward(dir) ? result : -result;
+	}
+
+	return 0;
+}
+
+/*
+ * _bt_sync_array_keys() -- Copy the current array elements into so->keyData
+ *
+ * Only valid when _bt_array_prefix_len() says so, since then each array
+ * key's column has just that one preprocessed key.
+ */
+static void
+_bt_sync_array_keys(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	int			i;
+
+	for (i = 0; i < so->numArrayKeys; i++)
+	{
+		ScanKey		skey = &so->arrayKeyData[so->arrayKeys[i].scan_key];
+
+		Assert(so->keyData[skey->sk_attno - 1].sk_attno == skey->sk_attno);
+		so->keyData[skey->sk_attno - 1].sk_argument = skey->sk_argument;
+	}
+}
+
+/*
+ * _bt_advance_array_keys_page() -- Move on to later array elements in place
+ *
+ * Called by _bt_readpage when the tuple at *offnum ended the primitive scan
+ * for the current array elements.  Rather than descending the tree again
+ * for the next elements, advance the array keys past any elements that this
+ * tuple is already beyond, and carry on from the first tuple on the page
+ * that could match them: returns true after pointing *offnum at it.  If no
+ * tuple on this page can, but the sibling page in scan direction might,
+ * sets *nextpage and returns true as well.  This makes a scan of a long,
+ * dense IN list about as cheap as reading the range of the index it covers.
+ *
+ * Returns false if the primitive scan should end after all.  We set
+ * so->arrayKeysDone if no more array elements can match, or so->redescend
+ * if we already stepped to this page for the current elements and came up
+ * short, so that the next primitive scan descends to them.
+ */
+bool
+_bt_advance_array_keys_page(IndexScanDesc scan, Page page,
+							OffsetNumber *offnum, ScanDirection dir,
+							bool *nextpage)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTPageOpaque opaque = BTPageGetOpaque(page);
+	OffsetNumber minoff = P_FIRSTDATAKEY(opaque);
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+	int			natts = IndexRelationGetNumberOfAttributes(scan->indexRelation);
+	int			prefixlen;
+	IndexTuple	itup;
+	BTItemBuf	itembuf;
+	bool		behind;
+	OffsetNumber low,
+				high;
+
+	*nextpage = false;
+	prefixlen = _bt_array_prefix_len(scan);
+	if (prefixlen == 0)
+		return false;
+
+	/* Step past all the elements that this tuple is already beyond */
+	itup = BTPageGetItem(page, PageGetItemId(page, *offnum), &itembuf);
+	behind = (_bt_array_compare(scan, itup, natts, prefixlen, dir) < 0);
+	if (!behind)
+	{
+		do
+		{
+			if (!_bt_advance_array_elems(scan, dir))
+			{
+				so->arrayKeysDone = true;
+				_bt_sync_array_keys(scan);
+				return false;
+			}
+			_bt_sync_array_keys(scan);
+		} while (_bt_array_compare(scan, itup, natts, prefixlen, dir) > 0);
+	}
+
+	/*
+	 * Binary search for the first tuple, in scan direction, that isn't before
+	 * the new elements' matches.  The tuples before *offnum are all behind
+	 * us.
+	 */
+	if (ScanDirectionIsForward(dir))
+	{
+		low = *offnum;
+		high = maxoff + 1;
+		while (low < high)
+		{
+			OffsetNumber mid = low + ((high - low) / 2);
+
+			itup = BTPageGetItem(page, PageGetItemId(page, mid), &itembuf);
+			if (_bt_array_compare(scan, itup, natts, prefixlen, dir) >= 0)
+				high = mid;
+			else
+				low = mid + 1;
+		}
+		if (low <= maxoff)
+		{
+			*offnum = low;
+			return true;
+		}
+	}
+	else
+	{
+		low = minoff;
+		high = *offnum + 1;
+		while (low < high)
+		{
+			OffsetNumber mid = low + ((high - low) / 2);
+
+			itup = BTPageGetItem(page, PageGetItemId(page, mid), &itembuf);
+			if (_bt_array_compare(scan, itup, natts, prefixlen, dir) >= 0)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		if (low > minoff)
+		{
+			*offnum = low - 1;
+			return true;
+		}
+	}
+
+	/* The matches, if there are any, must be beyond this page */
+	if (ScanDirectionIsForward(dir) ? P_RIGHTMOST(opaque) : P_LEFTMOST(opaque))
+	{
+		so->arrayKeysDone = true;
+		return false;
+	}
+	if (behind)
+	{
+		so->redescend = true;
+		return false;
+	}
+
+	if (ScanDirectionIsForward(dir))
+	{
+		IndexTuple	hikey;
+		int			truncatt;
+
+		/* Elements before the high key would have had their matches here */
+		hikey = (IndexTuple) PageGetItem(page, PageGetItemId(page, P_HIKEY));
+		truncatt = BTreeTupleGetNAtts(hikey, scan->indexRelation);
+		while (_bt_array_compare(scan, hikey, truncatt, prefixlen, dir) > 0)
+		{
+			if (!_bt_advance_array_elems(scan, dir))
+			{
+				so->arrayKeysDone = true;
+				_bt_sync_array_keys(scan);
+				return false;
+			}
+			_bt_sync_array_keys(scan);
+		}
+	}
+
+	*nextpage = true;
+	return true;
+}
+
+/*
+ * _bt_advance_array_keys_hikey() -- Move on to the right sibling instead?
+ *
+ * Called by _bt_readpage when the high key says a forward scan can stop,
+ * having read the rest of the page.  That's not so if the array keys were
+ * advanced on this page to elements beyond the high key.  And if the high
+ * key is beyond the current elements, we can advance the array keys to the
+ * first elements that aren't before it, whose matches can only be on the
+ * right sibling or later, just as _bt_advance_array_keys_page does.
+ *
+ * Returns true if the scan should go on to the right sibling.
+ */
+bool
+_bt_advance_array_keys_hikey(IndexScanDesc scan, IndexTuple hikey,
+							 int tupnatts, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	int			prefixlen = _bt_array_prefix_len(scan);
+	int			result;
+
+	Assert(ScanDirectionIsForward(dir));
+
+	if (prefixlen == 0)
+		return false;
+
+	result = _bt_array_compare(scan, hikey, tupnatts, prefixlen, dir);
+	if (result == 0)
+		return false;			/* a later key failed */
+
+	while (result > 0)
+	{
+		if (!_bt_advance_array_elems(scan, dir))
+		{
+			so->arrayKeysDone = true;
+			_bt_sync_array_keys(scan);
+			return false;
+		}
+		_bt_sync_array_keys(scan);
+		result = _bt_array_compare(scan, hikey, tupnatts, prefixlen, dir);
+	}
+
+	return true;
+}
+
 
 /*
  *	_bt_preprocess_keys() -- Preprocess scan keys
  *
  * The given search-type keys (in scan->keyData[] or so->arrayKeyData[])
  * are copied to so->keyData[] with possible transformation.
- * scan->numberOfKeys is the number of input keys, so->numberOfKeys gets
- * the number of output keys (possibly less, never greater).
+ * scan->numberOfKeys is the number of input keys, plus so->numSkipKeys in a
+ * skip scan; so->numberOfKeys gets the number of output keys (possibly less,
+ * never greater).
  *
  * The output keys are marked with additional sk_flags bits beyond the
  * system-standard bits supplied by the caller.  The DESC and NULLS_FIRST
@@ -749,7 +1562,7 @@ void
 _bt_preprocess_keys(IndexScanDesc scan)
 {
 	BTScanOpaque so = (BTScanOpaque) scan->opaque;
-	int			numberOfKeys = scan->numberOfKeys;
+	int			numberOfKeys = scan->numberOfKeys + so->numSkipKeys;
 	int16	   *indoption = scan->indexRelation->rd_indoption;
 	int			new_numberOfKeys;
 	int			numberOfEqualCols;
@@ -1424,6 +2237,16 @@ _bt_checkkeys(IndexScanDesc scan, IndexTuple tuple, int tupnatts,
 					continue;	/* tuple satisfies this qual */
 			}
 
+			/*
+			 * In a skip scan, a non-null tuple may just not have reached the
+			 * nulls that an IS NULL key on a later column wants yet.
+			 */
+			if (so->numSkipKeys > 0 && key->sk_attno > so->numSkipKeys &&
+				(key->sk_flags & SK_SEARCHNULL) &&
+				((key->sk_flags & SK_BT_NULLS_FIRST) ?
+				 ScanDirectionIsBackward(dir) : ScanDirectionIsForward(dir)))
+				return false;
+
 			/*
 			 * Tuple fails this qual.  If it's a required qual for the current
 			 * scan direction, then we can conclude no further tuples will
@@ -1496,8 +2319,14 @@ _bt_checkkeys(IndexScanDesc scan, IndexTuple tuple, int tupnatts,
 			 * Note: because we stop the scan as soon as any required equality
 			 * qual fails, it is critical that equality quals be used for the
 			 * initial positioning in _bt_first() when they are available. See
-			 * comments in _bt_first().
+			 * comments in _bt_first().  A skip scan's primitive scans can
+			 * start short of the matches for such quals, though.
 			 */
+			if (so->numSkipKeys > 0 && key->sk_attno > so->numSkipKeys &&
+				key->sk_strategy == BTEqualStrategyNumber &&
+				(key->sk_flags & (SK_BT_REQFWD | SK_BT_REQBKWD)) &&
+				_bt_skip_before_key(scan, key, datum, dir))
+				return false;
 			if ((key->sk_flags & SK_BT_REQFWD) &&
 				ScanDirectionIsForward(dir))
 				*continuescan = false;
@@ -1733,6 +2562,7 @@ _bt_killitems(IndexScanDesc scan)
 	int			numKilled = so->numKilled;
 	bool		killedsomething = false;
 	bool		droppedpin PG_USED_FOR_ASSERTS_ONLY;
+	BTItemBuf	itembuf;
 
 	Assert(BTScanPosIsValid(so->currPos));
 
@@ -1791,7 +2621,7 @@ _bt_killitems(IndexScanDesc scan)
 		while (offnum <= maxoff)
 		{
 			ItemId		iid = PageGetItemId(page, offnum);
-			IndexTuple	ituple = (IndexTuple) PageGetItem(page, iid);
+			IndexTuple	ituple = BTPageGetItem(page, iid, &itembuf);
 			bool		killtuple = false;
 
 			if (BTreeTupleIsPosting(ituple))
@@ -1816,9 +2646,10 @@ _bt_killitems(IndexScanDesc scan)
 				 */
 				for (j = 0; j < nposting; j++)
 				{
-					ItemPointer item = BTreeTupleGetPostingN(ituple, j);
+					ItemPointerData item;
 
-					if (!ItemPointerEquals(item, &kitem->heapTid))
+					BTreeTupleGetPostingTID(ituple, j, &item);
+					if (!ItemPointerEquals(&item, &kitem->heapTid))
 						break;	/* out of posting list loop */
 
 					/*
@@ -2115,7 +2946,11 @@ btoptions(Datum reloptions, bool validate)
 		{"vacuum_cleanup_index_scale_factor", RELOPT_TYPE_REAL,
 		offsetof(BTOptions, vacuum_cleanup_index_scale_factor)},
 		{"deduplicate_items", RELOPT_TYPE_BOOL,
-		offsetof(BTOptions, deduplicate_items)}
+		offsetof(BTOptions, deduplicate_items)},
+		{"compress_posting_lists", RELOPT_TYPE_BOOL,
+		offsetof(BTOptions, compress_posting_lists)},
+		{"compress_key_prefixes", RELOPT_TYPE_BOOL,
+		offsetof(BTOptions, compress_key_prefixes)}
 	};
 
 	return (bytea *) build_reloptions(reloptions, validate,
@@ -2474,6 +3309,7 @@ _bt_check_natts(Relation rel, bool heapkeyspace, Page page, OffsetNumber offnum)
 	int16		nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
 	BTPageOpaque opaque = BTPageGetOpaque(page);
 	IndexTuple	itup;
+	BTItemBuf	itembuf;
 	int			tupnatts;
 
 	/*
@@ -2493,7 +3329,7 @@ _bt_check_natts(Relation rel, bool heapkeyspace, Page page, OffsetNumber offnum)
 	StaticAssertStmt(BT_OFFSET_MASK >= INDEX_MAX_KEYS,
 					 "BT_OFFSET_MASK can't fit INDEX_MAX_KEYS");
 
-	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	itup = BTPageGetItem(page, PageGetItemId(page, offnum), &itembuf);
 	tupnatts = BTreeTupleGetNAtts(itup, rel);
 
 	/* !heapkeyspace indexes do not support deduplication */
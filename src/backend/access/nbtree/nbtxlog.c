@@ -199,6 +199,10 @@ btree_xlog_insert(bool isleaf, bool ismeta, bool posting,
 						newitem,
 						nposting;
 			uint16		postingoff;
+			BTItemBuf	opostingbuf,
+						newitembuf;
+			Size		npostingsz,
+						newitemsz;
 
 			/*
 			 * A posting list split occurred during leaf page insertion.  WAL
@@ -215,19 +219,28 @@ btree_xlog_insert(bool isleaf, bool ismeta, bool posting,
 			datalen -= sizeof(uint16);
 
 			itemid = PageGetItemId(page, OffsetNumberPrev(xlrec->offnum));
-			oposting = (IndexTuple) PageGetItem(page, itemid);
+			oposting = BTPageGetItem(page, itemid, &opostingbuf);
 
 			/* Use mutable, aligned newitem copy in _bt_swap_posting() */
 			Assert(isleaf && postingoff > 0);
 			newitem = CopyIndexTuple((IndexTuple) datapos);
 			nposting = _bt_swap_posting(newitem, oposting, postingoff);
 
-			/* Replace existing posting list with post-split version */
-			memcpy(oposting, nposting, MAXALIGN(IndexTupleSize(nposting)));
+			/*
+			 * Replace existing posting list with post-split version.  Both
+			 * are stored with the same part of the page's key prefix left
+			 * out, if any.
+			 */
+			nposting = _bt_prefix_compress(page, nposting, &npostingsz,
+										   &opostingbuf);
+			Assert(npostingsz == ItemIdGetLength(itemid));
+			memcpy(PageGetItem(page, itemid), nposting, npostingsz);
 
 			/* Insert "final" new item (not orignewitem from WAL stream) */
 			Assert(IndexTupleSize(newitem) == datalen);
-			if (PageAddItem(page, (Item) newitem, datalen, xlrec->offnum,
+			newitem = _bt_prefix_compress(page, newitem, &newitemsz,
+										  &newitembuf);
+			if (PageAddItem(page, (Item) newitem, newitemsz, xlrec->offnum,
 							false, false) == InvalidOffsetNumber)
 				elog(PANIC, "failed to add posting split new item");
 		}
@@ -286,21 +299,52 @@ btree_xlog_split(bool newitemonleft, XLogReaderState *record)
 	if (!isleaf)
 		_bt_clear_incomplete_split(record, 3);
 
-	/* Reconstruct right (new) sibling page from scratch */
-	rbuf = XLogInitBufferForRedo(record, 1);
-	datapos = XLogRecGetBlockData(record, 1, &datalen);
-	rpage = (Page) BufferGetPage(rbuf);
+	/*
+	 * Reconstruct right (new) sibling page from scratch, unless it was logged
+	 * as a full-page image (which is how a right page with a key prefix is
+	 * logged)
+	 */
+	if (XLogRecBlockImageApply(record, 1))
+	{
+		if (XLogReadBufferForRedo(record, 1, &rbuf) != BLK_RESTORED)
+			elog(ERROR, "failed to restore right page after split");
+		rpage = (Page) BufferGetPage(rbuf);
+	}
+	else
+	{
+		rbuf = XLogInitBufferForRedo(record, 1);
+		rpage = (Page) BufferGetPage(rbuf);
+		datapos = XLogRecGetBlockData(record, 1, &datalen);
+
+		_bt_pageinit(rpage, BufferGetPageSize(rbuf));
+		ropaque = BTPageGetOpaque(rpage);
 
-	_bt_pageinit(rpage, BufferGetPageSize(rbuf));
-	ropaque = BTPageGetOpaque(rpage);
+		ropaque->btpo_prev = origpagenumber;
+		ropaque->btpo_next = spagenumber;
+		ropaque->btpo_level = xlrec->level;
+		ropaque->btpo_flags = isleaf ? BTP_LEAF : 0;
+		ropaque->btpo_cycleid = 0;
 
-	ropaque->btpo_prev = origpagenumber;
-	ropaque->btpo_next = spagenumber;
-	ropaque->btpo_level = xlrec->level;
-	ropaque->btpo_flags = isleaf ? BTP_LEAF : 0;
-	ropaque->btpo_cycleid = 0;
+		_bt_restore_page(rpage, datapos, datalen);
 
-	_bt_restore_page(rpage, datapos, datalen);
+		/* Right page may have been given some compressed posting lists */
+		if (isleaf)
+		{
+			OffsetNumber maxoff = PageGetMaxOffsetNumber(rpage);
+
+			for (OffsetNumber off = P_FIRSTDATAKEY(ropaque); off <= maxoff; off++)
+			{
+				IndexTuple	itup = (IndexTuple) PageGetItem(rpage,
+															PageGetItemId(rpage, off));
+
+				if (BTreeTupleIsCompressedPosting(itup))
+				{
+					ropaque->btpo_flags |= BTP_HAS_COMPRESSED;
+					break;
+				}
+			}
+		}
+	}
 
 	PageSetLSN(rpage, lsn);
 	MarkBufferDirty(rbuf);
@@ -424,7 +468,8 @@ btree_xlog_split(bool newitemonleft, XLogReaderState *record)
 		PageRestoreTempPage(leftpage, origpage);
 
 		/* Fix opaque fields */
-		oopaque->btpo_flags = BTP_INCOMPLETE_SPLIT;
+		oopaque->btpo_flags = BTP_INCOMPLETE_SPLIT |
+			(oopaque->btpo_flags & BTP_HAS_COMPRESSED);
 		if (isleaf)
 			oopaque->btpo_flags |= BTP_LEAF;
 		oopaque->btpo_next = rightpagenumber;
@@ -480,9 +525,12 @@ btree_xlog_dedup(XLogReaderState *record)
 		BTDedupState state;
 		BTDedupInterval *intervals;
 		Page		newpage;
+		BTItemBuf	itembufs[2];
+		int			curbuf = 0;
 
 		state = (BTDedupState) palloc(sizeof(BTDedupStateData));
 		state->deduplicate = true;	/* unused */
+		state->compress = xlrec->compress;
 		state->nmaxitems = 0;	/* unused */
 		/* Conservatively use larger maxpostingsize than primary */
 		state->maxpostingsize = BTMaxItemSize(page);
@@ -516,10 +564,14 @@ btree_xlog_dedup(XLogReaderState *record)
 			 offnum = OffsetNumberNext(offnum))
 		{
 			ItemId		itemid = PageGetItemId(page, offnum);
-			IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+			IndexTuple	itup = BTPageGetItem(page, itemid, &itembufs[curbuf]);
 
+			/* base tuple stays in its buffer, as in _bt_dedup_pass() */
 			if (offnum == minoff)
+			{
 				_bt_dedup_start_pending(state, itup, offnum);
+				curbuf = 1 - curbuf;
+			}
 			else if (state->nintervals < xlrec->nintervals &&
 					 state->baseoff == intervals[state->nintervals].baseoff &&
 					 state->nitems < intervals[state->nintervals].nitems)
@@ -531,6 +583,7 @@ btree_xlog_dedup(XLogReaderState *record)
 			{
 				_bt_dedup_finish_pending(newpage, state);
 				_bt_dedup_start_pending(state, itup, offnum);
+				curbuf = 1 - curbuf;
 			}
 		}
 
@@ -561,13 +614,15 @@ btree_xlog_updates(Page page, OffsetNumber *updatedoffsets,
 {
 	BTVacuumPosting vacposting;
 	IndexTuple	origtuple;
+	IndexTuple	updated;
 	ItemId		itemid;
 	Size		itemsz;
+	BTItemBuf	itembuf;
 
 	for (int i = 0; i < nupdated; i++)
 	{
 		itemid = PageGetItemId(page, updatedoffsets[i]);
-		origtuple = (IndexTuple) PageGetItem(page, itemid);
+		origtuple = BTPageGetItem(page, itemid, &itembuf);
 
 		vacposting = palloc(offsetof(BTVacuumPostingData, deletetids) +
 							updates->ndeletedtids * sizeof(uint16));
@@ -580,10 +635,11 @@ btree_xlog_updates(Page page, OffsetNumber *updatedoffsets,
 
 		_bt_update_posting(vacposting);
 
-		/* Overwrite updated version of tuple */
-		itemsz = MAXALIGN(IndexTupleSize(vacposting->itup));
+		/* Overwrite updated version of tuple, as primary stored it */
+		updated = _bt_prefix_compress(page, vacposting->itup, &itemsz,
+									  &itembuf);
 		if (!PageIndexTupleOverwrite(page, updatedoffsets[i],
-									 (Item) vacposting->itup, itemsz))
+									 (Item) updated, itemsz))
 			elog(PANIC, "failed to update partially dead item");
 
 		pfree(vacposting->itup);
@@ -1123,4 +1179,12 @@ btree_mask(char *pagedata, BlockNumber blkno)
 	 */
 	maskopaq->btpo_flags &= ~BTP_SPLIT_END;
 	maskopaq->btpo_cycleid = 0;
+
+	/*
+	 * BTP_HAS_COMPRESSED only needs to be set whenever there are compressed
+	 * posting lists on the page.  Replay of a page split sets it on the right
+	 * sibling based on the page contents, which the original page split
+	 * doesn't bother to do.
+	 */
+	maskopaq->btpo_flags &= ~BTP_HAS_COMPRESSED;
 }
@@ -48,7 +48,9 @@ btree_desc(StringInfo buf, XLogReaderState *record)
 			{
 				xl_btree_dedup *xlrec = (xl_btree_dedup *) rec;
 
-				appendStringInfo(buf, "nintervals %u", xlrec->nintervals);
+				appendStringInfo(buf, "nintervals %u; compress %c",
+								 xlrec->nintervals,
+								 xlrec->compress ? 'T' : 'F');
 				break;
 			}
 		case XLOG_BTREE_VACUUM:
@@ -264,17 +264,32 @@ XLogRecGetBlockRefInfo(XLogReaderState *record, bool pretty,
 					else
 						method = "unknown";
 
-					appendStringInfo(buf,
-									 " (FPW%s); hole: offset: %u, length: %u, "
-									 "compression saved: %u, method: %s",
-									 XLogRecBlockImageApply(record, block_id) ?
-									 "" : " for WAL verification",
-									 XLogRecGetBlock(record, block_id)->hole_offset,
-									 XLogRecGetBlock(record, block_id)->hole_length,
-									 BLCKSZ -
-									 XLogRecGetBlock(record, block_id)->hole_length -
-									 XLogRecGetBlock(record, block_id)->bimg_len,
-									 method);
+					/*
+					 * Images compressed as a group share one stream, held by
+					 * the first image of the group.
+					 */
+					if ((bimg_info & BKPIMAGE_COMPRESS_GROUP) != 0)
+						appendStringInfo(buf,
+										 " (FPW%s); hole: offset: %u, length: %u, "
+										 "grouped, stream length: %u, method: %s",
+										 XLogRecBlockImageApply(record, block_id) ?
+										 "" : " for WAL verification",
+										 XLogRecGetBlock(record, block_id)->hole_offset,
+										 XLogRecGetBlock(record, block_id)->hole_length,
+										 XLogRecGetBlock(record, block_id)->bimg_len,
+										 method);
+					else
+						appendStringInfo(buf,
+										 " (FPW%s); hole: offset: %u, length: %u, "
+										 "compression saved: %u, method: %s",
+										 XLogRecBlockImageApply(record, block_id) ?
+										 "" : " for WAL verification",
+										 XLogRecGetBlock(record, block_id)->hole_offset,
+										 XLogRecGetBlock(record, block_id)->hole_length,
+										 BLCKSZ -
+										 XLogRecGetBlock(record, block_id)->hole_length -
+										 XLogRecGetBlock(record, block_id)->bimg_len,
+										 method);
 				}
 				else
 				{
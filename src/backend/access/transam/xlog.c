@@ -682,6 +682,8 @@ static void CopyXLogRecordToWAL(int write_len, bool isLogSwitch,
 								TimeLineID tli);
 static void ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos,
 									  XLogRecPtr *EndPos, XLogRecPtr *PrevPtr);
+static void ReserveXLogInsertLocations(XLogRecord **rechdrs, int nrecords,
+									   XLogRecPtr *StartPos, XLogRecPtr *EndPos);
 static bool ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 							  XLogRecPtr *PrevPtr);
 static XLogRecPtr WaitXLogInsertionsToFinish(XLogRecPtr upto);
@@ -1023,6 +1025,141 @@ XLogInsertRecord(XLogRecData *rdata,
 	return EndPos;
 }
 
+/*
+ * Insert several WAL records into the XLOG, under a single WAL insertion lock
+ * acquisition and a single reservation of WAL space.
+ *
+ * This is the batched counterpart of XLogInsertRecord(), used by
+ * XLogInsertBatch().  Each element of 'rdatas' is the XLogRecData chain of
+ * one record, in the order the records are to appear in the WAL; as with
+ * XLogInsertRecord(), the first chunk of each chain must hold the whole
+ * MAXALIGNed record header.  The records are laid out back-to-back, each
+ * record's xl_prev pointing to the one before it.
+ *
+ * 'fpw_lsn' is the oldest of the records' fpw_lsn values, and 'num_fpi' and
+ * 'topxid_included' are the combined values for all of the records.  If
+ * any of the records would need to be recomputed, nothing is inserted and
+ * false is returned; the caller must re-assemble all the records and retry.
+ * Otherwise the end position of each record is stored in EndPtrs[i], for use
+ * as the LSN of the pages it applies to, and true is returned.
+ *
+ * xlog-switch records cannot be inserted this way.
+ */
+bool
+XLogInsertRecords(XLogRecData **rdatas, int nrecords,
+				  XLogRecPtr fpw_lsn, const uint8 *flags,
+				  int num_fpi, bool topxid_included,
+				  XLogRecPtr *EndPtrs)
+{
+	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	XLogRecord *rechdrs[XLR_MAX_BATCH_RECORDS];
+	XLogRecPtr	StartPtrs[XLR_MAX_BATCH_RECORDS];
+	bool		prevDoPageWrites = doPageWrites;
+	TimeLineID	insertTLI;
+	XLogRecPtr	lastImportantAt = InvalidXLogRecPtr;
+	uint64		wal_bytes = 0;
+	int			i;
+
+	Assert(nrecords > 0 && nrecords <= XLR_MAX_BATCH_RECORDS);
+
+	/* cross-check on whether we should be here or not */
+	if (!XLogInsertAllowed())
+		elog(ERROR, "cannot make new WAL entries during recovery");
+
+	for (i = 0; i < nrecords; i++)
+	{
+		XLogRecord *rechdr = (XLogRecord *) rdatas[i]->data;
+
+		/* we assume that all of the record header is in the first chunk */
+		Assert(rdatas[i]->len >= SizeOfXLogRecord);
+		Assert(!(rechdr->xl_rmid == RM_XLOG_ID &&
+				 (rechdr->xl_info & ~XLR_INFO_MASK) == XLOG_SWITCH));
+		rechdrs[i] = rechdr;
+	}
+
+	/* see XLogInsertRecord */
+	insertTLI = XLogCtl->InsertTimeLineID;
+
+	START_CRIT_SECTION();
+	WALInsertLockAcquire();
+
+	/*
+	 * Check whether the records need to be recomputed, exactly as
+	 * XLogInsertRecord does for a single record.
+	 */
+	if (RedoRecPtr != Insert->RedoRecPtr)
+	{
+		Assert(RedoRecPtr < Insert->RedoRecPtr);
+		RedoRecPtr = Insert->RedoRecPtr;
+	}
+	doPageWrites = (Insert->fullPageWrites || Insert->forcePageWrites);
+
+	if (doPageWrites &&
+		(!prevDoPageWrites ||
+		 (fpw_lsn != InvalidXLogRecPtr && fpw_lsn <= RedoRecPtr)))
+	{
+		WALInsertLockRelease();
+		END_CRIT_SECTION();
+		return false;
+	}
+
+	/* Reserve space for all the records at once; this sets their xl_prev. */
+	ReserveXLogInsertLocations(rechdrs, nrecords, StartPtrs, EndPtrs);
+
+	for (i = 0; i < nrecords; i++)
+	{
+		XLogRecord *rechdr = rechdrs[i];
+		pg_crc32c	rdata_crc;
+
+		rdata_crc = rechdr->xl_crc;
+		COMP_CRC32C(rdata_crc, rechdr, offsetof(XLogRecord, xl_crc));
+		FIN_CRC32C(rdata_crc);
+		rechdr->xl_crc = rdata_crc;
+
+		CopyXLogRecordToWAL(rechdr->xl_tot_len, false, rdatas[i],
+							StartPtrs[i], EndPtrs[i], insertTLI);
+
+		if ((flags[i] & XLOG_MARK_UNIMPORTANT) == 0)
+			lastImportantAt = StartPtrs[i];
+		wal_bytes += rechdr->xl_tot_len;
+	}
+
+	if (lastImportantAt != InvalidXLogRecPtr)
+	{
+		int			lockno = holdingAllLocks ? 0 : MyLockNo;
+
+		WALInsertLocks[lockno].l.lastImportantAt = lastImportantAt;
+	}
+
+	WALInsertLockRelease();
+
+	END_CRIT_SECTION();
+
+	MarkCurrentTransactionIdLoggedIfAny();
+
+	if (topxid_included)
+		MarkSubxactTopXidLogged();
+
+	/* Update shared LogwrtRqst.Write, if we crossed page boundary. */
+	if (StartPtrs[0] / XLOG_BLCKSZ != EndPtrs[nrecords - 1] / XLOG_BLCKSZ)
+	{
+		SpinLockAcquire(&XLogCtl->info_lck);
+		if (XLogCtl->LogwrtRqst.Write < EndPtrs[nrecords - 1])
+			XLogCtl->LogwrtRqst.Write = EndPtrs[nrecords - 1];
+		LogwrtResult = XLogCtl->LogwrtResult;
+		SpinLockRelease(&XLogCtl->info_lck);
+	}
+
+	ProcLastRecPtr = StartPtrs[nrecords - 1];
+	XactLastRecEnd = EndPtrs[nrecords - 1];
+
+	pgWalUsage.wal_bytes += wal_bytes;
+	pgWalUsage.wal_records += nrecords;
+	pgWalUsage.wal_fpi += num_fpi;
+
+	return true;
+}
+
 /*
  * Reserves the right amount of space for a record of given size from the WAL.
  * *StartPos is set to the beginning of the reserved section, *EndPos to
@@ -1084,6 +1221,58 @@ ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 	Assert(XLogRecPtrToBytePos(*PrevPtr) == prevbytepos);
 }
 
+/*
+ * Like ReserveXLogInsertLocation(), but reserves space for several records
+ * that are to be placed back-to-back, with a single acquisition of
+ * insertpos_lck.  The xl_prev field of each record header is filled in, and
+ * the start and end+1 of each record are returned in StartPos[i] and
+ * EndPos[i].
+ */
+static void
+ReserveXLogInsertLocations(XLogRecord **rechdrs, int nrecords,
+						   XLogRecPtr *StartPos, XLogRecPtr *EndPos)
+{
+	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	uint64		startbytepos;
+	uint64		prevbytepos;
+	uint64		bytepos;
+	uint64		size = 0;
+	uint32		lastsize = 0;
+	int			i;
+
+	for (i = 0; i < nrecords; i++)
+	{
+		lastsize = MAXALIGN(rechdrs[i]->xl_tot_len);
+		Assert(lastsize > SizeOfXLogRecord);
+		size += lastsize;
+	}
+
+	SpinLockAcquire(&Insert->insertpos_lck);
+
+	startbytepos = Insert->CurrBytePos;
+	prevbytepos = Insert->PrevBytePos;
+	Insert->CurrBytePos = startbytepos + size;
+	Insert->PrevBytePos = startbytepos + size - lastsize;
+
+	SpinLockRelease(&Insert->insertpos_lck);
+
+	bytepos = startbytepos;
+	for (i = 0; i < nrecords; i++)
+	{
+		uint32		recsize = MAXALIGN(rechdrs[i]->xl_tot_len);
+
+		rechdrs[i]->xl_prev = XLogBytePosToRecPtr(prevbytepos);
+		StartPos[i] = XLogBytePosToRecPtr(bytepos);
+		EndPos[i] = XLogBytePosToEndRecPtr(bytepos + recsize);
+
+		Assert(XLogRecPtrToBytePos(StartPos[i]) == bytepos);
+		Assert(XLogRecPtrToBytePos(EndPos[i]) == bytepos + recsize);
+
+		prevbytepos = bytepos;
+		bytepos += recsize;
+	}
+}
+
 /*
  * Like ReserveXLogInsertLocation(), but for an xlog-switch record.
  *
@@ -2474,6 +2663,10 @@ UpdateMinRecoveryPoint(XLogRecPtr lsn, bool force)
 		 * value as the min recovery point would prevent us from coming up at
 		 * all.  Instead, we just log a warning and continue with recovery.
 		 * (See also the comments about corrupt LSNs in XLogFlush.)
+		 *
+		 * With redo workers, the last record being replayed is the last one
+		 * that has been handed to a worker, which covers every page LSN the
+		 * workers can have set.
 		 */
 		newMinRecoveryPoint = GetCurrentReplayRecPtr(&newMinRecoveryPointTLI);
 		if (!force && newMinRecoveryPoint < lsn)
@@ -62,6 +62,32 @@
 /* Buffer size required to store a compressed version of backup block image */
 #define COMPRESS_BUFSIZE	Max(Max(PGLZ_MAX_BLCKSZ, LZ4_MAX_BLCKSZ), ZSTD_MAX_BLCKSZ)
 
+/*
+ * Maximum number of uncompressed bytes in a group of backup block images
+ * compressed as one stream, and the buffer size required to compress it.
+ */
+#define GROUP_MAX_RAW		(4 * BLCKSZ)
+
+#ifdef USE_LZ4
+#define LZ4_MAX_GROUP		LZ4_COMPRESSBOUND(GROUP_MAX_RAW)
+#else
+#define LZ4_MAX_GROUP		0
+#endif
+
+#ifdef USE_ZSTD
+#define ZSTD_MAX_GROUP		ZSTD_COMPRESSBOUND(GROUP_MAX_RAW)
+#else
+#define ZSTD_MAX_GROUP		0
+#endif
+
+#define GROUP_COMPRESS_BUFSIZE \
+	Max(Max(PGLZ_MAX_OUTPUT(GROUP_MAX_RAW), LZ4_MAX_GROUP), ZSTD_MAX_GROUP)
+
+/* Values of registered_buffer.group */
+#define BKP_GROUP_NONE		0	/* image is compressed on its own, if at all */
+#define BKP_GROUP_LEADER	1	/* image data holds the group's stream */
+#define BKP_GROUP_MEMBER	2	/* image is part of a preceding leader's stream */
+
 /*
  * For each block reference registered with XLogRegisterBuffer, we fill in
  * a registered_buffer struct.
@@ -83,6 +109,14 @@ typedef struct
 	XLogRecData bkp_rdatas[2];	/* temporary rdatas used to hold references to
 								 * backup block data in XLogRecordAssemble() */
 
+	/* backup block image decisions, made by XLogRecordAssemble() */
+	bool		needs_backup;	/* image must be restored at replay? */
+	bool		include_image;	/* image included in the record? */
+	uint16		hole_offset;	/* number of bytes before "hole" */
+	uint16		hole_length;	/* number of bytes in "hole" */
+	uint16		compressed_len; /* length of compressed image, or 0 */
+	uint8		group;			/* BKP_GROUP_* */
+
 	/* buffer to store a compressed version of backup block image */
 	char		compressed_page[COMPRESS_BUFSIZE];
 } registered_buffer;
@@ -132,6 +166,66 @@ static int	max_rdatas;			/* allocated size */
 
 static bool begininsert_called = false;
 
+/*
+ * Number of XLOG_FPI records that log_newpages() and log_newpage_range()
+ * insert as one batch.
+ */
+#define NEWPAGE_BATCH_RECORDS	4
+
+/*
+ * Records queued with XLogBatchAdd(), waiting for XLogInsertBatch().
+ *
+ * Queuing a record takes a private copy of its registered data, and remembers
+ * the registered blocks, so that the record can be assembled again at
+ * XLogInsertBatch() time.  The block contents are not copied; the pages must
+ * stay locked and unmodified until the batch has been inserted.
+ */
+typedef struct
+{
+	uint8		block_id;
+	uint8		flags;			/* REGBUF_* flags */
+	RelFileNode rnode;			/* identifies the relation and block */
+	ForkNumber	forkno;
+	BlockNumber block;
+	Page		page;			/* page content */
+	char	   *data;			/* copy of data registered with this block */
+	uint32		data_len;
+} batched_block;
+
+typedef struct
+{
+	RmgrId		rmid;
+	uint8		info;
+	uint8		flags;			/* flags set with XLogSetRecordFlags() */
+	bool		phony;			/* not inserted, see XLogInsert() */
+	int			first_block;	/* index of first entry in batched_blocks */
+	int			nblocks;
+	char	   *maindata;		/* copy of the main data */
+	uint32		maindata_len;
+	XLogRecData flat;			/* the record, as assembled for insertion */
+} batched_record;
+
+static batched_record batched_records[XLR_MAX_BATCH_RECORDS];
+static int	num_batched_records = 0;
+static int	max_batched_records = 0;	/* set by XLogBeginBatch() */
+static batched_block *batched_blocks;
+static int	num_batched_blocks = 0;
+static int	max_batched_blocks = 0;	/* allocated size */
+static int	max_batched_block_id = 0;	/* per record, set by XLogBeginBatch() */
+
+/* copies of registered data */
+static char *batch_data;
+static Size batch_data_used = 0;
+static Size batch_data_size = 0;	/* allocated size */
+
+/* space to assemble the queued records in, at insertion */
+static char *batch_flat;
+static Size batch_flat_size = 0;	/* allocated size */
+
+/* working areas to compress groups of backup block images */
+static char *group_raw;
+static char *group_compressed;
+
 /* Memory context to hold the registered buffer and data references. */
 static MemoryContext xloginsert_cxt;
 
@@ -141,6 +235,9 @@ static XLogRecData *XLogRecordAssemble(RmgrId rmid, uint8 info,
 									   bool *topxid_included);
 static bool XLogCompressBackupBlock(char *page, uint16 hole_offset,
 									uint16 hole_length, char *dest, uint16 *dlen);
+static int32 XLogCompressImageData(char *source, int32 orig_len, char *dest,
+								   int32 dest_size);
+static void XLogGroupBackupBlocks(void);
 
 /*
  * Begin constructing a WAL record. This must be called before the
@@ -498,6 +595,313 @@ XLogInsert(RmgrId rmid, uint8 info)
 	return EndPos;
 }
 
+/*
+ * Prepare to queue WAL records with XLogBatchAdd(), for insertion with a
+ * single WAL insertion lock acquisition by XLogInsertBatch().
+ *
+ * 'max_records' is the most records that will be queued before
+ * XLogInsertBatch() is called, at most XLR_MAX_BATCH_RECORDS;
+ * 'max_block_id' and 'max_data' bound the highest block ID and the total
+ * amount of registered data (main data plus block data) of each record.
+ * This allocates the working memory needed for queuing and inserting the
+ * records, so it must be called before entering a critical section.
+ */
+void
+XLogBeginBatch(int max_records, int max_block_id, Size max_data)
+{
+	Size		data_size;
+	Size		flat_size;
+	int			nblocks;
+
+	Assert(CritSectionCount == 0);
+
+	if (max_records < 1 || max_records > XLR_MAX_BATCH_RECORDS)
+		elog(ERROR, "invalid number of batched WAL records: %d", max_records);
+	if (max_block_id > XLR_MAX_BLOCK_ID)
+		elog(ERROR, "maximum number of WAL record block references exceeded");
+
+	nblocks = max_records * (max_block_id + 1);
+	if (nblocks > max_batched_blocks)
+	{
+		if (batched_blocks == NULL)
+			batched_blocks = (batched_block *)
+				MemoryContextAlloc(xloginsert_cxt,
+								   sizeof(batched_block) * nblocks);
+		else
+			batched_blocks = (batched_block *)
+				repalloc(batched_blocks, sizeof(batched_block) * nblocks);
+		max_batched_blocks = nblocks;
+	}
+
+	data_size = max_records * MAXALIGN(max_data);
+	if (data_size > batch_data_size)
+	{
+		if (batch_data != NULL)
+			pfree(batch_data);
+		batch_data = MemoryContextAlloc(xloginsert_cxt, data_size);
+		batch_data_size = data_size;
+	}
+
+	/*
+	 * An assembled record consists of its headers, a full-page image of at
+	 * most each registered block, and the registered data.
+	 */
+	flat_size = max_records *
+		MAXALIGN(HEADER_SCRATCH_SIZE + (max_block_id + 1) * BLCKSZ + max_data);
+	if (flat_size > batch_flat_size)
+	{
+		if (batch_flat != NULL)
+			pfree(batch_flat);
+		batch_flat = MemoryContextAlloc(xloginsert_cxt, flat_size);
+		batch_flat_size = flat_size;
+	}
+
+	/* forget anything left behind by an earlier, failed, batch */
+	num_batched_records = 0;
+	max_batched_records = max_records;
+	max_batched_block_id = max_block_id;
+	num_batched_blocks = 0;
+	batch_data_used = 0;
+}
+
+/*
+ * Queue a WAL record having the specified RMID and info bytes, with the body
+ * of the record being the data and buffer references registered earlier with
+ * XLogRegister* calls, like XLogInsert() does.  Instead of being inserted
+ * right away, the record is inserted by the next XLogInsertBatch() call, in
+ * one go with the other queued records.
+ *
+ * The registered data is copied, so the caller's data areas can be reused
+ * right away.  The registered pages are not: they must stay exclusively
+ * locked and unchanged until XLogInsertBatch() has returned, after which the
+ * caller sets their LSNs.  A page cannot be referenced by more than one
+ * record of a batch.
+ */
+void
+XLogBatchAdd(RmgrId rmid, uint8 info)
+{
+	batched_record *rec;
+	XLogRecData *rdt;
+	int			block_id;
+
+	/* XLogBeginInsert() must have been called. */
+	if (!begininsert_called)
+		elog(ERROR, "XLogBeginInsert was not called");
+
+	if (num_batched_records >= max_batched_records)
+		elog(ERROR, "too many batched WAL records");
+
+	/* see XLogInsert */
+	if ((info & ~(XLR_RMGR_INFO_MASK |
+				  XLR_SPECIAL_REL_UPDATE |
+				  XLR_CHECK_CONSISTENCY)) != 0)
+		elog(PANIC, "invalid xlog info mask %02X", info);
+
+	TRACE_POSTGRESQL_WAL_INSERT(rmid, info);
+
+	rec = &batched_records[num_batched_records++];
+	rec->rmid = rmid;
+	rec->info = info;
+	rec->flags = curinsert_flags;
+	rec->phony = IsBootstrapProcessingMode() && rmid != RM_XLOG_ID;
+	rec->first_block = num_batched_blocks;
+	rec->nblocks = 0;
+	rec->maindata = NULL;
+	rec->maindata_len = 0;
+
+	if (rec->phony)
+	{
+		XLogResetInsertion();
+		return;
+	}
+
+	if (max_registered_block_id > max_batched_block_id + 1)
+		elog(ERROR, "too many registered buffers in batched WAL record");
+
+	if (mainrdata_len > 0)
+	{
+		char	   *dest;
+
+		if (batch_data_used + mainrdata_len > batch_data_size)
+			elog(ERROR, "too much WAL data in batch");
+		dest = rec->maindata = batch_data + batch_data_used;
+		for (rdt = mainrdata_head; rdt != NULL; rdt = rdt->next)
+		{
+			memcpy(dest, rdt->data, rdt->len);
+			dest += rdt->len;
+			if (rdt == mainrdata_last)
+				break;
+		}
+		rec->maindata_len = mainrdata_len;
+		batch_data_used += mainrdata_len;
+	}
+
+	for (block_id = 0; block_id < max_registered_block_id; block_id++)
+	{
+		registered_buffer *regbuf = &registered_buffers[block_id];
+		batched_block *bblock;
+
+		if (!regbuf->in_use)
+			continue;
+
+		Assert(num_batched_blocks < max_batched_blocks);
+		bblock = &batched_blocks[num_batched_blocks++];
+		rec->nblocks++;
+
+#ifdef USE_ASSERT_CHECKING
+		{
+			int			i;
+
+			for (i = 0; i < rec->first_block; i++)
+				Assert(!RelFileNodeEquals(batched_blocks[i].rnode, regbuf->rnode) ||
+					   batched_blocks[i].forkno != regbuf->forkno ||
+					   batched_blocks[i].block != regbuf->block);
+		}
+#endif
+
+		bblock->block_id = block_id;
+		bblock->flags = regbuf->flags;
+		bblock->rnode = regbuf->rnode;
+		bblock->forkno = regbuf->forkno;
+		bblock->block = regbuf->block;
+		bblock->page = regbuf->page;
+		bblock->data = NULL;
+		bblock->data_len = regbuf->rdata_len;
+
+		if (regbuf->rdata_len > 0)
+		{
+			char	   *dest;
+
+			if (batch_data_used + regbuf->rdata_len > batch_data_size)
+				elog(ERROR, "too much WAL data in batch");
+			dest = bblock->data = batch_data + batch_data_used;
+			for (rdt = regbuf->rdata_head; rdt != NULL; rdt = rdt->next)
+			{
+				memcpy(dest, rdt->data, rdt->len);
+				dest += rdt->len;
+				if (rdt == regbuf->rdata_tail)
+					break;
+			}
+			batch_data_used += regbuf->rdata_len;
+		}
+	}
+
+	XLogResetInsertion();
+}
+
+/*
+ * Insert the records queued with XLogBatchAdd(), in the order they were
+ * queued.  The end position of each record, to be used as the LSN of the
+ * pages it references, is returned in EndPtrs[i].
+ *
+ * All the records are assembled first, and then handed to
+ * XLogInsertRecords(), which reserves WAL space for all of them and copies
+ * them into the WAL buffers while holding a single insertion lock.  If the
+ * full-page-write decisions turn out to be stale, all the records are
+ * assembled again.
+ */
+void
+XLogInsertBatch(XLogRecPtr *EndPtrs)
+{
+	XLogRecData *rdatas[XLR_MAX_BATCH_RECORDS];
+	uint8		flags[XLR_MAX_BATCH_RECORDS];
+	int			recnos[XLR_MAX_BATCH_RECORDS];
+	XLogRecPtr	BatchEndPtrs[XLR_MAX_BATCH_RECORDS];
+	int			nrecords;
+	int			i;
+
+	Assert(!begininsert_called);
+
+	for (;;)
+	{
+		XLogRecPtr	RedoRecPtr;
+		bool		doPageWrites;
+		bool		topxid_included = false;
+		XLogRecPtr	fpw_lsn = InvalidXLogRecPtr;
+		int			num_fpi = 0;
+		char	   *flat = batch_flat;
+
+		GetFullPageWriteInfo(&RedoRecPtr, &doPageWrites);
+
+		nrecords = 0;
+		for (i = 0; i < num_batched_records; i++)
+		{
+			batched_record *rec = &batched_records[i];
+			XLogRecPtr	rec_fpw_lsn;
+			XLogRecData *rdt;
+			char	   *dest;
+			int			j;
+
+			if (rec->phony)
+				continue;
+
+			/* Register the queued record again, and assemble it. */
+			XLogBeginInsert();
+			for (j = rec->first_block; j < rec->first_block + rec->nblocks; j++)
+			{
+				batched_block *bblock = &batched_blocks[j];
+
+				XLogRegisterBlock(bblock->block_id, &bblock->rnode,
+								  bblock->forkno, bblock->block,
+								  bblock->page, bblock->flags);
+				if (bblock->data_len > 0)
+					XLogRegisterBufData(bblock->block_id, bblock->data,
+										bblock->data_len);
+			}
+			if (rec->maindata_len > 0)
+				XLogRegisterData(rec->maindata, rec->maindata_len);
+			XLogSetRecordFlags(rec->flags);
+
+			rdt = XLogRecordAssemble(rec->rmid, rec->info, RedoRecPtr,
+									 doPageWrites, &rec_fpw_lsn, &num_fpi,
+									 &topxid_included);
+
+			/*
+			 * The header and compressed images live in working areas that the
+			 * next record will reuse, so make a flat copy of the record.
+			 */
+			dest = flat;
+			for (; rdt != NULL; rdt = rdt->next)
+			{
+				memcpy(dest, rdt->data, rdt->len);
+				dest += rdt->len;
+			}
+			Assert(dest - batch_flat <= batch_flat_size);
+
+			rec->flat.data = flat;
+			rec->flat.len = dest - flat;
+			rec->flat.next = NULL;
+			flat = (char *) MAXALIGN(dest);
+
+			XLogResetInsertion();
+
+			if (rec_fpw_lsn != InvalidXLogRecPtr &&
+				(fpw_lsn == InvalidXLogRecPtr || rec_fpw_lsn < fpw_lsn))
+				fpw_lsn = rec_fpw_lsn;
+
+			rdatas[nrecords] = &rec->flat;
+			flags[nrecords] = rec->flags;
+			recnos[nrecords] = i;
+			nrecords++;
+		}
+
+		if (nrecords == 0 ||
+			XLogInsertRecords(rdatas, nrecords, fpw_lsn, flags, num_fpi,
+							  topxid_included, BatchEndPtrs))
+			break;
+	}
+
+	/* phony records get the same fake position as in XLogInsert() */
+	for (i = 0; i < num_batched_records; i++)
+		EndPtrs[i] = SizeOfXLogLongPHD;
+	for (i = 0; i < nrecords; i++)
+		EndPtrs[recnos[i]] = BatchEndPtrs[i];
+
+	num_batched_records = 0;
+	num_batched_blocks = 0;
+	batch_data_used = 0;
+}
+
 /*
  * Assemble a WAL record from the registered data and buffers into an
  * XLogRecData chain, ready for insertion with XLogInsertRecord().
@@ -521,6 +925,7 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 	XLogRecData *rdt;
 	uint32		total_len = 0;
 	int			block_id;
+	int			nimages = 0;
 	pg_crc32c	rdata_crc;
 	registered_buffer *prev_regbuf = NULL;
 	XLogRecData *rdt_datas_last;
@@ -559,13 +964,6 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 	{
 		registered_buffer *regbuf = &registered_buffers[block_id];
 		bool		needs_backup;
-		bool		needs_data;
-		XLogRecordBlockHeader bkpb;
-		XLogRecordBlockImageHeader bimg;
-		XLogRecordBlockCompressHeader cbimg = {0};
-		bool		samerel;
-		bool		is_compressed = false;
-		bool		include_image;
 
 		if (!regbuf->in_use)
 			continue;
@@ -594,31 +992,20 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			}
 		}
 
-		/* Determine if the buffer data needs to included */
-		if (regbuf->rdata_len == 0)
-			needs_data = false;
-		else if ((regbuf->flags & REGBUF_KEEP_DATA) != 0)
-			needs_data = true;
-		else
-			needs_data = !needs_backup;
-
-		bkpb.id = block_id;
-		bkpb.fork_flags = regbuf->forkno;
-		bkpb.data_length = 0;
-
-		if ((regbuf->flags & REGBUF_WILL_INIT) == REGBUF_WILL_INIT)
-			bkpb.fork_flags |= BKPBLOCK_WILL_INIT;
+		regbuf->needs_backup = needs_backup;
 
 		/*
 		 * If needs_backup is true or WAL checking is enabled for current
 		 * resource manager, log a full-page write for the current block.
 		 */
-		include_image = needs_backup || (info & XLR_CHECK_CONSISTENCY) != 0;
+		regbuf->include_image = needs_backup ||
+			(info & XLR_CHECK_CONSISTENCY) != 0;
+		regbuf->compressed_len = 0;
+		regbuf->group = BKP_GROUP_NONE;
 
-		if (include_image)
+		if (regbuf->include_image)
 		{
 			Page		page = regbuf->page;
-			uint16		compressed_len = 0;
 
 			/*
 			 * The page needs to be backed up, so calculate its hole length
@@ -634,21 +1021,21 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 					upper > lower &&
 					upper <= BLCKSZ)
 				{
-					bimg.hole_offset = lower;
-					cbimg.hole_length = upper - lower;
+					regbuf->hole_offset = lower;
+					regbuf->hole_length = upper - lower;
 				}
 				else
 				{
 					/* No "hole" to remove */
-					bimg.hole_offset = 0;
-					cbimg.hole_length = 0;
+					regbuf->hole_offset = 0;
+					regbuf->hole_length = 0;
 				}
 			}
 			else
 			{
 				/* Not a standard page header, don't try to eliminate "hole" */
-				bimg.hole_offset = 0;
-				cbimg.hole_length = 0;
+				regbuf->hole_offset = 0;
+				regbuf->hole_length = 0;
 			}
 
 			/*
@@ -656,22 +1043,69 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			 */
 			if (wal_compression != WAL_COMPRESSION_NONE)
 			{
-				is_compressed =
-					XLogCompressBackupBlock(page, bimg.hole_offset,
-											cbimg.hole_length,
+				uint16		compressed_len = 0;
+
+				if (XLogCompressBackupBlock(page, regbuf->hole_offset,
+											regbuf->hole_length,
 											regbuf->compressed_page,
-											&compressed_len);
+											&compressed_len))
+					regbuf->compressed_len = compressed_len;
 			}
 
+			/* Report a full page image constructed for the WAL record */
+			*num_fpi += 1;
+			nimages++;
+		}
+	}
+
+	/* See if the images compress better together than one by one */
+	if (wal_compression != WAL_COMPRESSION_NONE && nimages > 1)
+		XLogGroupBackupBlocks();
+
+	for (block_id = 0; block_id < max_registered_block_id; block_id++)
+	{
+		registered_buffer *regbuf = &registered_buffers[block_id];
+		bool		needs_data;
+		XLogRecordBlockHeader bkpb;
+		XLogRecordBlockImageHeader bimg;
+		XLogRecordBlockCompressHeader cbimg = {0};
+		bool		samerel;
+		bool		is_compressed = false;
+		bool		include_image = regbuf->include_image;
+
+		if (!regbuf->in_use)
+			continue;
+
+		/* Determine if the buffer data needs to included */
+		if (regbuf->rdata_len == 0)
+			needs_data = false;
+		else if ((regbuf->flags & REGBUF_KEEP_DATA) != 0)
+			needs_data = true;
+		else
+			needs_data = !regbuf->needs_backup;
+
+		bkpb.id = block_id;
+		bkpb.fork_flags = regbuf->forkno;
+		bkpb.data_length = 0;
+
+		if ((regbuf->flags & REGBUF_WILL_INIT) == REGBUF_WILL_INIT)
+			bkpb.fork_flags |= BKPBLOCK_WILL_INIT;
+
+		if (include_image)
+		{
+			Page		page = regbuf->page;
+
+			bimg.hole_offset = regbuf->hole_offset;
+			cbimg.hole_length = regbuf->hole_length;
+			is_compressed = (regbuf->compressed_len != 0 ||
+							 regbuf->group != BKP_GROUP_NONE);
+
 			/*
 			 * Fill in the remaining fields in the XLogRecordBlockHeader
 			 * struct
 			 */
 			bkpb.fork_flags |= BKPBLOCK_HAS_IMAGE;
 
-			/* Report a full page image constructed for the WAL record */
-			*num_fpi += 1;
-
 			/*
 			 * Construct XLogRecData entries for the page content.
 			 */
@@ -686,13 +1120,13 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			 * for the block modified. During redo, the full-page is replayed
 			 * only if BKPIMAGE_APPLY is set.
 			 */
-			if (needs_backup)
+			if (regbuf->needs_backup)
 				bimg.bimg_info |= BKPIMAGE_APPLY;
 
 			if (is_compressed)
 			{
 				/* The current compression is stored in the WAL record */
-				bimg.length = compressed_len;
+				bimg.length = regbuf->compressed_len;
 
 				/* Set the compression method used for this block */
 				switch ((WalCompression) wal_compression)
@@ -723,8 +1157,16 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 						/* no default case, so that compiler will warn */
 				}
 
+				/* Group members carry no data, their leader has it all */
+				if (regbuf->group != BKP_GROUP_NONE)
+				{
+					bimg.bimg_info |= BKPIMAGE_COMPRESS_GROUP;
+					if (regbuf->group == BKP_GROUP_MEMBER)
+						bimg.length = 0;
+				}
+
 				rdt_datas_last->data = regbuf->compressed_page;
-				rdt_datas_last->len = compressed_len;
+				rdt_datas_last->len = bimg.length;
 			}
 			else
 			{
@@ -908,16 +1350,44 @@ XLogCompressBackupBlock(char *page, uint16 hole_offset, uint16 hole_length,
 	else
 		source = page;
 
+	len = XLogCompressImageData(source, orig_len, dest, COMPRESS_BUFSIZE);
+
+	/*
+	 * We recheck the actual size even if compression reports success and see
+	 * if the number of bytes saved by compression is larger than the length
+	 * of extra data needed for the compressed version of block image.
+	 */
+	if (len >= 0 &&
+		len + extra_bytes < orig_len)
+	{
+		*dlen = (uint16) len;	/* successful compression */
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Compress 'orig_len' bytes at 'source' into 'dest', which has room for
+ * 'dest_size' bytes, using the method selected by wal_compression.
+ *
+ * Returns the compressed length, or -1 on failure.
+ */
+static int32
+XLogCompressImageData(char *source, int32 orig_len, char *dest,
+					  int32 dest_size)
+{
+	int32		len = -1;
+
 	switch ((WalCompression) wal_compression)
 	{
 		case WAL_COMPRESSION_PGLZ:
+			Assert(dest_size >= PGLZ_MAX_OUTPUT(orig_len));
 			len = pglz_compress(source, orig_len, dest, PGLZ_strategy_default);
 			break;
 
 		case WAL_COMPRESSION_LZ4:
 #ifdef USE_LZ4
-			len = LZ4_compress_default(source, dest, orig_len,
-									   COMPRESS_BUFSIZE);
+			len = LZ4_compress_default(source, dest, orig_len, dest_size);
 			if (len <= 0)
 				len = -1;		/* failure */
 #else
@@ -927,7 +1397,7 @@ XLogCompressBackupBlock(char *page, uint16 hole_offset, uint16 hole_length,
 
 		case WAL_COMPRESSION_ZSTD:
 #ifdef USE_ZSTD
-			len = ZSTD_compress(dest, COMPRESS_BUFSIZE, source, orig_len,
+			len = ZSTD_compress(dest, dest_size, source, orig_len,
 								ZSTD_CLEVEL_DEFAULT);
 			if (ZSTD_isError(len))
 				len = -1;		/* failure */
@@ -942,18 +1412,101 @@ XLogCompressBackupBlock(char *page, uint16 hole_offset, uint16 hole_length,
 			/* no default case, so that compiler will warn */
 	}
 
-	/*
-	 * We recheck the actual size even if compression reports success and see
-	 * if the number of bytes saved by compression is larger than the length
-	 * of extra data needed for the compressed version of block image.
-	 */
-	if (len >= 0 &&
-		len + extra_bytes < orig_len)
+	return len;
+}
+
+/*
+ * Try to compress runs of the backup block images of the record being
+ * assembled as single streams, see XLogRecordBlockImageHeader.
+ *
+ * Every image has already been compressed on its own, if possible.  Runs of
+ * consecutive images whose individual versions add up to less than a page
+ * are compressed again as one stream, which is used instead if it takes less
+ * space than the images do separately.  Capping a group like this keeps its
+ * stream within the leader's compressed_page buffer, and within the sizes
+ * that readers accept for a single image.
+ */
+static void
+XLogGroupBackupBlocks(void)
+{
+	int			images[XLR_MAX_BLOCK_ID + 1];
+	int			nimages = 0;
+	int			first;
+
+	for (int block_id = 0; block_id < max_registered_block_id; block_id++)
 	{
-		*dlen = (uint16) len;	/* successful compression */
-		return true;
+		if (registered_buffers[block_id].in_use &&
+			registered_buffers[block_id].include_image)
+			images[nimages++] = block_id;
+	}
+
+	first = 0;
+	while (first < nimages)
+	{
+		int32		raw_len = 0;
+		int32		separate_len = 0;
+		int32		grouped_len = 0;
+		int32		len;
+		int			end;
+
+		/* Collect the longest run that fits the limits */
+		for (end = first; end < nimages; end++)
+		{
+			registered_buffer *regbuf = &registered_buffers[images[end]];
+			int32		len_raw = BLCKSZ - regbuf->hole_length;
+			int32		len_separate;
+
+			len_separate = regbuf->compressed_len != 0 ?
+				regbuf->compressed_len : len_raw;
+			if (raw_len + len_raw > GROUP_MAX_RAW ||
+				separate_len + len_separate >= BLCKSZ)
+				break;
+
+			/* Copy the image, skipping the hole */
+			memcpy(group_raw + raw_len, regbuf->page, regbuf->hole_offset);
+			memcpy(group_raw + raw_len + regbuf->hole_offset,
+				   regbuf->page + (regbuf->hole_offset + regbuf->hole_length),
+				   BLCKSZ - (regbuf->hole_offset + regbuf->hole_length));
+			raw_len += len_raw;
+
+			/*
+			 * Compressed images with a hole need an extra header, which all
+			 * images of a group have.
+			 */
+			separate_len += len_separate;
+			if (regbuf->hole_length != 0)
+			{
+				if (regbuf->compressed_len != 0)
+					separate_len += SizeOfXLogRecordBlockCompressHeader;
+				grouped_len += SizeOfXLogRecordBlockCompressHeader;
+			}
+		}
+
+		if (end - first < 2)
+		{
+			first = Max(end, first + 1);
+			continue;
+		}
+
+		len = XLogCompressImageData(group_raw, raw_len, group_compressed,
+									GROUP_COMPRESS_BUFSIZE);
+		if (len >= 0 && len < BLCKSZ &&
+			len + grouped_len < separate_len)
+		{
+			registered_buffer *leader = &registered_buffers[images[first]];
+
+			memcpy(leader->compressed_page, group_compressed, len);
+			leader->compressed_len = (uint16) len;
+			leader->group = BKP_GROUP_LEADER;
+			for (int i = first + 1; i < end; i++)
+			{
+				registered_buffers[images[i]].compressed_len = 0;
+				registered_buffers[images[i]].group = BKP_GROUP_MEMBER;
+			}
+		}
+
+		first = end;
 	}
-	return false;
 }
 
 /*
@@ -1109,45 +1662,63 @@ log_newpage(RelFileNode *rnode, ForkNumber forkNum, BlockNumber blkno,
 /*
  * Like log_newpage(), but allows logging multiple pages in one operation.
  * It is more efficient than calling log_newpage() for each page separately,
- * because we can write multiple pages in a single WAL record.
+ * because we can write multiple pages in a single WAL record, and insert
+ * several such records with a single WAL insertion lock acquisition.
  */
 void
 log_newpages(RelFileNode *rnode, ForkNumber forkNum, int num_pages,
 			 BlockNumber *blknos, Page *pages, bool page_std)
 {
 	int			flags;
-	XLogRecPtr	recptr;
 	int			i;
-	int			j;
 
 	flags = REGBUF_FORCE_IMAGE;
 	if (page_std)
 		flags |= REGBUF_STANDARD;
 
 	/*
-	 * Iterate over all the pages. They are collected into batches of
-	 * XLR_MAX_BLOCK_ID pages, and a single WAL-record is written for each
-	 * batch.
+	 * Iterate over all the pages. They are collected into records of
+	 * XLR_MAX_BLOCK_ID pages, and up to NEWPAGE_BATCH_RECORDS such records
+	 * are inserted as one batch.
 	 */
 	XLogEnsureRecordSpace(XLR_MAX_BLOCK_ID - 1, 0);
 
 	i = 0;
 	while (i < num_pages)
 	{
+		XLogRecPtr	recptrs[NEWPAGE_BATCH_RECORDS];
 		int			batch_start = i;
-		int			nbatch;
+		int			nrecords;
+		int			r;
+		int			j;
 
-		XLogBeginInsert();
+		nrecords = (num_pages - i + XLR_MAX_BLOCK_ID - 1) / XLR_MAX_BLOCK_ID;
+		nrecords = Min(nrecords, NEWPAGE_BATCH_RECORDS);
+		if (nrecords > 1)
+			XLogBeginBatch(nrecords, XLR_MAX_BLOCK_ID - 1, 0);
 
-		nbatch = 0;
-		while (nbatch < XLR_MAX_BLOCK_ID && i < num_pages)
+		for (r = 0; r < nrecords; r++)
 		{
-			XLogRegisterBlock(nbatch, rnode, forkNum, blknos[i], pages[i], flags);
-			i++;
-			nbatch++;
+			int			nbatch;
+
+			XLogBeginInsert();
+
+			nbatch = 0;
+			while (nbatch < XLR_MAX_BLOCK_ID && i < num_pages)
+			{
+				XLogRegisterBlock(nbatch, rnode, forkNum, blknos[i], pages[i], flags);
+				i++;
+				nbatch++;
+			}
+
+			if (nrecords > 1)
+				XLogBatchAdd(RM_XLOG_ID, XLOG_FPI);
+			else
+				recptrs[0] = XLogInsert(RM_XLOG_ID, XLOG_FPI);
 		}
 
-		recptr = XLogInsert(RM_XLOG_ID, XLOG_FPI);
+		if (nrecords > 1)
+			XLogInsertBatch(recptrs);
 
 		for (j = batch_start; j < i; j++)
 		{
@@ -1157,7 +1728,7 @@ log_newpages(RelFileNode *rnode, ForkNumber forkNum, int num_pages,
 			 */
 			if (!PageIsNew(pages[j]))
 			{
-				PageSetLSN(pages[j], recptr);
+				PageSetLSN(pages[j], recptrs[(j - batch_start) / XLR_MAX_BLOCK_ID]);
 			}
 		}
 	}
@@ -1213,6 +1784,7 @@ log_newpage_range(Relation rel, ForkNumber forkNum,
 {
 	int			flags;
 	BlockNumber blkno;
+	int			maxrecords;
 
 	flags = REGBUF_FORCE_IMAGE;
 	if (page_std)
@@ -1220,24 +1792,30 @@ log_newpage_range(Relation rel, ForkNumber forkNum,
 
 	/*
 	 * Iterate over all the pages in the range. They are collected into
-	 * batches of XLR_MAX_BLOCK_ID pages, and a single WAL-record is written
-	 * for each batch.
+	 * records of XLR_MAX_BLOCK_ID pages, and up to NEWPAGE_BATCH_RECORDS such
+	 * records are inserted as one batch.  All the pages of a batch are kept
+	 * pinned and locked until the batch has been inserted, so use smaller
+	 * batches if shared_buffers is small.
 	 */
 	XLogEnsureRecordSpace(XLR_MAX_BLOCK_ID - 1, 0);
+	maxrecords = Min(NEWPAGE_BATCH_RECORDS, NBuffers / (4 * XLR_MAX_BLOCK_ID));
+	maxrecords = Max(maxrecords, 1);
 
 	blkno = startblk;
 	while (blkno < endblk)
 	{
-		Buffer		bufpack[XLR_MAX_BLOCK_ID];
-		XLogRecPtr	recptr;
+		Buffer		bufpack[NEWPAGE_BATCH_RECORDS * XLR_MAX_BLOCK_ID];
+		XLogRecPtr	recptrs[NEWPAGE_BATCH_RECORDS];
 		int			nbufs;
+		int			nrecords;
+		int			r;
 		int			i;
 
 		CHECK_FOR_INTERRUPTS();
 
 		/* Collect a batch of blocks. */
 		nbufs = 0;
-		while (nbufs < XLR_MAX_BLOCK_ID && blkno < endblk)
+		while (nbufs < maxrecords * XLR_MAX_BLOCK_ID && blkno < endblk)
 		{
 			Buffer		buf = ReadBufferExtended(rel, forkNum, blkno,
 												 RBM_NORMAL, NULL);
@@ -1256,21 +1834,36 @@ log_newpage_range(Relation rel, ForkNumber forkNum,
 			blkno++;
 		}
 
-		/* Write WAL record for this batch. */
-		XLogBeginInsert();
+		/* An empty batch still gets a record, as before */
+		nrecords = Max((nbufs + XLR_MAX_BLOCK_ID - 1) / XLR_MAX_BLOCK_ID, 1);
+		if (nrecords > 1)
+			XLogBeginBatch(nrecords, XLR_MAX_BLOCK_ID - 1, 0);
 
+		/* Write WAL records for this batch. */
 		START_CRIT_SECTION();
-		for (i = 0; i < nbufs; i++)
+		for (r = 0; r < nrecords; r++)
 		{
-			XLogRegisterBuffer(i, bufpack[i], flags);
-			MarkBufferDirty(bufpack[i]);
+			XLogBeginInsert();
+
+			for (i = r * XLR_MAX_BLOCK_ID;
+				 i < nbufs && i < (r + 1) * XLR_MAX_BLOCK_ID; i++)
+			{
+				XLogRegisterBuffer(i - r * XLR_MAX_BLOCK_ID, bufpack[i], flags);
+				MarkBufferDirty(bufpack[i]);
+			}
+
+			if (nrecords > 1)
+				XLogBatchAdd(RM_XLOG_ID, XLOG_FPI);
+			else
+				recptrs[0] = XLogInsert(RM_XLOG_ID, XLOG_FPI);
 		}
 
-		recptr = XLogInsert(RM_XLOG_ID, XLOG_FPI);
+		if (nrecords > 1)
+			XLogInsertBatch(recptrs);
 
 		for (i = 0; i < nbufs; i++)
 		{
-			PageSetLSN(BufferGetPage(bufpack[i]), recptr);
+			PageSetLSN(BufferGetPage(bufpack[i]), recptrs[i / XLR_MAX_BLOCK_ID]);
 			UnlockReleaseBuffer(bufpack[i]);
 		}
 		END_CRIT_SECTION();
@@ -1311,4 +1904,11 @@ InitXLogInsert(void)
 	if (hdr_scratch == NULL)
 		hdr_scratch = MemoryContextAllocZero(xloginsert_cxt,
 											 HEADER_SCRATCH_SIZE);
+
+	if (group_raw == NULL)
+	{
+		group_raw = MemoryContextAlloc(xloginsert_cxt, GROUP_MAX_RAW);
+		group_compressed = MemoryContextAlloc(xloginsert_cxt,
+											  GROUP_COMPRESS_BUFSIZE);
+	}
 }
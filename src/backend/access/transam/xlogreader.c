@@ -178,6 +178,8 @@ XLogReaderFree(XLogReaderState *state)
 	pfree(state->errormsg_buf);
 	if (state->readRecordBuf)
 		pfree(state->readRecordBuf);
+	if (state->fpiGroupBuf)
+		pfree(state->fpiGroupBuf);
 	pfree(state->readBuf);
 	pfree(state);
 }
@@ -1640,6 +1642,7 @@ DecodeXLogRecord(XLogReaderState *state,
 	uint32		datatotal;
 	RelFileNode *rnode = NULL;
 	uint8		block_id;
+	int			group_leader = -1;
 
 	decoded->header = *record;
 	decoded->lsn = lsn;
@@ -1820,6 +1823,43 @@ DecodeXLogRecord(XLogReaderState *state,
 										  LSN_FORMAT_ARGS(state->ReadRecPtr));
 					goto err;
 				}
+
+				/*
+				 * cross-check that grouped images are compressed, and that
+				 * an image without data belongs to a group started by an
+				 * earlier image compressed with the same method.
+				 */
+				if (blk->bimg_info & BKPIMAGE_COMPRESS_GROUP)
+				{
+					if (!BKPIMAGE_COMPRESSED(blk->bimg_info))
+					{
+						report_invalid_record(state,
+											  "BKPIMAGE_COMPRESS_GROUP set, but block image is not compressed at %X/%X",
+											  LSN_FORMAT_ARGS(state->ReadRecPtr));
+						goto err;
+					}
+					if (blk->bimg_len != 0)
+						group_leader = block_id;
+					else if (group_leader < 0 ||
+							 (decoded->blocks[group_leader].bimg_info & ~(BKPIMAGE_HAS_HOLE | BKPIMAGE_APPLY)) !=
+							 (blk->bimg_info & ~(BKPIMAGE_HAS_HOLE | BKPIMAGE_APPLY)))
+					{
+						report_invalid_record(state,
+											  "BKPIMAGE_COMPRESS_GROUP set, but no matching group leader for block %u at %X/%X",
+											  (unsigned int) block_id,
+											  LSN_FORMAT_ARGS(state->ReadRecPtr));
+						goto err;
+					}
+				}
+				else if (blk->bimg_len == 0)
+				{
+					report_invalid_record(state,
+										  "block image length is zero at %X/%X",
+										  LSN_FORMAT_ARGS(state->ReadRecPtr));
+					goto err;
+				}
+				else
+					group_leader = -1;
 			}
 			if (!(fork_flags & BKPBLOCK_SAME_REL))
 			{
@@ -2002,6 +2042,151 @@ XLogRecGetBlockData(XLogReaderState *record, uint8 block_id, Size *len)
 	}
 }
 
+/*
+ * Decompress 'srclen' bytes at 'src', compressed with the method indicated by
+ * 'bimg_info', into exactly 'rawlen' bytes at 'dest'.
+ *
+ * Returns false, after reporting the problem, if the data cannot be
+ * decompressed.
+ */
+static bool
+XLogDecompressImage(XLogReaderState *record, uint8 block_id, uint8 bimg_info,
+					char *src, uint32 srclen, char *dest, uint32 rawlen)
+{
+	bool		decomp_success = true;
+
+	if ((bimg_info & BKPIMAGE_COMPRESS_PGLZ) != 0)
+	{
+		if (pglz_decompress(src, srclen, dest, rawlen, true) < 0)
+			decomp_success = false;
+	}
+	else if ((bimg_info & BKPIMAGE_COMPRESS_LZ4) != 0)
+	{
+#ifdef USE_LZ4
+		if (LZ4_decompress_safe(src, dest, srclen, rawlen) <= 0)
+			decomp_success = false;
+#else
+		report_invalid_record(record, "image at %X/%X compressed with %s not supported by build, block %d",
+							  LSN_FORMAT_ARGS(record->ReadRecPtr),
+							  "LZ4",
+							  block_id);
+		return false;
+#endif
+	}
+	else if ((bimg_info & BKPIMAGE_COMPRESS_ZSTD) != 0)
+	{
+#ifdef USE_ZSTD
+		size_t		decomp_result = ZSTD_decompress(dest, rawlen, src, srclen);
+
+		if (ZSTD_isError(decomp_result))
+			decomp_success = false;
+#else
+		report_invalid_record(record, "image at %X/%X compressed with %s not supported by build, block %d",
+							  LSN_FORMAT_ARGS(record->ReadRecPtr),
+							  "zstd",
+							  block_id);
+		return false;
+#endif
+	}
+	else
+	{
+		report_invalid_record(record, "image at %X/%X compressed with unknown method, block %d",
+							  LSN_FORMAT_ARGS(record->ReadRecPtr),
+							  block_id);
+		return false;
+	}
+
+	if (!decomp_success)
+	{
+		report_invalid_record(record, "invalid compressed image at %X/%X, block %d",
+							  LSN_FORMAT_ARGS(record->ReadRecPtr),
+							  block_id);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Locate the hole-less image of a block belonging to a group of full-page
+ * images compressed as one stream.  The whole group is decompressed into
+ * record->fpiGroupBuf, where it stays cached for the other members.
+ *
+ * Returns a pointer to the image, or NULL after reporting the problem.
+ */
+static char *
+XLogGroupImage(XLogReaderState *record, uint8 block_id)
+{
+	DecodedXLogRecord *decoded = record->record;
+	DecodedBkpBlock *leader;
+	int			leader_id;
+	uint32		offset = 0;
+	uint32		rawlen = 0;
+
+	/* Find the group's leader, summing up the images in front of ours */
+	for (leader_id = block_id; leader_id >= 0; leader_id--)
+	{
+		DecodedBkpBlock *blk = &decoded->blocks[leader_id];
+
+		if (!blk->in_use || !blk->has_image)
+			continue;
+		if ((blk->bimg_info & BKPIMAGE_COMPRESS_GROUP) == 0)
+		{
+			leader_id = -1;
+			break;
+		}
+		if (leader_id != block_id)
+			offset += BLCKSZ - blk->hole_length;
+		if (blk->bimg_len != 0)
+			break;
+	}
+	if (leader_id < 0)
+	{
+		report_invalid_record(record, "image at %X/%X has no group leader, block %d",
+							  LSN_FORMAT_ARGS(record->ReadRecPtr),
+							  block_id);
+		return NULL;
+	}
+	leader = &decoded->blocks[leader_id];
+
+	if (record->fpiGroupBuf == NULL ||
+		record->fpiGroupLSN != decoded->lsn ||
+		record->fpiGroupLeader != leader_id)
+	{
+		/* The group runs up to the next leader or ungrouped image */
+		for (int i = leader_id; i <= decoded->max_block_id; i++)
+		{
+			DecodedBkpBlock *blk = &decoded->blocks[i];
+
+			if (!blk->in_use || !blk->has_image)
+				continue;
+			if ((blk->bimg_info & BKPIMAGE_COMPRESS_GROUP) == 0 ||
+				(i != leader_id && blk->bimg_len != 0))
+				break;
+			rawlen += BLCKSZ - blk->hole_length;
+		}
+
+		if (rawlen > record->fpiGroupBufSize)
+		{
+			if (record->fpiGroupBuf)
+				pfree(record->fpiGroupBuf);
+			record->fpiGroupBuf = palloc(rawlen);
+			record->fpiGroupBufSize = rawlen;
+		}
+
+		/* Forget any previous group until this one is known to be good */
+		record->fpiGroupLSN = InvalidXLogRecPtr;
+		if (!XLogDecompressImage(record, block_id, leader->bimg_info,
+								 leader->bkp_image, leader->bimg_len,
+								 record->fpiGroupBuf, rawlen))
+			return NULL;
+		record->fpiGroupLSN = decoded->lsn;
+		record->fpiGroupLeader = leader_id;
+	}
+
+	return record->fpiGroupBuf + offset;
+}
+
 /*
  * Restore a full-page image from a backup block attached to an XLOG record.
  *
@@ -2023,63 +2208,20 @@ RestoreBlockImage(XLogReaderState *record, uint8 block_id, char *page)
 	bkpb = &record->record->blocks[block_id];
 	ptr = bkpb->bkp_image;
 
-	if (BKPIMAGE_COMPRESSED(bkpb->bimg_info))
+	if ((bkpb->bimg_info & BKPIMAGE_COMPRESS_GROUP) != 0)
 	{
-		/* If a backup block image is compressed, decompress it */
-		bool		decomp_success = true;
-
-		if ((bkpb->bimg_info & BKPIMAGE_COMPRESS_PGLZ) != 0)
-		{
-			if (pglz_decompress(ptr, bkpb->bimg_len, tmp.data,
-								BLCKSZ - bkpb->hole_length, true) < 0)
-				decomp_success = false;
-		}
-		else if ((bkpb->bimg_info & BKPIMAGE_COMPRESS_LZ4) != 0)
-		{
-#ifdef USE_LZ4
-			if (LZ4_decompress_safe(ptr, tmp.data,
-									bkpb->bimg_len, BLCKSZ - bkpb->hole_length) <= 0)
-				decomp_success = false;
-#else
-			report_invalid_record(record, "image at %X/%X compressed with %s not supported by build, block %d",
-								  LSN_FORMAT_ARGS(record->ReadRecPtr),
-								  "LZ4",
-								  block_id);
-			return false;
-#endif
-		}
-		else if ((bkpb->bimg_info & BKPIMAGE_COMPRESS_ZSTD) != 0)
-		{
-#ifdef USE_ZSTD
-			size_t		decomp_result = ZSTD_decompress(tmp.data,
-														BLCKSZ - bkpb->hole_length,
-														ptr, bkpb->bimg_len);
-
-			if (ZSTD_isError(decomp_result))
-				decomp_success = false;
-#else
-			report_invalid_record(record, "image at %X/%X compressed with %s not supported by build, block %d",
-								  LSN_FORMAT_ARGS(record->ReadRecPtr),
-								  "zstd",
-								  block_id);
+		/* Image is part of a stream shared with other blocks */
+		ptr = XLogGroupImage(record, block_id);
+		if (ptr == NULL)
 			return false;
-#endif
-		}
-		else
-		{
-			report_invalid_record(record, "image at %X/%X compressed with unknown method, block %d",
-								  LSN_FORMAT_ARGS(record->ReadRecPtr),
-								  block_id);
-			return false;
-		}
-
-		if (!decomp_success)
-		{
-			report_invalid_record(record, "invalid compressed image at %X/%X, block %d",
-								  LSN_FORMAT_ARGS(record->ReadRecPtr),
-								  block_id);
+	}
+	else if (BKPIMAGE_COMPRESSED(bkpb->bimg_info))
+	{
+		/* If a backup block image is compressed, decompress it */
+		if (!XLogDecompressImage(record, block_id, bkpb->bimg_info,
+								 ptr, bkpb->bimg_len, tmp.data,
+								 BLCKSZ - bkpb->hole_length))
 			return false;
-		}
 
 		ptr = tmp.data;
 	}
@@ -39,6 +39,7 @@
 #include "access/xlogprefetcher.h"
 #include "access/xlogreader.h"
 #include "access/xlogrecovery.h"
+#include "access/xlogredoworker.h"
 #include "access/xlogutils.h"
 #include "catalog/pg_control.h"
 #include "commands/tablespace.h"
@@ -182,6 +183,16 @@ static bool LocalPromoteIsTriggered = false;
 /* Has the recovery code requested a walreceiver wakeup? */
 static bool doRequestWalReceiverReply;
 
+/*
+ * Have records been handed to redo workers since they were last idle?  If
+ * so, lastReplayedReadRecPtr etc. aren't advanced until the workers catch
+ * up; the values to advertise then are remembered here.
+ */
+static bool redoWorkersPending = false;
+static XLogRecPtr pendingReplayedReadRecPtr;
+static XLogRecPtr pendingReplayedEndRecPtr;
+static TimeLineID pendingReplayedTLI;
+
 /* XLogReader object used to parse the WAL records */
 static XLogReaderState *xlogreader = NULL;
 
@@ -340,7 +351,9 @@ typedef struct XLogRecoveryCtlData
 	/*
 	 * When we're currently replaying a record, ie. in a redo function,
 	 * replayEndRecPtr points to the end+1 of the record being replayed,
-	 * otherwise it's equal to lastReplayedEndRecPtr.
+	 * otherwise it's equal to lastReplayedEndRecPtr.  While redo workers
+	 * have records to replay, it points to the end+1 of the last record
+	 * handed to them, and so can be ahead of lastReplayedEndRecPtr.
 	 */
 	XLogRecPtr	replayEndRecPtr;
 	TimeLineID	replayEndTLI;
@@ -391,6 +404,7 @@ static bool read_backup_label(XLogRecPtr *checkPointLoc,
 static bool read_tablespace_map(List **tablespaces);
 
 static void xlogrecovery_redo(XLogReaderState *record, TimeLineID replayTLI);
+static void WaitForRedoWorkers(void);
 static void CheckRecoveryConsistency(void);
 static void rm_redo_error_callback(void *arg);
 #ifdef WAL_DEBUG
@@ -1637,6 +1651,14 @@ PerformWalRecovery(void)
 
 		RmgrStartup();
 
+		/*
+		 * Start redo workers, if requested.  They wake us up through the same
+		 * latch that we use to wait for WAL, if we're going to sleep during
+		 * recovery at all.
+		 */
+		RedoWorkersStart(ArchiveRecoveryRequested ?
+						 &XLogRecoveryCtl->recoveryWakeupLatch : MyLatch);
+
 		ereport(LOG,
 				(errmsg("redo starts at %X/%X",
 						LSN_FORMAT_ARGS(xlogreader->ReadRecPtr))));
@@ -1739,6 +1761,9 @@ PerformWalRecovery(void)
 		 * end of main redo apply loop
 		 */
 
+		WaitForRedoWorkers();
+		RedoWorkersStop();
+
 		if (reachedRecoveryTarget)
 		{
 			if (!reachedConsistency)
@@ -1812,6 +1837,7 @@ ApplyWalRecord(XLogReaderState *xlogreader, XLogRecord *record, TimeLineID *repl
 {
 	ErrorContextCallback errcallback;
 	bool		switchedTLI = false;
+	bool		dispatched = false;
 
 	/* Setup error traceback support for ereport() */
 	errcallback.callback = rm_redo_error_callback;
@@ -1869,7 +1895,11 @@ ApplyWalRecord(XLogReaderState *xlogreader, XLogRecord *record, TimeLineID *repl
 
 	/*
 	 * Update shared replayEndRecPtr before replaying this record, so that
-	 * XLogFlush will update minRecoveryPoint correctly.
+	 * XLogFlush will update minRecoveryPoint correctly.  This must happen
+	 * before the record is handed to a redo worker, too: pages dirtied by
+	 * the workers carry LSNs past lastReplayedEndRecPtr, which is held back
+	 * until they catch up, and flushing those pages must still advance
+	 * minRecoveryPoint over them.
 	 */
 	SpinLockAcquire(&XLogRecoveryCtl->info_lck);
 	XLogRecoveryCtl->replayEndRecPtr = xlogreader->EndRecPtr;
@@ -1884,35 +1914,65 @@ ApplyWalRecord(XLogReaderState *xlogreader, XLogRecord *record, TimeLineID *repl
 		RecordKnownAssignedTransactionIds(record->xl_xid);
 
 	/*
-	 * Some XLOG record types that are related to recovery are processed
-	 * directly here, rather than in xlog_redo()
+	 * Hand the record to a redo worker if possible.  Otherwise, unless the
+	 * record is independent of what the workers are doing, wait for them to
+	 * replay everything before it.
 	 */
-	if (record->xl_rmid == RM_XLOG_ID)
-		xlogrecovery_redo(xlogreader, *replayTLI);
+	if (RedoWorkersActive())
+	{
+		dispatched = RedoWorkerDispatch(xlogreader);
+		if (dispatched)
+			redoWorkersPending = true;
+		else if (RedoWorkerNeedsBarrier(xlogreader))
+			WaitForRedoWorkers();
+	}
+
+	if (!dispatched)
+	{
+		/*
+		 * Some XLOG record types that are related to recovery are processed
+		 * directly here, rather than in xlog_redo()
+		 */
+		if (record->xl_rmid == RM_XLOG_ID)
+			xlogrecovery_redo(xlogreader, *replayTLI);
 
-	/* Now apply the WAL record itself */
-	GetRmgr(record->xl_rmid).rm_redo(xlogreader);
+		/* Now apply the WAL record itself */
+		GetRmgr(record->xl_rmid).rm_redo(xlogreader);
 
-	/*
-	 * After redo, check whether the backup pages associated with the WAL
-	 * record are consistent with the existing pages. This check is done only
-	 * if consistency check is enabled for this record.
-	 */
-	if ((record->xl_info & XLR_CHECK_CONSISTENCY) != 0)
-		verifyBackupPageConsistency(xlogreader);
+		/*
+		 * After redo, check whether the backup pages associated with the WAL
+		 * record are consistent with the existing pages. This check is done
+		 * only if consistency check is enabled for this record.
+		 */
+		if ((record->xl_info & XLR_CHECK_CONSISTENCY) != 0)
+			verifyBackupPageConsistency(xlogreader);
+
+		if (RedoWorkersActive())
+			RedoWorkerAfterSerialRecord(xlogreader);
+	}
 
 	/* Pop the error context stack */
 	error_context_stack = errcallback.previous;
 
 	/*
 	 * Update lastReplayedEndRecPtr after this record has been successfully
-	 * replayed.
+	 * replayed.  If redo workers might still be working on earlier records,
+	 * that has to wait until they're done.
 	 */
-	SpinLockAcquire(&XLogRecoveryCtl->info_lck);
-	XLogRecoveryCtl->lastReplayedReadRecPtr = xlogreader->ReadRecPtr;
-	XLogRecoveryCtl->lastReplayedEndRecPtr = xlogreader->EndRecPtr;
-	XLogRecoveryCtl->lastReplayedTLI = *replayTLI;
-	SpinLockRelease(&XLogRecoveryCtl->info_lck);
+	if (redoWorkersPending)
+	{
+		pendingReplayedReadRecPtr = xlogreader->ReadRecPtr;
+		pendingReplayedEndRecPtr = xlogreader->EndRecPtr;
+		pendingReplayedTLI = *replayTLI;
+	}
+	else
+	{
+		SpinLockAcquire(&XLogRecoveryCtl->info_lck);
+		XLogRecoveryCtl->lastReplayedReadRecPtr = xlogreader->ReadRecPtr;
+		XLogRecoveryCtl->lastReplayedEndRecPtr = xlogreader->EndRecPtr;
+		XLogRecoveryCtl->lastReplayedTLI = *replayTLI;
+		SpinLockRelease(&XLogRecoveryCtl->info_lck);
+	}
 
 	/*
 	 * If rm_redo called XLogRequestWalReceiverReply, then we wake up the
@@ -1948,6 +2008,29 @@ ApplyWalRecord(XLogReaderState *xlogreader, XLogRecord *record, TimeLineID *repl
 	}
 }
 
+/*
+ * Wait for redo workers to replay all records handed to them, and advertise
+ * the replay position that was held back while they were busy.
+ */
+static void
+WaitForRedoWorkers(void)
+{
+	if (!redoWorkersPending)
+		return;
+
+	RedoWorkersWaitIdle();
+	redoWorkersPending = false;
+
+	SpinLockAcquire(&XLogRecoveryCtl->info_lck);
+	XLogRecoveryCtl->lastReplayedReadRecPtr = pendingReplayedReadRecPtr;
+	XLogRecoveryCtl->lastReplayedEndRecPtr = pendingReplayedEndRecPtr;
+	XLogRecoveryCtl->lastReplayedTLI = pendingReplayedTLI;
+	SpinLockRelease(&XLogRecoveryCtl->info_lck);
+
+	/* Allow read-only connections if we're consistent now */
+	CheckRecoveryConsistency();
+}
+
 /*
  * Some XLOG RM record types that are directly related to WAL recovery are
  * handled here rather than in the xlog_redo()
@@ -2799,6 +2882,9 @@ recoveryPausesHere(bool endOfRecovery)
 	if (LocalPromoteIsTriggered)
 		return;
 
+	/* Let redo workers finish what they have, so that the pause is visible */
+	WaitForRedoWorkers();
+
 	if (endOfRecovery)
 		ereport(LOG,
 				(errmsg("pausing at the end of recovery"),
@@ -3550,6 +3636,8 @@ WaitForWALToBecomeAvailable(XLogRecPtr RecPtr, bool randAccess,
 						elog(LOG, "waiting for WAL to become available at %X/%X",
 							 LSN_FORMAT_ARGS(RecPtr));
 
+						WaitForRedoWorkers();
+
 						(void) WaitLatch(&XLogRecoveryCtl->recoveryWakeupLatch,
 										 WL_LATCH_SET | WL_TIMEOUT |
 										 WL_EXIT_ON_PM_DEATH,
@@ -3808,8 +3896,10 @@ WaitForWALToBecomeAvailable(XLogRecPtr RecPtr, bool randAccess,
 					 * far and are about to start waiting for more WAL, let's
 					 * tell the upstream server our replay location now so
 					 * that pg_stat_replication doesn't show stale
-					 * information.
+					 * information.  Redo workers must finish first for that
+					 * to be true.
 					 */
+					WaitForRedoWorkers();
 					if (!streaming_reply_sent)
 					{
 						WalRcvForceReply();
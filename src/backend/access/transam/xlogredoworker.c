@@ -0,0 +1,984 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogredoworker.c
+ *		Parallel replay of WAL records during recovery.
+ *
+ * Portions Copyright (c) 2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogredoworker.c
+ *
+ * When recovery_redo_workers is set, the startup process hands WAL records
+ * that modify a single page to a pool of background workers instead of
+ * replaying them itself.  Records are routed by relation and block number,
+ * so all changes to a given page are replayed by the same worker, in WAL
+ * order, while changes to different pages are replayed concurrently.  The
+ * startup process keeps reading (and prefetching) WAL, and replays all other
+ * records itself.
+ *
+ * Records that touch several pages, or that must be ordered against other
+ * records (checkpoints, relation drops and truncations, commits when hot
+ * standby queries could observe them, ...) act as barriers: the startup
+ * process waits for every worker to drain its queue before replaying them.
+ * The startup process also drains the workers before it waits for more WAL
+ * to arrive or pauses, and only then advances lastReplayedEndRecPtr, so the
+ * advertised replay position and consistency checks only ever cover WAL that
+ * has really been replayed.  minRecoveryPoint is not held back like that:
+ * the startup process advances replayEndRecPtr before dispatching a record,
+ * so flushing a page that a worker has modified moves minRecoveryPoint past
+ * the page's LSN, as it would without workers.
+ *
+ * Each worker has a single-producer, single-consumer ring buffer in shared
+ * memory.  The startup process copies the DecodedXLogRecord into it, and the
+ * worker relocates the record's internal pointers and replays it with a
+ * private XLogReaderState.
+ *
+ * Some of the machinery that redo routines rely on assumes it is running in
+ * the one and only process replaying WAL.  Two places need help:
+ * XLogReadBufferExtended() serializes relation extension between workers
+ * with a small array of LWLocks partitioned by relation, and references to
+ * invalid pages are forwarded to the startup process, which owns the
+ * invalid-page table.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam_xlog.h"
+#include "access/nbtxlog.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogrecovery.h"
+#include "access/xlogredoworker.h"
+#include "access/xlogutils.h"
+#include "catalog/pg_control.h"
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/startup.h"
+#include "storage/ipc.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+/* Size of each worker's queue of WAL records */
+#define REDO_QUEUE_SIZE				(256 * 1024)
+
+/* Larger records are replayed by the startup process */
+#define REDO_MAX_RECORD_SIZE		(REDO_QUEUE_SIZE / 4)
+
+/* Number of consecutive blocks of a relation routed to the same worker */
+#define REDO_BLOCK_CHUNK			16
+
+/* Number of invalid-page references a worker can hand over at once */
+#define REDO_MAX_INVALID_PAGES		64
+
+/* Number of LWLocks serializing relation extension between workers */
+#define NUM_REDO_EXTENSION_LOCKS	64
+
+/*
+ * How long the startup process sleeps while waiting for workers.  Signals
+ * don't necessarily set the latch the startup process waits on during crash
+ * recovery, so don't sleep for long.
+ */
+#define REDO_WAIT_TIMEOUT_MS		100
+
+/* Header of each entry in a worker's queue */
+typedef struct RedoQueueEntry
+{
+	Size		size;			/* size of entry, or 0 to wrap around */
+	char	   *orig;			/* address of the record in startup process */
+} RedoQueueEntry;
+
+#define REDO_ENTRY_HEADER_SIZE		MAXALIGN(sizeof(RedoQueueEntry))
+
+/* A reference to an invalid page, on its way to the startup process */
+typedef struct RedoInvalidPage
+{
+	RelFileNode node;
+	ForkNumber	forkno;
+	BlockNumber blkno;
+	bool		present;
+} RedoInvalidPage;
+
+typedef struct RedoWorkerSlot
+{
+	/* Queue positions, in bytes since the workers were started */
+	pg_atomic_uint64 head;		/* advanced by the startup process */
+	pg_atomic_uint64 tail;		/* advanced by the worker */
+
+	Latch	   *latch;			/* worker's latch, NULL until it runs */
+
+	/* References to invalid pages, protected by mutex */
+	slock_t		mutex;
+	int			ninvalid;
+	RedoInvalidPage invalid[REDO_MAX_INVALID_PAGES];
+} RedoWorkerSlot;
+
+typedef struct RedoWorkerCtlData
+{
+	bool		shutdown;		/* workers should exit once idle */
+	Latch	   *startupLatch;	/* latch the startup process waits on */
+
+	/* Advanced when the startup process drops or truncates relations */
+	pg_atomic_uint32 smgr_generation;
+
+	LWLockPadded extension_locks[NUM_REDO_EXTENSION_LOCKS];
+
+	RedoWorkerSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} RedoWorkerCtlData;
+
+/* GUCs */
+int			recovery_redo_workers = 0;
+
+static RedoWorkerCtlData *RedoWorkerCtl = NULL;
+
+/* Startup process state */
+static int	num_redo_workers = 0;
+static BackgroundWorkerHandle **redo_worker_handles = NULL;
+
+/* Redo worker state */
+static int	MyRedoWorkerId = -1;
+
+static char *RedoWorkerQueue(int id);
+static bool RedoWorkerCanReplay(XLogReaderState *record);
+static bool RedoXactDropsRelations(XLogReaderState *record,
+								   bool *apply_feedback);
+static void RedoWorkersCheck(void);
+static void RedoWorkersWait(void);
+static void RedoWorkerReplay(XLogReaderState *reader, RedoQueueEntry *entry,
+							 MemoryContext redo_context);
+static void redo_worker_error_callback(void *arg);
+
+
+/*
+ * Report shared-memory space needed by RedoWorkerShmemInit.
+ */
+Size
+RedoWorkerShmemSize(void)
+{
+	Size		size;
+
+	size = offsetof(RedoWorkerCtlData, slots);
+	size = add_size(size, mul_size(recovery_redo_workers,
+								   sizeof(RedoWorkerSlot)));
+	size = BUFFERALIGN(size);
+	size = add_size(size, mul_size(recovery_redo_workers, REDO_QUEUE_SIZE));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize shared memory for redo workers.
+ */
+void
+RedoWorkerShmemInit(void)
+{
+	bool		found;
+
+	RedoWorkerCtl = (RedoWorkerCtlData *)
+		ShmemInitStruct("Redo Worker Data", RedoWorkerShmemSize(), &found);
+
+	if (!found)
+	{
+		RedoWorkerCtl->shutdown = false;
+		RedoWorkerCtl->startupLatch = NULL;
+		pg_atomic_init_u32(&RedoWorkerCtl->smgr_generation, 0);
+
+		for (int i = 0; i < NUM_REDO_EXTENSION_LOCKS; i++)
+			LWLockInitialize(&RedoWorkerCtl->extension_locks[i].lock,
+							 LWTRANCHE_REDO_EXTENSION);
+
+		for (int i = 0; i < recovery_redo_workers; i++)
+		{
+			RedoWorkerSlot *slot = &RedoWorkerCtl->slots[i];
+
+			pg_atomic_init_u64(&slot->head, 0);
+			pg_atomic_init_u64(&slot->tail, 0);
+			slot->latch = NULL;
+			SpinLockInit(&slot->mutex);
+			slot->ninvalid = 0;
+		}
+	}
+}
+
+/*
+ * Return the ring buffer of the given worker.
+ */
+static char *
+RedoWorkerQueue(int id)
+{
+	Size		offset;
+
+	offset = BUFFERALIGN(offsetof(RedoWorkerCtlData, slots) +
+						 recovery_redo_workers * sizeof(RedoWorkerSlot));
+
+	return (char *) RedoWorkerCtl + offset + (Size) id * REDO_QUEUE_SIZE;
+}
+
+/*
+ * Launch redo workers, if configured.  Called by the startup process before
+ * it starts replaying WAL.
+ *
+ * wakeupLatch is the latch the startup process sleeps on while it waits for
+ * workers; workers set it whenever they make progress.  If workers can't be
+ * started, all WAL is replayed by the startup process.
+ */
+void
+RedoWorkersStart(Latch *wakeupLatch)
+{
+	BackgroundWorker worker;
+	int			nregistered;
+	bool		all_started = true;
+
+	Assert(num_redo_workers == 0);
+
+	/* Workers are background workers, so we need a postmaster */
+	if (recovery_redo_workers == 0 || !IsUnderPostmaster)
+		return;
+
+	RedoWorkerCtl->shutdown = false;
+	RedoWorkerCtl->startupLatch = wakeupLatch;
+	for (int i = 0; i < recovery_redo_workers; i++)
+	{
+		RedoWorkerSlot *slot = &RedoWorkerCtl->slots[i];
+
+		pg_atomic_write_u64(&slot->head, 0);
+		pg_atomic_write_u64(&slot->tail, 0);
+		slot->latch = NULL;
+		slot->ninvalid = 0;
+	}
+
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	sprintf(worker.bgw_library_name, "postgres");
+	sprintf(worker.bgw_function_name, "RedoWorkerMain");
+	snprintf(worker.bgw_type, BGW_MAXLEN, "redo worker");
+
+	if (redo_worker_handles == NULL)
+		redo_worker_handles = (BackgroundWorkerHandle **)
+			MemoryContextAlloc(TopMemoryContext,
+							   recovery_redo_workers * sizeof(BackgroundWorkerHandle *));
+
+	for (nregistered = 0; nregistered < recovery_redo_workers; nregistered++)
+	{
+		snprintf(worker.bgw_name, BGW_MAXLEN, "redo worker %d", nregistered);
+		worker.bgw_main_arg = Int32GetDatum(nregistered);
+
+		if (!RegisterDynamicBackgroundWorker(&worker,
+											 &redo_worker_handles[nregistered]))
+			break;
+	}
+
+	/*
+	 * Wait for the workers to start.  We're not a regular backend, so the
+	 * postmaster won't notify us about their state changes; poll instead.
+	 */
+	for (int i = 0; i < nregistered; i++)
+	{
+		for (;;)
+		{
+			BgwHandleStatus status;
+			pid_t		pid;
+
+			status = GetBackgroundWorkerPid(redo_worker_handles[i], &pid);
+			if (status == BGWH_STARTED)
+				break;
+			if (status != BGWH_NOT_YET_STARTED)
+			{
+				all_started = false;
+				break;
+			}
+
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 10L, WAIT_EVENT_RECOVERY_REDO_WORKERS);
+			ResetLatch(MyLatch);
+			HandleStartupProcInterrupts();
+		}
+	}
+
+	if (!all_started)
+	{
+		/* Give up on parallel redo, and make sure no worker stays behind */
+		num_redo_workers = nregistered;
+		RedoWorkersStop();
+		ereport(LOG,
+				(errmsg("could not start redo workers, replaying WAL in the startup process")));
+		return;
+	}
+
+	if (nregistered < recovery_redo_workers)
+		ereport(LOG,
+				(errmsg("could only start %d of %d redo workers",
+						nregistered, recovery_redo_workers),
+				 errhint("You might need to increase max_worker_processes.")));
+
+	num_redo_workers = nregistered;
+}
+
+/*
+ * Are there redo workers to hand records to?
+ */
+bool
+RedoWorkersActive(void)
+{
+	return num_redo_workers > 0;
+}
+
+/*
+ * Can a redo worker replay this record on its own?
+ *
+ * This is the case for records that modify exactly one page in the main fork
+ * of a relation, and whose redo routine touches no other shared state that
+ * depends on WAL order, except for the visibility map and free space map,
+ * whose updates commute.
+ */
+static bool
+RedoWorkerCanReplay(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	DecodedBkpBlock *blk;
+
+	if (XLogRecMaxBlockId(record) != 0 ||
+		(XLogRecGetInfo(record) & XLR_CHECK_CONSISTENCY) != 0)
+		return false;
+
+	blk = XLogRecGetBlock(record, 0);
+	if (!blk->in_use || blk->forknum != MAIN_FORKNUM)
+		return false;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_HEAP_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP_INSERT:
+				case XLOG_HEAP_DELETE:
+				case XLOG_HEAP_UPDATE:
+				case XLOG_HEAP_HOT_UPDATE:
+				case XLOG_HEAP_CONFIRM:
+				case XLOG_HEAP_LOCK:
+				case XLOG_HEAP_INPLACE:
+					return true;
+			}
+			break;
+
+		case RM_HEAP2_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP2_MULTI_INSERT:
+				case XLOG_HEAP2_LOCK_UPDATED:
+					return true;
+
+				case XLOG_HEAP2_PRUNE:
+				case XLOG_HEAP2_VACUUM:
+				case XLOG_HEAP2_FREEZE_PAGE:
+
+					/*
+					 * In hot standby, these need to resolve conflicts with
+					 * queries, which only the startup process can do.
+					 */
+					return standbyState == STANDBY_DISABLED;
+			}
+			break;
+
+		case RM_BTREE_ID:
+			switch (info)
+			{
+				case XLOG_BTREE_INSERT_LEAF:
+				case XLOG_BTREE_INSERT_POST:
+				case XLOG_BTREE_DEDUP:
+					return true;
+
+				case XLOG_BTREE_VACUUM:
+				case XLOG_BTREE_DELETE:
+					/* as above */
+					return standbyState == STANDBY_DISABLED;
+			}
+			break;
+
+		case RM_XLOG_ID:
+			if (info == XLOG_FPI || info == XLOG_FPI_FOR_HINT)
+				return true;
+			break;
+	}
+
+	return false;
+}
+
+/*
+ * Hand a WAL record over to a redo worker.
+ *
+ * Returns false if the caller must replay the record itself.
+ */
+bool
+RedoWorkerDispatch(XLogReaderState *record)
+{
+	DecodedXLogRecord *decoded = record->record;
+	DecodedBkpBlock *blk;
+	RedoWorkerSlot *slot;
+	RedoQueueEntry *entry;
+	char	   *queue;
+	Size		size;
+	Size		needed;
+	Size		offset;
+	Size		contiguous;
+	uint64		head;
+	uint32		hash;
+
+	Assert(num_redo_workers > 0);
+
+	if (!RedoWorkerCanReplay(record))
+		return false;
+
+	size = REDO_ENTRY_HEADER_SIZE + decoded->size;
+	if (size > REDO_MAX_RECORD_SIZE)
+		return false;
+
+	/* Route the record by relation and block */
+	blk = &decoded->blocks[0];
+	hash = hash_combine(hash_bytes_uint32(blk->rnode.relNode),
+						hash_bytes_uint32(blk->blkno / REDO_BLOCK_CHUNK));
+	slot = &RedoWorkerCtl->slots[hash % num_redo_workers];
+	queue = RedoWorkerQueue(hash % num_redo_workers);
+
+	/* If the record doesn't fit before the end of the ring, wrap around */
+	head = pg_atomic_read_u64(&slot->head);
+	offset = head % REDO_QUEUE_SIZE;
+	contiguous = REDO_QUEUE_SIZE - offset;
+	needed = contiguous < size ? contiguous + size : size;
+
+	/* Wait for the worker to make room */
+	while (REDO_QUEUE_SIZE - (head - pg_atomic_read_u64(&slot->tail)) < needed)
+		RedoWorkersWait();
+
+	/* Don't overwrite anything the worker might still be reading */
+	pg_memory_barrier();
+
+	if (contiguous < size)
+	{
+		entry = (RedoQueueEntry *) (queue + offset);
+		entry->size = 0;
+		head += contiguous;
+		offset = 0;
+	}
+
+	entry = (RedoQueueEntry *) (queue + offset);
+	entry->size = size;
+	entry->orig = (char *) decoded;
+	memcpy((char *) entry + REDO_ENTRY_HEADER_SIZE, decoded, decoded->size);
+
+	pg_write_barrier();
+	pg_atomic_write_u64(&slot->head, head + size);
+
+	/* Pairs with the barrier after the worker advertises its latch */
+	pg_memory_barrier();
+	if (slot->latch != NULL)
+		SetLatch(slot->latch);
+
+	return true;
+}
+
+/*
+ * Does a commit or abort record drop relations?  *apply_feedback is set if
+ * someone waits for the commit to be replayed (synchronous_commit =
+ * remote_apply).
+ */
+static bool
+RedoXactDropsRelations(XLogReaderState *record, bool *apply_feedback)
+{
+	uint8		info = XLogRecGetInfo(record) & XLOG_XACT_OPMASK;
+
+	*apply_feedback = false;
+
+	if (info == XLOG_XACT_COMMIT || info == XLOG_XACT_COMMIT_PREPARED)
+	{
+		xl_xact_parsed_commit parsed;
+
+		ParseCommitRecord(XLogRecGetInfo(record),
+						  (xl_xact_commit *) XLogRecGetData(record),
+						  &parsed);
+		*apply_feedback = XactCompletionApplyFeedback(parsed.xinfo);
+		return parsed.nrels > 0;
+	}
+	else if (info == XLOG_XACT_ABORT || info == XLOG_XACT_ABORT_PREPARED)
+	{
+		xl_xact_parsed_abort parsed;
+
+		ParseAbortRecord(XLogRecGetInfo(record),
+						 (xl_xact_abort *) XLogRecGetData(record),
+						 &parsed);
+		return parsed.nrels > 0;
+	}
+
+	return false;
+}
+
+/*
+ * Must the redo workers finish all earlier records before the startup
+ * process replays this one?
+ *
+ * This is true for almost everything that the workers can't replay
+ * themselves.  The exceptions are records that don't touch any relation
+ * pages and whose effects can't be observed before the workers catch up.
+ */
+bool
+RedoWorkerNeedsBarrier(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	bool		apply_feedback;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_XACT_ID:
+
+			/*
+			 * Without hot standby, nobody can see the order in which
+			 * transaction status and page changes are replayed.  But dropped
+			 * relations must not be touched by workers anymore, and a
+			 * remote_apply waiter must see the whole transaction replayed.
+			 */
+			if (standbyState == STANDBY_DISABLED)
+				return RedoXactDropsRelations(record, &apply_feedback) ||
+					apply_feedback;
+			break;
+
+		case RM_STANDBY_ID:
+			/* these only matter for hot standby */
+			if (standbyState == STANDBY_DISABLED)
+				return false;
+			break;
+
+		case RM_HEAP2_ID:
+			/* nothing to replay */
+			if ((info & XLOG_HEAP_OPMASK) == XLOG_HEAP2_NEW_CID)
+				return false;
+			break;
+	}
+
+	return true;
+}
+
+/*
+ * Let the redo workers know about relations dropped or truncated by a record
+ * that the startup process just replayed.
+ *
+ * Workers may have cached the sizes of those relations, or have files open
+ * that were just unlinked.  They release them before their next record.
+ */
+void
+RedoWorkerAfterSerialRecord(XLogReaderState *record)
+{
+	bool		apply_feedback;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_SMGR_ID:
+		case RM_DBASE_ID:
+		case RM_TBLSPC_ID:
+			break;
+
+		case RM_XACT_ID:
+			if (RedoXactDropsRelations(record, &apply_feedback))
+				break;
+			return;
+
+		default:
+			return;
+	}
+
+	pg_atomic_fetch_add_u32(&RedoWorkerCtl->smgr_generation, 1);
+}
+
+/*
+ * Accept invalid-page references from the workers, and make sure they're all
+ * still alive.  Called by the startup process whenever it waits for workers.
+ */
+static void
+RedoWorkersCheck(void)
+{
+	for (int i = 0; i < num_redo_workers; i++)
+	{
+		RedoWorkerSlot *slot = &RedoWorkerCtl->slots[i];
+		RedoInvalidPage pages[REDO_MAX_INVALID_PAGES];
+		int			npages;
+		pid_t		pid;
+
+		SpinLockAcquire(&slot->mutex);
+		npages = slot->ninvalid;
+		memcpy(pages, slot->invalid, npages * sizeof(RedoInvalidPage));
+		slot->ninvalid = 0;
+		SpinLockRelease(&slot->mutex);
+
+		if (npages > 0)
+		{
+			/* The worker might be waiting for room */
+			if (slot->latch != NULL)
+				SetLatch(slot->latch);
+
+			for (int j = 0; j < npages; j++)
+				XLogRememberInvalidPage(pages[j].node, pages[j].forkno,
+										pages[j].blkno, pages[j].present);
+		}
+
+		if (GetBackgroundWorkerPid(redo_worker_handles[i], &pid) != BGWH_STARTED)
+			ereport(FATAL,
+					(errmsg("redo worker %d terminated unexpectedly", i)));
+	}
+}
+
+/*
+ * Wait for redo workers to make progress.
+ */
+static void
+RedoWorkersWait(void)
+{
+	Latch	   *latch = RedoWorkerCtl->startupLatch;
+
+	RedoWorkersCheck();
+
+	(void) WaitLatch(latch,
+					 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+					 REDO_WAIT_TIMEOUT_MS, WAIT_EVENT_RECOVERY_REDO_WORKERS);
+	ResetLatch(latch);
+
+	HandleStartupProcInterrupts();
+}
+
+/*
+ * Wait for redo workers to replay all records handed to them.
+ *
+ * Afterwards, the startup process can safely replay any record itself.
+ */
+void
+RedoWorkersWaitIdle(void)
+{
+	for (;;)
+	{
+		bool		idle = true;
+
+		for (int i = 0; i < num_redo_workers; i++)
+		{
+			RedoWorkerSlot *slot = &RedoWorkerCtl->slots[i];
+
+			if (pg_atomic_read_u64(&slot->tail) !=
+				pg_atomic_read_u64(&slot->head))
+			{
+				idle = false;
+				break;
+			}
+		}
+
+		if (idle)
+			break;
+
+		RedoWorkersWait();
+	}
+
+	/* Collect any invalid-page references from the last records */
+	pg_memory_barrier();
+	RedoWorkersCheck();
+
+	/*
+	 * The workers might have extended relations whose size we have cached,
+	 * and XLogReadBufferExtended() trusts the cache during recovery.
+	 */
+	smgrresetnblocks();
+}
+
+/*
+ * Shut down redo workers.  They must be idle.
+ */
+void
+RedoWorkersStop(void)
+{
+	if (num_redo_workers == 0)
+		return;
+
+	RedoWorkerCtl->shutdown = true;
+	pg_memory_barrier();
+
+	for (int i = 0; i < num_redo_workers; i++)
+	{
+		RedoWorkerSlot *slot = &RedoWorkerCtl->slots[i];
+
+		Assert(pg_atomic_read_u64(&slot->tail) ==
+			   pg_atomic_read_u64(&slot->head));
+
+		if (slot->latch != NULL)
+			SetLatch(slot->latch);
+		else
+			TerminateBackgroundWorker(redo_worker_handles[i]);
+	}
+
+	for (int i = 0; i < num_redo_workers; i++)
+	{
+		pid_t		pid;
+
+		while (GetBackgroundWorkerPid(redo_worker_handles[i], &pid) != BGWH_STOPPED)
+		{
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 10L, WAIT_EVENT_RECOVERY_REDO_WORKERS);
+			ResetLatch(MyLatch);
+			HandleStartupProcInterrupts();
+		}
+		pfree(redo_worker_handles[i]);
+	}
+
+	num_redo_workers = 0;
+}
+
+/*
+ * Is this process a redo worker?
+ */
+bool
+IsRedoWorker(void)
+{
+	return MyRedoWorkerId >= 0;
+}
+
+/*
+ * Return the lock that serializes extension of the given relation fork
+ * between redo workers.
+ */
+LWLock *
+RedoWorkerExtensionLock(RelFileNode rnode, ForkNumber forknum)
+{
+	uint32		hash;
+
+	hash = hash_combine(hash_bytes_uint32(rnode.relNode),
+						hash_bytes_uint32((uint32) forknum));
+
+	return &RedoWorkerCtl->extension_locks[hash % NUM_REDO_EXTENSION_LOCKS].lock;
+}
+
+/*
+ * Hand a reference to an invalid page over to the startup process, which
+ * keeps track of them.  See log_invalid_page().
+ */
+void
+RedoWorkerLogInvalidPage(RelFileNode node, ForkNumber forkno,
+						 BlockNumber blkno, bool present)
+{
+	RedoWorkerSlot *slot = &RedoWorkerCtl->slots[MyRedoWorkerId];
+
+	Assert(IsRedoWorker());
+
+	for (;;)
+	{
+		SpinLockAcquire(&slot->mutex);
+		if (slot->ninvalid < REDO_MAX_INVALID_PAGES)
+		{
+			RedoInvalidPage *page = &slot->invalid[slot->ninvalid++];
+
+			page->node = node;
+			page->forkno = forkno;
+			page->blkno = blkno;
+			page->present = present;
+			SpinLockRelease(&slot->mutex);
+			break;
+		}
+		SpinLockRelease(&slot->mutex);
+
+		/* Wait for the startup process to collect the ones we have */
+		SetLatch(RedoWorkerCtl->startupLatch);
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+						 WAIT_EVENT_RECOVERY_REDO_WORKERS);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Error context callback for errors occurring while replaying a record.
+ */
+static void
+redo_worker_error_callback(void *arg)
+{
+	XLogReaderState *record = (XLogReaderState *) arg;
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	xlog_outdesc(&buf, record);
+
+	/* translator: %s is a WAL record description */
+	errcontext("WAL redo at %X/%X for %s",
+			   LSN_FORMAT_ARGS(record->ReadRecPtr),
+			   buf.data);
+
+	pfree(buf.data);
+}
+
+/*
+ * Replay one record from our queue.
+ */
+static void
+RedoWorkerReplay(XLogReaderState *reader, RedoQueueEntry *entry,
+				 MemoryContext redo_context)
+{
+	DecodedXLogRecord *decoded;
+	char	   *copy;
+	ErrorContextCallback errcallback;
+	MemoryContext oldcontext;
+
+	copy = (char *) entry + REDO_ENTRY_HEADER_SIZE;
+	decoded = (DecodedXLogRecord *) copy;
+
+	/*
+	 * The data of the record lies within the decoded record itself, so point
+	 * into our copy instead of the startup process's decode buffer.
+	 */
+	decoded->next = NULL;
+	if (decoded->main_data != NULL)
+		decoded->main_data = copy + (decoded->main_data - entry->orig);
+	for (int block_id = 0; block_id <= decoded->max_block_id; block_id++)
+	{
+		DecodedBkpBlock *blk = &decoded->blocks[block_id];
+
+		if (!blk->in_use)
+			continue;
+		if (blk->has_image)
+			blk->bkp_image = copy + (blk->bkp_image - entry->orig);
+		if (blk->has_data)
+			blk->data = copy + (blk->data - entry->orig);
+	}
+
+	reader->record = decoded;
+	reader->ReadRecPtr = decoded->lsn;
+	reader->EndRecPtr = decoded->next_lsn;
+
+	/* XLogFlush of the pages we modify must cover this record; see above */
+	Assert(reader->EndRecPtr <= GetCurrentReplayRecPtr(NULL));
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = redo_worker_error_callback;
+	errcallback.arg = (void *) reader;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	oldcontext = MemoryContextSwitchTo(redo_context);
+	GetRmgr(decoded->header.xl_rmid).rm_redo(reader);
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	MemoryContextReset(redo_context);
+	reader->record = NULL;
+}
+
+/*
+ * Main entry point for a redo worker.
+ */
+void
+RedoWorkerMain(Datum main_arg)
+{
+	RedoWorkerSlot *slot;
+	char	   *queue;
+	XLogReaderState *reader;
+	MemoryContext redo_context;
+	uint32		smgr_generation;
+	uint64		tail;
+
+	/* Allow redo to finish the current record when asked to shut down */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	MyRedoWorkerId = DatumGetInt32(main_arg);
+	slot = &RedoWorkerCtl->slots[MyRedoWorkerId];
+	queue = RedoWorkerQueue(MyRedoWorkerId);
+
+	/* Redo routines behave differently when InRecovery is set */
+	InRecovery = true;
+
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "redo worker");
+	redo_context = AllocSetContextCreate(TopMemoryContext,
+										 "Redo worker",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	reader = XLogReaderAllocate(wal_segment_size, NULL, XL_ROUTINE(), NULL);
+	if (!reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	RmgrStartup();
+
+	smgr_generation = pg_atomic_read_u32(&RedoWorkerCtl->smgr_generation);
+	tail = pg_atomic_read_u64(&slot->tail);
+
+	/* Advertise our latch, then look for work */
+	slot->latch = MyLatch;
+	pg_memory_barrier();
+
+	for (;;)
+	{
+		uint64		head;
+
+		CHECK_FOR_INTERRUPTS();
+
+		head = pg_atomic_read_u64(&slot->head);
+		if (head == tail)
+		{
+			if (((volatile RedoWorkerCtlData *) RedoWorkerCtl)->shutdown)
+				break;
+
+			(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+							 WAIT_EVENT_REDO_WORKER_MAIN);
+			ResetLatch(MyLatch);
+			continue;
+		}
+
+		/* Don't read the entries before we've seen the head move */
+		pg_read_barrier();
+
+		while (tail != head)
+		{
+			Size		offset = tail % REDO_QUEUE_SIZE;
+			RedoQueueEntry *entry = (RedoQueueEntry *) (queue + offset);
+			Size		size = entry->size;
+			uint32		generation;
+
+			if (size == 0)
+			{
+				/* wraparound */
+				tail += REDO_QUEUE_SIZE - offset;
+				continue;
+			}
+
+			/* Forget about relations the startup process dropped */
+			generation = pg_atomic_read_u32(&RedoWorkerCtl->smgr_generation);
+			if (generation != smgr_generation)
+			{
+				smgrreleaseall();
+				smgr_generation = generation;
+			}
+
+			RedoWorkerReplay(reader, entry, redo_context);
+
+			/* Release the space only after we're done with it */
+			tail += size;
+			pg_memory_barrier();
+			pg_atomic_write_u64(&slot->tail, tail);
+
+			SetLatch(RedoWorkerCtl->startupLatch);
+		}
+	}
+
+	RmgrCleanup();
+	XLogReaderFree(reader);
+}
@@ -47,6 +47,32 @@ XLogRecGetLen(XLogReaderState *record, uint32 *rec_len,
 	*rec_len = XLogRecGetTotalLen(record) - *fpi_len;
 }
 
+/*
+ * Count the full-page images in a record, and the number of bytes they would
+ * take without compression.  That is the page size less the "hole", which is
+ * removed whether or not the image is compressed.
+ */
+static void
+XLogRecGetFPIRawLen(XLogReaderState *record, uint32 *fpi_count,
+					uint32 *fpi_raw_len)
+{
+	int			block_id;
+
+	*fpi_count = 0;
+	*fpi_raw_len = 0;
+	for (block_id = 0; block_id <= XLogRecMaxBlockId(record); block_id++)
+	{
+		if (!XLogRecHasBlockRef(record, block_id))
+			continue;
+
+		if (XLogRecHasBlockImage(record, block_id))
+		{
+			(*fpi_count)++;
+			*fpi_raw_len += BLCKSZ - XLogRecGetBlock(record, block_id)->hole_length;
+		}
+	}
+}
+
 /*
  * Store per-rmgr and per-record statistics for a given record.
  */
@@ -57,6 +83,8 @@ XLogRecStoreStats(XLogStats *stats, XLogReaderState *record)
 	uint8		recid;
 	uint32		rec_len;
 	uint32		fpi_len;
+	uint32		fpi_count;
+	uint32		fpi_raw_len;
 
 	Assert(stats != NULL && record != NULL);
 
@@ -65,12 +93,15 @@ XLogRecStoreStats(XLogStats *stats, XLogReaderState *record)
 	rmid = XLogRecGetRmid(record);
 
 	XLogRecGetLen(record, &rec_len, &fpi_len);
+	XLogRecGetFPIRawLen(record, &fpi_count, &fpi_raw_len);
 
 	/* Update per-rmgr statistics */
 
 	stats->rmgr_stats[rmid].count++;
 	stats->rmgr_stats[rmid].rec_len += rec_len;
 	stats->rmgr_stats[rmid].fpi_len += fpi_len;
+	stats->rmgr_stats[rmid].fpi_count += fpi_count;
+	stats->rmgr_stats[rmid].fpi_raw_len += fpi_raw_len;
 
 	/*
 	 * Update per-record statistics, where the record is identified by a
@@ -93,4 +124,6 @@ XLogRecStoreStats(XLogStats *stats, XLogReaderState *record)
 	stats->record_stats[rmid][recid].count++;
 	stats->record_stats[rmid][recid].rec_len += rec_len;
 	stats->record_stats[rmid][recid].fpi_len += fpi_len;
+	stats->record_stats[rmid][recid].fpi_count += fpi_count;
+	stats->record_stats[rmid][recid].fpi_raw_len += fpi_raw_len;
 }
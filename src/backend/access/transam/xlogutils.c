@@ -23,6 +23,7 @@
 #include "access/xlogrecovery.h"
 #include "access/xlog_internal.h"
 #include "access/xlogprefetcher.h"
+#include "access/xlogredoworker.h"
 #include "access/xlogutils.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -109,6 +110,13 @@ log_invalid_page(RelFileNode node, ForkNumber forkno, BlockNumber blkno,
 	xl_invalid_page *hentry;
 	bool		found;
 
+	/* Redo workers leave the bookkeeping to the startup process */
+	if (IsRedoWorker())
+	{
+		RedoWorkerLogInvalidPage(node, forkno, blkno, present);
+		return;
+	}
+
 	/*
 	 * Once recovery has reached a consistent state, the invalid-page table
 	 * should be empty and remain so. If a reference to an invalid page is
@@ -232,6 +240,14 @@ forget_invalid_pages_db(Oid dbid)
 	}
 }
 
+/* Log a reference to an invalid page reported by a redo worker */
+void
+XLogRememberInvalidPage(RelFileNode node, ForkNumber forkno,
+						BlockNumber blkno, bool present)
+{
+	log_invalid_page(node, forkno, blkno, present);
+}
+
 /* Are there any unresolved references to invalid pages? */
 bool
 XLogHaveInvalidPages(void)
@@ -475,6 +491,7 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 	BlockNumber lastblock;
 	Buffer		buffer;
 	SMgrRelation smgr;
+	LWLock	   *extension_lock = NULL;
 
 	Assert(blkno != P_NEW);
 
@@ -502,6 +519,19 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 
 	lastblock = smgrnblocks(smgr, forknum);
 
+	/*
+	 * Redo workers replay records concurrently, so another worker might have
+	 * extended the relation since we cached its size.  Recheck, and extend
+	 * it if necessary, while holding the extension lock.
+	 */
+	if (blkno >= lastblock && IsRedoWorker())
+	{
+		extension_lock = RedoWorkerExtensionLock(rnode, forknum);
+		LWLockAcquire(extension_lock, LW_EXCLUSIVE);
+		smgr->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+		lastblock = smgrnblocks(smgr, forknum);
+	}
+
 	if (blkno < lastblock)
 	{
 		/* page exists in file */
@@ -513,13 +543,22 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 		/* hm, page doesn't exist in file */
 		if (mode == RBM_NORMAL)
 		{
+			if (extension_lock)
+				LWLockRelease(extension_lock);
 			log_invalid_page(rnode, forknum, blkno, false);
 			return InvalidBuffer;
 		}
 		if (mode == RBM_NORMAL_NO_LOG)
+		{
+			if (extension_lock)
+				LWLockRelease(extension_lock);
 			return InvalidBuffer;
+		}
 		/* OK to extend the file */
-		/* we do this in recovery only - no rel-extension lock needed */
+		/*
+		 * we do this in recovery only - no rel-extension lock needed, except
+		 * between redo workers (see above)
+		 */
 		Assert(InRecovery);
 		buffer = InvalidBuffer;
 		do
@@ -545,6 +584,9 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 		}
 	}
 
+	if (extension_lock)
+		LWLockRelease(extension_lock);
+
 recent_buffer_fast_path:
 	if (mode == RBM_NORMAL)
 	{
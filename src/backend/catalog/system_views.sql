@@ -1115,6 +1115,16 @@ CREATE VIEW pg_stat_bgwriter AS
         pg_stat_get_buf_alloc() AS buffers_alloc,
         pg_stat_get_bgwriter_stat_reset_time() AS stats_reset;
 
+CREATE VIEW pg_stat_buffer_strategy AS
+    SELECT
+            s.freelist_allocs,
+            s.clock_sweep_allocs,
+            s.buffers_scanned,
+            s.avg_sweep_distance,
+            s.max_sweep_distance,
+            s.stats_reset
+     FROM pg_stat_get_buffer_strategy() s;
+
 CREATE VIEW pg_stat_wal AS
     SELECT
         w.wal_records,
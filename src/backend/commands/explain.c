@@ -81,6 +81,8 @@ static void show_scan_qual(List *qual, const char *qlabel,
 static void show_upper_qual(List *qual, const char *qlabel,
 							PlanState *planstate, List *ancestors,
 							ExplainState *es);
+static void show_runtime_filters(PlanState *planstate, List *ancestors,
+								 ExplainState *es);
 static void show_sort_keys(SortState *sortstate, List *ancestors,
 						   ExplainState *es);
 static void show_incremental_sort_keys(IncrementalSortState *incrsortstate,
@@ -109,6 +111,7 @@ static void show_sort_info(SortState *sortstate, ExplainState *es);
 static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
 									   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_adaptive_join_info(HashJoinState *hjstate, ExplainState *es);
 static void show_memoize_info(MemoizeState *mstate, List *ancestors,
 							  ExplainState *es);
 static void show_hashagg_info(AggState *hashstate, ExplainState *es);
@@ -1219,8 +1222,16 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			sname = "Merge Join";
 			break;
 		case T_HashJoin:
-			pname = "Hash";		/* "Join" gets added by jointype switch */
-			sname = "Hash Join";
+			if (((HashJoin *) plan)->nlinner != NULL)
+			{
+				pname = "Adaptive"; /* "Join" gets added by jointype switch */
+				sname = "Adaptive Join";
+			}
+			else
+			{
+				pname = "Hash"; /* "Join" gets added by jointype switch */
+				sname = "Hash Join";
+			}
 			break;
 		case T_SeqScan:
 			pname = sname = "Seq Scan";
@@ -1751,6 +1762,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			show_runtime_filters(planstate, ancestors, es);
 			break;
 		case T_IndexOnlyScan:
 			show_scan_qual(((IndexOnlyScan *) plan)->indexqual,
@@ -1782,6 +1794,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			show_runtime_filters(planstate, ancestors, es);
 			if (es->analyze)
 				show_tidbitmap_info((BitmapHeapScanState *) planstate, es);
 			break;
@@ -1800,6 +1813,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			show_runtime_filters(planstate, ancestors, es);
 			break;
 		case T_Gather:
 			{
@@ -1979,11 +1993,17 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 2,
 										   planstate, es);
+			if (((HashJoin *) plan)->radix_partition)
+				ExplainPropertyBool("Radix Partitioned", true, es);
+			if (((HashJoin *) plan)->nlinner != NULL)
+				show_adaptive_join_info(castNode(HashJoinState, planstate), es);
 			break;
 		case T_Agg:
 			show_agg_keys(castNode(AggState, planstate), ancestors, es);
 			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
 			show_hashagg_info((AggState *) planstate, es);
+			if (((AggState *) planstate)->batch != NULL)
+				ExplainPropertyText("Execution Mode", "batch", es);
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
@@ -2177,6 +2197,11 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			ExplainNode(((SubqueryScanState *) planstate)->subplan, ancestors,
 						"Subquery", NULL, es);
 			break;
+		case T_HashJoin:
+			if (((HashJoinState *) planstate)->hj_NestLoopInner)
+				ExplainNode(((HashJoinState *) planstate)->hj_NestLoopInner,
+							ancestors, "Inner", "Nested Loop Inner", es);
+			break;
 		case T_CustomScan:
 			ExplainCustomChildren((CustomScanState *) planstate,
 								  ancestors, es);
@@ -2335,6 +2360,43 @@ show_upper_qual(List *qual, const char *qlabel,
 	show_qual(qual, qlabel, planstate, ancestors, useprefix, es);
 }
 
+/*
+ * Show the hash keys of the runtime filters pushed down to a scan node, and
+ * how many rows the filters removed
+ */
+static void
+show_runtime_filters(PlanState *planstate, List *ancestors, ExplainState *es)
+{
+	Scan	   *scan = (Scan *) planstate->plan;
+	List	   *context;
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	if (scan->rtfilters == NIL)
+		return;
+
+	/* Set up deparsing context */
+	context = set_deparse_context_plan(es->deparse_cxt,
+									   planstate->plan,
+									   ancestors);
+
+	foreach(lc, scan->rtfilters)
+	{
+		RuntimeFilter *rf = lfirst_node(RuntimeFilter, lc);
+		char	   *exprstr;
+
+		exprstr = deparse_expression((Node *) rf->hashkeys, context,
+									 es->verbose, false);
+		if (list_length(rf->hashkeys) > 1)
+			exprstr = psprintf("(%s)", exprstr);
+		result = lappend(result, exprstr);
+	}
+
+	ExplainPropertyList("Runtime Filters", result, es);
+	show_instrumentation_count("Rows Removed by Runtime Filter", 3,
+							   planstate, es);
+}
+
 /*
  * Show the sort keys for a Sort node.
  */
@@ -2757,6 +2819,11 @@ show_sort_info(SortState *sortstate, ExplainState *es)
 		}
 	}
 
+	/* input tuples dropped because of a top-N bound shared with siblings */
+	if (sortstate->sortbound != NULL)
+		ExplainPropertyInteger("Rows Skipped by Top-N Bound", NULL,
+							   sortstate->bound_skipped, es);
+
 	/*
 	 * You might think we should just skip this stanza entirely when
 	 * es->hide_workers is true, but then we'd get no sort-method output at
@@ -3060,6 +3127,8 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 											  worker_hi->nbatch_original);
 			hinstrument.space_peak = Max(hinstrument.space_peak,
 										 worker_hi->space_peak);
+			hinstrument.radix_partitions = Max(hinstrument.radix_partitions,
+											   worker_hi->radix_partitions);
 		}
 	}
 
@@ -3100,6 +3169,54 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 							 hinstrument.nbuckets, hinstrument.nbatch,
 							 spacePeakKb);
 		}
+
+		if (hinstrument.radix_partitions > 0)
+			ExplainPropertyInteger("Radix Partitions", NULL,
+								   hinstrument.radix_partitions, es);
+	}
+}
+
+/*
+ * Show the switch threshold of an adaptive join, and which of its
+ * strategies were used.
+ */
+static void
+show_adaptive_join_info(HashJoinState *hjstate, ExplainState *es)
+{
+	HashJoin   *plan = (HashJoin *) hjstate->js.ps.plan;
+
+	/* The threshold is derived from cost estimates */
+	if (es->costs)
+		ExplainPropertyFloat("Switch Threshold", "rows", plan->nl_max_rows,
+							 0, es);
+
+	if (!es->analyze)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyUInteger("Nested Loop Scans", NULL,
+								hjstate->hj_NestLoopScans, es);
+		ExplainPropertyUInteger("Hash Scans", NULL,
+								hjstate->hj_HashScans, es);
+	}
+	else if (hjstate->hj_HashScans == 0 && hjstate->hj_NestLoopScans > 0)
+	{
+		ExplainIndentText(es);
+		appendStringInfoString(es->str, "Strategy Used: Nested Loop\n");
+	}
+	else if (hjstate->hj_NestLoopScans == 0 && hjstate->hj_HashScans > 0)
+	{
+		ExplainIndentText(es);
+		appendStringInfoString(es->str, "Strategy Used: Hash\n");
+	}
+	else if (hjstate->hj_NestLoopScans > 0)
+	{
+		ExplainIndentText(es);
+		appendStringInfo(es->str,
+						 "Strategy Used: Nested Loop (" UINT64_FORMAT " scans), Hash (" UINT64_FORMAT " scans)\n",
+						 hjstate->hj_NestLoopScans,
+						 hjstate->hj_HashScans);
 	}
 }
 
@@ -3176,17 +3293,22 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 			ExplainPropertyInteger("Cache Misses", NULL, mstate->stats.cache_misses, es);
 			ExplainPropertyInteger("Cache Evictions", NULL, mstate->stats.cache_evictions, es);
 			ExplainPropertyInteger("Cache Overflows", NULL, mstate->stats.cache_overflows, es);
+			ExplainPropertyInteger("Cache Bypasses", NULL, mstate->stats.cache_bypasses, es);
 			ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
 		}
 		else
 		{
 			ExplainIndentText(es);
 			appendStringInfo(es->str,
-							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT "  Memory Usage: " INT64_FORMAT "kB\n",
+							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT,
 							 mstate->stats.cache_hits,
 							 mstate->stats.cache_misses,
 							 mstate->stats.cache_evictions,
-							 mstate->stats.cache_overflows,
+							 mstate->stats.cache_overflows);
+			if (mstate->stats.cache_bypasses > 0)
+				appendStringInfo(es->str, "  Bypasses: " UINT64_FORMAT,
+								 mstate->stats.cache_bypasses);
+			appendStringInfo(es->str, "  Memory Usage: " INT64_FORMAT "kB\n",
 							 memPeakKb);
 		}
 	}
@@ -3223,9 +3345,13 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 		{
 			ExplainIndentText(es);
 			appendStringInfo(es->str,
-							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT "  Memory Usage: " INT64_FORMAT "kB\n",
+							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT,
 							 si->cache_hits, si->cache_misses,
-							 si->cache_evictions, si->cache_overflows,
+							 si->cache_evictions, si->cache_overflows);
+			if (si->cache_bypasses > 0)
+				appendStringInfo(es->str, "  Bypasses: " UINT64_FORMAT,
+								 si->cache_bypasses);
+			appendStringInfo(es->str, "  Memory Usage: " INT64_FORMAT "kB\n",
 							 memPeakKb);
 		}
 		else
@@ -3238,6 +3364,8 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 								   si->cache_evictions, es);
 			ExplainPropertyInteger("Cache Overflows", NULL,
 								   si->cache_overflows, es);
+			ExplainPropertyInteger("Cache Bypasses", NULL,
+								   si->cache_bypasses, es);
 			ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb,
 								   es);
 		}
@@ -3412,7 +3540,9 @@ show_instrumentation_count(const char *qlabel, int which,
 	if (!es->analyze || !planstate->instrument)
 		return;
 
-	if (which == 2)
+	if (which == 3)
+		nfiltered = planstate->instrument->nfiltered3;
+	else if (which == 2)
 		nfiltered = planstate->instrument->nfiltered2;
 	else
 		nfiltered = planstate->instrument->nfiltered1;
@@ -0,0 +1,1160 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Support routines for batch-at-a-time (vectorized) execution
+ *
+ * When enable_batch_execution is on, a plain aggregate directly above a
+ * sequential scan pulls whole batches of up to EXEC_BATCH_SIZE rows from the
+ * scan instead of one tuple at a time.  The table AM deforms all the rows of
+ * a batch in one go, the scan quals narrow a selection vector column by
+ * column, and the aggregate transition functions run over the selected
+ * rows in tight loops.
+ *
+ * Only a small set of expressions can be evaluated this way: Vars, Consts
+ * and the comparison and arithmetic operators of int4, int8, float8 and
+ * date, combined with AND in quals.  The aggregates supported are count,
+ * sum and avg of int4 and float8, and min and max of int4, int8, float8 and
+ * date.  Anything else makes ExecInitBatchAgg() return NULL, and the plan
+ * runs in the normal row-at-a-time mode.  The batch code must produce the
+ * same results and raise the same errors as the row-at-a-time functions it
+ * replaces.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "catalog/pg_aggregate.h"
+#include "catalog/pg_type.h"
+#include "common/int.h"
+#include "executor/execBatch.h"
+#include "executor/executor.h"
+#include "executor/nodeSeqscan.h"
+#include "nodes/nodeFuncs.h"
+#include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/float.h"
+#include "utils/fmgroids.h"
+
+/* GUC */
+bool		enable_batch_execution = false;
+
+typedef enum BatchExprKind
+{
+	BATCH_EXPR_VAR,
+	BATCH_EXPR_CONST,
+	BATCH_EXPR_OP
+} BatchExprKind;
+
+typedef enum BatchOp
+{
+	BATCH_OP_EQ,
+	BATCH_OP_NE,
+	BATCH_OP_LT,
+	BATCH_OP_LE,
+	BATCH_OP_GT,
+	BATCH_OP_GE,
+	BATCH_OP_PL,
+	BATCH_OP_MI,
+	BATCH_OP_MUL
+} BatchOp;
+
+/*
+ * A compiled expression.  The result for row i of the batch is stored in
+ * values[i] and isnull[i]; only the selected rows are computed.  A Const
+ * fills the whole arrays once, when it is built.
+ */
+struct BatchExpr
+{
+	BatchExprKind kind;
+	Oid			type;			/* result type */
+	int			attno;			/* VAR: 0-based column in the batch */
+	BatchOp		op;				/* OP: operator */
+	Oid			argtype;		/* OP: type of both arguments */
+	BatchExpr  *left;			/* OP: arguments */
+	BatchExpr  *right;
+	Datum	   *values;			/* EXEC_BATCH_SIZE results */
+	bool	   *isnull;
+};
+
+/* The operator functions we know how to evaluate over a batch */
+typedef struct BatchOpInfo
+{
+	Oid			funcid;
+	Oid			argtype;
+	BatchOp		op;
+} BatchOpInfo;
+
+static const BatchOpInfo batch_op_info[] =
+{
+	{F_INT4EQ, INT4OID, BATCH_OP_EQ},
+	{F_INT4NE, INT4OID, BATCH_OP_NE},
+	{F_INT4LT, INT4OID, BATCH_OP_LT},
+	{F_INT4LE, INT4OID, BATCH_OP_LE},
+	{F_INT4GT, INT4OID, BATCH_OP_GT},
+	{F_INT4GE, INT4OID, BATCH_OP_GE},
+	{F_INT4PL, INT4OID, BATCH_OP_PL},
+	{F_INT4MI, INT4OID, BATCH_OP_MI},
+	{F_INT4MUL, INT4OID, BATCH_OP_MUL},
+	{F_INT8EQ, INT8OID, BATCH_OP_EQ},
+	{F_INT8NE, INT8OID, BATCH_OP_NE},
+	{F_INT8LT, INT8OID, BATCH_OP_LT},
+	{F_INT8LE, INT8OID, BATCH_OP_LE},
+	{F_INT8GT, INT8OID, BATCH_OP_GT},
+	{F_INT8GE, INT8OID, BATCH_OP_GE},
+	{F_INT8PL, INT8OID, BATCH_OP_PL},
+	{F_INT8MI, INT8OID, BATCH_OP_MI},
+	{F_INT8MUL, INT8OID, BATCH_OP_MUL},
+	{F_FLOAT8EQ, FLOAT8OID, BATCH_OP_EQ},
+	{F_FLOAT8NE, FLOAT8OID, BATCH_OP_NE},
+	{F_FLOAT8LT, FLOAT8OID, BATCH_OP_LT},
+	{F_FLOAT8LE, FLOAT8OID, BATCH_OP_LE},
+	{F_FLOAT8GT, FLOAT8OID, BATCH_OP_GT},
+	{F_FLOAT8GE, FLOAT8OID, BATCH_OP_GE},
+	{F_FLOAT8PL, FLOAT8OID, BATCH_OP_PL},
+	{F_FLOAT8MI, FLOAT8OID, BATCH_OP_MI},
+	{F_FLOAT8MUL, FLOAT8OID, BATCH_OP_MUL},
+	{F_DATE_EQ, DATEOID, BATCH_OP_EQ},
+	{F_DATE_NE, DATEOID, BATCH_OP_NE},
+	{F_DATE_LT, DATEOID, BATCH_OP_LT},
+	{F_DATE_LE, DATEOID, BATCH_OP_LE},
+	{F_DATE_GT, DATEOID, BATCH_OP_GT},
+	{F_DATE_GE, DATEOID, BATCH_OP_GE}
+};
+
+typedef enum BatchAggKind
+{
+	BATCH_AGG_NONE,				/* aggno not used */
+	BATCH_AGG_COUNT_STAR,
+	BATCH_AGG_COUNT,
+	BATCH_AGG_SUM_INT4,
+	BATCH_AGG_SUM_FLOAT8,
+	BATCH_AGG_AVG_INT4,
+	BATCH_AGG_AVG_FLOAT8,
+	BATCH_AGG_MIN,
+	BATCH_AGG_MAX
+} BatchAggKind;
+
+/*
+ * Transition state of one aggregate.  count(any) of a plain column of any
+ * type only looks at the null flags; then nullattno is its column and arg
+ * is NULL.
+ */
+typedef struct BatchAggTrans
+{
+	BatchAggKind kind;
+	Oid			argtype;		/* MIN/MAX: type of the argument */
+	BatchExpr  *arg;			/* argument, NULL for count(*) */
+	int			nullattno;		/* COUNT: column to count, or -1 */
+
+	int64		count;			/* number of non-null inputs */
+	int64		isum;			/* SUM_INT4, AVG_INT4 */
+	float8		fN;				/* SUM_FLOAT8 uses fSx only */
+	float8		fSx;
+	float8		fSxx;
+	Datum		extreme;		/* MIN/MAX, valid if count > 0 */
+} BatchAggTrans;
+
+struct BatchAgg
+{
+	int			numaggs;
+	BatchAggTrans *trans;		/* indexed by aggno */
+};
+
+static bool batch_type_supported(Oid type);
+static int	batch_outer_attno(Var *var, List *outer_tlist);
+static bool batch_flatten_qual(List *qual, List **result);
+static void ExecEvalBatchExpr(BatchExpr *expr, TupleBatch *batch);
+static void batch_eval_op(BatchExpr *expr, TupleBatch *batch);
+static void batch_advance_aggregate(BatchAggTrans *trans, TupleBatch *batch);
+static void batch_finalize_aggregate(BatchAggTrans *trans,
+									 Datum *result, bool *isnull);
+
+/*
+ * Types whose values we can evaluate over a batch.  All of them must be
+ * passed by value, so that results never need to be allocated.
+ */
+static bool
+batch_type_supported(Oid type)
+{
+	switch (type)
+	{
+		case INT4OID:
+		case DATEOID:
+			return true;
+		case INT8OID:
+		case FLOAT8OID:
+			return FLOAT8PASSBYVAL;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Map a Var of an upper node to the 0-based column of the scan below it.
+ *
+ * If outer_tlist is NIL, var belongs to the scan itself; otherwise it is an
+ * OUTER_VAR reference to an entry of outer_tlist, which must be a plain
+ * column of the scanned relation.  Returns -1 if neither is the case.
+ */
+static int
+batch_outer_attno(Var *var, List *outer_tlist)
+{
+	if (outer_tlist != NIL)
+	{
+		TargetEntry *tle;
+
+		if (var->varno != OUTER_VAR || var->varattno <= 0 ||
+			var->varattno > list_length(outer_tlist))
+			return -1;
+		tle = list_nth_node(TargetEntry, outer_tlist, var->varattno - 1);
+		if (!IsA(tle->expr, Var))
+			return -1;
+		var = (Var *) tle->expr;
+	}
+
+	if (IS_SPECIAL_VARNO(var->varno) || var->varattno <= 0 ||
+		var->varlevelsup != 0)
+		return -1;
+
+	return var->varattno - 1;
+}
+
+/*
+ * ExecBuildBatchExpr
+ *		Compile expr for evaluation over batches.
+ *
+ * See batch_outer_attno() for the meaning of outer_tlist.  *maxattno is
+ * raised to cover the columns the expression reads.  Returns NULL if the
+ * expression cannot be evaluated in batch mode.
+ */
+BatchExpr *
+ExecBuildBatchExpr(Expr *expr, List *outer_tlist, int *maxattno)
+{
+	BatchExpr  *result;
+
+	switch (nodeTag(expr))
+	{
+		case T_Var:
+			{
+				Var		   *var = (Var *) expr;
+				int			attno;
+
+				if (!batch_type_supported(var->vartype))
+					return NULL;
+				attno = batch_outer_attno(var, outer_tlist);
+				if (attno < 0)
+					return NULL;
+
+				result = palloc0(sizeof(BatchExpr));
+				result->kind = BATCH_EXPR_VAR;
+				result->type = var->vartype;
+				result->attno = attno;
+				*maxattno = Max(*maxattno, attno + 1);
+				break;
+			}
+		case T_Const:
+			{
+				Const	   *con = (Const *) expr;
+
+				if (!batch_type_supported(con->consttype))
+					return NULL;
+
+				result = palloc0(sizeof(BatchExpr));
+				result->kind = BATCH_EXPR_CONST;
+				result->type = con->consttype;
+				result->values = palloc(sizeof(Datum) * EXEC_BATCH_SIZE);
+				result->isnull = palloc(sizeof(bool) * EXEC_BATCH_SIZE);
+				for (int i = 0; i < EXEC_BATCH_SIZE; i++)
+				{
+					result->values[i] = con->constvalue;
+					result->isnull[i] = con->constisnull;
+				}
+				return result;
+			}
+		case T_OpExpr:
+			{
+				OpExpr	   *op = (OpExpr *) expr;
+				const BatchOpInfo *info = NULL;
+				BatchExpr  *left;
+				BatchExpr  *right;
+
+				if (list_length(op->args) != 2 || op->opretset)
+					return NULL;
+
+				set_opfuncid(op);
+				for (int i = 0; i < lengthof(batch_op_info); i++)
+				{
+					if (batch_op_info[i].funcid == op->opfuncid)
+					{
+						info = &batch_op_info[i];
+						break;
+					}
+				}
+				if (info == NULL || !batch_type_supported(info->argtype))
+					return NULL;
+
+				left = ExecBuildBatchExpr(linitial(op->args), outer_tlist,
+										  maxattno);
+				right = ExecBuildBatchExpr(lsecond(op->args), outer_tlist,
+										   maxattno);
+				if (left == NULL || right == NULL ||
+					left->type != info->argtype ||
+					right->type != info->argtype)
+					return NULL;
+
+				result = palloc0(sizeof(BatchExpr));
+				result->kind = BATCH_EXPR_OP;
+				result->op = info->op;
+				result->argtype = info->argtype;
+				result->type = info->op >= BATCH_OP_PL ? info->argtype : BOOLOID;
+				result->left = left;
+				result->right = right;
+				break;
+			}
+		default:
+			return NULL;
+	}
+
+	result->values = palloc(sizeof(Datum) * EXEC_BATCH_SIZE);
+	result->isnull = palloc(sizeof(bool) * EXEC_BATCH_SIZE);
+
+	return result;
+}
+
+/*
+ * Flatten nested ANDs of an implicitly-ANDed qual list.
+ */
+static bool
+batch_flatten_qual(List *qual, List **result)
+{
+	ListCell   *lc;
+
+	foreach(lc, qual)
+	{
+		Expr	   *clause = (Expr *) lfirst(lc);
+
+		if (is_andclause(clause))
+		{
+			if (!batch_flatten_qual(((BoolExpr *) clause)->args, result))
+				return false;
+		}
+		else
+			*result = lappend(*result, clause);
+	}
+
+	return true;
+}
+
+/*
+ * ExecBuildBatchQual
+ *		Compile the implicitly-ANDed qual of a scan for batch evaluation.
+ *
+ * On success, stores a list of BatchExprs in *batchqual (NIL if there is no
+ * qual) and returns true.
+ */
+bool
+ExecBuildBatchQual(List *qual, List **batchqual, int *maxattno)
+{
+	List	   *clauses = NIL;
+	ListCell   *lc;
+
+	*batchqual = NIL;
+	if (!batch_flatten_qual(qual, &clauses))
+		return false;
+
+	foreach(lc, clauses)
+	{
+		BatchExpr  *clause;
+
+		clause = ExecBuildBatchExpr((Expr *) lfirst(lc), NIL, maxattno);
+		if (clause == NULL || clause->type != BOOLOID)
+			return false;
+		*batchqual = lappend(*batchqual, clause);
+	}
+
+	return true;
+}
+
+/*
+ * ExecCreateTupleBatch
+ *		Allocate a batch of EXEC_BATCH_SIZE rows of natts attributes.
+ */
+TupleBatch *
+ExecCreateTupleBatch(int natts)
+{
+	TupleBatch *batch = palloc0(sizeof(TupleBatch));
+
+	batch->natts = natts;
+	batch->values = palloc(sizeof(Datum) * Max(natts, 1) * EXEC_BATCH_SIZE);
+	batch->isnull = palloc(sizeof(bool) * Max(natts, 1) * EXEC_BATCH_SIZE);
+	batch->sel = palloc(sizeof(uint16) * EXEC_BATCH_SIZE);
+
+	return batch;
+}
+
+/*
+ * ExecBatchQual
+ *		Narrow the batch's selection vector to the rows passing all quals.
+ *
+ * Each qual is only evaluated for the rows that passed the previous ones,
+ * just like ExecQual stops at the first false clause.
+ */
+void
+ExecBatchQual(List *batchqual, TupleBatch *batch)
+{
+	ListCell   *lc;
+
+	foreach(lc, batchqual)
+	{
+		BatchExpr  *qual = (BatchExpr *) lfirst(lc);
+		int			nsel = 0;
+
+		if (batch->nsel == 0)
+			break;
+
+		ExecEvalBatchExpr(qual, batch);
+
+		for (int i = 0; i < batch->nsel; i++)
+		{
+			int			row = batch->sel[i];
+
+			if (!qual->isnull[row] && DatumGetBool(qual->values[row]))
+				batch->sel[nsel++] = row;
+		}
+		batch->nsel = nsel;
+	}
+}
+
+/*
+ * Evaluate expr for the selected rows of batch.
+ */
+static void
+ExecEvalBatchExpr(BatchExpr *expr, TupleBatch *batch)
+{
+	switch (expr->kind)
+	{
+		case BATCH_EXPR_VAR:
+			{
+				int			natts = batch->natts;
+				int			attno = expr->attno;
+
+				for (int i = 0; i < batch->nsel; i++)
+				{
+					int			row = batch->sel[i];
+
+					expr->values[row] = batch->values[row * natts + attno];
+					expr->isnull[row] = batch->isnull[row * natts + attno];
+				}
+				break;
+			}
+		case BATCH_EXPR_CONST:
+			/* already filled in */
+			break;
+		case BATCH_EXPR_OP:
+			ExecEvalBatchExpr(expr->left, batch);
+			ExecEvalBatchExpr(expr->right, batch);
+			batch_eval_op(expr, batch);
+			break;
+	}
+}
+
+/*
+ * Arithmetic with the same overflow checks as int4pl() and friends.
+ */
+static inline int32
+batch_int4pl(int32 a, int32 b)
+{
+	int32		result;
+
+	if (unlikely(pg_add_s32_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("integer out of range")));
+	return result;
+}
+
+static inline int32
+batch_int4mi(int32 a, int32 b)
+{
+	int32		result;
+
+	if (unlikely(pg_sub_s32_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("integer out of range")));
+	return result;
+}
+
+static inline int32
+batch_int4mul(int32 a, int32 b)
+{
+	int32		result;
+
+	if (unlikely(pg_mul_s32_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("integer out of range")));
+	return result;
+}
+
+static inline int64
+batch_int8pl(int64 a, int64 b)
+{
+	int64		result;
+
+	if (unlikely(pg_add_s64_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("bigint out of range")));
+	return result;
+}
+
+static inline int64
+batch_int8mi(int64 a, int64 b)
+{
+	int64		result;
+
+	if (unlikely(pg_sub_s64_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("bigint out of range")));
+	return result;
+}
+
+static inline int64
+batch_int8mul(int64 a, int64 b)
+{
+	int64		result;
+
+	if (unlikely(pg_mul_s64_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("bigint out of range")));
+	return result;
+}
+
+/*
+ * Loops applying a strict binary operator to the selected rows, one for
+ * operators that are plain C comparisons and one for function calls.
+ */
+#define BATCH_CMP_LOOP(GETARG, OP) \
+	for (int i = 0; i < nsel; i++) \
+	{ \
+		int			row = sel[i]; \
+		\
+		if (lnull[row] || rnull[row]) \
+			resnull[row] = true; \
+		else \
+		{ \
+			resnull[row] = false; \
+			result[row] = BoolGetDatum(GETARG(lvals[row]) OP GETARG(rvals[row])); \
+		} \
+	}
+
+#define BATCH_FUNC_LOOP(GETARG, SETRESULT, FUNC) \
+	for (int i = 0; i < nsel; i++) \
+	{ \
+		int			row = sel[i]; \
+		\
+		if (lnull[row] || rnull[row]) \
+			resnull[row] = true; \
+		else \
+		{ \
+			resnull[row] = false; \
+			result[row] = SETRESULT(FUNC(GETARG(lvals[row]), GETARG(rvals[row]))); \
+		} \
+	}
+
+/*
+ * Apply an operator to the already evaluated arguments of expr.
+ */
+static void
+batch_eval_op(BatchExpr *expr, TupleBatch *batch)
+{
+	int			nsel = batch->nsel;
+	uint16	   *sel = batch->sel;
+	Datum	   *lvals = expr->left->values;
+	bool	   *lnull = expr->left->isnull;
+	Datum	   *rvals = expr->right->values;
+	bool	   *rnull = expr->right->isnull;
+	Datum	   *result = expr->values;
+	bool	   *resnull = expr->isnull;
+
+	switch (expr->argtype)
+	{
+		case INT4OID:
+			switch (expr->op)
+			{
+				case BATCH_OP_EQ:
+					BATCH_CMP_LOOP(DatumGetInt32, ==);
+					break;
+				case BATCH_OP_NE:
+					BATCH_CMP_LOOP(DatumGetInt32, !=);
+					break;
+				case BATCH_OP_LT:
+					BATCH_CMP_LOOP(DatumGetInt32, <);
+					break;
+				case BATCH_OP_LE:
+					BATCH_CMP_LOOP(DatumGetInt32, <=);
+					break;
+				case BATCH_OP_GT:
+					BATCH_CMP_LOOP(DatumGetInt32, >);
+					break;
+				case BATCH_OP_GE:
+					BATCH_CMP_LOOP(DatumGetInt32, >=);
+					break;
+				case BATCH_OP_PL:
+					BATCH_FUNC_LOOP(DatumGetInt32, Int32GetDatum, batch_int4pl);
+					break;
+				case BATCH_OP_MI:
+					BATCH_FUNC_LOOP(DatumGetInt32, Int32GetDatum, batch_int4mi);
+					break;
+				case BATCH_OP_MUL:
+					BATCH_FUNC_LOOP(DatumGetInt32, Int32GetDatum, batch_int4mul);
+					break;
+			}
+			break;
+
+		case DATEOID:
+			switch (expr->op)
+			{
+				case BATCH_OP_EQ:
+					BATCH_CMP_LOOP(DatumGetDateADT, ==);
+					break;
+				case BATCH_OP_NE:
+					BATCH_CMP_LOOP(DatumGetDateADT, !=);
+					break;
+				case BATCH_OP_LT:
+					BATCH_CMP_LOOP(DatumGetDateADT, <);
+					break;
+				case BATCH_OP_LE:
+					BATCH_CMP_LOOP(DatumGetDateADT, <=);
+					break;
+				case BATCH_OP_GT:
+					BATCH_CMP_LOOP(DatumGetDateADT, >);
+					break;
+				case BATCH_OP_GE:
+					BATCH_CMP_LOOP(DatumGetDateADT, >=);
+					break;
+				default:
+					elog(ERROR, "unsupported date operator in batch expression");
+			}
+			break;
+
+		case INT8OID:
+			switch (expr->op)
+			{
+				case BATCH_OP_EQ:
+					BATCH_CMP_LOOP(DatumGetInt64, ==);
+					break;
+				case BATCH_OP_NE:
+					BATCH_CMP_LOOP(DatumGetInt64, !=);
+					break;
+				case BATCH_OP_LT:
+					BATCH_CMP_LOOP(DatumGetInt64, <);
+					break;
+				case BATCH_OP_LE:
+					BATCH_CMP_LOOP(DatumGetInt64, <=);
+					break;
+				case BATCH_OP_GT:
+					BATCH_CMP_LOOP(DatumGetInt64, >);
+					break;
+				case BATCH_OP_GE:
+					BATCH_CMP_LOOP(DatumGetInt64, >=);
+					break;
+				case BATCH_OP_PL:
+					BATCH_FUNC_LOOP(DatumGetInt64, Int64GetDatum, batch_int8pl);
+					break;
+				case BATCH_OP_MI:
+					BATCH_FUNC_LOOP(DatumGetInt64, Int64GetDatum, batch_int8mi);
+					break;
+				case BATCH_OP_MUL:
+					BATCH_FUNC_LOOP(DatumGetInt64, Int64GetDatum, batch_int8mul);
+					break;
+			}
+			break;
+
+		case FLOAT8OID:
+			/* float8_eq() and friends sort NaN above all other values */
+			switch (expr->op)
+			{
+				case BATCH_OP_EQ:
+					BATCH_FUNC_LOOP(DatumGetFloat8, BoolGetDatum, float8_eq);
+					break;
+				case BATCH_OP_NE:
+					BATCH_FUNC_LOOP(DatumGetFloat8, BoolGetDatum, float8_ne);
+					break;
+				case BATCH_OP_LT:
+					BATCH_FUNC_LOOP(DatumGetFloat8, BoolGetDatum, float8_lt);
+					break;
+				case BATCH_OP_LE:
+					BATCH_FUNC_LOOP(DatumGetFloat8, BoolGetDatum, float8_le);
+					break;
+				case BATCH_OP_GT:
+					BATCH_FUNC_LOOP(DatumGetFloat8, BoolGetDatum, float8_gt);
+					break;
+				case BATCH_OP_GE:
+					BATCH_FUNC_LOOP(DatumGetFloat8, BoolGetDatum, float8_ge);
+					break;
+				case BATCH_OP_PL:
+					BATCH_FUNC_LOOP(DatumGetFloat8, Float8GetDatum, float8_pl);
+					break;
+				case BATCH_OP_MI:
+					BATCH_FUNC_LOOP(DatumGetFloat8, Float8GetDatum, float8_mi);
+					break;
+				case BATCH_OP_MUL:
+					BATCH_FUNC_LOOP(DatumGetFloat8, Float8GetDatum, float8_mul);
+					break;
+			}
+			break;
+
+		default:
+			elog(ERROR, "unsupported type %u in batch expression",
+				 expr->argtype);
+	}
+}
+
+/*
+ * ExecInitBatchAgg
+ *		Set up batch execution of a plain aggregate, if possible.
+ *
+ * This requires a non-grouped, non-split aggregate directly above a
+ * sequential scan whose table AM can return batches, and only aggregates
+ * and arguments that the code in this file knows how to compute.  On
+ * success the scan is switched to batch mode as well.  Returns NULL if the
+ * aggregate must run row by row.
+ */
+BatchAgg *
+ExecInitBatchAgg(AggState *aggstate)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	PlanState  *outerstate = outerPlanState(aggstate);
+	List	   *outer_tlist;
+	BatchAgg   *batchagg;
+	int			maxattno = 0;
+	ListCell   *lc;
+
+	if (node->aggstrategy != AGG_PLAIN || node->groupingSets != NIL ||
+		node->aggsplit != AGGSPLIT_SIMPLE || aggstate->numaggs == 0)
+		return NULL;
+	if (aggstate->ss.ps.state->es_epq_active != NULL)
+		return NULL;
+	if (outerstate == NULL || !IsA(outerstate, SeqScanState))
+		return NULL;
+	outer_tlist = outerstate->plan->targetlist;
+
+	batchagg = palloc(sizeof(BatchAgg));
+	batchagg->numaggs = aggstate->numaggs;
+	batchagg->trans = palloc0(sizeof(BatchAggTrans) * aggstate->numaggs);
+
+	foreach(lc, aggstate->aggs)
+	{
+		Aggref	   *aggref = (Aggref *) lfirst(lc);
+		BatchAggTrans *trans = &batchagg->trans[aggref->aggno];
+		Expr	   *arg = NULL;
+		Oid			argtype = InvalidOid;
+
+		/* identical Aggrefs share an aggno */
+		if (trans->kind != BATCH_AGG_NONE)
+			continue;
+
+		if (aggref->aggfilter != NULL || aggref->aggdistinct != NIL ||
+			aggref->aggorder != NIL || aggref->aggdirectargs != NIL ||
+			aggref->aggkind != AGGKIND_NORMAL || aggref->agglevelsup != 0 ||
+			list_length(aggref->args) > 1)
+			return NULL;
+		if (aggref->args != NIL)
+			arg = linitial_node(TargetEntry, aggref->args)->expr;
+
+		trans->nullattno = -1;
+		switch (aggref->aggfnoid)
+		{
+			case F_COUNT_:
+				trans->kind = BATCH_AGG_COUNT_STAR;
+				break;
+			case F_COUNT_ANY:
+				trans->kind = BATCH_AGG_COUNT;
+				if (IsA(arg, Var))
+				{
+					/* only the null flags matter, so any type will do */
+					trans->nullattno = batch_outer_attno((Var *) arg,
+														 outer_tlist);
+					if (trans->nullattno < 0)
+						return NULL;
+					maxattno = Max(maxattno, trans->nullattno + 1);
+				}
+				break;
+			case F_SUM_INT4:
+				trans->kind = BATCH_AGG_SUM_INT4;
+				argtype = INT4OID;
+				break;
+			case F_AVG_INT4:
+				trans->kind = BATCH_AGG_AVG_INT4;
+				argtype = INT4OID;
+				break;
+			case F_SUM_FLOAT8:
+				trans->kind = BATCH_AGG_SUM_FLOAT8;
+				argtype = FLOAT8OID;
+				break;
+			case F_AVG_FLOAT8:
+				trans->kind = BATCH_AGG_AVG_FLOAT8;
+				argtype = FLOAT8OID;
+				break;
+			case F_MIN_INT4:
+			case F_MAX_INT4:
+				argtype = INT4OID;
+				break;
+			case F_MIN_INT8:
+			case F_MAX_INT8:
+				argtype = INT8OID;
+				break;
+			case F_MIN_FLOAT8:
+			case F_MAX_FLOAT8:
+				argtype = FLOAT8OID;
+				break;
+			case F_MIN_DATE:
+			case F_MAX_DATE:
+				argtype = DATEOID;
+				break;
+			default:
+				return NULL;
+		}
+
+		switch (aggref->aggfnoid)
+		{
+			case F_MIN_INT4:
+			case F_MIN_INT8:
+			case F_MIN_FLOAT8:
+			case F_MIN_DATE:
+				trans->kind = BATCH_AGG_MIN;
+				break;
+			case F_MAX_INT4:
+			case F_MAX_INT8:
+			case F_MAX_FLOAT8:
+			case F_MAX_DATE:
+				trans->kind = BATCH_AGG_MAX;
+				break;
+		}
+		trans->argtype = argtype;
+
+		if (arg != NULL && trans->nullattno < 0)
+		{
+			trans->arg = ExecBuildBatchExpr(arg, outer_tlist, &maxattno);
+			if (trans->arg == NULL ||
+				(OidIsValid(argtype) && trans->arg->type != argtype))
+				return NULL;
+		}
+	}
+
+	if (!ExecSeqScanInitBatch((SeqScanState *) outerstate, maxattno))
+		return NULL;
+
+	return batchagg;
+}
+
+/*
+ * Advance one aggregate over the selected rows of a batch, with the same
+ * semantics as its row-at-a-time transition function.
+ */
+static void
+batch_advance_aggregate(BatchAggTrans *trans, TupleBatch *batch)
+{
+	int			nsel = batch->nsel;
+	uint16	   *sel = batch->sel;
+	Datum	   *values;
+	bool	   *isnull;
+
+	if (trans->kind == BATCH_AGG_COUNT_STAR)
+	{
+		trans->count += nsel;
+		return;
+	}
+
+	if (trans->nullattno >= 0)
+	{
+		int			natts = batch->natts;
+		int			attno = trans->nullattno;
+
+		for (int i = 0; i < nsel; i++)
+			trans->count += !batch->isnull[sel[i] * natts + attno];
+		return;
+	}
+
+	ExecEvalBatchExpr(trans->arg, batch);
+	values = trans->arg->values;
+	isnull = trans->arg->isnull;
+
+	switch (trans->kind)
+	{
+		case BATCH_AGG_COUNT:
+			for (int i = 0; i < nsel; i++)
+				trans->count += !isnull[sel[i]];
+			break;
+
+		case BATCH_AGG_SUM_INT4:
+		case BATCH_AGG_AVG_INT4:
+			{
+				int64		count = trans->count;
+				int64		sum = trans->isum;
+
+				/* as in int4_sum() and int4_avg_accum(), no overflow check */
+				for (int i = 0; i < nsel; i++)
+				{
+					int			row = sel[i];
+
+					if (!isnull[row])
+					{
+						sum += DatumGetInt32(values[row]);
+						count++;
+					}
+				}
+				trans->count = count;
+				trans->isum = sum;
+				break;
+			}
+
+		case BATCH_AGG_SUM_FLOAT8:
+			for (int i = 0; i < nsel; i++)
+			{
+				int			row = sel[i];
+
+				if (isnull[row])
+					continue;
+				/* the first input becomes the state, as for any strict agg */
+				if (trans->count++ == 0)
+					trans->fSx = DatumGetFloat8(values[row]);
+				else
+					trans->fSx = float8_pl(trans->fSx,
+										   DatumGetFloat8(values[row]));
+			}
+			break;
+
+		case BATCH_AGG_AVG_FLOAT8:
+			{
+				float8		N = trans->fN;
+				float8		Sx = trans->fSx;
+				float8		Sxx = trans->fSxx;
+
+				/* keep in sync with float8_accum() */
+				for (int i = 0; i < nsel; i++)
+				{
+					int			row = sel[i];
+					float8		newval;
+					float8		oldN = N;
+					float8		oldSx = Sx;
+
+					if (isnull[row])
+						continue;
+					newval = DatumGetFloat8(values[row]);
+
+					N += 1.0;
+					Sx += newval;
+					if (oldN > 0.0)
+					{
+						float8		tmp = newval * N - Sx;
+
+						Sxx += tmp * tmp / (N * oldN);
+						if (isinf(Sx) || isinf(Sxx))
+						{
+							if (!isinf(oldSx) && !isinf(newval))
+								float_overflow_error();
+
+							Sxx = get_float8_nan();
+						}
+					}
+					else
+					{
+						if (isnan(newval) || isinf(newval))
+							Sxx = get_float8_nan();
+					}
+				}
+				trans->fN = N;
+				trans->fSx = Sx;
+				trans->fSxx = Sxx;
+				break;
+			}
+
+		case BATCH_AGG_MIN:
+		case BATCH_AGG_MAX:
+			{
+				bool		max = (trans->kind == BATCH_AGG_MAX);
+
+				for (int i = 0; i < nsel; i++)
+				{
+					int			row = sel[i];
+					Datum		newval = values[row];
+					bool		replace;
+
+					if (isnull[row])
+						continue;
+					if (trans->count++ == 0)
+					{
+						trans->extreme = newval;
+						continue;
+					}
+
+					/* same comparisons as int4larger(), float8smaller() etc */
+					switch (trans->argtype)
+					{
+						case INT4OID:
+							replace = max ?
+								DatumGetInt32(newval) > DatumGetInt32(trans->extreme) :
+								DatumGetInt32(newval) < DatumGetInt32(trans->extreme);
+							break;
+						case DATEOID:
+							replace = max ?
+								DatumGetDateADT(newval) > DatumGetDateADT(trans->extreme) :
+								DatumGetDateADT(newval) < DatumGetDateADT(trans->extreme);
+							break;
+						case INT8OID:
+							replace = max ?
+								DatumGetInt64(newval) > DatumGetInt64(trans->extreme) :
+								DatumGetInt64(newval) < DatumGetInt64(trans->extreme);
+							break;
+						case FLOAT8OID:
+							replace = max ?
+								float8_gt(DatumGetFloat8(newval), DatumGetFloat8(trans->extreme)) :
+								float8_lt(DatumGetFloat8(newval), DatumGetFloat8(trans->extreme));
+							break;
+						default:
+							elog(ERROR, "unsupported type %u in batch aggregate",
+								 trans->argtype);
+							replace = false;	/* keep compiler quiet */
+					}
+					if (replace)
+						trans->extreme = newval;
+				}
+				break;
+			}
+
+		default:
+			elog(ERROR, "unexpected batch aggregate kind %d", trans->kind);
+	}
+}
+
+/*
+ * Compute the final value of an aggregate, like its final function would.
+ */
+static void
+batch_finalize_aggregate(BatchAggTrans *trans, Datum *result, bool *isnull)
+{
+	*isnull = false;
+
+	switch (trans->kind)
+	{
+		case BATCH_AGG_COUNT_STAR:
+		case BATCH_AGG_COUNT:
+			*result = Int64GetDatum(trans->count);
+			break;
+
+		case BATCH_AGG_SUM_INT4:
+			if (trans->count == 0)
+				*isnull = true;
+			else
+				*result = Int64GetDatum(trans->isum);
+			break;
+
+		case BATCH_AGG_AVG_INT4:
+			/* as in int8_avg() */
+			if (trans->count == 0)
+				*isnull = true;
+			else
+				*result = DirectFunctionCall2(numeric_div,
+											  DirectFunctionCall1(int8_numeric,
+																  Int64GetDatum(trans->isum)),
+											  DirectFunctionCall1(int8_numeric,
+																  Int64GetDatum(trans->count)));
+			break;
+
+		case BATCH_AGG_SUM_FLOAT8:
+			if (trans->count == 0)
+				*isnull = true;
+			else
+				*result = Float8GetDatum(trans->fSx);
+			break;
+
+		case BATCH_AGG_AVG_FLOAT8:
+			/* as in float8_avg() */
+			if (trans->fN == 0.0)
+				*isnull = true;
+			else
+				*result = Float8GetDatum(trans->fSx / trans->fN);
+			break;
+
+		case BATCH_AGG_MIN:
+		case BATCH_AGG_MAX:
+			if (trans->count == 0)
+				*isnull = true;
+			else
+				*result = trans->extreme;
+			break;
+
+		default:
+			elog(ERROR, "unexpected batch aggregate kind %d", trans->kind);
+	}
+}
+
+/*
+ * ExecBatchAgg
+ *		Compute all the aggregates of a plain Agg node in batch mode.
+ *
+ * Consumes the whole input and stores the aggregate values in the node's
+ * expression context, ready for projection.
+ */
+void
+ExecBatchAgg(AggState *aggstate)
+{
+	BatchAgg   *batchagg = aggstate->batch;
+	SeqScanState *scanstate = (SeqScanState *) outerPlanState(aggstate);
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+	TupleBatch *batch;
+	MemoryContext oldcontext;
+
+	for (int aggno = 0; aggno < batchagg->numaggs; aggno++)
+	{
+		BatchAggTrans *trans = &batchagg->trans[aggno];
+
+		trans->count = 0;
+		trans->isum = 0;
+		trans->fN = 0.0;
+		trans->fSx = 0.0;
+		trans->fSxx = 0.0;
+		trans->extreme = (Datum) 0;
+	}
+
+	while ((batch = ExecSeqScanNextBatch(scanstate)) != NULL)
+	{
+		for (int aggno = 0; aggno < batchagg->numaggs; aggno++)
+		{
+			BatchAggTrans *trans = &batchagg->trans[aggno];
+
+			if (trans->kind != BATCH_AGG_NONE)
+				batch_advance_aggregate(trans, batch);
+		}
+	}
+
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+	for (int aggno = 0; aggno < batchagg->numaggs; aggno++)
+	{
+		BatchAggTrans *trans = &batchagg->trans[aggno];
+
+		if (trans->kind != BATCH_AGG_NONE)
+			batch_finalize_aggregate(trans, &econtext->ecxt_aggvalues[aggno],
+									 &econtext->ecxt_aggnulls[aggno]);
+		else
+		{
+			econtext->ecxt_aggvalues[aggno] = (Datum) 0;
+			econtext->ecxt_aggnulls[aggno] = true;
+		}
+	}
+	MemoryContextSwitchTo(oldcontext);
+}
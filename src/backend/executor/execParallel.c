@@ -290,11 +290,11 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 			ExecIncrementalSortEstimate((IncrementalSortState *) planstate, e->pcxt);
 			break;
 		case T_AggState:
-			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			/* also when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecAggEstimate((AggState *) planstate, e->pcxt);
 			break;
 		case T_MemoizeState:
-			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			/* even when not parallel-aware, for EXPLAIN ANALYZE and sharing */
 			ExecMemoizeEstimate((MemoizeState *) planstate, e->pcxt);
 			break;
 		default:
@@ -514,11 +514,11 @@ ExecParallelInitializeDSM(PlanState *planstate,
 			ExecIncrementalSortInitializeDSM((IncrementalSortState *) planstate, d->pcxt);
 			break;
 		case T_AggState:
-			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			/* also when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecAggInitializeDSM((AggState *) planstate, d->pcxt);
 			break;
 		case T_MemoizeState:
-			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			/* even when not parallel-aware, for EXPLAIN ANALYZE and sharing */
 			ExecMemoizeInitializeDSM((MemoizeState *) planstate, d->pcxt);
 			break;
 		default:
@@ -994,8 +994,15 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 				ExecHashJoinReInitializeDSM((HashJoinState *) planstate,
 											pcxt);
 			break;
-		case T_HashState:
+		case T_AggState:
+			if (planstate->plan->parallel_aware)
+				ExecAggReInitializeDSM((AggState *) planstate, pcxt);
+			break;
 		case T_SortState:
+			/* even when not parallel-aware, for a shared top-N bound */
+			ExecSortReInitializeDSM((SortState *) planstate, pcxt);
+			break;
+		case T_HashState:
 		case T_IncrementalSortState:
 		case T_MemoizeState:
 			/* these nodes have DSM state, but no reinitialization is required */
@@ -1359,11 +1366,11 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 												pwcxt);
 			break;
 		case T_AggState:
-			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			/* also when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecAggInitializeWorker((AggState *) planstate, pwcxt);
 			break;
 		case T_MemoizeState:
-			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			/* even when not parallel-aware, for EXPLAIN ANALYZE and sharing */
 			ExecMemoizeInitializeWorker((MemoizeState *) planstate, pwcxt);
 			break;
 		default:
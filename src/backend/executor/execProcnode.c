@@ -919,6 +919,13 @@ ExecSetTupleBound(int64 tuples_needed, PlanState *child_node)
 
 		for (i = 0; i < maState->ms_nplans; i++)
 			ExecSetTupleBound(tuples_needed, maState->mergeplans[i]);
+
+		/*
+		 * Moreover, none of the first tuples_needed output tuples can sort
+		 * after the last tuple kept by any one bounded Sort child, so let
+		 * those Sorts tell each other about it.
+		 */
+		ExecSortShareBound(maState->mergeplans, maState->ms_nplans, false);
 	}
 	else if (IsA(child_node, ResultState))
 	{
@@ -970,6 +977,9 @@ ExecSetTupleBound(int64 tuples_needed, PlanState *child_node)
 		gstate->tuples_needed = tuples_needed;
 
 		ExecSetTupleBound(tuples_needed, outerPlanState(child_node));
+
+		/* Same comments as for MergeAppend, with workers as the siblings */
+		ExecSortShareBound(&outerPlanState(child_node), 1, true);
 	}
 
 	/*
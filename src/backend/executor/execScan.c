@@ -19,7 +19,10 @@
 #include "postgres.h"
 
 #include "executor/executor.h"
+#include "executor/nodeHash.h"
 #include "miscadmin.h"
+#include "port/pg_bitutils.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
 
@@ -133,6 +136,81 @@ ExecScanFetch(ScanState *node,
 	return (*accessMtd) (node);
 }
 
+/*
+ * ExecScanRuntimeFilters -- check the current scan tuple against the
+ * runtime filters pushed down to the node
+ *
+ * Returns false if some filter shows that the tuple cannot have a partner
+ * in the hash join that built it.  The hash value is computed the same way
+ * ExecHashGetHashValue computes it for the join's outer tuples.  All the
+ * join operators are strict (the planner checks that), so a NULL key means
+ * no match.
+ */
+static bool
+ExecScanRuntimeFilters(ScanState *node, ExprContext *econtext)
+{
+	MemoryContext oldContext;
+	bool		result = true;
+	int			i;
+
+	if (!node->ss_rtfiltersLoaded)
+	{
+		/* Pick up whatever the Hash nodes have published by now */
+		for (i = 0; i < node->ss_nrtfilters; i++)
+		{
+			RuntimeFilterState *rfstate = &node->ss_rtfilters[i];
+			ParamExecData *prm;
+
+			prm = &econtext->ecxt_param_exec_vals[rfstate->paramid];
+			if (prm->isnull)
+				rfstate->filter = NULL;
+			else
+				rfstate->filter = RuntimeFilterGetBloom(prm->value);
+		}
+		node->ss_rtfiltersLoaded = true;
+	}
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < node->ss_nrtfilters && result; i++)
+	{
+		RuntimeFilterState *rfstate = &node->ss_rtfilters[i];
+		uint32		hashkey = 0;
+		int			j;
+
+		if (rfstate->filter == NULL)
+			continue;
+
+		for (j = 0; j < rfstate->nkeys; j++)
+		{
+			Datum		keyval;
+			bool		isNull;
+
+			/* combine successive hashkeys by rotating */
+			hashkey = pg_rotate_left32(hashkey, 1);
+
+			keyval = ExecEvalExpr(rfstate->keys[j], econtext, &isNull);
+			if (isNull)
+			{
+				result = false;
+				break;
+			}
+			hashkey ^= DatumGetUInt32(FunctionCall1Coll(&rfstate->hashfunctions[j],
+														rfstate->collations[j],
+														keyval));
+		}
+
+		if (result &&
+			bloom_lacks_element(rfstate->filter, (unsigned char *) &hashkey,
+								sizeof(hashkey)))
+			result = false;
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return result;
+}
+
 /* ----------------------------------------------------------------
  *		ExecScan
  *
@@ -173,10 +251,11 @@ ExecScan(ScanState *node,
 	/* interrupt checks are in ExecScanFetch */
 
 	/*
-	 * If we have neither a qual to check nor a projection to do, just skip
-	 * all the overhead and return the raw scan tuple.
+	 * If we have neither a qual to check nor a projection to do, and no
+	 * runtime filters either, just skip all the overhead and return the raw
+	 * scan tuple.
 	 */
-	if (!qual && !projInfo)
+	if (!qual && !projInfo && node->ss_nrtfilters == 0)
 	{
 		ResetExprContext(econtext);
 		return ExecScanFetch(node, accessMtd, recheckMtd);
@@ -226,6 +305,18 @@ ExecScan(ScanState *node,
 		 */
 		if (qual == NULL || ExecQual(qual, econtext))
 		{
+			/*
+			 * Runtime filters are checked after the qual, which is usually
+			 * cheaper and more selective.
+			 */
+			if (node->ss_nrtfilters > 0 &&
+				!ExecScanRuntimeFilters(node, econtext))
+			{
+				InstrCountFiltered3(node, 1);
+				ResetExprContext(econtext);
+				continue;
+			}
+
 			/*
 			 * Found a satisfactory scan tuple.
 			 */
@@ -306,6 +397,9 @@ ExecScanReScan(ScanState *node)
 	 */
 	ExecClearTuple(node->ss_ScanTupleSlot);
 
+	/* The hash joins might have built new runtime filters */
+	node->ss_rtfiltersLoaded = false;
+
 	/* Rescan EvalPlanQual tuple if we're inside an EvalPlanQual recheck */
 	if (estate->es_epq_active != NULL)
 	{
@@ -340,3 +434,64 @@ ExecScanReScan(ScanState *node)
 		}
 	}
 }
+
+/*
+ * ExecInitScanRuntimeFilters
+ *		Set up the runtime filters, if any, that the planner pushed down to
+ *		a scan node.
+ *
+ * The filters themselves are only built once the hash joins above have read
+ * their inner input, so they are fetched at the first tuple of each scan.
+ */
+void
+ExecInitScanRuntimeFilters(ScanState *node)
+{
+	Scan	   *scan = (Scan *) node->ps.plan;
+	ListCell   *lc;
+	int			i = 0;
+
+	node->ss_nrtfilters = list_length(scan->rtfilters);
+	node->ss_rtfiltersLoaded = false;
+	if (node->ss_nrtfilters == 0)
+	{
+		node->ss_rtfilters = NULL;
+		return;
+	}
+
+	node->ss_rtfilters = (RuntimeFilterState *)
+		palloc0(node->ss_nrtfilters * sizeof(RuntimeFilterState));
+
+	foreach(lc, scan->rtfilters)
+	{
+		RuntimeFilter *rf = lfirst_node(RuntimeFilter, lc);
+		RuntimeFilterState *rfstate = &node->ss_rtfilters[i++];
+		ListCell   *lk;
+		ListCell   *lo;
+		ListCell   *lcoll;
+		int			j = 0;
+
+		rfstate->paramid = rf->paramid;
+		rfstate->nkeys = list_length(rf->hashkeys);
+		rfstate->keys = (ExprState **)
+			palloc(rfstate->nkeys * sizeof(ExprState *));
+		rfstate->hashfunctions = (FmgrInfo *)
+			palloc(rfstate->nkeys * sizeof(FmgrInfo));
+		rfstate->collations = (Oid *) palloc(rfstate->nkeys * sizeof(Oid));
+
+		forthree(lk, rf->hashkeys, lo, rf->hashoperators,
+				 lcoll, rf->hashcollations)
+		{
+			Oid			hashop = lfirst_oid(lo);
+			Oid			left_hashfn;
+			Oid			right_hashfn;
+
+			if (!get_op_hash_functions(hashop, &left_hashfn, &right_hashfn))
+				elog(ERROR, "could not find hash function for hash operator %u",
+					 hashop);
+			fmgr_info(left_hashfn, &rfstate->hashfunctions[j]);
+			rfstate->collations[j] = lfirst_oid(lcoll);
+			rfstate->keys[j] = ExecInitExpr((Expr *) lfirst(lk), &node->ps);
+			j++;
+		}
+	}
+}
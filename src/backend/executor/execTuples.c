@@ -907,6 +907,210 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
 	}
 }
 
+/*
+ * One attribute of a TupleDeformProgram.  This is the subset of
+ * pg_attribute needed to deform a tuple, packed densely so that walking
+ * wide descriptors doesn't drag a whole FormData_pg_attribute per column
+ * through the cache.
+ */
+typedef struct TupleDeformStep
+{
+	int32		off;			/* fixed offset in tuple data, or -1 */
+	int16		attlen;
+	bool		attbyval;
+	char		attalign;
+} TupleDeformStep;
+
+/*
+ * Precomputed instructions to deform heap tuples of a given descriptor.
+ *
+ * The first nfixed attributes sit at the same offset in every tuple that has
+ * no nulls among them, as they are preceded only by fixed-width attributes.
+ * This is what attcacheoff records, but computed once up front rather than
+ * rediscovered attribute by attribute for each tuple.
+ */
+struct TupleDeformProgram
+{
+	TupleDesc	tupdesc;		/* descriptor this was built for */
+	int			natts;
+	int			nfixed;			/* # of leading fixed-offset attributes */
+	TupleDeformStep steps[FLEXIBLE_ARRAY_MEMBER];
+};
+
+/*
+ * ExecBuildDeformProgram
+ *		Build a TupleDeformProgram for tuples of the given descriptor, in the
+ *		current memory context.  The descriptor must outlive the program.
+ */
+TupleDeformProgram *
+ExecBuildDeformProgram(TupleDesc tupdesc)
+{
+	TupleDeformProgram *program;
+	uint32		off = 0;
+	bool		fixed = true;
+
+	program = palloc(offsetof(TupleDeformProgram, steps) +
+					 tupdesc->natts * sizeof(TupleDeformStep));
+	program->tupdesc = tupdesc;
+	program->natts = tupdesc->natts;
+	program->nfixed = 0;
+
+	for (int attnum = 0; attnum < tupdesc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, attnum);
+		TupleDeformStep *step = &program->steps[attnum];
+
+		step->attlen = att->attlen;
+		step->attbyval = att->attbyval;
+		step->attalign = att->attalign;
+		step->off = -1;
+
+		if (!fixed)
+			continue;
+
+		/*
+		 * A varlena's offset can only be fixed if it is already suitably
+		 * aligned, so that there are no pad bytes whether or not the value
+		 * has a short header.  In any case, nothing after it is fixed.
+		 */
+		if (att->attlen == -1)
+		{
+			if (off == att_align_nominal(off, att->attalign))
+			{
+				step->off = off;
+				program->nfixed = attnum + 1;
+			}
+			fixed = false;
+		}
+		else if (att->attlen > 0)
+		{
+			off = att_align_nominal(off, att->attalign);
+			step->off = off;
+			program->nfixed = attnum + 1;
+			off += att->attlen;
+		}
+		else
+			fixed = false;
+	}
+
+	return program;
+}
+
+/*
+ * Expand the null bitmap of a tuple into isnull[from .. to - 1].
+ *
+ * Whole bitmap bytes are expanded eight attributes at a time: the byte's
+ * bits are spread into the bytes of a 64-bit word, one bit per byte, which is
+ * then stored as eight bools.
+ */
+static inline void
+slot_expand_null_bitmap(bits8 *bp, bool *isnull, int from, int to)
+{
+	int			attnum = from;
+
+	/* leading attributes up to a bitmap byte boundary */
+	for (; attnum < to && (attnum & 0x07) != 0; attnum++)
+		isnull[attnum] = att_isnull(attnum, bp);
+
+	for (; attnum + 8 <= to; attnum += 8)
+	{
+		uint64		w = (uint8) ~bp[attnum >> 3];
+
+		/* replicate the byte, keep bit i in byte i, and turn it into 0/1 */
+		w *= UINT64CONST(0x0101010101010101);
+#ifdef WORDS_BIGENDIAN
+		w &= UINT64CONST(0x0102040810204080);
+#else
+		w &= UINT64CONST(0x8040201008040201);
+#endif
+		w = ((w + UINT64CONST(0x7F7F7F7F7F7F7F7F)) >> 7) &
+			UINT64CONST(0x0101010101010101);
+		memcpy(&isnull[attnum], &w, sizeof(w));
+	}
+
+	for (; attnum < to; attnum++)
+		isnull[attnum] = att_isnull(attnum, bp);
+}
+
+/*
+ * deform_heap_tuple_program
+ *		Extract attributes [attnum, natts) of a heap tuple into values/isnull,
+ *		following a TupleDeformProgram.  The caller must have clamped natts
+ *		to the number of attributes in the tuple.
+ *
+ *		*offp and *slowp carry the loop state from one call to the next, for
+ *		incremental deforming; they must be 0 and false when attnum is 0.
+ *		"slow" means that the fixed offsets of the program no longer apply.
+ */
+static pg_attribute_always_inline void
+deform_heap_tuple_program(TupleDeformProgram *program, HeapTupleHeader tup,
+						  int attnum, int natts, Datum *values, bool *isnull,
+						  uint32 *offp, bool *slowp)
+{
+	char	   *tp = (char *) tup + tup->t_hoff;	/* ptr to tuple data */
+	uint32		off = *offp;	/* offset in tuple data */
+	bool		slow = *slowp;
+
+	Assert(natts <= program->natts);
+
+	if (attnum >= natts)
+		return;
+
+	/* Work out which attributes are null up front */
+	if ((tup->t_infomask & HEAP_HASNULL) != 0)
+		slot_expand_null_bitmap(tup->t_bits, isnull, attnum, natts);
+	else
+		memset(isnull + attnum, 0, (natts - attnum) * sizeof(bool));
+
+	/* Fast path for the attributes at fixed offsets */
+	if (!slow)
+	{
+		int			nfixed = Min(natts, program->nfixed);
+
+		for (; attnum < nfixed; attnum++)
+		{
+			TupleDeformStep *step = &program->steps[attnum];
+
+			if (isnull[attnum])
+				break;
+
+			off = step->off;
+			values[attnum] = fetch_att(tp + off, step->attbyval, step->attlen);
+			off = att_addlength_pointer(off, step->attlen, tp + off);
+		}
+
+		/* past the fixed attributes, or behind a null */
+		if (attnum == program->nfixed || attnum < nfixed)
+			slow = true;
+	}
+
+	for (; attnum < natts; attnum++)
+	{
+		TupleDeformStep *step = &program->steps[attnum];
+
+		if (isnull[attnum])
+		{
+			values[attnum] = (Datum) 0;
+			continue;
+		}
+
+		if (step->attlen == -1)
+			off = att_align_pointer(off, step->attalign, -1, tp + off);
+		else
+		{
+			/* not varlena, so safe to use att_align_nominal */
+			off = att_align_nominal(off, step->attalign);
+		}
+
+		values[attnum] = fetch_att(tp + off, step->attbyval, step->attlen);
+
+		off = att_addlength_pointer(off, step->attlen, tp + off);
+	}
+
+	*offp = off;
+	*slowp = slow;
+}
+
 /*
  * slot_deform_heap_tuple
  *		Given a TupleTableSlot, extract data from the slot's physical tuple
@@ -918,6 +1122,9 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
  *		re-computing information about previously extracted attributes.
  *		slot->tts_nvalid is the number of attributes already extracted.
  *
+ *		The work is driven by a TupleDeformProgram, built the first time the
+ *		slot deforms a tuple.
+ *
  * This is marked as always inline, so the different offp for different types
  * of slots gets optimized away.
  */
@@ -925,16 +1132,19 @@ static pg_attribute_always_inline void
 slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 					   int natts)
 {
-	TupleDesc	tupleDesc = slot->tts_tupleDescriptor;
-	Datum	   *values = slot->tts_values;
-	bool	   *isnull = slot->tts_isnull;
-	HeapTupleHeader tup = tuple->t_data;
-	bool		hasnulls = HeapTupleHasNulls(tuple);
+	TupleDeformProgram *program = slot->tts_deform;
 	int			attnum;
-	char	   *tp;				/* ptr to tuple data */
 	uint32		off;			/* offset in tuple data */
-	bits8	   *bp = tup->t_bits;	/* ptr to null bitmap in tuple */
-	bool		slow;			/* can we use/set attcacheoff? */
+	bool		slow;			/* fixed offsets no longer apply? */
+
+	if (unlikely(program == NULL))
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(slot->tts_mcxt);
+
+		program = ExecBuildDeformProgram(slot->tts_tupleDescriptor);
+		slot->tts_deform = program;
+		MemoryContextSwitchTo(oldcxt);
+	}
 
 	/* We can only fetch as many attributes as the tuple has. */
 	natts = Min(HeapTupleHeaderGetNatts(tuple->t_data), natts);
@@ -957,63 +1167,14 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 		slow = TTS_SLOW(slot);
 	}
 
-	tp = (char *) tup + tup->t_hoff;
-
-	for (; attnum < natts; attnum++)
-	{
-		Form_pg_attribute thisatt = TupleDescAttr(tupleDesc, attnum);
-
-		if (hasnulls && att_isnull(attnum, bp))
-		{
-			values[attnum] = (Datum) 0;
-			isnull[attnum] = true;
-			slow = true;		/* can't use attcacheoff anymore */
-			continue;
-		}
-
-		isnull[attnum] = false;
-
-		if (!slow && thisatt->attcacheoff >= 0)
-			off = thisatt->attcacheoff;
-		else if (thisatt->attlen == -1)
-		{
-			/*
-			 * We can only cache the offset for a varlena attribute if the
-			 * offset is already suitably aligned, so that there would be no
-			 * pad bytes in any case: then the offset will be valid for either
-			 * an aligned or unaligned value.
-			 */
-			if (!slow &&
-				off == att_align_nominal(off, thisatt->attalign))
-				thisatt->attcacheoff = off;
-			else
-			{
-				off = att_align_pointer(off, thisatt->attalign, -1,
-										tp + off);
-				slow = true;
-			}
-		}
-		else
-		{
-			/* not varlena, so safe to use att_align_nominal */
-			off = att_align_nominal(off, thisatt->attalign);
-
-			if (!slow)
-				thisatt->attcacheoff = off;
-		}
-
-		values[attnum] = fetchatt(thisatt, tp + off);
-
-		off = att_addlength_pointer(off, thisatt->attlen, tp + off);
-
-		if (thisatt->attlen <= 0)
-			slow = true;		/* can't use attcacheoff anymore */
-	}
+	deform_heap_tuple_program(program, tuple->t_data, attnum, natts,
+							  slot->tts_values, slot->tts_isnull,
+							  &off, &slow);
 
 	/*
 	 * Save state for next execution
 	 */
-	slot->tts_nvalid = attnum;
+	slot->tts_nvalid = Max(natts, attnum);
 	*offp = off;
 	if (slow)
 		slot->tts_flags |= TTS_FLAG_SLOW;
@@ -1021,6 +1182,39 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 		slot->tts_flags &= ~TTS_FLAG_SLOW;
 }
 
+/*
+ * ExecDeformHeapTuples
+ *		Deform the first natts attributes of a batch of heap tuples, such as
+ *		the visible tuples of one heap page, in one go.
+ *
+ *		values and isnull are arrays of ntuples * natts entries, filled in
+ *		row by row.  Attributes beyond the end of a tuple get their "missing"
+ *		value, as in slot_getmissingattrs.
+ */
+void
+ExecDeformHeapTuples(TupleDeformProgram *program, HeapTuple *tuples,
+					 int ntuples, int natts, Datum *values, bool *isnull)
+{
+	Assert(natts <= program->natts);
+
+	for (int i = 0; i < ntuples; i++)
+	{
+		HeapTupleHeader tup = tuples[i]->t_data;
+		int			tupnatts = Min(HeapTupleHeaderGetNatts(tup), natts);
+		uint32		off = 0;
+		bool		slow = false;
+
+		deform_heap_tuple_program(program, tup, 0, tupnatts,
+								  values, isnull, &off, &slow);
+
+		for (int attnum = tupnatts; attnum < natts; attnum++)
+			values[attnum] = getmissingattr(program->tupdesc, attnum + 1,
+											&isnull[attnum]);
+
+		values += natts;
+		isnull += natts;
+	}
+}
 
 const TupleTableSlotOps TTSOpsVirtual = {
 	.base_slot_size = sizeof(VirtualTupleTableSlot),
@@ -1216,6 +1410,8 @@ ExecResetTupleTable(List *tupleTable,	/* tuple table */
 				if (slot->tts_isnull)
 					pfree(slot->tts_isnull);
 			}
+			if (slot->tts_deform)
+				pfree(slot->tts_deform);
 			pfree(slot);
 		}
 	}
@@ -1266,6 +1462,8 @@ ExecDropSingleTupleTableSlot(TupleTableSlot *slot)
 		if (slot->tts_isnull)
 			pfree(slot->tts_isnull);
 	}
+	if (slot->tts_deform)
+		pfree(slot->tts_deform);
 	pfree(slot);
 }
 
@@ -1295,8 +1493,9 @@ ExecSetSlotDescriptor(TupleTableSlot *slot, /* slot to change */
 	ExecClearTuple(slot);
 
 	/*
-	 * Release any old descriptor.  Also release old Datum/isnull arrays if
-	 * present (we don't bother to check if they could be re-used).
+	 * Release any old descriptor.  Also release old Datum/isnull arrays and
+	 * deform program if present (we don't bother to check if they could be
+	 * re-used).
 	 */
 	if (slot->tts_tupleDescriptor)
 		ReleaseTupleDesc(slot->tts_tupleDescriptor);
@@ -1305,6 +1504,11 @@ ExecSetSlotDescriptor(TupleTableSlot *slot, /* slot to change */
 		pfree(slot->tts_values);
 	if (slot->tts_isnull)
 		pfree(slot->tts_isnull);
+	if (slot->tts_deform)
+	{
+		pfree(slot->tts_deform);
+		slot->tts_deform = NULL;
+	}
 
 	/*
 	 * Install the new descriptor; if it's refcounted, bump its refcount.
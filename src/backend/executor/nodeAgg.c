@@ -226,6 +226,23 @@
  *	  imposing a limit on the number of groups separately from the amount of
  *	  memory consumed.
  *
+ *	  Parallel-Aware Hash Aggregation
+ *
+ *	  Normally, each participant of a parallel query aggregates its share of
+ *	  the input privately, and a Finalize Aggregate above the Gather combines
+ *	  the partial results, so that with many groups most of them are hashed
+ *	  once in every participant and once more in the leader.  A parallel-aware
+ *	  AGG_HASHED node instead computes complete aggregates for disjoint sets
+ *	  of groups: all participants first route their input tuples to a number
+ *	  of shared partitions, chosen by the high bits of the grouping key's
+ *	  hash value, in a SharedTuplestore each.  When all participants are done
+ *	  with that (see agg_fill_shared_partitions()), they claim the partitions
+ *	  one by one and aggregate them like batches of spilled tuples.  All
+ *	  tuples of a group are in the same partition, so each group is seen by
+ *	  exactly one participant.  The partitions also serve as the first level
+ *	  of spilling; a partition that does not fit in hash_mem is spilled
+ *	  further to the participant's own logical tapes.
+ *
  *    Transition / Combine function invocation:
  *
  *    For performance reasons transition functions, including combine
@@ -255,6 +272,7 @@
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
+#include "executor/execBatch.h"
 #include "executor/execExpr.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
@@ -265,12 +283,15 @@
 #include "optimizer/optimizer.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "pgstat.h"
+#include "storage/barrier.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/dynahash.h"
 #include "utils/expandeddatum.h"
 #include "utils/logtape.h"
+#include "utils/sharedtuplestore.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
@@ -353,10 +374,52 @@ typedef struct HashAggBatch
 	int			setno;			/* grouping set */
 	int			used_bits;		/* number of bits of hash already used */
 	LogicalTape *input_tape;	/* input partition tape */
+	SharedTuplestoreAccessor *input_sts;	/* or shared input partition */
 	int64		input_tuples;	/* number of tuples in this batch */
 	double		input_card;		/* estimated group cardinality */
 } HashAggBatch;
 
+/*
+ * Shared state of a parallel-aware hashed aggregation.
+ *
+ * partitions holds 2^partition_bits SharedTuplestores, each taking
+ * ParallelAggPartitionSize(nparticipants) bytes.  The hash value of each
+ * tuple is stored with it as meta-data.
+ */
+typedef struct ParallelAggState
+{
+	Barrier		barrier;		/* see PAGG_PHASE_* */
+	pg_atomic_uint32 next_partition;	/* next partition to aggregate */
+	int			nparticipants;
+	int			partition_bits;
+	SharedFileSet fileset;		/* space for the partitions' files */
+	char		partitions[FLEXIBLE_ARRAY_MEMBER];
+} ParallelAggState;
+
+/* phases of ParallelAggState's barrier */
+#define PAGG_PHASE_PARTITIONING		0
+#define PAGG_PHASE_AGGREGATING		1
+
+#define ParallelAggPartitionSize(nparticipants) \
+	MAXALIGN(sts_estimate(nparticipants))
+#define ParallelAggPartition(pstate, partno) \
+	((SharedTuplestore *) ((pstate)->partitions + \
+						   (partno) * ParallelAggPartitionSize((pstate)->nparticipants)))
+
+/*
+ * We want enough shared partitions that the participants can keep busy
+ * until the end, and that each of them fits in hash_mem if possible.
+ */
+#define PAGG_PARTITIONS_PER_PARTICIPANT	4
+#define PAGG_MAX_PARTITION_BITS			10
+
+/*
+ * The toc key under which the shared state is stored.  The plan node ID
+ * itself is used for the shared instrumentation.
+ */
+#define PARALLEL_AGG_KEY(plan_node_id) \
+	(UINT64CONST(0xD000000000000000) | (plan_node_id))
+
 /* used to find referenced colnos */
 typedef struct FindColsContext
 {
@@ -418,7 +481,9 @@ static void initialize_hash_entry(AggState *aggstate,
 								  TupleHashEntry entry);
 static void lookup_hash_entries(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
+static TupleTableSlot *agg_retrieve_batch(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static void agg_fill_shared_partitions(AggState *aggstate);
 static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table_in_memory(AggState *aggstate);
@@ -432,11 +497,16 @@ static HashAggBatch *hashagg_batch_new(LogicalTape *input_tape, int setno,
 									   int64 input_tuples, double input_card,
 									   int used_bits);
 static MinimalTuple hashagg_batch_read(HashAggBatch *batch, uint32 *hashp);
+static HashAggBatch *hashagg_claim_shared_partition(AggState *aggstate);
 static void hashagg_spill_init(HashAggSpill *spill, LogicalTapeSet *lts,
 							   int used_bits, double input_groups,
 							   double hashentrysize);
+static TupleTableSlot *hashagg_spill_slot(AggState *aggstate,
+										  TupleTableSlot *inputslot);
 static Size hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 								TupleTableSlot *slot, uint32 hash);
+static int	parallel_agg_partition_bits(AggState *aggstate, int nparticipants);
+static Size parallel_agg_state_size(int nparticipants, int partition_bits);
 static void hashagg_spill_finish(AggState *aggstate, HashAggSpill *spill,
 								 int setno);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
@@ -2151,12 +2221,23 @@ ExecAgg(PlanState *pstate)
 		{
 			case AGG_HASHED:
 				if (!node->table_filled)
-					agg_fill_hash_table(node);
+				{
+					if (node->pagg_state != NULL)
+						agg_fill_shared_partitions(node);
+					else
+						agg_fill_hash_table(node);
+				}
 				/* FALLTHROUGH */
 			case AGG_MIXED:
 				result = agg_retrieve_hash_table(node);
 				break;
 			case AGG_PLAIN:
+				if (node->batch != NULL)
+				{
+					result = agg_retrieve_batch(node);
+					break;
+				}
+				/* FALLTHROUGH */
 			case AGG_SORTED:
 				result = agg_retrieve_direct(node);
 				break;
@@ -2169,6 +2250,30 @@ ExecAgg(PlanState *pstate)
 	return NULL;
 }
 
+/*
+ * ExecAgg for plain aggregation in batch mode
+ *
+ * The aggregates are computed by ExecBatchAgg, which reads the input a batch
+ * at a time; see execBatch.c.  There is exactly one result row, as in the
+ * AGG_PLAIN case of agg_retrieve_direct.
+ */
+static TupleTableSlot *
+agg_retrieve_batch(AggState *aggstate)
+{
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+
+	ResetExprContext(econtext);
+	aggstate->agg_done = true;
+
+	ExecBatchAgg(aggstate);
+
+	/* there are no references to non-aggregated input columns */
+	ExecClearTuple(aggstate->ss.ss_ScanTupleSlot);
+	econtext->ecxt_outertuple = aggstate->ss.ss_ScanTupleSlot;
+
+	return project_aggregates(aggstate);
+}
+
 /*
  * ExecAgg for non-hashed case
  */
@@ -2560,6 +2665,72 @@ agg_fill_hash_table(AggState *aggstate)
 						   &aggstate->perhash[0].hashiter);
 }
 
+/*
+ * ExecAgg for parallel-aware hashed case: distribute the input
+ *
+ * Write each input tuple to the shared partition selected by the hash value
+ * of its grouping key, and wait for the other participants to do the same.
+ * The hash table is left empty; agg_refill_hash_table() fills it from the
+ * partitions that this participant claims.  A participant that arrives after
+ * the partitioning phase has nothing to contribute, as the other
+ * participants have already consumed all the input.
+ */
+static void
+agg_fill_shared_partitions(AggState *aggstate)
+{
+	ParallelAggState *pstate = aggstate->pagg_state;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	int			shift = 32 - pstate->partition_bits;
+
+	/* all participants must compute the same hash values */
+	Assert(aggstate->num_hashes == 1);
+	Assert(!DO_AGGSPLIT_SKIPFINAL(aggstate->aggsplit));
+
+	if (BarrierAttach(&pstate->barrier) == PAGG_PHASE_PARTITIONING)
+	{
+		for (;;)
+		{
+			TupleTableSlot *outerslot;
+			TupleTableSlot *spillslot;
+			MinimalTuple tuple;
+			uint32		hash;
+			bool		shouldFree;
+
+			outerslot = fetch_input_tuple(aggstate);
+			if (TupIsNull(outerslot))
+				break;
+
+			prepare_hash_slot(perhash, outerslot, perhash->hashslot);
+			hash = TupleHashTableHash(perhash->hashtable, perhash->hashslot);
+
+			spillslot = hashagg_spill_slot(aggstate, outerslot);
+			tuple = ExecFetchSlotMinimalTuple(spillslot, &shouldFree);
+			sts_puttuple(aggstate->pagg_partitions[hash >> shift], &hash,
+						 tuple);
+			if (shouldFree)
+				pfree(tuple);
+
+			ResetExprContext(aggstate->tmpcontext);
+		}
+
+		for (int i = 0; i < (1 << pstate->partition_bits); i++)
+			sts_end_write(aggstate->pagg_partitions[i]);
+
+		BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_HASH_AGG_PARTITION);
+	}
+	BarrierDetach(&pstate->barrier);
+
+	/*
+	 * The input has effectively been spilled; this also keeps a rescan from
+	 * trying to reuse the hash table.
+	 */
+	aggstate->hash_ever_spilled = true;
+
+	aggstate->table_filled = true;
+	select_current_set(aggstate, 0, true);
+	ResetTupleHashIterator(perhash->hashtable, &perhash->hashiter);
+}
+
 /*
  * If any data was spilled during hash aggregation, reset the hash table and
  * reprocess one batch of spilled data. After reprocessing a batch, the hash
@@ -2569,6 +2740,9 @@ agg_fill_hash_table(AggState *aggstate)
  * Should only be called after all in memory hash table entries have been
  * finalized and emitted.
  *
+ * In parallel-aware mode, the shared partitions are processed the same way
+ * once the participant's own spilled batches are done.
+ *
  * Return false when input is exhausted and there's no more work to be done;
  * otherwise return true.
  */
@@ -2578,16 +2752,23 @@ agg_refill_hash_table(AggState *aggstate)
 	HashAggBatch *batch;
 	AggStatePerHash perhash;
 	HashAggSpill spill;
-	LogicalTapeSet *tapeset = aggstate->hash_tapeset;
 	bool		spill_initialized = false;
 
-	if (aggstate->hash_batches == NIL)
+	if (aggstate->hash_batches != NIL)
+	{
+		/* hash_batches is a stack, with the top item at the end of the list */
+		batch = llast(aggstate->hash_batches);
+		aggstate->hash_batches = list_delete_last(aggstate->hash_batches);
+	}
+	else if (aggstate->pagg_state != NULL)
+	{
+		batch = hashagg_claim_shared_partition(aggstate);
+		if (batch == NULL)
+			return false;
+	}
+	else
 		return false;
 
-	/* hash_batches is a stack, with the top item at the end of the list */
-	batch = llast(aggstate->hash_batches);
-	aggstate->hash_batches = list_delete_last(aggstate->hash_batches);
-
 	hash_agg_set_limits(aggstate->hashentrysize, batch->input_card,
 						batch->used_bits, &aggstate->hash_mem_limit,
 						&aggstate->hash_ngroups_limit, NULL);
@@ -2675,8 +2856,11 @@ agg_refill_hash_table(AggState *aggstate)
 				 * that we don't assign tapes that will never be used.
 				 */
 				spill_initialized = true;
-				hashagg_spill_init(&spill, tapeset, batch->used_bits,
-								   batch->input_card, aggstate->hashentrysize);
+				if (aggstate->hash_tapeset == NULL)
+					aggstate->hash_tapeset = LogicalTapeSetCreate(true, NULL, -1);
+				hashagg_spill_init(&spill, aggstate->hash_tapeset,
+								   batch->used_bits, batch->input_card,
+								   aggstate->hashentrysize);
 			}
 			/* no memory for a new group, spill */
 			hashagg_spill_tuple(aggstate, &spill, spillslot, hash);
@@ -2691,7 +2875,10 @@ agg_refill_hash_table(AggState *aggstate)
 		ResetExprContext(aggstate->tmpcontext);
 	}
 
-	LogicalTapeClose(batch->input_tape);
+	if (batch->input_sts != NULL)
+		sts_end_parallel_scan(batch->input_sts);
+	else
+		LogicalTapeClose(batch->input_tape);
 
 	/* change back to phase 0 */
 	aggstate->current_phase = 0;
@@ -2897,6 +3084,38 @@ hashagg_spill_init(HashAggSpill *spill, LogicalTapeSet *tapeset, int used_bits,
 		initHyperLogLog(&spill->hll_card[i], HASHAGG_HLL_BIT_WIDTH);
 }
 
+/*
+ * hashagg_spill_slot
+ *
+ * Return a slot holding the attributes of an input tuple that need to be
+ * spilled; the others are set to NULL.
+ */
+static TupleTableSlot *
+hashagg_spill_slot(AggState *aggstate, TupleTableSlot *inputslot)
+{
+	TupleTableSlot *spillslot;
+
+	if (aggstate->all_cols_needed)
+		return inputslot;
+
+	spillslot = aggstate->hash_spill_wslot;
+	slot_getsomeattrs(inputslot, aggstate->max_colno_needed);
+	ExecClearTuple(spillslot);
+	for (int i = 0; i < spillslot->tts_tupleDescriptor->natts; i++)
+	{
+		if (bms_is_member(i + 1, aggstate->colnos_needed))
+		{
+			spillslot->tts_values[i] = inputslot->tts_values[i];
+			spillslot->tts_isnull[i] = inputslot->tts_isnull[i];
+		}
+		else
+			spillslot->tts_isnull[i] = true;
+	}
+	ExecStoreVirtualTuple(spillslot);
+
+	return spillslot;
+}
+
 /*
  * hashagg_spill_tuple
  *
@@ -2917,25 +3136,7 @@ hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 	Assert(spill->partitions != NULL);
 
 	/* spill only attributes that we actually need */
-	if (!aggstate->all_cols_needed)
-	{
-		spillslot = aggstate->hash_spill_wslot;
-		slot_getsomeattrs(inputslot, aggstate->max_colno_needed);
-		ExecClearTuple(spillslot);
-		for (int i = 0; i < spillslot->tts_tupleDescriptor->natts; i++)
-		{
-			if (bms_is_member(i + 1, aggstate->colnos_needed))
-			{
-				spillslot->tts_values[i] = inputslot->tts_values[i];
-				spillslot->tts_isnull[i] = inputslot->tts_isnull[i];
-			}
-			else
-				spillslot->tts_isnull[i] = true;
-		}
-		ExecStoreVirtualTuple(spillslot);
-	}
-	else
-		spillslot = inputslot;
+	spillslot = hashagg_spill_slot(aggstate, inputslot);
 
 	tuple = ExecFetchSlotMinimalTuple(spillslot, &shouldFree);
 
@@ -2997,6 +3198,17 @@ hashagg_batch_read(HashAggBatch *batch, uint32 *hashp)
 	size_t		nread;
 	uint32		hash;
 
+	if (batch->input_sts != NULL)
+	{
+		/* the tuple belongs to the tuplestore, so return a copy */
+		tuple = sts_parallel_scan_next(batch->input_sts, &hash);
+		if (tuple == NULL)
+			return NULL;
+		if (hashp != NULL)
+			*hashp = hash;
+		return heap_copy_minimal_tuple(tuple);
+	}
+
 	nread = LogicalTapeRead(tape, &hash, sizeof(uint32));
 	if (nread == 0)
 		return NULL;
@@ -3030,6 +3242,37 @@ hashagg_batch_read(HashAggBatch *batch, uint32 *hashp)
 	return tuple;
 }
 
+/*
+ * hashagg_claim_shared_partition
+ *
+ * Claim the next shared partition not yet aggregated by any participant, and
+ * return a batch to read it.  Returns NULL if there are none left.
+ */
+static HashAggBatch *
+hashagg_claim_shared_partition(AggState *aggstate)
+{
+	ParallelAggState *pstate = aggstate->pagg_state;
+	int			npartitions = 1 << pstate->partition_bits;
+	uint32		partno;
+	double		input_card;
+	HashAggBatch *batch;
+
+	partno = pg_atomic_fetch_add_u32(&pstate->next_partition, 1);
+	if (partno >= npartitions)
+		return NULL;
+
+	/* numGroups is the planner's estimate for one participant */
+	input_card = Max(aggstate->perhash[0].aggnode->numGroups *
+					 pstate->nparticipants / npartitions, 1);
+
+	batch = hashagg_batch_new(NULL, 0, 0, input_card, pstate->partition_bits);
+	batch->input_sts = aggstate->pagg_partitions[partno];
+	sts_begin_parallel_scan(batch->input_sts);
+	aggstate->hash_batches_used++;
+
+	return batch;
+}
+
 /*
  * hashagg_finish_initial_spills
  *
@@ -4002,6 +4245,13 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		phase->evaltrans_cache[0][0] = phase->evaltrans;
 	}
 
+	/*
+	 * Plain aggregation directly over a sequential scan may be able to run
+	 * in batch mode.
+	 */
+	if (enable_batch_execution)
+		aggstate->batch = ExecInitBatchAgg(aggstate);
+
 	return aggstate;
 }
 
@@ -4652,7 +4902,8 @@ AggRegisterCallback(FunctionCallInfo fcinfo,
  /* ----------------------------------------------------------------
   *		ExecAggEstimate
   *
-  *		Estimate space required to propagate aggregate statistics.
+  *		Estimate space required to propagate aggregate statistics, and
+  *		for the shared state of a parallel-aware node.
   * ----------------------------------------------------------------
   */
 void
@@ -4660,6 +4911,17 @@ ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		int			nparticipants = pcxt->nworkers + 1;
+
+		size = parallel_agg_state_size(nparticipants,
+									   parallel_agg_partition_bits(node,
+																   nparticipants));
+		shm_toc_estimate_chunk(&pcxt->estimator, size);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -4670,10 +4932,35 @@ ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 }
 
+/*
+ * Set up the shared partitions of a parallel-aware node, as participant 0.
+ */
+static void
+parallel_agg_init_partitions(AggState *node, ParallelAggState *pstate)
+{
+	int			npartitions = 1 << pstate->partition_bits;
+
+	for (int i = 0; i < npartitions; i++)
+	{
+		char		name[MAXPGPATH];
+
+		snprintf(name, sizeof(name), "a%d", i);
+		node->pagg_partitions[i] =
+			sts_initialize(ParallelAggPartition(pstate, i),
+						   pstate->nparticipants,
+						   0,
+						   sizeof(uint32),
+						   SHARED_TUPLESTORE_SINGLE_PASS,
+						   &pstate->fileset,
+						   name);
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecAggInitializeDSM
  *
- *		Initialize DSM space for aggregate statistics.
+ *		Initialize DSM space for aggregate statistics, and the shared
+ *		state of a parallel-aware node.
  * ----------------------------------------------------------------
  */
 void
@@ -4681,6 +4968,36 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	/*
+	 * A parallel-aware node needs a real DSM segment for its shared files.
+	 * Without one, no workers can be launched, and the leader aggregates all
+	 * input privately.
+	 */
+	if (node->ss.ps.plan->parallel_aware && pcxt->seg != NULL)
+	{
+		int			nparticipants = pcxt->nworkers + 1;
+		int			partition_bits = parallel_agg_partition_bits(node,
+																 nparticipants);
+		ParallelAggState *pstate;
+
+		pstate = shm_toc_allocate(pcxt->toc,
+								  parallel_agg_state_size(nparticipants,
+														  partition_bits));
+		BarrierInit(&pstate->barrier, 0);
+		pg_atomic_init_u32(&pstate->next_partition, 0);
+		pstate->nparticipants = nparticipants;
+		pstate->partition_bits = partition_bits;
+		SharedFileSetInit(&pstate->fileset, pcxt->seg);
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_AGG_KEY(node->ss.ps.plan->plan_node_id),
+					   pstate);
+
+		node->pagg_state = pstate;
+		node->pagg_partitions = palloc(sizeof(SharedTuplestoreAccessor *) <<
+									   partition_bits);
+		parallel_agg_init_partitions(node, pstate);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -4695,19 +5012,96 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecAggReInitializeDSM
+ *
+ *		Reset the shared state of a parallel-aware node before beginning
+ *		a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggReInitializeDSM(AggState *node, ParallelContext *pcxt)
+{
+	ParallelAggState *pstate = node->pagg_state;
+
+	if (pstate == NULL)
+		return;
+
+	/* Clear the old partitions' files and start over. */
+	SharedFileSetDeleteAll(&pstate->fileset);
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->next_partition, 0);
+	parallel_agg_init_partitions(node, pstate);
+}
+
 /* ----------------------------------------------------------------
  *		ExecAggInitializeWorker
  *
- *		Attach worker to DSM space for aggregate statistics.
+ *		Attach worker to DSM space for aggregate statistics, and to the
+ *		shared state of a parallel-aware node.
  * ----------------------------------------------------------------
  */
 void
 ExecAggInitializeWorker(AggState *node, ParallelWorkerContext *pwcxt)
 {
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		ParallelAggState *pstate;
+
+		pstate = shm_toc_lookup(pwcxt->toc,
+								PARALLEL_AGG_KEY(node->ss.ps.plan->plan_node_id),
+								true);
+		if (pstate != NULL)
+		{
+			int			npartitions = 1 << pstate->partition_bits;
+
+			SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+
+			node->pagg_state = pstate;
+			node->pagg_partitions =
+				palloc(sizeof(SharedTuplestoreAccessor *) * npartitions);
+			for (int i = 0; i < npartitions; i++)
+				node->pagg_partitions[i] =
+					sts_attach(ParallelAggPartition(pstate, i),
+							   ParallelWorkerNumber + 1,
+							   &pstate->fileset);
+		}
+	}
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
 }
 
+/*
+ * Choose the number of shared partitions of a parallel-aware node.
+ */
+static int
+parallel_agg_partition_bits(AggState *aggstate, int nparticipants)
+{
+	Agg		   *aggnode = (Agg *) aggstate->ss.ps.plan;
+	double		npartitions;
+
+	/* numGroups is the planner's estimate for one participant */
+	npartitions = aggnode->numGroups * nparticipants *
+		aggstate->hashentrysize / get_hash_memory_limit();
+	npartitions = Max(npartitions,
+					  PAGG_PARTITIONS_PER_PARTICIPANT * nparticipants);
+	npartitions = Min(npartitions, 1 << PAGG_MAX_PARTITION_BITS);
+
+	return my_log2((long) npartitions);
+}
+
+/*
+ * Size of the shared state of a parallel-aware node.
+ */
+static Size
+parallel_agg_state_size(int nparticipants, int partition_bits)
+{
+	return add_size(offsetof(ParallelAggState, partitions),
+					mul_size(ParallelAggPartitionSize(nparticipants),
+							 (Size) 1 << partition_bits));
+}
+
 /* ----------------------------------------------------------------
  *		ExecAggRetrieveInstrumentation
  *
@@ -789,6 +789,7 @@ ExecInitBitmapHeapScan(BitmapHeapScan *node, EState *estate, int eflags)
 		ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
 	scanstate->bitmapqualorig =
 		ExecInitQual(node->bitmapqualorig, (PlanState *) scanstate);
+	ExecInitScanRuntimeFilters(&scanstate->ss);
 
 	/*
 	 * Maximum number of prefetches for the tablespace if configured,
@@ -44,6 +44,12 @@
 #include "utils/memutils.h"
 #include "utils/syscache.h"
 
+/*
+ * A runtime filter with more than this fraction of its bits set would let
+ * through too many tuples without a join partner to pay for itself.
+ */
+#define RUNTIME_FILTER_MAX_BITS_SET		0.5
+
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable);
@@ -62,6 +68,8 @@ static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
 												dsa_pointer *shared);
 static void MultiExecPrivateHash(HashState *node);
 static void MultiExecParallelHash(HashState *node);
+static void ExecHashPublishRuntimeFilter(HashState *node,
+										 bloom_filter *filter);
 static inline HashJoinTuple ExecParallelHashFirstTuple(HashJoinTable table,
 													   int bucketno);
 static inline HashJoinTuple ExecParallelHashNextTuple(HashJoinTable table,
@@ -144,6 +152,7 @@ MultiExecPrivateHash(HashState *node)
 	TupleTableSlot *slot;
 	ExprContext *econtext;
 	uint32		hashvalue;
+	bloom_filter *filter = NULL;
 
 	/*
 	 * get state info from node
@@ -157,6 +166,22 @@ MultiExecPrivateHash(HashState *node)
 	hashkeys = node->hashkeys;
 	econtext = node->ps.ps_ExprContext;
 
+	/*
+	 * If we're to build a runtime filter for the outer side of the join,
+	 * withdraw any previous one and set up a new one.
+	 */
+	if (((Hash *) node->ps.plan)->rtfilterParam >= 0)
+	{
+		MemoryContext oldcxt;
+
+		ExecHashPublishRuntimeFilter(node, NULL);
+
+		oldcxt = MemoryContextSwitchTo(hashtable->hashCxt);
+		filter = bloom_create(Max((int64) node->ps.plan->plan_rows, 1),
+							  work_mem, 0);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
 	/*
 	 * Get all tuples from the node below the Hash node and insert into the
 	 * hash table (or temp files).
@@ -174,6 +199,10 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (filter)
+				bloom_add_element(filter, (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -200,7 +229,63 @@ MultiExecPrivateHash(HashState *node)
 	if (hashtable->spaceUsed > hashtable->spacePeak)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
+	if (hashtable->radixEnabled)
+		ExecHashTableRadixCluster(hashtable);
+
 	hashtable->partialTuples = hashtable->totalTuples;
+
+	if (filter)
+		ExecHashPublishRuntimeFilter(node, filter);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashPublishRuntimeFilter
+ *
+ *		Make a runtime filter built from the inner tuples available to the
+ *		scans below the outer side of the join, which read it from the
+ *		plan's rtfilterParam.  A NULL filter, or one with too many bits set
+ *		to be of use, is published as a null param, which lets everything
+ *		through.  The filter itself is freed.
+ *
+ *		The param holds a bytea so that a Gather can pass it on to its
+ *		workers.  The copy is kept until the next one replaces it.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecHashPublishRuntimeFilter(HashState *node, bloom_filter *filter)
+{
+	EState	   *estate = node->ps.state;
+	ParamExecData *prm;
+
+	prm = &estate->es_param_exec_vals[((Hash *) node->ps.plan)->rtfilterParam];
+	prm->value = (Datum) 0;
+	prm->isnull = true;
+
+	if (node->rtfilter)
+	{
+		pfree(node->rtfilter);
+		node->rtfilter = NULL;
+	}
+
+	if (filter == NULL)
+		return;
+
+	if (bloom_prop_bits_set(filter) <= RUNTIME_FILTER_MAX_BITS_SET)
+	{
+		Size		size = bloom_total_size(filter);
+
+		node->rtfilter = (bytea *)
+			MemoryContextAlloc(estate->es_query_cxt,
+							   RUNTIME_FILTER_BLOOM_OFFSET + size);
+		SET_VARSIZE(node->rtfilter, RUNTIME_FILTER_BLOOM_OFFSET + size);
+		memcpy((char *) node->rtfilter + RUNTIME_FILTER_BLOOM_OFFSET,
+			   filter, size);
+
+		prm->value = PointerGetDatum(node->rtfilter);
+		prm->isnull = false;
+	}
+
+	bloom_free(filter);
 }
 
 /* ----------------------------------------------------------------
@@ -367,6 +452,16 @@ ExecInitHash(Hash *node, EState *estate, int eflags)
 	hashstate->ps.ExecProcNode = ExecHash;
 	hashstate->hashtable = NULL;
 	hashstate->hashkeys = NIL;	/* will be set by parent HashJoin */
+	hashstate->rtfilter = NULL;
+
+	/* The runtime filter, if any, lets everything through until it's built */
+	if (node->rtfilterParam >= 0)
+	{
+		ParamExecData *prm = &estate->es_param_exec_vals[node->rtfilterParam];
+
+		prm->value = (Datum) 0;
+		prm->isnull = true;
+	}
 
 	/*
 	 * Miscellaneous initialization
@@ -509,6 +604,9 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_HASH_MEM_PERCENT / 100;
 	hashtable->chunks = NULL;
+	hashtable->radixEnabled = false;
+	hashtable->radixBits = 0;
+	hashtable->radixBitsPeak = 0;
 	hashtable->current_chunk = NULL;
 	hashtable->parallel_state = state->parallel_state;
 	hashtable->area = state->ps.state->es_query_dsa;
@@ -1937,6 +2035,43 @@ ExecHashGetBucketAndBatch(HashJoinTable hashtable,
 	}
 }
 
+/*
+ * ExecHashPrefetchBucket
+ *		start loading the head of a hash bucket into the CPU cache
+ *
+ * If first_tuple is false, the bucket's entry in the bucket array is
+ * prefetched.  Otherwise that entry is read, so it should have been
+ * prefetched earlier, and the first tuple in the bucket is prefetched.
+ * Issuing the first step for a group of probes, then the second, and only
+ * then scanning the buckets lets the cache misses of the group overlap,
+ * which matters once the hash table is much larger than the CPU caches.
+ */
+void
+ExecHashPrefetchBucket(HashJoinTable hashtable, int bucketno,
+					   bool first_tuple)
+{
+	if (hashtable->parallel_state != NULL)
+	{
+		if (!first_tuple)
+			pg_prefetch_mem(&hashtable->buckets.shared[bucketno]);
+		else
+		{
+			dsa_pointer p;
+
+			p = dsa_pointer_atomic_read(&hashtable->buckets.shared[bucketno]);
+			if (DsaPointerIsValid(p))
+				pg_prefetch_mem(dsa_get_address(hashtable->area, p));
+		}
+	}
+	else
+	{
+		if (!first_tuple)
+			pg_prefetch_mem(&hashtable->buckets.unshared[bucketno]);
+		else
+			pg_prefetch_mem(hashtable->buckets.unshared[bucketno]);
+	}
+}
+
 /*
  * ExecScanHashBucket
  *		scan a hash bucket for matches to the current outer tuple
@@ -2177,6 +2312,91 @@ ExecHashTableReset(HashJoinTable hashtable)
 
 	/* Forget the chunks (the memory was freed by the context reset above). */
 	hashtable->chunks = NULL;
+	hashtable->radixBits = 0;
+}
+
+/*
+ * ExecHashTableRadixCluster
+ *		cluster the tuples of the current in-memory batch by radix partition
+ *
+ * Tuples are normally stored in the order they arrive, so the chain of any
+ * bucket is scattered over the whole table.  Once the table is much larger
+ * than the CPU caches, that costs a cache miss for nearly every tuple
+ * visited.  Here we copy the tuples into fresh chunks in bucket order and
+ * divide the buckets into 2^radixBits partitions of about
+ * HASH_RADIX_PARTITION_SIZE bytes each.  The hash join then probes with
+ * groups of outer tuples sorted by partition, so that each partition is
+ * brought into the cache once per group rather than once per tuple.
+ *
+ * The copy needs room for a second set of tuples for a moment, so small
+ * tables, and tables that would exceed the memory limit, are left alone.
+ * Only private hash tables are handled.
+ */
+void
+ExecHashTableRadixCluster(HashJoinTable hashtable)
+{
+	HashMemoryChunk oldchunks = hashtable->chunks;
+	HashMemoryChunk chunk;
+	Size		tupleSpace = 0;
+	int			nparts;
+	int			radixBits;
+
+	Assert(hashtable->parallel_state == NULL);
+
+	hashtable->radixBits = 0;
+
+	/* skew tuples are not in the chunks, but they don't matter here */
+	for (chunk = oldchunks; chunk != NULL; chunk = chunk->next.unshared)
+		tupleSpace += chunk->used;
+
+	nparts = (int) Min(tupleSpace / HASH_RADIX_PARTITION_SIZE,
+					   (Size) hashtable->nbuckets);
+	if (nparts < 2)
+		return;
+	radixBits = pg_ceil_log2_32(nparts);
+	radixBits = Min(radixBits, hashtable->log2_nbuckets);
+
+	if (hashtable->spaceUsed + tupleSpace > hashtable->spaceAllowed)
+		return;
+
+	/* Rebuild the chains from copies of their tuples, in bucket order */
+	hashtable->chunks = NULL;
+	for (int i = 0; i < hashtable->nbuckets; i++)
+	{
+		HashJoinTuple *link = &hashtable->buckets.unshared[i];
+		HashJoinTuple hashTuple = *link;
+
+		while (hashTuple != NULL)
+		{
+			Size		size = HJTUPLE_OVERHEAD + HJTUPLE_MINTUPLE(hashTuple)->t_len;
+			HashJoinTuple copyTuple = (HashJoinTuple) dense_alloc(hashtable,
+																  size);
+
+			memcpy(copyTuple, hashTuple, size);
+			*link = copyTuple;
+			link = &copyTuple->next.unshared;
+			hashTuple = hashTuple->next.unshared;
+		}
+
+		/* allow this loop to be cancellable */
+		if ((i & 0xFFFF) == 0)
+			CHECK_FOR_INTERRUPTS();
+	}
+
+	hashtable->spacePeak = Max(hashtable->spacePeak,
+							   hashtable->spaceUsed + tupleSpace);
+
+	/* Release the old chunks */
+	while (oldchunks != NULL)
+	{
+		HashMemoryChunk nextchunk = oldchunks->next.unshared;
+
+		pfree(oldchunks);
+		oldchunks = nextchunk;
+	}
+
+	hashtable->radixBits = radixBits;
+	hashtable->radixBitsPeak = Max(hashtable->radixBitsPeak, radixBits);
 }
 
 /*
@@ -2718,6 +2938,9 @@ ExecHashAccumInstrumentation(HashInstrumentation *instrument,
 									  hashtable->nbatch_original);
 	instrument->space_peak = Max(instrument->space_peak,
 								 hashtable->spacePeak);
+	if (hashtable->radixBitsPeak > 0)
+		instrument->radix_partitions = Max(instrument->radix_partitions,
+										   1 << hashtable->radixBitsPeak);
 }
 
 /*
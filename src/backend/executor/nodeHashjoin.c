@@ -101,6 +101,24 @@
  * tuples while in PHJ_BATCH_PROBING phase, but that's OK because we use
  * BarrierArriveAndDetach() to advance it to PHJ_BATCH_DONE without waiting.
  *
+ * BATCHED PROBING
+ *
+ * Once the hash table of the current batch has HJ_PROBE_MIN_BUCKETS buckets
+ * or more, the bucket array and the tuples are too big to stay in the CPU
+ * caches, and following a bucket chain costs a cache miss or two per outer
+ * tuple.  Both the parallel-oblivious and the parallel-aware variants then
+ * read outer tuples ahead, HJ_PROBE_BATCH_SIZE at a time: the tuples are
+ * fetched, hashed and copied into hj_ProbeCxt (see
+ * ExecHashJoinFillProbeBatch), and the bucket heads of the whole group are
+ * prefetched before the first of them is probed, so that their cache misses
+ * overlap.  ExecHashJoinProbeGetTuple then returns the tuples to the state
+ * machine one at a time, in the order they were read unless the batch is
+ * radix partitioned.  The state machine saves the tuples that belong to a
+ * later batch to their batch file as usual.  A rescan discards any tuples
+ * that were read ahead but not probed yet.  Smaller hash tables are probed
+ * one outer tuple at a time, since copying the tuples would cost more than
+ * it saves.
+ *
  *-------------------------------------------------------------------------
  */
 
@@ -128,17 +146,55 @@
 #define HJ_FILL_INNER_TUPLES	5
 #define HJ_NEED_NEW_BATCH		6
 
+/*
+ * Strategies of an adaptive join, see ExecAdaptiveJoin
+ */
+#define HJ_ADAPTIVE_START		0
+#define HJ_ADAPTIVE_NESTLOOP	1
+#define HJ_ADAPTIVE_HASH		2
+
+/*
+ * Batched probing: when the hash table is large enough that following a
+ * bucket chain means a cache miss at nearly every step, outer tuples are
+ * fetched and hashed HJ_PROBE_BATCH_SIZE at a time, and the heads of their
+ * buckets are prefetched before any of them is probed.
+ */
+#define HJ_PROBE_BATCH_SIZE		32
+#define HJ_PROBE_MIN_BUCKETS	16384
+
+/*
+ * With a radix partitioned hash table, enough outer tuples are fetched ahead
+ * to give each partition a useful group of probes, see
+ * ExecHashJoinFillProbeBatch.
+ */
+#define HJ_RADIX_TUPLES_PER_PARTITION	16
+#define HJ_RADIX_MAX_PROBE_TUPLES		65536
+#define HJ_RADIX_SORT_BITS				12
+
 /* Returns true if doing null-fill on outer relation */
 #define HJ_FILL_OUTER(hjstate)	((hjstate)->hj_NullInnerTupleSlot != NULL)
 /* Returns true if doing null-fill on inner relation */
 #define HJ_FILL_INNER(hjstate)	((hjstate)->hj_NullOuterTupleSlot != NULL)
 
+static void ExecAdaptiveJoinChoose(HashJoinState *node);
+static TupleTableSlot *ExecAdaptiveJoinNestLoop(HashJoinState *node);
+static TupleTableSlot *ExecAdaptiveJoinGetBuffered(HashJoinState *hjstate);
+static inline TupleTableSlot *ExecHashJoinNextOuter(PlanState *outerNode,
+													HashJoinState *hjstate);
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
 static TupleTableSlot *ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 														 HashJoinState *hjstate,
 														 uint32 *hashvalue);
+static inline TupleTableSlot *ExecHashJoinProbeGetTuple(PlanState *outerNode,
+														HashJoinState *hjstate,
+														uint32 *hashvalue,
+														bool parallel);
+static int	ExecHashJoinFillProbeBatch(PlanState *outerNode,
+									   HashJoinState *hjstate,
+									   bool parallel);
+static void ExecHashJoinSortProbeBatch(HashJoinState *hjstate, int count);
 static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 												 BufFile *file,
 												 uint32 *hashvalue,
@@ -255,11 +311,20 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					 */
 					node->hj_FirstOuterTupleSlot = NULL;
 				}
+				else if (((Hash *) hashNode->ps.plan)->rtfilterParam >= 0)
+				{
+					/*
+					 * The outer side is to be filtered by what we're about to
+					 * build, so don't read from it yet.
+					 */
+					node->hj_FirstOuterTupleSlot = NULL;
+				}
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
 						  !node->hj_OuterNotEmpty))
 				{
-					node->hj_FirstOuterTupleSlot = ExecProcNode(outerNode);
+					node->hj_FirstOuterTupleSlot = ExecHashJoinNextOuter(outerNode,
+																		 node);
 					if (TupIsNull(node->hj_FirstOuterTupleSlot))
 					{
 						node->hj_OuterNotEmpty = false;
@@ -280,6 +345,9 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 												node->hj_HashOperators,
 												node->hj_Collations,
 												HJ_FILL_INNER(node));
+				hashtable->radixEnabled =
+					((HashJoin *) node->js.ps.plan)->radix_partition &&
+					hashtable->parallel_state == NULL;
 				node->hj_HashTable = hashtable;
 
 				/*
@@ -347,13 +415,9 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				/*
 				 * We don't have an outer tuple, try to get the next one
 				 */
-				if (parallel)
-					outerTupleSlot =
-						ExecParallelHashJoinOuterGetTuple(outerNode, node,
-														  &hashvalue);
-				else
-					outerTupleSlot =
-						ExecHashJoinOuterGetTuple(outerNode, node, &hashvalue);
+				outerTupleSlot = ExecHashJoinProbeGetTuple(outerNode, node,
+														   &hashvalue,
+														   parallel);
 
 				if (TupIsNull(outerTupleSlot))
 				{
@@ -607,6 +671,225 @@ ExecParallelHashJoin(PlanState *pstate)
 	return ExecHashJoinImpl(pstate, true);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecAdaptiveJoin
+ *
+ *		Version for adaptive joins, see HashJoin.  The planner chose a
+ *		nested loop over a parameterized inner plan, but was not sure of
+ *		the size of the outer side, so we first read up to nl_max_rows outer
+ *		tuples into a tuplestore.  If the outer side ends before that, the
+ *		buffered tuples are joined by the nested loop.  Otherwise we switch
+ *		to an ordinary hash join, which probes the hash table with the
+ *		buffered tuples before it goes on with the rest of the outer side.
+ *
+ *		On a rescan the choice is made afresh, unless we can keep using the
+ *		hash table built before.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *			/* return: a tuple or NULL */
+ExecAdaptiveJoin(PlanState *pstate)
+{
+	HashJoinState *node = castNode(HashJoinState, pstate);
+
+	if (node->hj_AdaptiveState == HJ_ADAPTIVE_START)
+		ExecAdaptiveJoinChoose(node);
+
+	if (node->hj_AdaptiveState == HJ_ADAPTIVE_HASH)
+		return ExecHashJoin(pstate);
+	else
+		return ExecAdaptiveJoinNestLoop(node);
+}
+
+/*
+ * ExecAdaptiveJoinChoose
+ *
+ *		buffer outer tuples and decide on the strategy of an adaptive join
+ */
+static void
+ExecAdaptiveJoinChoose(HashJoinState *node)
+{
+	HashJoin   *plan = (HashJoin *) node->js.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	double		ntuples = 0;
+
+	/* A hash table kept across a rescan is as cheap as it gets */
+	if (node->hj_HashTable != NULL)
+	{
+		node->hj_AdaptiveState = HJ_ADAPTIVE_HASH;
+		node->hj_HashScans++;
+		return;
+	}
+
+	Assert(node->hj_AdaptiveBuffer == NULL);
+	node->hj_AdaptiveBuffer = tuplestore_begin_heap(false, false, work_mem);
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+			break;
+
+		tuplestore_puttupleslot(node->hj_AdaptiveBuffer, slot);
+
+		if (++ntuples > plan->nl_max_rows)
+		{
+			/*
+			 * Too many outer tuples for a nested loop, so hash.  We know the
+			 * outer side isn't empty, which keeps ExecHashJoinImpl from
+			 * fetching a tuple ahead of the buffered ones.
+			 */
+			node->hj_AdaptiveState = HJ_ADAPTIVE_HASH;
+			node->hj_OuterNotEmpty = true;
+			node->hj_HashScans++;
+			return;
+		}
+	}
+
+	node->hj_AdaptiveState = HJ_ADAPTIVE_NESTLOOP;
+	node->hj_NestLoopNeedOuter = true;
+	node->hj_NestLoopScans++;
+}
+
+/*
+ * ExecAdaptiveJoinNestLoop
+ *
+ *		join the buffered outer tuples by rescanning the nested-loop inner
+ *		plan for each of them
+ *
+ * This works like ExecNestLoop, for the inner and semi joins the planner
+ * makes adaptive.  The inner plan applies the join clauses it was
+ * parameterized with, but we check all of them again, as the hash join
+ * would, so that the same quals apply in both strategies.
+ */
+static TupleTableSlot *
+ExecAdaptiveJoinNestLoop(HashJoinState *node)
+{
+	HashJoin   *plan = (HashJoin *) node->js.ps.plan;
+	PlanState  *innerPlan = node->hj_NestLoopInner;
+	ExprState  *joinqual = node->js.joinqual;
+	ExprState  *otherqual = node->js.ps.qual;
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+
+	ResetExprContext(econtext);
+
+	for (;;)
+	{
+		TupleTableSlot *innerTupleSlot;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (node->hj_NestLoopNeedOuter)
+		{
+			TupleTableSlot *outerTupleSlot;
+			ListCell   *lc;
+
+			outerTupleSlot = ExecAdaptiveJoinGetBuffered(node);
+			if (TupIsNull(outerTupleSlot))
+				return NULL;
+
+			econtext->ecxt_outertuple = outerTupleSlot;
+			node->hj_NestLoopNeedOuter = false;
+
+			/* pass the outer values to the inner plan, see ExecNestLoop */
+			foreach(lc, plan->nestParams)
+			{
+				NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+				int			paramno = nlp->paramno;
+				ParamExecData *prm;
+
+				prm = &(econtext->ecxt_param_exec_vals[paramno]);
+				Assert(IsA(nlp->paramval, Var));
+				Assert(nlp->paramval->varno == OUTER_VAR);
+				Assert(nlp->paramval->varattno > 0);
+				prm->value = slot_getattr(outerTupleSlot,
+										  nlp->paramval->varattno,
+										  &(prm->isnull));
+				innerPlan->chgParam = bms_add_member(innerPlan->chgParam,
+													 paramno);
+			}
+
+			ExecReScan(innerPlan);
+		}
+
+		innerTupleSlot = ExecProcNode(innerPlan);
+		econtext->ecxt_innertuple = innerTupleSlot;
+
+		if (TupIsNull(innerTupleSlot))
+		{
+			node->hj_NestLoopNeedOuter = true;
+			continue;
+		}
+
+		if (ExecQual(node->hashclauses, econtext) &&
+			(joinqual == NULL || ExecQual(joinqual, econtext)))
+		{
+			if (node->js.single_match)
+				node->hj_NestLoopNeedOuter = true;
+
+			if (otherqual == NULL || ExecQual(otherqual, econtext))
+				return ExecProject(node->js.ps.ps_ProjInfo);
+			else
+				InstrCountFiltered2(node, 1);
+		}
+		else
+			InstrCountFiltered1(node, 1);
+
+		ResetExprContext(econtext);
+	}
+}
+
+/*
+ * ExecAdaptiveJoinGetBuffered
+ *
+ *		get the next outer tuple an adaptive join has buffered
+ *
+ * The tuple is returned in hj_OuterTupleSlot, which has the same type as the
+ * outer plan's result slot, so that it can be used in expressions compiled
+ * for that.  Returns a null slot when all buffered tuples have been read.
+ */
+static TupleTableSlot *
+ExecAdaptiveJoinGetBuffered(HashJoinState *hjstate)
+{
+	MinimalTuple tuple;
+	bool		shouldFree;
+
+	if (!tuplestore_gettupleslot(hjstate->hj_AdaptiveBuffer, true, false,
+								 hjstate->hj_AdaptiveSlot))
+		return ExecClearTuple(hjstate->hj_OuterTupleSlot);
+
+	tuple = ExecFetchSlotMinimalTuple(hjstate->hj_AdaptiveSlot, &shouldFree);
+	Assert(!shouldFree);
+	ExecForceStoreMinimalTuple(tuple, hjstate->hj_OuterTupleSlot, false);
+
+	return hjstate->hj_OuterTupleSlot;
+}
+
+/*
+ * ExecHashJoinNextOuter
+ *
+ *		fetch the next tuple from the outer plan
+ *
+ * If an adaptive join switched to hashing, the outer tuples it had already
+ * buffered come first.
+ */
+static inline TupleTableSlot *
+ExecHashJoinNextOuter(PlanState *outerNode, HashJoinState *hjstate)
+{
+	if (unlikely(hjstate->hj_AdaptiveBuffer != NULL))
+	{
+		TupleTableSlot *slot = ExecAdaptiveJoinGetBuffered(hjstate);
+
+		if (!TupIsNull(slot))
+			return slot;
+
+		tuplestore_end(hjstate->hj_AdaptiveBuffer);
+		hjstate->hj_AdaptiveBuffer = NULL;
+	}
+
+	return ExecProcNode(outerNode);
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitHashJoin
  *
@@ -663,6 +946,21 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	innerPlanState(hjstate) = ExecInitNode((Plan *) hashNode, estate, eflags);
 	innerDesc = ExecGetResultType(innerPlanState(hjstate));
 
+	/*
+	 * An adaptive join also has the inner plan of its nested-loop strategy,
+	 * which will always be rescanned with fresh parameter values, so it
+	 * needn't support REWIND.  Our expressions then see inner tuples from
+	 * either plan, so we can't rely on the type of the Hash node's slot.
+	 */
+	if (node->nlinner != NULL)
+	{
+		hjstate->hj_NestLoopInner = ExecInitNode(node->nlinner, estate,
+												 eflags & ~EXEC_FLAG_REWIND);
+		hjstate->js.ps.inneropsset = true;
+		hjstate->js.ps.inneropsfixed = false;
+		hjstate->js.ps.ExecProcNode = ExecAdaptiveJoin;
+	}
+
 	/*
 	 * Initialize result slot, type and projection.
 	 */
@@ -675,6 +973,9 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	ops = ExecGetResultSlotOps(outerPlanState(hjstate), NULL);
 	hjstate->hj_OuterTupleSlot = ExecInitExtraTupleSlot(estate, outerDesc,
 														ops);
+	if (node->nlinner != NULL)
+		hjstate->hj_AdaptiveSlot = ExecInitExtraTupleSlot(estate, outerDesc,
+														  &TTSOpsMinimalTuple);
 
 	/*
 	 * detect whether we need only consider the first matching inner tuple
@@ -752,6 +1053,14 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
 
+	hjstate->hj_ProbeCxt = AllocSetContextCreate(CurrentMemoryContext,
+												 "HashJoin probe batch",
+												 ALLOCSET_DEFAULT_SIZES);
+	hjstate->hj_ProbeSize = 0;
+	hjstate->hj_ProbeCount = 0;
+	hjstate->hj_ProbeNext = 0;
+	hjstate->hj_ProbeExhausted = false;
+
 	return hjstate;
 }
 
@@ -785,11 +1094,22 @@ ExecEndHashJoin(HashJoinState *node)
 	ExecClearTuple(node->hj_OuterTupleSlot);
 	ExecClearTuple(node->hj_HashTupleSlot);
 
+	/*
+	 * release the outer tuples buffered by an adaptive join
+	 */
+	if (node->hj_AdaptiveBuffer)
+	{
+		tuplestore_end(node->hj_AdaptiveBuffer);
+		node->hj_AdaptiveBuffer = NULL;
+	}
+
 	/*
 	 * clean up subtrees
 	 */
 	ExecEndNode(outerPlanState(node));
 	ExecEndNode(innerPlanState(node));
+	if (node->hj_NestLoopInner)
+		ExecEndNode(node->hj_NestLoopInner);
 }
 
 /*
@@ -823,7 +1143,7 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 		if (!TupIsNull(slot))
 			hjstate->hj_FirstOuterTupleSlot = NULL;
 		else
-			slot = ExecProcNode(outerNode);
+			slot = ExecHashJoinNextOuter(outerNode, hjstate);
 
 		while (!TupIsNull(slot))
 		{
@@ -849,7 +1169,7 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			 * That tuple couldn't match because of a NULL, so discard it and
 			 * continue with the next one.
 			 */
-			slot = ExecProcNode(outerNode);
+			slot = ExecHashJoinNextOuter(outerNode, hjstate);
 		}
 	}
 	else if (curbatch < hashtable->nbatch)
@@ -875,6 +1195,230 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	return NULL;
 }
 
+/*
+ * ExecHashJoinProbeGetTuple
+ *
+ *		get the next outer tuple to probe the hash table with
+ *
+ * This is a wrapper around ExecHashJoinOuterGetTuple and its parallel
+ * variant that fetches outer tuples ahead when the hash table is big, see
+ * ExecHashJoinFillProbeBatch.  The buffered tuples are returned one at a
+ * time; before each group of HJ_PROBE_BATCH_SIZE of them is probed, the
+ * heads of their buckets are prefetched.
+ */
+static pg_attribute_always_inline TupleTableSlot *
+ExecHashJoinProbeGetTuple(PlanState *outerNode,
+						  HashJoinState *hjstate,
+						  uint32 *hashvalue,
+						  bool parallel)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			next;
+
+	if (hjstate->hj_ProbeNext >= hjstate->hj_ProbeCount)
+	{
+		if (hjstate->hj_ProbeExhausted)
+		{
+			/* report the end of the batch once, then start afresh */
+			hjstate->hj_ProbeExhausted = false;
+			return NULL;
+		}
+
+		if (hashtable->nbuckets < HJ_PROBE_MIN_BUCKETS &&
+			hashtable->radixBits == 0)
+		{
+			if (parallel)
+				return ExecParallelHashJoinOuterGetTuple(outerNode, hjstate,
+														 hashvalue);
+			else
+				return ExecHashJoinOuterGetTuple(outerNode, hjstate,
+												 hashvalue);
+		}
+
+		if (ExecHashJoinFillProbeBatch(outerNode, hjstate, parallel) == 0)
+		{
+			hjstate->hj_ProbeExhausted = false;
+			return NULL;
+		}
+	}
+
+	if (hjstate->hj_ProbeNext % HJ_PROBE_BATCH_SIZE == 0)
+	{
+		int			end = Min(hjstate->hj_ProbeNext + HJ_PROBE_BATCH_SIZE,
+							  hjstate->hj_ProbeCount);
+
+		/*
+		 * Prefetch the bucket array entries of the next group first; by the
+		 * time we are done with that, they should be arriving and we can
+		 * prefetch the first tuple of each bucket.
+		 */
+		for (int i = hjstate->hj_ProbeNext; i < end; i++)
+		{
+			int			bucketno = hjstate->hj_ProbeBucketNos[hjstate->hj_ProbeOrder[i]];
+
+			if (bucketno >= 0)
+				ExecHashPrefetchBucket(hashtable, bucketno, false);
+		}
+		for (int i = hjstate->hj_ProbeNext; i < end; i++)
+		{
+			int			bucketno = hjstate->hj_ProbeBucketNos[hjstate->hj_ProbeOrder[i]];
+
+			if (bucketno >= 0)
+				ExecHashPrefetchBucket(hashtable, bucketno, true);
+		}
+	}
+
+	next = hjstate->hj_ProbeOrder[hjstate->hj_ProbeNext++];
+	*hashvalue = hjstate->hj_ProbeHashValues[next];
+	ExecForceStoreMinimalTuple(hjstate->hj_ProbeTuples[next],
+							   hjstate->hj_OuterTupleSlot,
+							   false);
+
+	return hjstate->hj_OuterTupleSlot;
+}
+
+/*
+ * ExecHashJoinFillProbeBatch
+ *
+ *		fetch and hash the next group of outer tuples
+ *
+ * Normally HJ_PROBE_BATCH_SIZE tuples are fetched and probed in their
+ * original order.  If the current batch of the hash table is radix
+ * partitioned (see ExecHashTableRadixCluster), we fetch up to
+ * HJ_RADIX_TUPLES_PER_PARTITION tuples per partition, limited by work_mem,
+ * and sort them by partition, so that the tuples probing the same partition
+ * are probed one after another while it is in the cache.  A hash join's
+ * output order is not guaranteed, so this is allowed.
+ *
+ * The tuples are copied, because the outer plan is free to reuse its slot.
+ * Returns the number of tuples fetched, zero at the end of the batch.
+ */
+static int
+ExecHashJoinFillProbeBatch(PlanState *outerNode,
+						   HashJoinState *hjstate,
+						   bool parallel)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			maxcount = HJ_PROBE_BATCH_SIZE;
+	int			count = 0;
+
+	if (hashtable->radixBits > 0)
+		maxcount = Min(HJ_RADIX_TUPLES_PER_PARTITION << hashtable->radixBits,
+					   HJ_RADIX_MAX_PROBE_TUPLES);
+
+	/* Make sure the arrays are big enough */
+	if (hjstate->hj_ProbeSize < maxcount)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(hjstate->js.ps.state->es_query_cxt);
+
+		if (hjstate->hj_ProbeSize > 0)
+		{
+			pfree(hjstate->hj_ProbeTuples);
+			pfree(hjstate->hj_ProbeHashValues);
+			pfree(hjstate->hj_ProbeBucketNos);
+			pfree(hjstate->hj_ProbeOrder);
+		}
+		hjstate->hj_ProbeTuples = palloc(sizeof(MinimalTuple) * maxcount);
+		hjstate->hj_ProbeHashValues = palloc(sizeof(uint32) * maxcount);
+		hjstate->hj_ProbeBucketNos = palloc(sizeof(int) * maxcount);
+		hjstate->hj_ProbeOrder = palloc(sizeof(int) * maxcount);
+		hjstate->hj_ProbeSize = maxcount;
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	MemoryContextReset(hjstate->hj_ProbeCxt);
+
+	while (count < maxcount)
+	{
+		TupleTableSlot *slot;
+		uint32		hashvalue;
+		int			bucketno;
+		int			batchno;
+		MemoryContext oldcxt;
+
+		if (parallel)
+			slot = ExecParallelHashJoinOuterGetTuple(outerNode, hjstate,
+													 &hashvalue);
+		else
+			slot = ExecHashJoinOuterGetTuple(outerNode, hjstate, &hashvalue);
+		if (TupIsNull(slot))
+		{
+			hjstate->hj_ProbeExhausted = true;
+			break;
+		}
+
+		oldcxt = MemoryContextSwitchTo(hjstate->hj_ProbeCxt);
+		hjstate->hj_ProbeTuples[count] = ExecCopySlotMinimalTuple(slot);
+		MemoryContextSwitchTo(oldcxt);
+		hjstate->hj_ProbeHashValues[count] = hashvalue;
+
+		/* tuples belonging to a later batch won't probe anything now */
+		ExecHashGetBucketAndBatch(hashtable, hashvalue, &bucketno, &batchno);
+		hjstate->hj_ProbeBucketNos[count] =
+			(batchno == hashtable->curbatch) ? bucketno : -1;
+		hjstate->hj_ProbeOrder[count] = count;
+		count++;
+
+		if (count >= HJ_PROBE_BATCH_SIZE &&
+			MemoryContextMemAllocated(hjstate->hj_ProbeCxt, false) >
+			work_mem * 1024L)
+			break;
+	}
+
+	if (hashtable->radixBits > 0 && count > HJ_PROBE_BATCH_SIZE)
+		ExecHashJoinSortProbeBatch(hjstate, count);
+
+	hjstate->hj_ProbeCount = count;
+	hjstate->hj_ProbeNext = 0;
+
+	return count;
+}
+
+/*
+ * ExecHashJoinSortProbeBatch
+ *
+ *		order the buffered outer tuples by radix partition
+ *
+ * This is a counting sort on the partition number, or on its leading
+ * HJ_RADIX_SORT_BITS bits if there are more partitions than that.  Tuples
+ * not probing the current batch go first; they are just written out.
+ */
+static void
+ExecHashJoinSortProbeBatch(HashJoinState *hjstate, int count)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			sortbits = Min(hashtable->radixBits, HJ_RADIX_SORT_BITS);
+	int			shift = hashtable->radixBits - sortbits;
+	int			nslots = (1 << sortbits) + 1;
+	int		   *offsets;
+
+	offsets = palloc0(sizeof(int) * (nslots + 1));
+
+	/* slot 0 is for tuples of other batches, slot p + 1 for partition p */
+	for (int i = 0; i < count; i++)
+	{
+		int			bucketno = hjstate->hj_ProbeBucketNos[i];
+		int			slot;
+
+		slot = bucketno < 0 ? 0 :
+			(HASH_RADIX_PARTITION(hashtable, bucketno) >> shift) + 1;
+		offsets[slot + 1]++;
+	}
+	for (int i = 1; i <= nslots; i++)
+		offsets[i] += offsets[i - 1];
+	for (int i = 0; i < count; i++)
+	{
+		int			bucketno = hjstate->hj_ProbeBucketNos[i];
+		int			slot;
+
+		slot = bucketno < 0 ? 0 :
+			(HASH_RADIX_PARTITION(hashtable, bucketno) >> shift) + 1;
+		hjstate->hj_ProbeOrder[offsets[slot]++] = i;
+	}
+
+	pfree(offsets);
+}
+
 /*
  * ExecHashJoinOuterGetTuple variant for the parallel case.
  */
@@ -1063,6 +1607,9 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 		 */
 		BufFileClose(innerFile);
 		hashtable->innerBatchFile[curbatch] = NULL;
+
+		if (hashtable->radixEnabled)
+			ExecHashTableRadixCluster(hashtable);
 	}
 
 	/*
@@ -1346,6 +1893,16 @@ ExecReScanHashJoin(HashJoinState *node)
 			node->hj_HashTable = NULL;
 			node->hj_JoinState = HJ_BUILD_HASHTABLE;
 
+			/*
+			 * The new hash table comes with a new runtime filter, so make
+			 * sure that nodes on the outer side don't hang on to tuples they
+			 * filtered with the old one.
+			 */
+			if (((Hash *) hashNode->ps.plan)->rtfilterParam >= 0)
+				node->js.ps.lefttree->chgParam =
+					bms_add_member(node->js.ps.lefttree->chgParam,
+								   ((Hash *) hashNode->ps.plan)->rtfilterParam);
+
 			/*
 			 * if chgParam of subnode is not null then plan will be re-scanned
 			 * by first ExecProcNode.
@@ -1364,6 +1921,32 @@ ExecReScanHashJoin(HashJoinState *node)
 	node->hj_MatchedOuter = false;
 	node->hj_FirstOuterTupleSlot = NULL;
 
+	/* Forget any outer tuples fetched ahead */
+	node->hj_ProbeCount = 0;
+	node->hj_ProbeNext = 0;
+	node->hj_ProbeExhausted = false;
+	MemoryContextReset(node->hj_ProbeCxt);
+
+	/*
+	 * An adaptive join forgets the outer tuples it buffered and chooses its
+	 * strategy again.  The nested-loop inner plan is rescanned for every
+	 * outer tuple anyway, but it must learn about changed parameters.
+	 */
+	if (node->hj_NestLoopInner != NULL)
+	{
+		if (node->hj_AdaptiveBuffer != NULL)
+		{
+			tuplestore_end(node->hj_AdaptiveBuffer);
+			node->hj_AdaptiveBuffer = NULL;
+		}
+		ExecClearTuple(node->hj_OuterTupleSlot);
+		node->hj_AdaptiveState = HJ_ADAPTIVE_START;
+
+		if (node->js.ps.chgParam != NULL)
+			UpdateChangedParamSet(node->hj_NestLoopInner,
+								  node->js.ps.chgParam);
+	}
+
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
 	 * first ExecProcNode.
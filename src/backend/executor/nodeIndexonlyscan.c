@@ -101,6 +101,8 @@ IndexOnlyNext(IndexOnlyScanState *node)
 
 		/* Set it up for index-only scan */
 		node->ioss_ScanDesc->xs_want_itup = true;
+		node->ioss_ScanDesc->xs_allow_skip =
+			((IndexOnlyScan *) node->ss.ps.plan)->indexskip;
 		node->ioss_VMBuffer = InvalidBuffer;
 
 		/*
@@ -678,6 +680,8 @@ ExecIndexOnlyScanInitializeDSM(IndexOnlyScanState *node,
 								 node->ioss_NumOrderByKeys,
 								 piscan);
 	node->ioss_ScanDesc->xs_want_itup = true;
+	node->ioss_ScanDesc->xs_allow_skip =
+		((IndexOnlyScan *) node->ss.ps.plan)->indexskip;
 	node->ioss_VMBuffer = InvalidBuffer;
 
 	/*
@@ -723,6 +727,8 @@ ExecIndexOnlyScanInitializeWorker(IndexOnlyScanState *node,
 								 node->ioss_NumOrderByKeys,
 								 piscan);
 	node->ioss_ScanDesc->xs_want_itup = true;
+	node->ioss_ScanDesc->xs_allow_skip =
+		((IndexOnlyScan *) node->ss.ps.plan)->indexskip;
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
@@ -116,6 +116,7 @@ IndexNext(IndexScanState *node)
 								   node->iss_NumOrderByKeys);
 
 		node->iss_ScanDesc = scandesc;
+		scandesc->xs_allow_skip = ((IndexScan *) node->ss.ps.plan)->indexskip;
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -211,6 +212,7 @@ IndexNextWithReorder(IndexScanState *node)
 								   node->iss_NumOrderByKeys);
 
 		node->iss_ScanDesc = scandesc;
+		scandesc->xs_allow_skip = ((IndexScan *) node->ss.ps.plan)->indexskip;
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -960,6 +962,7 @@ ExecInitIndexScan(IndexScan *node, EState *estate, int eflags)
 		ExecInitQual(node->indexqualorig, (PlanState *) indexstate);
 	indexstate->indexorderbyorig =
 		ExecInitExprList(node->indexorderbyorig, (PlanState *) indexstate);
+	ExecInitScanRuntimeFilters(&indexstate->ss);
 
 	/*
 	 * If we are just doing EXPLAIN (ie, aren't going to run the plan), stop
@@ -1693,6 +1696,8 @@ ExecIndexScanInitializeDSM(IndexScanState *node,
 								 node->iss_NumScanKeys,
 								 node->iss_NumOrderByKeys,
 								 piscan);
+	node->iss_ScanDesc->xs_allow_skip =
+		((IndexScan *) node->ss.ps.plan)->indexskip;
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
@@ -1736,6 +1741,8 @@ ExecIndexScanInitializeWorker(IndexScanState *node,
 								 node->iss_NumScanKeys,
 								 node->iss_NumOrderByKeys,
 								 piscan);
+	node->iss_ScanDesc->xs_allow_skip =
+		((IndexScan *) node->ss.ps.plan)->indexskip;
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
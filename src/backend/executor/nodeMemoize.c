@@ -50,6 +50,27 @@
  * demanding, then that may allow us to start putting useful entries back into
  * the cache again.
  *
+ * The planner costs a Memoize node using an estimate of the cache hit ratio.
+ * When that estimate is badly wrong, caching only costs us memory and CPU, so
+ * we keep track of the hit ratio over windows of MEMO_ADAPTIVE_WINDOW
+ * lookups.  Once the planner expects every distinct key to have been seen
+ * once, a window whose hit ratio falls far below the estimate makes us stop
+ * using the cache for the rest of the scan.  From then on every rescan goes
+ * straight to the subplan.
+ *
+ * In a parallel query, each participant would normally build its own cache,
+ * so each one spends its own hash_mem and only sees hits for the keys it has
+ * seen itself.  If the subplan depends on no parameters other than the cache
+ * keys, all participants instead share one cache, kept in the query's DSA
+ * area.  An entry is filled privately by the participant that had the miss,
+ * and only becomes visible to the others once it is complete, after which it
+ * never changes.  A hit copies the entry back to private memory, so entries
+ * can be evicted at any time.  Instead of an LRU list, which all
+ * participants would have to update on every hit, eviction uses a clock
+ * sweep over the hash buckets: a hit sets the entry's usage flag, and the
+ * sweep evicts entries whose flag it has already cleared once.  The buckets
+ * are protected by a fixed set of partition locks.
+ *
  *
  * INTERFACE ROUTINES
  *		ExecMemoize			- lookup cache, exec subplan when not found
@@ -71,7 +92,11 @@
 #include "executor/nodeMemoize.h"
 #include "lib/ilist.h"
 #include "miscadmin.h"
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
+#include "storage/lwlock.h"
 #include "utils/datum.h"
+#include "utils/dsa.h"
 #include "utils/lsyscache.h"
 
 /* States of the ExecMemoize state machine */
@@ -90,6 +115,25 @@
 #define CACHE_TUPLE_BYTES(t)			(sizeof(MemoizeTuple) + \
 										 (t)->mintuple->t_len)
 
+/*
+ * We stop using the cache when the hit ratio over a window of this many
+ * lookups falls below MEMO_ADAPTIVE_MIN_FRACTION of the planner's estimate.
+ */
+#define MEMO_ADAPTIVE_WINDOW			1000
+#define MEMO_ADAPTIVE_MIN_FRACTION		0.25
+
+/*
+ * The toc key under which a shared cache is stored.  The plan node ID itself
+ * is used for the shared instrumentation.
+ */
+#define PARALLEL_MEMOIZE_KEY(plan_node_id) \
+	(UINT64CONST(0xD100000000000000) | (plan_node_id))
+
+/* Shared cache sizing */
+#define MEMO_SHARED_PARTITIONS			64
+#define MEMO_SHARED_MIN_BUCKETS			1024
+#define MEMO_SHARED_MAX_BUCKETS			(1 << 20)
+
  /* MemoizeTuple Stores an individually cached tuple */
 typedef struct MemoizeTuple
 {
@@ -122,6 +166,41 @@ typedef struct MemoizeEntry
 	bool		complete;		/* Did we read the outer plan to completion? */
 } MemoizeEntry;
 
+/*
+ * MemoizeSharedCache
+ *		Control data of a cache that is shared by all participants of a
+ *		parallel query.  Lives in the DSM segment, while the entries that the
+ *		buckets point to are allocated in the query's DSA area.
+ */
+typedef struct MemoizeSharedCache
+{
+	uint64		mem_limit;		/* memory limit in bytes for the cache */
+	pg_atomic_uint64 mem_used;	/* bytes of memory used by cache */
+	pg_atomic_uint32 clock_hand;	/* next bucket for the eviction sweep */
+	uint32		nbuckets;		/* size of buckets[], a power of 2 */
+	LWLock		locks[MEMO_SHARED_PARTITIONS];	/* protect the buckets */
+	dsa_pointer buckets[FLEXIBLE_ARRAY_MEMBER]; /* chains of entries */
+} MemoizeSharedCache;
+
+/*
+ * MemoizeSharedEntry
+ *		A complete cache entry in a shared cache.  The same allocation holds
+ *		the cache key followed by 'ntuples' cached tuples, each one a
+ *		MAXALIGN'd MinimalTuple.  Nothing but the usage flag changes once the
+ *		entry has been added to the cache.
+ */
+typedef struct MemoizeSharedEntry
+{
+	dsa_pointer next;			/* next entry in the same bucket */
+	uint32		hash;			/* Hash value of the key */
+	uint32		ntuples;		/* number of cached tuples */
+	Size		size;			/* size of the whole allocation */
+	pg_atomic_uint32 usage;		/* set by hits, cleared by the clock sweep */
+} MemoizeSharedEntry;
+
+#define SHARED_ENTRY_DATA(e) \
+	((char *) (e) + MAXALIGN(sizeof(MemoizeSharedEntry)))
+
 
 #define SH_PREFIX memoize
 #define SH_ELEMENT_TYPE MemoizeEntry
@@ -135,6 +214,8 @@ static uint32 MemoizeHash_hash(struct memoize_hash *tb,
 static bool MemoizeHash_equal(struct memoize_hash *tb,
 							  const MemoizeKey *params1,
 							  const MemoizeKey *params2);
+static uint32 memoize_probe_hash(MemoizeState *mstate);
+static bool memoize_key_equal(MemoizeState *mstate, MinimalTuple params);
 
 #define SH_PREFIX memoize
 #define SH_ELEMENT_TYPE MemoizeEntry
@@ -157,7 +238,29 @@ static bool MemoizeHash_equal(struct memoize_hash *tb,
 static uint32
 MemoizeHash_hash(struct memoize_hash *tb, const MemoizeKey *key)
 {
-	MemoizeState *mstate = (MemoizeState *) tb->private_data;
+	return memoize_probe_hash((MemoizeState *) tb->private_data);
+}
+
+/*
+ * MemoizeHash_equal
+ *		Equality function for confirming hash value matches during a hash
+ *		table lookup.  'key2' is never used.  Instead the MemoizeState's
+ *		probeslot is always populated with details of what's being looked up.
+ */
+static bool
+MemoizeHash_equal(struct memoize_hash *tb, const MemoizeKey *key1,
+				  const MemoizeKey *key2)
+{
+	return memoize_key_equal((MemoizeState *) tb->private_data, key1->params);
+}
+
+/*
+ * memoize_probe_hash
+ *		Compute the hash value of the key values in mstate's probeslot.
+ */
+static uint32
+memoize_probe_hash(MemoizeState *mstate)
+{
 	TupleTableSlot *pslot = mstate->probeslot;
 	uint32		hashkey = 0;
 	int			numkeys = mstate->nkeys;
@@ -207,22 +310,19 @@ MemoizeHash_hash(struct memoize_hash *tb, const MemoizeKey *key)
 }
 
 /*
- * MemoizeHash_equal
- *		Equality function for confirming hash value matches during a hash
- *		table lookup.  'key2' is never used.  Instead the MemoizeState's
- *		probeslot is always populated with details of what's being looked up.
+ * memoize_key_equal
+ *		Check if the cache key 'params' matches the key values in mstate's
+ *		probeslot.
  */
 static bool
-MemoizeHash_equal(struct memoize_hash *tb, const MemoizeKey *key1,
-				  const MemoizeKey *key2)
+memoize_key_equal(MemoizeState *mstate, MinimalTuple params)
 {
-	MemoizeState *mstate = (MemoizeState *) tb->private_data;
 	ExprContext *econtext = mstate->ss.ps.ps_ExprContext;
 	TupleTableSlot *tslot = mstate->tableslot;
 	TupleTableSlot *pslot = mstate->probeslot;
 
 	/* probeslot should have already been prepared by prepare_probe_slot() */
-	ExecStoreMinimalTuple(key1->params, tslot, false);
+	ExecStoreMinimalTuple(params, tslot, false);
 
 	if (mstate->binary_mode)
 	{
@@ -664,6 +764,393 @@ cache_store_tuple(MemoizeState *mstate, TupleTableSlot *slot)
 	return true;
 }
 
+/*
+ * shared_cache_reduce_memory
+ *		Sweep the clock hand over the shared cache's buckets, evicting entries
+ *		that haven't been used since the hand last passed them, until the
+ *		cache is back within its memory limit.  Returns false if we gave up
+ *		before getting there.
+ */
+static bool
+shared_cache_reduce_memory(MemoizeState *mstate)
+{
+	MemoizeSharedCache *sc = mstate->shared_cache;
+	dsa_area   *area = mstate->shared_area;
+	uint64		evictions = 0;
+	uint64		nswept = 0;
+	bool		result = true;
+
+	while (pg_atomic_read_u64(&sc->mem_used) > sc->mem_limit)
+	{
+		uint32		bucket;
+		LWLock	   *lock;
+		dsa_pointer *prevp;
+		dsa_pointer p;
+
+		/*
+		 * Two revolutions of our own are enough to clear and then evict every
+		 * entry that isn't being hit in the meantime.  If that wasn't enough,
+		 * the other participants must keep using the entries, or keep adding
+		 * new ones, so give up rather than evicting their working set.
+		 */
+		if (nswept++ >= 2 * (uint64) sc->nbuckets)
+		{
+			result = false;
+			break;
+		}
+
+		bucket = pg_atomic_fetch_add_u32(&sc->clock_hand, 1) &
+			(sc->nbuckets - 1);
+		lock = &sc->locks[bucket % MEMO_SHARED_PARTITIONS];
+
+		LWLockAcquire(lock, LW_EXCLUSIVE);
+		prevp = &sc->buckets[bucket];
+		p = *prevp;
+		while (DsaPointerIsValid(p))
+		{
+			MemoizeSharedEntry *sentry = dsa_get_address(area, p);
+			dsa_pointer next = sentry->next;
+
+			if (pg_atomic_read_u32(&sentry->usage) != 0)
+			{
+				/* Give it another chance */
+				pg_atomic_write_u32(&sentry->usage, 0);
+				prevp = &sentry->next;
+			}
+			else
+			{
+				*prevp = next;
+				pg_atomic_fetch_sub_u64(&sc->mem_used, sentry->size);
+				dsa_free(area, p);
+				evictions++;
+			}
+			p = next;
+		}
+		LWLockRelease(lock);
+	}
+
+	mstate->stats.cache_evictions += evictions; /* Update Stats */
+
+	return result;
+}
+
+/*
+ * shared_cache_lookup
+ *		The shared cache counterpart of cache_lookup().  If there's a complete
+ *		entry for the scan's current parameters, copy it into scanContext and
+ *		set *found to true.  Otherwise return a new, empty private entry that
+ *		the caller can fill with shared_cache_store_tuple().  Such an entry is
+ *		only added to the shared cache once cache_entry_complete() is called
+ *		for it.
+ */
+static MemoizeEntry *
+shared_cache_lookup(MemoizeState *mstate, bool *found)
+{
+	MemoizeSharedCache *sc = mstate->shared_cache;
+	MemoizeSharedEntry *sentry = NULL;
+	MemoizeEntry *entry;
+	MemoryContext oldcontext;
+	List	   *candidates = NIL;
+	ListCell   *lc;
+	dsa_pointer p;
+	uint32		hash;
+	uint32		bucket;
+	uint32		ntuples = 0;
+	char	   *data = NULL;
+	LWLock	   *lock;
+
+	/* prepare the probe slot with the current scan parameters */
+	prepare_probe_slot(mstate, NULL);
+
+	hash = memoize_probe_hash(mstate);
+	bucket = hash & (sc->nbuckets - 1);
+	lock = &sc->locks[bucket % MEMO_SHARED_PARTITIONS];
+
+	/* We're done with whatever the previous scan used */
+	MemoryContextReset(mstate->scanContext);
+	oldcontext = MemoryContextSwitchTo(mstate->scanContext);
+
+	/*
+	 * Copy the entries with a matching hash value while we hold the lock, as
+	 * they could be evicted as soon as we release it.  Their keys are only
+	 * compared once we have released it, since that runs the equality
+	 * functions, which might be slow.  Hash collisions are rare enough that
+	 * it doesn't matter that we copy, and mark as used, the odd entry for
+	 * other parameters.
+	 */
+	LWLockAcquire(lock, LW_SHARED);
+	for (p = sc->buckets[bucket]; DsaPointerIsValid(p); p = sentry->next)
+	{
+		sentry = dsa_get_address(mstate->shared_area, p);
+
+		if (sentry->hash == hash)
+		{
+			MemoizeSharedEntry *copy = palloc(sentry->size);
+
+			pg_atomic_write_u32(&sentry->usage, 1);
+			memcpy(copy, sentry, sentry->size);
+			candidates = lappend(candidates, copy);
+		}
+	}
+	LWLockRelease(lock);
+
+	foreach(lc, candidates)
+	{
+		MemoizeSharedEntry *copy = (MemoizeSharedEntry *) lfirst(lc);
+
+		if (memoize_key_equal(mstate, (MinimalTuple) SHARED_ENTRY_DATA(copy)))
+		{
+			ntuples = copy->ntuples;
+			data = SHARED_ENTRY_DATA(copy);
+			break;
+		}
+	}
+
+	entry = (MemoizeEntry *) palloc(sizeof(MemoizeEntry));
+	entry->key = (MemoizeKey *) palloc(sizeof(MemoizeKey));
+	entry->tuplehead = NULL;
+	entry->hash = hash;
+	mstate->last_tuple = NULL;
+
+	*found = (data != NULL);
+	if (*found)
+	{
+		MemoizeTuple **tailp = &entry->tuplehead;
+
+		/* Point the entry's key and tuples into our copy */
+		entry->key->params = (MinimalTuple) data;
+		data += MAXALIGN(entry->key->params->t_len);
+
+		for (uint32 i = 0; i < ntuples; i++)
+		{
+			MemoizeTuple *tuple = (MemoizeTuple *) palloc(sizeof(MemoizeTuple));
+
+			tuple->mintuple = (MinimalTuple) data;
+			tuple->next = NULL;
+			data += MAXALIGN(tuple->mintuple->t_len);
+
+			*tailp = tuple;
+			tailp = &tuple->next;
+		}
+		entry->complete = true;
+	}
+	else
+	{
+		entry->key->params = ExecCopySlotMinimalTuple(mstate->probeslot);
+		entry->complete = false;
+
+		/*
+		 * mem_used tracks the size the shared entry will need, so that we can
+		 * give up on caching this scan once it could never fit.
+		 */
+		mstate->mem_used = MAXALIGN(sizeof(MemoizeSharedEntry)) +
+			MAXALIGN(entry->key->params->t_len);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return entry;
+}
+
+/*
+ * shared_cache_store_tuple
+ *		The shared cache counterpart of cache_store_tuple().  The tuple is
+ *		added to the private entry made by shared_cache_lookup().  Returns
+ *		false if the entry has grown too large to ever fit in the shared
+ *		cache.
+ */
+static bool
+shared_cache_store_tuple(MemoizeState *mstate, TupleTableSlot *slot)
+{
+	MemoizeTuple *tuple;
+	MemoizeEntry *entry = mstate->entry;
+	MemoryContext oldcontext;
+
+	Assert(slot != NULL);
+	Assert(entry != NULL);
+
+	oldcontext = MemoryContextSwitchTo(mstate->scanContext);
+
+	tuple = (MemoizeTuple *) palloc(sizeof(MemoizeTuple));
+	tuple->mintuple = ExecCopySlotMinimalTuple(slot);
+	tuple->next = NULL;
+
+	if (entry->tuplehead == NULL)
+		entry->tuplehead = tuple;
+	else
+		mstate->last_tuple->next = tuple;
+
+	mstate->last_tuple = tuple;
+	mstate->mem_used += MAXALIGN(tuple->mintuple->t_len);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return mstate->mem_used <= mstate->shared_cache->mem_limit;
+}
+
+/*
+ * shared_cache_publish
+ *		Copy the complete private 'entry' into the shared cache, unless
+ *		another participant has added an entry for the same key in the
+ *		meantime, or we can't free enough memory for it.
+ *
+ *		Another participant can still add an entry for the same key between
+ *		our check for one and our adding ours.  That only wastes some memory
+ *		until the clock sweep evicts one of them, as lookups use whichever
+ *		they find first.
+ */
+static void
+shared_cache_publish(MemoizeState *mstate, MemoizeEntry *entry)
+{
+	MemoizeSharedCache *sc = mstate->shared_cache;
+	dsa_area   *area = mstate->shared_area;
+	Size		size = mstate->mem_used;
+	MemoizeSharedEntry *sentry;
+	MemoizeTuple *tuple;
+	List	   *keys = NIL;
+	ListCell   *lc;
+	dsa_pointer p;
+	uint32		bucket = entry->hash & (sc->nbuckets - 1);
+	uint32		ntuples = 0;
+	uint64		mem_used;
+	LWLock	   *lock = &sc->locks[bucket % MEMO_SHARED_PARTITIONS];
+	char	   *data;
+
+	/*
+	 * Give up if another participant had a miss for the same parameters at
+	 * the same time and beat us to it.  As in shared_cache_lookup(), we copy
+	 * the keys with a matching hash value and compare them after releasing
+	 * the lock.
+	 */
+	LWLockAcquire(lock, LW_SHARED);
+	for (p = sc->buckets[bucket]; DsaPointerIsValid(p); p = sentry->next)
+	{
+		sentry = dsa_get_address(area, p);
+
+		if (sentry->hash == entry->hash)
+			keys = lappend(keys,
+						   heap_copy_minimal_tuple((MinimalTuple) SHARED_ENTRY_DATA(sentry)));
+	}
+	LWLockRelease(lock);
+
+	if (keys != NIL)
+	{
+		bool		duplicate = false;
+
+		prepare_probe_slot(mstate, entry->key);
+		foreach(lc, keys)
+		{
+			if (memoize_key_equal(mstate, (MinimalTuple) lfirst(lc)))
+			{
+				duplicate = true;
+				break;
+			}
+		}
+		list_free_deep(keys);
+		if (duplicate)
+			return;
+	}
+
+	/* Reserve the memory first, then make room for it if we must */
+	pg_atomic_fetch_add_u64(&sc->mem_used, size);
+	if (!shared_cache_reduce_memory(mstate))
+	{
+		pg_atomic_fetch_sub_u64(&sc->mem_used, size);
+		return;
+	}
+
+	p = dsa_allocate_extended(area, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(p))
+	{
+		pg_atomic_fetch_sub_u64(&sc->mem_used, size);
+		return;
+	}
+
+	sentry = dsa_get_address(area, p);
+	sentry->next = InvalidDsaPointer;
+	sentry->hash = entry->hash;
+	sentry->size = size;
+	pg_atomic_init_u32(&sentry->usage, 1);
+
+	data = SHARED_ENTRY_DATA(sentry);
+	memcpy(data, entry->key->params, entry->key->params->t_len);
+	data += MAXALIGN(entry->key->params->t_len);
+	for (tuple = entry->tuplehead; tuple != NULL; tuple = tuple->next)
+	{
+		memcpy(data, tuple->mintuple, tuple->mintuple->t_len);
+		data += MAXALIGN(tuple->mintuple->t_len);
+		ntuples++;
+	}
+	sentry->ntuples = ntuples;
+	Assert(data == (char *) sentry + size);
+
+	/* Add it to its bucket */
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+	sentry->next = sc->buckets[bucket];
+	sc->buckets[bucket] = p;
+	LWLockRelease(lock);
+
+	/* Update peak memory usage */
+	mem_used = pg_atomic_read_u64(&sc->mem_used);
+	if (mem_used > mstate->stats.mem_peak)
+		mstate->stats.mem_peak = mem_used;
+}
+
+/*
+ * cache_entry_complete
+ *		Mark 'entry' as complete.  An entry for a shared cache only becomes
+ *		visible to the other participants at this point.
+ */
+static inline void
+cache_entry_complete(MemoizeState *mstate, MemoizeEntry *entry)
+{
+	if (entry->complete)
+		return;
+
+	entry->complete = true;
+
+	if (mstate->shared_cache != NULL)
+		shared_cache_publish(mstate, entry);
+}
+
+/*
+ * cache_adapt
+ *		Record the outcome of a cache lookup.  At the end of every window of
+ *		MEMO_ADAPTIVE_WINDOW lookups, stop using the cache if the hit ratio in
+ *		that window fell far short of the planner's estimate.
+ */
+static void
+cache_adapt(MemoizeState *mstate, bool hit)
+{
+	double		hit_ratio;
+
+	/* Nothing to compare with if the planner expected no hits */
+	if (mstate->est_hit_ratio <= 0.0)
+		return;
+
+	mstate->window_lookups++;
+	if (hit)
+		mstate->window_hits++;
+
+	if (mstate->window_lookups < MEMO_ADAPTIVE_WINDOW)
+		return;
+
+	hit_ratio = (double) mstate->window_hits / mstate->window_lookups;
+	mstate->window_lookups = 0;
+	mstate->window_hits = 0;
+
+	/*
+	 * Every distinct key misses the first time it's seen, so don't judge the
+	 * cache before the planner expects all of them to have been seen once.
+	 */
+	if (mstate->stats.cache_hits + mstate->stats.cache_misses <
+		mstate->est_unique_keys)
+		return;
+
+	if (hit_ratio < mstate->est_hit_ratio * MEMO_ADAPTIVE_MIN_FRACTION)
+		mstate->adaptive_bypass = true;
+}
+
 static TupleTableSlot *
 ExecMemoize(PlanState *pstate)
 {
@@ -681,6 +1168,29 @@ ExecMemoize(PlanState *pstate)
 
 				Assert(node->entry == NULL);
 
+				/*
+				 * If we've given up on the cache, just read from the subplan
+				 * as in bypass mode.
+				 */
+				if (unlikely(node->adaptive_bypass))
+				{
+					node->stats.cache_bypasses += 1;	/* stats update */
+
+					outerNode = outerPlanState(node);
+					outerslot = ExecProcNode(outerNode);
+					if (TupIsNull(outerslot))
+					{
+						node->mstatus = MEMO_END_OF_SCAN;
+						return NULL;
+					}
+
+					node->mstatus = MEMO_CACHE_BYPASS_MODE;
+
+					slot = node->ss.ps.ps_ResultTupleSlot;
+					ExecCopySlot(slot, outerslot);
+					return slot;
+				}
+
 				/*
 				 * We're only ever in this state for the first call of the
 				 * scan.  Here we have a look to see if we've already seen the
@@ -695,11 +1205,15 @@ ExecMemoize(PlanState *pstate)
 				 */
 
 				/* see if we've got anything cached for the current parameters */
-				entry = cache_lookup(node, &found);
+				if (node->shared_cache != NULL)
+					entry = shared_cache_lookup(node, &found);
+				else
+					entry = cache_lookup(node, &found);
 
 				if (found && entry->complete)
 				{
 					node->stats.cache_hits += 1;	/* stats update */
+					cache_adapt(node, true);
 
 					/*
 					 * Set last_tuple and entry so that the state
@@ -728,6 +1242,7 @@ ExecMemoize(PlanState *pstate)
 
 				/* Handle cache miss */
 				node->stats.cache_misses += 1;	/* stats update */
+				cache_adapt(node, false);
 
 				if (found)
 				{
@@ -755,7 +1270,7 @@ ExecMemoize(PlanState *pstate)
 					 * scan.
 					 */
 					if (likely(entry))
-						entry->complete = true;
+						cache_entry_complete(node, entry);
 
 					node->mstatus = MEMO_END_OF_SCAN;
 					return NULL;
@@ -768,7 +1283,9 @@ ExecMemoize(PlanState *pstate)
 				 * tuple in the entry, then go into bypass mode.
 				 */
 				if (unlikely(entry == NULL ||
-							 !cache_store_tuple(node, outerslot)))
+							 !(node->shared_cache != NULL ?
+							   shared_cache_store_tuple(node, outerslot) :
+							   cache_store_tuple(node, outerslot))))
 				{
 					node->stats.cache_overflows += 1;	/* stats update */
 
@@ -787,7 +1304,8 @@ ExecMemoize(PlanState *pstate)
 					 * cache lookups to work even when the scan has not been
 					 * executed to completion.
 					 */
-					entry->complete = node->singlerow;
+					if (node->singlerow)
+						cache_entry_complete(node, entry);
 					node->mstatus = MEMO_FILLING_CACHE;
 				}
 
@@ -837,7 +1355,7 @@ ExecMemoize(PlanState *pstate)
 				if (TupIsNull(outerslot))
 				{
 					/* No more tuples.  Mark it as complete */
-					entry->complete = true;
+					cache_entry_complete(node, entry);
 					node->mstatus = MEMO_END_OF_SCAN;
 					return NULL;
 				}
@@ -851,7 +1369,9 @@ ExecMemoize(PlanState *pstate)
 					elog(ERROR, "cache entry already complete");
 
 				/* Record the tuple in the current cache entry */
-				if (unlikely(!cache_store_tuple(node, outerslot)))
+				if (unlikely(!(node->shared_cache != NULL ?
+							   shared_cache_store_tuple(node, outerslot) :
+							   cache_store_tuple(node, outerslot))))
 				{
 					/* Couldn't store it?  Handle overflow */
 					node->stats.cache_overflows += 1;	/* stats update */
@@ -1025,6 +1545,18 @@ ExecInitMemoize(Memoize *node, EState *estate, int eflags)
 	/* Zero the statistics counters */
 	memset(&mstate->stats, 0, sizeof(MemoizeInstrumentation));
 
+	/* Remember what the planner expected, to check it against reality */
+	mstate->est_hit_ratio = node->est_hit_ratio;
+	mstate->est_unique_keys = node->est_unique_keys;
+	mstate->window_lookups = 0;
+	mstate->window_hits = 0;
+	mstate->adaptive_bypass = false;
+
+	/* Set up by ExecMemoizeInitializeDSM/Worker if the cache is shared */
+	mstate->shared_cache = NULL;
+	mstate->shared_area = NULL;
+	mstate->scanContext = NULL;
+
 	/* Allocate and set up the actual cache */
 	build_hash_table(mstate, node->est_entries);
 
@@ -1036,6 +1568,7 @@ ExecEndMemoize(MemoizeState *node)
 {
 #ifdef USE_ASSERT_CHECKING
 	/* Validate the memory accounting code is correct in assert builds. */
+	if (node->shared_cache == NULL)
 	{
 		int			count;
 		uint64		mem = 0;
@@ -1073,7 +1606,7 @@ ExecEndMemoize(MemoizeState *node)
 		MemoizeInstrumentation *si;
 
 		/* Make mem_peak available for EXPLAIN */
-		if (node->stats.mem_peak == 0)
+		if (node->stats.mem_peak == 0 && node->shared_cache == NULL)
 			node->stats.mem_peak = node->mem_used;
 
 		Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
@@ -1083,6 +1616,8 @@ ExecEndMemoize(MemoizeState *node)
 
 	/* Remove the cache context */
 	MemoryContextDelete(node->tableContext);
+	if (node->scanContext != NULL)
+		MemoryContextDelete(node->scanContext);
 
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 	/* must drop pointer to cache result tuple */
@@ -1124,6 +1659,11 @@ ExecReScanMemoize(MemoizeState *node)
 	 */
 	if (bms_nonempty_difference(outerPlan->chgParam, node->keyparamids))
 		cache_purge_all(node);
+
+	/* Free the memory of a private cache that we've stopped using */
+	if (node->adaptive_bypass && node->shared_cache == NULL &&
+		node->hashtable->members > 0)
+		cache_purge_all(node);
 }
 
 /*
@@ -1143,6 +1683,65 @@ ExecEstimateCacheEntryOverheadBytes(double ntuples)
  * ----------------------------------------------------------------
  */
 
+/*
+ * memoize_can_share_cache
+ *		Can the participants of a parallel query share the node's cache?
+ *
+ * Only if the subplan depends on no parameters but the cache keys.  Otherwise
+ * the participants could be caching results for different values of the
+ * other parameters at the same time.
+ */
+static bool
+memoize_can_share_cache(MemoizeState *node)
+{
+	Plan	   *outerNode = outerPlan(node->ss.ps.plan);
+
+	return bms_is_subset(outerNode->extParam, node->keyparamids);
+}
+
+/*
+ * memoize_shared_cache_size
+ *		Size of the shared cache control data, including its buckets.
+ */
+static Size
+memoize_shared_cache_size(MemoizeState *node, uint32 *nbuckets)
+{
+	uint32		est_entries = ((Memoize *) node->ss.ps.plan)->est_entries;
+
+	est_entries = Max(est_entries, MEMO_SHARED_MIN_BUCKETS);
+	est_entries = Min(est_entries, MEMO_SHARED_MAX_BUCKETS);
+	*nbuckets = pg_nextpower2_32(est_entries);
+
+	return add_size(offsetof(MemoizeSharedCache, buckets),
+					mul_size(*nbuckets, sizeof(dsa_pointer)));
+}
+
+/*
+ * memoize_attach_shared_cache
+ *		Start using the shared cache 'sc', whose entries live in 'area'.
+ */
+static void
+memoize_attach_shared_cache(MemoizeState *node, MemoizeSharedCache *sc,
+							dsa_area *area)
+{
+	node->shared_cache = sc;
+	node->shared_area = area;
+	node->mem_used = 0;
+	node->mem_limit = sc->mem_limit;
+
+	/* Nothing goes in the private cache anymore, so shrink it */
+	MemoryContextReset(node->tableContext);
+	dlist_init(&node->lru_list);
+	build_hash_table(node, 0);
+
+	if (node->scanContext == NULL)
+		node->scanContext = AllocSetContextCreate(CurrentMemoryContext,
+												  "MemoizeScan",
+												  ALLOCSET_DEFAULT_SIZES);
+	else
+		MemoryContextReset(node->scanContext);
+}
+
  /* ----------------------------------------------------------------
   *		ExecMemoizeEstimate
   *
@@ -1153,9 +1752,21 @@ void
 ExecMemoizeEstimate(MemoizeState *node, ParallelContext *pcxt)
 {
 	Size		size;
+	uint32		nbuckets;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need any of this if no workers */
+	if (pcxt->nworkers == 0)
+		return;
+
+	if (memoize_can_share_cache(node))
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   memoize_shared_cache_size(node, &nbuckets));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
+	/* don't need instrumentation if not instrumenting */
+	if (!node->ss.ps.instrument)
 		return;
 
 	size = mul_size(pcxt->nworkers, sizeof(MemoizeInstrumentation));
@@ -1173,10 +1784,49 @@ ExecMemoizeEstimate(MemoizeState *node, ParallelContext *pcxt)
 void
 ExecMemoizeInitializeDSM(MemoizeState *node, ParallelContext *pcxt)
 {
+	dsa_area   *area = node->ss.ps.state->es_query_dsa;
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need any of this if no workers */
+	if (pcxt->nworkers == 0)
+		return;
+
+	/* Forget the cache of an earlier execution of the parallel plan */
+	if (node->shared_cache != NULL)
+	{
+		node->shared_cache = NULL;
+		node->shared_area = NULL;
+		node->mem_used = 0;
+	}
+
+	/*
+	 * Set up a cache shared by all participants, if we can.  The entries go
+	 * in the query's DSA area, so we need one of those too.
+	 */
+	if (area != NULL && memoize_can_share_cache(node))
+	{
+		MemoizeSharedCache *sc;
+		uint32		nbuckets;
+
+		size = memoize_shared_cache_size(node, &nbuckets);
+		sc = shm_toc_allocate(pcxt->toc, size);
+		sc->mem_limit = get_hash_memory_limit();
+		pg_atomic_init_u64(&sc->mem_used, 0);
+		pg_atomic_init_u32(&sc->clock_hand, 0);
+		sc->nbuckets = nbuckets;
+		for (int i = 0; i < MEMO_SHARED_PARTITIONS; i++)
+			LWLockInitialize(&sc->locks[i], LWTRANCHE_PARALLEL_MEMOIZE);
+		for (uint32 i = 0; i < nbuckets; i++)
+			sc->buckets[i] = InvalidDsaPointer;
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_MEMOIZE_KEY(node->ss.ps.plan->plan_node_id),
+					   sc);
+
+		memoize_attach_shared_cache(node, sc, area);
+	}
+
+	/* don't need instrumentation if not instrumenting */
+	if (!node->ss.ps.instrument)
 		return;
 
 	size = offsetof(SharedMemoizeInfo, sinstrument)
@@ -1198,6 +1848,14 @@ ExecMemoizeInitializeDSM(MemoizeState *node, ParallelContext *pcxt)
 void
 ExecMemoizeInitializeWorker(MemoizeState *node, ParallelWorkerContext *pwcxt)
 {
+	MemoizeSharedCache *sc;
+
+	sc = shm_toc_lookup(pwcxt->toc,
+						PARALLEL_MEMOIZE_KEY(node->ss.ps.plan->plan_node_id),
+						true);
+	if (sc != NULL)
+		memoize_attach_shared_cache(node, sc, node->ss.ps.state->es_query_dsa);
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
 }
@@ -20,6 +20,9 @@
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
  *
+ *		ExecSeqScanInitBatch	switches the scan to batch mode
+ *		ExecSeqScanNextBatch	returns the next batch of qualifying rows
+ *
  *		ExecSeqScanEstimate		estimates DSM space needed for parallel scan
  *		ExecSeqScanInitializeDSM initialize DSM for parallel scan
  *		ExecSeqScanReInitializeDSM reinitialize DSM for fresh parallel scan
@@ -31,6 +34,8 @@
 #include "access/tableam.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "executor/instrument.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
@@ -170,6 +175,7 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 */
 	scanstate->ss.ps.qual =
 		ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
+	ExecInitScanRuntimeFilters(&scanstate->ss);
 
 	return scanstate;
 }
@@ -209,6 +215,107 @@ ExecEndSeqScan(SeqScanState *node)
 		table_endscan(scanDesc);
 }
 
+/* ----------------------------------------------------------------
+ *						Batch Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanInitBatch
+ *
+ *		Prepares the scan for ExecSeqScanNextBatch, which the parent
+ *		calls instead of ExecProcNode.  natts is the number of leading
+ *		attributes the parent needs.  Returns false, leaving the node
+ *		alone, if the table AM cannot return batches, the quals cannot
+ *		be evaluated in batch mode, or there are runtime filters.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecSeqScanInitBatch(SeqScanState *node, int natts)
+{
+	Relation	rel = node->ss.ss_currentRelation;
+	List	   *batchqual;
+
+	if (rel->rd_tableam->scan_getnextbatch == NULL)
+		return false;
+	if (node->ss.ss_nrtfilters > 0)
+		return false;
+	if (!ExecBuildBatchQual(node->ss.ps.plan->qual, &batchqual, &natts))
+		return false;
+
+	node->batchqual = batchqual;
+	node->batchprogram =
+		ExecBuildDeformProgram(node->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+	node->batch = ExecCreateTupleBatch(natts);
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanNextBatch
+ *
+ *		Returns the next batch with at least one row passing the
+ *		quals, or NULL at the end of the scan.  The batch is only
+ *		valid until the next call.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecSeqScanNextBatch(SeqScanState *node)
+{
+	TupleBatch *batch = node->batch;
+	EState	   *estate = node->ss.ps.state;
+	TableScanDesc scandesc = node->ss.ss_currentScanDesc;
+	Instrumentation *instr = node->ss.ps.instrument;
+
+	Assert(batch != NULL);
+	Assert(ScanDirectionIsForward(estate->es_direction));
+
+	/* must provide our own instrumentation support */
+	if (instr)
+		InstrStartNode(instr);
+
+	if (scandesc == NULL)
+	{
+		scandesc = table_beginscan(node->ss.ss_currentRelation,
+								   estate->es_snapshot,
+								   0, NULL);
+		node->ss.ss_currentScanDesc = scandesc;
+	}
+
+	for (;;)
+	{
+		int			nrows;
+
+		CHECK_FOR_INTERRUPTS();
+
+		nrows = table_scan_getnextbatch(scandesc, ForwardScanDirection,
+										node->batchprogram, batch->natts,
+										batch->values, batch->isnull,
+										EXEC_BATCH_SIZE);
+		if (nrows == 0)
+		{
+			batch = NULL;
+			break;
+		}
+
+		batch->nrows = nrows;
+		batch->nsel = nrows;
+		for (int i = 0; i < nrows; i++)
+			batch->sel[i] = i;
+
+		ExecBatchQual(node->batchqual, batch);
+		InstrCountFiltered1(node, nrows - batch->nsel);
+
+		if (batch->nsel > 0)
+			break;
+	}
+
+	if (instr)
+		InstrStopNode(instr, batch != NULL ? batch->nsel : 0);
+
+	return batch;
+}
+
 /* ----------------------------------------------------------------
  *						Join Support
  * ----------------------------------------------------------------
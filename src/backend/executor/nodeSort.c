@@ -19,8 +19,51 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "storage/spin.h"
+#include "utils/datum.h"
 #include "utils/tuplesort.h"
 
+/*
+ * How many input tuples a Sort sharing a top-N bound reads between attempts
+ * to tighten it.
+ */
+#define SORT_BOUND_INTERVAL		256
+
+static SortBound *ExecSortMakeBound(SortState *node);
+static bool ExecSortSameLeadingKey(SortState *a, SortState *b);
+static void ExecSortExchangeBound(SortState *node);
+
+/*
+ * ExecSortBeyondBound
+ *
+ * Check an input tuple against the top-N bound we share with other Sorts,
+ * trying to tighten the bound every SORT_BOUND_INTERVAL tuples.  Returns true
+ * if the tuple's leading key sorts after the bound, so that it cannot be
+ * among the tuples wanted from the merged output.
+ */
+static inline bool
+ExecSortBeyondBound(SortState *node, TupleTableSlot *slot, uint64 ntuples)
+{
+	SortBound  *sortbound = node->sortbound;
+	Datum		value;
+	bool		isnull;
+
+	if (ntuples % SORT_BOUND_INTERVAL == 0)
+		ExecSortExchangeBound(node);
+	if (!sortbound->valid)
+		return false;
+
+	value = slot_getattr(slot, ((Sort *) node->ss.ps.plan)->sortColIdx[0],
+						 &isnull);
+	if (ApplySortComparator(value, isnull,
+							sortbound->value, sortbound->isnull,
+							&sortbound->ssup) <= 0)
+		return false;
+
+	node->bound_skipped++;
+	return true;
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecSort
@@ -78,6 +121,7 @@ ExecSort(PlanState *pstate)
 		PlanState  *outerNode;
 		TupleDesc	tupDesc;
 		int			tuplesortopts = TUPLESORT_NONE;
+		uint64		ntuples = 0;
 
 		SO1_printf("ExecSort: %s\n",
 				   "sorting subplan");
@@ -124,9 +168,19 @@ ExecSort(PlanState *pstate)
 			tuplesort_set_bound(tuplesortstate, node->bound);
 		node->tuplesortstate = (void *) tuplesortstate;
 
+		/*
+		 * A parallel worker learns from the leader's DSM whether to share a
+		 * top-N bound with the other participants.
+		 */
+		if (!node->bounded)
+			node->sortbound = NULL;
+		else if (node->sortbound == NULL && node->shared_bound != NULL)
+			node->sortbound = ExecSortMakeBound(node);
+
 		/*
 		 * Scan the subplan and feed all the tuples to tuplesort using the
-		 * appropriate method based on the type of sort we're doing.
+		 * appropriate method based on the type of sort we're doing.  Tuples
+		 * beyond a top-N bound shared with other Sorts are not even copied.
 		 */
 		if (node->datumSort)
 		{
@@ -136,6 +190,9 @@ ExecSort(PlanState *pstate)
 
 				if (TupIsNull(slot))
 					break;
+				if (node->sortbound &&
+					ExecSortBeyondBound(node, slot, ++ntuples))
+					continue;
 				slot_getsomeattrs(slot, 1);
 				tuplesort_putdatum(tuplesortstate,
 								   slot->tts_values[0],
@@ -150,6 +207,9 @@ ExecSort(PlanState *pstate)
 
 				if (TupIsNull(slot))
 					break;
+				if (node->sortbound &&
+					ExecSortBeyondBound(node, slot, ++ntuples))
+					continue;
 				tuplesort_puttupleslot(tuplesortstate, slot);
 			}
 		}
@@ -159,6 +219,10 @@ ExecSort(PlanState *pstate)
 		 */
 		tuplesort_performsort(tuplesortstate);
 
+		/* let the other Sorts know the leading key of our Nth tuple */
+		if (node->sortbound)
+			ExecSortExchangeBound(node);
+
 		/*
 		 * restore to user specified direction
 		 */
@@ -244,6 +308,10 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	sortstate->bounded = false;
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
+	sortstate->sortbound = NULL;
+	sortstate->share_bound = false;
+	sortstate->shared_bound = NULL;
+	sortstate->bound_skipped = 0;
 
 	/*
 	 * Miscellaneous initialization
@@ -404,6 +472,203 @@ ExecReScanSort(SortState *node)
 		tuplesort_rescan((Tuplesortstate *) node->tuplesortstate);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSortShareBound
+ *
+ *		Called by ExecSetTupleBound for the children of a MergeAppend,
+ *		or the child of a Gather Merge, after passing the bound down.
+ *		The bounded Sorts among them whose leading sort keys agree get
+ *		a common SortBound, so that each can drop input tuples beyond
+ *		the Nth tuple of any other.  If 'parallel', the bound is shared
+ *		with the copies of the Sort in parallel workers as well.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortShareBound(PlanState **nodes, int nnodes, bool parallel)
+{
+	SortState  *first = NULL;
+	SortBound  *sortbound = NULL;
+	int			nsorts = 0;
+	int			i;
+
+	for (i = 0; i < nnodes; i++)
+	{
+		SortState  *sortstate;
+
+		if (!IsA(nodes[i], SortState))
+			continue;
+		sortstate = (SortState *) nodes[i];
+
+		/* reuse the bound left over from a previous scan, if any */
+		if (sortbound == NULL)
+			sortbound = sortstate->sortbound;
+
+		if (sortstate->bounded &&
+			(first == NULL || ExecSortSameLeadingKey(first, sortstate)))
+		{
+			if (first == NULL)
+				first = sortstate;
+			nsorts++;
+		}
+	}
+
+	/* sharing pays off only if there is somebody to share with */
+	if (nsorts < (parallel ? 1 : 2))
+		first = NULL;
+
+	if (first != NULL)
+	{
+		if (sortbound == NULL)
+			sortbound = ExecSortMakeBound(first);
+		else
+		{
+			/* the input may have changed, so forget what we knew */
+			if (sortbound->valid && !sortbound->typbyval &&
+				!sortbound->isnull)
+				pfree(DatumGetPointer(sortbound->value));
+			sortbound->valid = false;
+		}
+	}
+
+	for (i = 0; i < nnodes; i++)
+	{
+		SortState  *sortstate;
+
+		if (!IsA(nodes[i], SortState))
+			continue;
+		sortstate = (SortState *) nodes[i];
+
+		if (first != NULL && sortstate->bounded &&
+			ExecSortSameLeadingKey(first, sortstate))
+		{
+			sortstate->sortbound = sortbound;
+			sortstate->share_bound = parallel && sortbound->typbyval;
+		}
+		else
+		{
+			sortstate->sortbound = NULL;
+			sortstate->share_bound = false;
+		}
+	}
+}
+
+/*
+ * Set up a SortBound comparing values of the leading sort key of 'node'.
+ */
+static SortBound *
+ExecSortMakeBound(SortState *node)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	TupleDesc	tupDesc = ExecGetResultType(outerPlanState(node));
+	Form_pg_attribute attr = TupleDescAttr(tupDesc, plannode->sortColIdx[0] - 1);
+	MemoryContext cxt = node->ss.ps.state->es_query_cxt;
+	SortBound  *sortbound;
+
+	sortbound = (SortBound *) MemoryContextAllocZero(cxt, sizeof(SortBound));
+	sortbound->ssup.ssup_cxt = cxt;
+	sortbound->ssup.ssup_collation = plannode->collations[0];
+	sortbound->ssup.ssup_nulls_first = plannode->nullsFirst[0];
+	PrepareSortSupportFromOrderingOp(plannode->sortOperators[0],
+									 &sortbound->ssup);
+	sortbound->typlen = attr->attlen;
+	sortbound->typbyval = attr->attbyval;
+	sortbound->valid = false;
+
+	return sortbound;
+}
+
+/*
+ * Do two Sorts order their input by the same leading key?
+ */
+static bool
+ExecSortSameLeadingKey(SortState *a, SortState *b)
+{
+	Sort	   *aplan = (Sort *) a->ss.ps.plan;
+	Sort	   *bplan = (Sort *) b->ss.ps.plan;
+	TupleDesc	adesc = ExecGetResultType(outerPlanState(a));
+	TupleDesc	bdesc = ExecGetResultType(outerPlanState(b));
+
+	return aplan->sortOperators[0] == bplan->sortOperators[0] &&
+		aplan->collations[0] == bplan->collations[0] &&
+		aplan->nullsFirst[0] == bplan->nullsFirst[0] &&
+		TupleDescAttr(adesc, aplan->sortColIdx[0] - 1)->atttypid ==
+		TupleDescAttr(bdesc, bplan->sortColIdx[0] - 1)->atttypid;
+}
+
+/*
+ * ExecSortExchangeBound
+ *
+ * Replace the shared bound by the leading key of our own Nth tuple if that
+ * is tighter, then do the same between our bound and the one shared with
+ * parallel workers.  Every participant's Nth key is a valid bound, so an
+ * update lost to a concurrent one just means less pruning.
+ */
+static void
+ExecSortExchangeBound(SortState *node)
+{
+	SortBound  *sortbound = node->sortbound;
+	SharedSortBound *shared = node->shared_bound;
+	Datum		value;
+	bool		isnull;
+	bool		valid;
+
+	if (tuplesort_get_bound_key((Tuplesortstate *) node->tuplesortstate,
+								&value, &isnull) &&
+		(!sortbound->valid ||
+		 ApplySortComparator(value, isnull,
+							 sortbound->value, sortbound->isnull,
+							 &sortbound->ssup) < 0))
+	{
+		if (!sortbound->typbyval)
+		{
+			MemoryContext oldcontext;
+
+			if (sortbound->valid && !sortbound->isnull)
+				pfree(DatumGetPointer(sortbound->value));
+			oldcontext = MemoryContextSwitchTo(sortbound->ssup.ssup_cxt);
+			if (!isnull)
+				value = datumCopy(value, false, sortbound->typlen);
+			MemoryContextSwitchTo(oldcontext);
+		}
+		sortbound->value = value;
+		sortbound->isnull = isnull;
+		sortbound->valid = true;
+	}
+
+	if (shared == NULL)
+		return;
+
+	/* don't call the comparator while holding the spinlock */
+	Assert(sortbound->typbyval);
+	SpinLockAcquire(&shared->mutex);
+	valid = shared->valid;
+	value = shared->value;
+	isnull = shared->isnull;
+	SpinLockRelease(&shared->mutex);
+
+	if (valid &&
+		(!sortbound->valid ||
+		 ApplySortComparator(value, isnull,
+							 sortbound->value, sortbound->isnull,
+							 &sortbound->ssup) < 0))
+	{
+		sortbound->value = value;
+		sortbound->isnull = isnull;
+		sortbound->valid = true;
+	}
+	else if (sortbound->valid &&
+			 (!valid ||
+			  ApplySortComparator(sortbound->value, sortbound->isnull,
+								  value, isnull, &sortbound->ssup) < 0))
+	{
+		SpinLockAcquire(&shared->mutex);
+		shared->value = sortbound->value;
+		shared->isnull = sortbound->isnull;
+		shared->valid = true;
+		SpinLockRelease(&shared->mutex);
+	}
+}
+
 /* ----------------------------------------------------------------
  *						Parallel Query Support
  * ----------------------------------------------------------------
@@ -412,7 +677,8 @@ ExecReScanSort(SortState *node)
 /* ----------------------------------------------------------------
  *		ExecSortEstimate
  *
- *		Estimate space required to propagate sort statistics.
+ *		Estimate space required to propagate sort statistics and
+ *		to share a top-N bound.
  * ----------------------------------------------------------------
  */
 void
@@ -420,8 +686,9 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need this if neither instrumenting nor sharing, or no workers */
+	if ((!node->ss.ps.instrument && !node->share_bound) ||
+		pcxt->nworkers == 0)
 		return;
 
 	size = mul_size(pcxt->nworkers, sizeof(TuplesortInstrumentation));
@@ -433,7 +700,7 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecSortInitializeDSM
  *
- *		Initialize DSM space for sort statistics.
+ *		Initialize DSM space for sort statistics and the top-N bound.
  * ----------------------------------------------------------------
  */
 void
@@ -441,8 +708,11 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	node->shared_bound = NULL;
+
+	/* don't need this if neither instrumenting nor sharing, or no workers */
+	if ((!node->ss.ps.instrument && !node->share_bound) ||
+		pcxt->nworkers == 0)
 		return;
 
 	size = offsetof(SharedSortInfo, sinstrument)
@@ -451,14 +721,34 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 	/* ensure any unfilled slots will contain zeroes */
 	memset(node->shared_info, 0, size);
 	node->shared_info->num_workers = pcxt->nworkers;
+	if (node->share_bound)
+	{
+		node->shared_info->has_bound = true;
+		SpinLockInit(&node->shared_info->bound.mutex);
+		node->shared_bound = &node->shared_info->bound;
+	}
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSortReInitializeDSM
+ *
+ *		Forget the top-N bound of the previous scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortReInitializeDSM(SortState *node, ParallelContext *pcxt)
+{
+	if (node->shared_bound != NULL)
+		node->shared_bound->valid = false;
+}
+
 /* ----------------------------------------------------------------
  *		ExecSortInitializeWorker
  *
- *		Attach worker to DSM space for sort statistics.
+ *		Attach worker to DSM space for sort statistics and the top-N
+ *		bound.
  * ----------------------------------------------------------------
  */
 void
@@ -466,6 +756,8 @@ ExecSortInitializeWorker(SortState *node, ParallelWorkerContext *pwcxt)
 {
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+	if (node->shared_info && node->shared_info->has_bound)
+		node->shared_bound = &node->shared_info->bound;
 	node->am_worker = true;
 }
 
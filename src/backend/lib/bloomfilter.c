@@ -192,6 +192,21 @@ bloom_prop_bits_set(bloom_filter *filter)
 	return bits_set / (double) filter->m;
 }
 
+/*
+ * Size of the Bloom filter, including its bookkeeping fields.
+ *
+ * A Bloom filter is a single chunk of memory that contains no pointers, so
+ * callers may copy this many bytes elsewhere (even into another process's
+ * memory), and use the copy as a Bloom filter, provided it is suitably
+ * aligned.
+ */
+size_t
+bloom_total_size(bloom_filter *filter)
+{
+	return offsetof(bloom_filter, bitset) +
+		sizeof(unsigned char) * (filter->m / BITS_PER_BYTE);
+}
+
 /*
  * Which element in the sequence of powers of two is less than or equal to
  * target_bitset_bits?
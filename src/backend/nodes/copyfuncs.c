@@ -420,6 +420,7 @@ CopyScanFields(const Scan *from, Scan *newnode)
 	CopyPlanFields((const Plan *) from, (Plan *) newnode);
 
 	COPY_SCALAR_FIELD(scanrelid);
+	COPY_NODE_FIELD(rtfilters);
 }
 
 /*
@@ -498,6 +499,7 @@ _copyIndexScan(const IndexScan *from)
 	COPY_NODE_FIELD(indexorderbyorig);
 	COPY_NODE_FIELD(indexorderbyops);
 	COPY_SCALAR_FIELD(indexorderdir);
+	COPY_SCALAR_FIELD(indexskip);
 
 	return newnode;
 }
@@ -524,6 +526,7 @@ _copyIndexOnlyScan(const IndexOnlyScan *from)
 	COPY_NODE_FIELD(indexorderby);
 	COPY_NODE_FIELD(indextlist);
 	COPY_SCALAR_FIELD(indexorderdir);
+	COPY_SCALAR_FIELD(indexskip);
 
 	return newnode;
 }
@@ -548,6 +551,7 @@ _copyBitmapIndexScan(const BitmapIndexScan *from)
 	COPY_SCALAR_FIELD(isshared);
 	COPY_NODE_FIELD(indexqual);
 	COPY_NODE_FIELD(indexqualorig);
+	COPY_SCALAR_FIELD(indexskip);
 
 	return newnode;
 }
@@ -931,6 +935,10 @@ _copyHashJoin(const HashJoin *from)
 	COPY_NODE_FIELD(hashoperators);
 	COPY_NODE_FIELD(hashcollations);
 	COPY_NODE_FIELD(hashkeys);
+	COPY_SCALAR_FIELD(radix_partition);
+	COPY_NODE_FIELD(nlinner);
+	COPY_NODE_FIELD(nestParams);
+	COPY_SCALAR_FIELD(nl_max_rows);
 
 	return newnode;
 }
@@ -977,6 +985,8 @@ _copyMemoize(const Memoize *from)
 	COPY_SCALAR_FIELD(binary_mode);
 	COPY_SCALAR_FIELD(est_entries);
 	COPY_BITMAPSET_FIELD(keyparamids);
+	COPY_SCALAR_FIELD(est_unique_keys);
+	COPY_SCALAR_FIELD(est_hit_ratio);
 
 	return newnode;
 }
@@ -1161,6 +1171,7 @@ _copyHash(const Hash *from)
 	COPY_SCALAR_FIELD(skewColumn);
 	COPY_SCALAR_FIELD(skewInherit);
 	COPY_SCALAR_FIELD(rows_total);
+	COPY_SCALAR_FIELD(rtfilterParam);
 
 	return newnode;
 }
@@ -1352,6 +1363,22 @@ _copyPlanInvalItem(const PlanInvalItem *from)
 	return newnode;
 }
 
+/*
+ * _copyRuntimeFilter
+ */
+static RuntimeFilter *
+_copyRuntimeFilter(const RuntimeFilter *from)
+{
+	RuntimeFilter *newnode = makeNode(RuntimeFilter);
+
+	COPY_SCALAR_FIELD(paramid);
+	COPY_NODE_FIELD(hashkeys);
+	COPY_NODE_FIELD(hashoperators);
+	COPY_NODE_FIELD(hashcollations);
+
+	return newnode;
+}
+
 /* ****************************************************************
  *					   primnodes.h copy functions
  * ****************************************************************
@@ -5728,6 +5755,9 @@ copyObjectImpl(const void *from)
 		case T_PlanInvalItem:
 			retval = _copyPlanInvalItem(from);
 			break;
+		case T_RuntimeFilter:
+			retval = _copyRuntimeFilter(from);
+			break;
 
 			/*
 			 * PRIMITIVE NODES
@@ -4630,6 +4630,11 @@ planstate_tree_walker(PlanState *planstate,
 			if (walker(((SubqueryScanState *) planstate)->subplan, context))
 				return true;
 			break;
+		case T_HashJoin:
+			if (((HashJoinState *) planstate)->hj_NestLoopInner &&
+				walker(((HashJoinState *) planstate)->hj_NestLoopInner, context))
+				return true;
+			break;
 		case T_CustomScan:
 			foreach(lc, ((CustomScanState *) planstate)->custom_ps)
 			{
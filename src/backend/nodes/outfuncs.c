@@ -367,6 +367,7 @@ _outScanInfo(StringInfo str, const Scan *node)
 	_outPlanInfo(str, (const Plan *) node);
 
 	WRITE_UINT_FIELD(scanrelid);
+	WRITE_NODE_FIELD(rtfilters);
 }
 
 /*
@@ -577,6 +578,7 @@ _outIndexScan(StringInfo str, const IndexScan *node)
 	WRITE_NODE_FIELD(indexorderbyorig);
 	WRITE_NODE_FIELD(indexorderbyops);
 	WRITE_ENUM_FIELD(indexorderdir, ScanDirection);
+	WRITE_BOOL_FIELD(indexskip);
 }
 
 static void
@@ -592,6 +594,7 @@ _outIndexOnlyScan(StringInfo str, const IndexOnlyScan *node)
 	WRITE_NODE_FIELD(indexorderby);
 	WRITE_NODE_FIELD(indextlist);
 	WRITE_ENUM_FIELD(indexorderdir, ScanDirection);
+	WRITE_BOOL_FIELD(indexskip);
 }
 
 static void
@@ -605,6 +608,7 @@ _outBitmapIndexScan(StringInfo str, const BitmapIndexScan *node)
 	WRITE_BOOL_FIELD(isshared);
 	WRITE_NODE_FIELD(indexqual);
 	WRITE_NODE_FIELD(indexqualorig);
+	WRITE_BOOL_FIELD(indexskip);
 }
 
 static void
@@ -795,6 +799,10 @@ _outHashJoin(StringInfo str, const HashJoin *node)
 	WRITE_NODE_FIELD(hashoperators);
 	WRITE_NODE_FIELD(hashcollations);
 	WRITE_NODE_FIELD(hashkeys);
+	WRITE_BOOL_FIELD(radix_partition);
+	WRITE_NODE_FIELD(nlinner);
+	WRITE_NODE_FIELD(nestParams);
+	WRITE_FLOAT_FIELD(nl_max_rows, "%.0f");
 }
 
 static void
@@ -882,6 +890,8 @@ _outMemoize(StringInfo str, const Memoize *node)
 	WRITE_BOOL_FIELD(binary_mode);
 	WRITE_UINT_FIELD(est_entries);
 	WRITE_BITMAPSET_FIELD(keyparamids);
+	WRITE_FLOAT_FIELD(est_unique_keys, "%.0f");
+	WRITE_FLOAT_FIELD(est_hit_ratio, "%.6f");
 }
 
 static void
@@ -939,6 +949,7 @@ _outHash(StringInfo str, const Hash *node)
 	WRITE_INT_FIELD(skewColumn);
 	WRITE_BOOL_FIELD(skewInherit);
 	WRITE_FLOAT_FIELD(rows_total, "%.0f");
+	WRITE_INT_FIELD(rtfilterParam);
 }
 
 static void
@@ -1066,6 +1077,17 @@ _outPlanInvalItem(StringInfo str, const PlanInvalItem *node)
 	WRITE_UINT_FIELD(hashValue);
 }
 
+static void
+_outRuntimeFilter(StringInfo str, const RuntimeFilter *node)
+{
+	WRITE_NODE_TYPE("RUNTIMEFILTER");
+
+	WRITE_INT_FIELD(paramid);
+	WRITE_NODE_FIELD(hashkeys);
+	WRITE_NODE_FIELD(hashoperators);
+	WRITE_NODE_FIELD(hashcollations);
+}
+
 /*****************************************************************************
  *
  *	Stuff from primnodes.h.
@@ -1980,6 +2002,7 @@ _outIndexPath(StringInfo str, const IndexPath *node)
 	WRITE_ENUM_FIELD(indexscandir, ScanDirection);
 	WRITE_FLOAT_FIELD(indextotalcost, "%.2f");
 	WRITE_FLOAT_FIELD(indexselectivity, "%.4f");
+	WRITE_BOOL_FIELD(indexskip);
 }
 
 static void
@@ -2126,6 +2149,8 @@ _outMemoizePath(StringInfo str, const MemoizePath *node)
 	WRITE_BOOL_FIELD(binary_mode);
 	WRITE_FLOAT_FIELD(calls, "%.0f");
 	WRITE_UINT_FIELD(est_entries);
+	WRITE_FLOAT_FIELD(est_unique_keys, "%.0f");
+	WRITE_FLOAT_FIELD(est_hit_ratio, "%.6f");
 }
 
 static void
@@ -2420,6 +2445,7 @@ _outHashPath(StringInfo str, const HashPath *node)
 	WRITE_NODE_FIELD(path_hashclauses);
 	WRITE_INT_FIELD(num_batches);
 	WRITE_FLOAT_FIELD(inner_rows_total, "%.0f");
+	WRITE_BOOL_FIELD(radix_partition);
 }
 
 static void
@@ -4210,6 +4236,9 @@ outNode(StringInfo str, const void *obj)
 			case T_PlanInvalItem:
 				_outPlanInvalItem(str, obj);
 				break;
+			case T_RuntimeFilter:
+				_outRuntimeFilter(str, obj);
+				break;
 			case T_Alias:
 				_outAlias(str, obj);
 				break;
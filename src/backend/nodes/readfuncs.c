@@ -2039,6 +2039,7 @@ ReadCommonScan(Scan *local_node)
 	ReadCommonPlan(&local_node->plan);
 
 	READ_UINT_FIELD(scanrelid);
+	READ_NODE_FIELD(rtfilters);
 }
 
 /*
@@ -2099,6 +2100,7 @@ _readIndexScan(void)
 	READ_NODE_FIELD(indexorderbyorig);
 	READ_NODE_FIELD(indexorderbyops);
 	READ_ENUM_FIELD(indexorderdir, ScanDirection);
+	READ_BOOL_FIELD(indexskip);
 
 	READ_DONE();
 }
@@ -2119,6 +2121,7 @@ _readIndexOnlyScan(void)
 	READ_NODE_FIELD(indexorderby);
 	READ_NODE_FIELD(indextlist);
 	READ_ENUM_FIELD(indexorderdir, ScanDirection);
+	READ_BOOL_FIELD(indexskip);
 
 	READ_DONE();
 }
@@ -2137,6 +2140,7 @@ _readBitmapIndexScan(void)
 	READ_BOOL_FIELD(isshared);
 	READ_NODE_FIELD(indexqual);
 	READ_NODE_FIELD(indexqualorig);
+	READ_BOOL_FIELD(indexskip);
 
 	READ_DONE();
 }
@@ -2429,6 +2433,10 @@ _readHashJoin(void)
 	READ_NODE_FIELD(hashoperators);
 	READ_NODE_FIELD(hashcollations);
 	READ_NODE_FIELD(hashkeys);
+	READ_BOOL_FIELD(radix_partition);
+	READ_NODE_FIELD(nlinner);
+	READ_NODE_FIELD(nestParams);
+	READ_FLOAT_FIELD(nl_max_rows);
 
 	READ_DONE();
 }
@@ -2464,6 +2472,8 @@ _readMemoize(void)
 	READ_BOOL_FIELD(binary_mode);
 	READ_UINT_FIELD(est_entries);
 	READ_BITMAPSET_FIELD(keyparamids);
+	READ_FLOAT_FIELD(est_unique_keys);
+	READ_FLOAT_FIELD(est_hit_ratio);
 
 	READ_DONE();
 }
@@ -2665,6 +2675,7 @@ _readHash(void)
 	READ_INT_FIELD(skewColumn);
 	READ_BOOL_FIELD(skewInherit);
 	READ_FLOAT_FIELD(rows_total);
+	READ_INT_FIELD(rtfilterParam);
 
 	READ_DONE();
 }
@@ -2832,6 +2843,22 @@ _readPlanInvalItem(void)
 	READ_DONE();
 }
 
+/*
+ * _readRuntimeFilter
+ */
+static RuntimeFilter *
+_readRuntimeFilter(void)
+{
+	READ_LOCALS(RuntimeFilter);
+
+	READ_INT_FIELD(paramid);
+	READ_NODE_FIELD(hashkeys);
+	READ_NODE_FIELD(hashoperators);
+	READ_NODE_FIELD(hashcollations);
+
+	READ_DONE();
+}
+
 /*
  * _readSubPlan
  */
@@ -3203,6 +3230,8 @@ parseNodeString(void)
 		return_value = _readPartitionPruneStepCombine();
 	else if (MATCH("PLANINVALITEM", 13))
 		return_value = _readPlanInvalItem();
+	else if (MATCH("RUNTIMEFILTER", 13))
+		return_value = _readRuntimeFilter();
 	else if (MATCH("SUBPLAN", 7))
 		return_value = _readSubPlan();
 	else if (MATCH("ALTERNATIVESUBPLAN", 18))
@@ -132,24 +132,31 @@ Cost		disable_cost = 1.0e10;
 
 int			max_parallel_workers_per_gather = 2;
 
+int			radix_hashjoin_threshold = 16384;
+
 bool		enable_seqscan = true;
 bool		enable_indexscan = true;
 bool		enable_indexonlyscan = true;
+bool		enable_indexskipscan = false;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
 bool		enable_incremental_sort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
+bool		enable_adaptive_join = false;
 bool		enable_material = true;
 bool		enable_memoize = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
+bool		enable_radix_hashjoin = false;
+bool		enable_runtime_filter = false;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_hashagg = false;
 bool		enable_partition_pruning = true;
 bool		enable_async_append = true;
 
@@ -581,9 +588,11 @@ cost_index(IndexPath *path, PlannerInfo *root, double loop_count,
 	 * Call index-access-method-specific code to estimate the processing cost
 	 * for scanning the index, as well as the selectivity of the index (ie,
 	 * the fraction of main-table tuples we will have to retrieve) and its
-	 * correlation to the main-table tuple order.  We need a cast here because
+	 * correlation to the main-table tuple order.  The estimator also sets
+	 * indexskip if it assumes a skip scan.  We need a cast here because
 	 * pathnodes.h uses a weak function type to avoid including amapi.h.
 	 */
+	path->indexskip = false;
 	amcostestimate = (amcostestimate_function) index->amcostestimate;
 	amcostestimate(root, path, loop_count,
 				   &indexStartupCost, &indexTotalCost,
@@ -2860,6 +2869,13 @@ cost_memoize_rescan(PlannerInfo *root, MemoizePath *mpath,
 	/* Ensure we don't go negative */
 	hit_ratio = Max(hit_ratio, 0.0);
 
+	/*
+	 * Remember the estimates too.  The executor stops caching when the hit
+	 * ratio it observes falls far short of this one.
+	 */
+	mpath->est_unique_keys = ndistinct;
+	mpath->est_hit_ratio = hit_ratio;
+
 	/*
 	 * Set the total_cost accounting for the expected cache hit ratio.  We
 	 * also add on a cpu_operator_cost to account for a cache lookup. This
@@ -3106,6 +3122,31 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * cost_parallel_hashagg
+ *		Adds the cost of redistributing the input of a parallel-aware
+ *		hashed aggregation to the cost computed by cost_agg().
+ *
+ * Before aggregating, each participant writes its share of the input to
+ * shared temporary files partitioned by hash value, and the partitions are
+ * read back by whichever participant aggregates them; see nodeAgg.c.  All of
+ * that happens before the first group can be returned.
+ */
+void
+cost_parallel_hashagg(Path *path, double input_tuples, double input_width)
+{
+	double		pages;
+	Cost		cost;
+
+	pages = ceil(relation_byte_size(input_tuples, input_width) / BLCKSZ);
+
+	cost = 2.0 * pages * seq_page_cost;
+	cost += 2.0 * input_tuples * cpu_tuple_cost;
+
+	path->startup_cost += cost;
+	path->total_cost += cost;
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
@@ -4224,6 +4265,7 @@ final_cost_hashjoin(PlannerInfo *root, HashPath *path,
 	QualCost	qp_qual_cost;
 	double		hashjointuples;
 	double		virtualbuckets;
+	double		inner_batch_bytes;
 	Selectivity innerbucketsize;
 	Selectivity innermcvfreq;
 	ListCell   *hcl;
@@ -4432,6 +4474,28 @@ final_cost_hashjoin(PlannerInfo *root, HashPath *path,
 		hashjointuples = approx_tuple_count(root, &path->jpath, hashclauses);
 	}
 
+	/*
+	 * If a batch of the hash table is much bigger than the CPU caches
+	 * (radix_hashjoin_threshold), nearly every probe costs a cache miss.  The
+	 * executor can avoid most of that by clustering the table by radix
+	 * partition and probing it in partition order, which costs an extra pass
+	 * over both inputs.  Parallel-aware joins share their hash table and
+	 * can't be clustered, and clustering copies the table, so it needs room
+	 * for the table twice.  We don't try to estimate the cache misses
+	 * themselves, so joins that aren't clustered are costed as before.
+	 */
+	inner_batch_bytes = relation_byte_size(inner_path_rows_total / numbatches,
+										   inner_path->pathtarget->width) +
+		numbuckets * sizeof(void *);
+	path->radix_partition = false;
+	if (enable_radix_hashjoin && !path->jpath.path.parallel_aware &&
+		inner_batch_bytes > radix_hashjoin_threshold * 1024.0 &&
+		2.0 * inner_batch_bytes <= get_hash_memory_limit())
+	{
+		path->radix_partition = true;
+		run_cost += cpu_operator_cost * (outer_path_rows + inner_path_rows);
+	}
+
 	/*
 	 * For each tuple that gets through the hashjoin proper, we charge
 	 * cpu_tuple_cost plus the cost of evaluating additional restriction
@@ -4450,6 +4514,48 @@ final_cost_hashjoin(PlannerInfo *root, HashPath *path,
 	path->jpath.path.total_cost = startup_cost + run_cost;
 }
 
+/*
+ * adaptive_join_threshold
+ *	  Determine after how many outer rows an adaptive join should give up on
+ *	  its nested loop and switch to hashing.
+ *
+ * 'nl_inner' is the parameterized inner path of the nested loop, and
+ * 'hash_inner' the plain path that gets hashed instead.  We compare the cost
+ * of rescanning the former once per outer row with the one-time cost of
+ * building a hash table from the latter plus a probe per outer row, and
+ * return the outer row count at which the two break even.  The threshold is
+ * never less than twice the estimated outer row count, so that we don't
+ * second-guess the planner over small estimation errors.
+ *
+ * Returns -1 if hashing never pays off.
+ */
+double
+adaptive_join_threshold(PlannerInfo *root, Path *outer_path,
+						Path *nl_inner, Path *hash_inner, int nhashclauses)
+{
+	Cost		rescan_startup_cost;
+	Cost		rescan_total_cost;
+	Cost		build_cost;
+	Cost		nl_per_outer;
+	Cost		hash_per_outer;
+	double		threshold;
+
+	cost_rescan(root, nl_inner, &rescan_startup_cost, &rescan_total_cost);
+	nl_per_outer = rescan_total_cost;
+
+	/* This follows initial_cost_hashjoin, minus the batching overheads */
+	build_cost = hash_inner->total_cost +
+		(cpu_operator_cost * nhashclauses + cpu_tuple_cost) * hash_inner->rows;
+	hash_per_outer = cpu_operator_cost * nhashclauses;
+
+	if (nl_per_outer <= hash_per_outer)
+		return -1;
+
+	threshold = ceil(build_cost / (nl_per_outer - hash_per_outer));
+
+	return clamp_row_est(Max(threshold, 2 * outer_path->rows));
+}
+
 
 /*
  * cost_subplan
@@ -20,6 +20,7 @@
 
 #include "access/sysattr.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_type.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/extensible.h"
@@ -70,6 +71,12 @@
 #define CP_LABEL_TLIST		0x0004	/* tlist must contain sortgrouprefs */
 #define CP_IGNORE_TLIST		0x0008	/* caller will replace tlist */
 
+/*
+ * A hash join only builds a runtime filter if it's expected to return at most
+ * this fraction of its outer rows.
+ */
+#define RUNTIME_FILTER_MAX_SELECTIVITY	0.5
+
 
 static Plan *create_plan_recurse(PlannerInfo *root, Path *best_path,
 								 int flags);
@@ -158,9 +165,23 @@ static ForeignScan *create_foreignscan_plan(PlannerInfo *root, ForeignPath *best
 static CustomScan *create_customscan_plan(PlannerInfo *root,
 										  CustomPath *best_path,
 										  List *tlist, List *scan_clauses);
-static NestLoop *create_nestloop_plan(PlannerInfo *root, NestPath *best_path);
+static Plan *create_nestloop_plan(PlannerInfo *root, NestPath *best_path);
+static Path *adaptive_join_hash_path(PlannerInfo *root, NestPath *best_path,
+									 List **hashclauses, List **otherclauses,
+									 double *nl_max_rows);
+static HashJoin *create_adaptive_join_plan(PlannerInfo *root,
+										   NestPath *best_path, List *tlist,
+										   Plan *outer_plan, Plan *nl_inner_plan,
+										   List *nestParams,
+										   Path *hash_inner_path,
+										   List *hashclauses, List *otherclauses,
+										   double nl_max_rows);
 static MergeJoin *create_mergejoin_plan(PlannerInfo *root, MergePath *best_path);
 static HashJoin *create_hashjoin_plan(PlannerInfo *root, HashPath *best_path);
+static void push_runtime_filter(PlannerInfo *root, HashPath *best_path,
+								Hash *hash_plan, Plan *outer_plan,
+								List *hashoperators, List *hashcollations,
+								List *outer_hashkeys);
 static Node *replace_nestloop_params(PlannerInfo *root, Node *expr);
 static Node *replace_nestloop_params_mutator(Node *node, PlannerInfo *root);
 static void fix_indexqual_references(PlannerInfo *root, IndexPath *index_path,
@@ -184,16 +205,18 @@ static IndexScan *make_indexscan(List *qptlist, List *qpqual, Index scanrelid,
 								 Oid indexid, List *indexqual, List *indexqualorig,
 								 List *indexorderby, List *indexorderbyorig,
 								 List *indexorderbyops,
-								 ScanDirection indexscandir);
+								 ScanDirection indexscandir, bool indexskip);
 static IndexOnlyScan *make_indexonlyscan(List *qptlist, List *qpqual,
 										 Index scanrelid, Oid indexid,
 										 List *indexqual, List *recheckqual,
 										 List *indexorderby,
 										 List *indextlist,
-										 ScanDirection indexscandir);
+										 ScanDirection indexscandir,
+										 bool indexskip);
 static BitmapIndexScan *make_bitmap_indexscan(Index scanrelid, Oid indexid,
 											  List *indexqual,
-											  List *indexqualorig);
+											  List *indexqualorig,
+											  bool indexskip);
 static BitmapHeapScan *make_bitmap_heapscan(List *qptlist,
 											List *qpqual,
 											Plan *lefttree,
@@ -280,7 +303,9 @@ static Material *make_material(Plan *lefttree);
 static Memoize *make_memoize(Plan *lefttree, Oid *hashoperators,
 							 Oid *collations, List *param_exprs,
 							 bool singlerow, bool binary_mode,
-							 uint32 est_entries, Bitmapset *keyparamids);
+							 uint32 est_entries, Bitmapset *keyparamids,
+							 Cardinality est_unique_keys,
+							 double est_hit_ratio);
 static WindowAgg *make_windowagg(List *tlist, Index winref,
 								 int partNumCols, AttrNumber *partColIdx, Oid *partOperators, Oid *partCollations,
 								 int ordNumCols, AttrNumber *ordColIdx, Oid *ordOperators, Oid *ordCollations,
@@ -1073,8 +1098,8 @@ create_join_plan(PlannerInfo *root, JoinPath *best_path)
 												 (HashPath *) best_path);
 			break;
 		case T_NestLoop:
-			plan = (Plan *) create_nestloop_plan(root,
-												 (NestPath *) best_path);
+			plan = create_nestloop_plan(root,
+										(NestPath *) best_path);
 			break;
 		default:
 			elog(ERROR, "unrecognized node type: %d",
@@ -1690,7 +1715,8 @@ create_memoize_plan(PlannerInfo *root, MemoizePath *best_path, int flags)
 
 	plan = make_memoize(subplan, operators, collations, param_exprs,
 						best_path->singlerow, best_path->binary_mode,
-						best_path->est_entries, keyparamids);
+						best_path->est_entries, keyparamids,
+						best_path->est_unique_keys, best_path->est_hit_ratio);
 
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
 
@@ -3163,7 +3189,8 @@ create_indexscan_plan(PlannerInfo *root,
 												stripped_indexquals,
 												fixed_indexorderbys,
 												indexinfo->indextlist,
-												best_path->indexscandir);
+												best_path->indexscandir,
+												best_path->indexskip);
 	else
 		scan_plan = (Scan *) make_indexscan(tlist,
 											qpqual,
@@ -3174,7 +3201,8 @@ create_indexscan_plan(PlannerInfo *root,
 											fixed_indexorderbys,
 											indexorderbys,
 											indexorderbyops,
-											best_path->indexscandir);
+											best_path->indexscandir,
+											best_path->indexskip);
 
 	copy_generic_path_info(&scan_plan->plan, &best_path->path);
 
@@ -3464,7 +3492,8 @@ create_bitmap_subplan(PlannerInfo *root, Path *bitmapqual,
 		plan = (Plan *) make_bitmap_indexscan(iscan->scan.scanrelid,
 											  iscan->indexid,
 											  iscan->indexqual,
-											  iscan->indexqualorig);
+											  iscan->indexqualorig,
+											  iscan->indexskip);
 		/* and set its cost/width fields appropriately */
 		plan->startup_cost = 0.0;
 		plan->total_cost = ipath->indextotalcost;
@@ -4312,7 +4341,7 @@ create_customscan_plan(PlannerInfo *root, CustomPath *best_path,
  *
  *****************************************************************************/
 
-static NestLoop *
+static Plan *
 create_nestloop_plan(PlannerInfo *root,
 					 NestPath *best_path)
 {
@@ -4326,6 +4355,10 @@ create_nestloop_plan(PlannerInfo *root,
 	Relids		outerrelids;
 	List	   *nestParams;
 	Relids		saveOuterRels = root->curOuterRels;
+	Path	   *hash_inner_path = NULL;
+	List	   *adaptive_hashclauses = NIL;
+	List	   *adaptive_otherclauses = NIL;
+	double		nl_max_rows = 0;
 
 	/* NestLoop can project, so no need to be picky about child tlists */
 	outer_plan = create_plan_recurse(root, best_path->jpath.outerjoinpath, 0);
@@ -4334,7 +4367,19 @@ create_nestloop_plan(PlannerInfo *root,
 	root->curOuterRels = bms_union(root->curOuterRels,
 								   best_path->jpath.outerjoinpath->parent->relids);
 
-	inner_plan = create_plan_recurse(root, best_path->jpath.innerjoinpath, 0);
+	/*
+	 * If this is to become an adaptive join, the inner plan must return the
+	 * same columns as the one the hash join alternative would use, so ask
+	 * for an exact tlist.
+	 */
+	if (enable_adaptive_join)
+		hash_inner_path = adaptive_join_hash_path(root, best_path,
+												  &adaptive_hashclauses,
+												  &adaptive_otherclauses,
+												  &nl_max_rows);
+
+	inner_plan = create_plan_recurse(root, best_path->jpath.innerjoinpath,
+									 hash_inner_path ? CP_EXACT_TLIST : 0);
 
 	/* Restore curOuterRels */
 	bms_free(root->curOuterRels);
@@ -4374,6 +4419,21 @@ create_nestloop_plan(PlannerInfo *root,
 	outerrelids = best_path->jpath.outerjoinpath->parent->relids;
 	nestParams = identify_current_nestloop_params(root, outerrelids);
 
+	if (hash_inner_path)
+	{
+		HashJoin   *adaptive_plan;
+
+		adaptive_plan = create_adaptive_join_plan(root, best_path, tlist,
+												  outer_plan, inner_plan,
+												  nestParams,
+												  hash_inner_path,
+												  adaptive_hashclauses,
+												  adaptive_otherclauses,
+												  nl_max_rows);
+		if (adaptive_plan)
+			return (Plan *) adaptive_plan;
+	}
+
 	join_plan = make_nestloop(tlist,
 							  joinclauses,
 							  otherclauses,
@@ -4385,6 +4445,198 @@ create_nestloop_plan(PlannerInfo *root,
 
 	copy_generic_path_info(&join_plan->join.plan, &best_path->jpath.path);
 
+	return (Plan *) join_plan;
+}
+
+/*
+ * adaptive_join_hash_path
+ *	  Decide whether a nestloop should be planned as an adaptive join, which
+ *	  switches to a hash join at runtime if the outer side turns out to be
+ *	  much bigger than estimated.
+ *
+ * We only consider plain inner and semi joins whose inner side is a scan of
+ * a base relation parameterized by the outer side, that is, the cases where
+ * an underestimated outer side makes the nestloop rescan the inner relation
+ * over and over.  The join clauses enforced by the parameterized scan plus
+ * those left at the join have to include at least one hashable clause.
+ *
+ * If so, the cheapest unparameterized path of the inner relation is
+ * returned, along with the join clauses (as RestrictInfos) split into hash
+ * clauses and others, and the number of outer rows after which to switch.
+ * Otherwise, returns NULL.
+ */
+static Path *
+adaptive_join_hash_path(PlannerInfo *root, NestPath *best_path,
+						List **hashclauses, List **otherclauses,
+						double *nl_max_rows)
+{
+	Path	   *outer_path = best_path->jpath.outerjoinpath;
+	Path	   *inner_path = best_path->jpath.innerjoinpath;
+	RelOptInfo *innerrel = inner_path->parent;
+	Relids		outerrelids = outer_path->parent->relids;
+	Path	   *hash_inner_path;
+	RangeTblEntry *rte;
+	List	   *clauses;
+	ListCell   *lc;
+
+	*hashclauses = NIL;
+	*otherclauses = NIL;
+
+	if (best_path->jpath.jointype != JOIN_INNER &&
+		best_path->jpath.jointype != JOIN_SEMI)
+		return NULL;
+
+	/*
+	 * A hash join doesn't preserve the outer ordering, and buffering outer
+	 * rows defeats the purpose of a fast-start plan.
+	 */
+	if (best_path->jpath.path.pathkeys != NIL || root->tuple_fraction > 0)
+		return NULL;
+
+	if (best_path->jpath.path.param_info != NULL ||
+		inner_path->param_info == NULL)
+		return NULL;
+
+	if (innerrel->reloptkind != RELOPT_BASEREL)
+		return NULL;
+	rte = planner_rt_fetch(innerrel->relid, root);
+	if (rte->rtekind != RTE_RELATION || rte->inh)
+		return NULL;
+
+	hash_inner_path = innerrel->cheapest_total_path;
+	if (hash_inner_path == NULL || PATH_REQ_OUTER(hash_inner_path) != NULL)
+		return NULL;
+	if (best_path->jpath.path.parallel_safe && !hash_inner_path->parallel_safe)
+		return NULL;
+
+	/*
+	 * Both alternatives will contain the relation's restriction clauses; make
+	 * sure we needn't worry about planning subplans in them twice.
+	 */
+	foreach(lc, innerrel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (contain_subplans((Node *) rinfo->clause))
+			return NULL;
+	}
+
+	clauses = list_concat_copy(best_path->jpath.joinrestrictinfo,
+							   inner_path->param_info->ppi_clauses);
+	foreach(lc, clauses)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (rinfo->pseudoconstant)
+			continue;
+
+		if (rinfo->can_join && OidIsValid(rinfo->hashjoinoperator))
+		{
+			if (bms_is_subset(rinfo->left_relids, outerrelids) &&
+				bms_is_subset(rinfo->right_relids, innerrel->relids))
+			{
+				rinfo->outer_is_left = true;
+				*hashclauses = lappend(*hashclauses, rinfo);
+				continue;
+			}
+			if (bms_is_subset(rinfo->left_relids, innerrel->relids) &&
+				bms_is_subset(rinfo->right_relids, outerrelids))
+			{
+				rinfo->outer_is_left = false;
+				*hashclauses = lappend(*hashclauses, rinfo);
+				continue;
+			}
+		}
+		*otherclauses = lappend(*otherclauses, rinfo);
+	}
+
+	if (*hashclauses == NIL)
+		return NULL;
+
+	*nl_max_rows = adaptive_join_threshold(root, outer_path, inner_path,
+										   hash_inner_path,
+										   list_length(*hashclauses));
+	if (*nl_max_rows < 0)
+		return NULL;
+
+	return hash_inner_path;
+}
+
+/*
+ * create_adaptive_join_plan
+ *	  Build an adaptive join from a nestloop path, see HashJoin.
+ *
+ * The result is a hash join over the outer plan and a Hash of the plain
+ * inner plan, which also carries the nestloop's parameterized inner plan and
+ * its nestParams.  In nested-loop mode, the executor checks the hash clauses
+ * and join quals against the tuples of that plan just as it would against
+ * the tuples found in the hash table, which requires both inner plans to
+ * produce the same tlist.  Returns NULL if they don't.
+ */
+static HashJoin *
+create_adaptive_join_plan(PlannerInfo *root, NestPath *best_path, List *tlist,
+						  Plan *outer_plan, Plan *nl_inner_plan,
+						  List *nestParams, Path *hash_inner_path,
+						  List *hashclauses, List *otherclauses,
+						  double nl_max_rows)
+{
+	HashJoin   *join_plan;
+	Hash	   *hash_plan;
+	Plan	   *hash_inner_plan;
+	List	   *joinclauses;
+	List	   *hashoperators = NIL;
+	List	   *hashcollations = NIL;
+	List	   *inner_hashkeys = NIL;
+	List	   *outer_hashkeys = NIL;
+	ListCell   *lc;
+
+	hash_inner_plan = create_plan_recurse(root, hash_inner_path,
+										  CP_EXACT_TLIST);
+	if (!tlist_same_exprs(hash_inner_plan->targetlist,
+						  nl_inner_plan->targetlist))
+		return NULL;
+
+	otherclauses = order_qual_clauses(root, otherclauses);
+	joinclauses = extract_actual_clauses(otherclauses, false);
+	hashclauses = get_switched_clauses(hashclauses,
+									   best_path->jpath.outerjoinpath->parent->relids);
+
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *hclause = lfirst_node(OpExpr, lc);
+
+		hashoperators = lappend_oid(hashoperators, hclause->opno);
+		hashcollations = lappend_oid(hashcollations, hclause->inputcollid);
+		outer_hashkeys = lappend(outer_hashkeys, linitial(hclause->args));
+		inner_hashkeys = lappend(inner_hashkeys, lsecond(hclause->args));
+	}
+
+	hash_plan = make_hash(hash_inner_plan,
+						  inner_hashkeys,
+						  InvalidOid,
+						  InvalidAttrNumber,
+						  false);
+	copy_plan_costsize(&hash_plan->plan, hash_inner_plan);
+	hash_plan->plan.startup_cost = hash_plan->plan.total_cost;
+
+	join_plan = make_hashjoin(tlist,
+							  joinclauses,
+							  NIL,
+							  hashclauses,
+							  hashoperators,
+							  hashcollations,
+							  outer_hashkeys,
+							  outer_plan,
+							  (Plan *) hash_plan,
+							  best_path->jpath.jointype,
+							  best_path->jpath.inner_unique);
+	join_plan->nlinner = nl_inner_plan;
+	join_plan->nestParams = nestParams;
+	join_plan->nl_max_rows = nl_max_rows;
+
+	/* The costs are those of the nestloop we expect to run */
+	copy_generic_path_info(&join_plan->join.plan, &best_path->jpath.path);
+
 	return join_plan;
 }
 
@@ -4862,12 +5114,161 @@ create_hashjoin_plan(PlannerInfo *root,
 							  (Plan *) hash_plan,
 							  best_path->jpath.jointype,
 							  best_path->jpath.inner_unique);
+	join_plan->radix_partition = best_path->radix_partition;
 
 	copy_generic_path_info(&join_plan->join.plan, &best_path->jpath.path);
 
+	if (enable_runtime_filter)
+		push_runtime_filter(root, best_path, hash_plan, outer_plan,
+							hashoperators, hashcollations, outer_hashkeys);
+
 	return join_plan;
 }
 
+/*
+ * push_runtime_filter
+ *	  Try to make the Hash node of a hash join build a runtime filter for a
+ *	  scan on the outer side of the join.
+ *
+ * The Hash node fills a Bloom filter with the hash values of the inner
+ * tuples, and the scan discards tuples whose hash value is not in it.  That
+ * is only correct if the join throws away outer tuples without a match, and
+ * if every node between the join and the scan would pass such tuples up
+ * unchanged; so we only walk down the outer side of plain inner, semi, left
+ * and anti joins, and through nodes that merely reorder or buffer their
+ * input.  The outer hash keys must all be simple columns of the scanned
+ * relation, so that the scan can compute the hash value itself.
+ *
+ * A Parallel Hash cannot publish its filter until all participants have
+ * finished the build, so it doesn't get one.  A parallel-oblivious hash join
+ * above a Gather can still filter the scan below it, since the Gather passes
+ * the filter to the workers along with its other initParams.
+ */
+static void
+push_runtime_filter(PlannerInfo *root, HashPath *best_path, Hash *hash_plan,
+					Plan *outer_plan, List *hashoperators,
+					List *hashcollations, List *outer_hashkeys)
+{
+	Plan	   *plan = outer_plan;
+	Plan	   *gather = NULL;
+	Index		scanrelid = 0;
+	RuntimeFilter *rf;
+	Param	   *param;
+	ListCell   *lc;
+
+	if (best_path->jpath.path.parallel_aware)
+		return;
+
+	switch (best_path->jpath.jointype)
+	{
+		case JOIN_INNER:
+		case JOIN_SEMI:
+		case JOIN_RIGHT:
+			break;
+		default:
+			/* the join must not emit unmatched outer tuples */
+			return;
+	}
+
+	/*
+	 * Don't bother unless the join is expected to eliminate a good part of
+	 * its outer input.
+	 */
+	if (best_path->jpath.path.rows >
+		best_path->jpath.outerjoinpath->rows * RUNTIME_FILTER_MAX_SELECTIVITY)
+		return;
+
+	foreach(lc, outer_hashkeys)
+	{
+		Node	   *key = (Node *) lfirst(lc);
+
+		if (IsA(key, RelabelType))
+			key = (Node *) ((RelabelType *) key)->arg;
+		if (!IsA(key, Var) || ((Var *) key)->varlevelsup != 0)
+			return;
+		if (scanrelid == 0)
+			scanrelid = ((Var *) key)->varno;
+		else if (((Var *) key)->varno != scanrelid)
+			return;
+	}
+
+	/*
+	 * A non-strict operator would make NULL keys match, but the scan rejects
+	 * them outright.
+	 */
+	foreach(lc, hashoperators)
+	{
+		if (!op_strict(lfirst_oid(lc)))
+			return;
+	}
+
+	/* Find the scan of scanrelid that feeds the outer side of the join */
+	for (;;)
+	{
+		switch (nodeTag(plan))
+		{
+			case T_SeqScan:
+			case T_IndexScan:
+			case T_BitmapHeapScan:
+				if (((Scan *) plan)->scanrelid != scanrelid)
+					return;
+				break;
+			case T_Gather:
+			case T_GatherMerge:
+				if (gather != NULL)
+					return;
+				gather = plan;
+				plan = plan->lefttree;
+				continue;
+			case T_Sort:
+			case T_IncrementalSort:
+			case T_Material:
+				plan = plan->lefttree;
+				continue;
+			case T_NestLoop:
+			case T_MergeJoin:
+			case T_HashJoin:
+				switch (((Join *) plan)->jointype)
+				{
+					case JOIN_INNER:
+					case JOIN_SEMI:
+					case JOIN_LEFT:
+					case JOIN_ANTI:
+						plan = plan->lefttree;
+						continue;
+					default:
+						return;
+				}
+			default:
+				return;
+		}
+		break;
+	}
+
+	param = generate_new_exec_param(root, BYTEAOID, -1, InvalidOid);
+
+	rf = makeNode(RuntimeFilter);
+	rf->paramid = param->paramid;
+	rf->hashkeys = copyObject(outer_hashkeys);
+	rf->hashoperators = list_copy(hashoperators);
+	rf->hashcollations = list_copy(hashcollations);
+
+	((Scan *) plan)->rtfilters = lappend(((Scan *) plan)->rtfilters, rf);
+	hash_plan->rtfilterParam = param->paramid;
+
+	if (gather != NULL)
+	{
+		if (IsA(gather, Gather))
+			((Gather *) gather)->initParam =
+				bms_add_member(((Gather *) gather)->initParam,
+							   param->paramid);
+		else
+			((GatherMerge *) gather)->initParam =
+				bms_add_member(((GatherMerge *) gather)->initParam,
+							   param->paramid);
+	}
+}
+
 
 /*****************************************************************************
  *
@@ -5508,7 +5909,8 @@ make_indexscan(List *qptlist,
 			   List *indexorderby,
 			   List *indexorderbyorig,
 			   List *indexorderbyops,
-			   ScanDirection indexscandir)
+			   ScanDirection indexscandir,
+			   bool indexskip)
 {
 	IndexScan  *node = makeNode(IndexScan);
 	Plan	   *plan = &node->scan.plan;
@@ -5525,6 +5927,7 @@ make_indexscan(List *qptlist,
 	node->indexorderbyorig = indexorderbyorig;
 	node->indexorderbyops = indexorderbyops;
 	node->indexorderdir = indexscandir;
+	node->indexskip = indexskip;
 
 	return node;
 }
@@ -5538,7 +5941,8 @@ make_indexonlyscan(List *qptlist,
 				   List *recheckqual,
 				   List *indexorderby,
 				   List *indextlist,
-				   ScanDirection indexscandir)
+				   ScanDirection indexscandir,
+				   bool indexskip)
 {
 	IndexOnlyScan *node = makeNode(IndexOnlyScan);
 	Plan	   *plan = &node->scan.plan;
@@ -5554,6 +5958,7 @@ make_indexonlyscan(List *qptlist,
 	node->indexorderby = indexorderby;
 	node->indextlist = indextlist;
 	node->indexorderdir = indexscandir;
+	node->indexskip = indexskip;
 
 	return node;
 }
@@ -5562,7 +5967,8 @@ static BitmapIndexScan *
 make_bitmap_indexscan(Index scanrelid,
 					  Oid indexid,
 					  List *indexqual,
-					  List *indexqualorig)
+					  List *indexqualorig,
+					  bool indexskip)
 {
 	BitmapIndexScan *node = makeNode(BitmapIndexScan);
 	Plan	   *plan = &node->scan.plan;
@@ -5575,6 +5981,7 @@ make_bitmap_indexscan(Index scanrelid,
 	node->indexid = indexid;
 	node->indexqual = indexqual;
 	node->indexqualorig = indexqualorig;
+	node->indexskip = indexskip;
 
 	return node;
 }
@@ -5975,6 +6382,7 @@ make_hash(Plan *lefttree,
 	node->skewTable = skewTable;
 	node->skewColumn = skewColumn;
 	node->skewInherit = skewInherit;
+	node->rtfilterParam = -1;
 
 	return node;
 }
@@ -6519,7 +6927,8 @@ materialize_finished_plan(Plan *subplan)
 static Memoize *
 make_memoize(Plan *lefttree, Oid *hashoperators, Oid *collations,
 			 List *param_exprs, bool singlerow, bool binary_mode,
-			 uint32 est_entries, Bitmapset *keyparamids)
+			 uint32 est_entries, Bitmapset *keyparamids,
+			 Cardinality est_unique_keys, double est_hit_ratio)
 {
 	Memoize    *node = makeNode(Memoize);
 	Plan	   *plan = &node->plan;
@@ -6537,6 +6946,8 @@ make_memoize(Plan *lefttree, Oid *hashoperators, Oid *collations,
 	node->binary_mode = binary_mode;
 	node->est_entries = est_entries;
 	node->keyparamids = keyparamids;
+	node->est_unique_keys = est_unique_keys;
+	node->est_hit_ratio = est_hit_ratio;
 
 	return node;
 }
@@ -6066,7 +6066,8 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
  *		CREATE INDEX should request for use
  *
  * tableOid is the table on which the index is to be built.  indexOid is the
- * OID of an index to be created or reindexed (which must be a btree index).
+ * OID of an index to be created or reindexed (which must be a btree or gin
+ * index).
  *
  * Return value is the number of parallel worker processes to request.  It
  * may be unsafe to proceed if this is 0.  Note that this does not include the
@@ -6558,6 +6559,36 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									 havingQual,
 									 agg_costs,
 									 dNumGroups));
+
+			/*
+			 * Consider a parallel-aware HashAgg.  Its participants aggregate
+			 * disjoint sets of groups completely, so there's no need for a
+			 * Finalize step; gather_grouping_paths() will just put a Gather
+			 * on top.  Don't try it for partitionwise aggregation of a child
+			 * relation; the partitions are already aggregated separately.
+			 */
+			if (enable_parallel_hashagg && grouped_rel->consider_parallel &&
+				input_rel->partial_pathlist != NIL &&
+				!IS_OTHER_REL(grouped_rel))
+			{
+				Path	   *partial_path = linitial(input_rel->partial_pathlist);
+				AggPath    *agg_path;
+
+				agg_path = create_agg_path(root, grouped_rel,
+										   partial_path,
+										   grouped_rel->reltarget,
+										   AGG_HASHED,
+										   AGGSPLIT_SIMPLE,
+										   parse->groupClause,
+										   havingQual,
+										   agg_costs,
+										   clamp_row_est(dNumGroups /
+														 partial_path->parallel_workers));
+				agg_path->path.parallel_aware = true;
+				cost_parallel_hashagg(&agg_path->path, partial_path->rows,
+									  partial_path->pathtarget->width);
+				add_partial_path(grouped_rel, (Path *) agg_path);
+			}
 		}
 
 		/*
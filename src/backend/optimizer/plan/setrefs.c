@@ -143,6 +143,8 @@ static Node *fix_scan_expr_mutator(Node *node, fix_scan_expr_context *context);
 static bool fix_scan_expr_walker(Node *node, fix_scan_expr_context *context);
 static void set_join_references(PlannerInfo *root, Join *join, int rtoffset);
 static void set_upper_references(PlannerInfo *root, Plan *plan, int rtoffset);
+static void fix_runtime_filter_references(PlannerInfo *root, Scan *scan,
+										  int rtoffset);
 static void set_param_references(PlannerInfo *root, Plan *plan);
 static Node *convert_combining_aggrefs(Node *node, void *context);
 static void set_dummy_tlist_references(Plan *plan, int rtoffset);
@@ -559,6 +561,7 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 				splan->scan.plan.qual =
 					fix_scan_list(root, splan->scan.plan.qual,
 								  rtoffset, NUM_EXEC_QUAL(plan));
+				fix_runtime_filter_references(root, &splan->scan, rtoffset);
 			}
 			break;
 		case T_SampleScan:
@@ -600,6 +603,7 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 				splan->indexorderbyorig =
 					fix_scan_list(root, splan->indexorderbyorig,
 								  rtoffset, NUM_EXEC_QUAL(plan));
+				fix_runtime_filter_references(root, &splan->scan, rtoffset);
 			}
 			break;
 		case T_IndexOnlyScan:
@@ -638,6 +642,7 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 				splan->bitmapqualorig =
 					fix_scan_list(root, splan->bitmapqualorig,
 								  rtoffset, NUM_EXEC_QUAL(plan));
+				fix_runtime_filter_references(root, &splan->scan, rtoffset);
 			}
 			break;
 		case T_TidScan:
@@ -1214,6 +1219,9 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 	 */
 	plan->lefttree = set_plan_refs(root, plan->lefttree, rtoffset);
 	plan->righttree = set_plan_refs(root, plan->righttree, rtoffset);
+	if (IsA(plan, HashJoin) && ((HashJoin *) plan)->nlinner != NULL)
+		((HashJoin *) plan)->nlinner =
+			set_plan_refs(root, ((HashJoin *) plan)->nlinner, rtoffset);
 
 	return plan;
 }
@@ -2204,6 +2212,7 @@ set_join_references(PlannerInfo *root, Join *join, int rtoffset)
 	else if (IsA(join, HashJoin))
 	{
 		HashJoin   *hj = (HashJoin *) join;
+		ListCell   *lc;
 
 		hj->hashclauses = fix_join_expr(root,
 										hj->hashclauses,
@@ -2223,6 +2232,22 @@ set_join_references(PlannerInfo *root, Join *join, int rtoffset)
 											   OUTER_VAR,
 											   rtoffset,
 											   NUM_EXEC_QUAL((Plan *) join));
+
+		/* An adaptive join passes nestParams like a NestLoop */
+		foreach(lc, hj->nestParams)
+		{
+			NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+
+			nlp->paramval = (Var *) fix_upper_expr(root,
+												   (Node *) nlp->paramval,
+												   outer_itlist,
+												   OUTER_VAR,
+												   rtoffset,
+												   NUM_EXEC_TLIST(outer_plan));
+			if (!(IsA(nlp->paramval, Var) &&
+				  nlp->paramval->varno == OUTER_VAR))
+				elog(ERROR, "NestLoopParam was not reduced to a simple Var");
+		}
 	}
 
 	/*
@@ -2348,6 +2373,24 @@ set_upper_references(PlannerInfo *root, Plan *plan, int rtoffset)
 	pfree(subplan_itlist);
 }
 
+/*
+ * fix_runtime_filter_references
+ *	  Do set_plan_references processing on the hash keys of the runtime
+ *	  filters pushed down to a scan node.
+ */
+static void
+fix_runtime_filter_references(PlannerInfo *root, Scan *scan, int rtoffset)
+{
+	ListCell   *lc;
+
+	foreach(lc, scan->rtfilters)
+	{
+		RuntimeFilter *rf = lfirst_node(RuntimeFilter, lc);
+
+		rf->hashkeys = fix_scan_list(root, rf->hashkeys, rtoffset, 1);
+	}
+}
+
 /*
  * set_param_references
  *	  Initialize the initParam list in Gather or Gather merge node such that
@@ -2382,14 +2425,19 @@ set_param_references(PlannerInfo *root, Plan *plan)
 
 		/*
 		 * Remember the list of all external initplan params that are used by
-		 * the children of Gather or Gather merge node.
+		 * the children of Gather or Gather merge node.  Keep any runtime
+		 * filter params that createplan.c put there already.
 		 */
 		if (IsA(plan, Gather))
 			((Gather *) plan)->initParam =
-				bms_intersect(plan->lefttree->extParam, initSetParam);
+				bms_add_members(((Gather *) plan)->initParam,
+								bms_intersect(plan->lefttree->extParam,
+											  initSetParam));
 		else
 			((GatherMerge *) plan)->initParam =
-				bms_intersect(plan->lefttree->extParam, initSetParam);
+				bms_add_members(((GatherMerge *) plan)->initParam,
+								bms_intersect(plan->lefttree->extParam,
+											  initSetParam));
 	}
 }
 
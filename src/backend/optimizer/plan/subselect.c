@@ -103,6 +103,8 @@ static Bitmapset *finalize_plan(PlannerInfo *root,
 								Bitmapset *scan_params);
 static bool finalize_primnode(Node *node, finalize_primnode_context *context);
 static bool finalize_agg_primnode(Node *node, finalize_primnode_context *context);
+static void finalize_runtime_filters(Scan *scan,
+									 finalize_primnode_context *context);
 
 
 /*
@@ -2310,6 +2312,7 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			break;
 
 		case T_SeqScan:
+			finalize_runtime_filters((Scan *) plan, &context);
 			context.paramids = bms_add_members(context.paramids, scan_params);
 			break;
 
@@ -2330,6 +2333,7 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			 * param references as indexqual.  Likewise, we can ignore
 			 * indexorderbyorig.
 			 */
+			finalize_runtime_filters((Scan *) plan, &context);
 			context.paramids = bms_add_members(context.paramids, scan_params);
 			break;
 
@@ -2360,6 +2364,7 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 		case T_BitmapHeapScan:
 			finalize_primnode((Node *) ((BitmapHeapScan *) plan)->bitmapqualorig,
 							  &context);
+			finalize_runtime_filters((Scan *) plan, &context);
 			context.paramids = bms_add_members(context.paramids, scan_params);
 			break;
 
@@ -2649,6 +2654,38 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 							  &context);
 			finalize_primnode((Node *) ((HashJoin *) plan)->hashclauses,
 							  &context);
+			/* outer child nodes are allowed to reference rtfilterParam */
+			locally_added_param = ((Hash *) plan->righttree)->rtfilterParam;
+			if (locally_added_param >= 0)
+				valid_params = bms_add_member(bms_copy(valid_params),
+											  locally_added_param);
+
+			/*
+			 * The nested-loop inner plan of an adaptive join can reference
+			 * its nestParams, which don't count as parameters used at this
+			 * level, as for a NestLoop's right child.
+			 */
+			if (((HashJoin *) plan)->nlinner != NULL)
+			{
+				Bitmapset  *nl_params = NULL;
+				ListCell   *l;
+
+				foreach(l, ((HashJoin *) plan)->nestParams)
+				{
+					NestLoopParam *nlp = (NestLoopParam *) lfirst(l);
+
+					nl_params = bms_add_member(nl_params, nlp->paramno);
+				}
+				child_params = finalize_plan(root,
+											 ((HashJoin *) plan)->nlinner,
+											 gather_param,
+											 bms_union(nl_params, valid_params),
+											 scan_params);
+				context.paramids =
+					bms_add_members(context.paramids,
+									bms_difference(child_params, nl_params));
+				bms_free(nl_params);
+			}
 			break;
 
 		case T_Limit:
@@ -2842,6 +2879,24 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 	return plan->allParam;
 }
 
+/*
+ * finalize_runtime_filters: add IDs of the params through which a scan
+ * receives its runtime filters to the result set.  (The filters' hash keys
+ * are plain Vars of the scanned relation, so they can't contain any params.)
+ */
+static void
+finalize_runtime_filters(Scan *scan, finalize_primnode_context *context)
+{
+	ListCell   *lc;
+
+	foreach(lc, scan->rtfilters)
+	{
+		RuntimeFilter *rf = lfirst_node(RuntimeFilter, lc);
+
+		context->paramids = bms_add_member(context->paramids, rf->paramid);
+	}
+}
+
 /*
  * finalize_primnode: add IDs of all PARAM_EXEC params appearing in the given
  * expression tree to the result set.
@@ -1613,6 +1613,8 @@ create_memoize_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 	 * If left at 0, the executor will make a guess at a good value.
 	 */
 	pathnode->est_entries = 0;
+	pathnode->est_unique_keys = 0;
+	pathnode->est_hit_ratio = 0;
 
 	/*
 	 * Add a small additional charge for caching the first entry.  All the
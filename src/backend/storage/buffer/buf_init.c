@@ -71,6 +71,7 @@ InitBufferPool(void)
 				foundDescs,
 				foundIOCV,
 				foundBufCkpt;
+	Size		numaPageSize;
 
 	/* Align descriptors to a cacheline boundary. */
 	BufferDescriptors = (BufferDescPadded *)
@@ -78,9 +79,16 @@ InitBufferPool(void)
 						NBuffers * sizeof(BufferDescPadded),
 						&foundDescs);
 
+	/*
+	 * When the pool is to be striped over NUMA nodes, align the blocks to
+	 * the page size, so that stripe boundaries fall on page boundaries.
+	 */
+	numaPageSize = BufferNumaPageSize();
 	BufferBlocks = (char *)
 		ShmemInitStruct("Buffer Blocks",
-						NBuffers * (Size) BLCKSZ, &foundBufs);
+						NBuffers * (Size) BLCKSZ + numaPageSize, &foundBufs);
+	if (numaPageSize > 0)
+		BufferBlocks = (char *) TYPEALIGN(numaPageSize, BufferBlocks);
 
 	/* Align condition variables to cacheline boundary. */
 	BufferIOCVArray = (ConditionVariableMinimallyPadded *)
@@ -99,6 +107,12 @@ InitBufferPool(void)
 		ShmemInitStruct("Checkpoint BufferIds",
 						NBuffers * sizeof(CkptSortItem), &foundBufCkpt);
 
+	/*
+	 * Bind the memory of the buffer pool to NUMA nodes, if requested.  This
+	 * must happen before the memory is first touched below.
+	 */
+	BufferNumaInit(!foundDescs);
+
 	if (foundDescs || foundBufs || foundIOCV || foundBufCkpt)
 	{
 		/* should find all of these, or none of them */
@@ -165,6 +179,11 @@ BufferShmemSize(void)
 
 	/* size of data pages */
 	size = add_size(size, mul_size(NBuffers, BLCKSZ));
+	/* to allow aligning them for NUMA placement */
+	size = add_size(size, BufferNumaPageSize());
+
+	/* size of NUMA stripe control structure */
+	size = add_size(size, BufferNumaShmemSize());
 
 	/* size of stuff controlled by freelist.c */
 	size = add_size(size, StrategyShmemSize());
@@ -0,0 +1,473 @@
+/*-------------------------------------------------------------------------
+ *
+ * buf_numa.c
+ *	  NUMA-aware placement of the shared buffer pool.
+ *
+ * With numa_shared_buffers enabled, the buffer pool is divided into stripes
+ * of consecutive buffers, one for each NUMA node that we may allocate memory
+ * on, and the memory holding each stripe's buffer blocks and descriptors is
+ * bound to its node before anything touches it.  Stripe sizes are rounded up
+ * to a multiple of the page size shared memory is mapped with (the huge page
+ * size, if huge pages may be in use), so that no memory page straddles two
+ * stripes.  Buffer descriptors are much smaller than blocks, so a page of
+ * them can cover more than one stripe; such pages are left to the kernel's
+ * default policy.
+ *
+ * StrategyGetBuffer() prefers victim buffers from the stripe of the node the
+ * backend is currently running on, and we count buffer hits and allocations
+ * per stripe, which pg_buffercache reports.
+ *
+ * This is implemented with the Linux mbind(2), get_mempolicy(2) and
+ * getcpu(2) system calls, invoked directly so that we don't need libnuma.
+ *
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/buf_numa.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+#ifdef HAVE_LINUX_MEMPOLICY_H
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+#include "storage/buf_internals.h"
+#include "storage/bufmgr.h"
+#include "storage/pg_shmem.h"
+#include "storage/shmem.h"
+
+/* Number of bits in the node masks we pass to the kernel */
+#define NUMA_NODE_MASK_BITS		1024
+#define NUMA_NODE_MASK_WORDS	(NUMA_NODE_MASK_BITS / (8 * sizeof(unsigned long)))
+
+/* Number of counted events after which a backend flushes its counts */
+#define BUFFER_NUMA_FLUSH_EVENTS	64
+
+/* Number of calls after which we ask the kernel again where we're running */
+#define BUFFER_NUMA_NODE_REFRESH	64
+
+/*
+ * Shared state of one stripe.  Each is on a cache line of its own, as the
+ * counters are updated by all backends.
+ */
+typedef struct BufferNumaStripeData
+{
+	int			os_node;		/* NUMA node the stripe is bound to */
+
+	/*
+	 * Position of the stripe's local clock hand.  Like nextVictimBuffer in
+	 * freelist.c, this is not reduced modulo the size of the stripe.
+	 */
+	pg_atomic_uint32 nextVictim;
+
+	pg_atomic_uint64 hits;		/* buffer hits on the stripe */
+	pg_atomic_uint64 remoteHits;	/* ... by backends on other nodes */
+	pg_atomic_uint64 allocs;	/* victim buffers chosen in the stripe */
+} BufferNumaStripeData;
+
+typedef union BufferNumaStripePadded
+{
+	BufferNumaStripeData stripe;
+	char		pad[PG_CACHE_LINE_SIZE];
+} BufferNumaStripePadded;
+
+typedef struct BufferNumaControl
+{
+	int			stripeBuffers;	/* buffers per stripe, or 0 */
+	int			nstripes;		/* number of stripes */
+	BufferNumaStripePadded stripes[BUFFER_NUMA_MAX_NODES];
+} BufferNumaControl;
+
+/* GUC variable */
+bool		numa_shared_buffers = false;
+
+/* Copy of BufferNumaCtl->stripeBuffers, see buf_internals.h */
+int			BufferNumaStripe = 0;
+
+static BufferNumaControl *BufferNumaCtl = NULL;
+
+/* Stripe of the node this backend is running on, or -1 if none */
+static int	MyNumaStripe = -1;
+static int	MyNumaStripeAge = 0;
+
+/* Counts not yet added to BufferNumaCtl */
+static uint32 PendingNumaHits[BUFFER_NUMA_MAX_NODES];
+static uint32 PendingNumaRemoteHits[BUFFER_NUMA_MAX_NODES];
+static uint32 PendingNumaAllocs[BUFFER_NUMA_MAX_NODES];
+static int	PendingNumaEvents = 0;
+
+#ifdef HAVE_LINUX_MEMPOLICY_H
+static void BufferNumaPlace(void);
+static void BufferNumaBind(char *start, Size len, Size pagesize, int os_node);
+#endif
+
+
+/*
+ * BufferNumaPageSize
+ *
+ * Returns the alignment that NUMA stripe boundaries need, or 0 if the buffer
+ * pool is not to be striped.  InitBufferPool() aligns BufferBlocks to this.
+ */
+Size
+BufferNumaPageSize(void)
+{
+#ifdef HAVE_LINUX_MEMPOLICY_H
+	Size		hugepagesize;
+
+	if (!numa_shared_buffers)
+		return 0;
+
+	if (huge_pages != HUGE_PAGES_OFF)
+	{
+		GetHugePageSize(&hugepagesize, NULL);
+		if (hugepagesize != 0)
+			return hugepagesize;
+	}
+
+	return (Size) sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+/*
+ * BufferNumaShmemSize
+ *
+ * Estimate space needed for the NUMA stripe control structure.
+ */
+Size
+BufferNumaShmemSize(void)
+{
+	return MAXALIGN(sizeof(BufferNumaControl));
+}
+
+/*
+ * BufferNumaInit
+ *
+ * Set up the NUMA stripe control structure, and bind the memory of each
+ * stripe to its node.  This must be called after BufferBlocks and
+ * BufferDescriptors have been allocated, but before they are initialized.
+ */
+void
+BufferNumaInit(bool init)
+{
+	bool		found;
+	int			i;
+
+	BufferNumaCtl = (BufferNumaControl *)
+		ShmemInitStruct("Buffer NUMA Stripes",
+						sizeof(BufferNumaControl), &found);
+
+	if (!found)
+	{
+		Assert(init);
+
+		BufferNumaCtl->stripeBuffers = 0;
+		BufferNumaCtl->nstripes = 0;
+		for (i = 0; i < BUFFER_NUMA_MAX_NODES; i++)
+		{
+			BufferNumaStripeData *stripe = &BufferNumaCtl->stripes[i].stripe;
+
+			stripe->os_node = -1;
+			pg_atomic_init_u32(&stripe->nextVictim, 0);
+			pg_atomic_init_u64(&stripe->hits, 0);
+			pg_atomic_init_u64(&stripe->remoteHits, 0);
+			pg_atomic_init_u64(&stripe->allocs, 0);
+		}
+
+#ifdef HAVE_LINUX_MEMPOLICY_H
+		if (numa_shared_buffers)
+			BufferNumaPlace();
+#endif
+	}
+
+	BufferNumaStripe = BufferNumaCtl->stripeBuffers;
+}
+
+#ifdef HAVE_LINUX_MEMPOLICY_H
+/*
+ * BufferNumaPlace - Helper routine for BufferNumaInit()
+ *
+ * Divide the buffer pool into stripes and bind each to a node.
+ */
+static void
+BufferNumaPlace(void)
+{
+	unsigned long allowed[NUMA_NODE_MASK_WORDS];
+	int			nodes[BUFFER_NUMA_MAX_NODES];
+	int			nnodes = 0;
+	int			mode;
+	Size		pagesize = BufferNumaPageSize();
+	int			align;
+	int			stripe;
+	int			i;
+
+	/* Find the nodes we're allowed to allocate memory on */
+	memset(allowed, 0, sizeof(allowed));
+	if (syscall(SYS_get_mempolicy, &mode, allowed, NUMA_NODE_MASK_BITS + 1,
+				NULL, MPOL_F_MEMS_ALLOWED) != 0)
+	{
+		ereport(WARNING,
+				(errmsg("could not determine NUMA nodes: %m"),
+				 errdetail("Shared buffers will not be placed on NUMA nodes.")));
+		return;
+	}
+
+	for (i = 0; i < NUMA_NODE_MASK_BITS && nnodes < BUFFER_NUMA_MAX_NODES; i++)
+	{
+		if (allowed[i / (8 * sizeof(unsigned long))] &
+			(1UL << (i % (8 * sizeof(unsigned long)))))
+			nodes[nnodes++] = i;
+	}
+	if (nnodes == 0)
+		return;
+
+	/* Divide the pool evenly, rounding stripes up to whole pages */
+	align = Max(pagesize / BLCKSZ, 1);
+	stripe = (NBuffers + nnodes - 1) / nnodes;
+	stripe = ((stripe + align - 1) / align) * align;
+
+	BufferNumaCtl->stripeBuffers = stripe;
+	BufferNumaCtl->nstripes = (NBuffers + stripe - 1) / stripe;
+
+	for (i = 0; i < BufferNumaCtl->nstripes; i++)
+	{
+		int			first = i * stripe;
+		int			nbuffers = Min(stripe, NBuffers - first);
+
+		BufferNumaCtl->stripes[i].stripe.os_node = nodes[i];
+
+		BufferNumaBind(BufferBlocks + (Size) first * BLCKSZ,
+					   (Size) nbuffers * BLCKSZ, pagesize, nodes[i]);
+		BufferNumaBind((char *) GetBufferDescriptor(first),
+					   (Size) nbuffers * sizeof(BufferDescPadded),
+					   pagesize, nodes[i]);
+	}
+
+	elog(DEBUG1, "shared buffers striped over %d NUMA nodes, %d buffers each",
+		 BufferNumaCtl->nstripes, stripe);
+}
+
+/*
+ * BufferNumaBind - Helper routine for BufferNumaPlace()
+ *
+ * Bind the whole pages within the given memory range to a node.  We ask for
+ * the node to be preferred rather than required, so that allocation falls
+ * back to other nodes rather than failing if the node runs out of memory.
+ */
+static void
+BufferNumaBind(char *start, Size len, Size pagesize, int os_node)
+{
+	unsigned long mask[NUMA_NODE_MASK_WORDS];
+	char	   *first = (char *) TYPEALIGN(pagesize, start);
+	char	   *last = (char *) TYPEALIGN_DOWN(pagesize, start + len);
+
+	if (last <= first)
+		return;
+
+	memset(mask, 0, sizeof(mask));
+	mask[os_node / (8 * sizeof(unsigned long))] |=
+		1UL << (os_node % (8 * sizeof(unsigned long)));
+
+	if (syscall(SYS_mbind, first, (unsigned long) (last - first),
+				MPOL_PREFERRED, mask, NUMA_NODE_MASK_BITS + 1, 0) != 0)
+		ereport(WARNING,
+				(errmsg("could not bind shared buffers to NUMA node %d: %m",
+						os_node)));
+}
+#endif							/* HAVE_LINUX_MEMPOLICY_H */
+
+/*
+ * BufferNumaCurrentStripe
+ *
+ * Returns the stripe of the node this backend is running on, or -1 if no
+ * stripe is bound to it.  Backends can be moved between CPUs at any time, so
+ * this is only a good guess; we ask the kernel again every so often.
+ */
+static int
+BufferNumaCurrentStripe(void)
+{
+#ifdef HAVE_LINUX_MEMPOLICY_H
+	if (--MyNumaStripeAge < 0)
+	{
+		unsigned int cpu;
+		unsigned int node;
+		int			i;
+
+		MyNumaStripe = -1;
+		if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+		{
+			for (i = 0; i < BufferNumaCtl->nstripes; i++)
+			{
+				if (BufferNumaCtl->stripes[i].stripe.os_node == (int) node)
+				{
+					MyNumaStripe = i;
+					break;
+				}
+			}
+		}
+		MyNumaStripeAge = BUFFER_NUMA_NODE_REFRESH;
+	}
+#endif
+
+	return MyNumaStripe;
+}
+
+/*
+ * BufferNumaLocalCandidates
+ *
+ * Advance the local clock hand of the stripe of the node we're running on by
+ * BUFFER_NUMA_LOCAL_BATCH positions, and store the ids of the buffers it
+ * passed over into buf_ids[].  Returns the number of buffers stored, which is
+ * zero if we're not running on a node with a stripe.
+ */
+int
+BufferNumaLocalCandidates(int *buf_ids)
+{
+	int			stripeno = BufferNumaCurrentStripe();
+	int			first;
+	int			nbuffers;
+	uint32		pos;
+	int			i;
+
+	if (stripeno < 0)
+		return 0;
+
+	first = stripeno * BufferNumaStripe;
+	nbuffers = Min(BufferNumaStripe, NBuffers - first);
+
+	pos = pg_atomic_fetch_add_u32(&BufferNumaCtl->stripes[stripeno].stripe.nextVictim,
+								  BUFFER_NUMA_LOCAL_BATCH);
+	for (i = 0; i < BUFFER_NUMA_LOCAL_BATCH; i++)
+		buf_ids[i] = first + (pos + i) % nbuffers;
+
+	return BUFFER_NUMA_LOCAL_BATCH;
+}
+
+/*
+ * BufferNumaFlushStats
+ *
+ * Add this backend's counts to the shared ones.
+ */
+void
+BufferNumaFlushStats(void)
+{
+	int			i;
+
+	if (PendingNumaEvents == 0)
+		return;
+
+	for (i = 0; i < BufferNumaCtl->nstripes; i++)
+	{
+		BufferNumaStripeData *stripe = &BufferNumaCtl->stripes[i].stripe;
+
+		if (PendingNumaHits[i] != 0)
+			pg_atomic_fetch_add_u64(&stripe->hits, PendingNumaHits[i]);
+		if (PendingNumaRemoteHits[i] != 0)
+			pg_atomic_fetch_add_u64(&stripe->remoteHits,
+									PendingNumaRemoteHits[i]);
+		if (PendingNumaAllocs[i] != 0)
+			pg_atomic_fetch_add_u64(&stripe->allocs, PendingNumaAllocs[i]);
+
+		PendingNumaHits[i] = 0;
+		PendingNumaRemoteHits[i] = 0;
+		PendingNumaAllocs[i] = 0;
+	}
+
+	PendingNumaEvents = 0;
+}
+
+/*
+ * BufferNumaCountHit
+ *
+ * Count a buffer hit on the given buffer.  Only to be called when the buffer
+ * pool is striped.
+ */
+void
+BufferNumaCountHit(int buf_id)
+{
+	int			stripeno = buf_id / BufferNumaStripe;
+
+	PendingNumaHits[stripeno]++;
+	if (stripeno != BufferNumaCurrentStripe())
+		PendingNumaRemoteHits[stripeno]++;
+
+	if (++PendingNumaEvents >= BUFFER_NUMA_FLUSH_EVENTS)
+		BufferNumaFlushStats();
+}
+
+/*
+ * BufferNumaCountAlloc
+ *
+ * Count the choice of the given buffer as a victim.  Only to be called when
+ * the buffer pool is striped.  This is called with the buffer header spinlock
+ * held, so we only count locally; StrategyGetBuffer() flushes the counts
+ * later.
+ */
+void
+BufferNumaCountAlloc(int buf_id)
+{
+	PendingNumaAllocs[buf_id / BufferNumaStripe]++;
+	PendingNumaEvents++;
+}
+
+/*
+ * BufferNumaResetStats
+ *
+ * Reset the shared per-stripe counters.
+ */
+void
+BufferNumaResetStats(void)
+{
+	int			i;
+
+	for (i = 0; i < BufferNumaCtl->nstripes; i++)
+	{
+		BufferNumaStripeData *stripe = &BufferNumaCtl->stripes[i].stripe;
+
+		pg_atomic_write_u64(&stripe->hits, 0);
+		pg_atomic_write_u64(&stripe->remoteHits, 0);
+		pg_atomic_write_u64(&stripe->allocs, 0);
+	}
+}
+
+/*
+ * BufferNumaStripes
+ *
+ * Returns the number of NUMA stripes, or 0 if the buffer pool is not striped.
+ */
+int
+BufferNumaStripes(void)
+{
+	return BufferNumaCtl->nstripes;
+}
+
+/*
+ * BufferNumaGetStripe
+ *
+ * Report the node, the range of buffers and the counters of a stripe.
+ */
+void
+BufferNumaGetStripe(int stripeno, int *os_node, int *first_buffer,
+					int *nbuffers, uint64 *hits, uint64 *remote_hits,
+					uint64 *allocs)
+{
+	BufferNumaStripeData *stripe;
+
+	Assert(stripeno >= 0 && stripeno < BufferNumaCtl->nstripes);
+	stripe = &BufferNumaCtl->stripes[stripeno].stripe;
+
+	*os_node = stripe->os_node;
+	*first_buffer = stripeno * BufferNumaStripe;
+	*nbuffers = Min(BufferNumaStripe, NBuffers - *first_buffer);
+	*hits = pg_atomic_read_u64(&stripe->hits);
+	*remote_hits = pg_atomic_read_u64(&stripe->remoteHits);
+	*allocs = pg_atomic_read_u64(&stripe->allocs);
+}
@@ -9,6 +9,17 @@
  * in most cases the caller needs to adjust the buffer header contents
  * before the lock is released (see notes in README).
  *
+ * Besides the authoritative hash table, we maintain an array of lookup
+ * hints: a small open-addressing table, indexed by the tag's hash code, that
+ * maps hash codes to the buffers most recently entered under them.  The hints
+ * can be read without any lock at all, which lets the common case of finding
+ * a page that is already in shared buffers avoid the BufMappingLock
+ * entirely.  Hints are only hints: an entry may be missing (it can be pushed
+ * out by other entries of the same bucket) or refer to a buffer that has
+ * meanwhile been given a different page, so the caller must pin the buffer
+ * and check its tag before trusting it, and fall back to BufTableLookup()
+ * under the partition lock if that fails.
+ *
  *
  * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -33,37 +44,146 @@ typedef struct
 
 static HTAB *SharedBufHash;
 
+/*
+ * Number of buffers we aim to cover with each mapping partition.  The number
+ * of partitions is the next power of 2 that achieves this, but never less
+ * than NUM_BUFFER_PARTITIONS.
+ */
+#define BUFFERS_PER_MAPPING_PARTITION	1024
+
+/*
+ * A lookup hint packs the tag's full 32-bit hash code into the high half and
+ * buf_id + 1 into the low half, so that zero means an empty slot.  The hint
+ * array has room for about two hints per buffer.
+ */
+#define BUF_TABLE_HINT_MAKE(hashcode, buf_id) \
+	(((uint64) (hashcode) << 32) | (uint64) ((buf_id) + 1))
+#define BUF_TABLE_HINT_HASHCODE(hint)	((uint32) ((hint) >> 32))
+#define BUF_TABLE_HINT_BUF_ID(hint)		((int) ((uint32) (hint)) - 1)
+
+/* Number of partitions of the mapping table, and their locks */
+int			NumBufMappingPartitions = NUM_BUFFER_PARTITIONS;
+LWLockPadded *BufMappingLWLockArray = NULL;
+
+static pg_atomic_uint64 *BufTableHints;
+static uint32 BufTableHintBucketMask;
+
+/*
+ * Compute the number of mapping partitions and hint buckets for the current
+ * NBuffers.  Both are powers of 2, and there are at least as many buckets as
+ * partitions; thus all the hints in one bucket belong to tags of the same
+ * partition, and so are protected by the same partition lock.
+ */
+static void
+BufTableComputeSizes(int *npartitions, uint32 *nbuckets)
+{
+	int			nparts = NUM_BUFFER_PARTITIONS;
+	uint32		nb = 1;
+
+	while (nparts < NBuffers / BUFFERS_PER_MAPPING_PARTITION)
+		nparts <<= 1;
+
+	while (nb * BUF_TABLE_HINT_WAYS < 2 * (uint32) NBuffers)
+		nb <<= 1;
+	nb = Max(nb, (uint32) nparts);
+
+	*npartitions = nparts;
+	*nbuckets = nb;
+}
 
 /*
- * Estimate space needed for mapping hashtable
- *		size is the desired hash table size (possibly more than NBuffers)
+ * Estimate space needed for mapping hashtable, its partition locks and the
+ * lookup hints
  */
 Size
-BufTableShmemSize(int size)
+BufTableShmemSize(void)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	int			nparts;
+	uint32		nbuckets;
+	Size		size;
+
+	BufTableComputeSizes(&nparts, &nbuckets);
+
+	/* see comment in InitBufTable */
+	size = hash_estimate_size(NBuffers + nparts, sizeof(BufferLookupEnt));
+	size = add_size(size, mul_size(nparts, sizeof(LWLockPadded)));
+	size = add_size(size, PG_CACHE_LINE_SIZE);
+	size = add_size(size, mul_size(mul_size(nbuckets, BUF_TABLE_HINT_WAYS),
+								   sizeof(pg_atomic_uint64)));
+	size = add_size(size, PG_CACHE_LINE_SIZE);
+
+	return size;
 }
 
 /*
- * Initialize shmem hash table for mapping buffers
- *		size is the desired hash table size (possibly more than NBuffers)
+ * Initialize shmem hash table for mapping buffers, together with its
+ * partition locks and the lookup hints
  */
 void
-InitBufTable(int size)
+InitBufTable(void)
 {
 	HASHCTL		info;
+	uint32		nbuckets;
+	int			size;
+	bool		foundLocks,
+				foundHints;
+	char	   *ptr;
+
+	BufTableComputeSizes(&NumBufMappingPartitions, &nbuckets);
+	BufTableHintBucketMask = nbuckets - 1;
+
+	/*
+	 * Since we can't tolerate running out of lookup table entries, we must be
+	 * sure to specify an adequate table size here.  The maximum steady-state
+	 * usage is of course NBuffers entries, but BufferAlloc() tries to insert
+	 * a new entry before deleting the old.  In principle this could be
+	 * happening in each partition concurrently, so we could need as many as
+	 * NBuffers + NumBufMappingPartitions entries.
+	 */
+	size = NBuffers + NumBufMappingPartitions;
 
 	/* assume no locking is needed yet */
 
 	/* BufferTag maps to Buffer */
 	info.keysize = sizeof(BufferTag);
 	info.entrysize = sizeof(BufferLookupEnt);
-	info.num_partitions = NUM_BUFFER_PARTITIONS;
+	info.num_partitions = NumBufMappingPartitions;
 
 	SharedBufHash = ShmemInitHash("Shared Buffer Lookup Table",
 								  size, size,
 								  &info,
 								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+
+	/* Align the partition locks and the hint buckets to cacheline boundary. */
+	ptr = ShmemInitStruct("Shared Buffer Lookup Locks",
+						  NumBufMappingPartitions * sizeof(LWLockPadded) +
+						  PG_CACHE_LINE_SIZE,
+						  &foundLocks);
+	BufMappingLWLockArray = (LWLockPadded *) CACHELINEALIGN(ptr);
+
+	ptr = ShmemInitStruct("Shared Buffer Lookup Hints",
+						  nbuckets * BUF_TABLE_HINT_WAYS *
+						  sizeof(pg_atomic_uint64) + PG_CACHE_LINE_SIZE,
+						  &foundHints);
+	BufTableHints = (pg_atomic_uint64 *) CACHELINEALIGN(ptr);
+
+	if (foundLocks || foundHints)
+	{
+		/* should find both of these, or neither */
+		Assert(foundLocks && foundHints);
+		/* note: this path is only taken in EXEC_BACKEND case */
+	}
+	else
+	{
+		int			i;
+
+		for (i = 0; i < NumBufMappingPartitions; i++)
+			LWLockInitialize(&BufMappingLWLockArray[i].lock,
+							 LWTRANCHE_BUFFER_MAPPING);
+
+		for (i = 0; i < nbuckets * BUF_TABLE_HINT_WAYS; i++)
+			pg_atomic_init_u64(&BufTableHints[i], 0);
+	}
 }
 
 /*
@@ -159,4 +279,114 @@ BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 
 	if (!result)				/* shouldn't happen */
 		elog(ERROR, "shared buffer hash table corrupted");
+
+	/* Forget any lookup hint that points to the entry's buffer. */
+	BufTableClearHint(hashcode, result->id);
+}
+
+/*
+ * BufTableLookupHints
+ *		Return the buffers that might hold the page with the given hash code,
+ *		according to the lookup hints
+ *
+ * Up to BUF_TABLE_HINT_WAYS buffer IDs are stored into buf_ids[], and the
+ * number of them is returned.  No lock is required, and none of the results
+ * can be trusted: the caller must pin each candidate and check its tag.
+ * Conversely, not finding a buffer here doesn't mean that the page isn't in
+ * the table.
+ */
+int
+BufTableLookupHints(uint32 hashcode, int *buf_ids)
+{
+	pg_atomic_uint64 *bucket;
+	int			n = 0;
+	int			i;
+
+	bucket = &BufTableHints[(hashcode & BufTableHintBucketMask) *
+							BUF_TABLE_HINT_WAYS];
+	for (i = 0; i < BUF_TABLE_HINT_WAYS; i++)
+	{
+		uint64		hint = pg_atomic_read_u64(&bucket[i]);
+
+		if (hint != 0 && BUF_TABLE_HINT_HASHCODE(hint) == hashcode)
+			buf_ids[n++] = BUF_TABLE_HINT_BUF_ID(hint);
+	}
+
+	return n;
+}
+
+/*
+ * BufTableSetHint
+ *		Remember that the page with the given hash code is in buffer buf_id
+ *
+ * The buffer's tag must already have been set, so that a concurrent lookup
+ * using the hint finds the buffer ready to be pinned.
+ *
+ * If exclusive is true, the caller holds exclusive lock on the BufMappingLock
+ * for the tag's partition, and an older hint is evicted if the bucket is
+ * full.  Otherwise the caller holds only share lock, so other backends might
+ * be adding hints to the same bucket concurrently; we then only fill an empty
+ * slot, using compare-and-exchange.
+ */
+void
+BufTableSetHint(uint32 hashcode, int buf_id, bool exclusive)
+{
+	pg_atomic_uint64 *bucket;
+	uint64		newhint = BUF_TABLE_HINT_MAKE(hashcode, buf_id);
+	int			empty = -1;
+	int			i;
+
+	bucket = &BufTableHints[(hashcode & BufTableHintBucketMask) *
+							BUF_TABLE_HINT_WAYS];
+	for (i = 0; i < BUF_TABLE_HINT_WAYS; i++)
+	{
+		uint64		hint = pg_atomic_read_u64(&bucket[i]);
+
+		if (hint == newhint)
+			return;				/* already there */
+		if (hint == 0 && empty < 0)
+			empty = i;
+	}
+
+	if (!exclusive)
+	{
+		uint64		expected = 0;
+
+		if (empty >= 0)
+			(void) pg_atomic_compare_exchange_u64(&bucket[empty], &expected,
+												  newhint);
+		return;
+	}
+
+	/* Bucket is full, evict a pseudo-randomly chosen hint. */
+	if (empty < 0)
+		empty = (hashcode >> 16 ^ buf_id) % BUF_TABLE_HINT_WAYS;
+	pg_atomic_write_u64(&bucket[empty], newhint);
+}
+
+/*
+ * BufTableClearHint
+ *		Forget that the page with the given hash code is in buffer buf_id
+ *
+ * Caller must hold exclusive lock on BufMappingLock for tag's partition
+ */
+void
+BufTableClearHint(uint32 hashcode, int buf_id)
+{
+	pg_atomic_uint64 *bucket;
+	uint64		oldhint = BUF_TABLE_HINT_MAKE(hashcode, buf_id);
+	int			i;
+
+	bucket = &BufTableHints[(hashcode & BufTableHintBucketMask) *
+							BUF_TABLE_HINT_WAYS];
+
+	/*
+	 * Lookups holding only share lock might have added the same hint more
+	 * than once, so check every slot.
+	 */
+	for (i = 0; i < BUF_TABLE_HINT_WAYS; i++)
+	{
+		if (pg_atomic_read_u64(&bucket[i]) == oldhint)
+			pg_atomic_write_u64(&bucket[i], 0);
+	}
 }
@@ -52,6 +52,7 @@
 #include "storage/smgr.h"
 #include "storage/standby.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
@@ -159,9 +160,45 @@ int			checkpoint_flush_after = 0;
 int			bgwriter_flush_after = 0;
 int			backend_flush_after = 0;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
-static bool IsForInput;
+/*
+ * Maximum number of blocks ReadBuffers() reads, and BufferSync() writes, with
+ * a single I/O operation.
+ */
+int			io_combine_limit = DEFAULT_IO_COMBINE_LIMIT;
+
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * A backend can have I/O in progress on as many buffers as a batch of reads
+ * or checkpoint writes holds, plus one more for a victim buffer that
+ * BufferAlloc() has to write out while a batch of reads is being assembled.
+ */
+#define MAX_IN_PROGRESS_BUFS	(MAX_IO_BATCH_BUFFERS + 1)
+
+static BufferDesc *InProgressBufs[MAX_IN_PROGRESS_BUFS];
+static bool InProgressIsForInput[MAX_IN_PROGRESS_BUFS];
+static int	NInProgressBufs = 0;
+
+/*
+ * Checkpoint writes that SyncBufferRange() has prepared, but that haven't
+ * been performed yet.  The buffers are pinned, share-locked and marked
+ * BM_IO_IN_PROGRESS, and PendingWritePages[] points to the data to write for
+ * each, which is a checksummed copy if checksums are enabled.  Consecutive
+ * buffers form ranges of consecutive blocks of a relation fork.
+ */
+typedef struct PendingWriteRange
+{
+	int			first;			/* index of first buffer */
+	int			nbufs;			/* number of buffers */
+} PendingWriteRange;
+
+static BufferDesc *PendingWriteBufs[MAX_IO_BATCH_BUFFERS];
+static char *PendingWritePages[MAX_IO_BATCH_BUFFERS];
+static PendingWriteRange PendingWriteRanges[MAX_IO_BATCH_BUFFERS];
+static int	NPendingWriteBufs = 0;
+static int	NPendingWriteRanges = 0;
+static XLogRecPtr PendingWriteMaxLSN = InvalidXLogRecPtr;
+static char *PendingWriteCopies = NULL;
 
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
@@ -470,8 +507,11 @@ static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
 						  WritebackContext *wb_context);
+static int	SyncBufferRange(int *buf_ids, int nbufs,
+							WritebackContext *wb_context, int *nwritten);
+static void FlushPendingWrites(WritebackContext *wb_context);
 static void WaitIO(BufferDesc *buf);
-static bool StartBufferIO(BufferDesc *buf, bool forInput);
+static bool StartBufferIO(BufferDesc *buf, bool forInput, bool nowait);
 static void TerminateBufferIO(BufferDesc *buf, bool clear_dirty,
 							  uint32 set_flag_bits);
 static void shared_buffer_write_error_callback(void *arg);
@@ -481,7 +521,7 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   ForkNumber forkNum,
 							   BlockNumber blockNum,
 							   BufferAccessStrategy strategy,
-							   bool *foundPtr);
+							   bool nowait, bool *foundPtr);
 static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
 static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
 										  ForkNumber forkNum,
@@ -498,6 +538,93 @@ static inline int ckpt_buforder_comparator(const CkptSortItem *a, const CkptSort
 static int	ts_ckpt_progress_comparator(Datum a, Datum b, void *arg);
 
 
+/*
+ * FindBufferByHint -- find the buffer holding a page, using only the lookup
+ * hints
+ *
+ * Returns the buffer ID, or -1 if the hints don't lead to a buffer holding
+ * the page; in the latter case the page might still be in the buffer pool.
+ * The buffer isn't pinned, so the answer might be obsolete by the time the
+ * caller looks at it.
+ */
+static int
+FindBufferByHint(BufferTag *tag, uint32 hashcode)
+{
+	int			buf_ids[BUF_TABLE_HINT_WAYS];
+	int			n;
+	int			i;
+
+	n = BufTableLookupHints(hashcode, buf_ids);
+	for (i = 0; i < n; i++)
+	{
+		BufferDesc *buf = GetBufferDescriptor(buf_ids[i]);
+		uint32		buf_state;
+		bool		match;
+
+		buf_state = LockBufHdr(buf);
+		match = (buf_state & BM_TAG_VALID) && BUFFERTAGS_EQUAL(buf->tag, *tag);
+		UnlockBufHdr(buf, buf_state);
+
+		if (match)
+			return buf_ids[i];
+	}
+
+	return -1;
+}
+
+/*
+ * PinBufferByHint -- find and pin the buffer holding a page, using only the
+ * lookup hints
+ *
+ * Returns the pinned buffer, setting *valid as PinBuffer() would, or NULL if
+ * the hints don't lead to a buffer holding the page.  In the latter case the
+ * page might still be in the buffer pool, and the caller must look it up in
+ * the mapping table under the partition lock.
+ *
+ * This is safe without the mapping lock because a buffer's tag can't change
+ * while it's pinned (see BufferAlloc and InvalidateBuffer), and a buffer only
+ * has a valid tag while the mapping table has an entry for it.  So once we
+ * hold a pin on a buffer with the right tag, we're in the same position as
+ * if we had found it in the mapping table.  A hint that turns out to be stale
+ * costs a pin and unpin of some unrelated buffer, which bumps its usage count
+ * as a side effect; that's harmless, and rare.
+ *
+ * Note that ResourceOwnerEnlargeBuffers must have been done already.
+ */
+static BufferDesc *
+PinBufferByHint(BufferTag *tag, uint32 hashcode,
+				BufferAccessStrategy strategy, bool *valid)
+{
+	int			buf_ids[BUF_TABLE_HINT_WAYS];
+	int			n;
+	int			i;
+
+	n = BufTableLookupHints(hashcode, buf_ids);
+	for (i = 0; i < n; i++)
+	{
+		BufferDesc *buf = GetBufferDescriptor(buf_ids[i]);
+		bool		isvalid;
+		uint32		buf_state;
+
+		isvalid = PinBuffer(buf, strategy);
+
+		/*
+		 * PinBuffer's compare-and-exchange acts as a memory barrier, so we
+		 * see the tag as it was set by whoever last renamed the buffer.
+		 */
+		buf_state = pg_atomic_read_u32(&buf->state);
+		if ((buf_state & BM_TAG_VALID) && BUFFERTAGS_EQUAL(buf->tag, *tag))
+		{
+			*valid = isvalid;
+			return buf;
+		}
+
+		UnpinBuffer(buf, true);
+	}
+
+	return NULL;
+}
+
 /*
  * Implementation of PrefetchBuffer() for shared buffers.
  */
@@ -522,10 +649,18 @@ PrefetchSharedBuffer(SMgrRelation smgr_reln,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
-	LWLockAcquire(newPartitionLock, LW_SHARED);
-	buf_id = BufTableLookup(&newTag, newHash);
-	LWLockRelease(newPartitionLock);
+	/*
+	 * See if the block is in the buffer pool already.  We only need a hint
+	 * here, so if the lookup hints name a buffer holding the block, that's
+	 * good enough; otherwise consult the mapping table.
+	 */
+	buf_id = FindBufferByHint(&newTag, newHash);
+	if (buf_id < 0)
+	{
+		LWLockAcquire(newPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&newTag, newHash);
+		LWLockRelease(newPartitionLock);
+	}
 
 	/* If not in buffers, initiate prefetch */
 	if (buf_id < 0)
@@ -692,6 +827,8 @@ ReadRecentBuffer(RelFileNode rnode, ForkNumber forkNum, BlockNumber blockNum,
 				PinBuffer_Locked(bufHdr);	/* pin for first time */
 
 			pgBufferUsage.shared_blks_hit++;
+			if (BufferNumaStripe > 0)
+				BufferNumaCountHit(bufHdr->buf_id);
 
 			return true;
 		}
@@ -785,6 +922,336 @@ ReadBufferExtended(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
 }
 
 
+/*
+ * LimitAdditionalPins -- limit the number of pins a multi-block operation
+ *		may acquire on top of those already held
+ *
+ * Reading ahead pins buffers well before they are used, and a backend that
+ * pins more than its share of shared_buffers could leave others with no
+ * buffer to evict.  Our share is taken to be NBuffers divided by the maximum
+ * number of backends, which is pessimistic but allows plenty of pins unless
+ * shared_buffers is tiny.  One additional pin is always allowed, since the
+ * operation couldn't make progress otherwise.
+ */
+void
+LimitAdditionalPins(uint32 *additional_pins)
+{
+	uint32		max_backends;
+	int			max_proportional_pins;
+
+	if (*additional_pins <= 1)
+		return;
+
+	max_backends = MaxBackends + NUM_AUXILIARY_PROCS;
+	max_proportional_pins = NBuffers / max_backends;
+
+	/*
+	 * Subtract the pins we already hold.  We know the number of overflowed
+	 * entries, but counting the used PrivateRefCountArray entries isn't worth
+	 * it, so assume they are all in use.
+	 */
+	max_proportional_pins -= PrivateRefCountOverflowed + REFCOUNT_ARRAY_ENTRIES;
+
+	if (max_proportional_pins <= 0)
+		max_proportional_pins = 1;
+
+	if (*additional_pins > max_proportional_pins)
+		*additional_pins = max_proportional_pins;
+}
+
+
+/*
+ * ReadBuffers -- pin a range of consecutive blocks of a relation fork,
+ *		reading those that are not already in the buffer pool with a single
+ *		I/O operation
+ *
+ * On entry, *nblocks is the number of blocks wanted, starting at blockNum;
+ * it must not exceed MAX_IO_COMBINE_LIMIT.  On return, *nblocks is set to
+ * the number of buffers actually pinned and stored in buffers[], which is
+ * always at least one.  If the first block is already valid in the buffer
+ * pool, it is returned alone.  Otherwise, the blocks that need to be read
+ * are read in together with smgrreadv(), and the range stops at (and
+ * includes) the first block that turns out to be valid already.  The
+ * caller should call again for any remaining blocks.
+ *
+ * This behaves like calling ReadBufferExtended() with RBM_NORMAL for each
+ * block, including the statistics it keeps, so all of the blocks must
+ * exist.  Returns true if any blocks had to be read.
+ */
+bool
+ReadBuffers(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+			int *nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	ReadBuffersOperation operation;
+
+	if (!StartReadBuffers(&operation, reln, forkNum, blockNum, nblocks,
+						  strategy, buffers))
+		return false;
+
+	WaitReadBuffers(&operation, 1);
+
+	return true;
+}
+
+/*
+ * StartReadBuffers -- first half of ReadBuffers()
+ *
+ * Pins the buffers for a range of blocks as described for ReadBuffers(), and
+ * sets up *operation for reading those that are not valid.  Returns true if
+ * there is anything to read, in which case the caller must pass *operation
+ * to WaitReadBuffers() before using the buffers.  buffers[] must stay in
+ * place until then.
+ *
+ * Several operations can be started before waiting for all of them together,
+ * so that their reads can be performed concurrently; see io_method.  The
+ * total number of blocks of the operations in such a batch must not exceed
+ * MAX_IO_BATCH_BUFFERS.  Operations other than the first in a batch don't
+ * wait for reads started by other backends, because we hold
+ * BM_IO_IN_PROGRESS on the blocks of the earlier operations, and the other
+ * backend could be waiting for one of those.  Such an operation stops before
+ * the first block that is being read by someone else, and thus might pin no
+ * buffers at all, setting *nblocks to zero.  The caller should wait for its
+ * batch and then try again.
+ *
+ * Within the first operation of a batch, we may wait for another backend's
+ * I/O on the next block while holding BM_IO_IN_PROGRESS on the blocks we
+ * allocated before it.  That can't deadlock, because every backend starts
+ * I/O on the blocks of a range in ascending order, so the backend we wait
+ * for can only be waiting for still later blocks itself.
+ */
+bool
+StartReadBuffers(ReadBuffersOperation *operation,
+				 Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+				 int *nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	SMgrRelation smgr;
+	bool		isLocalBuf;
+	bool		nowait;
+	int			nwanted = *nblocks;
+	int			npinned = 0;
+	int			nmisses = 0;
+
+	Assert(nwanted > 0 && nwanted <= MAX_IO_COMBINE_LIMIT);
+	Assert(NInProgressBufs + nwanted <= MAX_IO_BATCH_BUFFERS);
+
+	/* See ReadBufferExtended */
+	if (RELATION_IS_OTHER_TEMP(reln))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions")));
+
+	smgr = RelationGetSmgr(reln);
+	isLocalBuf = SmgrIsTemp(smgr);
+	nowait = NInProgressBufs > 0;
+
+	/*
+	 * Pin buffers until we find one that is already valid.  Those before it
+	 * are marked IO_IN_PROGRESS, if they're shared buffers.
+	 */
+	while (npinned < nwanted)
+	{
+		BlockNumber curBlockNum = blockNum + npinned;
+		BufferDesc *bufHdr;
+		bool		found;
+
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		if (isLocalBuf)
+			bufHdr = LocalBufferAlloc(smgr, forkNum, curBlockNum, &found);
+		else
+		{
+			bufHdr = BufferAlloc(smgr, reln->rd_rel->relpersistence,
+								 forkNum, curBlockNum, strategy, nowait,
+								 &found);
+			if (bufHdr == NULL)
+				break;			/* being read by someone else */
+		}
+		buffers[npinned++] = BufferDescriptorGetBuffer(bufHdr);
+
+		TRACE_POSTGRESQL_BUFFER_READ_START(forkNum, curBlockNum,
+										   smgr->smgr_rnode.node.spcNode,
+										   smgr->smgr_rnode.node.dbNode,
+										   smgr->smgr_rnode.node.relNode,
+										   smgr->smgr_rnode.backend,
+										   false);
+		pgstat_count_buffer_read(reln);
+
+		if (found)
+		{
+			if (isLocalBuf)
+				pgBufferUsage.local_blks_hit++;
+			else
+			{
+				pgBufferUsage.shared_blks_hit++;
+				if (BufferNumaStripe > 0)
+					BufferNumaCountHit(bufHdr->buf_id);
+			}
+			pgstat_count_buffer_hit(reln);
+			VacuumPageHit++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+
+			TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, curBlockNum,
+											  smgr->smgr_rnode.node.spcNode,
+											  smgr->smgr_rnode.node.dbNode,
+											  smgr->smgr_rnode.node.relNode,
+											  smgr->smgr_rnode.backend,
+											  false,
+											  true);
+			break;
+		}
+
+		if (isLocalBuf)
+			pgBufferUsage.local_blks_read++;
+		else
+			pgBufferUsage.shared_blks_read++;
+		nmisses++;
+	}
+
+	Assert(npinned > 0 || nowait);
+	*nblocks = npinned;
+
+	operation->rel = reln;
+	operation->forknum = forkNum;
+	operation->blocknum = blockNum;
+	operation->buffers = buffers;
+	operation->nmisses = nmisses;
+
+	return nmisses > 0;
+}
+
+/*
+ * WaitReadBuffers -- second half of ReadBuffers()
+ *
+ * Reads the blocks of a batch of operations set up by StartReadBuffers().
+ * With more than one operation, the reads are submitted with
+ * smgrperformio(), so that they can be performed concurrently.  On return,
+ * all of the buffers are valid.
+ */
+void
+WaitReadBuffers(ReadBuffersOperation *operations, int noperations)
+{
+	instr_time	io_start,
+				io_time;
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	/* The blocks to read are always at the start of each range. */
+	if (noperations == 1)
+	{
+		ReadBuffersOperation *operation = &operations[0];
+		char	   *bufBlocks[MAX_IO_COMBINE_LIMIT];
+
+		for (int i = 0; i < operation->nmisses; i++)
+			bufBlocks[i] = (char *) BufferGetBlock(operation->buffers[i]);
+
+		smgrreadv(RelationGetSmgr(operation->rel), operation->forknum,
+				  operation->blocknum, bufBlocks, operation->nmisses);
+	}
+	else
+	{
+		SMgrIORequest *reqs;
+		char	   *bufBlocks[MAX_IO_BATCH_BUFFERS];
+		int			nblocks = 0;
+
+		reqs = palloc(sizeof(SMgrIORequest) * noperations);
+		for (int i = 0; i < noperations; i++)
+		{
+			ReadBuffersOperation *operation = &operations[i];
+
+			reqs[i].reln = RelationGetSmgr(operation->rel);
+			reqs[i].forknum = operation->forknum;
+			reqs[i].blocknum = operation->blocknum;
+			reqs[i].buffers = &bufBlocks[nblocks];
+			reqs[i].nblocks = operation->nmisses;
+			reqs[i].is_write = false;
+			reqs[i].skipFsync = false;
+
+			for (int j = 0; j < operation->nmisses; j++)
+				bufBlocks[nblocks++] =
+					(char *) BufferGetBlock(operation->buffers[j]);
+		}
+		Assert(nblocks <= MAX_IO_BATCH_BUFFERS);
+
+		smgrperformio(reqs, noperations);
+		pfree(reqs);
+	}
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+	}
+
+	for (int n = 0; n < noperations; n++)
+	{
+		ReadBuffersOperation *operation = &operations[n];
+		SMgrRelation smgr = RelationGetSmgr(operation->rel);
+		ForkNumber	forkNum = operation->forknum;
+
+		for (int i = 0; i < operation->nmisses; i++)
+		{
+			Buffer		buffer = operation->buffers[i];
+			BlockNumber curBlockNum = operation->blocknum + i;
+			Page		page = BufferGetPage(buffer);
+
+			/* check for garbage data, as in ReadBuffer_common */
+			if (!PageIsVerifiedExtended(page, curBlockNum,
+										PIV_LOG_WARNING | PIV_REPORT_STAT))
+			{
+				if (zero_damaged_pages)
+				{
+					ereport(WARNING,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("invalid page in block %u of relation %s; zeroing out page",
+									curBlockNum,
+									relpath(smgr->smgr_rnode, forkNum))));
+					MemSet(page, 0, BLCKSZ);
+				}
+				else
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("invalid page in block %u of relation %s",
+									curBlockNum,
+									relpath(smgr->smgr_rnode, forkNum))));
+			}
+
+			if (BufferIsLocal(buffer))
+			{
+				/* Only need to adjust flags */
+				BufferDesc *bufHdr = GetLocalBufferDescriptor(-buffer - 1);
+				uint32		buf_state = pg_atomic_read_u32(&bufHdr->state);
+
+				buf_state |= BM_VALID;
+				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
+			}
+			else
+			{
+				/* Set BM_VALID, terminate IO, and wake up any waiters */
+				TerminateBufferIO(GetBufferDescriptor(buffer - 1), false,
+								  BM_VALID);
+			}
+
+			VacuumPageMiss++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageMiss;
+
+			TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, curBlockNum,
+											  smgr->smgr_rnode.node.spcNode,
+											  smgr->smgr_rnode.node.dbNode,
+											  smgr->smgr_rnode.node.relNode,
+											  smgr->smgr_rnode.backend,
+											  false,
+											  false);
+		}
+	}
+}
+
+
 /*
  * ReadBufferWithoutRelcache -- like ReadBufferExtended, but doesn't require
  *		a relcache entry for the relation.
@@ -871,9 +1338,13 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 * not currently in memory.
 		 */
 		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum,
-							 strategy, &found);
+							 strategy, false, &found);
 		if (found)
+		{
 			pgBufferUsage.shared_blks_hit++;
+			if (BufferNumaStripe > 0)
+				BufferNumaCountHit(bufHdr->buf_id);
+		}
 		else if (isExtend)
 			pgBufferUsage.shared_blks_written++;
 		else if (mode == RBM_NORMAL || mode == RBM_NORMAL_NO_LOG ||
@@ -968,7 +1439,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				Assert(buf_state & BM_VALID);
 				buf_state &= ~BM_VALID;
 				UnlockBufHdr(bufHdr, buf_state);
-			} while (!StartBufferIO(bufHdr, true));
+			} while (!StartBufferIO(bufHdr, true, false));
 		}
 	}
 
@@ -1113,13 +1584,18 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
  * *foundPtr is actually redundant with the buffer's BM_VALID flag, but
  * we keep it for simplicity in ReadBuffer.
  *
+ * If nowait is true and another backend is reading the page in, we don't
+ * wait for it; NULL is returned instead, with no pin held.  Callers that
+ * already hold BM_IO_IN_PROGRESS on other buffers use this to avoid waiting
+ * for a backend that might in turn be waiting for them.
+ *
  * No locks are held either at entry or exit.
  */
 static BufferDesc *
 BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			BlockNumber blockNum,
 			BufferAccessStrategy strategy,
-			bool *foundPtr)
+			bool nowait, bool *foundPtr)
 {
 	BufferTag	newTag;			/* identity of requested block */
 	uint32		newHash;		/* hash value for newTag */
@@ -1140,23 +1616,39 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
-	LWLockAcquire(newPartitionLock, LW_SHARED);
-	buf_id = BufTableLookup(&newTag, newHash);
-	if (buf_id >= 0)
+	/*
+	 * See if the block is in the buffer pool already.  Usually the lookup
+	 * hints lead us straight to it without taking the mapping lock.
+	 */
+	buf = PinBufferByHint(&newTag, newHash, strategy, &valid);
+	if (buf == NULL)
 	{
-		/*
-		 * Found it.  Now, pin the buffer so no one can steal it from the
-		 * buffer pool, and check to see if the correct data has been loaded
-		 * into the buffer.
-		 */
-		buf = GetBufferDescriptor(buf_id);
+		LWLockAcquire(newPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&newTag, newHash);
+		if (buf_id >= 0)
+		{
+			/*
+			 * Found it.  Now, pin the buffer so no one can steal it from the
+			 * buffer pool.
+			 */
+			buf = GetBufferDescriptor(buf_id);
 
-		valid = PinBuffer(buf, strategy);
+			valid = PinBuffer(buf, strategy);
+
+			/* Make sure the next lookup can find it without the lock */
+			BufTableSetHint(newHash, buf_id, false);
+		}
 
 		/* Can release the mapping lock as soon as we've pinned it */
 		LWLockRelease(newPartitionLock);
+	}
 
+	if (buf != NULL)
+	{
+		/*
+		 * Found it, and it's pinned.  Check to see if the correct data has
+		 * been loaded into the buffer.
+		 */
 		*foundPtr = true;
 
 		if (!valid)
@@ -1168,7 +1660,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			 * own read attempt if the page is still not BM_VALID.
 			 * StartBufferIO does it all.
 			 */
-			if (StartBufferIO(buf, true))
+			if (StartBufferIO(buf, true, nowait))
 			{
 				/*
 				 * If we get here, previous attempts to read the buffer must
@@ -1176,6 +1668,12 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				 */
 				*foundPtr = false;
 			}
+			else if (nowait && !(pg_atomic_read_u32(&buf->state) & BM_VALID))
+			{
+				/* Someone else is reading it in, and we mustn't wait. */
+				UnpinBuffer(buf, true);
+				return NULL;
+			}
 		}
 
 		return buf;
@@ -1366,6 +1864,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 			valid = PinBuffer(buf, strategy);
 
+			BufTableSetHint(newHash, buf_id, true);
+
 			/* Can release the mapping lock as soon as we've pinned it */
 			LWLockRelease(newPartitionLock);
 
@@ -1380,7 +1880,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				 * then set up our own read attempt if the page is still not
 				 * BM_VALID.  StartBufferIO does it all.
 				 */
-				if (StartBufferIO(buf, true))
+				if (StartBufferIO(buf, true, nowait))
 				{
 					/*
 					 * If we get here, previous attempts to read the buffer
@@ -1388,6 +1888,12 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 					 */
 					*foundPtr = false;
 				}
+				else if (nowait && !(pg_atomic_read_u32(&buf->state) & BM_VALID))
+				{
+					/* Someone else is reading it in, and we mustn't wait. */
+					UnpinBuffer(buf, true);
+					return NULL;
+				}
 			}
 
 			return buf;
@@ -1441,6 +1947,9 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	UnlockBufHdr(buf, buf_state);
 
+	/* Now that the tag is set, lookups may find the buffer without a lock */
+	BufTableSetHint(newHash, buf->buf_id, true);
+
 	if (oldPartitionLock != NULL)
 	{
 		BufTableDelete(&oldTag, oldHash);
@@ -1456,8 +1965,13 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 * to read it before we did, so there's nothing left for BufferAlloc() to
 	 * do.
 	 */
-	if (StartBufferIO(buf, true))
+	if (StartBufferIO(buf, true, nowait))
 		*foundPtr = false;
+	else if (nowait && !(pg_atomic_read_u32(&buf->state) & BM_VALID))
+	{
+		UnpinBuffer(buf, true);
+		return NULL;
+	}
 	else
 		*foundPtr = true;
 
@@ -1966,6 +2480,14 @@ BufferSync(int flags)
 	/* Make sure we can handle the pin inside SyncOneBuffer */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
 
+	/*
+	 * Forget any write batch left over from a checkpoint that failed; error
+	 * recovery has already released its locks, pins and I/O.
+	 */
+	NPendingWriteBufs = 0;
+	NPendingWriteRanges = 0;
+	PendingWriteMaxLSN = InvalidXLogRecPtr;
+
 	/*
 	 * Unless this is a shutdown checkpoint or we have been explicitly told,
 	 * we write only permanent, dirty buffers.  But at shutdown or end of
@@ -2139,6 +2661,7 @@ BufferSync(int flags)
 		BufferDesc *bufHdr = NULL;
 		CkptTsStatus *ts_stat = (CkptTsStatus *)
 		DatumGetPointer(binaryheap_first(ts_heap));
+		int			nprocessed;
 
 		buf_id = CkptBufferIds[ts_stat->index].buf_id;
 		Assert(buf_id != -1);
@@ -2159,9 +2682,46 @@ BufferSync(int flags)
 		 * write the buffer though we didn't need to.  It doesn't seem worth
 		 * guarding against this, though.
 		 */
+		nprocessed = 1;
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+			CkptSortItem *first = &CkptBufferIds[ts_stat->index];
+			int			nbufs = 1;
+
+			/*
+			 * If the following buffers of this tablespace hold the next
+			 * blocks of the same relation fork, try to write them all with
+			 * one I/O operation.  SyncBufferRange checks that the buffers
+			 * really still hold those blocks.
+			 */
+			while (nbufs < io_combine_limit &&
+				   ts_stat->num_scanned + nbufs < ts_stat->num_to_scan)
+			{
+				CkptSortItem *next = &CkptBufferIds[ts_stat->index + nbufs];
+
+				if (next->relNode != first->relNode ||
+					next->forkNum != first->forkNum ||
+					next->blockNum != first->blockNum + nbufs)
+					break;
+				nbufs++;
+			}
+
+			if (nbufs > 1 || io_method != IO_METHOD_SYNC)
+			{
+				int			buf_ids[MAX_IO_COMBINE_LIMIT];
+				int			nwritten;
+
+				for (i = 0; i < nbufs; i++)
+					buf_ids[i] = CkptBufferIds[ts_stat->index + i].buf_id;
+
+				nprocessed = SyncBufferRange(buf_ids, nbufs, &wb_context,
+											 &nwritten);
+				for (i = 0; i < nwritten; i++)
+					TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_ids[i]);
+				PendingCheckpointerStats.buf_written_checkpoints += nwritten;
+				num_written += nwritten;
+			}
+			else if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
 			{
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
 				PendingCheckpointerStats.buf_written_checkpoints++;
@@ -2173,9 +2733,10 @@ BufferSync(int flags)
 		 * Measure progress independent of actually having to flush the buffer
 		 * - otherwise writing become unbalanced.
 		 */
-		ts_stat->progress += ts_stat->progress_slice;
-		ts_stat->num_scanned++;
-		ts_stat->index++;
+		num_processed += nprocessed - 1;
+		ts_stat->progress += ts_stat->progress_slice * nprocessed;
+		ts_stat->num_scanned += nprocessed;
+		ts_stat->index += nprocessed;
 
 		/* Have all the buffers from the tablespace been processed? */
 		if (ts_stat->num_scanned == ts_stat->num_to_scan)
@@ -2189,14 +2750,18 @@ BufferSync(int flags)
 		}
 
 		/*
-		 * Sleep to throttle our I/O rate.
+		 * Sleep to throttle our I/O rate, but not while we're holding a
+		 * batch of buffers locked.  The batch is written out as soon as it's
+		 * full, so this happens often enough.
 		 *
 		 * (This will check for barrier events even if it doesn't sleep.)
 		 */
-		CheckpointWriteDelay(flags, (double) num_processed / num_to_scan);
+		if (NPendingWriteBufs == 0)
+			CheckpointWriteDelay(flags, (double) num_processed / num_to_scan);
 	}
 
-	/* issue all pending flushes */
+	/* write out the last batch, and issue all pending flushes */
+	FlushPendingWrites(&wb_context);
 	IssuePendingWritebacks(&wb_context);
 
 	pfree(per_ts_stat);
@@ -2586,6 +3151,276 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * SyncBufferRange -- write out a range of buffers during a checkpoint, with
+ *		a single I/O operation if possible.
+ *
+ * buf_ids[] holds the checkpoint's candidate buffers for consecutive blocks
+ * of one relation fork, as they were when the checkpoint started.  The first
+ * buffer is handled just like SyncOneBuffer(..., false, ...) would.  The
+ * range is then extended over as many of the following buffers as still
+ * hold the expected blocks and need to be written, and can be share-locked
+ * and marked BM_IO_IN_PROGRESS without waiting.  Waiting while we hold locks
+ * and I/O on other buffers could deadlock against a backend that locks
+ * pages in a different order; stopping short just means that the remaining
+ * buffers are left for the next call.
+ *
+ * The locked range is added to the pending write batch.  With io_method =
+ * sync, the batch is written out right away; otherwise, only once it is
+ * full, or when the caller calls FlushPendingWrites().  While the batch is
+ * not empty, we don't wait for the first buffer either; if it isn't
+ * immediately available, the batch is written out first.
+ *
+ * Returns the number of leading entries of buf_ids[] that were dealt with,
+ * which is at least one, and sets *nwritten to the number of those that
+ * were (or will be) written.
+ */
+static int
+SyncBufferRange(int *buf_ids, int nbufs, WritebackContext *wb_context,
+				int *nwritten)
+{
+	BufferDesc **bufHdrs;
+	PendingWriteRange *range;
+	bool		nowait;
+	int			nlocked;
+
+	Assert(nbufs > 0 && nbufs <= MAX_IO_COMBINE_LIMIT);
+	Assert(NPendingWriteBufs < MAX_IO_BATCH_BUFFERS);
+
+	*nwritten = 0;
+	nbufs = Min(nbufs, MAX_IO_BATCH_BUFFERS - NPendingWriteBufs);
+
+retry:
+	bufHdrs = &PendingWriteBufs[NPendingWriteBufs];
+	nowait = NPendingWriteBufs > 0;
+
+	/* Pin, share-lock, and start output I/O on as many buffers as we can. */
+	for (nlocked = 0; nlocked < nbufs; nlocked++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(buf_ids[nlocked]);
+		uint32		buf_state;
+
+		/*
+		 * Pins taken for earlier ranges of the batch are still held, so
+		 * make room in the resource owner for each pin, including the first.
+		 */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+		ReservePrivateRefCountEntry();
+
+		buf_state = LockBufHdr(bufHdr);
+
+		/* The first buffer is pinned by now, so its tag can't change */
+		if (nlocked > 0 &&
+			(!(buf_state & BM_CHECKPOINT_NEEDED) ||
+			 !RelFileNodeEquals(bufHdr->tag.rnode, bufHdrs[0]->tag.rnode) ||
+			 bufHdr->tag.forkNum != bufHdrs[0]->tag.forkNum ||
+			 bufHdr->tag.blockNum != bufHdrs[0]->tag.blockNum + nlocked))
+		{
+			UnlockBufHdr(bufHdr, buf_state);
+			break;
+		}
+
+		if (!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY))
+		{
+			/* It's clean, so nothing to do */
+			UnlockBufHdr(bufHdr, buf_state);
+			if (nlocked == 0)
+				return 1;
+			break;
+		}
+
+		PinBuffer_Locked(bufHdr);
+
+		if (nlocked == 0 && !nowait)
+			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+		else if (!LWLockConditionalAcquire(BufferDescriptorGetContentLock(bufHdr),
+										   LW_SHARED))
+		{
+			UnpinBuffer(bufHdr, true);
+			if (nlocked == 0)
+			{
+				/* write out the batch, so that we're free to wait */
+				FlushPendingWrites(wb_context);
+				goto retry;
+			}
+			break;
+		}
+
+		/*
+		 * For the first buffer, StartBufferIO returning false means someone
+		 * else flushed it before we could; count it as written, as
+		 * SyncOneBuffer would.  For later ones we don't wait.
+		 */
+		if (!StartBufferIO(bufHdr, false, nlocked > 0 || nowait))
+		{
+			BufferTag	tag = bufHdr->tag;
+
+			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+			UnpinBuffer(bufHdr, true);
+			if (nlocked == 0)
+			{
+				if (nowait)
+				{
+					FlushPendingWrites(wb_context);
+					goto retry;
+				}
+				ScheduleBufferTagForWriteback(wb_context, &tag);
+				*nwritten = 1;
+				return 1;
+			}
+			break;
+		}
+
+		bufHdrs[nlocked] = bufHdr;
+	}
+
+	/*
+	 * We need private copies of the pages to set checksums in, as in
+	 * FlushBuffer.  Only the checkpointer gets here, so keep the space
+	 * around.
+	 */
+	if (PendingWriteCopies == NULL && DataChecksumsEnabled())
+		PendingWriteCopies = MemoryContextAlloc(TopMemoryContext,
+												(Size) MAX_IO_BATCH_BUFFERS * BLCKSZ);
+
+	for (int i = 0; i < nlocked; i++)
+	{
+		BufferDesc *bufHdr = bufHdrs[i];
+		Page		page = (Page) BufHdrGetBlock(bufHdr);
+		int			slot = NPendingWriteBufs + i;
+		XLogRecPtr	recptr;
+		uint32		buf_state;
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_START(bufHdr->tag.forkNum,
+											bufHdr->tag.blockNum,
+											bufHdr->tag.rnode.spcNode,
+											bufHdr->tag.rnode.dbNode,
+											bufHdr->tag.rnode.relNode);
+
+		/* See FlushBuffer */
+		buf_state = LockBufHdr(bufHdr);
+		recptr = BufferGetLSN(bufHdr);
+		buf_state &= ~BM_JUST_DIRTIED;
+		UnlockBufHdr(bufHdr, buf_state);
+
+		if ((buf_state & BM_PERMANENT) && recptr > PendingWriteMaxLSN)
+			PendingWriteMaxLSN = recptr;
+
+		if (PageIsNew(page) || !DataChecksumsEnabled())
+			PendingWritePages[slot] = (char *) page;
+		else
+		{
+			PendingWritePages[slot] = PendingWriteCopies + (Size) slot * BLCKSZ;
+			memcpy(PendingWritePages[slot], page, BLCKSZ);
+			PageSetChecksumInplace((Page) PendingWritePages[slot],
+								   bufHdr->tag.blockNum);
+		}
+	}
+
+	range = &PendingWriteRanges[NPendingWriteRanges++];
+	range->first = NPendingWriteBufs;
+	range->nbufs = nlocked;
+	NPendingWriteBufs += nlocked;
+
+	if (io_method == IO_METHOD_SYNC || NPendingWriteBufs == MAX_IO_BATCH_BUFFERS)
+		FlushPendingWrites(wb_context);
+
+	*nwritten = nlocked;
+	return nlocked;
+}
+
+/*
+ * FlushPendingWrites -- write out the batch prepared by SyncBufferRange()
+ *
+ * All of the ranges are written with one call to smgrperformio(), after a
+ * single WAL flush that covers all of the pages.  Afterwards, the buffers
+ * are marked clean, and unlocked and unpinned.
+ */
+static void
+FlushPendingWrites(WritebackContext *wb_context)
+{
+	SMgrIORequest reqs[MAX_IO_BATCH_BUFFERS];
+	ErrorContextCallback errcallback;
+	instr_time	io_start,
+				io_time;
+
+	if (NPendingWriteBufs == 0)
+		return;
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = shared_buffer_write_error_callback;
+	errcallback.arg = (void *) PendingWriteBufs[0];
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/* One WAL flush covers all the pages */
+	if (!XLogRecPtrIsInvalid(PendingWriteMaxLSN))
+		XLogFlush(PendingWriteMaxLSN);
+
+	for (int i = 0; i < NPendingWriteRanges; i++)
+	{
+		PendingWriteRange *range = &PendingWriteRanges[i];
+		BufferDesc *bufHdr = PendingWriteBufs[range->first];
+
+		reqs[i].reln = smgropen(bufHdr->tag.rnode, InvalidBackendId);
+		reqs[i].forknum = bufHdr->tag.forkNum;
+		reqs[i].blocknum = bufHdr->tag.blockNum;
+		reqs[i].buffers = &PendingWritePages[range->first];
+		reqs[i].nblocks = range->nbufs;
+		reqs[i].is_write = true;
+		reqs[i].skipFsync = false;
+	}
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	if (NPendingWriteRanges == 1)
+		smgrwritev(reqs[0].reln, reqs[0].forknum, reqs[0].blocknum,
+				   reqs[0].buffers, reqs[0].nblocks, false);
+	else
+		smgrperformio(reqs, NPendingWriteRanges);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+	}
+
+	pgBufferUsage.shared_blks_written += NPendingWriteBufs;
+
+	for (int i = 0; i < NPendingWriteBufs; i++)
+	{
+		BufferDesc *bufHdr = PendingWriteBufs[i];
+		BufferTag	tag = bufHdr->tag;
+
+		/*
+		 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set)
+		 * and end the BM_IO_IN_PROGRESS state.
+		 */
+		TerminateBufferIO(bufHdr, true, 0);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(tag.forkNum,
+										   tag.blockNum,
+										   tag.rnode.spcNode,
+										   tag.rnode.dbNode,
+										   tag.rnode.relNode);
+
+		LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+		UnpinBuffer(bufHdr, true);
+
+		ScheduleBufferTagForWriteback(wb_context, &tag);
+	}
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	NPendingWriteBufs = 0;
+	NPendingWriteRanges = 0;
+	PendingWriteMaxLSN = InvalidXLogRecPtr;
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2629,6 +3464,8 @@ InitBufferPoolAccess(void)
 	 */
 	Assert(MyProc != NULL);
 	on_shmem_exit(AtProcExit_Buffers, 0);
+
+	StrategyInitAccess();
 }
 
 /*
@@ -2837,7 +3674,7 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	 * someone else flushed the buffer before we could, so we need not do
 	 * anything.
 	 */
-	if (!StartBufferIO(buf, false))
+	if (!StartBufferIO(buf, false, false))
 		return;
 
 	/* Setup error traceback support for ereport() */
@@ -4493,8 +5330,11 @@ IsBufferCleanupOK(Buffer buffer)
 /*
  *	Functions for buffer I/O handling
  *
- *	Note: We assume that nested buffer I/O never occurs.
- *	i.e at most one BM_IO_IN_PROGRESS bit is set per proc.
+ *	Note: A backend can have BM_IO_IN_PROGRESS set on several buffers at once,
+ *	when it reads or writes a range of consecutive blocks with one operation.
+ *	To avoid deadlocks, a backend holding I/O on some buffers may only wait
+ *	for another backend's I/O on a later block of the same relation fork;
+ *	see ReadBuffers() and BufferSync().
  *
  *	Also note that these are used only for shared buffers, not local ones.
  */
@@ -4530,27 +5370,28 @@ WaitIO(BufferDesc *buf)
 /*
  * StartBufferIO: begin I/O on this buffer
  *	(Assumptions)
- *	My process is executing no IO
+ *	My process is not already executing IO on this buffer
  *	The buffer is Pinned
  *
  * In some scenarios there are race conditions in which multiple backends
  * could attempt the same I/O operation concurrently.  If someone else
  * has already started I/O on this buffer then we will block on the
- * I/O condition variable until he's done.
+ * I/O condition variable until he's done, unless nowait is true, in which
+ * case we return false immediately.
  *
  * Input operations are only attempted on buffers that are not BM_VALID,
  * and output operations only on buffers that are BM_VALID and BM_DIRTY,
  * so we can always tell if the work is already done.
  *
  * Returns true if we successfully marked the buffer as I/O busy,
- * false if someone else already did the work.
+ * false if someone else already did the work or, with nowait, is doing it.
  */
 static bool
-StartBufferIO(BufferDesc *buf, bool forInput)
+StartBufferIO(BufferDesc *buf, bool forInput, bool nowait)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NInProgressBufs < MAX_IN_PROGRESS_BUFS);
 
 	for (;;)
 	{
@@ -4559,6 +5400,8 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 		if (!(buf_state & BM_IO_IN_PROGRESS))
 			break;
 		UnlockBufHdr(buf, buf_state);
+		if (nowait)
+			return false;
 		WaitIO(buf);
 	}
 
@@ -4574,8 +5417,9 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
-	IsForInput = forInput;
+	InProgressBufs[NInProgressBufs] = buf;
+	InProgressIsForInput[NInProgressBufs] = forInput;
+	NInProgressBufs++;
 
 	return true;
 }
@@ -4600,8 +5444,18 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	/* Forget the buffer, moving the last entry into its slot */
+	for (i = 0; i < NInProgressBufs; i++)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i < NInProgressBufs);
+	NInProgressBufs--;
+	InProgressBufs[i] = InProgressBufs[NInProgressBufs];
+	InProgressIsForInput[i] = InProgressIsForInput[NInProgressBufs];
 
 	buf_state = LockBufHdr(buf);
 
@@ -4614,8 +5468,6 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
-
 	ConditionVariableBroadcast(BufferDescriptorGetIOCV(buf));
 }
 
@@ -4625,21 +5477,21 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
  *	All LWLocks we might have held have been released,
  *	but we haven't yet released buffer pins, so the buffer is still pinned.
  *
- *	If I/O was in progress, we always set BM_IO_ERROR, even though it's
- *	possible the error condition wasn't related to the I/O.
+ *	If I/O was in progress on any buffers, we always set BM_IO_ERROR, even
+ *	though it's possible the error condition wasn't related to the I/O.
  */
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	/* TerminateBufferIO removes each buffer from the array in turn */
+	while (NInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NInProgressBufs - 1];
 		uint32		buf_state;
 
 		buf_state = LockBufHdr(buf);
 		Assert(buf_state & BM_IO_IN_PROGRESS);
-		if (IsForInput)
+		if (InProgressIsForInput[NInProgressBufs - 1])
 		{
 			Assert(!(buf_state & BM_DIRTY));
 
@@ -15,54 +15,113 @@
  */
 #include "postgres.h"
 
+#include "funcapi.h"
 #include "port/atomics.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/ipc.h"
 #include "storage/proc.h"
+#include "utils/builtins.h"
+#include "utils/timestamp.h"
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/*
+ * Maximum number of clock positions a backend claims at once; see
+ * ClockSweepTick().
+ */
+#define CLOCK_SWEEP_BATCH_MAX	16
+
+/*
+ * Number of buffer allocations after which a backend adds its counts to the
+ * shared pg_stat_buffer_strategy statistics.
+ */
+#define STRATEGY_STATS_FLUSH_ALLOCS	16
+
+/*
+ * The head of the freelist packs the id of the first free buffer (or
+ * FREENEXT_END_OF_LIST) into the low 32 bits, and a counter that is
+ * incremented by every push and pop into the high 32 bits.  The counter
+ * ensures that a compare-and-exchange based on an outdated head fails even if
+ * the same buffer has been popped and pushed back meanwhile (the ABA
+ * problem).
+ */
+#define FreeListHeadMake(count, buf_id) \
+	(((uint64) (count) << 32) | (uint32) (buf_id))
+#define FreeListHeadGetBuffer(head)	((int) (uint32) (head))
+#define FreeListHeadGetCount(head)	((uint32) ((head) >> 32))
 
 /*
  * The shared freelist control information.
  */
 typedef struct
 {
-	/* Spinlock: protects the values below */
+	/* Spinlock: protects completePasses and bgwprocno */
 	slock_t		buffer_strategy_lock;
 
-	/*
-	 * Clock sweep hand: index of next buffer to consider grabbing. Note that
-	 * this isn't a concrete buffer - we only ever increase the value. So, to
-	 * get an actual buffer, it needs to be used modulo NBuffers.
-	 */
-	pg_atomic_uint32 nextVictimBuffer;
-
-	int			firstFreeBuffer;	/* Head of list of unused buffers */
-	int			lastFreeBuffer; /* Tail of list of unused buffers */
-
-	/*
-	 * NOTE: lastFreeBuffer is undefined when firstFreeBuffer is -1 (that is,
-	 * when the list is empty)
-	 */
-
 	/*
 	 * Statistics.  These counters should be wide enough that they can't
 	 * overflow during a single bgwriter cycle.
 	 */
 	uint32		completePasses; /* Complete cycles of the clock sweep */
-	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
 
 	/*
 	 * Bgworker process to be notified upon activity or -1 if none. See
 	 * StrategyNotifyBgWriter.
 	 */
 	int			bgwprocno;
+
+	/*
+	 * The clock hand and the freelist head are updated by every buffer
+	 * allocation in the system, so keep each on a cache line of its own.
+	 */
+	char		pad1[PG_CACHE_LINE_SIZE];
+
+	/*
+	 * Clock sweep hand: index of next buffer to consider grabbing. Note that
+	 * this isn't a concrete buffer - we only ever increase the value. So, to
+	 * get an actual buffer, it needs to be used modulo NBuffers.
+	 */
+	pg_atomic_uint32 nextVictimBuffer;
+
+	char		pad2[PG_CACHE_LINE_SIZE];
+
+	/* Head of list of unused buffers, linked through freeNext */
+	pg_atomic_uint64 freeListHead;
+
+	char		pad3[PG_CACHE_LINE_SIZE];
+
+	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
+
+	/* Cumulative statistics, for pg_stat_buffer_strategy */
+	pg_atomic_uint64 statsResetTime;
+	pg_atomic_uint64 freelistAllocs;	/* allocations from the freelist */
+	pg_atomic_uint64 clockSweepAllocs;	/* allocations by the clock sweep */
+	pg_atomic_uint64 buffersScanned;	/* buffers examined by the sweep */
+	pg_atomic_uint32 maxSweepDistance;	/* most examined for one allocation */
 } BufferStrategyControl;
 
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
 
+/*
+ * Clock positions claimed by this backend that it has not examined yet, from
+ * MyClockSweepNext up to MyClockSweepEnd.  Like nextVictimBuffer, these have
+ * not been reduced modulo NBuffers.
+ */
+static uint32 MyClockSweepNext = 0;
+static uint32 MyClockSweepEnd = 0;
+
+/*
+ * Allocation statistics not yet added to StrategyControl.  numBufferAllocs,
+ * which the bgwriter relies on, is kept up to date instead.
+ */
+static uint32 PendingAllocs = 0;
+static uint32 PendingFreelistAllocs = 0;
+static uint32 PendingClockSweepAllocs = 0;
+static uint64 PendingBuffersScanned = 0;
+static uint32 PendingMaxSweepDistance = 0;
+
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
  * This is currently the only kind of BufferAccessStrategy object, but someday
@@ -103,69 +162,161 @@ static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 static void AddBufferToRing(BufferAccessStrategy strategy,
 							BufferDesc *buf);
 
+/*
+ * ClockSweepClaimBatch - Helper routine for ClockSweepTick()
+ *
+ * Claim the next batch of clock positions for this backend.
+ */
+static void
+ClockSweepClaimBatch(void)
+{
+	uint32		batch;
+	uint32		start;
+	uint32		end;
+
+	/* Don't let backends hold back more than a small part of the pool. */
+	batch = Max(1, Min(CLOCK_SWEEP_BATCH_MAX, NBuffers / 1024));
+
+	/*
+	 * Atomically move hand ahead by a whole batch - if there's several
+	 * processes doing this, this can lead to buffers being returned slightly
+	 * out of apparent order.
+	 */
+	start = pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, batch);
+	end = start + batch;
+
+	/*
+	 * If our batch includes a position that is a positive multiple of
+	 * NBuffers, we're the one that just caused a wraparound, so force
+	 * completePasses to be incremented while holding the spinlock. We need
+	 * the spinlock so StrategySyncStart() can return a consistent value
+	 * consisting of nextVictimBuffer and completePasses.
+	 */
+	if (start > 0 && (end - 1) / NBuffers != (start - 1) / NBuffers)
+	{
+		uint32		expected;
+		uint32		wrapped;
+		bool		success = false;
+
+		expected = end;
+
+		while (!success)
+		{
+			/*
+			 * Acquire the spinlock while increasing completePasses. That
+			 * allows other readers to read nextVictimBuffer and
+			 * completePasses in a consistent manner which is required for
+			 * StrategySyncStart().  In theory delaying the increment could
+			 * lead to an overflow of nextVictimBuffers, but that's highly
+			 * unlikely and wouldn't be particularly harmful.
+			 */
+			SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+
+			wrapped = expected % NBuffers;
+
+			success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+													 &expected, wrapped);
+			if (success)
+				StrategyControl->completePasses++;
+			SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+		}
+	}
+
+	MyClockSweepNext = start;
+	MyClockSweepEnd = end;
+}
+
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
  * Move the clock hand one buffer ahead of its current position and return the
  * id of the buffer now under the hand.
+ *
+ * To keep backends from fighting over the cache line holding the shared clock
+ * hand, each backend claims a batch of consecutive positions at a time and
+ * then steps through them privately.  Positions claimed by a backend that
+ * stops allocating are simply skipped for that pass of the clock.
  */
 static inline uint32
 ClockSweepTick(void)
 {
-	uint32		victim;
+	if (MyClockSweepNext == MyClockSweepEnd)
+		ClockSweepClaimBatch();
 
-	/*
-	 * Atomically move hand ahead one buffer - if there's several processes
-	 * doing this, this can lead to buffers being returned slightly out of
-	 * apparent order.
-	 */
-	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+	/* always wrap what we look up in BufferDescriptors */
+	return MyClockSweepNext++ % NBuffers;
+}
+
+/*
+ * StrategyFlushStats - add this backend's allocation counts to the shared
+ *		statistics
+ */
+static void
+StrategyFlushStats(void)
+{
+	uint32		max;
 
-	if (victim >= NBuffers)
+	pg_atomic_fetch_add_u64(&StrategyControl->freelistAllocs,
+							PendingFreelistAllocs);
+	pg_atomic_fetch_add_u64(&StrategyControl->clockSweepAllocs,
+							PendingClockSweepAllocs);
+	pg_atomic_fetch_add_u64(&StrategyControl->buffersScanned,
+							PendingBuffersScanned);
+
+	max = pg_atomic_read_u32(&StrategyControl->maxSweepDistance);
+	while (PendingMaxSweepDistance > max)
 	{
-		uint32		originalVictim = victim;
+		if (pg_atomic_compare_exchange_u32(&StrategyControl->maxSweepDistance,
+										   &max, PendingMaxSweepDistance))
+			break;
+	}
 
-		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+	PendingAllocs = 0;
+	PendingFreelistAllocs = 0;
+	PendingClockSweepAllocs = 0;
+	PendingBuffersScanned = 0;
+	PendingMaxSweepDistance = 0;
 
-		/*
-		 * If we're the one that just caused a wraparound, force
-		 * completePasses to be incremented while holding the spinlock. We
-		 * need the spinlock so StrategySyncStart() can return a consistent
-		 * value consisting of nextVictimBuffer and completePasses.
-		 */
-		if (victim == 0)
-		{
-			uint32		expected;
-			uint32		wrapped;
-			bool		success = false;
+	if (BufferNumaStripe > 0)
+		BufferNumaFlushStats();
+}
+
+/*
+ * StrategyAtExit - flush the statistics at backend exit
+ */
+static void
+StrategyAtExit(int code, Datum arg)
+{
+	if (PendingAllocs > 0)
+		StrategyFlushStats();
+}
 
-			expected = originalVictim + 1;
+/*
+ * StrategyCountAlloc - count a buffer allocation
+ *
+ * distance is the number of buffers the clock sweep (or the search of the
+ * local NUMA stripe) examined to find it, or zero if it came from the
+ * freelist.  To avoid more traffic on shared cache lines, counts are
+ * accumulated locally, and StrategyGetBuffer() adds them to the shared
+ * counters every STRATEGY_STATS_FLUSH_ALLOCS allocations, as does
+ * StrategyAtExit() with what's left at backend exit.  This is called with the
+ * buffer header spinlock held, so it had better be cheap.
+ */
+static inline void
+StrategyCountAlloc(BufferDesc *buf, uint32 distance)
+{
+	if (BufferNumaStripe > 0)
+		BufferNumaCountAlloc(buf->buf_id);
 
-			while (!success)
-			{
-				/*
-				 * Acquire the spinlock while increasing completePasses. That
-				 * allows other readers to read nextVictimBuffer and
-				 * completePasses in a consistent manner which is required for
-				 * StrategySyncStart().  In theory delaying the increment
-				 * could lead to an overflow of nextVictimBuffers, but that's
-				 * highly unlikely and wouldn't be particularly harmful.
-				 */
-				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-
-				wrapped = expected % NBuffers;
-
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
-														 &expected, wrapped);
-				if (success)
-					StrategyControl->completePasses++;
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
-			}
-		}
+	PendingAllocs++;
+	if (distance == 0)
+		PendingFreelistAllocs++;
+	else
+	{
+		PendingClockSweepAllocs++;
+		PendingBuffersScanned += distance;
+		PendingMaxSweepDistance = Max(PendingMaxSweepDistance, distance);
 	}
-	return victim;
 }
 
 /*
@@ -179,7 +330,9 @@ ClockSweepTick(void)
 bool
 have_free_buffer(void)
 {
-	if (StrategyControl->firstFreeBuffer >= 0)
+	uint64		head = pg_atomic_read_u64(&StrategyControl->freeListHead);
+
+	if (FreeListHeadGetBuffer(head) >= 0)
 		return true;
 	else
 		return false;
@@ -203,7 +356,9 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	BufferDesc *buf;
 	int			bgwprocno;
 	int			trycounter;
+	uint32		distance;
 	uint32		local_buf_state;	/* to avoid repeated (de-)referencing */
+	uint64		head;
 
 	/*
 	 * If given a strategy object, see whether it can select a buffer. We
@@ -249,73 +404,106 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	 */
 	pg_atomic_fetch_add_u32(&StrategyControl->numBufferAllocs, 1);
 
+	/* Add the last batch of our counts to pg_stat_buffer_strategy */
+	if (PendingAllocs >= STRATEGY_STATS_FLUSH_ALLOCS)
+		StrategyFlushStats();
+
 	/*
-	 * First check, without acquiring the lock, whether there's buffers in the
-	 * freelist. Since we otherwise don't require the spinlock in every
-	 * StrategyGetBuffer() invocation, it'd be sad to acquire it here -
-	 * uselessly in most cases. That obviously leaves a race where a buffer is
-	 * put on the freelist but we don't see the store yet - but that's pretty
-	 * harmless, it'll just get used during the next buffer acquisition.
-	 *
-	 * If there's buffers on the freelist, acquire the spinlock to pop one
-	 * buffer of the freelist. Then check whether that buffer is usable and
-	 * repeat if not.
+	 * Try to pop a buffer off the freelist, without any lock.  Then check
+	 * whether that buffer is usable and repeat if not.
 	 *
-	 * Note that the freeNext fields are considered to be protected by the
-	 * buffer_strategy_lock not the individual buffer spinlocks, so it's OK to
-	 * manipulate them without holding the spinlock.
+	 * The link to the next buffer is read from the candidate's freeNext
+	 * before the compare-and-exchange, and might be stale by then; but in
+	 * that case the head has changed too, and the exchange fails.  Once the
+	 * buffer is off the list, we mark it so under its header spinlock, which
+	 * StrategyFreeBuffer() also holds while checking whether a buffer is
+	 * already in the list.
 	 */
-	if (StrategyControl->firstFreeBuffer >= 0)
+	head = pg_atomic_read_u64(&StrategyControl->freeListHead);
+	while (FreeListHeadGetBuffer(head) >= 0)
 	{
-		while (true)
+		int			next;
+
+		buf = GetBufferDescriptor(FreeListHeadGetBuffer(head));
+
+		/* read freeNext only after the head that pointed us to it */
+		pg_read_barrier();
+		next = INT_ACCESS_ONCE(buf->freeNext);
+
+		if (!pg_atomic_compare_exchange_u64(&StrategyControl->freeListHead,
+											&head,
+											FreeListHeadMake(FreeListHeadGetCount(head) + 1,
+															 next)))
+			continue;			/* head was updated, retry with it */
+
+		/*
+		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
+		 * it; discard it and retry.  (This can only happen if VACUUM put a
+		 * valid buffer in the freelist and then someone else used it before
+		 * we got to it.  It's probably impossible altogether as of 8.3, but
+		 * we'd better check anyway.)
+		 */
+		local_buf_state = LockBufHdr(buf);
+		buf->freeNext = FREENEXT_NOT_IN_LIST;
+		if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0
+			&& BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0)
 		{
-			/* Acquire the spinlock to remove element from the freelist */
-			SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+			if (strategy != NULL)
+				AddBufferToRing(strategy, buf);
+			*buf_state = local_buf_state;
+			StrategyCountAlloc(buf, 0);
+			return buf;
+		}
+		UnlockBufHdr(buf, local_buf_state);
 
-			if (StrategyControl->firstFreeBuffer < 0)
-			{
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
-				break;
-			}
+		head = pg_atomic_read_u64(&StrategyControl->freeListHead);
+	}
 
-			buf = GetBufferDescriptor(StrategyControl->firstFreeBuffer);
-			Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
+	/*
+	 * Nothing on the freelist.  If the buffer pool is striped over NUMA
+	 * nodes, first look for a buffer we can take right away in the stripe of
+	 * the node we're running on.  We don't decrement usage counts here, but
+	 * leave the aging of buffers to the clock sweep, so that buffers on all
+	 * nodes age at the same rate.
+	 */
+	if (BufferNumaStripe > 0)
+	{
+		int			buf_ids[BUFFER_NUMA_LOCAL_BATCH];
+		int			n;
+		int			i;
 
-			/* Unconditionally remove buffer from freelist */
-			StrategyControl->firstFreeBuffer = buf->freeNext;
-			buf->freeNext = FREENEXT_NOT_IN_LIST;
+		n = BufferNumaLocalCandidates(buf_ids);
+		for (i = 0; i < n; i++)
+		{
+			buf = GetBufferDescriptor(buf_ids[i]);
 
-			/*
-			 * Release the lock so someone else can access the freelist while
-			 * we check out this buffer.
-			 */
-			SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+			/* Check without the spinlock first, to skip busy buffers cheaply */
+			local_buf_state = pg_atomic_read_u32(&buf->state);
+			if (BUF_STATE_GET_REFCOUNT(local_buf_state) != 0 ||
+				BUF_STATE_GET_USAGECOUNT(local_buf_state) != 0)
+				continue;
 
-			/*
-			 * If the buffer is pinned or has a nonzero usage_count, we cannot
-			 * use it; discard it and retry.  (This can only happen if VACUUM
-			 * put a valid buffer in the freelist and then someone else used
-			 * it before we got to it.  It's probably impossible altogether as
-			 * of 8.3, but we'd better check anyway.)
-			 */
 			local_buf_state = LockBufHdr(buf);
-			if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0
-				&& BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0)
+			if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0 &&
+				BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0)
 			{
 				if (strategy != NULL)
 					AddBufferToRing(strategy, buf);
 				*buf_state = local_buf_state;
+				StrategyCountAlloc(buf, i + 1);
 				return buf;
 			}
 			UnlockBufHdr(buf, local_buf_state);
 		}
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
+	/* Otherwise run the "clock sweep" algorithm */
 	trycounter = NBuffers;
+	distance = 0;
 	for (;;)
 	{
 		buf = GetBufferDescriptor(ClockSweepTick());
+		distance++;
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
@@ -337,6 +525,7 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 				if (strategy != NULL)
 					AddBufferToRing(strategy, buf);
 				*buf_state = local_buf_state;
+				StrategyCountAlloc(buf, distance);
 				return buf;
 			}
 		}
@@ -362,21 +551,36 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 void
 StrategyFreeBuffer(BufferDesc *buf)
 {
-	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+	uint32		buf_state;
+	uint64		head;
 
 	/*
 	 * It is possible that we are told to put something in the freelist that
-	 * is already in it; don't screw up the list if so.
+	 * is already in it; don't screw up the list if so.  Checking and claiming
+	 * freeNext under the buffer header spinlock makes sure that only one
+	 * process pushes the buffer.
 	 */
-	if (buf->freeNext == FREENEXT_NOT_IN_LIST)
+	buf_state = LockBufHdr(buf);
+	if (buf->freeNext != FREENEXT_NOT_IN_LIST)
 	{
-		buf->freeNext = StrategyControl->firstFreeBuffer;
-		if (buf->freeNext < 0)
-			StrategyControl->lastFreeBuffer = buf->buf_id;
-		StrategyControl->firstFreeBuffer = buf->buf_id;
+		UnlockBufHdr(buf, buf_state);
+		return;
 	}
+	buf->freeNext = FREENEXT_END_OF_LIST;
+	UnlockBufHdr(buf, buf_state);
 
-	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+	/*
+	 * Push it.  The compare-and-exchange is a full barrier, so the link is
+	 * visible to anyone who sees the new head.
+	 */
+	head = pg_atomic_read_u64(&StrategyControl->freeListHead);
+	do
+	{
+		buf->freeNext = FreeListHeadGetBuffer(head);
+	} while (!pg_atomic_compare_exchange_u64(&StrategyControl->freeListHead,
+											 &head,
+											 FreeListHeadMake(FreeListHeadGetCount(head) + 1,
+															  buf->buf_id)));
 }
 
 /*
@@ -454,8 +658,8 @@ StrategyShmemSize(void)
 {
 	Size		size = 0;
 
-	/* size of lookup hash table ... see comment in StrategyInitialize */
-	size = add_size(size, BufTableShmemSize(NBuffers + NUM_BUFFER_PARTITIONS));
+	/* size of lookup hash table */
+	size = add_size(size, BufTableShmemSize());
 
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
@@ -477,15 +681,8 @@ StrategyInitialize(bool init)
 
 	/*
 	 * Initialize the shared buffer lookup hashtable.
-	 *
-	 * Since we can't tolerate running out of lookup table entries, we must be
-	 * sure to specify an adequate table size here.  The maximum steady-state
-	 * usage is of course NBuffers entries, but BufferAlloc() tries to insert
-	 * a new entry before deleting the old.  In principle this could be
-	 * happening in each partition concurrently, so we could need as many as
-	 * NBuffers + NUM_BUFFER_PARTITIONS entries.
 	 */
-	InitBufTable(NBuffers + NUM_BUFFER_PARTITIONS);
+	InitBufTable();
 
 	/*
 	 * Get or create the shared strategy control block
@@ -508,8 +705,8 @@ StrategyInitialize(bool init)
 		 * Grab the whole linked list of free buffers for our strategy. We
 		 * assume it was previously set up by InitBufferPool().
 		 */
-		StrategyControl->firstFreeBuffer = 0;
-		StrategyControl->lastFreeBuffer = NBuffers - 1;
+		pg_atomic_init_u64(&StrategyControl->freeListHead,
+						   FreeListHeadMake(0, 0));
 
 		/* Initialize the clock sweep pointer */
 		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
@@ -517,6 +714,12 @@ StrategyInitialize(bool init)
 		/* Clear statistics */
 		StrategyControl->completePasses = 0;
 		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
+		pg_atomic_init_u64(&StrategyControl->statsResetTime,
+						   GetCurrentTimestamp());
+		pg_atomic_init_u64(&StrategyControl->freelistAllocs, 0);
+		pg_atomic_init_u64(&StrategyControl->clockSweepAllocs, 0);
+		pg_atomic_init_u64(&StrategyControl->buffersScanned, 0);
+		pg_atomic_init_u32(&StrategyControl->maxSweepDistance, 0);
 
 		/* No pending notification */
 		StrategyControl->bgwprocno = -1;
@@ -525,6 +728,77 @@ StrategyInitialize(bool init)
 		Assert(!init);
 }
 
+/*
+ * StrategyInitAccess -- initialize a backend's use of the strategy
+ *
+ * Make sure that the statistics it hasn't flushed yet are not lost when the
+ * backend exits.
+ */
+void
+StrategyInitAccess(void)
+{
+	before_shmem_exit(StrategyAtExit, 0);
+}
+
+
+/*
+ * StrategyResetStats -- reset the counters shown in pg_stat_buffer_strategy
+ *
+ * Counts that other backends haven't added to the shared counters yet will
+ * still show up after the reset.
+ */
+void
+StrategyResetStats(void)
+{
+	pg_atomic_write_u64(&StrategyControl->statsResetTime, GetCurrentTimestamp());
+	pg_atomic_write_u64(&StrategyControl->freelistAllocs, 0);
+	pg_atomic_write_u64(&StrategyControl->clockSweepAllocs, 0);
+	pg_atomic_write_u64(&StrategyControl->buffersScanned, 0);
+	pg_atomic_write_u32(&StrategyControl->maxSweepDistance, 0);
+
+	if (BufferNumaStripe > 0)
+		BufferNumaResetStats();
+}
+
+/*
+ * Report the buffer replacement statistics, for pg_stat_buffer_strategy.
+ */
+Datum
+pg_stat_get_buffer_strategy(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_BUFFER_STRATEGY_COLS 6
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Datum		values[PG_STAT_GET_BUFFER_STRATEGY_COLS];
+	bool		nulls[PG_STAT_GET_BUFFER_STRATEGY_COLS];
+	uint64		clock_sweep_allocs;
+	uint64		buffers_scanned;
+
+	SetSingleFuncCall(fcinfo, 0);
+
+	/* Include our own pending counts, so that our activity is visible */
+	if (PendingAllocs > 0)
+		StrategyFlushStats();
+
+	for (int i = 0; i < PG_STAT_GET_BUFFER_STRATEGY_COLS; ++i)
+		nulls[i] = false;
+
+	clock_sweep_allocs = pg_atomic_read_u64(&StrategyControl->clockSweepAllocs);
+	buffers_scanned = pg_atomic_read_u64(&StrategyControl->buffersScanned);
+
+	values[0] = Int64GetDatum(pg_atomic_read_u64(&StrategyControl->freelistAllocs));
+	values[1] = Int64GetDatum(clock_sweep_allocs);
+	values[2] = Int64GetDatum(buffers_scanned);
+	if (clock_sweep_allocs > 0)
+		values[3] = Float8GetDatum((double) buffers_scanned / clock_sweep_allocs);
+	else
+		nulls[3] = true;
+	values[4] = Int64GetDatum(pg_atomic_read_u32(&StrategyControl->maxSweepDistance));
+	values[5] = TimestampTzGetDatum(pg_atomic_read_u64(&StrategyControl->statsResetTime));
+	tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+
+	return (Datum) 0;
+}
+
 
 /* ----------------------------------------------------------------
  *				Backend-private buffer ring management
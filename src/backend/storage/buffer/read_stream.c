@@ -0,0 +1,404 @@
+/*-------------------------------------------------------------------------
+ *
+ * read_stream.c
+ *	  Mechanism for accessing buffered relation data with look-ahead
+ *
+ * Code that needs to access relation data typically pins blocks one at a
+ * time, often in a predictable order that might be sequential or data-driven.
+ * Calling the simple ReadBuffer() function for each block is inefficient,
+ * because blocks that are not yet in the buffer pool require I/O operations
+ * that are small and might stall waiting for storage.  This mechanism looks
+ * into the future and calls PrefetchBuffer() for upcoming blocks, so that the
+ * kernel can start reading them before they are needed.
+ *
+ * A client of the read stream API supplies a callback that returns the block
+ * numbers it wants, and then repeatedly calls read_stream_next_buffer() to
+ * obtain the corresponding pinned buffers, in the same order.  The callback
+ * may also fill in a small amount of per-buffer data, which is handed back to
+ * the consumer along with the buffer.
+ *
+ * When the block at the head of the queue is not yet pinned, it is read
+ * together with the queued blocks that directly follow it on disk, up to
+ * io_combine_limit blocks, using a single ReadBuffers() call.  The buffers
+ * for the later blocks stay pinned in the queue until the consumer gets to
+ * them.  With io_method = io_uring, the rest of the queue is divided into
+ * such ranges too, and all of them are read as one batch, with
+ * StartReadBuffers() and WaitReadBuffers(); prefetch advice is then
+ * unnecessary, and the look-ahead distance is scaled up so that a batch can
+ * hold several full-sized ranges.  Either way, LimitAdditionalPins() decides
+ * how many buffers we may pin at once.
+ *
+ * The look-ahead distance adapts to the observed access pattern: it doubles
+ * each time I/O was needed, and decays by one each time the blocks turned
+ * out to be in the buffer pool already, so that fully cached scans don't pay
+ * for useless advice or pins.  With prefetching, that is judged by the
+ * PrefetchBuffer() result of each upcoming block; otherwise by whether
+ * ReadBuffers() had to read.  The maximum distance is the larger of
+ * io_combine_limit and effective_io_concurrency or
+ * maintenance_io_concurrency, as set for the relation's tablespace.  If the
+ * latter is zero, or the platform has no support for prefetching, no advice
+ * is issued, but sequential blocks are still combined into larger reads.
+ *
+ * The queue of look-ahead block numbers is a circular buffer with one more
+ * slot than the maximum distance, so that the slot holding the per-buffer
+ * data of the buffer most recently returned to the consumer is not
+ * overwritten until the following call.
+ *
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/read_stream.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/catalog.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/read_stream.h"
+#include "utils/rel.h"
+#include "utils/spccache.h"
+
+struct ReadStream
+{
+	Relation	rel;
+	ForkNumber	forknum;
+	BufferAccessStrategy strategy;
+
+	int16		max_distance;	/* maximum look-ahead, in blocks */
+	int16		distance;		/* current look-ahead, in blocks */
+	int16		queue_size;		/* number of slots in the circular queue */
+	int16		nqueued;		/* number of blocks currently queued */
+	int16		oldest;			/* index of the oldest queued block */
+	bool		advice_enabled; /* issue PrefetchBuffer() calls? */
+	bool		batch_io;		/* read the whole queue as a batch? */
+	bool		exhausted;		/* has the callback reported end? */
+
+	ReadStreamBlockNumberCB callback;
+	void	   *callback_private_data;
+
+	/* per_buffer_data_size bytes for each queue slot, or NULL */
+	size_t		per_buffer_data_size;
+	char	   *per_buffer_data;
+
+	/*
+	 * Buffers already pinned for queued blocks, or InvalidBuffer.  Only a
+	 * prefix of the queue can be pinned, since buffers are pinned by reading
+	 * ranges starting at the head.
+	 */
+	Buffer	   *buffers;
+
+	/* circular queue of block numbers, queue_size entries */
+	BlockNumber blocknums[FLEXIBLE_ARRAY_MEMBER];
+};
+
+static inline void *
+get_per_buffer_data(ReadStream *stream, int16 index)
+{
+	return stream->per_buffer_data + stream->per_buffer_data_size * index;
+}
+
+/*
+ * Ask the callback for blocks until the queue holds "distance" blocks or the
+ * callback reports the end of the stream, issuing prefetch advice for each.
+ */
+static void
+read_stream_look_ahead(ReadStream *stream)
+{
+	while (!stream->exhausted && stream->nqueued < stream->distance)
+	{
+		int16		index;
+		BlockNumber blocknum;
+
+		index = stream->oldest + stream->nqueued;
+		if (index >= stream->queue_size)
+			index -= stream->queue_size;
+
+		blocknum = stream->callback(stream,
+									stream->callback_private_data,
+									stream->per_buffer_data ?
+									get_per_buffer_data(stream, index) : NULL);
+		if (blocknum == InvalidBlockNumber)
+		{
+			stream->exhausted = true;
+			break;
+		}
+
+		stream->blocknums[index] = blocknum;
+		stream->nqueued++;
+
+		if (stream->advice_enabled)
+		{
+			PrefetchBufferResult result;
+
+			result = PrefetchBuffer(stream->rel, stream->forknum, blocknum);
+
+			/*
+			 * Look further ahead while we keep finding blocks that need I/O,
+			 * and pull back while everything we see is already cached.
+			 */
+			if (result.initiated_io)
+				stream->distance = Min(stream->distance * 2,
+									   stream->max_distance);
+			else if (stream->distance > 1)
+				stream->distance--;
+		}
+	}
+}
+
+/*
+ * Pin the block at the head of the queue, along with as many of the queued
+ * blocks that follow it consecutively as ReadBuffers() is willing to read
+ * together with it.  With batch_io, continue with further ranges until the
+ * queue is exhausted or a batch is full, and read them all together.
+ */
+static void
+read_stream_read_range(ReadStream *stream)
+{
+	ReadBuffersOperation operations[MAX_IO_BATCH_BUFFERS];
+	Buffer		buffers[MAX_IO_BATCH_BUFFERS];
+	int			noperations = 0;
+	int			nbuffers = 0;
+	int16		head = stream->oldest;
+	int16		nremaining = stream->nqueued;
+	bool		did_io = false;
+	uint32		max_pins;
+
+	/*
+	 * The buffers stay pinned until the consumer gets to them, so don't take
+	 * more than our share of the buffer pool, for a single range or for a
+	 * whole batch.
+	 */
+	max_pins = stream->batch_io ? MAX_IO_BATCH_BUFFERS : io_combine_limit;
+	LimitAdditionalPins(&max_pins);
+
+	while (nremaining > 0)
+	{
+		BlockNumber blocknum = stream->blocknums[head];
+		int16		index = head;
+		int			nblocks = 1;
+		int			limit;
+
+		Assert(stream->buffers[head] == InvalidBuffer);
+
+		limit = Min(io_combine_limit, max_pins - nbuffers);
+		while (nblocks < nremaining && nblocks < limit)
+		{
+			if (++index == stream->queue_size)
+				index = 0;
+			if (stream->blocknums[index] != blocknum + nblocks)
+				break;
+			nblocks++;
+		}
+
+		if (StartReadBuffers(&operations[noperations],
+							 stream->rel, stream->forknum, blocknum, &nblocks,
+							 stream->strategy, &buffers[nbuffers]))
+		{
+			noperations++;
+			did_io = true;
+		}
+
+		/* A range after the first might come back empty; see bufmgr.c. */
+		if (nblocks == 0)
+			break;
+
+		for (int i = 0; i < nblocks; i++)
+		{
+			stream->buffers[head] = buffers[nbuffers++];
+			if (++head == stream->queue_size)
+				head = 0;
+		}
+		nremaining -= nblocks;
+
+		if (!stream->batch_io || nbuffers == max_pins)
+			break;
+	}
+
+	if (noperations > 0)
+		WaitReadBuffers(operations, noperations);
+
+	/* Without advice, this is our only clue about the cache hit rate. */
+	if (!stream->advice_enabled)
+	{
+		if (did_io)
+			stream->distance = Min(stream->distance * 2,
+								   stream->max_distance);
+		else if (stream->distance > 1)
+			stream->distance--;
+	}
+}
+
+/*
+ * Create a new read stream for reading a relation fork.
+ *
+ * The callback is invoked to obtain each block number to read, in order.  If
+ * per_buffer_data_size is non-zero, the callback may store that many bytes
+ * of data for each block, and read_stream_next_buffer() hands it back.
+ */
+ReadStream *
+read_stream_begin_relation(int flags,
+						   BufferAccessStrategy strategy,
+						   Relation rel,
+						   ForkNumber forknum,
+						   ReadStreamBlockNumberCB callback,
+						   void *callback_private_data,
+						   size_t per_buffer_data_size)
+{
+	ReadStream *stream;
+	int			max_distance;
+	int			queue_size;
+	bool		advice_enabled;
+	bool		batch_io;
+
+	/*
+	 * Choose the maximum look-ahead distance.  Temporary relations use the
+	 * same settings; their blocks are prefetched into the kernel page cache
+	 * just like those of permanent relations.  Don't consult the tablespace
+	 * cache for catalogs, or before we're connected to a database, because
+	 * that might itself require a catalog scan.
+	 */
+#ifdef USE_PREFETCH
+	if (!OidIsValid(MyDatabaseId) || IsCatalogRelation(rel))
+		max_distance = (flags & READ_STREAM_MAINTENANCE) ?
+			maintenance_io_concurrency : effective_io_concurrency;
+	else if (flags & READ_STREAM_MAINTENANCE)
+		max_distance = get_tablespace_maintenance_io_concurrency(rel->rd_rel->reltablespace);
+	else
+		max_distance = get_tablespace_io_concurrency(rel->rd_rel->reltablespace);
+#else
+	max_distance = 0;
+#endif
+	max_distance = Min(max_distance, MAX_IO_CONCURRENCY);
+	advice_enabled = max_distance > 0;
+	batch_io = io_method != IO_METHOD_SYNC;
+
+	if (batch_io)
+	{
+		/*
+		 * The kernel is told about our reads directly, so advice would only
+		 * duplicate work.  Instead, allow as many full-sized ranges in a
+		 * batch as the I/O concurrency setting suggests.
+		 */
+		advice_enabled = false;
+		max_distance = Min(Max(max_distance, 1) * io_combine_limit,
+						   MAX_IO_BATCH_BUFFERS);
+	}
+
+	/* Look far enough ahead to find blocks to combine into one read. */
+	max_distance = Max(max_distance, io_combine_limit);
+	queue_size = max_distance + 1;
+
+	stream = (ReadStream *) palloc0(offsetof(ReadStream, blocknums) +
+									sizeof(BlockNumber) * queue_size);
+
+	stream->rel = rel;
+	stream->forknum = forknum;
+	stream->strategy = strategy;
+	stream->advice_enabled = advice_enabled;
+	stream->batch_io = batch_io;
+	stream->max_distance = max_distance;
+	stream->distance = 1;
+	stream->queue_size = queue_size;
+	stream->buffers = palloc(sizeof(Buffer) * queue_size);
+	for (int i = 0; i < queue_size; i++)
+		stream->buffers[i] = InvalidBuffer;
+	stream->callback = callback;
+	stream->callback_private_data = callback_private_data;
+	stream->per_buffer_data_size = per_buffer_data_size;
+	if (per_buffer_data_size > 0)
+		stream->per_buffer_data = palloc0(per_buffer_data_size * queue_size);
+
+	return stream;
+}
+
+/*
+ * Pull one pinned buffer out of a stream.  Each call returns successive
+ * blocks in the order specified by the callback.  If per_buffer_data_size
+ * was set when the stream was created, *per_buffer_data is set to point to
+ * the data the callback stored for this block; it remains valid until the
+ * next call.  At the end of the stream, InvalidBuffer is returned.  The
+ * caller is responsible for releasing the returned buffers.
+ */
+Buffer
+read_stream_next_buffer(ReadStream *stream, void **per_buffer_data)
+{
+	int16		index;
+	Buffer		buffer;
+
+	/* Top up the look-ahead window before we wait for our own read. */
+	read_stream_look_ahead(stream);
+
+	if (stream->nqueued == 0)
+	{
+		Assert(stream->exhausted);
+		if (per_buffer_data)
+			*per_buffer_data = NULL;
+		return InvalidBuffer;
+	}
+
+	index = stream->oldest;
+
+	if (stream->buffers[index] == InvalidBuffer)
+		read_stream_read_range(stream);
+
+	buffer = stream->buffers[index];
+	stream->buffers[index] = InvalidBuffer;
+
+	if (++stream->oldest == stream->queue_size)
+		stream->oldest = 0;
+	stream->nqueued--;
+
+	if (per_buffer_data)
+		*per_buffer_data = stream->per_buffer_data ?
+			get_per_buffer_data(stream, index) : NULL;
+
+	return buffer;
+}
+
+/*
+ * Reset a read stream by forgetting any blocks that have been queued, so
+ * that the next call to read_stream_next_buffer() starts calling the
+ * callback again.  This can be used after the callback's state has been
+ * changed, for example to change scan direction, or after the callback has
+ * reported the end of the stream, to restart it.
+ */
+void
+read_stream_reset(ReadStream *stream)
+{
+	/* Release any buffers pinned ahead of the consumer. */
+	while (stream->nqueued > 0)
+	{
+		if (stream->buffers[stream->oldest] != InvalidBuffer)
+		{
+			ReleaseBuffer(stream->buffers[stream->oldest]);
+			stream->buffers[stream->oldest] = InvalidBuffer;
+		}
+		if (++stream->oldest == stream->queue_size)
+			stream->oldest = 0;
+		stream->nqueued--;
+	}
+
+	stream->oldest = 0;
+	stream->distance = 1;
+	stream->exhausted = false;
+}
+
+/*
+ * Release and free a read stream, including any buffers it still holds
+ * pinned.
+ */
+void
+read_stream_end(ReadStream *stream)
+{
+	read_stream_reset(stream);
+	pfree(stream->buffers);
+	if (stream->per_buffer_data)
+		pfree(stream->per_buffer_data);
+	pfree(stream);
+}
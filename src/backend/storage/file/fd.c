@@ -86,6 +86,10 @@
 #ifdef HAVE_SYS_RESOURCE_H
 #include <sys/resource.h>		/* for getrlimit */
 #endif
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
 
 #include "access/xact.h"
 #include "access/xlog.h"
@@ -95,6 +99,7 @@
 #include "common/pg_prng.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/atomics.h"
 #include "port/pg_iovec.h"
 #include "portability/mem.h"
 #include "postmaster/startup.h"
@@ -165,6 +170,9 @@ bool		data_sync_retry = false;
 /* How SyncDataDirectory() should do its job. */
 int			recovery_init_sync_method = RECOVERY_INIT_SYNC_METHOD_FSYNC;
 
+/* How FilePerformIO() performs its requests. */
+int			io_method = IO_METHOD_SYNC;
+
 /* Debugging.... */
 
 #ifdef FDDEBUG
@@ -238,6 +246,38 @@ static uint64 temporary_files_size = 0;
 static bool temporary_files_allowed = false;
 #endif
 
+#ifdef USE_IO_URING
+/*
+ * This process's io_uring instance for FilePerformIO(), set up on first use.
+ * We don't need many entries; FilePerformIO() waits for requests to complete
+ * before queuing more once the ring is full.
+ */
+#define PG_URING_ENTRIES 64
+
+static struct
+{
+	int			fd;
+	pid_t		owner_pid;
+	unsigned	sq_entries;
+	char	   *sq_ring;
+	size_t		sq_ring_size;
+	char	   *cq_ring;
+	size_t		cq_ring_size;
+	unsigned   *sq_head;
+	unsigned   *sq_tail;
+	unsigned	sq_mask;
+	unsigned   *sq_array;
+	unsigned   *cq_head;
+	unsigned   *cq_tail;
+	unsigned	cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+}			pg_uring = {.fd = -1};
+
+/* Did setting up io_uring fail in this process? */
+static bool pg_uring_failed = false;
+#endif
+
 /*
  * List of OS handles opened with AllocateFile, AllocateDir and
  * OpenTransientFile.
@@ -330,6 +370,14 @@ static File AllocateVfd(void);
 static void FreeVfd(File file);
 
 static int	FileAccess(File file);
+static void FilePerformOneIO(FileIORequest *req);
+#ifdef USE_IO_URING
+static bool pg_uring_init(void);
+static void pg_uring_reset(void);
+static void pg_uring_enter(unsigned to_submit, unsigned min_complete,
+						   bool inflight, uint32 wait_event_info);
+static void pg_uring_perform(FileIORequest *reqs, int nreqs);
+#endif
 static File OpenTemporaryFileInTablespace(Oid tblspcOid, bool rejectError);
 static bool reserveAllocatedDesc(void);
 static int	FreeDesc(AllocateDesc *desc);
@@ -2111,16 +2159,34 @@ FileWriteback(File file, off_t offset, off_t nbytes, uint32 wait_event_info)
 int
 FileRead(File file, char *buffer, int amount, off_t offset,
 		 uint32 wait_event_info)
+{
+	struct iovec iov;
+
+	iov.iov_base = buffer;
+	iov.iov_len = amount;
+
+	return FileReadV(file, &iov, 1, offset, wait_event_info);
+}
+
+/*
+ * Read into several buffers with a single system call, as with preadv().
+ * Like FileRead(), this may transfer fewer bytes than requested; the caller
+ * is responsible for continuing a short read.
+ */
+int
+FileReadV(File file, const struct iovec *iov, int iovcnt, off_t offset,
+		  uint32 wait_event_info)
 {
 	int			returnCode;
 	Vfd		   *vfdP;
 
 	Assert(FileIsValid(file));
+	Assert(iovcnt > 0 && iovcnt <= PG_IOV_MAX);
 
-	DO_DB(elog(LOG, "FileRead: %d (%s) " INT64_FORMAT " %d %p",
+	DO_DB(elog(LOG, "FileReadV: %d (%s) " INT64_FORMAT " %d",
 			   file, VfdCache[file].fileName,
 			   (int64) offset,
-			   amount, buffer));
+			   iovcnt));
 
 	returnCode = FileAccess(file);
 	if (returnCode < 0)
@@ -2130,7 +2196,11 @@ FileRead(File file, char *buffer, int amount, off_t offset,
 
 retry:
 	pgstat_report_wait_start(wait_event_info);
-	returnCode = pg_pread(vfdP->fd, buffer, amount, offset);
+	if (iovcnt == 1)
+		returnCode = pg_pread(vfdP->fd, iov[0].iov_base, iov[0].iov_len,
+							  offset);
+	else
+		returnCode = pg_preadv(vfdP->fd, iov, iovcnt, offset);
 	pgstat_report_wait_end();
 
 	if (returnCode < 0)
@@ -2167,16 +2237,40 @@ retry:
 int
 FileWrite(File file, char *buffer, int amount, off_t offset,
 		  uint32 wait_event_info)
+{
+	struct iovec iov;
+
+	iov.iov_base = buffer;
+	iov.iov_len = amount;
+
+	return FileWriteV(file, &iov, 1, offset, wait_event_info);
+}
+
+/*
+ * Write from several buffers with a single system call, as with pwritev().
+ * Like FileWrite(), this may transfer fewer bytes than requested, in which
+ * case errno is set as for a failed write; the caller decides whether to
+ * continue.
+ */
+int
+FileWriteV(File file, const struct iovec *iov, int iovcnt, off_t offset,
+		   uint32 wait_event_info)
 {
 	int			returnCode;
+	int			amount;
 	Vfd		   *vfdP;
 
 	Assert(FileIsValid(file));
+	Assert(iovcnt > 0 && iovcnt <= PG_IOV_MAX);
+
+	amount = 0;
+	for (int i = 0; i < iovcnt; i++)
+		amount += iov[i].iov_len;
 
-	DO_DB(elog(LOG, "FileWrite: %d (%s) " INT64_FORMAT " %d %p",
+	DO_DB(elog(LOG, "FileWriteV: %d (%s) " INT64_FORMAT " %d %d",
 			   file, VfdCache[file].fileName,
 			   (int64) offset,
-			   amount, buffer));
+			   amount, iovcnt));
 
 	returnCode = FileAccess(file);
 	if (returnCode < 0)
@@ -2212,7 +2306,11 @@ FileWrite(File file, char *buffer, int amount, off_t offset,
 retry:
 	errno = 0;
 	pgstat_report_wait_start(wait_event_info);
-	returnCode = pg_pwrite(VfdCache[file].fd, buffer, amount, offset);
+	if (iovcnt == 1)
+		returnCode = pg_pwrite(vfdP->fd, iov[0].iov_base, iov[0].iov_len,
+							   offset);
+	else
+		returnCode = pg_pwritev(vfdP->fd, iov, iovcnt, offset);
 	pgstat_report_wait_end();
 
 	/* if write didn't set errno, assume problem is no disk space */
@@ -2262,6 +2360,326 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FilePerformIO - perform a set of independent reads and writes
+ *
+ * Returns when all of the requests are complete.  As with FileReadV() and
+ * FileWriteV(), a request may transfer fewer bytes than requested; the
+ * caller is responsible for continuing it.
+ *
+ * With io_method = io_uring, the requests are handed to the kernel together,
+ * so that the device can work on all of them at once.  Otherwise, or if
+ * io_uring can't be used, they are simply performed one at a time.
+ */
+void
+FilePerformIO(FileIORequest *reqs, int nreqs)
+{
+#ifdef USE_IO_URING
+	if (io_method == IO_METHOD_IO_URING && nreqs > 1 && pg_uring_init())
+	{
+		pg_uring_perform(reqs, nreqs);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < nreqs; i++)
+		FilePerformOneIO(&reqs[i]);
+}
+
+/*
+ * Perform one FilePerformIO() request synchronously.
+ */
+static void
+FilePerformOneIO(FileIORequest *req)
+{
+	if (req->is_write)
+		req->result = FileWriteV(req->file, req->iov, req->iovcnt,
+								 req->offset, req->wait_event_info);
+	else
+		req->result = FileReadV(req->file, req->iov, req->iovcnt,
+								req->offset, req->wait_event_info);
+	req->error = req->result < 0 ? errno : 0;
+}
+
+#ifdef USE_IO_URING
+
+/*
+ * Set up this process's io_uring instance, if that hasn't been done yet.
+ * Returns false if io_uring can't be used, for example because the kernel
+ * is too old or the system call is blocked; we then fall back to
+ * synchronous I/O for the rest of the life of the process.
+ */
+static bool
+pg_uring_init(void)
+{
+	struct io_uring_params params;
+	size_t		sq_ring_size;
+	size_t		cq_ring_size;
+	char	   *sq_ring;
+	char	   *cq_ring;
+	int			fd;
+
+	if (pg_uring.fd >= 0)
+	{
+		/* A ring inherited from the parent process is of no use to us */
+		if (pg_uring.owner_pid == MyProcPid)
+			return true;
+		pg_uring_reset();
+	}
+	if (pg_uring_failed)
+		return false;
+
+	memset(&params, 0, sizeof(params));
+	fd = syscall(__NR_io_uring_setup, PG_URING_ENTRIES, &params);
+	if (fd < 0)
+		goto fail;
+
+	sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_ring_size = params.cq_off.cqes +
+		params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		sq_ring_size = cq_ring_size = Max(sq_ring_size, cq_ring_size);
+
+	sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE,
+				   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (sq_ring == MAP_FAILED)
+	{
+		close(fd);
+		goto fail;
+	}
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		cq_ring = sq_ring;
+	else
+	{
+		cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+					   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (cq_ring == MAP_FAILED)
+		{
+			munmap(sq_ring, sq_ring_size);
+			close(fd);
+			goto fail;
+		}
+	}
+	pg_uring.sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+						 PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+						 fd, IORING_OFF_SQES);
+	if (pg_uring.sqes == MAP_FAILED)
+	{
+		if (cq_ring != sq_ring)
+			munmap(cq_ring, cq_ring_size);
+		munmap(sq_ring, sq_ring_size);
+		close(fd);
+		goto fail;
+	}
+
+	/* The ring's file descriptor counts against our budget */
+	ReserveExternalFD();
+
+	pg_uring.fd = fd;
+	pg_uring.owner_pid = MyProcPid;
+	pg_uring.sq_entries = params.sq_entries;
+	pg_uring.sq_ring = sq_ring;
+	pg_uring.sq_ring_size = sq_ring_size;
+	pg_uring.cq_ring = cq_ring;
+	pg_uring.cq_ring_size = cq_ring_size;
+	pg_uring.sq_head = (unsigned *) (sq_ring + params.sq_off.head);
+	pg_uring.sq_tail = (unsigned *) (sq_ring + params.sq_off.tail);
+	pg_uring.sq_mask = *(unsigned *) (sq_ring + params.sq_off.ring_mask);
+	pg_uring.sq_array = (unsigned *) (sq_ring + params.sq_off.array);
+	pg_uring.cq_head = (unsigned *) (cq_ring + params.cq_off.head);
+	pg_uring.cq_tail = (unsigned *) (cq_ring + params.cq_off.tail);
+	pg_uring.cq_mask = *(unsigned *) (cq_ring + params.cq_off.ring_mask);
+	pg_uring.cqes = (struct io_uring_cqe *) (cq_ring + params.cq_off.cqes);
+
+	return true;
+
+fail:
+	ereport(LOG,
+			(errcode_for_file_access(),
+			 errmsg("could not set up io_uring, using synchronous I/O instead: %m")));
+	pg_uring_failed = true;
+	return false;
+}
+
+/*
+ * Forget about a ring inherited from our parent process.
+ */
+static void
+pg_uring_reset(void)
+{
+	munmap(pg_uring.sqes, pg_uring.sq_entries * sizeof(struct io_uring_sqe));
+	if (pg_uring.cq_ring != pg_uring.sq_ring)
+		munmap(pg_uring.cq_ring, pg_uring.cq_ring_size);
+	munmap(pg_uring.sq_ring, pg_uring.sq_ring_size);
+	close(pg_uring.fd);
+	pg_uring.fd = -1;
+}
+
+/*
+ * Submit the queued entries to the kernel, and wait until at least
+ * min_complete requests have completed.
+ *
+ * Once requests are in flight, the kernel may still be transferring data to
+ * or from the caller's buffers, so there is no way to recover from a
+ * failure here; we must not return control to code that might release or
+ * reuse those buffers.
+ */
+static void
+pg_uring_enter(unsigned to_submit, unsigned min_complete, bool inflight,
+			   uint32 wait_event_info)
+{
+	for (;;)
+	{
+		int			rc;
+
+		pgstat_report_wait_start(wait_event_info);
+		rc = syscall(__NR_io_uring_enter, pg_uring.fd, to_submit, min_complete,
+					 min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		pgstat_report_wait_end();
+
+		if (rc >= 0)
+		{
+			Assert(rc <= to_submit);
+			to_submit -= rc;
+			if (to_submit == 0)
+				break;
+			continue;
+		}
+
+		if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+			continue;
+
+		ereport(inflight || to_submit > 0 ? PANIC : ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not submit I/O requests to io_uring: %m")));
+	}
+}
+
+/*
+ * Perform FilePerformIO() requests using io_uring.
+ */
+static void
+pg_uring_perform(FileIORequest *reqs, int nreqs)
+{
+	int			next = 0;		/* next request to queue */
+	int			nqueued = 0;	/* queued but not yet submitted */
+	int			ninflight = 0;	/* submitted but not yet completed */
+	int			ncompleted = 0;
+
+	while (ncompleted < nreqs)
+	{
+		unsigned	head;
+		unsigned	tail;
+
+		/* Queue as many requests as the ring has room for */
+		while (next < nreqs && nqueued + ninflight < pg_uring.sq_entries)
+		{
+			FileIORequest *req = &reqs[next];
+			struct io_uring_sqe *sqe;
+			unsigned	index;
+
+			/*
+			 * Writes to temporary files need the temp_file_limit
+			 * accounting in FileWriteV(), so just perform them directly.
+			 */
+			if (req->is_write &&
+				(VfdCache[req->file].fdstate & FD_TEMP_FILE_LIMIT))
+			{
+				FilePerformOneIO(req);
+				next++;
+				ncompleted++;
+				continue;
+			}
+
+			/*
+			 * Opening a file might close another one to make room, which
+			 * could be one that queued requests refer to by descriptor.  So
+			 * submit those first; the kernel holds its own reference to the
+			 * file of a submitted request.
+			 */
+			if (FileIsNotOpen(req->file) && nqueued > 0)
+			{
+				pg_uring_enter(nqueued, 0, ninflight > 0,
+							   reqs[0].wait_event_info);
+				ninflight += nqueued;
+				nqueued = 0;
+			}
+
+			if (FileAccess(req->file) < 0)
+			{
+				req->result = -1;
+				req->error = errno;
+				next++;
+				ncompleted++;
+				continue;
+			}
+
+			tail = *pg_uring.sq_tail;
+			index = tail & pg_uring.sq_mask;
+			sqe = &pg_uring.sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = req->is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+			sqe->fd = VfdCache[req->file].fd;
+			sqe->addr = (uint64) (uintptr_t) req->iov;
+			sqe->len = req->iovcnt;
+			sqe->off = req->offset;
+			sqe->user_data = next;
+			pg_uring.sq_array[index] = index;
+
+			/* Make the entry visible before advancing the tail */
+			pg_write_barrier();
+			*pg_uring.sq_tail = tail + 1;
+
+			nqueued++;
+			next++;
+		}
+
+		if (nqueued == 0 && ninflight == 0)
+			continue;
+
+		/* Submit whatever is queued, and wait for something to complete */
+		pg_uring_enter(nqueued, 1, ninflight > 0, reqs[0].wait_event_info);
+		ninflight += nqueued;
+		nqueued = 0;
+
+		/* Reap completions */
+		head = *pg_uring.cq_head;
+		tail = *(volatile unsigned *) pg_uring.cq_tail;
+		pg_read_barrier();
+		while (head != tail)
+		{
+			struct io_uring_cqe *cqe = &pg_uring.cqes[head & pg_uring.cq_mask];
+			FileIORequest *req = &reqs[cqe->user_data];
+
+			if (cqe->res == -EINTR || cqe->res == -EAGAIN)
+			{
+				/* Rare for files; just do it the ordinary way */
+				FilePerformOneIO(req);
+			}
+			else if (cqe->res < 0)
+			{
+				req->result = -1;
+				req->error = -cqe->res;
+			}
+			else
+			{
+				req->result = cqe->res;
+				req->error = 0;
+			}
+
+			head++;
+			ninflight--;
+			ncompleted++;
+		}
+
+		/* Let the kernel reuse the completion slots */
+		pg_memory_barrier();
+		*pg_uring.cq_head = head;
+	}
+}
+
+#endif							/* USE_IO_URING */
+
 int
 FileSync(File file, uint32 wait_event_info)
 {
@@ -183,6 +183,10 @@ static const char *const BuiltinTrancheNames[] = {
 	"PgStatsHash",
 	/* LWTRANCHE_PGSTATS_DATA: */
 	"PgStatsData",
+	/* LWTRANCHE_REDO_EXTENSION: */
+	"RedoExtension",
+	/* LWTRANCHE_PARALLEL_MEMOIZE: */
+	"ParallelMemoize",
 };
 
 StaticAssertDecl(lengthof(BuiltinTrancheNames) ==
@@ -522,11 +526,6 @@ InitializeLWLocks(void)
 	for (id = 0, lock = MainLWLockArray; id < NUM_INDIVIDUAL_LWLOCKS; id++, lock++)
 		LWLockInitialize(&lock->lock, id);
 
-	/* Initialize buffer mapping LWLocks in main array */
-	lock = MainLWLockArray + BUFFER_MAPPING_LWLOCK_OFFSET;
-	for (id = 0; id < NUM_BUFFER_PARTITIONS; id++, lock++)
-		LWLockInitialize(&lock->lock, LWTRANCHE_BUFFER_MAPPING);
-
 	/* Initialize lmgrs' LWLocks in main array */
 	lock = MainLWLockArray + LOCK_MANAGER_LWLOCK_OFFSET;
 	for (id = 0; id < NUM_LOCK_PARTITIONS; id++, lock++)
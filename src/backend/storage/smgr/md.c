@@ -31,6 +31,7 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
@@ -425,7 +426,7 @@ mdunlinkfork(RelFileNodeBackend rnode, ForkNumber forkNum, bool isRedo)
 /*
  *	mdextend() -- Add a block to the specified relation.
  *
- *		The semantics are nearly the same as mdwrite(): write at the
+ *		The semantics are nearly the same as mdwritev(): write at the
  *		specified position.  However, this is to be used for the case of
  *		extending a relation (i.e., blocknum is at or beyond the current
  *		EOF).  Note that we assume writing a block beyond current EOF
@@ -623,7 +624,7 @@ mdwriteback(SMgrRelation reln, ForkNumber forknum,
 		/*
 		 * We might be flushing buffers of already removed relations, that's
 		 * ok, just ignore that case.  If the segment file wasn't open already
-		 * (ie from a recent mdwrite()), then we don't want to re-open it, to
+		 * (ie from a recent mdwritev()), then we don't want to re-open it, to
 		 * avoid a race with PROCSIGNAL_BARRIER_SMGRRELEASE that might leave
 		 * us with a descriptor to a file that is about to be unlinked.
 		 */
@@ -651,128 +652,373 @@ mdwriteback(SMgrRelation reln, ForkNumber forknum,
 }
 
 /*
- *	mdread() -- Read the specified block from a relation.
+ * Adjust an array of iovecs to skip the first "transferred" bytes, after a
+ * short read or write.  The remaining iovecs are moved to the front of the
+ * array, and their number is returned.
+ */
+static int
+md_skip_iovecs(struct iovec *iov, int iovcnt, size_t transferred)
+{
+	int			skip = 0;
+
+	while (skip < iovcnt && transferred >= iov[skip].iov_len)
+	{
+		transferred -= iov[skip].iov_len;
+		skip++;
+	}
+
+	iovcnt -= skip;
+	memmove(iov, iov + skip, sizeof(struct iovec) * iovcnt);
+
+	if (iovcnt > 0)
+	{
+		iov[0].iov_base = (char *) iov[0].iov_base + transferred;
+		iov[0].iov_len -= transferred;
+	}
+
+	return iovcnt;
+}
+
+/*
+ *	mdreadv() -- Read the specified blocks from a relation.
+ *
+ *		Consecutive blocks that lie in the same segment file are read with a
+ *		single system call, up to PG_IOV_MAX blocks at a time.
  */
 void
-mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
-	   char *buffer)
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, BlockNumber nblocks)
 {
-	off_t		seekpos;
-	int			nbytes;
-	MdfdVec    *v;
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		int			iovcnt;
+		off_t		seekpos;
+		int			nbytes;
+		MdfdVec    *v;
+		BlockNumber nblocks_this_segment;
+		size_t		transferred_this_segment;
+		size_t		size_this_segment;
 
-	TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
-										reln->smgr_rnode.node.spcNode,
-										reln->smgr_rnode.node.dbNode,
-										reln->smgr_rnode.node.relNode,
-										reln->smgr_rnode.backend);
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
 
-	v = _mdfd_getseg(reln, forknum, blocknum, false,
-					 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
 
-	seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		nblocks_this_segment = Min(nblocks_this_segment, PG_IOV_MAX);
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_READ);
+		for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+		{
+			iov[iovcnt].iov_base = buffers[iovcnt];
+			iov[iovcnt].iov_len = BLCKSZ;
+		}
 
-	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
-									   reln->smgr_rnode.node.spcNode,
-									   reln->smgr_rnode.node.dbNode,
-									   reln->smgr_rnode.node.relNode,
-									   reln->smgr_rnode.backend,
-									   nbytes,
-									   BLCKSZ);
+		size_this_segment = (size_t) nblocks_this_segment * BLCKSZ;
+		transferred_this_segment = 0;
 
-	if (nbytes != BLCKSZ)
-	{
-		if (nbytes < 0)
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not read block %u in file \"%s\": %m",
-							blocknum, FilePathName(v->mdfd_vfd))));
+		/* Keep reading until the whole range is done, or we reach EOF. */
+		for (;;)
+		{
+			TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
+												reln->smgr_rnode.node.spcNode,
+												reln->smgr_rnode.node.dbNode,
+												reln->smgr_rnode.node.relNode,
+												reln->smgr_rnode.backend);
+
+			nbytes = FileReadV(v->mdfd_vfd, iov, iovcnt, seekpos,
+							   WAIT_EVENT_DATA_FILE_READ);
+
+			TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
+											   reln->smgr_rnode.node.spcNode,
+											   reln->smgr_rnode.node.dbNode,
+											   reln->smgr_rnode.node.relNode,
+											   reln->smgr_rnode.backend,
+											   nbytes,
+											   size_this_segment - transferred_this_segment);
+
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read block %u in file \"%s\": %m",
+								blocknum + (BlockNumber) (transferred_this_segment / BLCKSZ),
+								FilePathName(v->mdfd_vfd))));
 
-		/*
-		 * Short read: we are at or past EOF, or we read a partial block at
-		 * EOF.  Normally this is an error; upper levels should never try to
-		 * read a nonexistent block.  However, if zero_damaged_pages is ON or
-		 * we are InRecovery, we should instead return zeroes without
-		 * complaining.  This allows, for example, the case of trying to
-		 * update a block that was later truncated away.
-		 */
-		if (zero_damaged_pages || InRecovery)
-			MemSet(buffer, 0, BLCKSZ);
-		else
-			ereport(ERROR,
-					(errcode(ERRCODE_DATA_CORRUPTED),
-					 errmsg("could not read block %u in file \"%s\": read only %d of %d bytes",
-							blocknum, FilePathName(v->mdfd_vfd),
-							nbytes, BLCKSZ)));
+			if (nbytes == 0)
+			{
+				/*
+				 * We are at or past EOF, or we read a partial block at EOF.
+				 * Normally this is an error; upper levels should never try
+				 * to read a nonexistent block.  However, if
+				 * zero_damaged_pages is ON or we are InRecovery, we should
+				 * instead return zeroes without complaining.  This allows,
+				 * for example, the case of trying to update a block that was
+				 * later truncated away.
+				 */
+				if (zero_damaged_pages || InRecovery)
+				{
+					for (BlockNumber i = transferred_this_segment / BLCKSZ;
+						 i < nblocks_this_segment;
+						 i++)
+						MemSet(buffers[i], 0, BLCKSZ);
+					break;
+				}
+				else
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("could not read block %u in file \"%s\": read only %d of %d bytes",
+									blocknum + (BlockNumber) (transferred_this_segment / BLCKSZ),
+									FilePathName(v->mdfd_vfd),
+									(int) (transferred_this_segment % BLCKSZ),
+									BLCKSZ)));
+			}
+
+			transferred_this_segment += nbytes;
+			if (transferred_this_segment == size_this_segment)
+				break;
+
+			/* Short read: continue with whatever is left. */
+			seekpos += nbytes;
+			iovcnt = md_skip_iovecs(iov, iovcnt, nbytes);
+		}
+
+		nblocks -= nblocks_this_segment;
+		buffers += nblocks_this_segment;
+		blocknum += nblocks_this_segment;
 	}
 }
 
 /*
- *	mdwrite() -- Write the supplied block at the appropriate location.
+ *	mdwritev() -- Write the supplied blocks at the appropriate location.
  *
  *		This is to be used only for updating already-existing blocks of a
  *		relation (ie, those before the current EOF).  To extend a relation,
- *		use mdextend().
+ *		use mdextend().  As in mdreadv(), consecutive blocks in the same
+ *		segment file are written with a single system call.
  */
 void
-mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
-		char *buffer, bool skipFsync)
+mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		 char **buffers, BlockNumber nblocks, bool skipFsync)
 {
-	off_t		seekpos;
-	int			nbytes;
-	MdfdVec    *v;
-
 	/* This assert is too expensive to have on normally ... */
 #ifdef CHECK_WRITE_VS_EXTEND
-	Assert(blocknum < mdnblocks(reln, forknum));
+	Assert(blocknum + nblocks <= mdnblocks(reln, forknum));
 #endif
 
-	TRACE_POSTGRESQL_SMGR_MD_WRITE_START(forknum, blocknum,
-										 reln->smgr_rnode.node.spcNode,
-										 reln->smgr_rnode.node.dbNode,
-										 reln->smgr_rnode.node.relNode,
-										 reln->smgr_rnode.backend);
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		int			iovcnt;
+		off_t		seekpos;
+		int			nbytes;
+		MdfdVec    *v;
+		BlockNumber nblocks_this_segment;
+		size_t		transferred_this_segment;
+		size_t		size_this_segment;
 
-	v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
-					 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
 
-	seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
 
-	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		nblocks_this_segment = Min(nblocks_this_segment, PG_IOV_MAX);
+
+		for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+		{
+			iov[iovcnt].iov_base = buffers[iovcnt];
+			iov[iovcnt].iov_len = BLCKSZ;
+		}
+
+		size_this_segment = (size_t) nblocks_this_segment * BLCKSZ;
+		transferred_this_segment = 0;
+
+		/*
+		 * Keep writing until the whole range is done.  A short write is
+		 * retried once more with the remainder; if that makes no progress,
+		 * we're probably out of disk space.
+		 */
+		for (;;)
+		{
+			TRACE_POSTGRESQL_SMGR_MD_WRITE_START(forknum, blocknum,
+												 reln->smgr_rnode.node.spcNode,
+												 reln->smgr_rnode.node.dbNode,
+												 reln->smgr_rnode.node.relNode,
+												 reln->smgr_rnode.backend);
+
+			nbytes = FileWriteV(v->mdfd_vfd, iov, iovcnt, seekpos,
+								WAIT_EVENT_DATA_FILE_WRITE);
+
+			TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
+												reln->smgr_rnode.node.spcNode,
+												reln->smgr_rnode.node.dbNode,
+												reln->smgr_rnode.node.relNode,
+												reln->smgr_rnode.backend,
+												nbytes,
+												size_this_segment - transferred_this_segment);
+
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not write block %u in file \"%s\": %m",
+								blocknum + (BlockNumber) (transferred_this_segment / BLCKSZ),
+								FilePathName(v->mdfd_vfd))));
+
+			if (nbytes == 0)
+			{
+				/* short write: complain appropriately */
+				ereport(ERROR,
+						(errcode(ERRCODE_DISK_FULL),
+						 errmsg("could not write block %u in file \"%s\": wrote only %d of %d bytes",
+								blocknum + (BlockNumber) (transferred_this_segment / BLCKSZ),
+								FilePathName(v->mdfd_vfd),
+								(int) (transferred_this_segment % BLCKSZ),
+								BLCKSZ),
+						 errhint("Check free disk space.")));
+			}
+
+			transferred_this_segment += nbytes;
+			if (transferred_this_segment == size_this_segment)
+				break;
 
-	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_WRITE);
+			seekpos += nbytes;
+			iovcnt = md_skip_iovecs(iov, iovcnt, nbytes);
+		}
 
-	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
-										reln->smgr_rnode.node.spcNode,
-										reln->smgr_rnode.node.dbNode,
-										reln->smgr_rnode.node.relNode,
-										reln->smgr_rnode.backend,
-										nbytes,
-										BLCKSZ);
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
 
-	if (nbytes != BLCKSZ)
+		nblocks -= nblocks_this_segment;
+		buffers += nblocks_this_segment;
+		blocknum += nblocks_this_segment;
+	}
+}
+
+/*
+ *	mdperformio() -- Perform a set of reads and writes of block ranges.
+ *
+ *		Each request is split at segment boundaries and at PG_IOV_MAX blocks,
+ *		and all of the resulting file-level requests are handed to
+ *		FilePerformIO() together, so that they can be in progress at the same
+ *		time.  Whatever was not transferred completely, whether because of a
+ *		short transfer or an error, is then finished by mdreadv() or
+ *		mdwritev(), which also take care of reporting errors and of the
+ *		special treatment of reads beyond EOF.
+ */
+void
+mdperformio(SMgrIORequest *reqs, int nreqs)
+{
+	FileIORequest *freqs;
+	struct iovec *iovs;
+	int		   *owners;
+	BlockNumber *firstblocks;
+	int			nfreqs = 0;
+	int			maxfreqs = 0;
+	int			niovs = 0;
+
+	/* Size the arrays for the worst case of splitting. */
+	for (int i = 0; i < nreqs; i++)
 	{
-		if (nbytes < 0)
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not write block %u in file \"%s\": %m",
-							blocknum, FilePathName(v->mdfd_vfd))));
-		/* short write: complain appropriately */
-		ereport(ERROR,
-				(errcode(ERRCODE_DISK_FULL),
-				 errmsg("could not write block %u in file \"%s\": wrote only %d of %d bytes",
-						blocknum,
-						FilePathName(v->mdfd_vfd),
-						nbytes, BLCKSZ),
-				 errhint("Check free disk space.")));
+		maxfreqs += reqs[i].nblocks / Min(PG_IOV_MAX, RELSEG_SIZE) + 2;
+		niovs += reqs[i].nblocks;
 	}
+	freqs = palloc(sizeof(FileIORequest) * maxfreqs);
+	owners = palloc(sizeof(int) * maxfreqs);
+	firstblocks = palloc(sizeof(BlockNumber) * maxfreqs);
+	iovs = palloc(sizeof(struct iovec) * niovs);
 
-	if (!skipFsync && !SmgrIsTemp(reln))
-		register_dirty_segment(reln, forknum, v);
+	niovs = 0;
+	for (int i = 0; i < nreqs; i++)
+	{
+		SMgrIORequest *req = &reqs[i];
+		BlockNumber done = 0;
+
+		while (done < req->nblocks)
+		{
+			BlockNumber blocknum = req->blocknum + done;
+			BlockNumber nblocks_this_segment;
+			FileIORequest *freq = &freqs[nfreqs];
+			MdfdVec    *v;
+
+			v = _mdfd_getseg(req->reln, req->forknum, blocknum,
+							 req->is_write && req->skipFsync,
+							 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+			nblocks_this_segment =
+				Min(req->nblocks - done,
+					RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+			nblocks_this_segment = Min(nblocks_this_segment, PG_IOV_MAX);
+
+			freq->file = v->mdfd_vfd;
+			freq->is_write = req->is_write;
+			freq->offset = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+			freq->iov = &iovs[niovs];
+			freq->iovcnt = nblocks_this_segment;
+			freq->wait_event_info = req->is_write ?
+				WAIT_EVENT_DATA_FILE_WRITE : WAIT_EVENT_DATA_FILE_READ;
+
+			for (BlockNumber j = 0; j < nblocks_this_segment; j++)
+			{
+				iovs[niovs].iov_base = req->buffers[done + j];
+				iovs[niovs].iov_len = BLCKSZ;
+				niovs++;
+			}
+
+			owners[nfreqs] = i;
+			firstblocks[nfreqs] = done;
+			nfreqs++;
+			done += nblocks_this_segment;
+		}
+	}
+	Assert(nfreqs <= maxfreqs);
+
+	FilePerformIO(freqs, nfreqs);
+
+	for (int k = 0; k < nfreqs; k++)
+	{
+		FileIORequest *freq = &freqs[k];
+		SMgrIORequest *req = &reqs[owners[k]];
+		BlockNumber first = firstblocks[k];
+		BlockNumber ndone;
+
+		ndone = freq->result > 0 ? freq->result / BLCKSZ : 0;
+
+		if (ndone == freq->iovcnt)
+		{
+			if (req->is_write && !req->skipFsync && !SmgrIsTemp(req->reln))
+				register_dirty_segment(req->reln, req->forknum,
+									   _mdfd_getseg(req->reln, req->forknum,
+													req->blocknum + first,
+													false,
+													EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY));
+			continue;
+		}
+
+		/*
+		 * Finish the rest synchronously, reporting any error there.  For a
+		 * write, that also registers the segment as dirty.
+		 */
+		if (req->is_write)
+			mdwritev(req->reln, req->forknum, req->blocknum + first + ndone,
+					 req->buffers + first + ndone, freq->iovcnt - ndone,
+					 req->skipFsync);
+		else
+			mdreadv(req->reln, req->forknum, req->blocknum + first + ndone,
+					req->buffers + first + ndone, freq->iovcnt - ndone);
+	}
+
+	pfree(freqs);
+	pfree(owners);
+	pfree(firstblocks);
+	pfree(iovs);
 }
 
 /*
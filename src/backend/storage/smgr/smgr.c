@@ -52,10 +52,13 @@ typedef struct f_smgr
 								BlockNumber blocknum, char *buffer, bool skipFsync);
 	bool		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
-	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
-							  BlockNumber blocknum, char *buffer);
-	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
-							   BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+							   BlockNumber blocknum, char **buffers,
+							   BlockNumber nblocks);
+	void		(*smgr_writev) (SMgrRelation reln, ForkNumber forknum,
+								BlockNumber blocknum, char **buffers,
+								BlockNumber nblocks, bool skipFsync);
+	void		(*smgr_performio) (SMgrIORequest *reqs, int nreqs);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
 								   BlockNumber blocknum, BlockNumber nblocks);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
@@ -76,8 +79,9 @@ static const f_smgr smgrsw[] = {
 		.smgr_unlink = mdunlink,
 		.smgr_extend = mdextend,
 		.smgr_prefetch = mdprefetch,
-		.smgr_read = mdread,
-		.smgr_write = mdwrite,
+		.smgr_readv = mdreadv,
+		.smgr_writev = mdwritev,
+		.smgr_performio = mdperformio,
 		.smgr_writeback = mdwriteback,
 		.smgr_nblocks = mdnblocks,
 		.smgr_truncate = mdtruncate,
@@ -315,6 +319,31 @@ smgrreleaseall(void)
 		smgrrelease(reln);
 }
 
+/*
+ *	smgrresetnblocks() -- Forget the cached sizes of all relations.
+ *
+ * This is used during parallel redo, where other processes may have extended
+ * relations whose sizes we have cached.
+ */
+void
+smgrresetnblocks(void)
+{
+	HASH_SEQ_STATUS status;
+	SMgrRelation reln;
+
+	/* Nothing to do if hashtable not set up */
+	if (SMgrRelationHash == NULL)
+		return;
+
+	hash_seq_init(&status, SMgrRelationHash);
+
+	while ((reln = (SMgrRelation) hash_seq_search(&status)) != NULL)
+	{
+		for (ForkNumber forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+			reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+	}
+}
+
 /*
  *	smgrcloseall() -- Close all existing SMgrRelation objects.
  */
@@ -532,7 +561,22 @@ void
 smgrread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		 char *buffer)
 {
-	smgrsw[reln->smgr_which].smgr_read(reln, forknum, blocknum, buffer);
+	smgrsw[reln->smgr_which].smgr_readv(reln, forknum, blocknum, &buffer, 1);
+}
+
+/*
+ *	smgrreadv() -- read a range of consecutive blocks from a relation into
+ *				   the supplied buffers.
+ *
+ *		Like smgrread(), but the storage manager may transfer all of the
+ *		blocks with fewer, larger I/O operations.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, BlockNumber nblocks)
+{
+	smgrsw[reln->smgr_which].smgr_readv(reln, forknum, blocknum, buffers,
+										nblocks);
 }
 
 /*
@@ -554,10 +598,45 @@ void
 smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		  char *buffer, bool skipFsync)
 {
-	smgrsw[reln->smgr_which].smgr_write(reln, forknum, blocknum,
-										buffer, skipFsync);
+	smgrsw[reln->smgr_which].smgr_writev(reln, forknum, blocknum,
+										 &buffer, 1, skipFsync);
 }
 
+/*
+ *	smgrwritev() -- Write out a range of consecutive blocks.
+ *
+ *		Like smgrwrite(), but the storage manager may transfer all of the
+ *		blocks with fewer, larger I/O operations.
+ */
+void
+smgrwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   char **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_writev(reln, forknum, blocknum,
+										 buffers, nblocks, skipFsync);
+}
+
+/*
+ *	smgrperformio() -- Perform a set of reads and writes.
+ *
+ *		Each request reads or writes a range of consecutive blocks, with the
+ *		same meaning as smgrreadv() or smgrwritev().  The storage manager may
+ *		have all of the requests in progress at the same time, so they must
+ *		not overlap.  On return, all of them are complete.
+ */
+void
+smgrperformio(SMgrIORequest *reqs, int nreqs)
+{
+	if (nreqs == 0)
+		return;
+
+#ifdef USE_ASSERT_CHECKING
+	for (int i = 1; i < nreqs; i++)
+		Assert(reqs[i].reln->smgr_which == reqs[0].reln->smgr_which);
+#endif
+
+	smgrsw[reqs[0].reln->smgr_which].smgr_performio(reqs, nreqs);
+}
 
 /*
  *	smgrwriteback() -- Trigger kernel writeback for the supplied range of
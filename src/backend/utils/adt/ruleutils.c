@@ -7926,30 +7926,34 @@ find_param_referent(Param *param, deparse_context *context,
 		foreach(lc, dpns->ancestors)
 		{
 			Node	   *ancestor = (Node *) lfirst(lc);
+			List	   *nestParams = NIL;
 			ListCell   *lc2;
 
 			/*
-			 * NestLoops transmit params to their inner child only; also, once
+			 * NestLoops transmit params to their inner child only, and
+			 * adaptive hash joins to their nested-loop inner plan; also, once
 			 * we've crawled up out of a subplan, this couldn't possibly be
 			 * the right match.
 			 */
 			if (IsA(ancestor, NestLoop) &&
 				child_plan == innerPlan(ancestor) &&
 				in_same_plan_level)
+				nestParams = ((NestLoop *) ancestor)->nestParams;
+			else if (IsA(ancestor, HashJoin) &&
+					 child_plan == ((HashJoin *) ancestor)->nlinner &&
+					 in_same_plan_level)
+				nestParams = ((HashJoin *) ancestor)->nestParams;
+
+			foreach(lc2, nestParams)
 			{
-				NestLoop   *nl = (NestLoop *) ancestor;
+				NestLoopParam *nlp = (NestLoopParam *) lfirst(lc2);
 
-				foreach(lc2, nl->nestParams)
+				if (nlp->paramno == param->paramid)
 				{
-					NestLoopParam *nlp = (NestLoopParam *) lfirst(lc2);
-
-					if (nlp->paramno == param->paramid)
-					{
-						/* Found a match, so return it */
-						*dpns_p = dpns;
-						*ancestor_cell_p = lc;
-						return (Node *) nlp->paramval;
-					}
+					/* Found a match, so return it */
+					*dpns_p = dpns;
+					*ancestor_cell_p = lc;
+					return (Node *) nlp->paramval;
 				}
 			}
 
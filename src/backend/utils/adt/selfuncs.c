@@ -6680,8 +6680,53 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	double		num_skip_scans;
 	ListCell   *lc;
 
+	/*
+	 * If there are no quals on the leading index column(s), nbtree does a
+	 * skip scan: it descends once for each distinct value of those columns,
+	 * as if they had '=' quals, and skips over the tuples in between.  That
+	 * only pays off when there are few enough distinct values, which we
+	 * judge by whether the descents would touch fewer pages than reading the
+	 * whole index does.  If so, we can carry on as if the skipped columns
+	 * had '=' quals.
+	 *
+	 * Either way, we mark the path as one that may skip when executed.  With
+	 * many distinct prefixes, nbtree mostly steps from one to the next
+	 * without a new descent, so skipping costs little more than reading the
+	 * whole index.
+	 */
+	indexcol = 0;
+	eqQualHere = false;
+	num_skip_scans = 1;
+	if (enable_indexskipscan && path->indexclauses != NIL &&
+		linitial_node(IndexClause, path->indexclauses)->indexcol > 0)
+	{
+		int			nskip = linitial_node(IndexClause, path->indexclauses)->indexcol;
+		List	   *prefixExprs = NIL;
+		double		ndistinct;
+
+		path->indexskip = true;
+
+		foreach(lc, index->indextlist)
+		{
+			TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+			if (list_length(prefixExprs) >= nskip)
+				break;
+			prefixExprs = lappend(prefixExprs, tle->expr);
+		}
+		ndistinct = estimate_num_groups(root, prefixExprs, index->rel->tuples,
+										NULL, NULL);
+		if (ndistinct * (Max(index->tree_height, 0) + 1) < index->pages)
+		{
+			num_skip_scans = ndistinct;
+			indexcol = nskip;
+			eqQualHere = true;
+		}
+	}
+
 	/*
 	 * For a btree scan, only leading '=' quals plus inequality quals for the
 	 * immediately next attribute contribute to index selectivity (these are
@@ -6700,8 +6745,6 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * considered to act the same as it normally does.
 	 */
 	indexBoundQuals = NIL;
-	indexcol = 0;
-	eqQualHere = false;
 	found_saop = false;
 	found_is_null_op = false;
 	num_sa_scans = 1;
@@ -6792,7 +6835,8 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
-		!found_is_null_op)
+		!found_is_null_op &&
+		num_skip_scans == 1)
 		numIndexTuples = 1.0;
 	else
 	{
@@ -6812,6 +6856,14 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 												  NULL);
 		numIndexTuples = btreeSelectivity * index->rel->tuples;
 
+		/*
+		 * A skip scan reads at least one leaf page for each distinct prefix,
+		 * however selective the quals on the later columns are.
+		 */
+		if (num_skip_scans > 1 && index->pages > 0)
+			numIndexTuples = Max(numIndexTuples,
+								 num_skip_scans * index->tuples / index->pages);
+
 		/*
 		 * As in genericcostestimate(), we have to adjust for any
 		 * ScalarArrayOpExpr quals included in indexBoundQuals, and then round
@@ -6835,15 +6887,16 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * comparisons to descend a btree of N leaf tuples.  We charge one
 	 * cpu_operator_cost per comparison.
 	 *
-	 * If there are ScalarArrayOpExprs, charge this once per SA scan.  The
-	 * ones after the first one are not startup cost so far as the overall
-	 * plan is concerned, so add them only to "total" cost.
+	 * If there are ScalarArrayOpExprs, charge this once per SA scan, and
+	 * likewise once per distinct prefix in a skip scan.  The ones after the
+	 * first one are not startup cost so far as the overall plan is
+	 * concerned, so add them only to "total" cost.
 	 */
 	if (index->tuples > 1)		/* avoid computing log(0) */
 	{
 		descentCost = ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
 		costs.indexStartupCost += descentCost;
-		costs.indexTotalCost += costs.num_sa_scans * descentCost;
+		costs.indexTotalCost += costs.num_sa_scans * num_skip_scans * descentCost;
 	}
 
 	/*
@@ -6854,11 +6907,12 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * in cases where only a single leaf page is expected to be visited.  This
 	 * cost is somewhat arbitrarily set at 50x cpu_operator_cost per page
 	 * touched.  The number of such pages is btree tree height plus one (ie,
-	 * we charge for the leaf page too).  As above, charge once per SA scan.
+	 * we charge for the leaf page too).  As above, charge once per SA scan
+	 * and skipped prefix.
 	 */
 	descentCost = (index->tree_height + 1) * 50.0 * cpu_operator_cost;
 	costs.indexStartupCost += descentCost;
-	costs.indexTotalCost += costs.num_sa_scans * descentCost;
+	costs.indexTotalCost += costs.num_sa_scans * num_skip_scans * descentCost;
 
 	/*
 	 * If we can get an estimate of the first column's ordering correlation C
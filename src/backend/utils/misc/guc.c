@@ -43,6 +43,7 @@
 #include "access/xlog_internal.h"
 #include "access/xlogprefetcher.h"
 #include "access/xlogrecovery.h"
+#include "access/xlogredoworker.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
 #include "catalog/pg_authid.h"
@@ -56,6 +57,7 @@
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "common/string.h"
+#include "executor/execBatch.h"
 #include "funcapi.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
@@ -217,6 +219,7 @@ static bool check_autovacuum_work_mem(int *newval, void **extra, GucSource sourc
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
 static bool check_maintenance_io_concurrency(int *newval, void **extra, GucSource source);
 static bool check_huge_page_size(int *newval, void **extra, GucSource source);
+static bool check_numa_shared_buffers(bool *newval, void **extra, GucSource source);
 static bool check_client_connection_check_interval(int *newval, void **extra, GucSource source);
 static void assign_maintenance_io_concurrency(int newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
@@ -510,6 +513,14 @@ static const struct config_enum_entry recovery_prefetch_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry io_method_options[] = {
+	{"sync", IO_METHOD_SYNC, false},
+#ifdef USE_IO_URING
+	{"io_uring", IO_METHOD_IO_URING, false},
+#endif
+	{NULL, 0, false}
+};
+
 static const struct config_enum_entry force_parallel_mode_options[] = {
 	{"off", FORCE_PARALLEL_OFF, false},
 	{"on", FORCE_PARALLEL_ON, false},
@@ -1042,6 +1053,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_indexskipscan", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables index scans that skip over leading columns without quals."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_indexskipscan,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_bitmapscan", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of bitmap-scan plans."),
@@ -1122,6 +1143,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_adaptive_join", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables nested-loop joins that switch to hashing when the outer side is larger than estimated."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_adaptive_join,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_mergejoin", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of merge join plans."),
@@ -1142,6 +1173,26 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_radix_hashjoin", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables radix partitioning of large in-memory hash join tables."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_radix_hashjoin,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_runtime_filter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables pushing Bloom filters built by hash joins down to outer-side scans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_runtime_filter,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_gathermerge", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of gather merge plans."),
@@ -1192,6 +1243,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel-aware hashed aggregation."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_hashagg,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_partition_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables plan-time and execution-time partition pruning."),
@@ -1214,6 +1275,17 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_batch_execution", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the executor's use of batch-at-a-time execution."),
+			gettext_noop("Plain aggregates over sequential scans then process "
+						 "their input in batches of rows where possible."),
+			GUC_EXPLAIN
+		},
+		&enable_batch_execution,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_group_by_reordering", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("enable reordering of GROUP BY key"),
@@ -1291,6 +1363,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"numa_shared_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Places shared buffers on NUMA nodes in stripes."),
+			gettext_noop("Each NUMA node holds an equal part of the buffer pool, "
+						 "and backends prefer to replace buffers on their own node.")
+		},
+		&numa_shared_buffers,
+		false,
+		check_numa_shared_buffers, NULL, NULL
+	},
 	{
 		{"fsync", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Forces synchronization of updates to disk."),
@@ -2650,6 +2732,17 @@ static struct config_int ConfigureNamesInt[] =
 	},
 #endif
 
+	{
+		{"radix_hashjoin_threshold", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Sets the hash table size above which hash joins are radix partitioned."),
+			gettext_noop("Only has an effect if enable_radix_hashjoin is on."),
+			GUC_NOT_IN_SAMPLE | GUC_UNIT_KB | GUC_EXPLAIN
+		},
+		&radix_hashjoin_threshold,
+		16384, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"statement_timeout", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets the maximum allowed duration of any statement."),
@@ -2846,6 +2939,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"recovery_redo_workers", PGC_POSTMASTER, WAL_RECOVERY,
+			gettext_noop("Sets the number of background workers that replay WAL during recovery."),
+			gettext_noop("Zero means that the startup process replays all WAL by itself.")
+		},
+		&recovery_redo_workers,
+		0, 0, 64,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_keep_size", PGC_SIGHUP, REPLICATION_SENDING,
 			gettext_noop("Sets the size of WAL files held for standby servers."),
@@ -3173,6 +3276,20 @@ static struct config_int ConfigureNamesInt[] =
 		NULL
 	},
 
+	{
+		{"io_combine_limit",
+			PGC_USERSET,
+			RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Limit on the size of data reads and writes."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&io_combine_limit,
+		DEFAULT_IO_COMBINE_LIMIT,
+		1, MAX_IO_COMBINE_LIMIT,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"backend_flush_after", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
 			gettext_noop("Number of pages after which previously performed writes are flushed to disk."),
@@ -5052,6 +5169,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		check_recovery_prefetch, assign_recovery_prefetch, NULL
 	},
 
+	{
+		{"io_method", PGC_SIGHUP, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Selects the method used for batches of data file reads and writes."),
+			NULL
+		},
+		&io_method,
+		IO_METHOD_SYNC, io_method_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"force_parallel_mode", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Forces use of parallel query facilities."),
@@ -12560,6 +12687,19 @@ check_huge_page_size(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_numa_shared_buffers(bool *newval, void **extra, GucSource source)
+{
+#ifndef HAVE_LINUX_MEMPOLICY_H
+	if (*newval)
+	{
+		GUC_check_errdetail("numa_shared_buffers is not supported on this platform.");
+		return false;
+	}
+#endif
+	return true;
+}
+
 static bool
 check_client_connection_check_interval(int *newval, void **extra, GucSource source)
 {
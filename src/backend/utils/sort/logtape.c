@@ -1153,11 +1153,40 @@ LogicalTapeSeek(LogicalTape *lt, long blocknum, int offset)
 	lt->pos = offset;
 }
 
+/*
+ * Start reading an imported tape at an arbitrary position.
+ *
+ * This is the counterpart of LogicalTapeSeek() for tapes that are not
+ * frozen, such as worker tapes imported into another process.  The tape must
+ * have been rewound for reading, and nothing may have been read from it yet;
+ * reading then proceeds forward from the given position, using the full read
+ * buffer.  blocknum and offset must have been obtained with LogicalTapeTell()
+ * by the process that wrote the tape, while writing it or after freezing it.
+ */
+void
+LogicalTapeSeekImported(LogicalTape *lt, long blocknum, int offset)
+{
+	Assert(!lt->writing && !lt->frozen);
+	Assert(lt->buffer_size > 0);
+	Assert(offset >= 0 && offset <= TapeBlockPayloadSize);
+
+	if (lt->buffer == NULL)
+		lt->buffer = palloc(lt->buffer_size);
+
+	/* Fill the buffer starting at the given block */
+	lt->nextBlockNumber = blocknum;
+	if (!ltsReadFillBuffer(lt) || offset > lt->nbytes)
+		elog(ERROR, "invalid tape seek position");
+	lt->pos = offset;
+}
+
 /*
  * Obtain current position in a form suitable for a later LogicalTapeSeek.
  *
- * NOTE: it'd be OK to do this during write phase with intention of using
- * the position for a seek after freezing.  Not clear if anyone needs that.
+ * This is also OK during write phase with intention of using the position
+ * for a seek after freezing, or for LogicalTapeSeekImported() in a process
+ * that imports the frozen tape.  tuplesort.c does that to find partition
+ * boundaries in worker runs.  At least one byte must have been written.
  */
 void
 LogicalTapeTell(LogicalTape *lt, long *blocknum, int *offset)
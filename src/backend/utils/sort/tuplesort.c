@@ -86,6 +86,14 @@
  * worker process.  This is then merged.  Worker processes are guaranteed to
  * produce exactly one output run from their partial input.
  *
+ * In B-Tree index builds with more than one participant, the workers also
+ * take over the final merge from the leader.  Each participant samples the
+ * leading keys of its run; all participants derive the same splitter keys
+ * from the samples of all runs, dividing the key range into one partition
+ * per participant.  Every participant then merges the parts of all runs that
+ * fall into its own partition, and the leader merely reads the merged
+ * partitions one after the other.  See worker_partition_merge().
+ *
  *
  * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -109,6 +117,8 @@
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "pgstat.h"
+#include "storage/condition_variable.h"
 #include "utils/datum.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
@@ -236,6 +246,63 @@ typedef enum
 #define TAPE_BUFFER_OVERHEAD		BLCKSZ
 #define MERGE_BUFFER_SIZE			(BLCKSZ * 32)
 
+/*
+ * Parameters of the partitioned merge performed by workers (see
+ * worker_partition_merge()).  While writing its final run, a worker notes the
+ * tape position of up to RUN_INDEX_SIZE evenly spaced tuples.  It publishes
+ * the leading keys of up to PARTITION_SAMPLES of them, in at most
+ * PARTITION_SAMPLE_SPACE bytes.  Sorts of fewer than
+ * PARTITION_MERGE_MIN_TUPLES tuples in total are merged by the leader, as
+ * usual.
+ */
+#define RUN_INDEX_SIZE				4096
+#define PARTITION_SAMPLES			128
+#define PARTITION_SAMPLE_SPACE		8192
+#define PARTITION_MERGE_MIN_TUPLES	10000
+
+/*
+ * A position in a worker's final run: the tape position at which the tuple
+ * numbered ordinal (counting from 0) starts.
+ */
+typedef struct RunPosition
+{
+	int64		ordinal;
+	long		blocknum;		/* as returned by LogicalTapeTell() */
+	int			offset;
+} RunPosition;
+
+/*
+ * Per-participant state of a partitioned merge, in shared memory.
+ *
+ * Each participant publishes the leading keys sampled from its run in a
+ * RunSample, and where each partition begins in its run in an array of
+ * RunBounds, one per partition.  A bound with blocknum -1 denotes the
+ * start of the run.
+ */
+typedef struct RunSample
+{
+	int64		ntuples;		/* number of tuples in the run */
+	int			nsamples;		/* number of keys in data */
+	char		data[PARTITION_SAMPLE_SPACE];	/* datumSerialize()'d keys */
+} RunSample;
+
+typedef struct RunBound
+{
+	int64		ntuples;		/* number of tuples in the partition */
+	long		blocknum;		/* position of first tuple */
+	int			offset;
+} RunBound;
+
+/*
+ * A sampled leading key, with the number of tuples it stands for.
+ */
+typedef struct SplitterKey
+{
+	Datum		value;
+	bool		isnull;
+	int64		weight;
+} SplitterKey;
+
 typedef int (*SortTupleComparator) (const SortTuple *a, const SortTuple *b,
 									Tuplesortstate *state);
 
@@ -399,6 +466,8 @@ struct Tuplesortstate
 	 */
 	LogicalTape *result_tape;	/* actual tape of finished output */
 	int			current;		/* array index (only used if SORTEDINMEM) */
+	int			nPartitions;	/* # of partition tapes (only in leader) */
+	int			curPartition;	/* index of result_tape among them */
 	bool		eof_reached;	/* reached EOF (needed for cursors) */
 
 	/* markpos_xxx holds marked position for mark and restore */
@@ -426,6 +495,18 @@ struct Tuplesortstate
 	Sharedsort *shared;
 	int			nParticipants;
 
+	/*
+	 * These variables are used by workers that take part in a partitioned
+	 * merge (see worker_partition_merge()).  While the final run is written,
+	 * runIndex notes the position of every runStride'th tuple, and runTuples
+	 * counts the tuples written so far.
+	 */
+	bool		partitionMerge;
+	RunPosition *runIndex;
+	int			nRunIndex;
+	int64		runStride;
+	int64		runTuples;
+
 	/*
 	 * The sortKeys variable is used by every case other than the hash index
 	 * case; it is set by tuplesort_begin_xxx.  tupDesc is only used by the
@@ -512,6 +593,19 @@ struct Sharedsort
 	int			currentWorker;
 	int			workersFinished;
 
+	/*
+	 * Participants of a partitioned merge wait for one another on cv.
+	 * nLaunched is the number of participants, set by the leader once
+	 * workers have been launched (0 until then).  nSampled and nBounded
+	 * count participants that have published their samples and partition
+	 * bounds, and nMerged those that have merged their partition.
+	 */
+	int			nLaunched;
+	int			nSampled;
+	int			nBounded;
+	int			nMerged;
+	ConditionVariable cv;
+
 	/* Temporary file space */
 	SharedFileSet fileset;
 
@@ -523,8 +617,25 @@ struct Sharedsort
 	 * leader to concatenate all worker tapes into one for merging
 	 */
 	TapeShare	tapes[FLEXIBLE_ARRAY_MEMBER];
+
+	/*
+	 * The tapes array is followed by the state of a partitioned merge:
+	 * nTapes RunSamples, nTapes * nTapes RunBounds (those of participant i's
+	 * run start at i * nTapes), and nTapes TapeShares of the merged
+	 * partitions.
+	 */
 };
 
+#define SharedsortSamples(shared) \
+	((RunSample *) ((char *) (shared) + \
+					MAXALIGN(offsetof(Sharedsort, tapes) + \
+							 sizeof(TapeShare) * (shared)->nTapes)))
+#define SharedsortBounds(shared) \
+	((RunBound *) (SharedsortSamples(shared) + (shared)->nTapes))
+#define SharedsortMerged(shared) \
+	((TapeShare *) (SharedsortBounds(shared) + \
+					(shared)->nTapes * (shared)->nTapes))
+
 /*
  * Is the given tuple allocated from the slab memory arena?
  */
@@ -674,6 +785,16 @@ static void readtup_datum(Tuplesortstate *state, SortTuple *stup,
 static int	worker_get_identifier(Tuplesortstate *state);
 static void worker_freeze_result_tape(Tuplesortstate *state);
 static void worker_nomergeruns(Tuplesortstate *state);
+static void worker_begin_run_index(Tuplesortstate *state);
+static void worker_note_run_position(Tuplesortstate *state);
+static void worker_partition_merge(Tuplesortstate *state);
+static int	worker_wait_participants(Tuplesortstate *state, int *counter);
+static void worker_read_run_tuple(Tuplesortstate *state, RunPosition *pos,
+								  SortTuple *stup);
+static RunPosition worker_find_partition_start(Tuplesortstate *state,
+											   SplitterKey *splitter,
+											   RunPosition start, int nvalid);
+static int	partition_key_cmp(const void *a, const void *b, void *arg);
 static void leader_takeover_tapes(Tuplesortstate *state);
 static void free_sort_tuple(Tuplesortstate *state, SortTuple *stup);
 static void tuplesort_free(Tuplesortstate *state);
@@ -822,6 +943,182 @@ qsort_tuple_int32_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
 #define ST_DEFINE
 #include "lib/sort_template.h"
 
+/*
+ * Radix sort on datum1.
+ *
+ * When the leading key's comparator is one of the specialized ones above,
+ * datum1 holds either the key itself or an order-preserving abbreviation of
+ * it, and can be turned into an unsigned integer whose byte-wise order is
+ * the sort order: flip the sign bit of signed values, and all bits for a
+ * descending sort.  A large input is then sorted with an in-place MSD radix
+ * sort on those normalized keys, one byte at a time.  Buckets that become
+ * small, and runs of equal keys that might still need the tiebreak, are
+ * left to the matching qsort specialization.
+ */
+#define RADIX_SORT_MIN_TUPLES	16384	/* use radix sort for this many */
+#define RADIX_SORT_CUTOFF		64	/* sort smaller buckets by comparison */
+
+typedef void (*RadixSortFallback) (SortTuple *tuples, size_t n,
+								   Tuplesortstate *state);
+
+typedef struct RadixSortKey
+{
+	uint64		mask;			/* XORed into keys to normalize them */
+	int			nbytes;			/* number of significant bytes */
+	RadixSortFallback fallback; /* comparison sort for the same key */
+} RadixSortKey;
+
+static inline int
+radix_key_byte(const SortTuple *tuple, const RadixSortKey *key, int level)
+{
+	uint64		k;
+
+	if (key->nbytes == sizeof(int32))
+		k = (uint32) DatumGetInt32(tuple->datum1);
+	else
+		k = (uint64) tuple->datum1;
+	k ^= key->mask;
+
+	return (k >> ((key->nbytes - 1 - level) * BITS_PER_BYTE)) & 0xFF;
+}
+
+static void
+radix_sort_tuple(SortTuple *tuples, size_t n, int level,
+				 const RadixSortKey *key, Tuplesortstate *state)
+{
+	size_t		counts[256];
+	size_t		next[256];
+	size_t		end[256];
+	size_t		offset;
+
+	CHECK_FOR_INTERRUPTS();
+
+	for (;;)
+	{
+		if (n < RADIX_SORT_CUTOFF)
+		{
+			key->fallback(tuples, n, state);
+			return;
+		}
+
+		/*
+		 * All the keys are equal.  Unless datum1 was the only key, we still
+		 * have to sort on the remaining ones.
+		 */
+		if (level == key->nbytes)
+		{
+			if (state->onlyKey == NULL)
+				key->fallback(tuples, n, state);
+			return;
+		}
+
+		memset(counts, 0, sizeof(counts));
+		for (size_t i = 0; i < n; i++)
+			counts[radix_key_byte(&tuples[i], key, level)]++;
+
+		/* skip bytes common to all the keys without moving anything */
+		if (counts[radix_key_byte(&tuples[0], key, level)] < n)
+			break;
+		level++;
+	}
+
+	offset = 0;
+	for (int b = 0; b < 256; b++)
+	{
+		next[b] = offset;
+		offset += counts[b];
+		end[b] = offset;
+	}
+
+	/* move each tuple into its bucket, following cycles of displacement */
+	for (int b = 0; b < 256; b++)
+	{
+		while (next[b] < end[b])
+		{
+			SortTuple	tuple = tuples[next[b]];
+			int			d = radix_key_byte(&tuple, key, level);
+
+			while (d != b)
+			{
+				SortTuple	tmp = tuples[next[d]];
+
+				tuples[next[d]++] = tuple;
+				tuple = tmp;
+				d = radix_key_byte(&tuple, key, level);
+			}
+			tuples[next[b]++] = tuple;
+		}
+	}
+
+	offset = 0;
+	for (int b = 0; b < 256; b++)
+	{
+		if (counts[b] > 1)
+			radix_sort_tuple(tuples + offset, counts[b], level + 1, key, state);
+		offset += counts[b];
+	}
+}
+
+/*
+ * Sort memtuples with a radix sort on datum1, see above.  signbit is the
+ * sign bit of the key if it's signed, else zero.
+ */
+static void
+radix_sort_memtuples(Tuplesortstate *state, uint64 signbit, int nbytes,
+					 RadixSortFallback fallback)
+{
+	SortSupport sortKey = &state->sortKeys[0];
+	SortTuple  *tuples = state->memtuples;
+	size_t		n = state->memtupcount;
+	size_t		nnulls = 0;
+	SortTuple  *values;
+	RadixSortKey key;
+
+	key.mask = signbit;
+	if (sortKey->ssup_reverse)
+		key.mask ^= (nbytes == sizeof(uint64)) ? PG_UINT64_MAX : PG_UINT32_MAX;
+	key.nbytes = nbytes;
+	key.fallback = fallback;
+
+	/* Move the NULLs to whichever end they belong to */
+	if (sortKey->ssup_nulls_first)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			if (tuples[i].isnull1)
+			{
+				SortTuple	tmp = tuples[i];
+
+				tuples[i] = tuples[nnulls];
+				tuples[nnulls++] = tmp;
+			}
+		}
+		values = tuples + nnulls;
+	}
+	else
+	{
+		for (size_t i = n; i > 0; i--)
+		{
+			if (tuples[i - 1].isnull1)
+			{
+				SortTuple	tmp = tuples[i - 1];
+
+				tuples[i - 1] = tuples[n - 1 - nnulls];
+				tuples[n - 1 - nnulls++] = tmp;
+			}
+		}
+		values = tuples;
+	}
+
+	/* the NULLs only need sorting on the remaining keys */
+	if (nnulls > 1 && state->onlyKey == NULL)
+		fallback(sortKey->ssup_nulls_first ? tuples : tuples + n - nnulls,
+				 nnulls, state);
+
+	if (n - nnulls > 1)
+		radix_sort_tuple(values, n - nnulls, 0, &key, state);
+}
+
 /*
  *		tuplesort_begin_xxx
  *
@@ -1251,6 +1548,9 @@ tuplesort_begin_index_btree(Relation heapRel,
 	state->enforceUnique = enforceUnique;
 	state->uniqueNullsNotDistinct = uniqueNullsNotDistinct;
 
+	/* Workers merge partitions of the output themselves */
+	state->partitionMerge = WORKER(state);
+
 	indexScanKey = _bt_mkscankey(indexRel, NULL);
 
 	/* Prepare SortSupport data for each column */
@@ -1534,6 +1834,36 @@ tuplesort_used_bound(Tuplesortstate *state)
 	return state->boundUsed;
 }
 
+/*
+ * tuplesort_get_bound_key
+ *
+ * In a bounded sort that has collected as many tuples as the bound, return
+ * the leading sort key of the last tuple that will be output.  No input
+ * tuple whose leading key sorts after it can affect the result.  Returns
+ * false if no such key is known (yet).
+ *
+ * A pass-by-reference key points into tuplesort memory, so the caller must
+ * copy it before adding more tuples.
+ */
+bool
+tuplesort_get_bound_key(Tuplesortstate *state, Datum *key, bool *isnull)
+{
+	SortTuple  *stup;
+
+	/* the bounded heap has its largest entry on top */
+	if (state->status == TSS_BOUNDED)
+		stup = &state->memtuples[0];
+	else if (state->status == TSS_SORTEDINMEM && state->boundUsed)
+		stup = &state->memtuples[state->memtupcount - 1];
+	else
+		return false;
+
+	/* bounded sorts never use abbreviated keys, so datum1 is the real key */
+	*key = stup->datum1;
+	*isnull = stup->isnull1;
+	return true;
+}
+
 /*
  * tuplesort_free
  *
@@ -2225,18 +2555,25 @@ tuplesort_performsort(Tuplesortstate *state)
 				 * merge is required to produce single output run, though.
 				 */
 				inittapes(state, false);
+				if (state->partitionMerge)
+					worker_begin_run_index(state);
 				dumptuples(state, true);
 				worker_nomergeruns(state);
 				state->status = TSS_SORTEDONTAPE;
+				if (state->partitionMerge)
+					worker_partition_merge(state);
 			}
 			else
 			{
 				/*
-				 * Leader will take over worker tapes and merge worker runs.
-				 * Note that mergeruns sets the correct state->status.
+				 * Leader will take over worker tapes and merge worker runs,
+				 * unless the workers have already merged partitions of the
+				 * output.  Note that mergeruns sets the correct
+				 * state->status.
 				 */
 				leader_takeover_tapes(state);
-				mergeruns(state);
+				if (state->status == TSS_BUILDRUNS)
+					mergeruns(state);
 			}
 			state->current = 0;
 			state->eof_reached = false;
@@ -2270,6 +2607,8 @@ tuplesort_performsort(Tuplesortstate *state)
 			 */
 			dumptuples(state, true);
 			mergeruns(state);
+			if (state->partitionMerge)
+				worker_partition_merge(state);
 			state->eof_reached = false;
 			state->markpos_block = 0L;
 			state->markpos_offset = 0;
@@ -2378,7 +2717,18 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 				if (state->eof_reached)
 					return false;
 
-				if ((tuplen = getlen(state->result_tape, true)) != 0)
+				tuplen = getlen(state->result_tape, true);
+				while (tuplen == 0 &&
+					   state->curPartition + 1 < state->nPartitions)
+				{
+					/* Continue with the next partition merged by a worker */
+					LogicalTapeClose(state->result_tape);
+					state->result_tape =
+						state->outputTapes[++state->curPartition];
+					tuplen = getlen(state->result_tape, true);
+				}
+
+				if (tuplen != 0)
 				{
 					READTUP(state, stup, state->result_tape, tuplen);
 
@@ -3129,6 +3479,14 @@ mergeruns(Tuplesortstate *state)
 			for (tapenum = 0; tapenum < state->nInputTapes; tapenum++)
 				LogicalTapeRewindForRead(state->inputTapes[tapenum], input_buffer_size);
 
+			/*
+			 * In a worker, the last pass writes the final run.  Note tuple
+			 * positions in it, if a partitioned merge is to follow.
+			 */
+			if (state->partitionMerge &&
+				state->nInputRuns <= state->nInputTapes)
+				worker_begin_run_index(state);
+
 			/*
 			 * If there's just one run left on each input tape, then only one
 			 * merge pass remains.  If we don't have to produce a materialized
@@ -3205,6 +3563,8 @@ mergeonerun(Tuplesortstate *state)
 		srcTapeIndex = state->memtuples[0].srctape;
 		srcTape = state->inputTapes[srcTapeIndex];
 		WRITETUP(state, state->destTape, &state->memtuples[0]);
+		if (state->runIndex)
+			worker_note_run_position(state);
 
 		/* recycle the slot of the tuple we just wrote out, for the next read */
 		if (state->memtuples[0].tuple)
@@ -3351,6 +3711,8 @@ dumptuples(Tuplesortstate *state, bool alltuples)
 	for (i = 0; i < memtupwrite; i++)
 	{
 		WRITETUP(state, state->destTape, &state->memtuples[i]);
+		if (state->runIndex)
+			worker_note_run_position(state);
 		state->memtupcount--;
 	}
 
@@ -3665,25 +4027,37 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 		{
 			if (state->sortKeys[0].comparator == ssup_datum_unsigned_cmp)
 			{
-				qsort_tuple_unsigned(state->memtuples,
-									 state->memtupcount,
-									 state);
+				if (state->memtupcount >= RADIX_SORT_MIN_TUPLES)
+					radix_sort_memtuples(state, 0, sizeof(Datum),
+										 qsort_tuple_unsigned);
+				else
+					qsort_tuple_unsigned(state->memtuples,
+										 state->memtupcount,
+										 state);
 				return;
 			}
 #if SIZEOF_DATUM >= 8
 			else if (state->sortKeys[0].comparator == ssup_datum_signed_cmp)
 			{
-				qsort_tuple_signed(state->memtuples,
-								   state->memtupcount,
-								   state);
+				if (state->memtupcount >= RADIX_SORT_MIN_TUPLES)
+					radix_sort_memtuples(state, UINT64CONST(1) << 63,
+										 sizeof(int64), qsort_tuple_signed);
+				else
+					qsort_tuple_signed(state->memtuples,
+									   state->memtupcount,
+									   state);
 				return;
 			}
 #endif
 			else if (state->sortKeys[0].comparator == ssup_datum_int32_cmp)
 			{
-				qsort_tuple_int32(state->memtuples,
-								  state->memtupcount,
-								  state);
+				if (state->memtupcount >= RADIX_SORT_MIN_TUPLES)
+					radix_sort_memtuples(state, UINT64CONST(1) << 31,
+										 sizeof(int32), qsort_tuple_int32);
+				else
+					qsort_tuple_int32(state->memtuples,
+									  state->memtupcount,
+									  state);
 				return;
 			}
 		}
@@ -4685,6 +5059,14 @@ tuplesort_estimate_shared(int nWorkers)
 	tapesSize = mul_size(sizeof(TapeShare), nWorkers);
 	tapesSize = MAXALIGN(add_size(tapesSize, offsetof(Sharedsort, tapes)));
 
+	/* State of a partitioned merge follows; see SharedsortSamples() */
+	tapesSize = add_size(tapesSize,
+						 mul_size(sizeof(RunSample), nWorkers));
+	tapesSize = add_size(tapesSize,
+						 mul_size(sizeof(RunBound),
+								  mul_size(nWorkers, nWorkers)));
+	tapesSize = add_size(tapesSize, mul_size(sizeof(TapeShare), nWorkers));
+
 	return tapesSize;
 }
 
@@ -4705,14 +5087,44 @@ tuplesort_initialize_shared(Sharedsort *shared, int nWorkers, dsm_segment *seg)
 	SpinLockInit(&shared->mutex);
 	shared->currentWorker = 0;
 	shared->workersFinished = 0;
+	shared->nLaunched = 0;
+	shared->nSampled = 0;
+	shared->nBounded = 0;
+	shared->nMerged = 0;
+	ConditionVariableInit(&shared->cv);
 	SharedFileSetInit(&shared->fileset, seg);
 	shared->nTapes = nWorkers;
 	for (i = 0; i < nWorkers; i++)
 	{
 		shared->tapes[i].firstblocknumber = 0L;
+		SharedsortSamples(shared)[i].ntuples = 0;
+		SharedsortSamples(shared)[i].nsamples = 0;
+		SharedsortMerged(shared)[i].firstblocknumber = 0L;
 	}
 }
 
+/*
+ * tuplesort_launched_shared - report number of participants
+ *
+ * Must be called from leader process once workers have been launched, with
+ * the number of participants known launched, including any worker state held
+ * by the leader itself (this is the same number the leader later passes in
+ * its coordinate argument).  Participants of a partitioned merge wait for one
+ * another within tuplesort_performsort(), so they need to know how many of
+ * them there are.
+ */
+void
+tuplesort_launched_shared(Sharedsort *shared, int nParticipants)
+{
+	Assert(nParticipants > 0 && nParticipants <= shared->nTapes);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->nLaunched = nParticipants;
+	SpinLockRelease(&shared->mutex);
+
+	ConditionVariableBroadcast(&shared->cv);
+}
+
 /*
  * tuplesort_attach_shared - attach to shared tuplesort state
  *
@@ -4815,6 +5227,497 @@ worker_nomergeruns(Tuplesortstate *state)
 	worker_freeze_result_tape(state);
 }
 
+/*
+ * worker_begin_run_index - start noting tuple positions in the final run
+ *
+ * Called just before a worker that takes part in a partitioned merge writes
+ * its final run.  See worker_note_run_position().
+ */
+static void
+worker_begin_run_index(Tuplesortstate *state)
+{
+	Assert(WORKER(state));
+
+	state->runIndex = (RunPosition *)
+		MemoryContextAlloc(state->sortcontext,
+						   RUN_INDEX_SIZE * sizeof(RunPosition));
+	state->nRunIndex = 0;
+	state->runStride = 1;
+	state->runTuples = 0;
+}
+
+/*
+ * worker_note_run_position - account for a tuple written to the final run
+ *
+ * After every runStride'th tuple, notes the tape position, which is where the
+ * next tuple starts.  Once RUN_INDEX_SIZE positions have been noted, every
+ * other one is discarded and the stride doubles, so that the noted positions
+ * remain evenly spaced over the whole run.
+ */
+static void
+worker_note_run_position(Tuplesortstate *state)
+{
+	RunPosition *pos;
+
+	if (++state->runTuples % state->runStride != 0)
+		return;
+
+	if (state->nRunIndex == RUN_INDEX_SIZE)
+	{
+		int			i;
+
+		for (i = 1; i < RUN_INDEX_SIZE; i += 2)
+			state->runIndex[i / 2] = state->runIndex[i];
+		state->nRunIndex = RUN_INDEX_SIZE / 2;
+		state->runStride *= 2;
+
+		if (state->runTuples % state->runStride != 0)
+			return;
+	}
+
+	pos = &state->runIndex[state->nRunIndex++];
+	pos->ordinal = state->runTuples;
+	LogicalTapeTell(state->destTape, &pos->blocknum, &pos->offset);
+}
+
+/*
+ * worker_partition_merge - merge one partition of the output in a worker
+ *
+ * Called by every participant of a parallel B-Tree index build once its
+ * final run has been frozen.  Rather than leaving the merge of all runs to
+ * the leader, the participants divide the key range into as many partitions
+ * as there are participants.  Each of them merges the tuples of all runs
+ * that fall into one partition onto a tape of its own, so that the leader
+ * only needs to read the merged partitions in order.  This takes three
+ * steps, the first two of which end with waiting for all participants:
+ *
+ * 1. Publish the leading keys of evenly spaced tuples of our run, found
+ *    through the positions noted in runIndex while the run was written.
+ *
+ * 2. Choose splitter keys from the samples of all participants.  Since
+ *    everybody chooses from the same samples in the same way, all
+ *    participants arrive at the same splitters.  Find where each partition
+ *    begins in our run, and publish that.
+ *
+ * 3. Merge the part of every run that belongs to the partition numbered
+ *    after our worker number, and freeze the result for the leader.
+ *
+ * Partitions are defined by the leading key alone, so all tuples with equal
+ * leading keys end up in the same partition.  A skewed distribution of
+ * leading keys thus only makes the partitions less balanced, and the
+ * comparisons made while merging a partition still see all duplicates when
+ * enforcing uniqueness.
+ *
+ * Small sorts are left to the leader, in which case this returns without
+ * merging anything.  All participants come to the same decision.
+ */
+static void
+worker_partition_merge(Tuplesortstate *state)
+{
+	Sharedsort *shared = state->shared;
+	RunSample *samples = SharedsortSamples(shared);
+	RunSample *mysample = &samples[state->worker];
+	RunBound *bounds;
+	Form_pg_attribute keyattr;
+	SplitterKey *keys;
+	SplitterKey *splitters;
+	RunPosition start;
+	LogicalTapeSet *inputset;
+	LogicalTapeSet *outputset;
+	LogicalTape **inputs;
+	LogicalTape *output;
+	TapeShare	merged;
+	int64	   *remaining;
+	int64		input_buffer_size;
+	int64		totalTuples;
+	int64		totalWeight;
+	int64		weight;
+	char	   *ptr;
+	int			nParticipants;
+	int			nvalid;
+	int			nsamples;
+	int			nkeys;
+	int			ninputs;
+	int			i;
+	int			j;
+	int			w;
+
+	Assert(WORKER(state));
+	Assert(state->status == TSS_SORTEDONTAPE);
+	Assert(state->runIndex != NULL);
+
+	/*
+	 * Tuples read back from tape have the original leading key in datum1.
+	 * Disable abbreviation from this point on, as mergeruns() does.
+	 */
+	if (state->sortKeys->abbrev_converter != NULL)
+	{
+		state->sortKeys->abbrev_converter = NULL;
+		state->sortKeys->comparator = state->sortKeys->abbrev_full_comparator;
+		state->sortKeys->abbrev_abort = NULL;
+		state->sortKeys->abbrev_full_comparator = NULL;
+	}
+
+	/*
+	 * Reading tuples back requires the slab allocator, with a slot for each
+	 * run being merged, plus one.  Any slab left over from our own merge no
+	 * longer holds tuples.
+	 */
+	if (state->slabAllocatorUsed && state->slabMemoryBegin)
+		pfree(state->slabMemoryBegin);
+	init_slab_allocator(state, state->tuples ? shared->nTapes + 1 : 0);
+
+	/*
+	 * Step 1: publish samples.  The last noted position can be the end of
+	 * the run, which has no tuple to sample.
+	 */
+	nvalid = state->nRunIndex;
+	if (nvalid > 0 && state->runIndex[nvalid - 1].ordinal >= state->runTuples)
+		nvalid--;
+	nsamples = Min(nvalid, PARTITION_SAMPLES);
+	keyattr = TupleDescAttr(RelationGetDescr(state->indexRel), 0);
+
+	mysample->ntuples = state->runTuples;
+	mysample->nsamples = 0;
+	ptr = mysample->data;
+	for (i = 0; i < nsamples; i++)
+	{
+		SortTuple	stup;
+		Size		size;
+
+		worker_read_run_tuple(state,
+							  &state->runIndex[(int64) i * nvalid / nsamples],
+							  &stup);
+		size = datumEstimateSpace(stup.datum1, stup.isnull1,
+								  keyattr->attbyval, keyattr->attlen);
+		if (ptr + size <= mysample->data + PARTITION_SAMPLE_SPACE)
+		{
+			datumSerialize(stup.datum1, stup.isnull1,
+						   keyattr->attbyval, keyattr->attlen, &ptr);
+			mysample->nsamples++;
+		}
+		if (stup.tuple)
+			RELEASE_SLAB_SLOT(state, stup.tuple);
+	}
+
+	nParticipants = worker_wait_participants(state, &shared->nSampled);
+
+	totalTuples = 0;
+	nkeys = 0;
+	for (w = 0; w < nParticipants; w++)
+	{
+		totalTuples += samples[w].ntuples;
+		nkeys += samples[w].nsamples;
+	}
+	if (nParticipants < 2 || nkeys == 0 ||
+		totalTuples < PARTITION_MERGE_MIN_TUPLES)
+		return;
+
+	/*
+	 * Step 2: choose splitters that divide the sampled keys, each weighted by
+	 * the number of tuples it stands for, into nParticipants partitions of
+	 * about equal size.  Partition j holds the tuples whose leading key is
+	 * greater than splitter j - 1 and not greater than splitter j.
+	 */
+	keys = (SplitterKey *) palloc(nkeys * sizeof(SplitterKey));
+	nkeys = 0;
+	totalWeight = 0;
+	for (w = 0; w < nParticipants; w++)
+	{
+		if (samples[w].nsamples == 0)
+			continue;
+
+		weight = Max(samples[w].ntuples / samples[w].nsamples, 1);
+		ptr = samples[w].data;
+		for (i = 0; i < samples[w].nsamples; i++)
+		{
+			keys[nkeys].value = datumRestore(&ptr, &keys[nkeys].isnull);
+			keys[nkeys].weight = weight;
+			totalWeight += weight;
+			nkeys++;
+		}
+	}
+	qsort_arg(keys, nkeys, sizeof(SplitterKey), partition_key_cmp,
+			  state->sortKeys);
+
+	splitters = (SplitterKey *)
+		palloc((nParticipants - 1) * sizeof(SplitterKey));
+	weight = 0;
+	j = 0;
+	for (i = 0; i < nkeys; i++)
+	{
+		weight += keys[i].weight;
+		while (j < nParticipants - 1 &&
+			   weight * nParticipants >= totalWeight * (j + 1))
+			splitters[j++] = keys[i];
+	}
+	Assert(j == nParticipants - 1);
+
+	bounds = &SharedsortBounds(shared)[state->worker * shared->nTapes];
+	start.ordinal = 0;
+	start.blocknum = -1;
+	start.offset = 0;
+	for (j = 0; j < nParticipants; j++)
+	{
+		RunPosition next;
+
+		if (j < nParticipants - 1)
+			next = worker_find_partition_start(state, &splitters[j], start,
+											   nvalid);
+		else
+		{
+			next = start;
+			next.ordinal = state->runTuples;
+		}
+		bounds[j].ntuples = next.ordinal - start.ordinal;
+		bounds[j].blocknum = start.blocknum;
+		bounds[j].offset = start.offset;
+		start = next;
+	}
+
+	(void) worker_wait_participants(state, &shared->nBounded);
+
+	/*
+	 * Step 3: merge our partition.  Runs are imported the same way the leader
+	 * imports them, and the output goes to a tapeset file of our own, named
+	 * after a worker number no participant uses.
+	 */
+	ninputs = 0;
+	for (w = 0; w < nParticipants; w++)
+	{
+		if (SharedsortBounds(shared)[w * shared->nTapes + state->worker].ntuples > 0)
+			ninputs++;
+	}
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "worker %d starting merge of partition from %d of %d runs: %s",
+			 state->worker, ninputs, nParticipants,
+			 pg_rusage_show(&state->ru_start));
+#endif
+
+	input_buffer_size = merge_read_buffer_size(state->allowedMem,
+											   Max(ninputs, 1),
+											   Max(ninputs, 1), 1);
+	inputset = LogicalTapeSetCreate(false, &shared->fileset, -1);
+	inputs = (LogicalTape **) palloc(nParticipants * sizeof(LogicalTape *));
+	remaining = (int64 *) palloc(nParticipants * sizeof(int64));
+	ninputs = 0;
+	for (w = 0; w < nParticipants; w++)
+	{
+		RunBound *bound;
+
+		bound = &SharedsortBounds(shared)[w * shared->nTapes + state->worker];
+		if (bound->ntuples == 0)
+			continue;
+
+		inputs[ninputs] = LogicalTapeImport(inputset, w, &shared->tapes[w]);
+		LogicalTapeRewindForRead(inputs[ninputs], input_buffer_size);
+		if (bound->blocknum != -1)
+			LogicalTapeSeekImported(inputs[ninputs], bound->blocknum,
+									bound->offset);
+		remaining[ninputs] = bound->ntuples;
+		ninputs++;
+	}
+
+	outputset = LogicalTapeSetCreate(false, &shared->fileset,
+									 shared->nTapes + state->worker);
+	output = LogicalTapeCreate(outputset);
+
+	state->memtupsize = nParticipants;
+	state->memtuples = (SortTuple *)
+		MemoryContextAlloc(state->maincontext,
+						   nParticipants * sizeof(SortTuple));
+	state->memtupcount = 0;
+	for (i = 0; i < ninputs; i++)
+	{
+		SortTuple	stup;
+		unsigned int tuplen;
+
+		tuplen = getlen(inputs[i], false);
+		READTUP(state, &stup, inputs[i], tuplen);
+		remaining[i]--;
+		stup.srctape = i;
+		tuplesort_heap_insert(state, &stup);
+	}
+
+	while (state->memtupcount > 0)
+	{
+		SortTuple	stup;
+		unsigned int tuplen;
+
+		i = state->memtuples[0].srctape;
+		WRITETUP(state, output, &state->memtuples[0]);
+		if (state->memtuples[0].tuple)
+			RELEASE_SLAB_SLOT(state, state->memtuples[0].tuple);
+
+		if (remaining[i] > 0)
+		{
+			tuplen = getlen(inputs[i], false);
+			READTUP(state, &stup, inputs[i], tuplen);
+			remaining[i]--;
+			stup.srctape = i;
+			tuplesort_heap_replace_top(state, &stup);
+		}
+		else
+			tuplesort_heap_delete_top(state);
+	}
+	markrunend(output);
+
+	LogicalTapeFreeze(output, &merged);
+	LogicalTapeClose(output);
+	LogicalTapeSetClose(outputset);
+	for (i = 0; i < ninputs; i++)
+		LogicalTapeClose(inputs[i]);
+	if (ninputs > 0)
+		LogicalTapeSetClose(inputset);
+
+	SpinLockAcquire(&shared->mutex);
+	SharedsortMerged(shared)[state->worker] = merged;
+	shared->nMerged++;
+	SpinLockRelease(&shared->mutex);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "worker %d finished merge of partition: %s",
+			 state->worker, pg_rusage_show(&state->ru_start));
+#endif
+}
+
+/*
+ * worker_wait_participants - wait for all participants of a partitioned merge
+ *
+ * Increments the given counter in shared memory, and waits until every
+ * participant has done the same.  Returns the number of participants.
+ */
+static int
+worker_wait_participants(Tuplesortstate *state, int *counter)
+{
+	Sharedsort *shared = state->shared;
+	int			nLaunched;
+	bool		done;
+
+	SpinLockAcquire(&shared->mutex);
+	(*counter)++;
+	SpinLockRelease(&shared->mutex);
+	ConditionVariableBroadcast(&shared->cv);
+
+	for (;;)
+	{
+		SpinLockAcquire(&shared->mutex);
+		nLaunched = shared->nLaunched;
+		done = (nLaunched > 0 && *counter >= nLaunched);
+		SpinLockRelease(&shared->mutex);
+
+		if (done)
+			break;
+		ConditionVariableSleep(&shared->cv, WAIT_EVENT_PARALLEL_SORT_PARTITION);
+	}
+	ConditionVariableCancelSleep();
+
+	return nLaunched;
+}
+
+/*
+ * worker_read_run_tuple - read the tuple at a position of our final run
+ */
+static void
+worker_read_run_tuple(Tuplesortstate *state, RunPosition *pos,
+					  SortTuple *stup)
+{
+	unsigned int tuplen;
+
+	if (pos->blocknum == -1)
+		LogicalTapeRewindForRead(state->result_tape, 0);
+	else
+		LogicalTapeSeek(state->result_tape, pos->blocknum, pos->offset);
+
+	tuplen = getlen(state->result_tape, false);
+	READTUP(state, stup, state->result_tape, tuplen);
+}
+
+/*
+ * worker_find_partition_start - find where a partition begins in our run
+ *
+ * Returns the position of the first tuple at or after 'start' whose leading
+ * key is greater than the splitter, or of the end of the run.  A binary
+ * search of the noted tuple positions leaves less than runStride tuples to
+ * be read one by one.
+ */
+static RunPosition
+worker_find_partition_start(Tuplesortstate *state, SplitterKey *splitter,
+							RunPosition start, int nvalid)
+{
+	RunPosition pos = start;
+	SortTuple	stup;
+	int			lo = 0;
+	int			hi = nvalid - 1;
+	int			cmp;
+
+	while (lo <= hi && state->runIndex[lo].ordinal <= start.ordinal)
+		lo++;
+
+	/* Find the last noted tuple whose key is not greater than splitter */
+	while (lo <= hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		worker_read_run_tuple(state, &state->runIndex[mid], &stup);
+		cmp = ApplySortComparator(stup.datum1, stup.isnull1,
+								  splitter->value, splitter->isnull,
+								  state->sortKeys);
+		if (stup.tuple)
+			RELEASE_SLAB_SLOT(state, stup.tuple);
+
+		if (cmp <= 0)
+		{
+			pos = state->runIndex[mid];
+			lo = mid + 1;
+		}
+		else
+			hi = mid - 1;
+	}
+
+	/* Read on from there, up to the first tuple greater than splitter */
+	if (pos.blocknum == -1)
+		LogicalTapeRewindForRead(state->result_tape, 0);
+	else
+		LogicalTapeSeek(state->result_tape, pos.blocknum, pos.offset);
+
+	while (pos.ordinal < state->runTuples)
+	{
+		unsigned int tuplen;
+
+		LogicalTapeTell(state->result_tape, &pos.blocknum, &pos.offset);
+		tuplen = getlen(state->result_tape, false);
+		READTUP(state, &stup, state->result_tape, tuplen);
+		cmp = ApplySortComparator(stup.datum1, stup.isnull1,
+								  splitter->value, splitter->isnull,
+								  state->sortKeys);
+		if (stup.tuple)
+			RELEASE_SLAB_SLOT(state, stup.tuple);
+
+		if (cmp > 0)
+			break;
+		pos.ordinal++;
+	}
+
+	return pos;
+}
+
+/*
+ * qsort_arg comparator for sampled leading keys
+ */
+static int
+partition_key_cmp(const void *a, const void *b, void *arg)
+{
+	const SplitterKey *ka = (const SplitterKey *) a;
+	const SplitterKey *kb = (const SplitterKey *) b;
+
+	return ApplySortComparator(ka->value, ka->isnull, kb->value, kb->isnull,
+							   (SortSupport) arg);
+}
+
 /*
  * leader_takeover_tapes - create tapeset for leader from worker tapes
  *
@@ -4824,7 +5727,9 @@ worker_nomergeruns(Tuplesortstate *state)
  *
  * When this returns, leader process is left in a state that is virtually
  * indistinguishable from it having generated runs as a serial external sort
- * might have.
+ * might have.  If workers have merged partitions of the output, though, the
+ * leader is left in TSS_SORTEDONTAPE state, ready to read the partitions in
+ * order.
  */
 static void
 leader_takeover_tapes(Tuplesortstate *state)
@@ -4832,6 +5737,7 @@ leader_takeover_tapes(Tuplesortstate *state)
 	Sharedsort *shared = state->shared;
 	int			nParticipants = state->nParticipants;
 	int			workersFinished;
+	int			nMerged;
 	int			j;
 
 	Assert(LEADER(state));
@@ -4839,10 +5745,13 @@ leader_takeover_tapes(Tuplesortstate *state)
 
 	SpinLockAcquire(&shared->mutex);
 	workersFinished = shared->workersFinished;
+	nMerged = shared->nMerged;
 	SpinLockRelease(&shared->mutex);
 
 	if (nParticipants != workersFinished)
 		elog(ERROR, "cannot take over tapes before all workers finish");
+	if (nMerged != 0 && nParticipants != nMerged)
+		elog(ERROR, "cannot take over partitions before all workers merge them");
 
 	/*
 	 * Create the tapeset from worker tapes, including a leader-owned tape at
@@ -4874,6 +5783,38 @@ leader_takeover_tapes(Tuplesortstate *state)
 	state->nOutputTapes = nParticipants;
 	state->nOutputRuns = nParticipants;
 
+	if (nMerged > 0)
+	{
+		/*
+		 * Worker j has merged the j'th partition of the output.  Concatenating
+		 * the partitions in that order yields the final output, so there is
+		 * nothing left to merge.  Set up for reading them in turn, like
+		 * mergeruns() does for a materialized final run.
+		 */
+		for (j = 0; j < nParticipants; j++)
+			state->outputTapes[j] =
+				LogicalTapeImport(state->tapeset, shared->nTapes + j,
+								  &SharedsortMerged(shared)[j]);
+
+		FREEMEM(state, GetMemoryChunkSpace(state->memtuples));
+		pfree(state->memtuples);
+		state->memtuples = NULL;
+		init_slab_allocator(state, state->tuples ? 1 : 0);
+
+		/* Only one tape is read at a time, so each can use all the memory */
+		state->tape_buffer_mem = state->availMem;
+		USEMEM(state, state->tape_buffer_mem);
+		for (j = 0; j < nParticipants; j++)
+			LogicalTapeRewindForRead(state->outputTapes[j],
+									 state->tape_buffer_mem);
+
+		state->result_tape = state->outputTapes[0];
+		state->nPartitions = nParticipants;
+		state->curPartition = 0;
+		state->status = TSS_SORTEDONTAPE;
+		return;
+	}
+
 	for (j = 0; j < nParticipants; j++)
 	{
 		state->outputTapes[j] = LogicalTapeImport(state->tapeset, j, &shared->tapes[j]);
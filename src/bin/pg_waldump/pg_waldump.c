@@ -530,6 +530,8 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogStats *stats)
 	uint64		total_count = 0;
 	uint64		total_rec_len = 0;
 	uint64		total_fpi_len = 0;
+	uint64		total_fpi_count = 0;
+	uint64		total_fpi_raw_len = 0;
 	uint64		total_len = 0;
 	double		rec_len_pct,
 				fpi_len_pct;
@@ -553,6 +555,8 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogStats *stats)
 		total_count += stats->rmgr_stats[ri].count;
 		total_rec_len += stats->rmgr_stats[ri].rec_len;
 		total_fpi_len += stats->rmgr_stats[ri].fpi_len;
+		total_fpi_count += stats->rmgr_stats[ri].fpi_count;
+		total_fpi_raw_len += stats->rmgr_stats[ri].fpi_raw_len;
 	}
 	total_len = total_rec_len + total_fpi_len;
 
@@ -650,6 +654,17 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogStats *stats)
 		   total_rec_len, psprintf("[%.02f%%]", rec_len_pct),
 		   total_fpi_len, psprintf("[%.02f%%]", fpi_len_pct),
 		   total_len, "[100%]");
+
+	/*
+	 * Show how well full-page images compressed, comparing their size with
+	 * what they would take without compression.
+	 */
+	if (total_fpi_count > 0)
+		printf("\nFull-page images: %" INT64_MODIFIER "u, "
+			   "uncompressed size: %" INT64_MODIFIER "u, "
+			   "compression ratio: %.02f\n",
+			   total_fpi_count, total_fpi_raw_len,
+			   total_fpi_len != 0 ? (double) total_fpi_raw_len / total_fpi_len : 0);
 }
 
 static void
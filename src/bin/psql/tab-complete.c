@@ -1999,14 +1999,16 @@ psql_completion(const char *text, int start, int end)
 	/* ALTER INDEX <foo> SET|RESET ( */
 	else if (Matches("ALTER", "INDEX", MatchAny, "RESET", "("))
 		COMPLETE_WITH("fillfactor",
-					  "deduplicate_items",	/* BTREE */
+					  "deduplicate_items", "compress_posting_lists",	/* BTREE */
+					  "compress_key_prefixes",
 					  "fastupdate", "gin_pending_list_limit",	/* GIN */
 					  "buffering",	/* GiST */
 					  "pages_per_range", "autosummarize"	/* BRIN */
 			);
 	else if (Matches("ALTER", "INDEX", MatchAny, "SET", "("))
 		COMPLETE_WITH("fillfactor =",
-					  "deduplicate_items =",	/* BTREE */
+					  "deduplicate_items =", "compress_posting_lists =",	/* BTREE */
+					  "compress_key_prefixes =",
 					  "fastupdate =", "gin_pending_list_limit =",	/* GIN */
 					  "buffering =",	/* GiST */
 					  "pages_per_range =", "autosummarize ="	/* BRIN */
@@ -43,6 +43,13 @@ typedef struct GinOptions
 	 ((GinOptions *) (relation)->rd_options)->pendingListCleanupSize : \
 	 gin_pending_list_limit)
 
+/*
+ * Once the pending list is larger than the cleanup size above, inserts ask
+ * autovacuum to clean it up in the background.  Inserts only clean it up
+ * themselves once it is this many times larger than the cleanup size.
+ */
+#define GIN_PENDING_LIST_HARD_LIMIT_FACTOR	4
+
 
 /* Macros for buffer lock/unlock operations */
 #define GIN_UNLOCK	BUFFER_LOCK_UNLOCK
@@ -25,6 +25,7 @@
 #include "storage/bufpage.h"
 #include "storage/dsm.h"
 #include "storage/lockdefs.h"
+#include "storage/read_stream.h"
 #include "storage/shm_toc.h"
 #include "utils/relcache.h"
 #include "utils/snapshot.h"
@@ -35,6 +36,7 @@
 #define HEAP_INSERT_FROZEN		TABLE_INSERT_FROZEN
 #define HEAP_INSERT_NO_LOGICAL	TABLE_INSERT_NO_LOGICAL
 #define HEAP_INSERT_SPECULATIVE 0x0010
+#define HEAP_INSERT_EXTEND		0x0020	/* always use a new page */
 
 typedef struct BulkInsertStateData *BulkInsertState;
 struct TupleTableSlot;
@@ -63,6 +65,15 @@ typedef struct HeapScanDescData
 	/* rs_numblocks is usually InvalidBlockNumber, meaning "scan whole rel" */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 
+	/*
+	 * Sequential scans read pages through a read stream, which looks ahead
+	 * of rs_cblock in direction rs_dir.  rs_prefetch_block is the last block
+	 * handed to the stream.  NULL for other kinds of scans.
+	 */
+	ReadStream *rs_read_stream;
+	BlockNumber rs_prefetch_block;
+	ScanDirection rs_dir;
+
 	HeapTupleData rs_ctup;		/* current tuple in scan, if any */
 
 	/*
@@ -129,6 +140,9 @@ extern bool heap_getnextslot(TableScanDesc sscan,
 							 ScanDirection direction, struct TupleTableSlot *slot);
 extern void heap_set_tidrange(TableScanDesc sscan, ItemPointer mintid,
 							  ItemPointer maxtid);
+extern int	heap_getnextbatch(TableScanDesc sscan, ScanDirection direction,
+							  struct TupleDeformProgram *program, int natts,
+							  Datum *values, bool *isnull, int maxrows);
 extern bool heap_getnextslot_tidrange(TableScanDesc sscan,
 									  ScanDirection direction,
 									  TupleTableSlot *slot);
@@ -82,6 +82,8 @@ typedef BTPageOpaqueData *BTPageOpaque;
 #define BTP_HAS_GARBAGE (1 << 6)	/* page has LP_DEAD tuples (deprecated) */
 #define BTP_INCOMPLETE_SPLIT (1 << 7)	/* right sibling's downlink is missing */
 #define BTP_HAS_FULLXID	(1 << 8)	/* contains BTDeletedPageData */
+#define BTP_HAS_COMPRESSED (1 << 9)	/* may have compressed posting lists */
+#define BTP_HAS_PREFIX	(1 << 10)	/* leaf page has a key prefix */
 
 /*
  * The max allowed value of a cycle ID is a bit less than 64K.  This is
@@ -182,10 +184,18 @@ typedef struct BTMetaPageData
  * heap TIDs must have to fill the space between the page header and
  * special area).  The value is slightly higher (i.e. more conservative)
  * than necessary as a result, which is considered acceptable.
+ *
+ * Compressed posting lists (see below) can store many more heap TIDs in the
+ * same space.  Leaf pages that might have compressed posting lists (those
+ * with BTP_HAS_COMPRESSED set) may hold up to MaxTIDsPerCompressedBTreePage
+ * heap TIDs instead, and are split when they're about to exceed that,
+ * whether or not they're full.  Only code that deals with such pages needs
+ * buffers of that size; see BTPageGetMaxTIDs().
  */
 #define MaxTIDsPerBTreePage \
 	(int) ((BLCKSZ - SizeOfPageHeaderData - sizeof(BTPageOpaqueData)) / \
 		   sizeof(ItemPointerData))
+#define MaxTIDsPerCompressedBTreePage	(2 * MaxTIDsPerBTreePage)
 
 /*
  * The leaf-page fillfactor defaults to 90% but is user-adjustable.
@@ -227,6 +237,97 @@ typedef struct BTMetaPageData
 #define P_HAS_GARBAGE(opaque)	(((opaque)->btpo_flags & BTP_HAS_GARBAGE) != 0)
 #define P_INCOMPLETE_SPLIT(opaque)	(((opaque)->btpo_flags & BTP_INCOMPLETE_SPLIT) != 0)
 #define P_HAS_FULLXID(opaque)	(((opaque)->btpo_flags & BTP_HAS_FULLXID) != 0)
+#define P_HAS_COMPRESSED(opaque)	(((opaque)->btpo_flags & BTP_HAS_COMPRESSED) != 0)
+#define P_HAS_PREFIX(opaque)	(((opaque)->btpo_flags & BTP_HAS_PREFIX) != 0)
+
+/* Upper bound on the number of heap TIDs on a leaf page */
+#define BTPageGetMaxTIDs(opaque) \
+	(P_HAS_COMPRESSED(opaque) ? MaxTIDsPerCompressedBTreePage : \
+	 MaxTIDsPerBTreePage)
+
+/*
+ * BTPagePrefixData is the key prefix of a leaf page with BTP_HAS_PREFIX set.
+ * It is stored in the special space, right after BTPageOpaqueData, which
+ * makes the special space of such pages larger than usual.
+ *
+ * The prefix applies to a byte string formed from each non-pivot tuple's
+ * keys: the bytes of the fixed-width key attributes that come before any
+ * variable-width one (btpp_fixedlen bytes, including alignment padding),
+ * followed by the data of the first variable-width key attribute, if it is
+ * a varlena (its header and any alignment padding before it are skipped).
+ * Tuples with NULLs don't take part.  Each non-pivot tuple on the page is
+ * stored without the leading bytes of that string that it shares with the
+ * prefix, so it may use all, some or none of the prefix.  The tuple header
+ * still gives the full size of the tuple, so the number of omitted bytes is
+ * the difference between that and the line pointer's length.  High keys are
+ * never stored that way.  See "Key prefix compression" in nbtree/README.
+ *
+ * btpp_fixedlen and btpp_varalign are the same for every page of the index,
+ * but keeping them here lets code that doesn't know about the index's tuple
+ * descriptor (such as WAL replay) expand tuples.
+ */
+typedef struct BTPagePrefixData
+{
+	uint16		btpp_len;		/* length of prefix in bytes */
+	uint16		btpp_fixedlen;	/* bytes of leading fixed-width attributes */
+	char		btpp_varalign;	/* alignment of varlena attribute that follows
+								 * them, or '\0' if there is none */
+	char		btpp_data[FLEXIBLE_ARRAY_MEMBER];
+} BTPagePrefixData;
+
+typedef BTPagePrefixData *BTPagePrefix;
+
+#define SizeOfBTPagePrefix(len) \
+	(offsetof(BTPagePrefixData, btpp_data) + (len))
+
+/* Longest key prefix we store */
+#define BTMaxPrefixSize		(BLCKSZ / 32)
+
+/* Size of special space of a leaf page with a key prefix of length len */
+#define BTPrefixSpecialSize(len) \
+	(MAXALIGN(sizeof(BTPageOpaqueData)) + MAXALIGN(SizeOfBTPagePrefix(len)))
+
+static inline BTPagePrefix
+BTPageGetPrefix(Page page)
+{
+	Assert(P_HAS_PREFIX(BTPageGetOpaque(page)));
+
+	return (BTPagePrefix) ((char *) BTPageGetOpaque(page) +
+						   MAXALIGN(sizeof(BTPageOpaqueData)));
+}
+
+/*
+ * Does the special space of a btree page have the size its flags call for?
+ */
+static inline bool
+BTPageSpecialSizeIsValid(Page page)
+{
+	Size		specialsize = PageGetSpecialSize(page);
+	BTPagePrefix prefix;
+
+	if (specialsize == MAXALIGN(sizeof(BTPageOpaqueData)))
+		return !P_HAS_PREFIX(BTPageGetOpaque(page));
+	if (specialsize < BTPrefixSpecialSize(0) ||
+		specialsize > BTPrefixSpecialSize(BTMaxPrefixSize) ||
+		!P_HAS_PREFIX(BTPageGetOpaque(page)))
+		return false;
+
+	prefix = BTPageGetPrefix(page);
+
+	return prefix->btpp_len > 0 && prefix->btpp_len <= BTMaxPrefixSize &&
+		specialsize == BTPrefixSpecialSize(prefix->btpp_len);
+}
+
+/*
+ * Workspace for a leaf page item that has to be expanded to its full size
+ * before use; see BTPageGetItem().  It's big enough for any index tuple.
+ */
+typedef union BTItemBuf
+{
+	char		data[INDEX_SIZE_MASK + 1];
+	double		force_align_d;
+	int64		force_align_i64;
+} BTItemBuf;
 
 /*
  * BTDeletedPageData is the page contents of a deleted page
@@ -457,6 +558,26 @@ typedef struct BTVacState
  * number of columns stored is always implicitly the total number in the
  * index (in practice there can never be non-key columns stored, since
  * deduplication is not supported with INCLUDE indexes).
+ *
+ * When the compress_posting_lists storage parameter is enabled, new posting
+ * lists may instead be stored in compressed form, indicated by the
+ * BT_COMPRESSED_POSTING status bit:
+ *
+ *  t_tid | t_info | key values | min TID | max TID | width | offsets
+ *
+ * The lowest and highest heap TIDs are stored as plain ItemPointerData (so
+ * BTreeTupleGetHeapTID() and BTreeTupleGetMaxHeapTID() work as usual).  Every
+ * other heap TID is stored as its distance from the lowest TID, using the same
+ * number of bytes ('width') for each, just enough to represent the distance
+ * to the highest TID.  Distances are computed on TIDs represented as integers,
+ * with the offset number in the lowest BT_POSTING_OFFSET_BITS bits, the same
+ * representation that GIN uses for its posting lists.  The TIDs of a posting
+ * list are usually close together in the heap, so most of them take only two
+ * or three bytes.  Since every TID has the same width, BTreeTupleGetPostingTID()
+ * can still find the nth TID (and binary search the TIDs) directly, and a TID
+ * can be replaced by any TID between the lowest and highest TIDs without
+ * changing the size of the tuple, which is what posting list splits need.
+ * A posting list is only compressed when that makes the tuple smaller.
  */
 #define INDEX_ALT_TID_MASK			INDEX_AM_RESERVED_BIT
 
@@ -466,6 +587,12 @@ typedef struct BTVacState
 /* BT_STATUS_OFFSET_MASK status bits */
 #define BT_PIVOT_HEAP_TID_ATTR		0x1000
 #define BT_IS_POSTING				0x2000
+#define BT_COMPRESSED_POSTING		0x4000
+
+/* Compressed posting list representation (see above) */
+#define BT_POSTING_OFFSET_BITS		11
+#define BT_POSTING_MAX_WIDTH		5
+#define SizeOfBtCompressedPostingHeader	(2 * sizeof(ItemPointerData) + 1)
 
 /*
  * Note: BTreeTupleIsPivot() can have false negatives (but not false
@@ -495,8 +622,22 @@ BTreeTupleIsPosting(IndexTuple itup)
 	return true;
 }
 
+static inline bool
+BTreeTupleIsCompressedPosting(IndexTuple itup)
+{
+	if (!BTreeTupleIsPosting(itup))
+		return false;
+	/* presence of BT_COMPRESSED_POSTING indicates compressed posting list */
+	if ((ItemPointerGetOffsetNumberNoCheck(&itup->t_tid) &
+		 BT_COMPRESSED_POSTING) == 0)
+		return false;
+
+	return true;
+}
+
 static inline void
-BTreeTupleSetPosting(IndexTuple itup, uint16 nhtids, int postingoffset)
+BTreeTupleSetPosting(IndexTuple itup, uint16 nhtids, int postingoffset,
+					 bool compressed)
 {
 	Assert(nhtids > 1);
 	Assert((nhtids & BT_STATUS_OFFSET_MASK) == 0);
@@ -505,6 +646,8 @@ BTreeTupleSetPosting(IndexTuple itup, uint16 nhtids, int postingoffset)
 	Assert(!BTreeTupleIsPivot(itup));
 
 	itup->t_info |= INDEX_ALT_TID_MASK;
+	if (compressed)
+		nhtids |= BT_COMPRESSED_POSTING;
 	ItemPointerSetOffsetNumber(&itup->t_tid, (nhtids | BT_IS_POSTING));
 	ItemPointerSetBlockNumber(&itup->t_tid, postingoffset);
 }
@@ -528,6 +671,10 @@ BTreeTupleGetPostingOffset(IndexTuple posting)
 	return ItemPointerGetBlockNumberNoCheck(&posting->t_tid);
 }
 
+/*
+ * Get posting list.  With a compressed posting list, only the first two
+ * elements of the returned array are TIDs: the lowest and the highest.
+ */
 static inline ItemPointer
 BTreeTupleGetPosting(IndexTuple posting)
 {
@@ -538,9 +685,51 @@ BTreeTupleGetPosting(IndexTuple posting)
 static inline ItemPointer
 BTreeTupleGetPostingN(IndexTuple posting, int n)
 {
+	Assert(!BTreeTupleIsCompressedPosting(posting));
+
 	return BTreeTupleGetPosting(posting) + n;
 }
 
+/*
+ * Get nth heap TID from posting list, which may be compressed
+ */
+static inline void
+BTreeTupleGetPostingTID(IndexTuple posting, int n, ItemPointer htid)
+{
+	ItemPointer plist = BTreeTupleGetPosting(posting);
+	int			nhtids = BTreeTupleGetNPosting(posting);
+	unsigned char *ptr;
+	int			width;
+	uint64		val;
+
+	Assert(n >= 0 && n < nhtids);
+
+	if (!BTreeTupleIsCompressedPosting(posting))
+	{
+		*htid = plist[n];
+		return;
+	}
+	if (n == 0 || n == nhtids - 1)
+	{
+		/* lowest and highest TIDs are stored as is */
+		*htid = plist[n == 0 ? 0 : 1];
+		return;
+	}
+
+	ptr = (unsigned char *) (plist + 2);
+	width = *ptr++;
+	ptr += (n - 1) * width;
+	val = 0;
+	for (int i = 0; i < width; i++)
+		val = (val << 8) | ptr[i];
+
+	val += ((uint64) ItemPointerGetBlockNumberNoCheck(plist) <<
+			BT_POSTING_OFFSET_BITS) |
+		ItemPointerGetOffsetNumberNoCheck(plist);
+	ItemPointerSet(htid, (BlockNumber) (val >> BT_POSTING_OFFSET_BITS),
+				   (OffsetNumber) (val & ((1 << BT_POSTING_OFFSET_BITS) - 1)));
+}
+
 /*
  * Get/set downlink block number in pivot tuple.
  *
@@ -660,6 +849,8 @@ BTreeTupleGetMaxHeapTID(IndexTuple itup)
 {
 	Assert(!BTreeTupleIsPivot(itup));
 
+	if (BTreeTupleIsCompressedPosting(itup))
+		return BTreeTupleGetPosting(itup) + 1;
 	if (BTreeTupleIsPosting(itup))
 	{
 		uint16		nposting = BTreeTupleGetNPosting(itup);
@@ -866,6 +1057,7 @@ typedef struct BTDedupStateData
 {
 	/* Deduplication status info for entire pass over page */
 	bool		deduplicate;	/* Still deduplicating page? */
+	bool		compress;		/* Compress new posting lists? */
 	int			nmaxitems;		/* Number of max-sized tuples so far */
 	Size		maxpostingsize; /* Limit on size of final tuple */
 
@@ -977,12 +1169,15 @@ typedef struct BTScanPosData
 	 * array back-to-front, so we start at the last slot and fill downwards.
 	 * Hence we need both a first-valid-entry and a last-valid-entry counter.
 	 * itemIndex is a cursor showing which entry was last returned to caller.
+	 *
+	 * The array has room for so->maxItems entries, which is enough for any
+	 * page the scan has seen so far (see _bt_readpage).
 	 */
 	int			firstItem;		/* first valid index in items[] */
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
 
-	BTScanPosItem items[MaxTIDsPerBTreePage];	/* MUST BE LAST */
+	BTScanPosItem *items;		/* palloc'd array of matches */
 } BTScanPosData;
 
 typedef BTScanPosData *BTScanPos;
@@ -1019,6 +1214,22 @@ typedef BTScanPosData *BTScanPos;
 		(scanpos).nextTupleOffset = 0; \
 	} while (0)
 
+/*
+ * Copy scan position, including its valid items, into another one that has
+ * its own items array of the same size.
+ */
+static inline void
+BTScanPosCopy(BTScanPos dst, BTScanPos src)
+{
+	BTScanPosItem *items = dst->items;
+
+	*dst = *src;
+	dst->items = items;
+	if (src->lastItem >= src->firstItem)
+		memcpy(dst->items + src->firstItem, src->items + src->firstItem,
+			   (src->lastItem - src->firstItem + 1) * sizeof(BTScanPosItem));
+}
+
 /* We need one of these for each equality-type SK_SEARCHARRAY scan key */
 typedef struct BTArrayKeyInfo
 {
@@ -1044,6 +1255,36 @@ typedef struct BTScanOpaqueData
 								 * processed */
 	BTArrayKeyInfo *arrayKeys;	/* info about each equality-type array key */
 	MemoryContext arrayContext; /* scan-lifespan context for array data */
+	bool		arrayKeysDone;	/* no more array elements can match? */
+	bool		redescend;		/* descend to the current keys, rather than
+								 * advancing them, for the next primitive
+								 * scan? */
+	bool		markArrayKeysDone;	/* the above two, saved by btmarkpos */
+	bool		markRedescend;
+	FmgrInfo   *orderProcs;		/* 3-way comparators for required "=" keys */
+	Oid		   *orderProcTypes; /* ... and their right-hand input types */
+
+	/*
+	 * Workspace for skip scans.  When the leading index columns have no scan
+	 * keys at all, _bt_preprocess_array_keys adds an "=" key for each of them
+	 * at the front of arrayKeyData, and the scan then visits each distinct
+	 * prefix of those columns in turn (see nbtree/README).
+	 */
+	int			numSkipKeys;	/* number of skipped leading columns */
+	int			skipState;		/* BT_SKIP_* state, see below */
+	ScanKey		skipKeyTemplates;	/* "=" keys for the skipped columns */
+	Datum	   *skipValues;		/* current prefix (palloc'd if by-ref) */
+	bool	   *skipNulls;
+	int			skipMarkState;	/* skip state saved by btmarkpos */
+	Datum	   *skipMarkValues;
+	bool	   *skipMarkNulls;
+
+	/*
+	 * Size of the currPos and markPos items arrays.  It starts out as
+	 * MaxTIDsPerBTreePage, unless the index may have compressed posting
+	 * lists.
+	 */
+	int			maxItems;
 
 	/* info about killed items if any (killedItems is NULL if never used) */
 	int		   *killedItems;	/* currPos.items indexes of killed items */
@@ -1073,6 +1314,16 @@ typedef struct BTScanOpaqueData
 
 typedef BTScanOpaqueData *BTScanOpaque;
 
+/*
+ * Values of skipState.  BT_SKIP_AT means the skip keys hold the current
+ * prefix; the others mean the next primitive scan must first find a prefix,
+ * either the first one in the index or the one after skipValues, and
+ * _bt_readpage takes the prefix of the first tuple it examines.
+ */
+#define BT_SKIP_FIRST	0		/* no prefix yet, start at the index's end */
+#define BT_SKIP_NEXT	1		/* find the prefix after skipValues */
+#define BT_SKIP_AT		2		/* skip keys hold the current prefix */
+
 /*
  * We use some private sk_flags bits in preprocessed scan keys.  We're allowed
  * to use bits 16-31 (see skey.h).  The uppermost bits are copied from the
@@ -1090,6 +1341,8 @@ typedef struct BTOptions
 	int			fillfactor;		/* page fill factor in percent (0..100) */
 	float8		vacuum_cleanup_index_scale_factor;	/* deprecated */
 	bool		deduplicate_items;	/* Try to deduplicate items? */
+	bool		compress_posting_lists; /* Compress new posting lists? */
+	bool		compress_key_prefixes;	/* Use key prefixes on leaf pages? */
 } BTOptions;
 
 #define BTGetFillFactor(relation) \
@@ -1105,6 +1358,16 @@ typedef struct BTOptions
 				 relation->rd_rel->relam == BTREE_AM_OID), \
 	((relation)->rd_options ? \
 	 ((BTOptions *) (relation)->rd_options)->deduplicate_items : true))
+#define BTGetCompressPostingLists(relation) \
+	(AssertMacro(relation->rd_rel->relkind == RELKIND_INDEX && \
+				 relation->rd_rel->relam == BTREE_AM_OID), \
+	((relation)->rd_options ? \
+	 ((BTOptions *) (relation)->rd_options)->compress_posting_lists : false))
+#define BTGetCompressKeyPrefixes(relation) \
+	(AssertMacro(relation->rd_rel->relkind == RELKIND_INDEX && \
+				 relation->rd_rel->relam == BTREE_AM_OID), \
+	((relation)->rd_options ? \
+	 ((BTOptions *) (relation)->rd_options)->compress_key_prefixes : false))
 
 /*
  * Constant definition for progress reporting.  Phase numbers must match
@@ -1165,11 +1428,48 @@ extern void _bt_dedup_start_pending(BTDedupState state, IndexTuple base,
 extern bool _bt_dedup_save_htid(BTDedupState state, IndexTuple itup);
 extern Size _bt_dedup_finish_pending(Page newpage, BTDedupState state);
 extern IndexTuple _bt_form_posting(IndexTuple base, ItemPointer htids,
-								   int nhtids);
+								   int nhtids, bool compress);
 extern void _bt_update_posting(BTVacuumPosting vacposting);
 extern IndexTuple _bt_swap_posting(IndexTuple newitem, IndexTuple oposting,
 								   int postingoff);
 
+/*
+ * prototypes for functions in nbtprefix.c
+ */
+extern bool _bt_prefix_layout(Relation rel, uint16 *fixedlen,
+							  char *varalign);
+extern BTPagePrefix _bt_prefix_choose(Relation rel, BTPagePrefix curprefix,
+									  IndexTuple *items, int nitems);
+extern void _bt_prefix_setpage(Page page, BTPagePrefix prefix);
+extern void _bt_prefix_clearpage(Page page);
+extern IndexTuple _bt_prefix_compress(Page page, IndexTuple itup,
+									  Size *itemsz, BTItemBuf *buf);
+extern IndexTuple _bt_prefix_expand(Page page, ItemId itemid,
+									BTItemBuf *buf);
+
+/*
+ * Get a tuple from a leaf page, expanding it to its full size in caller's
+ * buffer if it was stored without part of its key (only possible on pages
+ * with BTP_HAS_PREFIX set).  Otherwise, this just returns a pointer to the
+ * tuple on the page.
+ *
+ * Code that reads the key attributes or the posting list of a leaf page
+ * tuple must use this instead of PageGetItem().  The header of a stored
+ * tuple is the same as that of its expanded form, though, so code that only
+ * looks at that (for example to get the heap TID of a plain non-pivot tuple)
+ * doesn't need to.
+ */
+static inline IndexTuple
+BTPageGetItem(Page page, ItemId itemid, BTItemBuf *buf)
+{
+	IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+
+	if (likely(IndexTupleSize(itup) == ItemIdGetLength(itemid)))
+		return itup;
+
+	return _bt_prefix_expand(page, itemid, buf);
+}
+
 /*
  * prototypes for functions in nbtinsert.c
  */
@@ -1245,6 +1545,18 @@ extern bool _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern void _bt_mark_array_keys(IndexScanDesc scan);
 extern void _bt_restore_array_keys(IndexScanDesc scan);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
+extern void _bt_skip_adopt(IndexScanDesc scan, IndexTuple tuple);
+extern int	_bt_skip_compare(IndexScanDesc scan, IndexTuple tuple);
+extern bool _bt_skip_next_on_page(IndexScanDesc scan, Page page,
+								  OffsetNumber *offnum, ScanDirection dir);
+extern bool _bt_skip_redescend(IndexScanDesc scan, Page page,
+							   ScanDirection dir);
+extern bool _bt_advance_array_keys_page(IndexScanDesc scan, Page page,
+										OffsetNumber *offnum,
+										ScanDirection dir, bool *nextpage);
+extern bool _bt_advance_array_keys_hikey(IndexScanDesc scan,
+										 IndexTuple hikey, int tupnatts,
+										 ScanDirection dir);
 extern bool _bt_checkkeys(IndexScanDesc scan, IndexTuple tuple,
 						  int tupnatts, ScanDirection dir, bool *continuescan);
 extern void _bt_killitems(IndexScanDesc scan);
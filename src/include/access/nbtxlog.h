@@ -165,16 +165,18 @@ typedef struct xl_btree_split
  * merged together into posting list tuples.
  *
  * The WAL record represents a deduplication pass for a leaf page.  An array
- * of BTDedupInterval structs follows.
+ * of BTDedupInterval structs follows.  compress says whether the new posting
+ * lists were compressed where possible (see compress_posting_lists).
  */
 typedef struct xl_btree_dedup
 {
 	uint16		nintervals;
+	bool		compress;
 
 	/* DEDUPLICATION INTERVALS FOLLOW */
 } xl_btree_dedup;
 
-#define SizeOfBtreeDedup 	(offsetof(xl_btree_dedup, nintervals) + sizeof(uint16))
+#define SizeOfBtreeDedup 	(offsetof(xl_btree_dedup, compress) + sizeof(bool))
 
 /*
  * This is what we need to know about page reuse within btree.  This record
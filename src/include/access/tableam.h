@@ -20,6 +20,7 @@
 #include "access/relscan.h"
 #include "access/sdir.h"
 #include "access/xact.h"
+#include "storage/read_stream.h"
 #include "utils/guc.h"
 #include "utils/rel.h"
 #include "utils/snapshot.h"
@@ -36,6 +37,7 @@ struct BulkInsertStateData;
 struct IndexInfo;
 struct SampleScanState;
 struct TBMIterateResult;
+struct TupleDeformProgram;
 struct VacuumParams;
 struct ValidateIndexState;
 
@@ -328,6 +330,20 @@ typedef struct TableAmRoutine
 									 ScanDirection direction,
 									 TupleTableSlot *slot);
 
+	/*
+	 * Optional: return a batch of up to `maxrows` tuples from `scan`,
+	 * deformed with `program` into the row-major `values` / `isnull` arrays
+	 * (`natts` entries per row).  Returns the number of rows, 0 at the end of
+	 * the scan.  Only forward scans without scan keys need to be supported.
+	 * By-reference datums may point into AM-owned memory that is valid only
+	 * until the next call on the scan.
+	 */
+	int			(*scan_getnextbatch) (TableScanDesc scan,
+									  ScanDirection direction,
+									  struct TupleDeformProgram *program,
+									  int natts, Datum *values, bool *isnull,
+									  int maxrows);
+
 	/*-----------
 	 * Optional functions to provide scanning for ranges of ItemPointers.
 	 * Implementations must either provide both of these functions, or neither
@@ -632,25 +648,26 @@ typedef struct TableAmRoutine
 									BufferAccessStrategy bstrategy);
 
 	/*
-	 * Prepare to analyze block `blockno` of `scan`. The scan has been started
-	 * with table_beginscan_analyze().  See also
-	 * table_scan_analyze_next_block().
+	 * Prepare to analyze the next block of `scan`, as read from `stream`.
+	 * The scan has been started with table_beginscan_analyze().  The read
+	 * stream yields the blocks chosen by the block sampler, in order.  See
+	 * also table_scan_analyze_next_block().
 	 *
 	 * The callback may acquire resources like locks that are held until
 	 * table_scan_analyze_next_tuple() returns false. It e.g. can make sense
 	 * to hold a lock until all tuples on a block have been analyzed by
 	 * scan_analyze_next_tuple.
 	 *
-	 * The callback can return false if the block is not suitable for
-	 * sampling, e.g. because it's a metapage that could never contain tuples.
+	 * The callback returns false when the stream is exhausted.  Blocks that
+	 * are not suitable for sampling, e.g. because it's a metapage that could
+	 * never contain tuples, can be skipped by the callback.
 	 *
 	 * XXX: This obviously is primarily suited for block-based AMs. It's not
 	 * clear what a good interface for non block based AMs would be, so there
 	 * isn't one yet.
 	 */
 	bool		(*scan_analyze_next_block) (TableScanDesc scan,
-											BlockNumber blockno,
-											BufferAccessStrategy bstrategy);
+											ReadStream *stream);
 
 	/*
 	 * See table_scan_analyze_next_tuple().
@@ -1046,6 +1063,26 @@ table_scan_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableS
 	return sscan->rs_rd->rd_tableam->scan_getnextslot(sscan, direction, slot);
 }
 
+/*
+ * Return the next batch of tuples from `scan`, deformed into `values` and
+ * `isnull`.  Only valid if the AM provides scan_getnextbatch.
+ */
+static inline int
+table_scan_getnextbatch(TableScanDesc sscan, ScanDirection direction,
+						struct TupleDeformProgram *program, int natts,
+						Datum *values, bool *isnull, int maxrows)
+{
+	Assert(sscan->rs_rd->rd_tableam->scan_getnextbatch != NULL);
+
+	if (unlikely(TransactionIdIsValid(CheckXidAlive) && !bsysscan))
+		elog(ERROR, "unexpected table_scan_getnextbatch call during logical decoding");
+
+	return sscan->rs_rd->rd_tableam->scan_getnextbatch(sscan, direction,
+													   program, natts,
+													   values, isnull,
+													   maxrows);
+}
+
 /* ----------------------------------------------------------------------------
  * TID Range scanning related functions.
  * ----------------------------------------------------------------------------
@@ -1681,19 +1718,17 @@ table_relation_vacuum(Relation rel, struct VacuumParams *params,
 }
 
 /*
- * Prepare to analyze block `blockno` of `scan`. The scan needs to have been
- * started with table_beginscan_analyze().  Note that this routine might
- * acquire resources like locks that are held until
+ * Prepare to analyze the next block of `scan`, as read from `stream`. The
+ * scan needs to have been started with table_beginscan_analyze().  Note that
+ * this routine might acquire resources like locks that are held until
  * table_scan_analyze_next_tuple() returns false.
  *
- * Returns false if block is unsuitable for sampling, true otherwise.
+ * Returns false if there are no more blocks to sample, true otherwise.
  */
 static inline bool
-table_scan_analyze_next_block(TableScanDesc scan, BlockNumber blockno,
-							  BufferAccessStrategy bstrategy)
+table_scan_analyze_next_block(TableScanDesc scan, ReadStream *stream)
 {
-	return scan->rs_rd->rd_tableam->scan_analyze_next_block(scan, blockno,
-															bstrategy);
+	return scan->rs_rd->rd_tableam->scan_analyze_next_block(scan, stream);
 }
 
 /*
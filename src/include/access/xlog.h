@@ -197,6 +197,10 @@ extern XLogRecPtr XLogInsertRecord(struct XLogRecData *rdata,
 								   uint8 flags,
 								   int num_fpi,
 								   bool topxid_included);
+extern bool XLogInsertRecords(struct XLogRecData **rdatas, int nrecords,
+							  XLogRecPtr fpw_lsn, const uint8 *flags,
+							  int num_fpi, bool topxid_included,
+							  XLogRecPtr *EndPtrs);
 extern void XLogFlush(XLogRecPtr RecPtr);
 extern bool XLogBackgroundFlush(void);
 extern bool XLogNeedsFlush(XLogRecPtr RecPtr);
@@ -27,6 +27,9 @@
 #define XLR_NORMAL_MAX_BLOCK_ID		4
 #define XLR_NORMAL_RDATAS			20
 
+/* The maximum number of WAL records that can be queued with XLogBatchAdd() */
+#define XLR_MAX_BATCH_RECORDS		16
+
 /* flags for XLogRegisterBuffer */
 #define REGBUF_FORCE_IMAGE	0x01	/* force a full-page image */
 #define REGBUF_NO_IMAGE		0x02	/* don't take a full-page image */
@@ -51,6 +54,9 @@ extern void XLogRegisterBlock(uint8 block_id, RelFileNode *rnode,
 extern void XLogRegisterBufData(uint8 block_id, char *data, int len);
 extern void XLogResetInsertion(void);
 extern bool XLogCheckBufferNeedsBackup(Buffer buffer);
+extern void XLogBeginBatch(int max_records, int max_block_id, Size max_data);
+extern void XLogBatchAdd(RmgrId rmid, uint8 info);
+extern void XLogInsertBatch(XLogRecPtr *EndPtrs);
 
 extern XLogRecPtr log_newpage(RelFileNode *rnode, ForkNumber forkNum,
 							  BlockNumber blk, char *page, bool page_std);
@@ -307,6 +307,16 @@ struct XLogReaderState
 	char	   *readRecordBuf;
 	uint32		readRecordBufSize;
 
+	/*
+	 * Buffer holding the decompressed stream of the most recently restored
+	 * group of full-page images (see RestoreBlockImage), identified by the
+	 * LSN of its record and the block_id of the group's leader.
+	 */
+	char	   *fpiGroupBuf;
+	uint32		fpiGroupBufSize;
+	XLogRecPtr	fpiGroupLSN;
+	int			fpiGroupLeader;
+
 	/* Buffer to hold error message */
 	char	   *errormsg_buf;
 	bool		errormsg_deferred;
@@ -126,6 +126,19 @@ typedef struct XLogRecordBlockHeader
  * the length of extra information. Hence, when a page image is successfully
  * compressed, the amount of block data actually present is less than
  * BLCKSZ - the length of "hole" bytes - the length of extra information.
+ *
+ * When a record carries several full-page images, they can instead be
+ * compressed together as a single stream, which lets the compressor exploit
+ * redundancy between pages (e.g. the many similar pages written by a bulk
+ * load).  All images of such a group have BKPIMAGE_COMPRESS_GROUP set along
+ * with the same compression method.  The first block of the group, the
+ * "leader", carries the whole compressed stream as its image data; the other
+ * members have a length of zero.  The stream decompresses to the hole-less
+ * images of the leader and the members, concatenated in block_id order.  A
+ * group extends from its leader up to the next leader, or up to the first
+ * image without BKPIMAGE_COMPRESS_GROUP.  Group members always store the
+ * XLogRecordBlockCompressHeader if they have a hole, like any other
+ * compressed image.
  */
 typedef struct XLogRecordBlockImageHeader
 {
@@ -150,6 +163,8 @@ typedef struct XLogRecordBlockImageHeader
 #define BKPIMAGE_COMPRESS_PGLZ	0x04
 #define BKPIMAGE_COMPRESS_LZ4	0x08
 #define BKPIMAGE_COMPRESS_ZSTD	0x10
+/* image is part of a group compressed as one stream, see above */
+#define BKPIMAGE_COMPRESS_GROUP	0x20
 
 #define	BKPIMAGE_COMPRESSED(info) \
 	((info & (BKPIMAGE_COMPRESS_PGLZ | BKPIMAGE_COMPRESS_LZ4 | \
@@ -0,0 +1,44 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogredoworker.h
+ *		Declarations for parallel WAL redo.
+ *
+ * Portions Copyright (c) 2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/access/xlogredoworker.h
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGREDOWORKER_H
+#define XLOGREDOWORKER_H
+
+#include "access/xlogreader.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/relfilenode.h"
+
+/* GUCs */
+extern PGDLLIMPORT int recovery_redo_workers;
+
+extern Size RedoWorkerShmemSize(void);
+extern void RedoWorkerShmemInit(void);
+
+/* Functions used by the startup process */
+extern void RedoWorkersStart(Latch *wakeupLatch);
+extern bool RedoWorkersActive(void);
+extern bool RedoWorkerDispatch(XLogReaderState *record);
+extern bool RedoWorkerNeedsBarrier(XLogReaderState *record);
+extern void RedoWorkerAfterSerialRecord(XLogReaderState *record);
+extern void RedoWorkersWaitIdle(void);
+extern void RedoWorkersStop(void);
+
+/* Functions used by redo workers */
+extern bool IsRedoWorker(void);
+extern LWLock *RedoWorkerExtensionLock(RelFileNode rnode, ForkNumber forknum);
+extern void RedoWorkerLogInvalidPage(RelFileNode node, ForkNumber forkno,
+									 BlockNumber blkno, bool present);
+
+extern void RedoWorkerMain(Datum main_arg);
+
+#endif
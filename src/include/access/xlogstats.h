@@ -23,6 +23,8 @@ typedef struct XLogRecStats
 	uint64		count;
 	uint64		rec_len;
 	uint64		fpi_len;
+	uint64		fpi_count;		/* number of full-page images */
+	uint64		fpi_raw_len;	/* their length before compression */
 } XLogRecStats;
 
 typedef struct XLogStats
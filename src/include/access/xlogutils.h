@@ -57,6 +57,8 @@ extern PGDLLIMPORT HotStandbyState standbyState;
 #define InHotStandby (standbyState >= STANDBY_SNAPSHOT_PENDING)
 
 
+extern void XLogRememberInvalidPage(RelFileNode node, ForkNumber forkno,
+									BlockNumber blkno, bool present);
 extern bool XLogHaveInvalidPages(void);
 extern void XLogCheckInvalidPages(void);
 
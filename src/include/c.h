@@ -273,6 +273,19 @@
 #define unlikely(x) ((x) != 0)
 #endif
 
+/*
+ * pg_prefetch_mem
+ *		Hint to the CPU to start loading the cache line containing addr.
+ *
+ * This is only a hint; addr need not even be valid.  It is useful for
+ * overlapping the cache misses of several independent memory accesses.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define pg_prefetch_mem(addr)	__builtin_prefetch(addr)
+#else
+#define pg_prefetch_mem(addr)	((void) (addr))
+#endif
+
 /*
  * CppAsString
  *		Convert the argument to a string, using the C preprocessor.
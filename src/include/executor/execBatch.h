@@ -0,0 +1,56 @@
+/*-------------------------------------------------------------------------
+ * execBatch.h
+ *		Support for batch-at-a-time (vectorized) execution
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/executor/execBatch.h
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include "nodes/execnodes.h"
+
+/* maximum number of rows exchanged between nodes in one batch */
+#define EXEC_BATCH_SIZE		1024
+
+/*
+ * A batch of rows produced by a scan.
+ *
+ * values and isnull hold nrows * natts entries, row by row.  Only the rows
+ * listed in the selection vector sel[0 .. nsel - 1] passed the scan's quals;
+ * the others must be ignored.  By-reference datums are not guaranteed to stay
+ * valid and are never looked at by batch consumers, which only evaluate
+ * by-value types and null flags.
+ */
+typedef struct TupleBatch
+{
+	int			natts;			/* number of attributes per row */
+	int			nrows;			/* number of rows in the batch */
+	Datum	   *values;			/* nrows * natts attribute values */
+	bool	   *isnull;			/* nrows * natts null flags */
+	int			nsel;			/* number of selected rows */
+	uint16	   *sel;			/* indexes of the selected rows */
+} TupleBatch;
+
+/* private in execBatch.c */
+typedef struct BatchExpr BatchExpr;
+typedef struct BatchAgg BatchAgg;
+
+/* GUC */
+extern PGDLLIMPORT bool enable_batch_execution;
+
+extern BatchExpr *ExecBuildBatchExpr(Expr *expr, List *outer_tlist,
+									 int *maxattno);
+extern bool ExecBuildBatchQual(List *qual, List **batchqual, int *maxattno);
+extern TupleBatch *ExecCreateTupleBatch(int natts);
+extern void ExecBatchQual(List *batchqual, TupleBatch *batch);
+
+extern BatchAgg *ExecInitBatchAgg(AggState *aggstate);
+extern void ExecBatchAgg(AggState *aggstate);
+
+#endif							/* EXECBATCH_H */
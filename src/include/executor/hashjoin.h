@@ -142,6 +142,12 @@ typedef struct HashMemoryChunkData *HashMemoryChunk;
 /* tuples exceeding HASH_CHUNK_THRESHOLD bytes are put in their own chunk */
 #define HASH_CHUNK_THRESHOLD	(HASH_CHUNK_SIZE / 4)
 
+/* target size of a radix partition (buckets and tuples), about an L2 cache */
+#define HASH_RADIX_PARTITION_SIZE	(256 * 1024L)
+/* radix partition of a bucket */
+#define HASH_RADIX_PARTITION(hashtable, bucketno) \
+	((bucketno) >> ((hashtable)->log2_nbuckets - (hashtable)->radixBits))
+
 /*
  * For each batch of a Parallel Hash Join, we have a ParallelHashJoinBatch
  * object in shared memory to coordinate access to it.  Since they are
@@ -351,6 +357,19 @@ typedef struct HashJoinTableData
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/* one list for the whole batch */
 
+	/*
+	 * Radix partitioning of a private in-memory batch: when enabled by the
+	 * planner and the batch is large, its tuples are clustered in bucket
+	 * order, so that each of the 2^radixBits partitions (a range of buckets
+	 * and their tuples) is contiguous in memory; see
+	 * ExecHashTableRadixCluster.  radixBits is 0 if the current batch is not
+	 * partitioned.  radixBitsPeak is the highest radixBits of any batch, for
+	 * EXPLAIN.
+	 */
+	bool		radixEnabled;
+	int			radixBits;
+	int			radixBitsPeak;
+
 	/* Shared and private state for Parallel Hash. */
 	HashMemoryChunk current_chunk;	/* this backend's current chunk */
 	dsa_area   *area;			/* DSA area to allocate memory from */
@@ -15,10 +15,20 @@
 #define NODEHASH_H
 
 #include "access/parallel.h"
+#include "lib/bloomfilter.h"
 #include "nodes/execnodes.h"
 
 struct SharedHashJoinBatch;
 
+/*
+ * A Hash node publishes its runtime filter as a bytea datum that holds a
+ * copy of the Bloom filter, at a MAXALIGN'd offset.
+ */
+#define RUNTIME_FILTER_BLOOM_OFFSET MAXALIGN(VARHDRSZ)
+#define RuntimeFilterGetBloom(datum) \
+	((bloom_filter *) ((char *) DatumGetPointer(datum) + \
+					   RUNTIME_FILTER_BLOOM_OFFSET))
+
 extern HashState *ExecInitHash(Hash *node, EState *estate, int eflags);
 extern Node *MultiExecHash(HashState *node);
 extern void ExecEndHash(HashState *node);
@@ -53,12 +63,15 @@ extern void ExecHashGetBucketAndBatch(HashJoinTable hashtable,
 									  uint32 hashvalue,
 									  int *bucketno,
 									  int *batchno);
+extern void ExecHashPrefetchBucket(HashJoinTable hashtable, int bucketno,
+								   bool first_tuple);
 extern bool ExecScanHashBucket(HashJoinState *hjstate, ExprContext *econtext);
 extern bool ExecParallelScanHashBucket(HashJoinState *hjstate, ExprContext *econtext);
 extern void ExecPrepHashTableForUnmatched(HashJoinState *hjstate);
 extern bool ExecScanHashTableForUnmatched(HashJoinState *hjstate,
 										  ExprContext *econtext);
 extern void ExecHashTableReset(HashJoinTable hashtable);
+extern void ExecHashTableRadixCluster(HashJoinTable hashtable);
 extern void ExecHashTableResetMatchFlags(HashJoinTable hashtable);
 extern void ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 									bool try_combined_hash_mem,
@@ -87,7 +87,7 @@
  * the descriptor is provided), or when a descriptor is assigned to the slot;
  * they are of length equal to the descriptor's natts.
  *
- * The TTS_FLAG_SLOW flag is saved state for
+ * The TTS_FLAG_SLOW flag and tts_deform are saved state for
  * slot_deform_heap_tuple, and should not be touched by any other code.
  *----------
  */
@@ -111,6 +111,9 @@
 struct TupleTableSlotOps;
 typedef struct TupleTableSlotOps TupleTableSlotOps;
 
+/* precomputed tuple deforming instructions, private to execTuples.c */
+typedef struct TupleDeformProgram TupleDeformProgram;
+
 /* base tuple table slot type */
 typedef struct TupleTableSlot
 {
@@ -129,6 +132,7 @@ typedef struct TupleTableSlot
 	MemoryContext tts_mcxt;		/* slot itself is in this context */
 	ItemPointerData tts_tid;	/* stored tuple's tid */
 	Oid			tts_tableOid;	/* table oid of tuple */
+	TupleDeformProgram *tts_deform; /* for slot_deform_heap_tuple, or NULL */
 } TupleTableSlot;
 
 /* routines for a TupleTableSlot implementation */
@@ -326,6 +330,10 @@ extern HeapTuple ExecFetchSlotHeapTuple(TupleTableSlot *slot, bool materialize,
 extern MinimalTuple ExecFetchSlotMinimalTuple(TupleTableSlot *slot,
 											  bool *shouldFree);
 extern Datum ExecFetchSlotHeapTupleDatum(TupleTableSlot *slot);
+extern TupleDeformProgram *ExecBuildDeformProgram(TupleDesc tupdesc);
+extern void ExecDeformHeapTuples(TupleDeformProgram *program,
+								 HeapTuple *tuples, int ntuples, int natts,
+								 Datum *values, bool *isnull);
 extern void slot_getmissingattrs(TupleTableSlot *slot, int startAttNum,
 								 int lastAttNum);
 extern void slot_getsomeattrs_int(TupleTableSlot *slot, int attnum);
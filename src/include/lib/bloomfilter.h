@@ -23,5 +23,6 @@ extern void bloom_add_element(bloom_filter *filter, unsigned char *elem,
 extern bool bloom_lacks_element(bloom_filter *filter, unsigned char *elem,
 								size_t len);
 extern double bloom_prop_bits_set(bloom_filter *filter);
+extern size_t bloom_total_size(bloom_filter *filter);
 
 #endif							/* BLOOMFILTER_H */
@@ -1109,6 +1109,11 @@ typedef struct PlanState
 		if (((PlanState *)(node))->instrument) \
 			((PlanState *)(node))->instrument->nfiltered2 += (delta); \
 	} while(0)
+#define InstrCountFiltered3(node, delta) \
+	do { \
+		if (((PlanState *)(node))->instrument) \
+			((PlanState *)(node))->instrument->nfiltered3 += (delta); \
+	} while(0)
 
 /*
  * EPQState is state for executing an EvalPlanQual recheck on a candidate
@@ -1416,14 +1421,30 @@ typedef struct BitmapOrState
  *		currentRelation    relation being scanned (NULL if none)
  *		currentScanDesc    current scan descriptor for scan (NULL if none)
  *		ScanTupleSlot	   pointer to slot in tuple table holding scan tuple
+ *		rtfilters		   runtime filters pushed down from hash joins
+ *		nrtfilters		   number of entries in rtfilters
+ *		rtfiltersLoaded    have we fetched the filters since the last rescan?
  * ----------------
  */
+typedef struct RuntimeFilterState
+{
+	int			paramid;		/* ID of PARAM_EXEC param holding the filter */
+	int			nkeys;			/* number of hash keys */
+	ExprState **keys;			/* hash key expressions */
+	FmgrInfo   *hashfunctions;	/* outer-side hash functions, one per key */
+	Oid		   *collations;		/* collations for the hash functions */
+	struct bloom_filter *filter;	/* current filter, or NULL to pass all */
+} RuntimeFilterState;
+
 typedef struct ScanState
 {
 	PlanState	ps;				/* its first field is NodeTag */
 	Relation	ss_currentRelation;
 	struct TableScanDescData *ss_currentScanDesc;
 	TupleTableSlot *ss_ScanTupleSlot;
+	RuntimeFilterState *ss_rtfilters;
+	int			ss_nrtfilters;
+	bool		ss_rtfiltersLoaded;
 } ScanState;
 
 /* ----------------
@@ -1434,6 +1455,11 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+
+	/* batch mode support, see execBatch.c */
+	struct TupleBatch *batch;	/* batch buffer, NULL if not in batch mode */
+	List	   *batchqual;		/* quals compiled for batch evaluation */
+	TupleDeformProgram *batchprogram;	/* deforms the scanned tuples */
 } SeqScanState;
 
 /* ----------------
@@ -2040,6 +2066,23 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_ProbeCxt				memory context for buffered outer tuples
+ *		hj_ProbeTuples			outer tuples fetched ahead for batched probing
+ *		hj_ProbeHashValues		their hash values
+ *		hj_ProbeBucketNos		their buckets, or -1 if in a later batch
+ *		hj_ProbeOrder			order in which to probe them
+ *		hj_ProbeSize			allocated size of the above arrays
+ *		hj_ProbeCount			number of buffered outer tuples
+ *		hj_ProbeNext			index into hj_ProbeOrder of next one to probe
+ *		hj_ProbeExhausted		true if outer side of current batch is done
+ *		hj_NestLoopInner		nested-loop inner plan of an adaptive join
+ *		hj_AdaptiveState		strategy of an adaptive join, see
+ *								ExecAdaptiveJoin
+ *		hj_AdaptiveBuffer		outer tuples read before choosing it
+ *		hj_AdaptiveSlot			tuple slot for buffered outer tuples
+ *		hj_NestLoopNeedOuter	true if nested loop needs a new outer tuple
+ *		hj_NestLoopScans		times the nested-loop strategy was used
+ *		hj_HashScans			times the hash strategy was used
  * ----------------
  */
 
@@ -2067,6 +2110,22 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	MemoryContext hj_ProbeCxt;
+	MinimalTuple *hj_ProbeTuples;
+	uint32	   *hj_ProbeHashValues;
+	int		   *hj_ProbeBucketNos;
+	int		   *hj_ProbeOrder;
+	int			hj_ProbeSize;
+	int			hj_ProbeCount;
+	int			hj_ProbeNext;
+	bool		hj_ProbeExhausted;
+	PlanState  *hj_NestLoopInner;
+	int			hj_AdaptiveState;
+	Tuplestorestate *hj_AdaptiveBuffer;
+	TupleTableSlot *hj_AdaptiveSlot;
+	bool		hj_NestLoopNeedOuter;
+	uint64		hj_NestLoopScans;
+	uint64		hj_HashScans;
 } HashJoinState;
 
 
@@ -2095,6 +2154,7 @@ typedef struct MaterialState
 struct MemoizeEntry;
 struct MemoizeTuple;
 struct MemoizeKey;
+struct MemoizeSharedCache;
 
 typedef struct MemoizeInstrumentation
 {
@@ -2108,6 +2168,8 @@ typedef struct MemoizeInstrumentation
 									 * cache when filling it due to not being
 									 * able to free enough space to store the
 									 * current scan's tuples. */
+	uint64		cache_bypasses; /* number of rescans that skipped the cache
+								 * because the hit ratio was too low */
 	uint64		mem_peak;		/* peak memory usage in bytes */
 } MemoizeInstrumentation;
 
@@ -2160,6 +2222,16 @@ typedef struct MemoizeState
 	SharedMemoizeInfo *shared_info; /* statistics for parallel workers */
 	Bitmapset  *keyparamids;	/* Param->paramids of expressions belonging to
 								 * param_exprs */
+	double		est_hit_ratio;	/* planner's estimated hit ratio */
+	double		est_unique_keys;	/* planner's estimated distinct keys */
+	uint64		window_lookups; /* lookups in the current sampling window */
+	uint64		window_hits;	/* cache hits in the current sampling window */
+	bool		adaptive_bypass;	/* true if we've stopped using the cache */
+
+	/* these are only used when the cache is shared with parallel workers */
+	struct MemoizeSharedCache *shared_cache;	/* cache control in DSM */
+	struct dsa_area *shared_area;	/* area holding the shared cache entries */
+	MemoryContext scanContext;	/* per-scan copy of the current entry */
 } MemoizeState;
 
 /* ----------------
@@ -2180,12 +2252,41 @@ typedef struct PresortedKeyData
  *	 Shared memory container for per-worker sort information
  * ----------------
  */
+typedef struct SharedSortBound
+{
+	slock_t		mutex;
+	bool		valid;			/* has any participant published a bound? */
+	bool		isnull;
+	Datum		value;			/* always a pass-by-value key */
+} SharedSortBound;
+
 typedef struct SharedSortInfo
 {
 	int			num_workers;
+	bool		has_bound;		/* is 'bound' shared by the participants? */
+	SharedSortBound bound;		/* top-N bound, see nodeSort.c */
 	TuplesortInstrumentation sinstrument[FLEXIBLE_ARRAY_MEMBER];
 } SharedSortInfo;
 
+/* ----------------
+ *	 Top-N bound shared by bounded Sorts whose outputs are merged
+ *
+ *	 When a MergeAppend or Gather Merge must return only the first N tuples,
+ *	 no input tuple whose leading sort key sorts after the Nth tuple kept by
+ *	 any one of its Sort children can be among them.  The Sorts publish the
+ *	 tightest such key here and drop input tuples beyond it, see nodeSort.c.
+ * ----------------
+ */
+typedef struct SortBound
+{
+	SortSupportData ssup;		/* comparator for the leading sort key */
+	int16		typlen;			/* type info for the leading sort key */
+	bool		typbyval;
+	bool		valid;			/* has any Sort published a bound yet? */
+	bool		isnull;
+	Datum		value;			/* leading key of the tightest Nth tuple */
+} SortBound;
+
 /* ----------------
  *	 SortState information
  * ----------------
@@ -2203,6 +2304,10 @@ typedef struct SortState
 	bool		am_worker;		/* are we a worker? */
 	bool		datumSort;		/* Datum sort instead of tuple sort? */
 	SharedSortInfo *shared_info;	/* one entry per worker */
+	SortBound  *sortbound;		/* top-N bound shared with siblings, or NULL */
+	bool		share_bound;	/* also share it with parallel workers? */
+	SharedSortBound *shared_bound;	/* cross-process copy, or NULL */
+	int64		bound_skipped;	/* input tuples dropped due to sortbound */
 } SortState;
 
 /* ----------------
@@ -2396,6 +2501,11 @@ typedef struct AggState
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
 	SharedAggInfo *shared_info; /* one entry per worker */
+	struct BatchAgg *batch;		/* batch mode state, or NULL */
+	/* these fields are used in parallel-aware AGG_HASHED mode: */
+	struct ParallelAggState *pagg_state;	/* shared state, or NULL */
+	struct SharedTuplestoreAccessor **pagg_partitions;	/* shared input
+														 * partitions */
 } AggState;
 
 /* ----------------
@@ -2587,6 +2697,7 @@ typedef struct HashInstrumentation
 	int			nbatch;			/* number of batches at end of execution */
 	int			nbatch_original;	/* planned number of batches */
 	Size		space_peak;		/* peak memory usage in bytes */
+	int			radix_partitions;	/* radix partitions of largest batch */
 } HashInstrumentation;
 
 /* ----------------
@@ -2626,6 +2737,9 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	/* Runtime filter last published in the plan's rtfilterParam, or NULL */
+	bytea	   *rtfilter;
 } HashState;
 
 /* ----------------
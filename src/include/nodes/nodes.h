@@ -96,6 +96,7 @@ typedef enum NodeTag
 	T_PartitionPruneStepOp,
 	T_PartitionPruneStepCombine,
 	T_PlanInvalItem,
+	T_RuntimeFilter,
 
 	/*
 	 * TAGS FOR PLAN STATE NODES (execnodes.h)
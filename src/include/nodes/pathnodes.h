@@ -1249,6 +1249,10 @@ typedef struct Path
  * we need not recompute them when considering using the same index in a
  * bitmap index/heap scan (see BitmapHeapPath).  The costs of the IndexPath
  * itself represent the costs of an IndexScan or IndexOnlyScan plan type.
+ *
+ * 'indexskip' is set by the index AM's cost estimator if the scan may skip
+ * over leading index columns that have no quals.  The executor lets the
+ * index AM do that only for such scans.
  *----------
  */
 typedef struct IndexPath
@@ -1261,6 +1265,7 @@ typedef struct IndexPath
 	ScanDirection indexscandir;
 	Cost		indextotalcost;
 	Selectivity indexselectivity;
+	bool		indexskip;
 } IndexPath;
 
 /*
@@ -1533,6 +1538,9 @@ typedef struct MemoizePath
 	uint32		est_entries;	/* The maximum number of entries that the
 								 * planner expects will fit in the cache, or 0
 								 * if unknown */
+	Cardinality est_unique_keys;	/* estimated number of distinct cache
+									 * keys */
+	double		est_hit_ratio;	/* estimated cache hit ratio */
 } MemoizePath;
 
 /*
@@ -1682,6 +1690,7 @@ typedef struct HashPath
 	List	   *path_hashclauses;	/* join clauses used for hashing */
 	int			num_batches;	/* number of batches expected */
 	Cardinality inner_rows_total;	/* total inner rows expected */
+	bool		radix_partition;	/* cluster hash table by radix partition? */
 } HashPath;
 
 /*
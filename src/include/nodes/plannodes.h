@@ -345,6 +345,7 @@ typedef struct Scan
 {
 	Plan		plan;
 	Index		scanrelid;		/* relid is index into the range table */
+	List	   *rtfilters;		/* RuntimeFilters pushed down from hash joins */
 } Scan;
 
 /* ----------------
@@ -402,6 +403,9 @@ typedef struct SampleScan
  *
  * indexorderdir specifies the scan ordering, for indexscans on amcanorder
  * indexes (for other indexes it should be "don't care").
+ *
+ * indexskip tells the index AM that it may skip over leading index columns
+ * that have no quals (see IndexPath).
  * ----------------
  */
 typedef struct IndexScan
@@ -414,6 +418,7 @@ typedef struct IndexScan
 	List	   *indexorderbyorig;	/* the same in original form */
 	List	   *indexorderbyops;	/* OIDs of sort ops for ORDER BY exprs */
 	ScanDirection indexorderdir;	/* forward or backward or don't care */
+	bool		indexskip;		/* may skip over leading index columns? */
 } IndexScan;
 
 /* ----------------
@@ -456,6 +461,7 @@ typedef struct IndexOnlyScan
 	List	   *indexorderby;	/* list of index ORDER BY exprs */
 	List	   *indextlist;		/* TargetEntry list describing index's cols */
 	ScanDirection indexorderdir;	/* forward or backward or don't care */
+	bool		indexskip;		/* may skip over leading index columns? */
 } IndexOnlyScan;
 
 /* ----------------
@@ -482,6 +488,7 @@ typedef struct BitmapIndexScan
 	bool		isshared;		/* Create shared bitmap if set */
 	List	   *indexqual;		/* list of index quals (OpExprs) */
 	List	   *indexqualorig;	/* the same in original form */
+	bool		indexskip;		/* may skip over leading index columns? */
 } BitmapIndexScan;
 
 /* ----------------
@@ -802,6 +809,26 @@ typedef struct HashJoin
 	 * perform lookups in the hashtable over the inner plan.
 	 */
 	List	   *hashkeys;
+
+	/*
+	 * Cluster the in-memory hash table by radix partition and probe it in
+	 * partition order?  See ExecHashTableRadixCluster.
+	 */
+	bool		radix_partition;
+
+	/*
+	 * Adaptive joins.  When nlinner isn't NULL, the join was planned as a
+	 * nested loop, and nlinner is its (parameterized) inner plan, fed by
+	 * nestParams just as in a NestLoop.  The executor buffers up to
+	 * nl_max_rows outer tuples; if the outer side runs out before that, the
+	 * join is done by rescanning nlinner for each of them, otherwise it
+	 * switches to hashing the plain inner plan (the Hash node's child) and
+	 * probes it with the buffered tuples followed by the rest of the outer
+	 * input.
+	 */
+	Plan	   *nlinner;
+	List	   *nestParams;		/* list of NestLoopParam nodes */
+	Cardinality nl_max_rows;	/* outer rows to buffer before switching */
 } HashJoin;
 
 /* ----------------
@@ -836,6 +863,10 @@ typedef struct Memoize
 								 * planner expects will fit in the cache, or 0
 								 * if unknown */
 	Bitmapset  *keyparamids;	/* paramids from param_exprs */
+	Cardinality est_unique_keys;	/* estimated number of distinct cache
+									 * keys, or 0 if unknown */
+	double		est_hit_ratio;	/* estimated cache hit ratio, or 0 if
+								 * unknown */
 } Memoize;
 
 /* ----------------
@@ -1015,6 +1046,8 @@ typedef struct Hash
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
 	/* all other info is in the parent HashJoin node */
 	Cardinality rows_total;		/* estimate total rows if parallel_aware */
+	int			rtfilterParam;	/* ID of Param to publish runtime filter in,
+								 * or -1 if none */
 } Hash;
 
 /* ----------------
@@ -1329,6 +1362,27 @@ typedef struct PlanInvalItem
 	uint32		hashValue;		/* hash value of object's cache lookup key */
 } PlanInvalItem;
 
+/*
+ * RuntimeFilter -
+ *		a filter built by a Hash node and applied by a scan below the outer
+ *		side of its hash join
+ *
+ * The Hash node publishes a Bloom filter of the hash values of its inner
+ * tuples in the PARAM_EXEC param identified by paramid.  The scan computes
+ * the hash value of hashkeys in exactly the way the hash join computes it
+ * for outer tuples, and discards tuples whose hash value the filter doesn't
+ * contain, since they cannot have a join partner.  While the param is null,
+ * the filter passes everything.
+ */
+typedef struct RuntimeFilter
+{
+	NodeTag		type;
+	int			paramid;		/* ID of PARAM_EXEC param holding the filter */
+	List	   *hashkeys;		/* outer-side hash key expressions */
+	List	   *hashoperators;	/* hash join operators, one per key */
+	List	   *hashcollations; /* collations of the hash join keys */
+} RuntimeFilter;
+
 /*
  * MonotonicFunction
  *
@@ -122,15 +122,22 @@ typedef struct buftag
  * The shared buffer mapping table is partitioned to reduce contention.
  * To determine which partition lock a given tag requires, compute the tag's
  * hash code with BufTableHashCode(), then apply BufMappingPartitionLock().
- * NB: NUM_BUFFER_PARTITIONS must be a power of 2!
+ * The number of partitions is a power of 2 that scales with NBuffers, but is
+ * at least NUM_BUFFER_PARTITIONS; it's fixed at shared memory initialization.
+ * The partition locks live in an array of their own, not in MainLWLockArray.
  */
+extern PGDLLIMPORT int NumBufMappingPartitions;
+extern PGDLLIMPORT LWLockPadded *BufMappingLWLockArray;
+
 #define BufTableHashPartition(hashcode) \
-	((hashcode) % NUM_BUFFER_PARTITIONS)
+	((hashcode) & (NumBufMappingPartitions - 1))
 #define BufMappingPartitionLock(hashcode) \
-	(&MainLWLockArray[BUFFER_MAPPING_LWLOCK_OFFSET + \
-		BufTableHashPartition(hashcode)].lock)
+	(&BufMappingLWLockArray[BufTableHashPartition(hashcode)].lock)
 #define BufMappingPartitionLockByIndex(i) \
-	(&MainLWLockArray[BUFFER_MAPPING_LWLOCK_OFFSET + (i)].lock)
+	(&BufMappingLWLockArray[(i)].lock)
+
+/* Number of lookup hints per hint bucket, see buf_table.c */
+#define BUF_TABLE_HINT_WAYS		4
 
 /*
  *	BufferDesc -- shared descriptor/state data for a single shared buffer.
@@ -141,9 +148,10 @@ typedef struct buftag
  * single atomic variable.  This layout allow us to do some operations in a
  * single atomic operation, without actually acquiring and releasing spinlock;
  * for instance, increase or decrease refcount.  buf_id field never changes
- * after initialization, so does not need locking.  freeNext is protected by
- * the buffer_strategy_lock not buffer header lock.  The LWLock can take care
- * of itself.  The buffer header lock is *not* used to control access to the
+ * after initialization, so does not need locking.  Whether freeNext is
+ * FREENEXT_NOT_IN_LIST is protected by the buffer header lock; while the
+ * buffer is in the freelist, its link is managed by the lock-free list
+ * operations in freelist.c.  The LWLock can take care of itself.  The buffer header lock is *not* used to control access to the
  * data in the buffer!
  *
  * It's assumed that nobody changes the state field while buffer header lock
@@ -320,15 +328,43 @@ extern void StrategyNotifyBgWriter(int bgwprocno);
 
 extern Size StrategyShmemSize(void);
 extern void StrategyInitialize(bool init);
+extern void StrategyInitAccess(void);
 extern bool have_free_buffer(void);
 
 /* buf_table.c */
-extern Size BufTableShmemSize(int size);
-extern void InitBufTable(int size);
+extern Size BufTableShmemSize(void);
+extern void InitBufTable(void);
 extern uint32 BufTableHashCode(BufferTag *tagPtr);
 extern int	BufTableLookup(BufferTag *tagPtr, uint32 hashcode);
 extern int	BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id);
 extern void BufTableDelete(BufferTag *tagPtr, uint32 hashcode);
+extern int	BufTableLookupHints(uint32 hashcode, int *buf_ids);
+extern void BufTableSetHint(uint32 hashcode, int buf_id, bool exclusive);
+extern void BufTableClearHint(uint32 hashcode, int buf_id);
+
+/* buf_numa.c */
+
+/* Maximum number of NUMA nodes the buffer pool can be striped over */
+#define BUFFER_NUMA_MAX_NODES		64
+
+/* Number of buffers BufferNumaLocalCandidates() returns */
+#define BUFFER_NUMA_LOCAL_BATCH		16
+
+/* Number of buffers per NUMA stripe, or 0 if the pool is not striped */
+extern PGDLLIMPORT int BufferNumaStripe;
+
+extern Size BufferNumaPageSize(void);
+extern Size BufferNumaShmemSize(void);
+extern void BufferNumaInit(bool init);
+extern int	BufferNumaLocalCandidates(int *buf_ids);
+extern void BufferNumaFlushStats(void);
+extern void BufferNumaCountHit(int buf_id);
+extern void BufferNumaCountAlloc(int buf_id);
+extern void BufferNumaResetStats(void);
+extern int	BufferNumaStripes(void);
+extern void BufferNumaGetStripe(int stripeno, int *os_node, int *first_buffer,
+								int *nbuffers, uint64 *hits,
+								uint64 *remote_hits, uint64 *allocs);
 
 /* localbuf.c */
 extern PrefetchBufferResult PrefetchLocalBuffer(SMgrRelation smgr,
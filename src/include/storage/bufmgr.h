@@ -14,6 +14,7 @@
 #ifndef BUFMGR_H
 #define BUFMGR_H
 
+#include "port/pg_iovec.h"
 #include "storage/block.h"
 #include "storage/buf.h"
 #include "storage/bufpage.h"
@@ -61,6 +62,19 @@ struct WritebackContext;
 /* forward declared, to avoid including smgr.h here */
 struct SMgrRelationData;
 
+/*
+ * A read of a range of consecutive blocks that has been started with
+ * StartReadBuffers(), and must be finished with WaitReadBuffers().
+ */
+typedef struct ReadBuffersOperation
+{
+	Relation	rel;
+	ForkNumber	forknum;
+	BlockNumber blocknum;		/* first block of the range */
+	Buffer	   *buffers;		/* caller's array of pinned buffers */
+	int			nmisses;		/* number of leading buffers to read */
+} ReadBuffersOperation;
+
 /* in globals.c ... this duplicates miscadmin.h */
 extern PGDLLIMPORT int NBuffers;
 
@@ -71,6 +85,7 @@ extern PGDLLIMPORT double bgwriter_lru_multiplier;
 extern PGDLLIMPORT bool track_io_timing;
 extern PGDLLIMPORT int effective_io_concurrency;
 extern PGDLLIMPORT int maintenance_io_concurrency;
+extern PGDLLIMPORT int io_combine_limit;
 
 extern PGDLLIMPORT int checkpoint_flush_after;
 extern PGDLLIMPORT int backend_flush_after;
@@ -79,6 +94,9 @@ extern PGDLLIMPORT int bgwriter_flush_after;
 /* in buf_init.c */
 extern PGDLLIMPORT char *BufferBlocks;
 
+/* in buf_numa.c */
+extern PGDLLIMPORT bool numa_shared_buffers;
+
 /* in localbuf.c */
 extern PGDLLIMPORT int NLocBuffer;
 extern PGDLLIMPORT Block *LocalBufferBlockPointers;
@@ -87,6 +105,13 @@ extern PGDLLIMPORT int32 *LocalRefCount;
 /* upper limit for effective_io_concurrency */
 #define MAX_IO_CONCURRENCY 1000
 
+/* upper limit and default for io_combine_limit, in blocks */
+#define MAX_IO_COMBINE_LIMIT PG_IOV_MAX
+#define DEFAULT_IO_COMBINE_LIMIT Min(MAX_IO_COMBINE_LIMIT, (128 * 1024) / BLCKSZ)
+
+/* upper limit on the number of buffers in one batch of reads or writes */
+#define MAX_IO_BATCH_BUFFERS (4 * MAX_IO_COMBINE_LIMIT)
+
 /* special block number for ReadBuffer() */
 #define P_NEW	InvalidBlockNumber	/* grow the file to get a new page */
 
@@ -182,6 +207,16 @@ extern Buffer ReadBuffer(Relation reln, BlockNumber blockNum);
 extern Buffer ReadBufferExtended(Relation reln, ForkNumber forkNum,
 								 BlockNumber blockNum, ReadBufferMode mode,
 								 BufferAccessStrategy strategy);
+extern void LimitAdditionalPins(uint32 *additional_pins);
+extern bool ReadBuffers(Relation reln, ForkNumber forkNum,
+						BlockNumber blockNum, int *nblocks,
+						BufferAccessStrategy strategy, Buffer *buffers);
+extern bool StartReadBuffers(ReadBuffersOperation *operation,
+							 Relation reln, ForkNumber forkNum,
+							 BlockNumber blockNum, int *nblocks,
+							 BufferAccessStrategy strategy, Buffer *buffers);
+extern void WaitReadBuffers(ReadBuffersOperation *operations,
+							int noperations);
 extern Buffer ReadBufferWithoutRelcache(RelFileNode rnode,
 										ForkNumber forkNum, BlockNumber blockNum,
 										ReadBufferMode mode, BufferAccessStrategy strategy,
@@ -248,6 +283,7 @@ extern void TestForOldSnapshot_impl(Snapshot snapshot, Relation relation);
 /* in freelist.c */
 extern BufferAccessStrategy GetAccessStrategy(BufferAccessStrategyType btype);
 extern void FreeAccessStrategy(BufferAccessStrategy strategy);
+extern void StrategyResetStats(void);
 
 
 /* inline functions */
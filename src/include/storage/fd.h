@@ -51,15 +51,45 @@ typedef enum RecoveryInitSyncMethod
 	RECOVERY_INIT_SYNC_METHOD_SYNCFS
 }			RecoveryInitSyncMethod;
 
+typedef enum IoMethod
+{
+	IO_METHOD_SYNC,
+	IO_METHOD_IO_URING
+}			IoMethod;
+
+/* io_uring is available if the kernel headers know about it */
+#ifdef HAVE_LINUX_IO_URING_H
+#define USE_IO_URING
+#endif
+
 struct iovec;					/* avoid including port/pg_iovec.h here */
 
 typedef int File;
 
+/*
+ * A read or write for FilePerformIO().  The caller fills in the first group
+ * of fields; result is set on completion to the number of bytes transferred,
+ * or -1 with the errno value in error.
+ */
+typedef struct FileIORequest
+{
+	File		file;
+	bool		is_write;
+	off_t		offset;
+	const struct iovec *iov;
+	int			iovcnt;
+	uint32		wait_event_info;
+
+	int			result;
+	int			error;
+} FileIORequest;
+
 
 /* GUC parameter */
 extern PGDLLIMPORT int max_files_per_process;
 extern PGDLLIMPORT bool data_sync_retry;
 extern PGDLLIMPORT int recovery_init_sync_method;
+extern PGDLLIMPORT int io_method;
 
 /*
  * This is private to fd.c, but exported for save/restore_backend_variables()
@@ -107,6 +137,9 @@ extern void FileClose(File file);
 extern int	FilePrefetch(File file, off_t offset, int amount, uint32 wait_event_info);
 extern int	FileRead(File file, char *buffer, int amount, off_t offset, uint32 wait_event_info);
 extern int	FileWrite(File file, char *buffer, int amount, off_t offset, uint32 wait_event_info);
+extern int	FileReadV(File file, const struct iovec *iov, int iovcnt, off_t offset, uint32 wait_event_info);
+extern int	FileWriteV(File file, const struct iovec *iov, int iovcnt, off_t offset, uint32 wait_event_info);
+extern void FilePerformIO(FileIORequest *reqs, int nreqs);
 extern int	FileSync(File file, uint32 wait_event_info);
 extern off_t FileSize(File file);
 extern int	FileTruncate(File file, off_t offset, uint32 wait_event_info);
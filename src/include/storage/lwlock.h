@@ -75,11 +75,15 @@ extern PGDLLIMPORT int NamedLWLockTrancheRequests;
 
 /*
  * It's a bit odd to declare NUM_BUFFER_PARTITIONS and NUM_LOCK_PARTITIONS
- * here, but we need them to figure out offsets within MainLWLockArray, and
- * having this file include lock.h or bufmgr.h would be backwards.
+ * here, but we need the lock manager ones to figure out offsets within
+ * MainLWLockArray, and having this file include lock.h or bufmgr.h would be
+ * backwards.
  */
 
-/* Number of partitions of the shared buffer mapping hashtable */
+/*
+ * Minimum number of partitions of the shared buffer mapping hashtable; the
+ * actual number scales with shared_buffers (see buf_table.c)
+ */
 #define NUM_BUFFER_PARTITIONS  128
 
 /* Number of partitions the shared lock tables are divided into */
@@ -91,9 +95,7 @@ extern PGDLLIMPORT int NamedLWLockTrancheRequests;
 #define NUM_PREDICATELOCK_PARTITIONS  (1 << LOG2_NUM_PREDICATELOCK_PARTITIONS)
 
 /* Offsets for various chunks of preallocated lwlocks. */
-#define BUFFER_MAPPING_LWLOCK_OFFSET	NUM_INDIVIDUAL_LWLOCKS
-#define LOCK_MANAGER_LWLOCK_OFFSET		\
-	(BUFFER_MAPPING_LWLOCK_OFFSET + NUM_BUFFER_PARTITIONS)
+#define LOCK_MANAGER_LWLOCK_OFFSET		NUM_INDIVIDUAL_LWLOCKS
 #define PREDICATELOCK_MANAGER_LWLOCK_OFFSET \
 	(LOCK_MANAGER_LWLOCK_OFFSET + NUM_LOCK_PARTITIONS)
 #define NUM_FIXED_LWLOCKS \
@@ -193,6 +195,8 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_PGSTATS_DSA,
 	LWTRANCHE_PGSTATS_HASH,
 	LWTRANCHE_PGSTATS_DATA,
+	LWTRANCHE_REDO_EXTENSION,
+	LWTRANCHE_PARALLEL_MEMOIZE,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
@@ -143,7 +143,12 @@ typedef struct TuplesortInstrumentation
  * 1. Request tuplesort-private shared memory for n workers.  Use
  *    tuplesort_estimate_shared() to get the required size.
  * 2. Have leader process initialize allocated shared memory using
- *    tuplesort_initialize_shared().  Launch workers.
+ *    tuplesort_initialize_shared().  Launch workers, and report the number
+ *    of participants (workers launched, plus the leader if it participates
+ *    as a worker) using tuplesort_launched_shared().  Participants may wait
+ *    for one another, so no participant should begin performing its sort
+ *    within the leader until all launched workers are known to have
+ *    attached.
  * 3. Initialize a coordinate argument within both the leader process, and
  *    for each worker process.  This has a pointer to the shared
  *    tuplesort-private structure, as well as some caller-initialized fields.
@@ -240,6 +245,8 @@ extern Tuplesortstate *tuplesort_begin_datum(Oid datumType,
 
 extern void tuplesort_set_bound(Tuplesortstate *state, int64 bound);
 extern bool tuplesort_used_bound(Tuplesortstate *state);
+extern bool tuplesort_get_bound_key(Tuplesortstate *state, Datum *key,
+									bool *isnull);
 
 extern void tuplesort_puttupleslot(Tuplesortstate *state,
 								   TupleTableSlot *slot);
@@ -276,6 +283,7 @@ extern int	tuplesort_merge_order(int64 allowedMem);
 extern Size tuplesort_estimate_shared(int nworkers);
 extern void tuplesort_initialize_shared(Sharedsort *shared, int nWorkers,
 										dsm_segment *seg);
+extern void tuplesort_launched_shared(Sharedsort *shared, int nParticipants);
 extern void tuplesort_attach_shared(Sharedsort *shared, dsm_segment *seg);
 
 /*
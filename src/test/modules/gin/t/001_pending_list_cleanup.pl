@@ -0,0 +1,81 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Verify that GIN pending lists are cleaned up by autovacuum work items, and
+# by the inserting backend once the list has grown far past its limit
+
+use strict;
+use warnings;
+
+use PostgreSQL::Test::Utils;
+use Test::More;
+use PostgreSQL::Test::Cluster;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf('postgresql.conf', 'autovacuum_naptime=1s');
+$node->start;
+
+$node->safe_psql('postgres', 'create extension pageinspect');
+
+# Keep autovacuum from vacuuming or analyzing the table, which would clean up
+# the pending list too; only the work items should do that here.  With a
+# 64kB gin_pending_list_limit, the list is over the limit once it has more
+# than 8 pages, and over four times the limit past 32 pages.
+$node->safe_psql(
+	'postgres',
+	'create table gin_pl (a int[]) with (autovacuum_vacuum_threshold = 1000000000,
+	   autovacuum_vacuum_insert_threshold = 1000000000,
+	   autovacuum_analyze_threshold = 1000000000);
+	 create index gin_pl_idx on gin_pl using gin (a)
+	   with (fastupdate = on, gin_pending_list_limit = 64);
+	 '
+);
+
+my $metapage = "gin_metapage_info(get_raw_page('gin_pl_idx', 0))";
+
+# Fill the list past the limit, but not past four times the limit.  REINDEX
+# holds an AccessExclusiveLock on the index until commit, so autovacuum can't
+# process the work item before we have looked at the list.
+my $result = $node->safe_psql(
+	'postgres',
+	"begin;
+	 reindex index gin_pl_idx;
+	 insert into gin_pl select array[g] from generate_series(1, 6000) g;
+	 select n_pending_pages > 8, n_pending_pages <= 32, n_pending_tuples
+	   from $metapage;
+	 commit;"
+);
+is($result, 't|t|6000', "insert past the limit leaves the pending list alone");
+
+$node->poll_query_until('postgres',
+	"select n_pending_pages = 0 from $metapage", 't')
+  or die "timed out waiting for autovacuum to clean up the pending list";
+
+$result = $node->safe_psql('postgres',
+	"select n_pending_pages, n_pending_tuples from $metapage");
+is($result, '0|0', "autovacuum cleaned up the pending list");
+
+# Now go past four times the limit, again without letting autovacuum in.  The
+# inserting backend has to clean up the list itself.
+$result = $node->safe_psql(
+	'postgres',
+	"begin;
+	 reindex index gin_pl_idx;
+	 insert into gin_pl select array[g] from generate_series(6001, 36000) g;
+	 select n_pending_pages <= 32, n_pending_tuples < 30000 from $metapage;
+	 commit;"
+);
+is($result, 't|t', "insert past four times the limit cleans up the list");
+
+# Check that the index still gives the right answers
+$result = $node->safe_psql(
+	'postgres',
+	"set enable_seqscan = off;
+	 select count(*) from gin_pl where a && '{1, 6000, 6001, 36000, 36001}';"
+);
+is($result, '4', "index returns the inserted rows");
+
+$node->stop;
+
+done_testing();
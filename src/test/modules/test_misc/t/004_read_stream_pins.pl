@@ -0,0 +1,73 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Check that read streams don't pin more buffers than a tiny shared_buffers
+# can spare, with each of the available I/O methods.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+# 16 buffers is the minimum.  Ask for the deepest look-ahead we can get, and
+# keep synchronized scans from moving the starting points of the cursors.
+$node->append_conf(
+	'postgresql.conf', qq{
+shared_buffers = 128kB
+effective_io_concurrency = 16
+maintenance_io_concurrency = 16
+synchronize_seqscans = off
+autovacuum = off
+});
+$node->start;
+
+$node->safe_psql(
+	'postgres', q{
+create table big (a int, b text);
+insert into big select g, repeat('x', 100) from generate_series(1, 100000) g;
+});
+
+my @methods = ('sync');
+push @methods, 'io_uring'
+  if $node->safe_psql('postgres',
+	"select 'io_uring' = any(enumvals) from pg_settings where name = 'io_method'"
+  ) eq 't';
+
+foreach my $method (@methods)
+{
+	$node->append_conf('postgresql.conf', "io_method = $method");
+	$node->reload;
+	$node->poll_query_until('postgres', 'show io_method', $method)
+	  or die "timed out waiting for io_method to become $method";
+
+	# Several streams reading ahead at once in one backend
+	my $result = $node->safe_psql(
+		'postgres', q{
+begin;
+declare c1 cursor for select a from big;
+declare c2 cursor for select a from big;
+declare c3 cursor for select a from big;
+move 20000 in c1;
+move 20000 in c2;
+move 40000 in c3;
+move 20000 in c1;
+fetch 1 from c1;
+fetch 1 from c2;
+fetch 1 from c3;
+commit;
+});
+	is($result, "40001\n20001\n40001",
+		"interleaved scans with io_method = $method");
+
+	$result = $node->safe_psql('postgres',
+		'vacuum big; analyze big; select count(*), sum(a) from big');
+	is($result, '100000|5000050000',
+		"vacuum, analyze and scan with io_method = $method");
+}
+
+$node->stop;
+
+done_testing();
@@ -0,0 +1,131 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Test replay with redo workers on a standby, and that the minimum recovery
+# point covers the pages they have modified when the standby crashes.
+
+use strict;
+use warnings;
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node_primary = PostgreSQL::Test::Cluster->new('primary');
+$node_primary->init(allows_streaming => 1);
+$node_primary->start;
+
+$node_primary->safe_psql('postgres',
+	'CREATE TABLE redo_tbl (id int PRIMARY KEY, val text)');
+
+my $backup_name = 'my_backup';
+$node_primary->backup($backup_name);
+
+my $node_standby = PostgreSQL::Test::Cluster->new('standby');
+$node_standby->init_from_backup($node_primary, $backup_name,
+	has_streaming => 1);
+$node_standby->append_conf('postgresql.conf', 'recovery_redo_workers = 2');
+$node_standby->start;
+
+$node_primary->wait_for_catchup($node_standby, 'replay',
+	$node_primary->lsn('insert'));
+
+is( $node_standby->safe_psql(
+		'postgres',
+		"SELECT count(*) FROM pg_stat_activity WHERE backend_type = 'redo worker'"
+	),
+	'2',
+	'redo workers are running on the standby');
+
+# Generate single-page records for the workers to replay: inserts into the
+# heap and the index, then updates and deletes.  Each batch is a single
+# transaction, so that the workers get long runs of records without a
+# barrier in between.  Restartpoints on the standby in between flush pages
+# modified by the workers.
+for my $i (0 .. 4)
+{
+	my $lo = $i * 20000 + 1;
+	my $hi = ($i + 1) * 20000;
+
+	$node_primary->safe_psql('postgres',
+		"INSERT INTO redo_tbl SELECT g, repeat('x', 50) FROM generate_series($lo, $hi) g"
+	);
+	$node_primary->safe_psql('postgres',
+		"UPDATE redo_tbl SET val = 'updated' WHERE id % 7 = $i");
+	$node_primary->safe_psql('postgres',
+		"DELETE FROM redo_tbl WHERE id % 11 = $i");
+	$node_primary->safe_psql('postgres', 'CHECKPOINT');
+
+	$node_primary->wait_for_catchup($node_standby, 'replay',
+		$node_primary->lsn('insert'));
+	$node_standby->safe_psql('postgres', 'CHECKPOINT');
+}
+
+# One more batch that the standby has not restarted from.
+$node_primary->safe_psql('postgres',
+	"UPDATE redo_tbl SET val = 'final' WHERE id % 3 = 0");
+my $expected = $node_primary->safe_psql('postgres',
+	"SELECT count(*), sum(id), count(*) FILTER (WHERE val = 'final') FROM redo_tbl"
+);
+
+$node_primary->wait_for_catchup($node_standby, 'replay',
+	$node_primary->lsn('insert'));
+
+is( $node_standby->safe_psql(
+		'postgres',
+		"SELECT count(*), sum(id), count(*) FILTER (WHERE val = 'final') FROM redo_tbl"
+	),
+	$expected,
+	'standby replayed all changes with redo workers');
+
+# Crash the standby and check that it only declares itself consistent after
+# replaying everything that was already on disk.
+$node_standby->stop('immediate');
+$node_standby->start;
+
+$node_primary->safe_psql('postgres',
+	"INSERT INTO redo_tbl VALUES (0, 'after crash')");
+$expected = $node_primary->safe_psql('postgres',
+	"SELECT count(*), sum(id), count(*) FILTER (WHERE val = 'final') FROM redo_tbl"
+);
+$node_primary->wait_for_catchup($node_standby, 'replay',
+	$node_primary->lsn('insert'));
+
+is( $node_standby->safe_psql(
+		'postgres',
+		"SELECT count(*), sum(id), count(*) FILTER (WHERE val = 'final') FROM redo_tbl"
+	),
+	$expected,
+	'standby is consistent after a crash');
+
+# Read the index on its own and check that it has the same entries as the
+# heap.
+my $index_only = 'SET enable_seqscan = off; SET enable_bitmapscan = off; ';
+my $heap_only =
+  'SET enable_indexscan = off; SET enable_indexonlyscan = off; '
+  . 'SET enable_bitmapscan = off; ';
+my $query = 'SELECT count(*), sum(id) FROM redo_tbl';
+
+like(
+	$node_standby->safe_psql('postgres',
+		$index_only . "EXPLAIN (COSTS OFF) $query"),
+	qr/Index Only Scan using redo_tbl_pkey on redo_tbl/,
+	'index-only scan is used on the standby');
+is( $node_standby->safe_psql('postgres', $index_only . $query),
+	$node_standby->safe_psql('postgres', $heap_only . $query),
+	'index on the standby matches the heap');
+
+my $log = slurp_file($node_standby->logfile);
+unlike(
+	$log,
+	qr/min recovery request .* is past current point/,
+	'minimum recovery point covered every page flushed by redo workers');
+unlike(
+	$log,
+	qr/could not start redo workers/,
+	'redo workers were started');
+
+$node_standby->stop;
+$node_primary->stop;
+
+done_testing();
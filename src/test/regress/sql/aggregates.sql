@@ -163,6 +163,19 @@ group by ten order by ten;
 select ten, count(four), sum(DISTINCT four) from onek
 group by ten order by ten;
 
+-- test batch execution of plain aggregates
+set enable_batch_execution = on;
+explain (costs off)
+select count(*), sum(unique1), avg(ten), min(unique1), max(unique1)
+  from tenk1 where four = 1 and ten < 5;
+select count(*), sum(unique1), avg(ten), min(unique1), max(unique1)
+  from tenk1 where four = 1 and ten < 5;
+select count(*), sum(unique1 * 2), max(ten - four) from tenk1
+  where ten = 9 and two = 1;
+-- overflow is reported just like in row-at-a-time execution
+select sum(unique1 * 1000000) from tenk1 where ten = 9;
+reset enable_batch_execution;
+
 -- user-defined aggregates
 SELECT newavg(four) AS avg_1 FROM onek;
 SELECT newsum(four) AS sum_1500 FROM onek;
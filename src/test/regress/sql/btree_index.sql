@@ -242,3 +242,160 @@ CREATE TABLE btree_part (id int4) PARTITION BY RANGE (id);
 CREATE INDEX btree_part_idx ON btree_part(id);
 ALTER INDEX btree_part_idx ALTER COLUMN id SET (n_distinct=100);
 DROP TABLE btree_part;
+
+--
+-- Test skip scans, where there are no conditions on the leading index column
+--
+CREATE TABLE btree_skip (a int, b int, c int);
+INSERT INTO btree_skip SELECT g % 20, g % 13, g FROM generate_series(1, 20000) g;
+INSERT INTO btree_skip SELECT NULL, g % 13, -g FROM generate_series(1, 300) g;
+INSERT INTO btree_skip SELECT g % 20, NULL, g FROM generate_series(1, 40) g;
+CREATE INDEX btree_skip_idx ON btree_skip (a, b);
+VACUUM ANALYZE btree_skip;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SET enable_indexskipscan = on;
+SELECT count(*), sum(c) FROM btree_skip WHERE b = 5;
+SELECT a, c FROM btree_skip WHERE b = 5 AND c BETWEEN 0 AND 120
+ORDER BY a, b, c;
+SELECT a, c FROM btree_skip WHERE b = 5 AND c BETWEEN 0 AND 120
+ORDER BY a DESC, b DESC, c DESC;
+SELECT count(*), min(c) FROM btree_skip WHERE b = 5 AND c < -280;
+SELECT count(*), count(DISTINCT a) FROM btree_skip WHERE b IS NULL;
+SELECT count(*), sum(c) FROM btree_skip WHERE b IN (2, 7);
+SELECT count(*) FROM btree_skip WHERE b > 11;
+-- index-only scan
+SELECT count(*), count(a), count(DISTINCT a) FROM btree_skip WHERE b = 12;
+-- backward scan, which finds the NULL prefix first
+SET enable_hashagg = off;
+EXPLAIN (COSTS OFF)
+SELECT a, count(*), sum(c) FROM btree_skip WHERE b = 5 GROUP BY a ORDER BY a DESC;
+SELECT a, count(*), sum(c) FROM btree_skip WHERE b = 5 GROUP BY a ORDER BY a DESC;
+-- mark and restore, under a merge join
+SET enable_hashjoin = off;
+SET enable_nestloop = off;
+SET enable_material = off;
+SELECT count(*), sum(s1.c), sum(s2.c)
+FROM btree_skip s1 JOIN btree_skip s2 ON s1.a = s2.a
+WHERE s1.b = 5 AND s2.b = 7;
+-- the same results without skipping
+SET enable_indexskipscan = off;
+SELECT a, count(*), sum(c) FROM btree_skip WHERE b = 5 GROUP BY a ORDER BY a DESC;
+SELECT count(*), sum(s1.c), sum(s2.c)
+FROM btree_skip s1 JOIN btree_skip s2 ON s1.a = s2.a
+WHERE s1.b = 5 AND s2.b = 7;
+SET enable_indexskipscan = on;
+RESET enable_hashagg;
+RESET enable_hashjoin;
+RESET enable_nestloop;
+RESET enable_material;
+-- many small prefixes, mostly handled without new descents
+CREATE TABLE btree_skip2 AS
+  SELECT g % 2000 AS a, g % 7 AS b FROM generate_series(1, 20000) g;
+CREATE INDEX btree_skip2_idx ON btree_skip2 (a, b);
+VACUUM ANALYZE btree_skip2;
+SELECT count(*), sum(a) FROM btree_skip2 WHERE b = 3;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET enable_indexskipscan;
+DROP TABLE btree_skip;
+DROP TABLE btree_skip2;
+
+--
+-- Test IN-list (ScalarArrayOpExpr) scans that advance the array keys
+-- within a leaf page rather than descending the tree again
+--
+CREATE TABLE btree_arr AS
+  SELECT g / 10 AS a, g % 10 AS b FROM generate_series(0, 29999) g;
+CREATE INDEX btree_arr_idx ON btree_arr (a, b);
+VACUUM ANALYZE btree_arr;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(b) FROM btree_arr
+WHERE a = ANY (ARRAY(SELECT generate_series(0, 3000, 7)));
+SELECT a, b FROM btree_arr WHERE a IN (5, 1000, 1001, 2999, 4000) AND b IN (0, 9)
+ORDER BY a DESC, b DESC;
+SELECT count(*) FROM btree_arr
+WHERE a = ANY ('{1, 2, 500, 501, 502, 2998, 5000}') AND b > 6;
+SELECT count(*) FROM btree_arr WHERE a = ANY ('{4, 3, NULL, 3}');
+SET enable_indexscan = off;
+SET enable_bitmapscan = on;
+SELECT count(*) FROM btree_arr
+WHERE a = ANY (ARRAY(SELECT generate_series(-5, 4000, 3)));
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET enable_indexscan;
+DROP TABLE btree_arr;
+
+--
+-- Test compressed posting lists
+--
+CREATE TABLE btree_cpl (a int, b int);
+CREATE INDEX btree_cpl_ins_idx ON btree_cpl (a)
+  WITH (compress_posting_lists = on);
+CREATE INDEX btree_cpl_plain_idx ON btree_cpl (a);
+INSERT INTO btree_cpl SELECT g % 20, g FROM generate_series(1, 20000) g;
+SELECT pg_relation_size('btree_cpl_ins_idx') <
+  pg_relation_size('btree_cpl_plain_idx') AS compressed_is_smaller;
+DROP INDEX btree_cpl_plain_idx;
+CREATE INDEX btree_cpl_build_idx ON btree_cpl (a)
+  WITH (compress_posting_lists = on);
+VACUUM ANALYZE btree_cpl;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT a, count(*) FROM btree_cpl WHERE a IN (0, 7, 19) GROUP BY a ORDER BY a;
+SELECT count(*) FROM btree_cpl WHERE a = 3 AND b BETWEEN 1000 AND 1999;
+DELETE FROM btree_cpl WHERE b % 3 = 0 OR a = 5;
+VACUUM btree_cpl;
+-- reuse freed heap space, splitting existing posting lists
+INSERT INTO btree_cpl SELECT g % 20, g FROM generate_series(1, 5000) g;
+SELECT a, count(*) FROM btree_cpl WHERE a IN (0, 5, 7, 19) GROUP BY a ORDER BY a;
+SELECT count(*) FROM btree_cpl WHERE a = 3 AND b BETWEEN 1000 AND 1999;
+ALTER INDEX btree_cpl_ins_idx SET (compress_posting_lists = off);
+REINDEX INDEX btree_cpl_ins_idx;
+SELECT count(*) FROM btree_cpl WHERE a = 11;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE btree_cpl;
+
+--
+-- Test key prefix compression
+--
+CREATE TABLE btree_kpc (a int, t text);
+CREATE INDEX btree_kpc_idx ON btree_kpc (a, t)
+  WITH (compress_key_prefixes = on);
+CREATE INDEX btree_kpc_plain_idx ON btree_kpc (a, t);
+INSERT INTO btree_kpc
+  SELECT g / 1000, 'https://www.example.com/some/long/path/' || g
+  FROM generate_series(1, 10000) g;
+SELECT pg_relation_size('btree_kpc_idx') <
+  pg_relation_size('btree_kpc_plain_idx') AS compressed_is_smaller;
+DROP INDEX btree_kpc_plain_idx;
+VACUUM ANALYZE btree_kpc;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM btree_kpc WHERE a = 3;
+SELECT t FROM btree_kpc
+  WHERE a = 5 AND t = 'https://www.example.com/some/long/path/5123';
+SELECT * FROM btree_kpc ORDER BY a DESC, t DESC LIMIT 3;
+-- empty some leaf pages, then add tuples that don't match their prefix
+DELETE FROM btree_kpc WHERE a = 4;
+VACUUM btree_kpc;
+INSERT INTO btree_kpc VALUES (4, NULL), (NULL, 'x');
+INSERT INTO btree_kpc
+  SELECT 4, 'https://www.example.com/other/' || g
+  FROM generate_series(1, 2000) g;
+SELECT count(*) FROM btree_kpc WHERE a = 4;
+SELECT count(*) FROM btree_kpc WHERE a = 4 AND t IS NULL;
+SELECT count(*) FROM btree_kpc WHERE a IS NULL;
+SELECT count(*) FROM btree_kpc WHERE a = 3;
+ALTER INDEX btree_kpc_idx SET (compress_key_prefixes = off);
+INSERT INTO btree_kpc
+  SELECT 3, 'https://www.example.com/some/long/path/3/' || g
+  FROM generate_series(1, 500) g;
+SELECT count(*) FROM btree_kpc WHERE a = 3;
+REINDEX INDEX btree_kpc_idx;
+SELECT count(*) FROM btree_kpc WHERE a = 3;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE btree_kpc;
@@ -171,3 +171,72 @@ reset enable_seqscan;
 reset enable_bitmapscan;
 
 drop table t_gin_test_tbl;
+
+-- Test parallel index build.  The table's parallel_workers setting makes
+-- the planner ask for two workers whatever maintenance_work_mem is, and a
+-- small maintenance_work_mem makes each participant write several sorted
+-- runs for the leader to merge.  The result is compared against the same
+-- index built serially.
+create table gin_parallel_tbl(id int4, i int4[], t text[])
+  with (parallel_workers = 2, autovacuum_enabled = off);
+insert into gin_parallel_tbl
+  select g, array[g % 10, g % 1000, g],
+         case when g % 500 <> 0 then array['a' || g % 7, 'b' || g % 100] end
+  from generate_series(1, 50000) g;
+create table gin_serial_tbl(id int4, i int4[], t text[])
+  with (autovacuum_enabled = off);
+insert into gin_serial_tbl select * from gin_parallel_tbl;
+set maintenance_work_mem = '1MB';
+set max_parallel_maintenance_workers = 0;
+create index gin_serial_idx on gin_serial_tbl using gin (i, t);
+set max_parallel_maintenance_workers = 2;
+create index gin_parallel_idx on gin_parallel_tbl using gin (i, t);
+
+-- Look up every key of the text column, and a sample of the integer keys
+-- that includes all of the ones with long posting lists, in both indexes.
+create view gin_build_compare as
+  select 'i' as col, count(*) as keys,
+         count(*) filter (where p.ids is distinct from s.ids) as mismatches
+  from (select distinct unnest(i) as k from gin_serial_tbl) ik,
+       lateral (select array_agg(id order by id) as ids
+                from gin_parallel_tbl where i @> array[ik.k]) p,
+       lateral (select array_agg(id order by id) as ids
+                from gin_serial_tbl where i @> array[ik.k]) s
+  where ik.k < 1000 or ik.k % 97 = 0
+  union all
+  select 't', count(*),
+         count(*) filter (where p.ids is distinct from s.ids)
+  from (select distinct unnest(t) as k from gin_serial_tbl) tk,
+       lateral (select array_agg(id order by id) as ids
+                from gin_parallel_tbl where t @> array[tk.k]) p,
+       lateral (select array_agg(id order by id) as ids
+                from gin_serial_tbl where t @> array[tk.k]) s;
+
+set enable_seqscan = off;
+set enable_bitmapscan = on;
+
+explain (costs off)
+select count(*) from gin_parallel_tbl where i @> array[3];
+select count(*) from gin_parallel_tbl where i @> array[3];
+select count(*) from gin_parallel_tbl where i && array[0, 25000];
+select count(*) from gin_parallel_tbl where t @> array['a3', 'b42'];
+select count(*) from gin_parallel_tbl where i @> array[3] and t @> array['b3'];
+select * from gin_build_compare;
+
+-- Without the table's parallel_workers setting, the planner only asks for
+-- workers if each participant gets at least 32MB.  Each participant then
+-- writes a single run.
+alter table gin_parallel_tbl reset (parallel_workers);
+set min_parallel_table_scan_size = 0;
+set maintenance_work_mem = '96MB';
+reindex index gin_parallel_idx;
+select * from gin_build_compare;
+
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset min_parallel_table_scan_size;
+reset max_parallel_maintenance_workers;
+reset maintenance_work_mem;
+
+drop view gin_build_compare;
+drop table gin_parallel_tbl, gin_serial_tbl;
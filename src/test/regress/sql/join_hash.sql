@@ -556,3 +556,183 @@ WHERE
     AND hjtest_1.a <> hjtest_2.b;
 
 ROLLBACK;
+
+-- Runtime filters built by hash joins must not change the results
+BEGIN;
+SET LOCAL enable_runtime_filter = on;
+SET LOCAL enable_mergejoin = off;
+SET LOCAL enable_nestloop = off;
+CREATE FUNCTION pg_temp.explain_rtfilter(query text) RETURNS SETOF text
+LANGUAGE plpgsql AS
+$$
+DECLARE
+  ln text;
+BEGIN
+  FOR ln IN
+    EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF) ' || query
+  LOOP
+    ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+    RETURN NEXT ln;
+  END LOOP;
+END;
+$$;
+-- the filter goes to the scan on the probe side
+EXPLAIN (COSTS OFF)
+SELECT count(*), sum(t1.unique1), sum(t1.ten)
+FROM tenk1 t1 JOIN onek t2 ON t1.unique1 = t2.unique1
+WHERE t2.ten = 1;
+SELECT pg_temp.explain_rtfilter($$
+  SELECT count(*), sum(t1.unique1), sum(t1.ten)
+  FROM tenk1 t1 JOIN onek t2 ON t1.unique1 = t2.unique1
+  WHERE t2.ten = 1
+$$);
+SELECT count(*), sum(t1.unique1), sum(t1.ten)
+FROM tenk1 t1 JOIN onek t2 ON t1.unique1 = t2.unique1
+WHERE t2.ten = 1;
+SELECT count(*)
+FROM tenk1 t1 JOIN onek t2 ON t1.unique1 = t2.unique1 AND t1.ten = t2.ten
+WHERE t2.four = 1;
+SELECT count(*) FROM tenk1 WHERE unique1 IN (SELECT unique1 FROM onek WHERE ten = 1);
+-- the hash table and its filter are rebuilt for each outer row
+SELECT pg_temp.explain_rtfilter($$
+  SELECT t.ten,
+         (SELECT count(a.ten) FROM tenk1 a JOIN onek b ON a.unique1 = b.unique1
+          WHERE b.ten = t.ten)
+  FROM (VALUES (1), (2)) t(ten)
+$$);
+SELECT t.ten,
+       (SELECT count(a.ten) FROM tenk1 a JOIN onek b ON a.unique1 = b.unique1
+        WHERE b.ten = t.ten)
+FROM (VALUES (1), (2)) t(ten);
+ROLLBACK;
+
+-- Adaptive joins must return the same rows with either strategy
+BEGIN;
+SET LOCAL enable_adaptive_join = on;
+SET LOCAL enable_hashjoin = off;
+SET LOCAL enable_mergejoin = off;
+SET LOCAL enable_memoize = off;
+-- the outer side is estimated to be small, but isn't
+CREATE TEMP TABLE adaptive_outer (a int) WITH (autovacuum_enabled = off);
+INSERT INTO adaptive_outer VALUES (1);
+ANALYZE adaptive_outer;
+INSERT INTO adaptive_outer SELECT g % 1000 FROM generate_series(1, 5000) g;
+CREATE FUNCTION pg_temp.explain_adaptive(query text) RETURNS SETOF text
+LANGUAGE plpgsql AS
+$$
+DECLARE
+  ln text;
+BEGIN
+  FOR ln IN
+    EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF) ' || query
+  LOOP
+    ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+    ln := regexp_replace(ln, 'Heap Fetches: \d+', 'Heap Fetches: N');
+    RETURN NEXT ln;
+  END LOOP;
+END;
+$$;
+-- too many outer rows, so it switches to hashing
+SELECT pg_temp.explain_adaptive($$
+  SELECT count(*), sum(t.unique1)
+  FROM adaptive_outer o JOIN tenk1 t ON t.unique1 = o.a
+$$);
+SELECT count(*), sum(t.unique1)
+FROM adaptive_outer o JOIN tenk1 t ON t.unique1 = o.a;
+SELECT count(*), sum(t.unique1)
+FROM adaptive_outer o JOIN tenk1 t ON t.unique1 = o.a AND t.unique1 + o.a < 1000;
+SELECT count(*) FROM adaptive_outer o
+WHERE EXISTS (SELECT 1 FROM tenk1 t WHERE t.unique1 = o.a + 9500);
+-- the strategy is chosen again on each rescan
+SELECT v.x,
+       (SELECT count(*) FROM adaptive_outer o JOIN tenk1 t ON t.unique1 = o.a
+        WHERE o.a < v.x)
+FROM (VALUES (10), (2000)) v(x);
+-- a small outer side keeps the nested loop
+CREATE TEMP TABLE adaptive_small AS SELECT g AS a FROM generate_series(1, 3) g;
+ANALYZE adaptive_small;
+SELECT pg_temp.explain_adaptive($$
+  SELECT count(*), sum(t.unique1)
+  FROM adaptive_small s JOIN tenk1 t ON t.unique1 = s.a
+$$);
+SELECT count(*), sum(t.unique1)
+FROM adaptive_small s JOIN tenk1 t ON t.unique1 = s.a;
+ROLLBACK;
+
+-- Big hash tables are probed with groups of outer tuples fetched ahead
+BEGIN;
+SET LOCAL work_mem = '512kB';
+SET LOCAL hash_mem_multiplier = 1.0;
+SET LOCAL max_parallel_workers_per_gather = 0;
+SET LOCAL enable_mergejoin = off;
+SET LOCAL enable_nestloop = off;
+CREATE TEMP TABLE readahead_inner AS SELECT g AS id FROM generate_series(1, 50000) g;
+CREATE TEMP TABLE readahead_outer AS SELECT g AS id FROM generate_series(1, 200000) g;
+ANALYZE readahead_inner, readahead_outer;
+CREATE FUNCTION pg_temp.hash_node(query text) RETURNS jsonb LANGUAGE plpgsql AS
+$$
+DECLARE
+  plan json;
+BEGIN
+  EXECUTE 'EXPLAIN (ANALYZE, FORMAT JSON) ' || query INTO plan;
+  RETURN jsonb_path_query_first(plan::jsonb,
+                                'strict $[0].Plan.** ? (@."Node Type" == "Hash")');
+END;
+$$;
+-- enough buckets for read-ahead, and multiple batches
+SELECT (h->>'Original Hash Buckets')::int >= 16384 AS read_ahead,
+       (h->>'Original Hash Batches')::int > 1 AS multibatch
+FROM pg_temp.hash_node($$
+  SELECT count(*) FROM readahead_outer o JOIN readahead_inner i USING (id)
+$$) h;
+SELECT count(*), sum(i.id)
+FROM readahead_outer o JOIN readahead_inner i USING (id);
+SELECT count(*)
+FROM readahead_outer o LEFT JOIN readahead_inner i USING (id)
+WHERE i.id IS NULL;
+-- a rescan must discard outer tuples fetched ahead but not yet probed
+-- (the filtered outer side is still estimated to be the bigger one)
+SELECT v.x,
+       (SELECT count(*) FROM
+          (SELECT o.id FROM readahead_outer o JOIN readahead_inner i USING (id)
+           WHERE o.id > v.x LIMIT 1000) s)
+FROM (VALUES (0), (49500), (60000)) v(x);
+ROLLBACK;
+
+-- Radix partitioning of big in-memory hash tables, with a lowered threshold
+BEGIN;
+SET LOCAL enable_radix_hashjoin = on;
+SET LOCAL radix_hashjoin_threshold = '1MB';
+SET LOCAL work_mem = '16MB';
+SET LOCAL hash_mem_multiplier = 1.0;
+SET LOCAL max_parallel_workers_per_gather = 0;
+SET LOCAL enable_mergejoin = off;
+SET LOCAL enable_nestloop = off;
+CREATE TEMP TABLE radix_inner AS SELECT g AS id FROM generate_series(1, 50000) g;
+CREATE TEMP TABLE radix_outer AS SELECT g AS id FROM generate_series(1, 100000) g;
+ANALYZE radix_inner, radix_outer;
+CREATE FUNCTION pg_temp.explain_radix(query text) RETURNS SETOF text
+LANGUAGE plpgsql AS
+$$
+DECLARE
+  ln text;
+BEGIN
+  FOR ln IN
+    EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF) ' || query
+  LOOP
+    ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+    ln := regexp_replace(ln, 'Radix Partitions: \d+', 'Radix Partitions: N');
+    RETURN NEXT ln;
+  END LOOP;
+END;
+$$;
+-- the hash table was clustered, so the outer side was probed in groups
+SELECT pg_temp.explain_radix($$
+  SELECT count(*) FROM radix_outer o JOIN radix_inner i USING (id)
+$$);
+SELECT count(*), sum(i.id)
+FROM radix_outer o JOIN radix_inner i USING (id);
+SELECT count(*)
+FROM radix_outer o LEFT JOIN radix_inner i USING (id)
+WHERE i.id IS NULL;
+ROLLBACK;
@@ -183,6 +183,38 @@ SELECT ''::text AS two, unique1, unique2, stringu1
 		FROM onek WHERE unique1 > 50
 		FETCH FIRST 2 ROW WITH TIES;
 
+-- bounded Sorts below a MergeAppend share their top-N bound
+CREATE TEMP TABLE topn_parted (p int, k int, t text) PARTITION BY LIST (p);
+CREATE TEMP TABLE topn_parted_1 PARTITION OF topn_parted FOR VALUES IN (1);
+CREATE TEMP TABLE topn_parted_2 PARTITION OF topn_parted FOR VALUES IN (2);
+CREATE TEMP TABLE topn_parted_3 PARTITION OF topn_parted FOR VALUES IN (3);
+INSERT INTO topn_parted
+  SELECT g % 3 + 1, (g * 7919) % 10007, 'x' || g FROM generate_series(1, 9000) g;
+ANALYZE topn_parted;
+SELECT k, t FROM topn_parted ORDER BY k LIMIT 5;
+CREATE FUNCTION pg_temp.explain_topn(query text) RETURNS SETOF text
+LANGUAGE plpgsql AS
+$$
+DECLARE
+  ln text;
+BEGIN
+  FOR ln IN
+    EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF) ' || query
+  LOOP
+    ln := regexp_replace(ln, 'Memory: \d+', 'Memory: N');
+    RETURN NEXT ln;
+  END LOOP;
+END;
+$$;
+-- each Sort shows how many input rows it skipped
+SELECT pg_temp.explain_topn('SELECT k, t FROM topn_parted ORDER BY k LIMIT 5');
+SELECT k FROM topn_parted ORDER BY k DESC LIMIT 3 OFFSET 2;
+SELECT t FROM topn_parted ORDER BY t LIMIT 3;
+-- the bound must be forgotten on rescan
+SELECT * FROM (VALUES (1), (2)) v(x),
+  LATERAL (SELECT k FROM topn_parted WHERE p <> v.x ORDER BY k LIMIT 2) s;
+DROP TABLE topn_parted;
+
 -- test ruleutils
 CREATE VIEW limit_thousand_v_1 AS SELECT thousand FROM onek WHERE thousand < 995
 		ORDER BY thousand FETCH FIRST 5 ROWS WITH TIES OFFSET 10;
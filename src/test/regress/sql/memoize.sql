@@ -148,7 +148,60 @@ SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
 LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
 WHERE t1.unique1 < 1000;
 
+-- The workers share one cache.  Make it small enough to see evictions, and
+-- ensure we still get the correct results.
+SET work_mem TO '64kB';
+SET hash_mem_multiplier TO 1.0;
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.thousand = t2.unique1) t2
+WHERE t1.unique1 < 5000;
+RESET hash_mem_multiplier;
+RESET work_mem;
+
+-- With no workers launched, the leader uses the shared cache on its own,
+-- which makes for stable EXPLAIN ANALYZE output.  Only show the Gather and
+-- Memoize details, as the rest of the plan doesn't matter here.
+SET max_parallel_workers TO 0;
+SELECT ltrim(e) AS explain_memoize FROM explain_memoize('
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
+WHERE t1.unique1 < 1000;', false) e
+WHERE e ~ 'Workers|Memoize|Cache|Hits';
+-- Evictions from the shared cache
+SET work_mem TO '64kB';
+SET hash_mem_multiplier TO 1.0;
+SELECT ltrim(e) AS explain_memoize FROM explain_memoize('
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.thousand = t2.unique1) t2
+WHERE t1.unique1 < 5000;', true) e
+WHERE e ~ 'Workers|Hits';
+RESET hash_mem_multiplier;
+RESET work_mem;
+RESET max_parallel_workers;
+
 RESET max_parallel_workers_per_gather;
 RESET parallel_tuple_cost;
 RESET parallel_setup_cost;
 RESET min_parallel_table_scan_size;
+
+-- Stop using the cache when the hit ratio falls far short of the planner's
+-- estimate.  The statistics say there are only 10 distinct values, but every
+-- value is different.
+CREATE TABLE memo_bypass (a int) WITH (autovacuum_enabled = off);
+INSERT INTO memo_bypass SELECT g % 10 FROM generate_series(1, 5000) g;
+ANALYZE memo_bypass;
+DELETE FROM memo_bypass;
+INSERT INTO memo_bypass SELECT g FROM generate_series(1, 5000) g;
+SET enable_hashjoin TO off;
+SET enable_mergejoin TO off;
+-- After the first 1000 lookups all missed, the other 4000 rescans bypass
+-- the cache
+SELECT explain_memoize('
+SELECT COUNT(*),AVG(t2.unique1) FROM memo_bypass b,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE b.a = t2.unique1) t2;', false);
+-- And check we get the expected results.
+SELECT COUNT(*),AVG(t2.unique1) FROM memo_bypass b,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE b.a = t2.unique1) t2;
+RESET enable_mergejoin;
+RESET enable_hashjoin;
+DROP TABLE memo_bypass;
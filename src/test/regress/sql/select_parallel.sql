@@ -314,6 +314,54 @@ reset enable_material;
 
 reset enable_hashagg;
 
+-- parallel-aware hash aggregation: each participant aggregates whole groups,
+-- so there is no Finalize step.  array_agg() has no combine function, so
+-- this is the only way to aggregate in parallel here.
+set enable_parallel_hashagg = on;
+
+explain (costs off)
+select sp_parallel_restricted(count(g)::int), sum(n) from
+  (select unique1 % 1000 as g, cardinality(array_agg(unique2)) as n
+   from tenk1 group by 1) ss;
+
+select sp_parallel_restricted(count(g)::int), sum(n) from
+  (select unique1 % 1000 as g, cardinality(array_agg(unique2)) as n
+   from tenk1 group by 1) ss;
+
+-- partitions that don't fit in work_mem are spilled further
+set work_mem = '64kB';
+set enable_sort = off;
+
+explain (costs off)
+select sp_parallel_restricted(count(g)::int), sum(n) from
+  (select unique1 % 1000 as g, cardinality(array_agg(unique2)) as n
+   from tenk1 group by 1) ss;
+
+select sp_parallel_restricted(count(g)::int), sum(n) from
+  (select unique1 % 1000 as g, cardinality(array_agg(unique2)) as n
+   from tenk1 group by 1) ss;
+
+reset enable_sort;
+reset work_mem;
+-- the shared partitions are set up again when the Gather is rescanned
+set enable_material = false;
+
+explain (costs off)
+select * from
+  (select sp_parallel_restricted(count(g)::int) as c, sum(n) as s from
+     (select unique1 % 1000 as g, cardinality(array_agg(unique2)) as n
+      from tenk1 group by 1) g) ss
+  right join (values (1),(2),(3)) v(x) on true;
+
+select * from
+  (select sp_parallel_restricted(count(g)::int) as c, sum(n) as s from
+     (select unique1 % 1000 as g, cardinality(array_agg(unique2)) as n
+      from tenk1 group by 1) g) ss
+  right join (values (1),(2),(3)) v(x) on true;
+
+reset enable_material;
+reset enable_parallel_hashagg;
+
 -- check parallelized int8 aggregate (bug #14897)
 explain (costs off)
 select avg(unique1::int8) from tenk1;
@@ -48,6 +48,10 @@ select count(*) > 0 as ok from pg_stat_slru;
 -- There must be only one record
 select count(*) = 1 as ok from pg_stat_wal;
 
+-- There must be only one record, and buffers have surely been allocated
+select count(*) = 1 and sum(freelist_allocs + clock_sweep_allocs) > 0 as ok
+  from pg_stat_buffer_strategy;
+
 -- We expect no walreceiver running in this test
 select count(*) = 0 as ok from pg_stat_wal_receiver;
 
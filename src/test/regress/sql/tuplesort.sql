@@ -259,6 +259,88 @@ FROM (
 
 ROLLBACK;
 
+----
+-- test radix sorting of large in-memory sorts
+---
+
+CREATE TEMP TABLE radix_sort_data AS
+    SELECT g,
+        (g * 7919) % 30011 - 15000 AS i4,
+        CASE WHEN g % 97 = 0 THEN NULL
+             ELSE (g::int8 * 1000003) % 1000000007 - 500000000 END AS i8,
+        md5(g::text)::uuid AS u,
+        md5(g::text) COLLATE "C" AS t
+    FROM generate_series(1, 30000) g;
+
+BEGIN;
+SET LOCAL work_mem = '64MB';
+
+-- int32 comparator
+SELECT count(*) FILTER (WHERE i4 < prev) AS misordered
+FROM (SELECT i4, lag(i4) OVER (ORDER BY i4) AS prev FROM radix_sort_data) s;
+
+-- signed comparator, descending with NULLs
+SELECT count(*) FILTER (WHERE i8 > prev OR (prev_null AND i8 IS NOT NULL)) AS misordered,
+       count(*) FILTER (WHERE i8 IS NULL) AS nulls
+FROM (SELECT i8, lag(i8) OVER w AS prev, lag(i8 IS NULL, 1, false) OVER w AS prev_null
+      FROM radix_sort_data WINDOW w AS (ORDER BY i8 DESC NULLS LAST)) s;
+
+-- unsigned comparator over abbreviated keys
+SELECT count(*) FILTER (WHERE u < prev) AS misordered
+FROM (SELECT u, lag(u) OVER (ORDER BY u) AS prev FROM radix_sort_data) s;
+
+SELECT count(*) FILTER (WHERE t < prev) AS misordered
+FROM (SELECT t, lag(t) OVER (ORDER BY t) AS prev FROM radix_sort_data) s;
+
+-- ties on the leading key are resolved by the remaining keys
+SELECT count(*) FILTER (WHERE (k, -g) < (pk, -pg)) AS misordered
+FROM (SELECT i4 % 100 AS k, g,
+             lag(i4 % 100) OVER w AS pk, lag(g) OVER w AS pg
+      FROM radix_sort_data WINDOW w AS (ORDER BY i4 % 100, g DESC)) s;
+
+ROLLBACK;
+
+DROP TABLE radix_sort_data;
+
+----
+-- test parallel index builds, whose workers merge partitions of the output
+----
+
+CREATE TABLE parallel_sort_data WITH (parallel_workers = 2) AS
+    SELECT (g * 7919) % 50000 AS a,
+        CASE WHEN g = 50000 THEN 1 ELSE g END AS b,
+        md5(g::text) COLLATE "C" AS t
+    FROM generate_series(1, 50000) g;
+
+SET max_parallel_maintenance_workers = 2;
+SET max_parallel_workers = 2;
+
+CREATE UNIQUE INDEX parallel_sort_data_a ON parallel_sort_data (a);
+CREATE INDEX parallel_sort_data_t ON parallel_sort_data (t);
+
+\set SHOW_CONTEXT never
+CREATE UNIQUE INDEX parallel_sort_data_b ON parallel_sort_data (b);
+\set SHOW_CONTEXT errors
+
+RESET max_parallel_maintenance_workers;
+RESET max_parallel_workers;
+
+BEGIN;
+SET LOCAL enable_seqscan = off;
+SET LOCAL enable_bitmapscan = off;
+
+SELECT count(*) FILTER (WHERE a < prev) AS misordered, count(*)
+FROM (SELECT a, lag(a) OVER (ORDER BY a) AS prev FROM parallel_sort_data) s;
+
+SELECT count(*) FILTER (WHERE t < prev) AS misordered, count(*)
+FROM (SELECT t, lag(t) OVER (ORDER BY t) AS prev FROM parallel_sort_data) s;
+
+SELECT count(*) FROM parallel_sort_data WHERE a BETWEEN 12345 AND 23456;
+SELECT count(*) FROM parallel_sort_data WHERE t >= 'c' AND t < 'd';
+
+ROLLBACK;
+
+DROP TABLE parallel_sort_data;
 
 ----
 -- test tuplesort mark/restore
@@ -299,6 +299,8 @@ sub GenerateFiles
 		HAVE_I_CONSTRAINT__BUILTIN_CONSTANT_P       => undef,
 		HAVE_KQUEUE                                 => undef,
 		HAVE_LANGINFO_H                             => undef,
+		HAVE_LINUX_IO_URING_H                       => undef,
+		HAVE_LINUX_MEMPOLICY_H                      => undef,
 		HAVE_LDAP_H                                 => undef,
 		HAVE_LDAP_INITIALIZE                        => undef,
 		HAVE_LIBCRYPTO                              => undef,